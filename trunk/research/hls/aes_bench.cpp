@@ -0,0 +1,92 @@
+// Benchmark the HLS encryption, compare the plaintext, the legacy AES_cbc_encrypt for each 4 TS packets,
+// and the bulk EVP encryption which uses AES-NI if available.
+// Usage:
+//      make aes_bench && ./aes_bench
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <openssl/aes.h>
+#include <openssl/evp.h>
+
+#define TS_PACKET_SIZE 188
+// The size of a segment, about 10s of 2Mbps.
+#define SEGMENT_SIZE (TS_PACKET_SIZE * 13300)
+#define NB_SEGMENTS 100
+#define LEGACY_BLOCK (TS_PACKET_SIZE * 4)
+#define BULK_BLOCK (TS_PACKET_SIZE * 512)
+
+int64_t now_us()
+{
+    timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+void report(const char* name, int64_t cost, int64_t plaintext)
+{
+    double mbps = (double)SEGMENT_SIZE * NB_SEGMENTS / 1024 / 1024 / (cost / 1000000.0);
+    printf("%-10s cost=%dms, throughput=%.1fMB/s, ratio=%.2f\n", name, (int)(cost / 1000), mbps,
+        plaintext ? (double)cost / plaintext : 1.0);
+}
+
+int main(int argc, char** argv)
+{
+    unsigned char key[16], iv[16];
+    memset(key, 0x5a, sizeof(key));
+    memset(iv, 0xa5, sizeof(iv));
+
+    char* segment = new char[SEGMENT_SIZE];
+    for (int i = 0; i < SEGMENT_SIZE; i++) {
+        segment[i] = (char)rand();
+    }
+    char* out = new char[SEGMENT_SIZE + 16];
+
+    // The plaintext, copy each TS packet to output.
+    int64_t starttime = now_us();
+    for (int k = 0; k < NB_SEGMENTS; k++) {
+        for (int i = 0; i < SEGMENT_SIZE; i += TS_PACKET_SIZE) {
+            memcpy(out + i, segment + i, TS_PACKET_SIZE);
+        }
+    }
+    int64_t plaintext = now_us() - starttime;
+    report("plaintext", plaintext, 0);
+
+    // The legacy, set key for each segment, and encrypt each 4 TS packets.
+    starttime = now_us();
+    for (int k = 0; k < NB_SEGMENTS; k++) {
+        AES_KEY aes;
+        AES_set_encrypt_key(key, 128, &aes);
+        unsigned char civ[16];
+        memcpy(civ, iv, 16);
+        for (int i = 0; i + LEGACY_BLOCK <= SEGMENT_SIZE; i += LEGACY_BLOCK) {
+            char* cipher = new char[LEGACY_BLOCK];
+            AES_cbc_encrypt((unsigned char*)segment + i, (unsigned char*)cipher, LEGACY_BLOCK, &aes, civ, AES_ENCRYPT);
+            memcpy(out + i, cipher, LEGACY_BLOCK);
+            delete[] cipher;
+        }
+    }
+    report("legacy", now_us() - starttime, plaintext);
+
+    // The bulk, reset the iv for each segment, and encrypt in bulk by EVP.
+    starttime = now_us();
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv);
+    for (int k = 0; k < NB_SEGMENTS; k++) {
+        EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv);
+        int nn = 0, pos = 0;
+        for (int i = 0; i < SEGMENT_SIZE; i += BULK_BLOCK) {
+            int size = (SEGMENT_SIZE - i < BULK_BLOCK) ? SEGMENT_SIZE - i : BULK_BLOCK;
+            EVP_EncryptUpdate(ctx, (unsigned char*)out + pos, &nn, (unsigned char*)segment + i, size);
+            pos += nn;
+        }
+        EVP_EncryptFinal_ex(ctx, (unsigned char*)out + pos, &nn);
+    }
+    EVP_CIPHER_CTX_free(ctx);
+    report("bulk", now_us() - starttime, plaintext);
+
+    delete[] segment;
+    delete[] out;
+    return 0;
+}
@@ -2255,6 +2255,7 @@ srs_error_t SrsConfig::check_normal_config()
         std::string n = conf->name;
         if (n != "listen" && n != "pid" && n != "chunk_size" && n != "ff_log_dir"
             && n != "srs_log_tank" && n != "srs_log_level" && n != "srs_log_level_v2" && n != "srs_log_file"
+            && n != "srs_log_async"
             && n != "max_connections" && n != "daemon" && n != "heartbeat" && n != "tencentcloud_apm"
             && n != "http_api" && n != "stats" && n != "vhost" && n != "pithy_print_ms"
             && n != "http_server" && n != "stream_caster" && n != "rtc_server" && n != "srt_server"
@@ -2264,7 +2265,7 @@ srs_error_t SrsConfig::check_normal_config()
             && n != "inotify_auto_reload" && n != "auto_reload_for_docker" && n != "tcmalloc_release_rate"
             && n != "query_latest_version" && n != "first_wait_for_qlv" && n != "threads"
             && n != "circuit_breaker" && n != "is_full" && n != "in_docker" && n != "tencentcloud_cls"
-            && n != "exporter"
+            && n != "exporter" && n != "accept"
             ) {
             return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal directive %s", n.c_str());
         }
@@ -2274,7 +2275,8 @@ srs_error_t SrsConfig::check_normal_config()
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             SrsConfDirective* obj = conf->at(i);
             string n = obj->name;
-            if (n != "enabled" && n != "listen" && n != "crossdomain" && n != "raw_api" && n != "https") {
+            if (n != "enabled" && n != "listen" && n != "crossdomain" && n != "raw_api" && n != "https"
+                && n != "profiler") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_api.%s", n.c_str());
             }
             
@@ -2286,15 +2288,45 @@ srs_error_t SrsConfig::check_normal_config()
                     }
                 }
             }
+
+            if (n == "profiler") {
+                for (int j = 0; j < (int)obj->directives.size(); j++) {
+                    string m = obj->at(j)->name;
+                    if (m != "enabled") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_api.profiler.%s", m.c_str());
+                    }
+                }
+            }
         }
     }
     if (true) {
         SrsConfDirective* conf = root->get("http_server");
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             string n = conf->at(i)->name;
-            if (n != "enabled" && n != "listen" && n != "dir" && n != "crossdomain" && n != "https") {
+            if (n != "enabled" && n != "listen" && n != "dir" && n != "crossdomain" && n != "https"
+                && n != "sendfile" && n != "file_cache" && n != "mp4_index") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_stream.%s", n.c_str());
             }
+
+            if (n == "file_cache") {
+                SrsConfDirective* fc = conf->at(i);
+                for (int j = 0; j < (int)fc->directives.size(); j++) {
+                    string m = fc->at(j)->name;
+                    if (m != "enabled" && m != "max_size" && m != "max_file_size") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_stream.file_cache.%s", m.c_str());
+                    }
+                }
+            }
+
+            if (n == "mp4_index") {
+                SrsConfDirective* mi = conf->at(i);
+                for (int j = 0; j < (int)mi->directives.size(); j++) {
+                    string m = mi->at(j)->name;
+                    if (m != "enabled" && m != "max_files") {
+                        return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal http_stream.mp4_index.%s", m.c_str());
+                    }
+                }
+            }
         }
     }
     if (true) {
@@ -2325,7 +2357,7 @@ srs_error_t SrsConfig::check_normal_config()
         SrsConfDirective* conf = get_stats();
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             string n = conf->at(i)->name;
-            if (n != "enabled" && n != "network" && n != "disk") {
+            if (n != "enabled" && n != "network" && n != "disk" && n != "latency") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal stats.%s", n.c_str());
             }
         }
@@ -2335,6 +2367,7 @@ srs_error_t SrsConfig::check_normal_config()
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             string n = conf->at(i)->name;
             if (n != "enabled" && n != "listen" && n != "dir" && n != "candidate" && n != "ecdsa" && n != "tcp"
+                && n != "dtls_resumption" && n != "rtcp_batch"
                 && n != "encrypt" && n != "reuseport" && n != "merge_nalus" && n != "black_hole" && n != "protocol"
                 && n != "ip_family" && n != "api_as_candidates" && n != "resolve_api_domain"
                 && n != "keep_api_domain" && n != "use_auto_detect_network_ip") {
@@ -2342,11 +2375,20 @@ srs_error_t SrsConfig::check_normal_config()
             }
         }
     }
+    if (true) {
+        SrsConfDirective* conf = root->get("accept");
+        for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
+            string n = conf->at(i)->name;
+            if (n != "reuseport" && n != "batch" && n != "rate") {
+                return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal accept.%s", n.c_str());
+            }
+        }
+    }
     if (true) {
         SrsConfDirective* conf = root->get("exporter");
         for (int i = 0; conf && i < (int)conf->directives.size(); i++) {
             string n = conf->at(i)->name;
-            if (n != "enabled" && n != "listen" && n != "label" && n != "tag") {
+            if (n != "enabled" && n != "listen" && n != "label" && n != "tag" && n != "max_streams") {
                 return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal exporter.%s", n.c_str());
             }
         }
@@ -2510,7 +2552,8 @@ srs_error_t SrsConfig::check_normal_config()
                 for (int j = 0; j < (int)conf->directives.size(); j++) {
                     string m = conf->at(j)->name;
                     if (m != "enabled"  && m != "dvr_apply" && m != "dvr_path" && m != "dvr_plan"
-                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter") {
+                        && m != "dvr_duration" && m != "dvr_wait_keyframe" && m != "time_jitter"
+                        && m != "dvr_fmp4" && m != "dvr_fmp4_fragment" && m != "dvr_fmp4_faststart") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.dvr.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2650,7 +2693,8 @@ srs_error_t SrsConfig::check_normal_config()
                     if (m != "enabled" && m != "nack" && m != "twcc" && m != "nack_no_copy"
                         && m != "bframe" && m != "aac" && m != "stun_timeout" && m != "stun_strict_check"
                         && m != "dtls_role" && m != "dtls_version" && m != "drop_for_pt" && m != "rtc_to_rtmp"
-                        && m != "pli_for_rtmp" && m != "rtmp_to_rtc" && m != "keep_bframe") {
+                        && m != "pli_for_rtmp" && m != "rtmp_to_rtc" && m != "keep_bframe" && m != "bridge_lazy"
+                        && m != "bridge_grace" && m != "bwe" && m != "pacing_factor" && m != "pacing_max_delay") {
                         return srs_error_new(ERROR_SYSTEM_CONFIG_INVALID, "illegal vhost.rtc.%s of %s", m.c_str(), vhost->arg0().c_str());
                     }
                 }
@@ -2901,6 +2945,77 @@ int SrsConfig::get_max_connections()
     return ::atoi(conf->arg0().c_str());
 }
 
+int SrsConfig::get_accept_reuseport()
+{
+    int v = get_accept_reuseport2();
+
+#if !defined(SO_REUSEPORT)
+    if (v > 1) {
+        srs_warn("REUSEPORT not supported, reset to 1");
+        v = 1;
+    }
+#endif
+
+    return v;
+}
+
+int SrsConfig::get_accept_reuseport2()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.accept.reuseport"); // SRS_ACCEPT_REUSEPORT
+
+    static int DEFAULT = 1;
+
+    SrsConfDirective* conf = root->get("accept");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("reuseport");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_accept_batch()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.accept.batch"); // SRS_ACCEPT_BATCH
+
+    static int DEFAULT = 32;
+
+    SrsConfDirective* conf = root->get("accept");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("batch");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_accept_rate()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.accept.rate"); // SRS_ACCEPT_RATE
+
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("accept");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("rate");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
 vector<string> SrsConfig::get_listens()
 {
     std::vector<string> ports;
@@ -3165,6 +3280,154 @@ srs_utime_t SrsConfig::get_threads_interval()
     return v * SRS_UTIME_SECONDS;
 }
 
+int SrsConfig::get_threads_hls_workers()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.hls_workers"); // SRS_THREADS_HLS_WORKERS
+
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("hls_workers");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_threads_hls_queue()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.hls_queue"); // SRS_THREADS_HLS_QUEUE
+
+    static int DEFAULT = 8192;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("hls_queue");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    int v = ::atoi(conf->arg0().c_str());
+    if (v <= 0) {
+        return DEFAULT;
+    }
+
+    return v;
+}
+
+int SrsConfig::get_threads_audio_workers()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.audio_workers"); // SRS_THREADS_AUDIO_WORKERS
+
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("audio_workers");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_threads_audio_queue()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.audio_queue"); // SRS_THREADS_AUDIO_QUEUE
+
+    static int DEFAULT = 1024;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("audio_queue");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    int v = ::atoi(conf->arg0().c_str());
+    if (v <= 0) {
+        return DEFAULT;
+    }
+
+    return v;
+}
+
+int SrsConfig::get_threads_dtls_workers()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.dtls_workers"); // SRS_THREADS_DTLS_WORKERS
+
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dtls_workers");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+int SrsConfig::get_threads_dtls_queue()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.threads.dtls_queue"); // SRS_THREADS_DTLS_QUEUE
+
+    static int DEFAULT = 1024;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dtls_queue");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    int v = ::atoi(conf->arg0().c_str());
+    if (v <= 0) {
+        return DEFAULT;
+    }
+
+    return v;
+}
+
+bool SrsConfig::get_threads_sched_stat()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.threads.sched_stat"); // SRS_THREADS_SCHED_STAT
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("threads");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("sched_stat");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 bool SrsConfig::get_circuit_breaker()
 {
     SRS_OVERWRITE_BY_ENV_BOOL2("srs.circuit_breaker.enabled"); // SRS_CIRCUIT_BREAKER_ENABLED
@@ -3716,6 +3979,25 @@ string SrsConfig::get_exporter_tag()
     return conf->arg0();
 }
 
+int SrsConfig::get_exporter_max_streams()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.exporter.max_streams"); // SRS_EXPORTER_MAX_STREAMS
+
+    static int DEFAULT = 100;
+
+    SrsConfDirective* conf = root->get("exporter");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("max_streams");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
 vector<SrsConfDirective*> SrsConfig::get_stream_casters()
 {
     srs_assert(root);
@@ -4167,6 +4449,44 @@ bool SrsConfig::get_rtc_server_ecdsa()
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_rtc_server_dtls_resumption()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL2("srs.rtc_server.dtls_resumption"); // SRS_RTC_SERVER_DTLS_RESUMPTION
+
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dtls_resumption");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+int SrsConfig::get_rtc_server_rtcp_batch()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.rtc_server.rtcp_batch"); // SRS_RTC_SERVER_RTCP_BATCH
+
+    static int DEFAULT = 64;
+
+    SrsConfDirective* conf = root->get("rtc_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("rtcp_batch");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
 bool SrsConfig::get_rtc_server_encrypt()
 {
     SRS_OVERWRITE_BY_ENV_BOOL2("srs.rtc_server.encrypt"); // SRS_RTC_SERVER_ENCRYPT
@@ -4394,109 +4714,205 @@ bool SrsConfig::get_rtc_stun_strict_check(string vhost)
 
 std::string SrsConfig::get_rtc_dtls_role(string vhost)
 {
-    SRS_OVERWRITE_BY_ENV_STRING("srs.vhost.rtc.dtls_role"); // SRS_VHOST_RTC_DTLS_ROLE
+    SRS_OVERWRITE_BY_ENV_STRING("srs.vhost.rtc.dtls_role"); // SRS_VHOST_RTC_DTLS_ROLE
+
+    static std::string DEFAULT = "passive";
+
+    SrsConfDirective* conf = get_rtc(vhost);
+
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dtls_role");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0();
+}
+
+std::string SrsConfig::get_rtc_dtls_version(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_STRING("srs.vhost.rtc.dtls_version"); // SRS_VHOST_RTC_DTLS_VERSION
+
+    static std::string DEFAULT = "auto";
+
+    SrsConfDirective* conf = get_rtc(vhost);
+
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dtls_version");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return conf->arg0();
+}
+
+int SrsConfig::get_rtc_drop_for_pt(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.vhost.rtc.drop_for_pt"); // SRS_VHOST_RTC_DROP_FOR_PT
+
+    static int DEFAULT = 0;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("drop_for_pt");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
+bool SrsConfig::get_rtc_to_rtmp(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.rtc.rtc_to_rtmp"); // SRS_VHOST_RTC_RTC_TO_RTMP
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("rtc_to_rtmp");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_rtc_pli_for_rtmp(string vhost)
+{
+    static srs_utime_t DEFAULT = 6 * SRS_UTIME_SECONDS;
+    srs_utime_t v = 0;
+
+    if (!srs_getenv("srs.vhost.rtc.pli_for_rtmp").empty()) { // SRS_VHOST_RTC_PLI_FOR_RTMP
+        v = (srs_utime_t)(::atof(srs_getenv("srs.vhost.rtc.pli_for_rtmp").c_str()) * SRS_UTIME_SECONDS);
+    } else {
+        SrsConfDirective* conf = get_rtc(vhost);
+        if (!conf) {
+            return DEFAULT;
+        }
+
+        conf = conf->get("pli_for_rtmp");
+        if (!conf || conf->arg0().empty()) {
+            return DEFAULT;
+        }
+
+        v = (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    }
+
+    if (v < 500 * SRS_UTIME_MILLISECONDS || v > 30 * SRS_UTIME_SECONDS) {
+        srs_warn("Reset pli %dms to %dms", srsu2msi(v), srsu2msi(DEFAULT));
+        return DEFAULT;
+    }
+
+    return v;
+}
+
+bool SrsConfig::get_rtc_bridge_lazy(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.rtc.bridge_lazy"); // SRS_VHOST_RTC_BRIDGE_LAZY
 
-    static std::string DEFAULT = "passive";
+    static bool DEFAULT = false;
 
     SrsConfDirective* conf = get_rtc(vhost);
-
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("dtls_role");
+    conf = conf->get("bridge_lazy");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
 
-    return conf->arg0();
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-std::string SrsConfig::get_rtc_dtls_version(string vhost)
+srs_utime_t SrsConfig::get_rtc_bridge_grace(string vhost)
 {
-    SRS_OVERWRITE_BY_ENV_STRING("srs.vhost.rtc.dtls_version"); // SRS_VHOST_RTC_DTLS_VERSION
+    SRS_OVERWRITE_BY_ENV_FLOAT_SECONDS("srs.vhost.rtc.bridge_grace"); // SRS_VHOST_RTC_BRIDGE_GRACE
 
-    static std::string DEFAULT = "auto";
+    static srs_utime_t DEFAULT = 10 * SRS_UTIME_SECONDS;
 
     SrsConfDirective* conf = get_rtc(vhost);
-
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("dtls_version");
+    conf = conf->get("bridge_grace");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
 
-    return conf->arg0();
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
 }
 
-int SrsConfig::get_rtc_drop_for_pt(string vhost)
+bool SrsConfig::get_rtc_bwe_enabled(string vhost)
 {
-    SRS_OVERWRITE_BY_ENV_INT("srs.vhost.rtc.drop_for_pt"); // SRS_VHOST_RTC_DROP_FOR_PT
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.rtc.bwe"); // SRS_VHOST_RTC_BWE
 
-    static int DEFAULT = 0;
+    static bool DEFAULT = false;
 
     SrsConfDirective* conf = get_rtc(vhost);
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("drop_for_pt");
-    if (!conf || conf->arg0().empty()) {
+    conf = conf->get("bwe");
+    if (!conf) {
         return DEFAULT;
     }
 
-    return ::atoi(conf->arg0().c_str());
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
 }
 
-bool SrsConfig::get_rtc_to_rtmp(string vhost)
+double SrsConfig::get_rtc_pacing_factor(string vhost)
 {
-    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.rtc.rtc_to_rtmp"); // SRS_VHOST_RTC_RTC_TO_RTMP
+    SRS_OVERWRITE_BY_ENV_FLOAT("srs.vhost.rtc.pacing_factor"); // SRS_VHOST_RTC_PACING_FACTOR
 
-    static bool DEFAULT = false;
+    static double DEFAULT = 2.5;
 
     SrsConfDirective* conf = get_rtc(vhost);
     if (!conf) {
         return DEFAULT;
     }
 
-    conf = conf->get("rtc_to_rtmp");
+    conf = conf->get("pacing_factor");
     if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
 
-    return SRS_CONF_PERFER_FALSE(conf->arg0());
+    double v = ::atof(conf->arg0().c_str());
+    return v > 0 ? v : DEFAULT;
 }
 
-srs_utime_t SrsConfig::get_rtc_pli_for_rtmp(string vhost)
+srs_utime_t SrsConfig::get_rtc_pacing_max_delay(string vhost)
 {
-    static srs_utime_t DEFAULT = 6 * SRS_UTIME_SECONDS;
-    srs_utime_t v = 0;
+    SRS_OVERWRITE_BY_ENV_MILLISECONDS("srs.vhost.rtc.pacing_max_delay"); // SRS_VHOST_RTC_PACING_MAX_DELAY
 
-    if (!srs_getenv("srs.vhost.rtc.pli_for_rtmp").empty()) { // SRS_VHOST_RTC_PLI_FOR_RTMP
-        v = (srs_utime_t)(::atof(srs_getenv("srs.vhost.rtc.pli_for_rtmp").c_str()) * SRS_UTIME_SECONDS);
-    } else {
-        SrsConfDirective* conf = get_rtc(vhost);
-        if (!conf) {
-            return DEFAULT;
-        }
-
-        conf = conf->get("pli_for_rtmp");
-        if (!conf || conf->arg0().empty()) {
-            return DEFAULT;
-        }
+    static srs_utime_t DEFAULT = 200 * SRS_UTIME_MILLISECONDS;
 
-        v = (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+    SrsConfDirective* conf = get_rtc(vhost);
+    if (!conf) {
+        return DEFAULT;
     }
 
-    if (v < 500 * SRS_UTIME_MILLISECONDS || v > 30 * SRS_UTIME_SECONDS) {
-        srs_warn("Reset pli %dms to %dms", srsu2msi(v), srsu2msi(DEFAULT));
+    conf = conf->get("pacing_max_delay");
+    if (!conf || conf->arg0().empty()) {
         return DEFAULT;
     }
 
-    return v;
+    return (srs_utime_t)(::atoi(conf->arg0().c_str()) * SRS_UTIME_MILLISECONDS);
 }
 
 bool SrsConfig::get_rtc_nack_enabled(string vhost)
@@ -6368,6 +6784,20 @@ string SrsConfig::get_log_file()
     return conf->arg0();
 }
 
+bool SrsConfig::get_log_async()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.srs_log_async"); // SRS_SRS_LOG_ASYNC
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("srs_log_async");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 bool SrsConfig::get_ff_log_enabled()
 {
     string log = get_ff_log_dir();
@@ -7349,6 +7779,63 @@ int SrsConfig::get_dvr_time_jitter(string vhost)
     return srs_time_jitter_string2int(conf->arg0());
 }
 
+bool SrsConfig::get_dvr_fmp4(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.dvr.dvr_fmp4"); // SRS_VHOST_DVR_DVR_FMP4
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dvr_fmp4");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+srs_utime_t SrsConfig::get_dvr_fmp4_fragment(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_FLOAT_SECONDS("srs.vhost.dvr.dvr_fmp4_fragment"); // SRS_VHOST_DVR_DVR_FMP4_FRAGMENT
+
+    static srs_utime_t DEFAULT = 2 * SRS_UTIME_SECONDS;
+
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dvr_fmp4_fragment");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return (srs_utime_t)(::atof(conf->arg0().c_str()) * SRS_UTIME_SECONDS);
+}
+
+bool SrsConfig::get_dvr_fmp4_faststart(string vhost)
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.vhost.dvr.dvr_fmp4_faststart"); // SRS_VHOST_DVR_DVR_FMP4_FASTSTART
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_dvr(vhost);
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("dvr_fmp4_faststart");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 bool SrsConfig::get_http_api_enabled()
 {
     SrsConfDirective* conf = root->get("http_api");
@@ -7472,6 +7959,30 @@ bool SrsConfig::get_raw_api_allow_update()
     return false;
 }
 
+bool SrsConfig::get_profiler_enabled()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.http_api.profiler.enabled"); // SRS_HTTP_API_PROFILER_ENABLED
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = root->get("http_api");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("profiler");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 SrsConfDirective* SrsConfig::get_https_api()
 {
     SrsConfDirective* conf = root->get("http_api");
@@ -7997,6 +8508,144 @@ bool SrsConfig::get_http_stream_crossdomain()
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_http_stream_sendfile()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL2("srs.http_server.sendfile"); // SRS_HTTP_SERVER_SENDFILE
+
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("sendfile");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+SrsConfDirective* SrsConfig::get_http_stream_file_cache()
+{
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return NULL;
+    }
+
+    return conf->get("file_cache");
+}
+
+bool SrsConfig::get_http_stream_file_cache_enabled()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.http_server.file_cache.enabled"); // SRS_HTTP_SERVER_FILE_CACHE_ENABLED
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_http_stream_file_cache();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
+int64_t SrsConfig::get_http_stream_file_cache_max_size()
+{
+    if (!srs_getenv("srs.http_server.file_cache.max_size").empty()) { // SRS_HTTP_SERVER_FILE_CACHE_MAX_SIZE
+        return ::atoll(srs_getenv("srs.http_server.file_cache.max_size").c_str()) * 1024;
+    }
+
+    static int64_t DEFAULT = 64 * 1024 * 1024;
+
+    SrsConfDirective* conf = get_http_stream_file_cache();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("max_size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoll(conf->arg0().c_str()) * 1024;
+}
+
+int64_t SrsConfig::get_http_stream_file_cache_max_file_size()
+{
+    if (!srs_getenv("srs.http_server.file_cache.max_file_size").empty()) { // SRS_HTTP_SERVER_FILE_CACHE_MAX_FILE_SIZE
+        return ::atoll(srs_getenv("srs.http_server.file_cache.max_file_size").c_str()) * 1024;
+    }
+
+    static int64_t DEFAULT = 1024 * 1024;
+
+    SrsConfDirective* conf = get_http_stream_file_cache();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("max_file_size");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoll(conf->arg0().c_str()) * 1024;
+}
+
+SrsConfDirective* SrsConfig::get_http_stream_mp4_index()
+{
+    SrsConfDirective* conf = root->get("http_server");
+    if (!conf) {
+        return NULL;
+    }
+
+    return conf->get("mp4_index");
+}
+
+bool SrsConfig::get_http_stream_mp4_index_enabled()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL2("srs.http_server.mp4_index.enabled"); // SRS_HTTP_SERVER_MP4_INDEX_ENABLED
+
+    static bool DEFAULT = true;
+
+    SrsConfDirective* conf = get_http_stream_mp4_index();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("enabled");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_TRUE(conf->arg0());
+}
+
+int SrsConfig::get_http_stream_mp4_index_max_files()
+{
+    SRS_OVERWRITE_BY_ENV_INT("srs.http_server.mp4_index.max_files"); // SRS_HTTP_SERVER_MP4_INDEX_MAX_FILES
+
+    static int DEFAULT = 64;
+
+    SrsConfDirective* conf = get_http_stream_mp4_index();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("max_files");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return ::atoi(conf->arg0().c_str());
+}
+
 SrsConfDirective* SrsConfig::get_https_stream()
 {
     SrsConfDirective* conf = root->get("http_server");
@@ -8454,6 +9103,25 @@ bool SrsConfig::get_stats_enabled()
     return SRS_CONF_PERFER_TRUE(conf->arg0());
 }
 
+bool SrsConfig::get_stats_latency()
+{
+    SRS_OVERWRITE_BY_ENV_BOOL("srs.stats.latency"); // SRS_STATS_LATENCY
+
+    static bool DEFAULT = false;
+
+    SrsConfDirective* conf = get_stats();
+    if (!conf) {
+        return DEFAULT;
+    }
+
+    conf = conf->get("latency");
+    if (!conf || conf->arg0().empty()) {
+        return DEFAULT;
+    }
+
+    return SRS_CONF_PERFER_FALSE(conf->arg0());
+}
+
 int SrsConfig::get_stats_network()
 {
     static int DEFAULT = 0;
@@ -399,6 +399,15 @@ public:
     //       user must use "ulimit -HSn 10000" and config the max connections
     //       of SRS.
     virtual int get_max_connections();
+    // Get the number of TCP listeners for each endpoint of RTMP and HTTP server, by SO_REUSEPORT.
+    virtual int get_accept_reuseport();
+private:
+    virtual int get_accept_reuseport2();
+public:
+    // Get the max number of connections to accept for each wakeup.
+    virtual int get_accept_batch();
+    // Get the max number of new connections per second for each listener, 0 to disable.
+    virtual int get_accept_rate();
     // Get the listen port of SRS.
     // user can specifies multiple listen ports,
     // each args of directive is a listen port.
@@ -443,6 +452,20 @@ public:
 // Thread pool section.
 public:
     virtual srs_utime_t get_threads_interval();
+    // The number of HLS mux workers, 0 to mux HLS in ST thread.
+    virtual int get_threads_hls_workers();
+    // The capacity of queue for each HLS mux worker.
+    virtual int get_threads_hls_queue();
+    // The number of audio transcode workers, 0 to transcode audio in ST thread.
+    virtual int get_threads_audio_workers();
+    // The capacity of queue for each audio transcode worker.
+    virtual int get_threads_audio_queue();
+    // The number of DTLS handshake workers, 0 to handshake in ST thread.
+    virtual int get_threads_dtls_workers();
+    // The capacity of queue for each DTLS handshake worker.
+    virtual int get_threads_dtls_queue();
+    // Whether stat the scheduler of ST, the run-queue depth and slices of coroutines.
+    virtual bool get_threads_sched_stat();
     virtual bool get_circuit_breaker();
     virtual int get_high_threshold();
     virtual int get_high_pulse();
@@ -507,6 +530,10 @@ public:
     virtual std::string get_rtc_server_protocol();
     virtual std::string get_rtc_server_ip_family();
     virtual bool get_rtc_server_ecdsa();
+    // Whether enable DTLS session resumption, by session cache and tickets.
+    virtual bool get_rtc_server_dtls_resumption();
+    // The max number of RTCP packets to send in a batch, 0 to disable.
+    virtual int get_rtc_server_rtcp_batch();
     virtual bool get_rtc_server_encrypt();
     virtual int get_rtc_server_reuseport();
     virtual bool get_rtc_server_merge_nalus();
@@ -528,6 +555,16 @@ public:
     int get_rtc_drop_for_pt(std::string vhost);
     bool get_rtc_to_rtmp(std::string vhost);
     srs_utime_t get_rtc_pli_for_rtmp(std::string vhost);
+    // Whether the bridge only works when there are consumers of target source.
+    bool get_rtc_bridge_lazy(std::string vhost);
+    // The grace period to suspend the lazy bridge after the last consumer leaves.
+    srs_utime_t get_rtc_bridge_grace(std::string vhost);
+    // Whether enable the sender-side bandwidth estimation and pacing for players.
+    bool get_rtc_bwe_enabled(std::string vhost);
+    // The pacing rate factor of the estimated bandwidth.
+    double get_rtc_pacing_factor(std::string vhost);
+    // The max delay of packets queued by pacer.
+    srs_utime_t get_rtc_pacing_max_delay(std::string vhost);
     bool get_rtc_nack_enabled(std::string vhost);
     bool get_rtc_nack_no_copy(std::string vhost);
     bool get_rtc_twcc_enabled(std::string vhost);
@@ -872,6 +909,8 @@ public:
     virtual std::string get_log_level_v2();
     // Get the log file path.
     virtual std::string get_log_file();
+    // Whether write log by the flusher thread, to never block the server.
+    virtual bool get_log_async();
     // Whether ffmpeg log enabled
     virtual bool get_ff_log_enabled();
     // The ffmpeg log dir.
@@ -999,6 +1038,12 @@ public:
     virtual bool get_dvr_wait_keyframe(std::string vhost);
     // Get the time_jitter algorithm for dvr.
     virtual int get_dvr_time_jitter(std::string vhost);
+    // Whether DVR to fragmented MP4, which flush moof and mdat for each fragment.
+    virtual bool get_dvr_fmp4(std::string vhost);
+    // Get the duration of fragment for fMP4 DVR.
+    virtual srs_utime_t get_dvr_fmp4_fragment(std::string vhost);
+    // Whether defragment the fMP4 to a faststart MP4 when DVR file is closed.
+    virtual bool get_dvr_fmp4_faststart(std::string vhost);
 // http api section
 private:
     // Whether http api enabled
@@ -1018,6 +1063,8 @@ public:
     virtual bool get_raw_api_allow_query();
     // Whether allow rpc update.
     virtual bool get_raw_api_allow_update();
+    // Whether enable the CPU profiler API.
+    virtual bool get_profiler_enabled();
 // https api section
 private:
     SrsConfDirective* get_https_api();
@@ -1040,6 +1087,24 @@ public:
     virtual std::string get_http_stream_dir();
     // Whether enable crossdomain for http static and stream server.
     virtual bool get_http_stream_crossdomain();
+    // Whether send static file by sendfile for plaintext HTTP.
+    virtual bool get_http_stream_sendfile();
+private:
+    SrsConfDirective* get_http_stream_file_cache();
+public:
+    // Whether enable the LRU cache for hot small static files.
+    virtual bool get_http_stream_file_cache_enabled();
+    // Get the max bytes of all cached files.
+    virtual int64_t get_http_stream_file_cache_max_size();
+    // Get the max bytes of a file to cache.
+    virtual int64_t get_http_stream_file_cache_max_file_size();
+private:
+    SrsConfDirective* get_http_stream_mp4_index();
+public:
+    // Whether enable the cache for index of MP4 VOD files.
+    virtual bool get_http_stream_mp4_index_enabled();
+    // Get the max number of cached MP4 indexes.
+    virtual int get_http_stream_mp4_index_max_files();
 // https api section
 private:
     SrsConfDirective* get_https_stream();
@@ -1097,6 +1162,8 @@ private:
 public:
     // Whether enabled stats.
     virtual bool get_stats_enabled();
+    // Whether enabled the latency histograms of stages in hot path.
+    virtual bool get_stats_latency();
     // Get the network device index, used to retrieve the ip of device,
     // For heartbeat to report to server, or to get the local ip.
     // For example, 0 means the eth0 maybe.
@@ -1111,6 +1178,8 @@ public:
     virtual std::string get_exporter_listen();
     virtual std::string get_exporter_label();
     virtual std::string get_exporter_tag();
+    // Get the max number of streams to export metrics, the top streams by kbps, 0 to disable.
+    virtual int get_exporter_max_streams();
 };
 
 #endif
@@ -7,6 +7,10 @@
 #include <srs_app_conn.hpp>
 
 #include <netinet/tcp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <stdlib.h>
+#include <string.h>
 #include <algorithm>
 using namespace std;
 
@@ -34,17 +38,246 @@ ISrsDisposingHandler::~ISrsDisposingHandler()
 {
 }
 
+SrsSockaddrKey::SrsSockaddrKey()
+{
+    memset(this, 0, sizeof(SrsSockaddrKey));
+}
+
+bool SrsSockaddrKey::parse(const sockaddr* addr)
+{
+    memset(this, 0, sizeof(SrsSockaddrKey));
+
+    if (addr->sa_family == AF_INET) {
+        const sockaddr_in* addr4 = (const sockaddr_in*)addr;
+        family = AF_INET;
+        port = addr4->sin_port;
+        memcpy(ip, &addr4->sin_addr, 4);
+        return true;
+    }
+
+    if (addr->sa_family == AF_INET6) {
+        const sockaddr_in6* addr6 = (const sockaddr_in6*)addr;
+        family = AF_INET6;
+        port = addr6->sin6_port;
+        memcpy(ip, &addr6->sin6_addr, 16);
+        return true;
+    }
+
+    return false;
+}
+
+uint64_t SrsSockaddrKey::hash() const
+{
+    uint64_t a, b;
+    uint32_t c;
+    memcpy(&a, ip, 8);
+    memcpy(&b, ip + 8, 8);
+    memcpy(&c, this, 4);
+
+    // Mix the words, then use the finalizer of MurmurHash3.
+    uint64_t h = a ^ (b * 0x9e3779b97f4a7c15ULL) ^ ((uint64_t)c << 17);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+bool SrsSockaddrKey::equals(const SrsSockaddrKey& o) const
+{
+    return memcmp(this, &o, sizeof(SrsSockaddrKey)) == 0;
+}
+
+// The state of slot in address table.
+#define SRS_ADDR_SLOT_EMPTY 0
+#define SRS_ADDR_SLOT_USED 1
+#define SRS_ADDR_SLOT_DELETED 2
+
+SrsResourceAddrTable::SrsResourceAddrTable()
+{
+    buckets_ = NULL;
+    nn_buckets_ = 0;
+    nn_used_ = nn_deleted_ = 0;
+
+    rehash(64);
+}
+
+SrsResourceAddrTable::~SrsResourceAddrTable()
+{
+    free(buckets_);
+}
+
+void SrsResourceAddrTable::set(const SrsSockaddrKey& key, ISrsResource* conn)
+{
+    SrsResourceAddrSlot* slot = lookup(key);
+
+    // Update the existed address, which might be reused by another resource.
+    if (slot) {
+        if (slot->impl != conn) {
+            std::vector<SrsSockaddrKey>& keys = keys_[slot->impl];
+            for (std::vector<SrsSockaddrKey>::iterator it = keys.begin(); it != keys.end(); ++it) {
+                if (it->equals(key)) {
+                    keys.erase(it);
+                    break;
+                }
+            }
+            if (keys.empty()) {
+                keys_.erase(slot->impl);
+            }
+
+            slot->impl = conn;
+            keys_[conn].push_back(key);
+        }
+        return;
+    }
+
+    // Keep load factor under 3/4, including the deleted slots.
+    uint32_t nn_slots = nn_buckets_ * 2;
+    if ((nn_used_ + nn_deleted_ + 1) * 4 > nn_slots * 3) {
+        // Grow if too many used slots, or cleanup the deleted slots.
+        rehash((nn_used_ + 1) * 2 > nn_slots? nn_buckets_ * 2 : nn_buckets_);
+    }
+
+    uint32_t mask = nn_buckets_ - 1;
+    for (uint32_t i = (uint32_t)key.hash() & mask;; i = (i + 1) & mask) {
+        SrsResourceAddrBucket* bucket = &buckets_[i];
+        for (int j = 0; j < 2; j++) {
+            SrsResourceAddrSlot* p = &bucket->slots[j];
+            if (p->state == SRS_ADDR_SLOT_USED) {
+                continue;
+            }
+
+            if (p->state == SRS_ADDR_SLOT_DELETED) {
+                nn_deleted_--;
+            }
+
+            p->key = key;
+            p->impl = conn;
+            p->state = SRS_ADDR_SLOT_USED;
+            nn_used_++;
+
+            keys_[conn].push_back(key);
+            return;
+        }
+    }
+}
+
+ISrsResource* SrsResourceAddrTable::find(const SrsSockaddrKey& key)
+{
+    SrsResourceAddrSlot* slot = lookup(key);
+    return slot? slot->impl : NULL;
+}
+
+void SrsResourceAddrTable::erase(ISrsResource* conn)
+{
+    std::map<ISrsResource*, std::vector<SrsSockaddrKey> >::iterator it = keys_.find(conn);
+    if (it == keys_.end()) {
+        return;
+    }
+
+    std::vector<SrsSockaddrKey>& keys = it->second;
+    for (int i = 0; i < (int)keys.size(); i++) {
+        SrsResourceAddrSlot* slot = lookup(keys.at(i));
+        if (slot && slot->impl == conn) {
+            slot->state = SRS_ADDR_SLOT_DELETED;
+            slot->impl = NULL;
+            nn_used_--;
+            nn_deleted_++;
+        }
+    }
+
+    keys_.erase(it);
+}
+
+uint32_t SrsResourceAddrTable::size()
+{
+    return nn_used_;
+}
+
+uint32_t SrsResourceAddrTable::capacity()
+{
+    return nn_buckets_ * 2;
+}
+
+SrsResourceAddrSlot* SrsResourceAddrTable::lookup(const SrsSockaddrKey& key)
+{
+    uint32_t mask = nn_buckets_ - 1;
+    uint32_t i = (uint32_t)key.hash() & mask;
+
+    for (uint32_t n = 0; n < nn_buckets_; n++, i = (i + 1) & mask) {
+        SrsResourceAddrBucket* bucket = &buckets_[i];
+        for (int j = 0; j < 2; j++) {
+            SrsResourceAddrSlot* slot = &bucket->slots[j];
+            if (slot->state == SRS_ADDR_SLOT_EMPTY) {
+                return NULL;
+            }
+            if (slot->state == SRS_ADDR_SLOT_USED && slot->key.equals(key)) {
+                return slot;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void SrsResourceAddrTable::rehash(uint32_t nn_buckets)
+{
+    SrsResourceAddrBucket* buckets = buckets_;
+    uint32_t nn_old = nn_buckets_;
+
+    // Align the buckets to cache line.
+    void* p = NULL;
+    if (posix_memalign(&p, 64, nn_buckets * sizeof(SrsResourceAddrBucket)) != 0) {
+        srs_assert(false);
+    }
+    memset(p, 0, nn_buckets * sizeof(SrsResourceAddrBucket));
+
+    buckets_ = (SrsResourceAddrBucket*)p;
+    nn_buckets_ = nn_buckets;
+    nn_used_ = nn_deleted_ = 0;
+
+    // Move the used slots to new buckets, the keys of resource are not changed.
+    uint32_t mask = nn_buckets_ - 1;
+    for (uint32_t i = 0; i < nn_old; i++) {
+        for (int j = 0; j < 2; j++) {
+            SrsResourceAddrSlot* from = &buckets[i].slots[j];
+            if (from->state != SRS_ADDR_SLOT_USED) {
+                continue;
+            }
+
+            for (uint32_t k = (uint32_t)from->key.hash() & mask;; k = (k + 1) & mask) {
+                SrsResourceAddrBucket* bucket = &buckets_[k];
+                SrsResourceAddrSlot* to = bucket->slots[0].state == SRS_ADDR_SLOT_EMPTY? &bucket->slots[0] : &bucket->slots[1];
+                if (to->state == SRS_ADDR_SLOT_EMPTY) {
+                    *to = *from;
+                    nn_used_++;
+                    break;
+                }
+            }
+        }
+    }
+
+    free(buckets);
+}
+
 SrsResourceManager::SrsResourceManager(const std::string& label, bool verbose)
 {
     verbose_ = verbose;
     label_ = label;
     cond = srs_cond_new();
     trd = NULL;
-    p_disposing_ = NULL;
     removing_ = false;
 
+    conns_.prev = conns_.next = &conns_;
+    nn_conns_ = 0;
+    cursor_index_ = -1;
+    cursor_ = NULL;
+
     nn_level0_cache_ = 100000;
     conns_level0_cache_ = new SrsResourceFastIdItem[nn_level0_cache_];
+
+    conns_addr_ = new SrsResourceAddrTable();
 }
 
 SrsResourceManager::~SrsResourceManager()
@@ -60,13 +293,14 @@ SrsResourceManager::~SrsResourceManager()
     clear();
 
     // Free all objects not in zombies.
-    std::vector<ISrsResource*>::iterator it;
-    for (it = conns_.begin(); it != conns_.end(); ++it) {
-        ISrsResource* resource = *it;
+    while (conns_.next != &conns_) {
+        ISrsResource* resource = conns_.next->resource;
+        unlink(resource);
         srs_freep(resource);
     }
 
     srs_freepa(conns_level0_cache_);
+    srs_freep(conns_addr_);
 }
 
 srs_error_t SrsResourceManager::start()
@@ -85,19 +319,19 @@ srs_error_t SrsResourceManager::start()
 
 bool SrsResourceManager::empty()
 {
-    return conns_.empty();
+    return !nn_conns_;
 }
 
 size_t SrsResourceManager::size()
 {
-    return conns_.size();
+    return nn_conns_;
 }
 
 srs_error_t SrsResourceManager::cycle()
 {
     srs_error_t err = srs_success;
 
-    srs_trace("%s: connection manager run, conns=%d", label_.c_str(), (int)conns_.size());
+    srs_trace("%s: connection manager run, conns=%d", label_.c_str(), (int)nn_conns_);
 
     while (true) {
         if ((err = trd->pull()) != srs_success) {
@@ -118,8 +352,8 @@ srs_error_t SrsResourceManager::cycle()
 
 void SrsResourceManager::add(ISrsResource* conn, bool* exists)
 {
-    if (std::find(conns_.begin(), conns_.end(), conn) == conns_.end()) {
-        conns_.push_back(conn);
+    if (conn->resource_hook_.manager != this) {
+        link(conn);
     } else {
         if (exists) {
             *exists = true;
@@ -131,6 +365,12 @@ void SrsResourceManager::add_with_id(const std::string& id, ISrsResource* conn)
 {
     add(conn);
     conns_id_[id] = conn;
+
+    // Record the key only once, because the same id may be added again.
+    vector<string>& ids = conn->resource_hook_.ids;
+    if (std::find(ids.begin(), ids.end(), id) == ids.end()) {
+        ids.push_back(id);
+    }
 }
 
 void SrsResourceManager::add_with_fast_id(uint64_t id, ISrsResource* conn)
@@ -139,6 +379,11 @@ void SrsResourceManager::add_with_fast_id(uint64_t id, ISrsResource* conn)
     add(conn, &exists);
     conns_fast_id_[id] = conn;
 
+    vector<uint64_t>& fast_ids = conn->resource_hook_.fast_ids;
+    if (std::find(fast_ids.begin(), fast_ids.end(), id) == fast_ids.end()) {
+        fast_ids.push_back(id);
+    }
+
     if (exists) {
         return;
     }
@@ -170,17 +415,48 @@ void SrsResourceManager::add_with_name(const std::string& name, ISrsResource* co
 {
     add(conn);
     conns_name_[name] = conn;
+
+    vector<string>& names = conn->resource_hook_.names;
+    if (std::find(names.begin(), names.end(), name) == names.end()) {
+        names.push_back(name);
+    }
+}
+
+void SrsResourceManager::add_with_addr(const sockaddr* addr, ISrsResource* conn)
+{
+    SrsSockaddrKey key;
+    if (!key.parse(addr)) {
+        return;
+    }
+
+    add(conn);
+    conns_addr_->set(key, conn);
 }
 
 ISrsResource* SrsResourceManager::at(int index)
 {
-    return (index < (int)conns_.size())? conns_.at(index) : NULL;
+    if (index < 0 || index >= (int)nn_conns_) {
+        return NULL;
+    }
+
+    // Start from the cursor if iterate forward, or from the head of list.
+    if (!cursor_ || index < cursor_index_) {
+        cursor_index_ = 0;
+        cursor_ = conns_.next;
+    }
+
+    while (cursor_index_ < index) {
+        cursor_index_++;
+        cursor_ = cursor_->next;
+    }
+
+    return cursor_->resource;
 }
 
 ISrsResource* SrsResourceManager::find_by_id(std::string id)
 {
     ++_srs_pps_ids->sugar;
-    map<string, ISrsResource*>::iterator it = conns_id_.find(id);
+    unordered_map<string, ISrsResource*>::iterator it = conns_id_.find(id);
     return (it != conns_id_.end())? it->second : NULL;
 }
 
@@ -193,14 +469,26 @@ ISrsResource* SrsResourceManager::find_by_fast_id(uint64_t id)
     }
 
     ++_srs_pps_fids->sugar;
-    map<uint64_t, ISrsResource*>::iterator it = conns_fast_id_.find(id);
+    unordered_map<uint64_t, ISrsResource*>::iterator it = conns_fast_id_.find(id);
     return (it != conns_fast_id_.end())? it->second : NULL;
 }
 
+ISrsResource* SrsResourceManager::find_by_addr(const sockaddr* addr)
+{
+    ++_srs_pps_fids->sugar;
+
+    SrsSockaddrKey key;
+    if (!key.parse(addr)) {
+        return NULL;
+    }
+
+    return conns_addr_->find(key);
+}
+
 ISrsResource* SrsResourceManager::find_by_name(std::string name)
 {
     ++_srs_pps_ids->sugar;
-    map<string, ISrsResource*>::iterator it = conns_name_.find(name);
+    unordered_map<string, ISrsResource*>::iterator it = conns_name_.find(name);
     return (it != conns_name_.end())? it->second : NULL;
 }
 
@@ -249,7 +537,7 @@ void SrsResourceManager::do_remove(ISrsResource* c)
     if (verbose_) {
         _srs_context->set_id(c->get_id());
         srs_trace("%s: before dispose resource(%s)(%p), conns=%d, zombies=%d, ign=%d, inz=%d, ind=%d",
-            label_.c_str(), c->desc().c_str(), c, (int)conns_.size(), (int)zombies_.size(), ignored,
+            label_.c_str(), c->desc().c_str(), c, (int)nn_conns_, (int)zombies_.size(), ignored,
             in_zombie, in_disposing);
     }
     if (ignored) {
@@ -258,6 +546,7 @@ void SrsResourceManager::do_remove(ISrsResource* c)
 
     // Push to zombies, we will free it in another coroutine.
     zombies_.push_back(c);
+    c->resource_hook_.zombie = true;
 
     // We should copy all handlers, because it may change during callback.
     vector<ISrsDisposingHandler*> handlers = handlers_;
@@ -269,7 +558,7 @@ void SrsResourceManager::do_remove(ISrsResource* c)
         // Ignore if handler is unsubscribing.
         if (!unsubs_.empty() && std::find(unsubs_.begin(), unsubs_.end(), h) != unsubs_.end()) {
             srs_warn2(TAG_RESOURCE_UNSUB, "%s: ignore before-dispose resource(%s)(%p) for %p, conns=%d",
-                label_.c_str(), c->desc().c_str(), c, h, (int)conns_.size());
+                label_.c_str(), c->desc().c_str(), c, h, (int)nn_conns_);
             continue;
         }
 
@@ -283,18 +572,46 @@ void SrsResourceManager::do_remove(ISrsResource* c)
 void SrsResourceManager::check_remove(ISrsResource* c, bool& in_zombie, bool& in_disposing)
 {
     // Only notify when not removed(in zombies_).
-    vector<ISrsResource*>::iterator it = std::find(zombies_.begin(), zombies_.end(), c);
-    if (it != zombies_.end()) {
-        in_zombie = true;
-    }
+    in_zombie = c->resource_hook_.zombie;
 
     // Also ignore when we are disposing it.
-    if (p_disposing_) {
-        it = std::find(p_disposing_->begin(), p_disposing_->end(), c);
-        if (it != p_disposing_->end()) {
-            in_disposing = true;
-        }
+    in_disposing = c->resource_hook_.disposing;
+}
+
+void SrsResourceManager::link(ISrsResource* c)
+{
+    SrsResourceHook* hook = &c->resource_hook_;
+
+    // The hook is only able to link to one manager.
+    srs_assert(!hook->manager);
+
+    hook->resource = c;
+    hook->manager = this;
+    hook->prev = conns_.prev;
+    hook->next = &conns_;
+    conns_.prev->next = hook;
+    conns_.prev = hook;
+    nn_conns_++;
+
+    // Append to tail never changes the index of others, so the cursor is still valid.
+}
+
+void SrsResourceManager::unlink(ISrsResource* c)
+{
+    SrsResourceHook* hook = &c->resource_hook_;
+    if (hook->manager != this) {
+        return;
     }
+
+    hook->prev->next = hook->next;
+    hook->next->prev = hook->prev;
+    hook->prev = hook->next = NULL;
+    hook->manager = NULL;
+    nn_conns_--;
+
+    // Reset the cursor, because the index of resources is changed.
+    cursor_index_ = -1;
+    cursor_ = NULL;
 }
 
 void SrsResourceManager::clear()
@@ -306,7 +623,7 @@ void SrsResourceManager::clear()
     SrsContextRestore(cid_);
     if (verbose_) {
         srs_trace("%s: clear zombies=%d resources, conns=%d, removing=%d, unsubs=%d",
-            label_.c_str(), (int)zombies_.size(), (int)conns_.size(), removing_, (int)unsubs_.size());
+            label_.c_str(), (int)zombies_.size(), (int)nn_conns_, removing_, (int)unsubs_.size());
     }
 
     // Clear all unsubscribing handlers, if not removing any resource.
@@ -323,7 +640,13 @@ void SrsResourceManager::do_clear()
     // we copy all connections then free one by one.
     vector<ISrsResource*> copy;
     copy.swap(zombies_);
-    p_disposing_ = &copy;
+
+    // Mark all resources as disposing, to ignore when removed again in callbacks.
+    for (int i = 0; i < (int)copy.size(); i++) {
+        SrsResourceHook* hook = &copy.at(i)->resource_hook_;
+        hook->zombie = false;
+        hook->disposing = true;
+    }
 
     for (int i = 0; i < (int)copy.size(); i++) {
         ISrsResource* conn = copy.at(i);
@@ -331,7 +654,7 @@ void SrsResourceManager::do_clear()
         if (verbose_) {
             _srs_context->set_id(conn->get_id());
             srs_trace("%s: disposing #%d resource(%s)(%p), conns=%d, disposing=%d, zombies=%d", label_.c_str(),
-                i, conn->desc().c_str(), conn, (int)conns_.size(), (int)copy.size(), (int)zombies_.size());
+                i, conn->desc().c_str(), conn, (int)nn_conns_, (int)copy.size(), (int)zombies_.size());
         }
 
         ++_srs_pps_dispose->sugar;
@@ -339,11 +662,6 @@ void SrsResourceManager::do_clear()
         dispose(conn);
     }
 
-    // Reset it for it points to a local object.
-    // @remark We must set the disposing to NULL to avoid reusing address,
-    // because the context might switch.
-    p_disposing_ = NULL;
-
     // We should free the resources when finished all disposing callbacks,
     // which might cause context switch and reuse the freed addresses.
     for (int i = 0; i < (int)copy.size(); i++) {
@@ -354,47 +672,49 @@ void SrsResourceManager::do_clear()
 
 void SrsResourceManager::dispose(ISrsResource* c)
 {
-    for (map<string, ISrsResource*>::iterator it = conns_name_.begin(); it != conns_name_.end();) {
-        if (c != it->second) {
-            ++it;
-        } else {
-            // Use C++98 style: https://stackoverflow.com/a/4636230
-            conns_name_.erase(it++);
+    SrsResourceHook* hook = &c->resource_hook_;
+
+    // Remove the keys of resource, ignore if the key is overwritten by other resource.
+    for (int i = 0; i < (int)hook->names.size(); i++) {
+        unordered_map<string, ISrsResource*>::iterator it = conns_name_.find(hook->names.at(i));
+        if (it != conns_name_.end() && it->second == c) {
+            conns_name_.erase(it);
         }
     }
 
-    for (map<string, ISrsResource*>::iterator it = conns_id_.begin(); it != conns_id_.end();) {
-        if (c != it->second) {
-            ++it;
-        } else {
-            // Use C++98 style: https://stackoverflow.com/a/4636230
-            conns_id_.erase(it++);
+    for (int i = 0; i < (int)hook->ids.size(); i++) {
+        unordered_map<string, ISrsResource*>::iterator it = conns_id_.find(hook->ids.at(i));
+        if (it != conns_id_.end() && it->second == c) {
+            conns_id_.erase(it);
         }
     }
 
-    for (map<uint64_t, ISrsResource*>::iterator it = conns_fast_id_.begin(); it != conns_fast_id_.end();) {
-        if (c != it->second) {
-            ++it;
-        } else {
-            // Update the level-0 cache for fast-id.
-            uint64_t id = it->first;
-            SrsResourceFastIdItem* item = &conns_level0_cache_[(id | id>>32) % nn_level0_cache_];
-            item->nn_collisions--;
-            if (!item->nn_collisions) {
-                item->fast_id = 0;
-                item->available = false;
-            }
+    for (int i = 0; i < (int)hook->fast_ids.size(); i++) {
+        uint64_t id = hook->fast_ids.at(i);
+        unordered_map<uint64_t, ISrsResource*>::iterator it = conns_fast_id_.find(id);
+        if (it == conns_fast_id_.end() || it->second != c) {
+            continue;
+        }
 
-            // Use C++98 style: https://stackoverflow.com/a/4636230
-            conns_fast_id_.erase(it++);
+        // Update the level-0 cache for fast-id.
+        SrsResourceFastIdItem* item = &conns_level0_cache_[(id | id>>32) % nn_level0_cache_];
+        item->nn_collisions--;
+        if (!item->nn_collisions) {
+            item->fast_id = 0;
+            item->available = false;
         }
-    }
 
-    vector<ISrsResource*>::iterator it = std::find(conns_.begin(), conns_.end(), c);
-    if (it != conns_.end()) {
-        it = conns_.erase(it);
+        conns_fast_id_.erase(it);
     }
 
+    vector<string>().swap(hook->names);
+    vector<string>().swap(hook->ids);
+    vector<uint64_t>().swap(hook->fast_ids);
+
+    conns_addr_->erase(c);
+
+    unlink(c);
+
     // We should copy all handlers, because it may change during callback.
     vector<ISrsDisposingHandler*> handlers = handlers_;
 
@@ -405,7 +725,7 @@ void SrsResourceManager::dispose(ISrsResource* c)
         // Ignore if handler is unsubscribing.
         if (!unsubs_.empty() && std::find(unsubs_.begin(), unsubs_.end(), h) != unsubs_.end()) {
             srs_warn2(TAG_RESOURCE_UNSUB, "%s: ignore disposing resource(%s)(%p) for %p, conns=%d",
-                label_.c_str(), c->desc().c_str(), c, h, (int)conns_.size());
+                label_.c_str(), c->desc().c_str(), c, h, (int)nn_conns_);
             continue;
         }
 
@@ -588,6 +908,11 @@ srs_error_t SrsTcpConnection::writev(const iovec *iov, int iov_size, ssize_t* nw
     return skt->writev(iov, iov_size, nwrite);
 }
 
+srs_error_t SrsTcpConnection::sendfile(int fd, off_t offset, size_t size, ssize_t* nwrite)
+{
+    return skt->sendfile(fd, offset, size, nwrite);
+}
+
 SrsBufferedReadWriter::SrsBufferedReadWriter(ISrsProtocolReadWriter* io)
 {
     io_ = io;
@@ -712,6 +1037,16 @@ srs_error_t SrsBufferedReadWriter::writev(const iovec *iov, int iov_size, ssize_
     return io_->writev(iov, iov_size, nwrite);
 }
 
+srs_error_t SrsBufferedReadWriter::sendfile(int fd, off_t offset, size_t size, ssize_t* nwrite)
+{
+    ISrsProtocolSendfile* sf = dynamic_cast<ISrsProtocolSendfile*>(io_);
+    if (!sf) {
+        return srs_error_new(ERROR_SOCKET_WRITE, "sendfile not supported");
+    }
+
+    return sf->sendfile(fd, offset, size, nwrite);
+}
+
 SrsSslConnection::SrsSslConnection(ISrsProtocolReadWriter* c)
 {
     transport = c;
@@ -12,6 +12,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 #include <openssl/ssl.h>
 
@@ -22,6 +23,7 @@
 
 class SrsWallClock;
 class SrsBuffer;
+struct sockaddr;
 
 // Hooks for connection manager, to handle the event when disposing connections.
 class ISrsDisposingHandler
@@ -60,6 +62,66 @@ public:
     }
 };
 
+// The raw socket address as key, for both IPv4 and IPv6, without building string.
+class SrsSockaddrKey
+{
+public:
+    uint16_t family;
+    // The port in network order.
+    uint16_t port;
+    // The IPv4 address in first 4 bytes, or the IPv6 address.
+    uint8_t ip[16];
+public:
+    SrsSockaddrKey();
+public:
+    // Parse from socket address, return false if not IPv4 or IPv6.
+    bool parse(const sockaddr* addr);
+    uint64_t hash() const;
+    bool equals(const SrsSockaddrKey& o) const;
+};
+
+// The slot of address table, 32 bytes, so a bucket of 2 slots fits a cache line.
+struct SrsResourceAddrSlot
+{
+    SrsSockaddrKey key;
+    uint32_t state;
+    ISrsResource* impl;
+};
+
+struct SrsResourceAddrBucket
+{
+    SrsResourceAddrSlot slots[2];
+};
+
+// The open-addressed hash table to find resource by socket address, for example, the
+// RTC session by UDP peer address. The buckets are probed linearly, so a lookup
+// generally only touches one cache line.
+class SrsResourceAddrTable
+{
+private:
+    SrsResourceAddrBucket* buckets_;
+    // The number of buckets, always power of 2.
+    uint32_t nn_buckets_;
+    // The number of used and deleted slots.
+    uint32_t nn_used_;
+    uint32_t nn_deleted_;
+    // The keys of resource, to remove all addresses when disposing resource.
+    std::map<ISrsResource*, std::vector<SrsSockaddrKey> > keys_;
+public:
+    SrsResourceAddrTable();
+    virtual ~SrsResourceAddrTable();
+public:
+    void set(const SrsSockaddrKey& key, ISrsResource* conn);
+    ISrsResource* find(const SrsSockaddrKey& key);
+    // Remove all addresses of resource.
+    void erase(ISrsResource* conn);
+    uint32_t size();
+    uint32_t capacity();
+private:
+    SrsResourceAddrSlot* lookup(const SrsSockaddrKey& key);
+    void rehash(uint32_t nn_buckets);
+};
+
 // The resource manager remove resource and delete it asynchronously.
 class SrsResourceManager : public ISrsCoroutineHandler, public ISrsResourceManager
 {
@@ -78,19 +140,24 @@ private:
     bool removing_;
     // The zombie connections, we will delete it asynchronously.
     std::vector<ISrsResource*> zombies_;
-    std::vector<ISrsResource*>* p_disposing_;
 private:
-    // The connections without any id.
-    std::vector<ISrsResource*> conns_;
+    // The list of all connections, linked by the hook of resource.
+    SrsResourceHook conns_;
+    size_t nn_conns_;
+    // The cursor of list for at(index), so it's O(1) to iterate resources by index.
+    int cursor_index_;
+    SrsResourceHook* cursor_;
     // The connections with resource id.
-    std::map<std::string, ISrsResource*> conns_id_;
+    std::unordered_map<std::string, ISrsResource*> conns_id_;
     // The connections with resource fast(int) id.
-    std::map<uint64_t, ISrsResource*> conns_fast_id_;
+    std::unordered_map<uint64_t, ISrsResource*> conns_fast_id_;
     // The level-0 fast cache for fast id.
     int nn_level0_cache_;
     SrsResourceFastIdItem* conns_level0_cache_;
     // The connections with resource name.
-    std::map<std::string, ISrsResource*> conns_name_;
+    std::unordered_map<std::string, ISrsResource*> conns_name_;
+    // The connections with socket address.
+    SrsResourceAddrTable* conns_addr_;
 public:
     SrsResourceManager(const std::string& label, bool verbose = false);
     virtual ~SrsResourceManager();
@@ -106,10 +173,12 @@ public:
     void add_with_id(const std::string& id, ISrsResource* conn);
     void add_with_fast_id(uint64_t id, ISrsResource* conn);
     void add_with_name(const std::string& name, ISrsResource* conn);
+    void add_with_addr(const sockaddr* addr, ISrsResource* conn);
     ISrsResource* at(int index);
     ISrsResource* find_by_id(std::string id);
     ISrsResource* find_by_fast_id(uint64_t id);
     ISrsResource* find_by_name(std::string name);
+    ISrsResource* find_by_addr(const sockaddr* addr);
 public:
     void subscribe(ISrsDisposingHandler* h);
     void unsubscribe(ISrsDisposingHandler* h);
@@ -119,6 +188,9 @@ public:
 private:
     void do_remove(ISrsResource* c);
     void check_remove(ISrsResource* c, bool& in_zombie, bool& in_disposing);
+    // Link or unlink the resource to list.
+    void link(ISrsResource* c);
+    void unlink(ISrsResource* c);
     void clear();
     void do_clear();
     void dispose(ISrsResource* c);
@@ -233,7 +305,7 @@ public:
 // The basic connection of SRS, for TCP based protocols,
 // all connections accept from listener must extends from this base class,
 // server will add the connection to manager, and delete it when remove.
-class SrsTcpConnection : public ISrsProtocolReadWriter
+class SrsTcpConnection : public ISrsProtocolReadWriter, public ISrsProtocolSendfile
 {
 private:
     // The underlayer st fd handler.
@@ -260,11 +332,14 @@ public:
     virtual srs_utime_t get_send_timeout();
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
     virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsProtocolSendfile
+public:
+    virtual srs_error_t sendfile(int fd, off_t offset, size_t size, ssize_t* nwrite);
 };
 
 // With a small fast read buffer, to support peek for protocol detecting. Note that directly write to io without any
 // cache or buffer.
-class SrsBufferedReadWriter : public ISrsProtocolReadWriter
+class SrsBufferedReadWriter : public ISrsProtocolReadWriter, public ISrsProtocolSendfile
 {
 private:
     // The under-layer transport.
@@ -294,6 +369,9 @@ public:
     virtual srs_utime_t get_send_timeout();
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
     virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsProtocolSendfile
+public:
+    virtual srs_error_t sendfile(int fd, off_t offset, size_t size, ssize_t* nwrite);
 };
 
 // The SSL connection over TCP transport, in server mode.
@@ -7,6 +7,7 @@
 #include <srs_app_dvr.hpp>
 
 #include <fcntl.h>
+#include <unistd.h>
 #include <sstream>
 #include <algorithm>
 using namespace std;
@@ -26,6 +27,9 @@ using namespace std;
 #include <srs_kernel_mp4.hpp>
 #include <srs_app_fragment.hpp>
 
+// The bytes to copy in a batch when defragment fMP4, then yield to other coroutines.
+#define SRS_DVR_DEFRAG_BATCH (1024 * 1024)
+
 SrsDvrSegmenter::SrsDvrSegmenter()
 {
     req = NULL;
@@ -174,6 +178,10 @@ srs_error_t SrsDvrSegmenter::close()
         return srs_error_wrap(err, "rename fragment");
     }
     
+    if ((err = reap_encoder()) != srs_success) {
+        return srs_error_wrap(err, "reap encoder");
+    }
+    
     // TODO: FIXME: the http callback is async, which will trigger thread switch,
     //          so the on_video maybe invoked during the http callback, and error.
     if ((err = plan->on_reap_segment()) != srs_success) {
@@ -183,6 +191,11 @@ srs_error_t SrsDvrSegmenter::close()
     return err;
 }
 
+srs_error_t SrsDvrSegmenter::reap_encoder()
+{
+    return srs_success;
+}
+
 string SrsDvrSegmenter::generate_path()
 {
     // the path in config, for example,
@@ -517,6 +530,183 @@ srs_error_t SrsDvrMp4Segmenter::close_encoder()
     return err;
 }
 
+SrsDvrFmp4Segmenter::SrsDvrFmp4Segmenter()
+{
+    enc = new SrsFmp4Encoder();
+    faststart = false;
+}
+
+SrsDvrFmp4Segmenter::~SrsDvrFmp4Segmenter()
+{
+    srs_freep(enc);
+}
+
+srs_error_t SrsDvrFmp4Segmenter::refresh_metadata()
+{
+    return srs_success;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::open_encoder()
+{
+    srs_error_t err = srs_success;
+    
+    srs_freep(enc);
+    enc = new SrsFmp4Encoder();
+    
+    faststart = _srs_config->get_dvr_fmp4_faststart(req->vhost);
+    srs_utime_t duration = _srs_config->get_dvr_fmp4_fragment(req->vhost);
+    
+    if ((err = enc->initialize(fs, duration)) != srs_success) {
+        return srs_error_wrap(err, "init encoder");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::encode_metadata(SrsSharedPtrMessage* /*metadata*/)
+{
+    return srs_success;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::encode_audio(SrsSharedPtrMessage* audio, SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+    
+    SrsAudioAacFrameTrait ct = format->audio->aac_packet_type;
+    if (ct == SrsAudioAacFrameTraitSequenceHeader || ct == SrsAudioMp3FrameTraitSequenceHeader) {
+        enc->acodec = format->acodec->id;
+        enc->sample_rate = format->acodec->sound_rate;
+        enc->sound_bits = format->acodec->sound_size;
+        enc->channels = format->acodec->sound_type;
+    }
+    
+    uint8_t* sample = (uint8_t*)format->raw;
+    uint32_t nb_sample = (uint32_t)format->nb_raw;
+    
+    uint32_t dts = (uint32_t)audio->timestamp;
+    if ((err = enc->write_sample(format, SrsMp4HandlerTypeSOUN, 0x00, ct, dts, dts, sample, nb_sample)) != srs_success) {
+        return srs_error_wrap(err, "write sample");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::encode_video(SrsSharedPtrMessage* video, SrsFormat* format)
+{
+    srs_error_t err = srs_success;
+    
+    SrsVideoAvcFrameType frame_type = format->video->frame_type;
+    SrsVideoAvcFrameTrait ct = format->video->avc_packet_type;
+    uint32_t cts = (uint32_t)format->video->cts;
+    
+    if (ct == SrsVideoAvcFrameTraitSequenceHeader) {
+        enc->vcodec = format->vcodec->id;
+    }
+    
+    uint32_t dts = (uint32_t)video->timestamp;
+    uint32_t pts = dts + cts;
+    
+    uint8_t* sample = (uint8_t*)format->raw;
+    uint32_t nb_sample = (uint32_t)format->nb_raw;
+    if ((err = enc->write_sample(format, SrsMp4HandlerTypeVIDE, frame_type, ct, dts, pts, sample, nb_sample)) != srs_success) {
+        return srs_error_wrap(err, "write sample");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::close_encoder()
+{
+    srs_error_t err = srs_success;
+    
+    if ((err = enc->flush()) != srs_success) {
+        return srs_error_wrap(err, "flush encoder");
+    }
+    
+    return err;
+}
+
+srs_error_t SrsDvrFmp4Segmenter::reap_encoder()
+{
+    srs_error_t err = srs_success;
+    
+    if (!faststart) {
+        return err;
+    }
+    
+    // Never block the publisher, the segment might be very large.
+    if ((err = _srs_dvr_async->execute(new SrsDvrAsyncCallDefragment(fragment->fullpath()))) != srs_success) {
+        return srs_error_wrap(err, "defragment");
+    }
+    
+    return err;
+}
+
+SrsDvrAsyncCallDefragment::SrsDvrAsyncCallDefragment(string p)
+{
+    path = p;
+}
+
+SrsDvrAsyncCallDefragment::~SrsDvrAsyncCallDefragment()
+{
+}
+
+srs_error_t SrsDvrAsyncCallDefragment::call()
+{
+    srs_error_t err = srs_success;
+    
+    srs_utime_t starttime = srs_update_system_time();
+    
+    // The fMP4 is also playable, so we keep it if failed to defragment.
+    string faststart_file = path + ".faststart";
+    
+    SrsFileReader fr;
+    if ((err = fr.open(path)) != srs_success) {
+        return srs_error_wrap(err, "open %s", path.c_str());
+    }
+    
+    SrsFileWriter fw;
+    if ((err = fw.open(faststart_file)) != srs_success) {
+        return srs_error_wrap(err, "open %s", faststart_file.c_str());
+    }
+    
+    // The segment might be very large, so we copy the samples in batches and yield between them, to never
+    // block other coroutines for a long time.
+    SrsFmp4Defragmenter defrag;
+    if ((err = defrag.initialize(&fr, &fw)) == srs_success) {
+        err = defrag.start();
+    }
+    bool done = false;
+    while (err == srs_success && !done) {
+        if ((err = defrag.copy(SRS_DVR_DEFRAG_BATCH, &done)) != srs_success) {
+            break;
+        }
+        if (!done) {
+            srs_thread_yield();
+        }
+    }
+    
+    fw.close();
+    if (err != srs_success) {
+        ::unlink(faststart_file.c_str());
+        return srs_error_wrap(err, "defragment %s", path.c_str());
+    }
+    
+    // Replace the fMP4 by the MP4, which is atomic for players.
+    if (::rename(faststart_file.c_str(), path.c_str()) < 0) {
+        ::unlink(faststart_file.c_str());
+        return srs_error_new(ERROR_SYSTEM_FILE_RENAME, "rename %s to %s", faststart_file.c_str(), path.c_str());
+    }
+    
+    srs_trace("dvr: defragment %s, cost=%dms", path.c_str(), srsu2msi(srs_update_system_time() - starttime));
+    return err;
+}
+
+string SrsDvrAsyncCallDefragment::to_string()
+{
+    return "defragment " + path;
+}
+
 SrsDvrAsyncCallOnDvr::SrsDvrAsyncCallOnDvr(SrsContextId c, SrsRequest* r, string p)
 {
     cid = c;
@@ -945,7 +1135,9 @@ srs_error_t SrsDvr::initialize(SrsOriginHub* h, SrsRequest* r)
     
     std::string path = _srs_config->get_dvr_path(r->vhost);
     SrsDvrSegmenter* segmenter = NULL;
-    if (srs_string_ends_with(path, ".mp4")) {
+    if (srs_string_ends_with(path, ".mp4") && _srs_config->get_dvr_fmp4(r->vhost)) {
+        segmenter = new SrsDvrFmp4Segmenter();
+    } else if (srs_string_ends_with(path, ".mp4")) {
         segmenter = new SrsDvrMp4Segmenter();
     } else {
         segmenter = new SrsDvrFlvSegmenter();
@@ -25,6 +25,7 @@ class SrsJsonAny;
 class SrsJsonObject;
 class SrsThread;
 class SrsMp4Encoder;
+class SrsFmp4Encoder;
 class SrsFragment;
 class SrsFormat;
 
@@ -42,8 +43,9 @@ protected:
     bool wait_keyframe;
     // The FLV/MP4 fragment file.
     SrsFragment* fragment;
-private:
+protected:
     SrsRequest* req;
+private:
     SrsDvrPlan* plan;
 private:
     SrsRtmpJitter* jitter;
@@ -81,6 +83,9 @@ protected:
     virtual srs_error_t encode_audio(SrsSharedPtrMessage* audio, SrsFormat* format) = 0;
     virtual srs_error_t encode_video(SrsSharedPtrMessage* video, SrsFormat* format) = 0;
     virtual srs_error_t close_encoder() = 0;
+    // Process the reaped file by the async worker, which is done before the callback of plan, because the tasks
+    // of async worker are executed in order.
+    virtual srs_error_t reap_encoder();
 private:
     // Generate the flv segment path.
     virtual std::string generate_path();
@@ -138,6 +143,42 @@ protected:
     virtual srs_error_t close_encoder();
 };
 
+// The fMP4 segmenter to use fMP4 encoder to write file, which flush each fragment to file,
+// so the memory is bounded, and the file is playable even if server crash.
+class SrsDvrFmp4Segmenter : public SrsDvrSegmenter
+{
+private:
+    // The fMP4 encoder, for MP4 target.
+    SrsFmp4Encoder* enc;
+    // Whether defragment to a faststart MP4 when close.
+    bool faststart;
+public:
+    SrsDvrFmp4Segmenter();
+    virtual ~SrsDvrFmp4Segmenter();
+public:
+    virtual srs_error_t refresh_metadata();
+protected:
+    virtual srs_error_t open_encoder();
+    virtual srs_error_t encode_metadata(SrsSharedPtrMessage* metadata);
+    virtual srs_error_t encode_audio(SrsSharedPtrMessage* audio, SrsFormat* format);
+    virtual srs_error_t encode_video(SrsSharedPtrMessage* video, SrsFormat* format);
+    virtual srs_error_t close_encoder();
+    virtual srs_error_t reap_encoder();
+};
+
+// The dvr async defragment, to convert the fMP4 file to faststart MP4.
+class SrsDvrAsyncCallDefragment : public ISrsAsyncCallTask
+{
+private:
+    std::string path;
+public:
+    SrsDvrAsyncCallDefragment(std::string p);
+    virtual ~SrsDvrAsyncCallDefragment();
+public:
+    virtual srs_error_t call();
+    virtual std::string to_string();
+};
+
 // the dvr async call.
 class SrsDvrAsyncCallOnDvr : public ISrsAsyncCallTask
 {
@@ -21,10 +21,44 @@ using namespace std;
 
 SrsHttpHeartbeat::SrsHttpHeartbeat()
 {
+    trd_ = new SrsSTCoroutine("heartbeat", this, _srs_context->get_id());
 }
 
 SrsHttpHeartbeat::~SrsHttpHeartbeat()
 {
+    srs_freep(trd_);
+}
+
+srs_error_t SrsHttpHeartbeat::start()
+{
+    srs_error_t err = srs_success;
+
+    if (!_srs_config->get_heartbeat_enabled()) {
+        return err;
+    }
+
+    if ((err = trd_->start()) != srs_success) {
+        return srs_error_wrap(err, "start heartbeat");
+    }
+
+    return err;
+}
+
+srs_error_t SrsHttpHeartbeat::cycle()
+{
+    srs_error_t err = srs_success;
+
+    while (true) {
+        if ((err = trd_->pull()) != srs_success) {
+            return srs_error_wrap(err, "quit");
+        }
+
+        heartbeat();
+
+        srs_usleep(_srs_config->get_heartbeat_interval());
+    }
+
+    return err;
 }
 
 void SrsHttpHeartbeat::heartbeat()
@@ -9,14 +9,23 @@
 
 #include <srs_core.hpp>
 
+#include <srs_app_st.hpp>
+
 // The http heartbeat to api-server to notice api that the information of SRS.
-class SrsHttpHeartbeat
+// Note that the http request might block for a long time, so it runs in its own coroutine, rather than the timer.
+class SrsHttpHeartbeat : public ISrsCoroutineHandler
 {
+private:
+    SrsCoroutine* trd_;
 public:
     SrsHttpHeartbeat();
     virtual ~SrsHttpHeartbeat();
 public:
+    virtual srs_error_t start();
     virtual void heartbeat();
+// interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
 private:
     virtual srs_error_t do_heartbeat();
 };
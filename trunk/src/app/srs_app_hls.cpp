@@ -34,6 +34,7 @@ using namespace std;
 #include <srs_app_utility.hpp>
 #include <srs_app_http_hooks.hpp>
 #include <srs_protocol_format.hpp>
+#include <srs_protocol_st.hpp>
 #include <openssl/rand.h>
 
 // drop the segment when duration of ts too small.
@@ -182,6 +183,147 @@ string SrsDvrAsyncCallOnHlsNotify::to_string()
     return "on_hls_notify: " + ts_url;
 }
 
+SrsHlsMuxChannel::SrsHlsMuxChannel(SrsThreadWorker* worker)
+{
+    worker_ = worker;
+    ctx_ = new SrsThreadTaskContext();
+    lock_ = new SrsThreadMutex();
+    err_ = srs_success;
+    wakeup_pipe_[0] = wakeup_pipe_[1] = -1;
+    wakeup_stfd_ = NULL;
+}
+
+SrsHlsMuxChannel::~SrsHlsMuxChannel()
+{
+    // Drop the messages not written, the worker thread never references the channel after canceled.
+    ctx_->cancel();
+
+    srs_close_stfd(wakeup_stfd_);
+    if (wakeup_pipe_[1] >= 0) {
+        ::close(wakeup_pipe_[1]);
+    }
+
+    srs_freep(err_);
+    srs_freep(lock_);
+}
+
+srs_error_t SrsHlsMuxChannel::initialize()
+{
+    if (pipe(wakeup_pipe_) < 0) {
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "create pipe");
+    }
+
+    if ((wakeup_stfd_ = srs_netfd_open(wakeup_pipe_[0])) == NULL) {
+        ::close(wakeup_pipe_[0]);
+        return srs_error_new(ERROR_SYSTEM_CREATE_PIPE, "open pipe");
+    }
+
+    // The worker never blocks when writing, the pipe is full only when we are woken up already.
+    int flags = fcntl(wakeup_pipe_[1], F_GETFL, 0);
+    fcntl(wakeup_pipe_[1], F_SETFL, flags | O_NONBLOCK);
+
+    ctx_->set_wakeup(wakeup_pipe_[1]);
+
+    return srs_success;
+}
+
+srs_error_t SrsHlsMuxChannel::write_audio(SrsTsContextWriter* tscw, SrsTsMessage* msg)
+{
+    return write(tscw, msg, true);
+}
+
+srs_error_t SrsHlsMuxChannel::write_video(SrsTsContextWriter* tscw, SrsTsMessage* msg)
+{
+    return write(tscw, msg, false);
+}
+
+void SrsHlsMuxChannel::wait()
+{
+    // Mark waiting before checking the pending messages, so the worker never misses to wake us up. The bytes
+    // of previous wakeup are also consumed here, which only cause another check.
+    ctx_->set_waiting(true);
+    while (ctx_->pending() > 0) {
+        // Sleep if failed, for example, the other coroutine is also waiting, which reads the pipe.
+        char buf[64];
+        if (srs_read(wakeup_stfd_, buf, sizeof(buf), SRS_UTIME_NO_TIMEOUT) <= 0) {
+            srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+        }
+    }
+    ctx_->set_waiting(false);
+}
+
+srs_error_t SrsHlsMuxChannel::drain()
+{
+    wait();
+    return pop_error();
+}
+
+void SrsHlsMuxChannel::on_written(srs_error_t err)
+{
+    if (err == srs_success) {
+        return;
+    }
+
+    SrsThreadLocker(lock_);
+    if (err_ == srs_success) {
+        err_ = err;
+    } else {
+        srs_freep(err);
+    }
+}
+
+srs_error_t SrsHlsMuxChannel::write(SrsTsContextWriter* tscw, SrsTsMessage* msg, bool audio)
+{
+    srs_error_t err = srs_success;
+
+    // Fail fast, if the worker failed to write previous messages.
+    if ((err = pop_error()) != srs_success) {
+        srs_freep(msg);
+        return srs_error_wrap(err, "hls: worker #%d", worker_->id());
+    }
+
+    worker_->push(new SrsHlsMuxTask(ctx_, this, tscw, msg, audio));
+
+    return err;
+}
+
+srs_error_t SrsHlsMuxChannel::pop_error()
+{
+    SrsThreadLocker(lock_);
+
+    srs_error_t err = err_;
+    err_ = srs_success;
+
+    return err;
+}
+
+SrsHlsMuxTask::SrsHlsMuxTask(SrsThreadTaskContext* ctx, SrsHlsMuxChannel* channel, SrsTsContextWriter* tscw, SrsTsMessage* msg, bool audio) : SrsThreadTask(ctx)
+{
+    channel_ = channel;
+    tscw_ = tscw;
+    msg_ = msg;
+    audio_ = audio;
+}
+
+SrsHlsMuxTask::~SrsHlsMuxTask()
+{
+    srs_freep(msg_);
+}
+
+void SrsHlsMuxTask::execute()
+{
+    srs_error_t err = srs_success;
+    if (audio_) {
+        err = tscw_->write_audio(msg_);
+    } else {
+        err = tscw_->write_video(msg_);
+    }
+
+    channel_->on_written(err);
+}
+
+SrsThreadWorkerPool* _srs_hls_mux_pool = NULL;
+
 SrsHlsMuxer::SrsHlsMuxer()
 {
     req = NULL;
@@ -204,6 +346,7 @@ SrsHlsMuxer::SrsHlsMuxer()
     segments = new SrsFragmentWindow();
     latest_acodec_ = SrsAudioCodecIdForbidden;
     latest_vcodec_ = SrsVideoCodecIdForbidden;
+    channel_ = NULL;
     
     memset(key, 0, 16);
     memset(iv, 0, 16);
@@ -211,6 +354,10 @@ SrsHlsMuxer::SrsHlsMuxer()
 
 SrsHlsMuxer::~SrsHlsMuxer()
 {
+    // Never wait for the mux worker in destructor, the channel is drained by dispose, or dropped here before
+    // freeing the segment.
+    srs_freep(channel_);
+
     srs_freep(segments);
     srs_freep(current);
     srs_freep(req);
@@ -224,6 +371,13 @@ void SrsHlsMuxer::dispose()
     srs_error_t err = srs_success;
     
     segments->dispose();
+
+    // Stop the mux worker for the current segment, and bind to a worker again when publishing.
+    if (channel_ && (err = channel_->drain()) != srs_success) {
+        srs_warn("Drain hls worker failed %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+    srs_freep(channel_);
     
     if (current) {
         if ((err = current->unlink_tmpfile()) != srs_success) {
@@ -277,7 +431,11 @@ SrsAudioCodecId SrsHlsMuxer::latest_acodec()
 void SrsHlsMuxer::set_latest_acodec(SrsAudioCodecId v)
 {
     // Refresh the codec in context writer for current segment.
-    if (current && current->tscw) current->tscw->set_acodec(v);
+    if (current && current->tscw) {
+        // Wait for the mux worker, which reads the codec when writing messages.
+        if (channel_) channel_->wait();
+        current->tscw->set_acodec(v);
+    }
 
     // Refresh the codec for future segments.
     latest_acodec_ = v;
@@ -295,7 +453,11 @@ SrsVideoCodecId SrsHlsMuxer::latest_vcodec()
 void SrsHlsMuxer::set_latest_vcodec(SrsVideoCodecId v)
 {
     // Refresh the codec in context writer for current segment.
-    if (current && current->tscw) current->tscw->set_vcodec(v);
+    if (current && current->tscw) {
+        // Wait for the mux worker, which reads the codec when writing messages.
+        if (channel_) channel_->wait();
+        current->tscw->set_vcodec(v);
+    }
 
     // Refresh the codec for future segments.
     latest_vcodec_ = v;
@@ -314,6 +476,18 @@ srs_error_t SrsHlsMuxer::on_publish(SrsRequest* req)
         return srs_error_wrap(err, "async start");
     }
 
+    // Bind to a mux worker, if enabled.
+    if (!channel_) {
+        int nn_workers = _srs_config->get_threads_hls_workers();
+        SrsThreadWorker* worker = _srs_hls_mux_pool->pick(nn_workers, _srs_config->get_threads_hls_queue());
+        channel_ = worker? new SrsHlsMuxChannel(worker) : NULL;
+
+        if (channel_ && (err = channel_->initialize()) != srs_success) {
+            srs_freep(channel_);
+            return srs_error_wrap(err, "hls worker");
+        }
+    }
+
     return err;
 }
 
@@ -589,6 +763,17 @@ srs_error_t SrsHlsMuxer::flush_audio(SrsTsMessageCache* cache)
     // update the duration of segment.
     current->append(cache->audio->pts / 90);
     
+    // Write by mux worker, which takes the ownership of msg.
+    if (channel_) {
+        SrsTsMessage* msg = cache->audio;
+        cache->audio = NULL;
+
+        if ((err = channel_->write_audio(current->tscw, msg)) != srs_success) {
+            return srs_error_wrap(err, "hls: write audio");
+        }
+        return err;
+    }
+
     if ((err = current->tscw->write_audio(cache->audio)) != srs_success) {
         return srs_error_wrap(err, "hls: write audio");
     }
@@ -618,6 +803,17 @@ srs_error_t SrsHlsMuxer::flush_video(SrsTsMessageCache* cache)
     // update the duration of segment.
     current->append(cache->video->dts / 90);
 
+    // Write by mux worker, which takes the ownership of msg.
+    if (channel_) {
+        SrsTsMessage* msg = cache->video;
+        cache->video = NULL;
+
+        if ((err = channel_->write_video(current->tscw, msg)) != srs_success) {
+            return srs_error_wrap(err, "hls: write video");
+        }
+        return err;
+    }
+
     if ((err = current->tscw->write_video(cache->video)) != srs_success) {
         return srs_error_wrap(err, "hls: write video");
     }
@@ -650,10 +846,17 @@ srs_error_t SrsHlsMuxer::do_segment_close()
     // when close current segment, the current segment must not be NULL.
     srs_assert(current);
 
+    // Wait for the mux worker to write all messages of segment.
+    srs_error_t r0 = channel_? channel_->drain() : srs_success;
+
     // We should always close the underlayer writer.
     if (current && current->writer) {
         current->writer->close();
     }
+
+    if (r0 != srs_success) {
+        return srs_error_wrap(r0, "hls: drain worker");
+    }
     
     // valid, add to segments if segment duration is ok
     // when too small, it maybe not enough data to play.
@@ -16,6 +16,7 @@
 #include <srs_kernel_file.hpp>
 #include <srs_app_async_call.hpp>
 #include <srs_app_fragment.hpp>
+#include <srs_app_threads.hpp>
 
 class SrsFormat;
 class SrsSharedPtrMessage;
@@ -30,6 +31,7 @@ class SrsFileWriter;
 class SrsSimpleStream;
 class SrsTsAacJitter;
 class SrsTsMessageCache;
+class SrsTsMessage;
 class SrsHlsSegment;
 class SrsTsContext;
 
@@ -97,6 +99,61 @@ public:
     virtual std::string to_string();
 };
 
+// The channel of a HLS stream to a mux worker, to write TS messages in worker thread,
+// while the segment, m3u8 and hooks are still managed by ST thread.
+// @remark Before ST thread touches the TS context or file writer, it MUST wait for
+//       the pending messages, that is, the worker never writes the same segment with ST.
+class SrsHlsMuxChannel
+{
+private:
+    SrsThreadWorker* worker_;
+    // The context of messages not written yet, shared with the tasks.
+    SrsThreadTaskContext* ctx_;
+    // The first error of worker thread.
+    SrsThreadMutex* lock_;
+    srs_error_t err_;
+    // The pipe for worker to wake up the coroutine waiting for pending messages, because the ST condition could
+    // not be signaled by other threads.
+    int wakeup_pipe_[2];
+    srs_netfd_t wakeup_stfd_;
+public:
+    SrsHlsMuxChannel(SrsThreadWorker* worker);
+    virtual ~SrsHlsMuxChannel();
+public:
+    srs_error_t initialize();
+    // Write TS message by worker thread, which always takes the ownership of msg.
+    srs_error_t write_audio(SrsTsContextWriter* tscw, SrsTsMessage* msg);
+    srs_error_t write_video(SrsTsContextWriter* tscw, SrsTsMessage* msg);
+    // Wait for all pending messages to be written, yield to other coroutines.
+    void wait();
+    // Wait for all pending messages and return the error of worker.
+    srs_error_t drain();
+    // Notify the message is written, called in worker thread.
+    void on_written(srs_error_t err);
+private:
+    srs_error_t write(SrsTsContextWriter* tscw, SrsTsMessage* msg, bool audio);
+    srs_error_t pop_error();
+};
+
+// The task to write a TS message in worker thread.
+class SrsHlsMuxTask : public SrsThreadTask
+{
+private:
+    SrsHlsMuxChannel* channel_;
+    SrsTsContextWriter* tscw_;
+    SrsTsMessage* msg_;
+    bool audio_;
+public:
+    SrsHlsMuxTask(SrsThreadTaskContext* ctx, SrsHlsMuxChannel* channel, SrsTsContextWriter* tscw, SrsTsMessage* msg, bool audio);
+    virtual ~SrsHlsMuxTask();
+protected:
+    virtual void execute();
+};
+
+// The workers to mux HLS streams in multiple threads.
+// It MUST be thread-safe, global and shared object.
+extern SrsThreadWorkerPool* _srs_hls_mux_pool;
+
 // Mux the HLS stream(m3u8 and ts files).
 // Generally, the m3u8 muxer only provides methods to open/close segments,
 // to flush video/audio, without any mechenisms.
@@ -161,6 +218,9 @@ private:
     SrsAudioCodecId latest_acodec_;
     // Latest audio codec, parsed from stream.
     SrsVideoCodecId latest_vcodec_;
+private:
+    // The channel to mux TS in worker thread, NULL to mux in ST thread.
+    SrsHlsMuxChannel* channel_;
 public:
     SrsHlsMuxer();
     virtual ~SrsHlsMuxer();
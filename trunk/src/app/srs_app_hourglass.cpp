@@ -37,26 +37,67 @@ ISrsHourGlass::~ISrsHourGlass()
 {
 }
 
+// The tick of hourglass, which is a timer in wheel.
+class SrsHourGlassTick : public ISrsFastTimer
+{
+public:
+    SrsHourGlass* hourglass_;
+    int event_;
+    // The interval of event, 0 means to notify for each resolution.
+    srs_utime_t interval_;
+    // The interval to schedule the timer.
+    srs_utime_t period_;
+public:
+    SrsHourGlassTick(SrsHourGlass* hourglass, int event, srs_utime_t interval, srs_utime_t resolution) {
+        hourglass_ = hourglass;
+        event_ = event;
+        interval_ = interval;
+        period_ = interval ? interval : resolution;
+    }
+    virtual ~SrsHourGlassTick() {
+    }
+// interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval) {
+        return hourglass_->notify(event_, interval_);
+    }
+};
+
 SrsHourGlass::SrsHourGlass(string label, ISrsHourGlass* h, srs_utime_t resolution)
 {
     label_ = label;
     handler = h;
     _resolution = resolution;
-    total_elapse = 0;
-    trd = new SrsSTCoroutine("timer-" + label, this, _srs_context->get_id());
+    wheel_ = _srs_timer_wheel;
+    started_ = false;
+    starttime_ = 0;
 }
 
 SrsHourGlass::~SrsHourGlass()
 {
-    srs_freep(trd);
+    map<int, SrsHourGlassTick*>::iterator it;
+    for (it = ticks.begin(); it != ticks.end(); ++it) {
+        SrsHourGlassTick* tick = it->second;
+        srs_freep(tick);
+    }
+    ticks.clear();
 }
 
 srs_error_t SrsHourGlass::start()
 {
     srs_error_t err = srs_success;
 
-    if ((err = trd->start()) != srs_success) {
-        return srs_error_wrap(err, "start timer");
+    if (started_) {
+        return err;
+    }
+    started_ = true;
+    starttime_ = srs_get_system_time();
+
+    // Each tick is notified immediately, then every interval.
+    map<int, SrsHourGlassTick*>::iterator it;
+    for (it = ticks.begin(); it != ticks.end(); ++it) {
+        SrsHourGlassTick* tick = it->second;
+        wheel_->schedule(tick, tick->period_, 0);
     }
 
     return err;
@@ -64,7 +105,13 @@ srs_error_t SrsHourGlass::start()
 
 void SrsHourGlass::stop()
 {
-    trd->stop();
+    started_ = false;
+
+    map<int, SrsHourGlassTick*>::iterator it;
+    for (it = ticks.begin(); it != ticks.end(); ++it) {
+        SrsHourGlassTick* tick = it->second;
+        wheel_->cancel(tick);
+    }
 }
 
 srs_error_t SrsHourGlass::tick(srs_utime_t interval)
@@ -80,71 +127,148 @@ srs_error_t SrsHourGlass::tick(int event, srs_utime_t interval)
         return srs_error_new(ERROR_SYSTEM_HOURGLASS_RESOLUTION,
             "invalid interval=%dms, resolution=%dms", srsu2msi(interval), srsu2msi(_resolution));
     }
-    
-    ticks[event] = interval;
+
+    untick(event);
+
+    SrsHourGlassTick* tick = new SrsHourGlassTick(this, event, interval, _resolution);
+    ticks[event] = tick;
+
+    if (started_) {
+        wheel_->schedule(tick, tick->period_, 0);
+    }
     
     return err;
 }
 
 void SrsHourGlass::untick(int event)
 {
-    map<int, srs_utime_t>::iterator it = ticks.find(event);
+    map<int, SrsHourGlassTick*>::iterator it = ticks.find(event);
     if (it != ticks.end()) {
+        SrsHourGlassTick* tick = it->second;
         ticks.erase(it);
+        // The tick is cancelled when freed.
+        srs_freep(tick);
     }
 }
 
-srs_error_t SrsHourGlass::cycle()
+srs_error_t SrsHourGlass::notify(int event, srs_utime_t interval)
 {
     srs_error_t err = srs_success;
 
-    while (true) {
-        if ((err = trd->pull()) != srs_success) {
-            return srs_error_wrap(err, "quit");
-        }
-    
-        map<int, srs_utime_t>::iterator it;
-        for (it = ticks.begin(); it != ticks.end(); ++it) {
-            int event = it->first;
-            srs_utime_t interval = it->second;
-
-            if (interval == 0 || (total_elapse % interval) == 0) {
-                ++_srs_pps_timer->sugar;
-
-                if ((err = handler->notify(event, interval, total_elapse)) != srs_success) {
-                    return srs_error_wrap(err, "notify");
-                }
-            }
-        }
-
-        // TODO: FIXME: Maybe we should use wallclock.
-        total_elapse += _resolution;
-        srs_usleep(_resolution);
+    // TODO: FIXME: Maybe we should use wallclock.
+    srs_utime_t elapsed = srs_get_system_time() - starttime_;
+    if ((err = handler->notify(event, interval, elapsed)) != srs_success) {
+        return srs_error_wrap(err, "notify %s event=%d", label_.c_str(), event);
     }
-    
+
     return err;
 }
 
 ISrsFastTimer::ISrsFastTimer()
 {
+    timer_node_.prev = timer_node_.next = NULL;
+    timer_node_.timer = this;
+    timer_node_.wheel = NULL;
+    timer_node_.owner = NULL;
+    timer_node_.interval = 0;
+    timer_node_.expires = 0;
 }
 
 ISrsFastTimer::~ISrsFastTimer()
 {
+    if (timer_node_.wheel) {
+        timer_node_.wheel->cancel(this);
+    }
 }
 
-SrsFastTimer::SrsFastTimer(std::string label, srs_utime_t interval)
+// Initialize the head of list.
+static void srs_timer_list_init(SrsTimerNode* head)
 {
-    interval_ = interval;
-    trd_ = new SrsSTCoroutine(label, this, _srs_context->get_id());
+    head->prev = head->next = head;
+    head->timer = NULL;
+    head->wheel = NULL;
+    head->owner = NULL;
+    head->interval = 0;
+    head->expires = 0;
 }
 
-SrsFastTimer::~SrsFastTimer()
+// Remove the node from list.
+static void srs_timer_list_del(SrsTimerNode* node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = NULL;
+}
+
+// Append the node to the tail of list.
+static void srs_timer_list_add(SrsTimerNode* head, SrsTimerNode* node)
+{
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+// Move all nodes of from to the tail of list to, and the from is empty.
+static void srs_timer_list_splice(SrsTimerNode* from, SrsTimerNode* to)
+{
+    if (from->next == from) {
+        return;
+    }
+
+    SrsTimerNode* first = from->next;
+    SrsTimerNode* last = from->prev;
+
+    first->prev = to->prev;
+    to->prev->next = first;
+    last->next = to;
+    to->prev = last;
+
+    from->prev = from->next = from;
+}
+
+SrsTimerWheel::SrsTimerWheel(string label, srs_utime_t resolution)
+{
+    resolution_ = srs_max(resolution, (srs_utime_t)1);
+    base_ = 0;
+    current_ = 0;
+    size_ = 0;
+
+    for (int i = 0; i < SRS_TIMER_WHEEL_ROOT_SIZE; i++) {
+        srs_timer_list_init(&root_[i]);
+    }
+    for (int level = 0; level < SRS_TIMER_WHEEL_LEVELS - 1; level++) {
+        for (int i = 0; i < SRS_TIMER_WHEEL_SIZE; i++) {
+            srs_timer_list_init(&levels_[level][i]);
+        }
+    }
+    srs_timer_list_init(&pending_);
+
+    trd_ = new SrsSTCoroutine("timer-" + label, this, _srs_context->get_id());
+}
+
+SrsTimerWheel::~SrsTimerWheel()
 {
     srs_freep(trd_);
+
+    // Detach all timers, which might be freed later.
+    for (int i = 0; i < SRS_TIMER_WHEEL_ROOT_SIZE; i++) {
+        srs_timer_list_splice(&root_[i], &pending_);
+    }
+    for (int level = 0; level < SRS_TIMER_WHEEL_LEVELS - 1; level++) {
+        for (int i = 0; i < SRS_TIMER_WHEEL_SIZE; i++) {
+            srs_timer_list_splice(&levels_[level][i], &pending_);
+        }
+    }
+    while (pending_.next != &pending_) {
+        SrsTimerNode* node = pending_.next;
+        srs_timer_list_del(node);
+        node->wheel = NULL;
+        node->owner = NULL;
+    }
 }
 
-srs_error_t SrsFastTimer::start()
+srs_error_t SrsTimerWheel::start()
 {
     srs_error_t err = srs_success;
 
@@ -155,46 +279,222 @@ srs_error_t SrsFastTimer::start()
     return err;
 }
 
-void SrsFastTimer::subscribe(ISrsFastTimer* timer)
+void SrsTimerWheel::schedule(ISrsFastTimer* timer, srs_utime_t interval)
+{
+    schedule(timer, interval, interval);
+}
+
+void SrsTimerWheel::schedule(ISrsFastTimer* timer, srs_utime_t interval, srs_utime_t delay)
 {
-    if (std::find(handlers_.begin(), handlers_.end(), timer) == handlers_.end()) {
-        handlers_.push_back(timer);
+    SrsTimerNode* node = &timer->timer_node_;
+
+    if (node->wheel) {
+        node->wheel->cancel(timer);
     }
+
+    node->wheel = this;
+    node->owner = NULL;
+    node->interval = interval;
+    // The deadline is from the last tick, which is the time now of wheel.
+    node->expires = (current_ ? current_ - 1 : 0) + to_ticks(delay);
+    add(node);
+    size_++;
 }
 
-void SrsFastTimer::unsubscribe(ISrsFastTimer* timer)
+void SrsTimerWheel::cancel(ISrsFastTimer* timer)
 {
-    vector<ISrsFastTimer*>::iterator it = std::find(handlers_.begin(), handlers_.end(), timer);
-    if (it != handlers_.end()) {
-        it = handlers_.erase(it);
+    SrsTimerNode* node = &timer->timer_node_;
+    if (node->wheel != this) {
+        return;
     }
+
+    srs_timer_list_del(node);
+    node->wheel = NULL;
+    node->owner = NULL;
+    size_--;
 }
 
-srs_error_t SrsFastTimer::cycle()
+bool SrsTimerWheel::scheduled(ISrsFastTimer* timer)
 {
-    srs_error_t err = srs_success;
+    return timer->timer_node_.wheel == this;
+}
 
-    while (true) {
-        if ((err = trd_->pull()) != srs_success) {
-            return srs_error_wrap(err, "quit");
+int SrsTimerWheel::size()
+{
+    return size_;
+}
+
+void SrsTimerWheel::advance(srs_utime_t now)
+{
+    if (!base_) {
+        base_ = now;
+    }
+    if (now < base_) {
+        return;
+    }
+
+    uint64_t target = (uint64_t)((now - base_) / resolution_);
+
+    while (current_ <= target) {
+        // There is no timer, jump to the target tick.
+        if (!size_) {
+            current_ = target + 1;
+            break;
         }
 
-        ++_srs_pps_timer->sugar;
+        // Move the timers of higher level to lower levels, when the lower level wraps.
+        int index = (int)(current_ & (SRS_TIMER_WHEEL_ROOT_SIZE - 1));
+        if (!index) {
+            for (int level = 0; level < SRS_TIMER_WHEEL_LEVELS - 1; level++) {
+                if (cascade(level)) {
+                    break;
+                }
+            }
+        }
 
-        for (int i = 0; i < (int)handlers_.size(); i++) {
-            ISrsFastTimer* timer = handlers_.at(i);
+        // The slot might be appended by timers in callback, so we move it to pending and run it.
+        srs_timer_list_splice(&root_[index], &pending_);
+        current_++;
+
+        while (pending_.next != &pending_) {
+            SrsTimerNode* node = pending_.next;
+            ISrsFastTimer* timer = node->timer;
+            srs_utime_t interval = node->interval;
+
+            // Reschedule the periodic timer before callback, so the callback is able to cancel it. If the wheel
+            // falls behind, we tick it once rather than a burst of ticks.
+            srs_timer_list_del(node);
+            if (interval > 0) {
+                node->expires += to_ticks(interval);
+                if (node->expires <= target) {
+                    node->expires = target + to_ticks(interval);
+                }
+                add(node);
+            } else {
+                node->wheel = NULL;
+                node->owner = NULL;
+                size_--;
+            }
 
-            if ((err = timer->on_timer(interval_)) != srs_success) {
+            ++_srs_pps_timer->sugar;
+
+            // Note that the timer might be freed in callback, so never use it after callback.
+            srs_error_t err = timer->on_timer(interval);
+            if (err != srs_success) {
                 srs_freep(err); // Ignore any error for shared timer.
             }
         }
+    }
+}
+
+uint64_t SrsTimerWheel::to_ticks(srs_utime_t v)
+{
+    if (v <= 0) {
+        return 0;
+    }
+    return (uint64_t)((v + resolution_ - 1) / resolution_);
+}
+
+void SrsTimerWheel::add(SrsTimerNode* node)
+{
+    // Never schedule to the ticks already run.
+    if (node->expires < current_) {
+        node->expires = current_;
+    }
+
+    // Clamp the deadline to the max ticks of wheel.
+    uint64_t delta = node->expires - current_;
+    if (delta >= SRS_TIMER_WHEEL_MAX_TICKS) {
+        delta = SRS_TIMER_WHEEL_MAX_TICKS - 1;
+        node->expires = current_ + delta;
+    }
+
+    uint64_t expires = node->expires;
+    if (delta < SRS_TIMER_WHEEL_ROOT_SIZE) {
+        srs_timer_list_add(&root_[expires & (SRS_TIMER_WHEEL_ROOT_SIZE - 1)], node);
+        return;
+    }
+
+    for (int level = 0; level < SRS_TIMER_WHEEL_LEVELS - 1; level++) {
+        int bits = SRS_TIMER_WHEEL_ROOT_BITS + (level + 1) * SRS_TIMER_WHEEL_BITS;
+        if (level == SRS_TIMER_WHEEL_LEVELS - 2 || delta < (1ULL << bits)) {
+            int shift = SRS_TIMER_WHEEL_ROOT_BITS + level * SRS_TIMER_WHEEL_BITS;
+            srs_timer_list_add(&levels_[level][(expires >> shift) & (SRS_TIMER_WHEEL_SIZE - 1)], node);
+            return;
+        }
+    }
+}
+
+int SrsTimerWheel::cascade(int level)
+{
+    int shift = SRS_TIMER_WHEEL_ROOT_BITS + level * SRS_TIMER_WHEEL_BITS;
+    int index = (int)((current_ >> shift) & (SRS_TIMER_WHEEL_SIZE - 1));
+
+    SrsTimerNode slot;
+    srs_timer_list_init(&slot);
+    srs_timer_list_splice(&levels_[level][index], &slot);
 
-        srs_usleep(interval_);
+    while (slot.next != &slot) {
+        SrsTimerNode* node = slot.next;
+        srs_timer_list_del(node);
+        add(node);
+    }
+
+    return index;
+}
+
+srs_error_t SrsTimerWheel::cycle()
+{
+    srs_error_t err = srs_success;
+
+    while (true) {
+        if ((err = trd_->pull()) != srs_success) {
+            return srs_error_wrap(err, "quit");
+        }
+
+        srs_usleep(resolution_);
+
+        advance(srs_update_system_time());
     }
 
     return err;
 }
 
+SrsFastTimer::SrsFastTimer(SrsTimerWheel* wheel, srs_utime_t interval)
+{
+    wheel_ = wheel;
+    interval_ = interval;
+}
+
+SrsFastTimer::~SrsFastTimer()
+{
+}
+
+void SrsFastTimer::subscribe(ISrsFastTimer* timer)
+{
+    SrsTimerNode* node = &timer->timer_node_;
+
+    // Ignore if already subscribed, to keep the deadline of timer.
+    if (node->wheel) {
+        // The timer has only one node, so it's not allowed to subscribe to other fast timer or wheel.
+        srs_assert(node->owner == this);
+        return;
+    }
+
+    wheel_->schedule(timer, interval_);
+    node->owner = this;
+}
+
+void SrsFastTimer::unsubscribe(ISrsFastTimer* timer)
+{
+    // Ignore if not subscribed to this fast timer.
+    if (timer->timer_node_.owner == this) {
+        wheel_->cancel(timer);
+    }
+}
+
+SrsTimerWheel* _srs_timer_wheel = NULL;
+
 SrsClockWallMonitor::SrsClockWallMonitor()
 {
 }
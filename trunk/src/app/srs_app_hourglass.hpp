@@ -16,6 +16,10 @@
 #include <vector>
 
 class SrsCoroutine;
+class ISrsFastTimer;
+class SrsFastTimer;
+class SrsTimerWheel;
+class SrsHourGlassTick;
 
 // The handler for the tick.
 class ISrsHourGlass
@@ -41,7 +45,8 @@ public:
 //          4. Got notify(event=3, time=7)
 //          5. Got notify(event=1, time=9)
 //          6. Got notify(event=2, time=10)
-// It's a complex and high-performance timer.
+// Each tick is a timer of the shared timer wheel, so there is no coroutine for each hourglass.
+// Note that the handler is called by the timer wheel, so it must not block, see SrsTimerWheel.
 //
 // Usage:
 //      SrsHourGlass* hg = new SrsHourGlass("nack", handler, 100 * SRS_UTIME_MILLISECONDS);
@@ -50,22 +55,23 @@ public:
 //      hg->tick(2, 500 * SRS_UTIME_MILLISECONDS);
 //      hg->tick(3, 700 * SRS_UTIME_MILLISECONDS);
 //
-//      // The hg will create a thread for timer.
+//      // The hg will schedule the ticks to timer wheel.
 //      hg->start();
-class SrsHourGlass : public ISrsCoroutineHandler
+class SrsHourGlass
 {
+    friend class SrsHourGlassTick;
 private:
     std::string label_;
-    SrsCoroutine* trd;
     ISrsHourGlass* handler;
     srs_utime_t _resolution;
+    SrsTimerWheel* wheel_;
     // The ticks:
     //      key: the event of tick.
-    //      value: the interval of tick.
-    std::map<int, srs_utime_t> ticks;
-    // The total elapsed time,
-    // for each cycle, we increase it with a resolution.
-    srs_utime_t total_elapse;
+    //      value: the timer of tick.
+    std::map<int, SrsHourGlassTick*> ticks;
+    // Whether started, the tick is scheduled when added.
+    bool started_;
+    srs_utime_t starttime_;
 public:
     // TODO: FIMXE: Refine to SrsHourGlass(std::string label);
     SrsHourGlass(std::string label, ISrsHourGlass* h, srs_utime_t resolution);
@@ -83,47 +89,132 @@ public:
     virtual srs_error_t tick(int event, srs_utime_t interval);
     // Remove the tick by event.
     void untick(int event);
-public:
-    // Cycle the hourglass, which will sleep resolution every time.
-    // and call handler when ticked.
-    virtual srs_error_t cycle();
+private:
+    srs_error_t notify(int event, srs_utime_t interval);
+};
+
+// The node of timer in wheel, embedded in the timer, linked in a slot of wheel.
+struct SrsTimerNode
+{
+    SrsTimerNode* prev;
+    SrsTimerNode* next;
+    // The timer object, NULL for the head of slot.
+    ISrsFastTimer* timer;
+    // The wheel which the timer is scheduled to, NULL if not scheduled.
+    SrsTimerWheel* wheel;
+    // The fast timer which subscribes the timer, NULL if scheduled by wheel directly.
+    SrsFastTimer* owner;
+    // The interval of timer, 0 for one-shot.
+    srs_utime_t interval;
+    // The deadline in ticks of wheel.
+    uint64_t expires;
 };
 
 // The handler for fast timer.
 class ISrsFastTimer
 {
+    friend class SrsTimerWheel;
+    friend class SrsFastTimer;
+private:
+    SrsTimerNode timer_node_;
 public:
     ISrsFastTimer();
+    // Cancel the timer if scheduled, so it's safe to free a timer which is not unsubscribed.
     virtual ~ISrsFastTimer();
 public:
     // Tick when timer is active.
     virtual srs_error_t on_timer(srs_utime_t interval) = 0;
 };
 
-// The fast timer, shared by objects, for high performance.
-// For example, we should never start a timer for each connection or publisher or player,
-// instead, we should start only one fast timer in server.
-class SrsFastTimer : public ISrsCoroutineHandler
+// The levels of timer wheel, the first level is 256 slots, and the others are 64 slots, so the max deadline
+// is 2^26 ticks, that is about 7.7 days for resolution 10ms. The timer is cascaded from higher level to lower
+// level when the lower level wraps, like the timer wheel of Linux kernel.
+#define SRS_TIMER_WHEEL_LEVELS 4
+#define SRS_TIMER_WHEEL_ROOT_BITS 8
+#define SRS_TIMER_WHEEL_BITS 6
+#define SRS_TIMER_WHEEL_ROOT_SIZE (1 << SRS_TIMER_WHEEL_ROOT_BITS)
+#define SRS_TIMER_WHEEL_SIZE (1 << SRS_TIMER_WHEEL_BITS)
+#define SRS_TIMER_WHEEL_MAX_TICKS (1ULL << (SRS_TIMER_WHEEL_ROOT_BITS + (SRS_TIMER_WHEEL_LEVELS - 1) * SRS_TIMER_WHEEL_BITS))
+
+// The hierarchical timer wheel, to schedule a huge number of timers by one coroutine, with O(1) schedule and
+// cancel, and each timer has its own deadline, so the timers of objects are spread over the ticks, rather than
+// all objects are called in the same tick.
+//
+// Note that all timers are called in the coroutine of wheel, so the callback must not block, for example, never
+// do any network or disk IO in callback, which stalls all other timers such as the RTC NACK and TWCC. Start a
+// coroutine for a blocking task instead, see SrsHttpHeartbeat.
+//
+// Usage:
+//      class MyTimer : public ISrsFastTimer {
+//          srs_error_t on_timer(srs_utime_t interval) { ... }
+//      };
+//      wheel->schedule(timer, 20 * SRS_UTIME_MILLISECONDS); // Tick every 20ms.
+//      wheel->cancel(timer);
+class SrsTimerWheel : public ISrsCoroutineHandler
 {
 private:
     SrsCoroutine* trd_;
-    srs_utime_t interval_;
-    std::vector<ISrsFastTimer*> handlers_;
+    srs_utime_t resolution_;
+    // The time of tick 0.
+    srs_utime_t base_;
+    // The next tick to expire.
+    uint64_t current_;
+    // The slots of levels, each slot is a circular list with head.
+    SrsTimerNode root_[SRS_TIMER_WHEEL_ROOT_SIZE];
+    SrsTimerNode levels_[SRS_TIMER_WHEEL_LEVELS - 1][SRS_TIMER_WHEEL_SIZE];
+    // The expired timers to run, which might be cancelled by other timers.
+    SrsTimerNode pending_;
+    // The number of scheduled timers.
+    int size_;
 public:
-    SrsFastTimer(std::string label, srs_utime_t interval);
-    virtual ~SrsFastTimer();
+    SrsTimerWheel(std::string label, srs_utime_t resolution);
+    virtual ~SrsTimerWheel();
 public:
     srs_error_t start();
 public:
-    void subscribe(ISrsFastTimer* timer);
-    void unsubscribe(ISrsFastTimer* timer);
+    // Schedule the timer, to tick every interval, or once if interval is 0, the first tick is after delay. If the
+    // timer is scheduled, it's rescheduled.
+    void schedule(ISrsFastTimer* timer, srs_utime_t interval);
+    void schedule(ISrsFastTimer* timer, srs_utime_t interval, srs_utime_t delay);
+    // Cancel the timer, ignore if not scheduled.
+    void cancel(ISrsFastTimer* timer);
+    // Whether the timer is scheduled by this wheel.
+    bool scheduled(ISrsFastTimer* timer);
+    int size();
+public:
+    // Run the expired timers until now.
+    void advance(srs_utime_t now);
+private:
+    uint64_t to_ticks(srs_utime_t v);
+    void add(SrsTimerNode* node);
+    // Move the timers in slot to lower levels.
+    int cascade(int level);
 // Interface ISrsCoroutineHandler
 private:
-    // Cycle the hourglass, which will sleep resolution every time.
-    // and call handler when ticked.
     virtual srs_error_t cycle();
 };
 
+// The fast timer, shared by objects, for high performance.
+// For example, we should never start a timer for each connection or publisher or player,
+// instead, we subscribe the object to a fast timer, which schedules it to the timer wheel, so each object is
+// ticked by its own deadline, with O(1) subscribe and unsubscribe.
+// Note that a timer object is able to subscribe to only one fast timer, because there is only one node in it.
+class SrsFastTimer
+{
+private:
+    SrsTimerWheel* wheel_;
+    srs_utime_t interval_;
+public:
+    SrsFastTimer(SrsTimerWheel* wheel, srs_utime_t interval);
+    virtual ~SrsFastTimer();
+public:
+    void subscribe(ISrsFastTimer* timer);
+    void unsubscribe(ISrsFastTimer* timer);
+};
+
+// The global timer wheel, for timers and hourglass.
+extern SrsTimerWheel* _srs_timer_wheel;
+
 // To monitor the system wall clock timer deviation.
 class SrsClockWallMonitor : public ISrsFastTimer
 {
@@ -30,12 +30,21 @@ using namespace std;
 #include <srs_protocol_amf0.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_app_coworkers.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_app_log.hpp>
+#ifdef SRS_RTC
+#include <srs_app_rtc_dtls.hpp>
+#include <srs_app_rtc_network.hpp>
+#endif
+#ifdef SRS_FFMPEG_FIT
+#include <srs_app_rtc_codec.hpp>
+#endif
 
 #if defined(__linux__) || defined(SRS_OSX)
 #include <sys/utsname.h>
 #endif
 
-srs_error_t srs_api_response_jsonp(ISrsHttpResponseWriter* w, string callback, string data)
+srs_error_t srs_api_response_jsonp(ISrsHttpResponseWriter* w, string callback, const string& data)
 {
     srs_error_t err = srs_success;
     
@@ -84,7 +93,7 @@ srs_error_t srs_api_response_jsonp_code(ISrsHttpResponseWriter* w, string callba
     return srs_api_response_jsonp(w, callback, obj->dumps());
 }
 
-srs_error_t srs_api_response_json(ISrsHttpResponseWriter* w, string data)
+srs_error_t srs_api_response_json(ISrsHttpResponseWriter* w, const string& data)
 {
     srs_error_t err = srs_success;
     
@@ -122,7 +131,7 @@ srs_error_t srs_api_response_json_code(ISrsHttpResponseWriter* w, srs_error_t co
     return srs_api_response_json(w, obj->dumps());
 }
 
-srs_error_t srs_api_response(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string json)
+srs_error_t srs_api_response(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, const std::string& json)
 {
     // no jsonp, directly response.
     if (!r->is_jsonp()) {
@@ -268,6 +277,7 @@ srs_error_t SrsGoApiV1::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r
     urls->set("clusters", SrsJsonAny::str("origin cluster server API"));
     urls->set("perf", SrsJsonAny::str("System performance stat"));
     urls->set("tcmalloc", SrsJsonAny::str("tcmalloc api with params ?page=summary|api"));
+    urls->set("profiler", SrsJsonAny::str("the built-in CPU profiler, with params ?action=status|start|stop|pprof|contexts|heap"));
 
     SrsJsonObject* tests = SrsJsonAny::object();
     obj->set("tests", tests);
@@ -695,41 +705,40 @@ srs_error_t SrsGoApiVhosts::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessag
         return srs_api_response_code(w, r, ERROR_RTMP_VHOST_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
+    if (!r->is_http_get()) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+    }
     
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
+    string buf;
+    SrsJsonWriter jw(&buf);
     
-    if (r->is_http_get()) {
-        if (!vhost) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("vhosts", data);
-            
-            if ((err = stat->dumps_vhosts(data)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("vhost", data);;
-            
-            if ((err = vhost->dumps(data)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        }
+    jw.begin_object();
+    jw.field_integer("code", ERROR_SUCCESS);
+    jw.field_str("server", stat->server_id());
+    
+    if (!vhost) {
+        jw.begin_array("vhosts");
+        err = stat->dumps_vhosts(&jw);
+        jw.end_array();
     } else {
-        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+        jw.key("vhost");
+        err = vhost->dumps(&jw);
     }
     
-    return srs_api_response(w, r, obj->dumps());
+    if (err != srs_success) {
+        int code = srs_error_code(err);
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
+    
+    jw.end_object();
+    
+    return srs_api_response(w, r, buf);
 }
 
 SrsGoApiStreams::SrsGoApiStreams()
 {
+    capacity_ = 0;
 }
 
 SrsGoApiStreams::~SrsGoApiStreams()
@@ -751,45 +760,49 @@ srs_error_t SrsGoApiStreams::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_STREAM_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
-    
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
+    if (!r->is_http_get()) {
+        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+    }
     
-    if (r->is_http_get()) {
-        if (!stream) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("streams", data);
-
-            std::string rstart = r->query_get("start");
-            std::string rcount = r->query_get("count");
-            int start = srs_max(0, atoi(rstart.c_str()));
-            int count = srs_max(10, atoi(rcount.c_str()));
-            if ((err = stat->dumps_streams(data, start, count)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("stream", data);;
-            
-            if ((err = stream->dumps(data)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        }
+    // Write the json to buffer by streaming writer, without the tree of json objects, reserved by the size of
+    // largest response, so we avoid the reallocations for lots of streams.
+    string buf;
+    buf.reserve(capacity_);
+    SrsJsonWriter jw(&buf);
+    
+    jw.begin_object();
+    jw.field_integer("code", ERROR_SUCCESS);
+    jw.field_str("server", stat->server_id());
+    
+    if (!stream) {
+        std::string rstart = r->query_get("start");
+        std::string rcount = r->query_get("count");
+        int start = srs_max(0, atoi(rstart.c_str()));
+        int count = srs_max(10, atoi(rcount.c_str()));
+        
+        jw.begin_array("streams");
+        err = stat->dumps_streams(&jw, start, count);
+        jw.end_array();
     } else {
-        return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
+        jw.key("stream");
+        err = stream->dumps(&jw);
     }
     
-    return srs_api_response(w, r, obj->dumps());
+    if (err != srs_success) {
+        int code = srs_error_code(err);
+        srs_error_reset(err);
+        return srs_api_response_code(w, r, code);
+    }
+    
+    jw.end_object();
+    capacity_ = srs_max(capacity_, buf.length());
+    
+    return srs_api_response(w, r, buf);
 }
 
 SrsGoApiClients::SrsGoApiClients()
 {
+    capacity_ = 0;
 }
 
 SrsGoApiClients::~SrsGoApiClients()
@@ -811,35 +824,35 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_api_response_code(w, r, ERROR_RTMP_CLIENT_NOT_FOUND);
     }
     
-    SrsJsonObject* obj = SrsJsonAny::object();
-    SrsAutoFree(SrsJsonObject, obj);
+    // Write the json to buffer by streaming writer, without the tree of json objects, reserved by the size of
+    // largest response, so we avoid the reallocations for lots of clients.
+    string buf;
+    buf.reserve(capacity_);
+    SrsJsonWriter jw(&buf);
     
-    obj->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
-    obj->set("server", SrsJsonAny::str(stat->server_id().c_str()));
+    jw.begin_object();
+    jw.field_integer("code", ERROR_SUCCESS);
+    jw.field_str("server", stat->server_id());
     
     if (r->is_http_get()) {
         if (!client) {
-            SrsJsonArray* data = SrsJsonAny::array();
-            obj->set("clients", data);
-            
             std::string rstart = r->query_get("start");
             std::string rcount = r->query_get("count");
             int start = srs_max(0, atoi(rstart.c_str()));
             int count = srs_max(10, atoi(rcount.c_str()));
-            if ((err = stat->dumps_clients(data, start, count)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
-        } else {
-            SrsJsonObject* data = SrsJsonAny::object();
-            obj->set("client", data);;
             
-            if ((err = client->dumps(data)) != srs_success) {
-                int code = srs_error_code(err);
-                srs_error_reset(err);
-                return srs_api_response_code(w, r, code);
-            }
+            jw.begin_array("clients");
+            err = stat->dumps_clients(&jw, start, count);
+            jw.end_array();
+        } else {
+            jw.key("client");
+            err = client->dumps(&jw);
+        }
+        
+        if (err != srs_success) {
+            int code = srs_error_code(err);
+            srs_error_reset(err);
+            return srs_api_response_code(w, r, code);
         }
     } else if (r->is_http_delete()) {
         if (!client) {
@@ -857,7 +870,10 @@ srs_error_t SrsGoApiClients::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
         return srs_go_http_error(w, SRS_CONSTS_HTTP_MethodNotAllowed);
     }
     
-    return srs_api_response(w, r, obj->dumps());
+    jw.end_object();
+    capacity_ = srs_max(capacity_, buf.length());
+    
+    return srs_api_response(w, r, buf);
 }
 
 SrsGoApiRaw::SrsGoApiRaw(SrsServer* svr)
@@ -1069,19 +1085,183 @@ srs_error_t SrsGoApiTcmalloc::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMess
 #endif
 
 
+// The default and max sampling frequency of CPU profiler, in Hz.
+#define SRS_PROFILER_FREQUENCY 100
+#define SRS_PROFILER_MAX_FREQUENCY 1000
+// The default and max samples of CPU profiler, about 280B per sample.
+#define SRS_PROFILER_SAMPLES 30000
+#define SRS_PROFILER_MAX_SAMPLES 300000
+// The max seconds to profile for pprof.
+#define SRS_PROFILER_MAX_SECONDS 300
+
+SrsGoApiProfiler::SrsGoApiProfiler()
+{
+    enabled_ = _srs_config->get_profiler_enabled();
+}
+
+SrsGoApiProfiler::~SrsGoApiProfiler()
+{
+}
+
+srs_error_t SrsGoApiProfiler::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = do_serve_http(w, r);
+    if (err != srs_success) {
+        srs_warn("profiler: serve err %s", srs_error_desc(err).c_str());
+        int code = srs_error_code(err);
+        srs_freep(err);
+        return srs_api_response_code(w, r, code);
+    }
+    return err;
+}
+
+srs_error_t SrsGoApiProfiler::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+
+    if (!enabled_) {
+        return srs_error_new(ERROR_PROFILER_DISABLED, "disabled");
+    }
+
+    SrsCpuProfiler* profiler = srs_get_cpu_profiler();
+    string action = r->query_get("action");
+
+    if (action == "start") {
+        int frequency = SRS_PROFILER_FREQUENCY, max_samples = SRS_PROFILER_SAMPLES;
+        if (!r->query_get("frequency").empty()) {
+            frequency = srs_min(SRS_PROFILER_MAX_FREQUENCY, ::atoi(r->query_get("frequency").c_str()));
+        }
+        if (!r->query_get("max_samples").empty()) {
+            max_samples = srs_min(SRS_PROFILER_MAX_SAMPLES, ::atoi(r->query_get("max_samples").c_str()));
+        }
+
+        if ((err = profiler->start(frequency, max_samples)) != srs_success) {
+            return srs_error_wrap(err, "start");
+        }
+        srs_trace("profiler: start frequency=%d, max_samples=%d", frequency, max_samples);
+    } else if (action == "stop") {
+        profiler->stop();
+        srs_trace("profiler: stop samples=%d, dropped=%d", profiler->nn_samples(), profiler->nn_dropped());
+    } else if (action == "pprof") {
+        return serve_pprof(w, r);
+    } else if (action == "heap") {
+        return serve_text(w, srs_get_heap_snapshot(), "text/plain; charset=utf-8");
+    } else if (!action.empty() && action != "status" && action != "contexts") {
+        return srs_error_new(ERROR_PROFILER_ACTION, "invalid action %s", action.c_str());
+    }
+
+    // The samples are written by signal handler when running, so never dump them.
+    if (action == "contexts" && profiler->started()) {
+        return srs_error_new(ERROR_PROFILER_RUNNING, "dump contexts");
+    }
+
+    // Response the status and top contexts in json.
+    string buf;
+    SrsJsonWriter jw(&buf);
+
+    jw.begin_object();
+    jw.field_integer("code", ERROR_SUCCESS);
+    jw.field_str("server", SrsStatistic::instance()->server_id());
+
+    jw.begin_object("data");
+    jw.field_boolean("started", profiler->started());
+    jw.field_integer("samples", profiler->nn_samples());
+    jw.field_integer("dropped", profiler->nn_dropped());
+    jw.field_integer("duration", srsu2ms(profiler->duration()));
+
+    if (action == "contexts") {
+        int count = 10;
+        if (!r->query_get("count").empty()) {
+            count = srs_max(1, ::atoi(r->query_get("count").c_str()));
+        }
+
+        jw.key("contexts");
+        profiler->dumps_contexts(&jw, count);
+    }
+    jw.end_object();
+
+    jw.field_str("help", "?action=status|start|stop|pprof|contexts|heap");
+    jw.end_object();
+
+    return srs_api_response(w, r, buf);
+}
+
+srs_error_t SrsGoApiProfiler::serve_pprof(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+
+    SrsCpuProfiler* profiler = srs_get_cpu_profiler();
+
+    // Profile for the specified seconds, or dump the last profile.
+    int seconds = ::atoi(r->query_get("seconds").c_str());
+    if (seconds > 0) {
+        seconds = srs_min(SRS_PROFILER_MAX_SECONDS, seconds);
+
+        int frequency = SRS_PROFILER_FREQUENCY;
+        if (!r->query_get("frequency").empty()) {
+            frequency = srs_min(SRS_PROFILER_MAX_FREQUENCY, ::atoi(r->query_get("frequency").c_str()));
+        }
+        int max_samples = srs_min(SRS_PROFILER_MAX_SAMPLES, frequency * seconds);
+
+        if ((err = profiler->start(frequency, max_samples)) != srs_success) {
+            return srs_error_wrap(err, "start");
+        }
+
+        srs_trace("profiler: pprof frequency=%d, seconds=%d", frequency, seconds);
+        srs_usleep(seconds * SRS_UTIME_SECONDS);
+        profiler->stop();
+    }
+
+    // The samples are written by signal handler when running, so never dump them.
+    if (profiler->started()) {
+        return srs_error_new(ERROR_PROFILER_RUNNING, "dump pprof");
+    }
+
+    string buf;
+    profiler->dumps_pprof(buf);
+
+    return serve_text(w, buf, "application/octet-stream");
+}
+
+srs_error_t SrsGoApiProfiler::serve_text(ISrsHttpResponseWriter* w, const string& data, const char* content_type)
+{
+    srs_error_t err = srs_success;
+
+    w->header()->set_content_type(content_type);
+    w->header()->set_content_length(data.length());
+    w->write_header(SRS_CONSTS_HTTP_OK);
+
+    if ((err = w->write((char*)data.data(), (int)data.length())) != srs_success) {
+        return srs_error_wrap(err, "write");
+    }
+
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+
+    return err;
+}
+
 SrsGoApiMetrics::SrsGoApiMetrics()
 {
     enabled_ = _srs_config->get_exporter_enabled();
     label_ = _srs_config->get_exporter_label();
     tag_ = _srs_config->get_exporter_tag();
+    max_streams_ = _srs_config->get_exporter_max_streams();
 }
 
 SrsGoApiMetrics::~SrsGoApiMetrics()
 {
+    for (int i = 0; i < (int)buffers_.size(); i++) {
+        string* buf = buffers_.at(i);
+        srs_freep(buf);
+    }
 }
 
 srs_error_t SrsGoApiMetrics::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
+    srs_error_t err = srs_success;
+
     // whether enabled the HTTP Metrics API.
     if (!enabled_) {
         return srs_api_response_code(w, r, ERROR_EXPORTER_DISABLED);
@@ -1098,6 +1278,10 @@ srs_error_t SrsGoApiMetrics::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
      * clients gauge
      * clients_total counter
      * error counter
+     * http_file_cache counter/gauge
+     * hls_worker counter/gauge
+     * vhost gauge, with label vhost
+     * stream counter/gauge, with labels vhost, app and stream, only the top streams by kbps
     */
 
     SrsStatistic* stat = SrsStatistic::instance();
@@ -1193,7 +1377,168 @@ srs_error_t SrsGoApiMetrics::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessa
        << nerrs
        << "\n";
 
+    // The cache for hot small files of HTTP server.
+    if (_srs_http_file_cache && _srs_http_file_cache->enabled()) {
+        ss << "# HELP srs_http_file_cache_hits_total The total hits of HTTP file cache.\n"
+           << "# TYPE srs_http_file_cache_hits_total counter\n"
+           << "srs_http_file_cache_hits_total "
+           << _srs_http_file_cache->hits()
+           << "\n";
+
+        ss << "# HELP srs_http_file_cache_misses_total The total misses of HTTP file cache.\n"
+           << "# TYPE srs_http_file_cache_misses_total counter\n"
+           << "srs_http_file_cache_misses_total "
+           << _srs_http_file_cache->misses()
+           << "\n";
+
+        ss << "# HELP srs_http_file_cache_evicts_total The total evicted files of HTTP file cache.\n"
+           << "# TYPE srs_http_file_cache_evicts_total counter\n"
+           << "srs_http_file_cache_evicts_total "
+           << _srs_http_file_cache->evicts()
+           << "\n";
+
+        ss << "# HELP srs_http_file_cache_hit_ratio The hit ratio of HTTP file cache.\n"
+           << "# TYPE srs_http_file_cache_hit_ratio gauge\n"
+           << "srs_http_file_cache_hit_ratio "
+           << _srs_http_file_cache->hit_ratio()
+           << "\n";
+
+        ss << "# HELP srs_http_file_cache_bytes The bytes of files in HTTP file cache.\n"
+           << "# TYPE srs_http_file_cache_bytes gauge\n"
+           << "srs_http_file_cache_bytes "
+           << _srs_http_file_cache->size()
+           << "\n";
+    }
+
+    // The logs dropped by async log, because the ring of thread is full, and the bytes written.
+    SrsFileLog* log = dynamic_cast<SrsFileLog*>(_srs_log);
+    if (log && _srs_config->get_log_async()) {
+        ss << "# HELP srs_log_dropped_total The total logs dropped because the ring of async log is full.\n"
+           << "# TYPE srs_log_dropped_total counter\n"
+           << "srs_log_dropped_total " << log->dropped() << "\n";
+
+        ss << "# HELP srs_log_written_bytes_total The total bytes written by the flusher of async log.\n"
+           << "# TYPE srs_log_written_bytes_total counter\n"
+           << "srs_log_written_bytes_total " << log->flushed() << "\n";
+    }
+
+    // The workers to mux HLS streams, labeled by worker id.
+    vector<SrsThreadWorker*> hls_workers = _srs_hls_mux_pool? _srs_hls_mux_pool->workers() : vector<SrsThreadWorker*>();
+    if (!hls_workers.empty()) {
+        ss << "# HELP srs_hls_worker_queue_depth The number of frames in queue of HLS worker.\n"
+           << "# TYPE srs_hls_worker_queue_depth gauge\n";
+        for (int i = 0; i < (int)hls_workers.size(); i++) {
+            SrsThreadWorker* worker = hls_workers.at(i);
+            ss << "srs_hls_worker_queue_depth{worker=\"" << worker->id() << "\"} " << worker->depth() << "\n";
+        }
+
+        ss << "# HELP srs_hls_worker_frames_total The total frames written by HLS worker.\n"
+           << "# TYPE srs_hls_worker_frames_total counter\n";
+        for (int i = 0; i < (int)hls_workers.size(); i++) {
+            SrsThreadWorker* worker = hls_workers.at(i);
+            ss << "srs_hls_worker_frames_total{worker=\"" << worker->id() << "\"} " << worker->tasks() << "\n";
+        }
+
+        ss << "# HELP srs_hls_worker_queue_full_total The total times that queue of HLS worker is full.\n"
+           << "# TYPE srs_hls_worker_queue_full_total counter\n";
+        for (int i = 0; i < (int)hls_workers.size(); i++) {
+            SrsThreadWorker* worker = hls_workers.at(i);
+            ss << "srs_hls_worker_queue_full_total{worker=\"" << worker->id() << "\"} " << worker->full() << "\n";
+        }
+    }
+
+#ifdef SRS_FFMPEG_FIT
+    // The workers to transcode audio of RTC bridges, labeled by worker id.
+    vector<SrsThreadWorker*> audio_workers = _srs_audio_transcode_pool? _srs_audio_transcode_pool->workers() : vector<SrsThreadWorker*>();
+    if (!audio_workers.empty()) {
+        ss << "# HELP srs_audio_worker_queue_depth The number of frames in queue of audio transcode worker.\n"
+           << "# TYPE srs_audio_worker_queue_depth gauge\n";
+        for (int i = 0; i < (int)audio_workers.size(); i++) {
+            SrsThreadWorker* worker = audio_workers.at(i);
+            ss << "srs_audio_worker_queue_depth{worker=\"" << worker->id() << "\"} " << worker->depth() << "\n";
+        }
+
+        ss << "# HELP srs_audio_worker_frames_total The total frames transcoded by audio worker.\n"
+           << "# TYPE srs_audio_worker_frames_total counter\n";
+        for (int i = 0; i < (int)audio_workers.size(); i++) {
+            SrsThreadWorker* worker = audio_workers.at(i);
+            ss << "srs_audio_worker_frames_total{worker=\"" << worker->id() << "\"} " << worker->tasks() << "\n";
+        }
+    }
+#endif
+
+#ifdef SRS_RTC
+    // The DTLS handshakes, and the latency percentiles of recent handshakes.
+    if (_srs_dtls_stat) {
+        ss << "# HELP srs_dtls_handshakes_total The total DTLS handshakes done, and resumed by session.\n"
+           << "# TYPE srs_dtls_handshakes_total counter\n"
+           << "srs_dtls_handshakes_total{resumed=\"false\"} " << _srs_dtls_stat->handshakes() - _srs_dtls_stat->resumed() << "\n"
+           << "srs_dtls_handshakes_total{resumed=\"true\"} " << _srs_dtls_stat->resumed() << "\n";
+
+        ss << "# HELP srs_dtls_handshaking The number of DTLS handshakes in progress, including the queued ones.\n"
+           << "# TYPE srs_dtls_handshaking gauge\n"
+           << "srs_dtls_handshaking " << _srs_dtls_stat->handshaking() << "\n";
+
+        ss << "# HELP srs_dtls_handshake_latency_ms The latency in ms of recent DTLS handshakes.\n"
+           << "# TYPE srs_dtls_handshake_latency_ms summary\n";
+        double quantiles[] = {0.5, 0.9, 0.99};
+        for (int i = 0; i < (int)(sizeof(quantiles) / sizeof(double)); i++) {
+            ss << "srs_dtls_handshake_latency_ms{quantile=\"" << quantiles[i] << "\"} "
+               << srsu2msi(_srs_dtls_stat->percentile(quantiles[i])) << "\n";
+        }
+    }
+
+    // The workers to handshake DTLS, labeled by worker id.
+    vector<SrsThreadWorker*> dtls_workers = _srs_dtls_worker_pool? _srs_dtls_worker_pool->workers() : vector<SrsThreadWorker*>();
+    if (!dtls_workers.empty()) {
+        ss << "# HELP srs_dtls_worker_queue_depth The number of packets in queue of DTLS worker.\n"
+           << "# TYPE srs_dtls_worker_queue_depth gauge\n";
+        for (int i = 0; i < (int)dtls_workers.size(); i++) {
+            SrsThreadWorker* worker = dtls_workers.at(i);
+            ss << "srs_dtls_worker_queue_depth{worker=\"" << worker->id() << "\"} " << worker->depth() << "\n";
+        }
+
+        ss << "# HELP srs_dtls_worker_packets_total The total DTLS packets handled by worker.\n"
+           << "# TYPE srs_dtls_worker_packets_total counter\n";
+        for (int i = 0; i < (int)dtls_workers.size(); i++) {
+            SrsThreadWorker* worker = dtls_workers.at(i);
+            ss << "srs_dtls_worker_packets_total{worker=\"" << worker->id() << "\"} " << worker->tasks() << "\n";
+        }
+    }
+
+    // The RTCP packets sent by batch, and the syscalls to send them.
+    if (_srs_rtcp_batch) {
+        ss << "# HELP srs_rtcp_batch_packets_total The total RTCP packets sent by batch.\n"
+           << "# TYPE srs_rtcp_batch_packets_total counter\n"
+           << "srs_rtcp_batch_packets_total " << _srs_rtcp_batch->packets() << "\n";
+
+        ss << "# HELP srs_rtcp_batch_syscalls_total The total syscalls to send the RTCP packets by batch.\n"
+           << "# TYPE srs_rtcp_batch_syscalls_total counter\n"
+           << "srs_rtcp_batch_syscalls_total " << _srs_rtcp_batch->syscalls() << "\n";
+    }
+#endif
+
+    // Render the metrics of vhosts and streams to a reused buffer, which grows only when there are more streams,
+    // so we avoid the reallocations for lots of streams. The buffer is taken by this scrape until written, so the
+    // concurrent scrapes use different buffers.
+    string* buf = NULL;
+    if (buffers_.empty()) {
+        buf = new string();
+    } else {
+        buf = buffers_.back();
+        buffers_.pop_back();
+    }
+    buf->assign(ss.str());
+    stat->dumps_metrics_streams(*buf, max_streams_);
+
     w->header()->set_content_type("text/plain; charset=utf-8");
+    w->header()->set_content_length(buf->length());
+
+    err = w->write((char*)buf->data(), (int)buf->length());
+    buffers_.push_back(buf);
+    if (err != srs_success) {
+        return srs_error_wrap(err, "write metrics");
+    }
 
-    return srs_api_response(w, r, ss.str());
+    return err;
 }
@@ -21,6 +21,7 @@ class ISrsHttpResponseWriter;
 class SrsHttpConn;
 
 #include <string>
+#include <vector>
 
 #include <srs_app_st.hpp>
 #include <srs_app_conn.hpp>
@@ -28,7 +29,7 @@ class SrsHttpConn;
 #include <srs_app_reload.hpp>
 #include <srs_app_http_conn.hpp>
 
-extern srs_error_t srs_api_response(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string json);
+extern srs_error_t srs_api_response(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, const std::string& json);
 extern srs_error_t srs_api_response_code(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, int code);
 extern srs_error_t srs_api_response_code(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, srs_error_t code);
 
@@ -152,6 +153,9 @@ public:
 
 class SrsGoApiStreams : public ISrsHttpHandler
 {
+private:
+    // The size of buffer to write json, grows by the size of responses.
+    size_t capacity_;
 public:
     SrsGoApiStreams();
     virtual ~SrsGoApiStreams();
@@ -161,6 +165,9 @@ public:
 
 class SrsGoApiClients : public ISrsHttpHandler
 {
+private:
+    // The size of buffer to write json, grows by the size of responses.
+    size_t capacity_;
 public:
     SrsGoApiClients();
     virtual ~SrsGoApiClients();
@@ -216,12 +223,36 @@ public:
 };
 #endif
 
+// The API for the built-in CPU profiler, for example:
+//      curl 'http://127.0.0.1:1985/api/v1/profiler?action=start&frequency=100'
+//      curl 'http://127.0.0.1:1985/api/v1/profiler?action=stop'
+//      curl 'http://127.0.0.1:1985/api/v1/profiler?action=pprof' -o srs.prof
+class SrsGoApiProfiler : public ISrsHttpHandler
+{
+private:
+    bool enabled_;
+public:
+    SrsGoApiProfiler();
+    virtual ~SrsGoApiProfiler();
+public:
+    virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+private:
+    srs_error_t do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+    srs_error_t serve_pprof(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
+    srs_error_t serve_text(ISrsHttpResponseWriter* w, const std::string& data, const char* content_type);
+};
+
 class SrsGoApiMetrics : public ISrsHttpHandler
 {
 private:
     bool enabled_;
     std::string label_;
     std::string tag_;
+    // The max number of streams to export metrics.
+    int max_streams_;
+    // The idle buffers to render metrics, reused by scrapes. A buffer is taken by a scrape until written,
+    // because the write might yield to other coroutines which serve another scrape.
+    std::vector<std::string*> buffers_;
 public:
     SrsGoApiMetrics();
     virtual ~SrsGoApiMetrics();
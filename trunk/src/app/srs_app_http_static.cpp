@@ -38,6 +38,8 @@ using namespace std;
 #include <srs_app_statistic.hpp>
 #include <srs_app_hybrid.hpp>
 #include <srs_protocol_log.hpp>
+#include <srs_kernel_mp4.hpp>
+#include <srs_kernel_stream.hpp>
 
 #define SRS_CONTEXT_IN_HLS "hls_ctx"
 
@@ -347,8 +349,130 @@ srs_error_t SrsHlsStream::on_timer(srs_utime_t interval)
     return err;
 }
 
+SrsMp4IndexCacheEntry::SrsMp4IndexCacheEntry()
+{
+    mtime = 0;
+    size = 0;
+    index = NULL;
+}
+
+SrsMp4IndexCacheEntry::~SrsMp4IndexCacheEntry()
+{
+    srs_freep(index);
+}
+
+SrsMp4IndexCache* _srs_mp4_index_cache = NULL;
+
+SrsMp4IndexCache::SrsMp4IndexCache()
+{
+    enabled_ = false;
+    max_files_ = 0;
+
+    nn_hits_ = 0;
+    nn_misses_ = 0;
+}
+
+SrsMp4IndexCache::~SrsMp4IndexCache()
+{
+    while (!lru_.empty()) {
+        erase(lru_.begin());
+    }
+}
+
+void SrsMp4IndexCache::initialize(bool enabled, int max_files)
+{
+    while (!lru_.empty()) {
+        erase(lru_.begin());
+    }
+
+    enabled_ = enabled && max_files > 0;
+    max_files_ = max_files;
+}
+
+bool SrsMp4IndexCache::enabled()
+{
+    return enabled_;
+}
+
+SrsMp4VodIndex* SrsMp4IndexCache::fetch(string path, srs_utime_t mtime, int64_t size)
+{
+    std::map<std::string, std::list<SrsMp4IndexCacheEntry*>::iterator>::iterator it = entries_.find(path);
+    if (it == entries_.end()) {
+        nn_misses_++;
+        return NULL;
+    }
+
+    // The file is changed, for example, the DVR file is rewritten, remove the stale entry.
+    std::list<SrsMp4IndexCacheEntry*>::iterator pos = it->second;
+    SrsMp4IndexCacheEntry* entry = *pos;
+    if (entry->mtime != mtime || entry->size != size) {
+        erase(pos);
+        nn_misses_++;
+        return NULL;
+    }
+
+    // Move to front, as the most recently used entry.
+    if (pos != lru_.begin()) {
+        lru_.splice(lru_.begin(), lru_, pos);
+    }
+
+    nn_hits_++;
+    return entry->index;
+}
+
+void SrsMp4IndexCache::store(string path, srs_utime_t mtime, int64_t size, SrsMp4VodIndex* index)
+{
+    SrsMp4IndexCacheEntry* entry = new SrsMp4IndexCacheEntry();
+    entry->path = path;
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->index = index;
+
+    // Remove the stale entry of path, which might be stored by other coroutine.
+    std::map<std::string, std::list<SrsMp4IndexCacheEntry*>::iterator>::iterator it = entries_.find(path);
+    if (it != entries_.end()) {
+        erase(it->second);
+    }
+
+    // Evict the least recently used entries.
+    while (!lru_.empty() && (int)lru_.size() >= max_files_) {
+        std::list<SrsMp4IndexCacheEntry*>::iterator last = lru_.end();
+        erase(--last);
+    }
+
+    lru_.push_front(entry);
+    entries_[path] = lru_.begin();
+}
+
+void SrsMp4IndexCache::erase(std::list<SrsMp4IndexCacheEntry*>::iterator it)
+{
+    SrsMp4IndexCacheEntry* entry = *it;
+
+    entries_.erase(entry->path);
+    lru_.erase(it);
+
+    srs_freep(entry);
+}
+
+int64_t SrsMp4IndexCache::hits()
+{
+    return nn_hits_;
+}
+
+int64_t SrsMp4IndexCache::misses()
+{
+    return nn_misses_;
+}
+
+int SrsMp4IndexCache::count()
+{
+    return (int)lru_.size();
+}
+
 SrsVodStream::SrsVodStream(string root_dir) : SrsHttpFileServer(root_dir)
 {
+    set_sendfile(_srs_config->get_http_stream_sendfile());
+    set_file_cache(_srs_http_file_cache);
 }
 
 SrsVodStream::~SrsVodStream()
@@ -486,6 +610,104 @@ srs_error_t SrsVodStream::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMe
     return err;
 }
 
+srs_error_t SrsVodStream::serve_mp4_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, srs_utime_t start)
+{
+    srs_error_t err = srs_success;
+
+    SrsFileReader* fs = fs_factory->create_file_reader();
+    SrsAutoFree(SrsFileReader, fs);
+
+    if ((err = fs->open(fullpath)) != srs_success) {
+        return srs_error_wrap(err, "fs open");
+    }
+
+    srs_utime_t mtime = 0;
+    int64_t filesize = 0;
+    if (!srs_http_fs_stat(fullpath, &mtime, &filesize)) {
+        filesize = fs->filesize();
+    }
+
+    // Parse the moov only once for each file, if cache is enabled.
+    SrsMp4VodIndex* index = NULL;
+    if (_srs_mp4_index_cache->enabled()) {
+        index = _srs_mp4_index_cache->fetch(fullpath, mtime, filesize);
+    }
+
+    SrsMp4VodIndex* parsed = NULL;
+    SrsAutoFree(SrsMp4VodIndex, parsed);
+
+    if (!index) {
+        srs_utime_t starttime = srs_update_system_time();
+
+        parsed = new SrsMp4VodIndex();
+        if ((err = parsed->initialize(fs)) != srs_success) {
+            return srs_error_wrap(err, "parse mp4 %s", fullpath.c_str());
+        }
+
+        srs_trace("mp4: parse index of %s, samples=%d, bytes=%" PRId64 ", duration=%dms, cost=%dms", fullpath.c_str(),
+            parsed->nb_samples(), parsed->nb_bytes(), srsu2msi(parsed->duration()), srsu2msi(srs_update_system_time() - starttime));
+
+        index = parsed;
+        if (_srs_mp4_index_cache->enabled()) {
+            _srs_mp4_index_cache->store(fullpath, mtime, filesize, parsed);
+            parsed = NULL;
+        }
+    }
+
+    // Build the header of trimmed mp4, the index might be freed when coroutine yields.
+    SrsSimpleStream header;
+    uint64_t offset = 0, size = 0;
+    if ((err = index->seek(start, &header, &offset, &size)) != srs_success) {
+        return srs_error_wrap(err, "seek mp4 %s to %dms", fullpath.c_str(), srsu2msi(start));
+    }
+    index = NULL;
+
+    // The trimmed mp4 is header and the range of file, we also support byte range of it.
+    int64_t nb_header = header.length();
+    int64_t length = nb_header + (int64_t)size;
+    int64_t range_start = 0, range_end = -1;
+    bool has_range = srs_http_parse_range(r, &range_start, &range_end);
+    if (range_end == -1 || range_end >= length) {
+        range_end = length - 1;
+    }
+    if (range_start > range_end) {
+        return srs_error_new(ERROR_HTTP_REMUX_OFFSET_OVERFLOW, "http mp4 seeking %s overflow. size=%" PRId64 ", offset=%" PRId64,
+            fullpath.c_str(), length, range_start);
+    }
+
+    w->header()->set_content_length(range_end - range_start + 1);
+    w->header()->set_content_type("video/mp4");
+    if (has_range) {
+        std::stringstream content_range;
+        content_range << "bytes " << range_start << "-" << range_end << "/" << length;
+        w->header()->set("Content-Range", content_range.str());
+        w->write_header(SRS_CONSTS_HTTP_PartialContent);
+    } else {
+        w->write_header(SRS_CONSTS_HTTP_OK);
+    }
+
+    // Write the part of header in range.
+    if (range_start < nb_header) {
+        int64_t nn = srs_min(range_end + 1, nb_header) - range_start;
+        if ((err = w->write(header.bytes() + range_start, (int)nn)) != srs_success) {
+            return srs_error_wrap(err, "write header");
+        }
+    }
+
+    // Write the part of samples in range.
+    if (range_end >= nb_header) {
+        int64_t pos = srs_max(range_start, nb_header) - nb_header;
+        int64_t left = range_end + 1 - nb_header - pos;
+
+        fs->seek2((int64_t)offset + pos);
+        if ((err = copy(w, fs, r, left)) != srs_success) {
+            return srs_error_wrap(err, "read mp4=%s size=%" PRId64, fullpath.c_str(), left);
+        }
+    }
+
+    return err;
+}
+
 srs_error_t SrsVodStream::serve_m3u8_ctx(ISrsHttpResponseWriter * w, ISrsHttpMessage * r, std::string fullpath)
 {
     srs_error_t err = srs_success;
@@ -553,6 +775,24 @@ SrsHttpStaticServer::~SrsHttpStaticServer()
 srs_error_t SrsHttpStaticServer::initialize()
 {
     srs_error_t err = srs_success;
+
+    // Setup the cache for hot small files, shared by all vhosts.
+    if (true) {
+        bool enabled = _srs_config->get_http_stream_file_cache_enabled();
+        int64_t max_size = _srs_config->get_http_stream_file_cache_max_size();
+        int64_t max_file_size = _srs_config->get_http_stream_file_cache_max_file_size();
+        _srs_http_file_cache->initialize(enabled, max_size, max_file_size);
+        srs_trace("http: sendfile=%d, file cache enabled=%d, max_size=%" PRId64 ", max_file_size=%" PRId64,
+            _srs_config->get_http_stream_sendfile(), enabled, max_size, max_file_size);
+    }
+
+    // Setup the cache for index of MP4 VOD files, shared by all vhosts.
+    if (true) {
+        bool enabled = _srs_config->get_http_stream_mp4_index_enabled();
+        int max_files = _srs_config->get_http_stream_mp4_index_max_files();
+        _srs_mp4_index_cache->initialize(enabled, max_files);
+        srs_trace("http: mp4 index cache enabled=%d, max_files=%d", enabled, max_files);
+    }
     
     bool default_root_exists = false;
     
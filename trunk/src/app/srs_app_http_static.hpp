@@ -11,7 +11,10 @@
 
 #include <srs_app_http_conn.hpp>
 
+#include <list>
+
 class ISrsFileReaderFactory;
+class SrsMp4VodIndex;
 
 struct SrsM3u8CtxInfo
 {
@@ -45,6 +48,58 @@ private:
     srs_error_t on_timer(srs_utime_t interval);
 };
 
+// The cached index of MP4 file, which is valid only when the mtime and size of file is not changed.
+class SrsMp4IndexCacheEntry
+{
+public:
+    std::string path;
+    srs_utime_t mtime;
+    int64_t size;
+    SrsMp4VodIndex* index;
+public:
+    SrsMp4IndexCacheEntry();
+    virtual ~SrsMp4IndexCacheEntry();
+};
+
+// The LRU cache for index of MP4 VOD files, so that the seeking requests never parse the moov again,
+// which might be some MB for a long MP4 file. The entry is keyed by path, and validated by the mtime
+// and size of file.
+class SrsMp4IndexCache
+{
+private:
+    bool enabled_;
+    // The max number of cached files.
+    int max_files_;
+    // The most recently used entry is at front.
+    std::list<SrsMp4IndexCacheEntry*> lru_;
+    std::map<std::string, std::list<SrsMp4IndexCacheEntry*>::iterator> entries_;
+private:
+    int64_t nn_hits_;
+    int64_t nn_misses_;
+public:
+    SrsMp4IndexCache();
+    virtual ~SrsMp4IndexCache();
+public:
+    // Setup the cache, and clear all cached indexes.
+    virtual void initialize(bool enabled, int max_files);
+    virtual bool enabled();
+    // Fetch the index of file, NULL if not cached or changed.
+    // @remark The index is owned by cache, user must use it before the coroutine yields.
+    virtual SrsMp4VodIndex* fetch(std::string path, srs_utime_t mtime, int64_t size);
+    // Cache the index of file, and evict the least recently used ones if exceed the max files.
+    // @remark The index is owned by cache, user should never free it.
+    virtual void store(std::string path, srs_utime_t mtime, int64_t size, SrsMp4VodIndex* index);
+private:
+    void erase(std::list<SrsMp4IndexCacheEntry*>::iterator it);
+public:
+    virtual int64_t hits();
+    virtual int64_t misses();
+    virtual int count();
+};
+
+// The global MP4 index cache, shared by all vhosts.
+extern SrsMp4IndexCache* _srs_mp4_index_cache;
+
 // The Vod streaming, like FLV, MP4 or HLS streaming.
 class SrsVodStream : public SrsHttpFileServer
 {
@@ -61,6 +116,10 @@ protected:
     virtual srs_error_t serve_flv_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int64_t offset);
     // Support mp4 with start and offset in query string.
     virtual srs_error_t serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int64_t start, int64_t end);
+    // Support mp4 seeking by time, for example, http://server/file.mp4?start=12.5
+    // server will response a trimmed mp4, which starts from the keyframe at or before the start time,
+    // while the byte range in header is also supported.
+    virtual srs_error_t serve_mp4_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, srs_utime_t start);
     // Support HLS streaming with pseudo session id.
     virtual srs_error_t serve_m3u8_ctx(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
     virtual srs_error_t serve_ts_ctx(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
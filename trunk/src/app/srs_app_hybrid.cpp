@@ -124,11 +124,11 @@ ISrsHybridServer::~ISrsHybridServer()
 
 SrsHybridServer::SrsHybridServer()
 {
-    // Create global shared timer.
-    timer20ms_ = new SrsFastTimer("hybrid", 20 * SRS_UTIME_MILLISECONDS);
-    timer100ms_ = new SrsFastTimer("hybrid", 100 * SRS_UTIME_MILLISECONDS);
-    timer1s_ = new SrsFastTimer("hybrid", 1 * SRS_UTIME_SECONDS);
-    timer5s_ = new SrsFastTimer("hybrid", 5 * SRS_UTIME_SECONDS);
+    // Create global shared timer, over the timer wheel.
+    timer20ms_ = new SrsFastTimer(_srs_timer_wheel, 20 * SRS_UTIME_MILLISECONDS);
+    timer100ms_ = new SrsFastTimer(_srs_timer_wheel, 100 * SRS_UTIME_MILLISECONDS);
+    timer1s_ = new SrsFastTimer(_srs_timer_wheel, 1 * SRS_UTIME_SECONDS);
+    timer5s_ = new SrsFastTimer(_srs_timer_wheel, 5 * SRS_UTIME_SECONDS);
 
     clock_monitor_ = new SrsClockWallMonitor();
 }
@@ -159,20 +159,8 @@ srs_error_t SrsHybridServer::initialize()
 {
     srs_error_t err = srs_success;
 
-    // Start the timer first.
-    if ((err = timer20ms_->start()) != srs_success) {
-        return srs_error_wrap(err, "start timer");
-    }
-
-    if ((err = timer100ms_->start()) != srs_success) {
-        return srs_error_wrap(err, "start timer");
-    }
-
-    if ((err = timer1s_->start()) != srs_success) {
-        return srs_error_wrap(err, "start timer");
-    }
-
-    if ((err = timer5s_->start()) != srs_success) {
+    // Start the timer wheel first, for all timers and hourglass.
+    if ((err = _srs_timer_wheel->start()) != srs_success) {
         return srs_error_wrap(err, "start timer");
     }
 
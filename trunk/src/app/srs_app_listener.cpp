@@ -38,6 +38,9 @@ SrsPps* _srs_pps_spkts = NULL;
 // set the max packet size.
 #define SRS_UDP_MAX_PACKET_SIZE 65535
 
+// The backoff of listener when accept failed, for example, the EMFILE when exceed the max fds.
+#define SRS_ACCEPT_BACKOFF (100 * SRS_UTIME_MILLISECONDS)
+
 // sleep in srs_utime_t for udp recv packet.
 #define SrsUdpPacketRecvCycleInterval 0
 
@@ -231,6 +234,7 @@ SrsTcpListener::SrsTcpListener(ISrsTcpHandler* h)
     port_ = 0;
     lfd = NULL;
     label_ = "TCP";
+    batch_ = 1;
     trd = new SrsDummyCoroutine();
 }
 
@@ -260,6 +264,12 @@ SrsTcpListener* SrsTcpListener::set_endpoint(const std::string& endpoint)
     return set_endpoint(ip, port_);
 }
 
+SrsTcpListener* SrsTcpListener::set_accept_batch(int batch)
+{
+    batch_ = srs_max(1, batch);
+    return this;
+}
+
 int SrsTcpListener::port()
 {
     return port_;
@@ -305,25 +315,132 @@ srs_error_t SrsTcpListener::cycle()
         }
         
         srs_netfd_t fd = srs_accept(lfd, NULL, NULL, SRS_UTIME_NO_TIMEOUT);
-        if(fd == NULL){
-            return srs_error_new(ERROR_SOCKET_ACCEPT, "accept at fd=%d", srs_netfd_fileno(lfd));
+        if (fd == NULL) {
+            // Interrupted when stop the listener, quit by pull.
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // Never quit the listener for errors such as EMFILE, ENFILE or ECONNABORTED, because the connections
+            // might be closed later, so we backoff to avoid a busy loop, for the listen fd is still readable.
+            srs_warn("%s: accept at fd=%d, errno=%d(%s), backoff %dms", label_.c_str(), srs_netfd_fileno(lfd),
+                errno, strerror(errno), srsu2msi(SRS_ACCEPT_BACKOFF));
+            srs_usleep(SRS_ACCEPT_BACKOFF);
+            continue;
         }
-        
-        if ((err = srs_fd_closeexec(srs_netfd_fileno(fd))) != srs_success) {
-            return srs_error_wrap(err, "set closeexec");
+
+        if ((err = on_accept(fd)) != srs_success) {
+            return srs_error_wrap(err, "accept");
         }
-        
-        if ((err = handler->on_tcp_client(this, fd)) != srs_success) {
-            return srs_error_wrap(err, "handle fd=%d", srs_netfd_fileno(fd));
+
+        // Drain the backlog of kernel in batch, without waiting for the event again. Note that the listen fd is
+        // non-blocking, so accept returns EAGAIN if no more connections.
+        int nn_accepted = 1;
+        for (; nn_accepted < batch_; nn_accepted++) {
+            int osfd = ::accept(srs_netfd_fileno(lfd), NULL, NULL);
+            if (osfd == -1) {
+                // No more connections, or other errors which will be handled by srs_accept in next loop.
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    srs_warn("%s: drain accept at fd=%d, errno=%d(%s)", label_.c_str(), srs_netfd_fileno(lfd),
+                        errno, strerror(errno));
+                }
+                break;
+            }
+
+            if ((fd = srs_netfd_open_socket(osfd)) == NULL) {
+                srs_warn("%s: open fd=%d, errno=%d(%s)", label_.c_str(), osfd, errno, strerror(errno));
+                ::close(osfd);
+                break;
+            }
+
+            if ((err = on_accept(fd)) != srs_success) {
+                return srs_error_wrap(err, "accept");
+            }
+        }
+
+        // Yield to other coroutines if there might be more connections, such as the accepted connections, so we
+        // never starve them when there is a reconnect storm.
+        if (nn_accepted >= batch_) {
+            srs_thread_yield();
         }
     }
     
     return err;
 }
 
+srs_error_t SrsTcpListener::on_accept(srs_netfd_t fd)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = srs_fd_closeexec(srs_netfd_fileno(fd))) != srs_success) {
+        srs_close_stfd(fd);
+        return srs_error_wrap(err, "set closeexec");
+    }
+
+    // Never quit the listener for error of a connection, for example, exceed the max connections.
+    if ((err = handler->on_tcp_client(this, fd)) != srs_success) {
+        srs_warn("%s: ignore client err %s", label_.c_str(), srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
+    return err;
+}
+
+SrsAcceptRateLimiter::SrsAcceptRateLimiter(int rate)
+{
+    rate_ = 0;
+    tokens_ = 0;
+    last_ = 0;
+    nn_rejected_ = 0;
+
+    set_rate(rate);
+}
+
+SrsAcceptRateLimiter::~SrsAcceptRateLimiter()
+{
+}
+
+void SrsAcceptRateLimiter::set_rate(int rate)
+{
+    rate_ = srs_max(0, rate);
+    tokens_ = rate_;
+    last_ = 0;
+}
+
+bool SrsAcceptRateLimiter::acquire(srs_utime_t now)
+{
+    if (!rate_) {
+        return true;
+    }
+
+    // Fill the bucket by elapsed time, at most rate tokens for burst.
+    if (last_ && now > last_) {
+        tokens_ += (double)(now - last_) * rate_ / SRS_UTIME_SECONDS;
+        tokens_ = srs_min(tokens_, (double)rate_);
+    }
+    last_ = now;
+
+    if (tokens_ < 1) {
+        nn_rejected_++;
+        return false;
+    }
+
+    tokens_ -= 1;
+    return true;
+}
+
+uint64_t SrsAcceptRateLimiter::nn_rejected()
+{
+    return nn_rejected_;
+}
+
 SrsMultipleTcpListeners::SrsMultipleTcpListeners(ISrsTcpHandler* h)
 {
     handler_ = h;
+    label_ = "TCP";
+    reuseport_ = 1;
+    batch_ = 1;
+    limiter_ = new SrsAcceptRateLimiter(0);
 }
 
 SrsMultipleTcpListeners::~SrsMultipleTcpListeners()
@@ -332,10 +449,14 @@ SrsMultipleTcpListeners::~SrsMultipleTcpListeners()
         SrsTcpListener* l = *it;
         srs_freep(l);
     }
+
+    srs_freep(limiter_);
 }
 
 SrsMultipleTcpListeners* SrsMultipleTcpListeners::set_label(const std::string& label)
 {
+    label_ = label;
+
     for (vector<SrsTcpListener*>::iterator it = listeners_.begin(); it != listeners_.end(); ++it) {
         SrsTcpListener* l = *it;
         l->set_label(label);
@@ -344,14 +465,37 @@ SrsMultipleTcpListeners* SrsMultipleTcpListeners::set_label(const std::string& l
     return this;
 }
 
+SrsMultipleTcpListeners* SrsMultipleTcpListeners::set_reuseport(int reuseport)
+{
+    reuseport_ = srs_max(1, reuseport);
+    return this;
+}
+
+SrsMultipleTcpListeners* SrsMultipleTcpListeners::set_accept(int batch, int rate)
+{
+    batch_ = srs_max(1, batch);
+    limiter_->set_rate(rate);
+
+    for (vector<SrsTcpListener*>::iterator it = listeners_.begin(); it != listeners_.end(); ++it) {
+        SrsTcpListener* l = *it;
+        l->set_accept_batch(batch_);
+    }
+
+    return this;
+}
+
 SrsMultipleTcpListeners* SrsMultipleTcpListeners::add(const std::vector<std::string>& endpoints)
 {
     for (int i = 0; i < (int) endpoints.size(); i++) {
         string ip; int port;
         srs_parse_endpoint(endpoints[i], ip, port);
 
-        SrsTcpListener* l = new SrsTcpListener(this);
-        listeners_.push_back(l->set_endpoint(ip, port));
+        // Listen at the same endpoint for multiple times, by SO_REUSEPORT.
+        for (int j = 0; j < reuseport_; j++) {
+            SrsTcpListener* l = new SrsTcpListener(this);
+            l->set_label(label_)->set_accept_batch(batch_);
+            listeners_.push_back(l->set_endpoint(ip, port));
+        }
     }
 
     return this;
@@ -383,6 +527,20 @@ void SrsMultipleTcpListeners::close()
 
 srs_error_t SrsMultipleTcpListeners::on_tcp_client(ISrsListener* listener, srs_netfd_t stfd)
 {
+    srs_error_t err = srs_success;
+
+    // Reject the connection early if exceed the rate, before any object is created for it.
+    if (!limiter_->acquire(srs_get_system_time())) {
+        srs_close_stfd(stfd);
+
+        // Log the first one and then every 1000 rejected connections, to avoid too many logs.
+        uint64_t nn_rejected = limiter_->nn_rejected();
+        if ((nn_rejected % 1000) == 1) {
+            srs_warn("%s: reject connection for exceed accept rate, rejected=%" PRId64, label_.c_str(), nn_rejected);
+        }
+        return err;
+    }
+
     return handler_->on_tcp_client(this, stfd);
 }
 
@@ -116,6 +116,8 @@ private:
     ISrsTcpHandler* handler;
     std::string ip;
     int port_;
+    // The max number of connections to accept for each wakeup.
+    int batch_;
 public:
     SrsTcpListener(ISrsTcpHandler* h);
     virtual ~SrsTcpListener();
@@ -123,6 +125,7 @@ public:
     SrsTcpListener* set_label(const std::string& label);
     SrsTcpListener* set_endpoint(const std::string& i, int p);
     SrsTcpListener* set_endpoint(const std::string& endpoint);
+    SrsTcpListener* set_accept_batch(int batch);
     int port();
 public:
     virtual srs_error_t listen();
@@ -130,19 +133,55 @@ public:
 // Interface ISrsReusableThreadHandler.
 public:
     virtual srs_error_t cycle();
+private:
+    srs_error_t on_accept(srs_netfd_t fd);
+};
+
+// The rate limiter of accept, a token bucket which is filled by rate every second, and at most rate tokens
+// for burst, to reject the new connections when exceed the rate.
+class SrsAcceptRateLimiter
+{
+private:
+    // The max number of new connections per second, 0 to disable.
+    int rate_;
+    // The available tokens in bucket.
+    double tokens_;
+    srs_utime_t last_;
+    // The number of rejected connections.
+    uint64_t nn_rejected_;
+public:
+    SrsAcceptRateLimiter(int rate);
+    virtual ~SrsAcceptRateLimiter();
+public:
+    void set_rate(int rate);
+    // Consume a token for a new connection at now.
+    // @return Whether accept the connection, false if exceed the rate.
+    bool acquire(srs_utime_t now);
+    uint64_t nn_rejected();
 };
 
 // Bind and listen tcp port, use handler to process the client.
+// For each endpoint, there might be multiple listeners by SO_REUSEPORT, each has its own backlog and coroutine.
 class SrsMultipleTcpListeners : public ISrsListener, public ISrsTcpHandler
 {
 private:
     ISrsTcpHandler* handler_;
     std::vector<SrsTcpListener*> listeners_;
+    std::string label_;
+    // The number of listeners for each endpoint.
+    int reuseport_;
+    // The max number of connections to accept for each wakeup.
+    int batch_;
+    SrsAcceptRateLimiter* limiter_;
 public:
     SrsMultipleTcpListeners(ISrsTcpHandler* h);
     virtual ~SrsMultipleTcpListeners();
 public:
     SrsMultipleTcpListeners* set_label(const std::string& label);
+    // Set the number of listeners for each endpoint, should be called before add.
+    SrsMultipleTcpListeners* set_reuseport(int reuseport);
+    // Set the max connections to accept for each wakeup, and the max connections per second, 0 to disable.
+    SrsMultipleTcpListeners* set_accept(int batch, int rate);
     SrsMultipleTcpListeners* add(const std::vector<std::string>& endpoints);
 public:
     srs_error_t listen();
@@ -13,6 +13,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/uio.h>
 
 #include <srs_app_config.hpp>
 #include <srs_kernel_error.hpp>
@@ -28,6 +29,97 @@
 // reserved for the end of log data, it must be strlen(LOG_TAIL)
 #define LOG_TAIL_SIZE 1
 
+// The size of ring for each thread, for async log.
+#define SRS_LOG_RING_SIZE (1024 * 1024)
+// The size of batch to write by flusher.
+#define SRS_LOG_FLUSH_SIZE (64 * 1024)
+// The interval for flusher to check the rings.
+#define SRS_LOG_FLUSH_INTERVAL (10 * SRS_UTIME_MILLISECONDS)
+
+SrsLogRing::SrsLogRing(int capacity)
+{
+    capacity_ = 1;
+    while (capacity_ < (uint64_t)capacity) {
+        capacity_ <<= 1;
+    }
+
+    data_ = new char[capacity_];
+    head_ = 0;
+    tail_ = 0;
+}
+
+SrsLogRing::~SrsLogRing()
+{
+    srs_freepa(data_);
+}
+
+bool SrsLogRing::write(iovec* iovs, int nn_iovs)
+{
+    uint64_t size = 0;
+    for (int i = 0; i < nn_iovs; i++) {
+        size += iovs[i].iov_len;
+    }
+
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail + size > capacity_) {
+        return false;
+    }
+
+    for (int i = 0; i < nn_iovs; i++) {
+        char* p = (char*)iovs[i].iov_base;
+        uint64_t len = iovs[i].iov_len;
+
+        uint64_t pos = head & (capacity_ - 1);
+        uint64_t n = srs_min(len, capacity_ - pos);
+        memcpy(data_ + pos, p, n);
+        memcpy(data_, p + n, len - n);
+        head += len;
+    }
+
+    // Publish the data to reader.
+    head_.store(head, std::memory_order_release);
+
+    return true;
+}
+
+int SrsLogRing::read(char* buf, int size)
+{
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    uint64_t head = head_.load(std::memory_order_acquire);
+
+    uint64_t available = head - tail;
+    uint64_t nn = srs_min(available, (uint64_t)size);
+
+    uint64_t pos = tail & (capacity_ - 1);
+    uint64_t n = srs_min(nn, capacity_ - pos);
+    memcpy(buf, data_ + pos, n);
+    memcpy(buf + n, data_, nn - n);
+
+    // Only read the whole lines, because the logs of other rings are written in the same batch.
+    if (nn < available) {
+        while (nn > 0 && buf[nn - 1] != LOG_TAIL) {
+            nn--;
+        }
+    }
+
+    // Release the space to writer.
+    tail_.store(tail + nn, std::memory_order_release);
+
+    return (int)nn;
+}
+
+int SrsLogRing::size()
+{
+    return (int)(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire));
+}
+
+// The ring of current thread, for the log identified by owner.
+static __thread uint64_t _srs_log_ring_owner = 0;
+static __thread SrsLogRing* _srs_log_ring = NULL;
+// The buffer to format log of current thread, for async log.
+static __thread char _srs_log_data[LOG_MAX_SIZE];
+
 SrsFileLog::SrsFileLog()
 {
     level_ = SrsLogLevelTrace;
@@ -38,10 +130,33 @@ SrsFileLog::SrsFileLog()
     utc = false;
 
     mutex_ = new SrsThreadMutex();
+
+    static std::atomic<uint64_t> ids(0);
+    id_ = ++ids;
+    async_ = false;
+    flusher_ = NULL;
+    quit_ = false;
+    flush_mutex_ = new SrsThreadMutex();
+    flush_data_ = NULL;
+    reopen_ = false;
+    nn_dropped_ = 0;
+    nn_flushed_ = 0;
 }
 
 SrsFileLog::~SrsFileLog()
 {
+    // Stop the flusher before freeing the rings and buffer it's using.
+    if (async_) {
+        stop_async();
+    }
+
+    for (int i = 0; i < (int)rings_.size(); i++) {
+        SrsLogRing* ring = rings_.at(i);
+        srs_freep(ring);
+    }
+    srs_freep(flush_mutex_);
+    srs_freepa(flush_data_);
+
     srs_freepa(log_data);
     
     if (fd > 0) {
@@ -74,6 +189,12 @@ srs_error_t SrsFileLog::initialize()
 
 void SrsFileLog::reopen()
 {
+    // The log file is reopened by the flusher thread, see flush().
+    if (async_) {
+        reopen_ = true;
+        return;
+    }
+
     if (fd > 0) {
         ::close(fd);
     }
@@ -91,35 +212,260 @@ void SrsFileLog::log(SrsLogLevel level, const char* tag, const SrsContextId& con
         return;
     }
 
+    // For async log, format in the buffer of thread and write to the ring of thread, so no lock.
+    if (async_) {
+        int size = 0;
+        if (format_log(_srs_log_data, level, tag, context_id, fmt, args, &size)) {
+            write_async(_srs_log_data, size, level);
+        }
+        return;
+    }
+
     SrsThreadLocker(mutex_);
 
+    int size = 0;
+    if (!format_log(log_data, level, tag, context_id, fmt, args, &size)) {
+        return;
+    }
+
+    write_log(fd, log_data, size, level);
+}
+
+srs_error_t SrsFileLog::start_async()
+{
+    srs_error_t err = srs_success;
+
+    if (async_ || !_srs_config || !_srs_config->get_log_async()) {
+        return err;
+    }
+
+    flush_data_ = new char[SRS_LOG_FLUSH_SIZE];
+
+    if ((err = _srs_thread_pool->execute("log", SrsFileLog::start_flusher, this)) != srs_success) {
+        return srs_error_wrap(err, "start flusher");
+    }
+
+    // Find the thread of flusher, to join it when stop.
+    std::vector<SrsThreadEntry*> threads = _srs_thread_pool->threads();
+    for (int i = 0; i < (int)threads.size(); i++) {
+        SrsThreadEntry* entry = threads.at(i);
+        if (entry->start == SrsFileLog::start_flusher && entry->arg == this) {
+            flusher_ = entry;
+        }
+    }
+
+    async_ = true;
+    srs_trace("Log: Start async log, ring=%dKB, batch=%dKB", SRS_LOG_RING_SIZE / 1024, SRS_LOG_FLUSH_SIZE / 1024);
+
+    return err;
+}
+
+int SrsFileLog::flush()
+{
+    SrsThreadLocker(flush_mutex_);
+
+    // Reopen the log file for log rotate.
+    if (reopen_) {
+        reopen_ = false;
+
+        if (fd > 0) {
+            ::close(fd);
+            fd = -1;
+        }
+
+        if (log_to_file_tank) {
+            open_log_file();
+        }
+    }
+
+    std::vector<SrsLogRing*> rings;
+    if (true) {
+        SrsThreadLocker(mutex_);
+        rings = rings_;
+    }
+
+    int written = 0;
+    int nn = 0;
+    for (int i = 0; i < (int)rings.size(); i++) {
+        SrsLogRing* ring = rings.at(i);
+
+        while (ring->size() > 0) {
+            int r0 = ring->read(flush_data_ + nn, SRS_LOG_FLUSH_SIZE - nn);
+            if (r0 > 0) {
+                nn += r0;
+                continue;
+            }
+
+            // Never happen, because each log is smaller than the batch.
+            if (!nn) {
+                break;
+            }
+
+            // The batch is full, write it and read again.
+            write_batch(flush_data_, nn);
+            written += nn;
+            nn = 0;
+        }
+    }
+
+    if (nn > 0) {
+        write_batch(flush_data_, nn);
+        written += nn;
+    }
+
+    nn_flushed_ += written;
+    return written;
+}
+
+uint64_t SrsFileLog::dropped()
+{
+    return nn_dropped_;
+}
+
+uint64_t SrsFileLog::flushed()
+{
+    return nn_flushed_;
+}
+
+srs_error_t SrsFileLog::start_flusher(void* arg)
+{
+    SrsFileLog* log = (SrsFileLog*)arg;
+    return log->flusher_cycle();
+}
+
+srs_error_t SrsFileLog::flusher_cycle()
+{
+    srs_error_t err = srs_success;
+
+    // The flusher never runs coroutines, so sleep the thread directly like SrsThreadWorker.
+    while (!quit_) {
+        if (flush() <= 0) {
+            ::usleep(SRS_LOG_FLUSH_INTERVAL);
+        }
+    }
+
+    return err;
+}
+
+void SrsFileLog::stop_async()
+{
+    quit_ = true;
+
+    if (flusher_) {
+        pthread_join(flusher_->trd, NULL);
+        flusher_ = NULL;
+    }
+
+    // Write the left logs in rings.
+    flush();
+}
+
+bool SrsFileLog::format_log(char* buf, SrsLogLevel level, const char* tag, const SrsContextId& context_id, const char* fmt, va_list args, int* psize)
+{
     int size = 0;
     bool header_ok = srs_log_header(
-        log_data, LOG_MAX_SIZE, utc, level >= SrsLogLevelWarn, tag, context_id, srs_log_level_strings[level], &size
+        buf, LOG_MAX_SIZE, utc, level >= SrsLogLevelWarn, tag, context_id, srs_log_level_strings[level], &size
     );
     if (!header_ok) {
-        return;
+        return false;
     }
 
     // Something not expected, drop the log.
-    int r0 = vsnprintf(log_data + size, LOG_MAX_SIZE - size, fmt, args);
+    int r0 = vsnprintf(buf + size, LOG_MAX_SIZE - size, fmt, args);
     if (r0 <= 0 || r0 >= LOG_MAX_SIZE - size) {
-        return;
+        return false;
     }
     size += r0;
 
     // Add errno and strerror() if error. Check size to avoid security issue https://github.com/ossrs/srs/issues/1229
     if (level == SrsLogLevelError && errno != 0 && size < LOG_MAX_SIZE) {
-        r0 = snprintf(log_data + size, LOG_MAX_SIZE - size, "(%s)", strerror(errno));
+        r0 = snprintf(buf + size, LOG_MAX_SIZE - size, "(%s)", strerror(errno));
 
         // Something not expected, drop the log.
         if (r0 <= 0 || r0 >= LOG_MAX_SIZE - size) {
-            return;
+            return false;
         }
         size += r0;
     }
 
-    write_log(fd, log_data, size, level);
+    *psize = size;
+    return true;
+}
+
+void SrsFileLog::write_async(char* str_log, int size, int level)
+{
+    // ensure the tail and EOF of string, see write_log.
+    size = srs_min(LOG_MAX_SIZE - 1 - LOG_TAIL_SIZE, size);
+    str_log[size++] = LOG_TAIL;
+
+    // For console, print color msg for warn and error, see write_log.
+    const char* color = NULL;
+    if (!log_to_file_tank && level == SrsLogLevelWarn) {
+        color = "\033[33m";
+    } else if (!log_to_file_tank && level > SrsLogLevelWarn) {
+        color = "\033[31m";
+    }
+
+    iovec iovs[3];
+    int nn_iovs = 0;
+    if (!color) {
+        iovs[nn_iovs].iov_base = str_log;
+        iovs[nn_iovs++].iov_len = size;
+    } else {
+        static char normal[] = "\033[0m\n";
+        iovs[nn_iovs].iov_base = (void*)color;
+        iovs[nn_iovs++].iov_len = strlen(color);
+        iovs[nn_iovs].iov_base = str_log;
+        iovs[nn_iovs++].iov_len = size - LOG_TAIL_SIZE;
+        iovs[nn_iovs].iov_base = normal;
+        iovs[nn_iovs++].iov_len = sizeof(normal) - 1;
+    }
+
+    // Drop the log if ring is full, never block the thread.
+    if (!thread_ring()->write(iovs, nn_iovs)) {
+        ++nn_dropped_;
+    }
+}
+
+void SrsFileLog::write_batch(char* data, int size)
+{
+    // Write to console, or open log file if specified.
+    int ofd = STDOUT_FILENO;
+    if (log_to_file_tank) {
+        if (fd < 0) {
+            open_log_file();
+        }
+        ofd = fd;
+    }
+
+    while (ofd > 0 && size > 0) {
+        ssize_t r0 = ::write(ofd, data, size);
+        if (r0 <= 0) {
+            break;
+        }
+
+        data += r0;
+        size -= r0;
+    }
+}
+
+SrsLogRing* SrsFileLog::thread_ring()
+{
+    if (_srs_log_ring_owner == id_) {
+        return _srs_log_ring;
+    }
+
+    // The ring is created for each thread, and freed by log.
+    SrsLogRing* ring = new SrsLogRing(SRS_LOG_RING_SIZE);
+    if (true) {
+        SrsThreadLocker(mutex_);
+        rings_.push_back(ring);
+    }
+
+    _srs_log_ring_owner = id_;
+    _srs_log_ring = ring;
+
+    return ring;
 }
 
 void SrsFileLog::write_log(int& fd, char *str_log, int size, int level)
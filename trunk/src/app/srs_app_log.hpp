@@ -11,11 +11,15 @@
 
 #include <string.h>
 #include <string>
+#include <vector>
+#include <atomic>
 
 #include <srs_app_reload.hpp>
 #include <srs_protocol_log.hpp>
 
 class SrsThreadMutex;
+class SrsThreadEntry;
+struct iovec;
 
 // For log TAGs.
 #define TAG_MAIN "MAIN"
@@ -25,6 +29,31 @@ class SrsThreadMutex;
 #define TAG_RESOURCE_UNSUB "RESOURCE_UNSUB"
 #define TAG_LARGE_TIMER "LARGE_TIMER"
 
+// The ring buffer of log for a thread, which is lock-free for one writer thread and one reader thread.
+class SrsLogRing
+{
+private:
+    char* data_;
+    // The capacity of ring, must be power of 2.
+    uint64_t capacity_;
+    // The position to write, only updated by the writer thread.
+    std::atomic<uint64_t> head_;
+    // The position to read, only updated by the reader thread.
+    std::atomic<uint64_t> tail_;
+public:
+    SrsLogRing(int capacity);
+    virtual ~SrsLogRing();
+public:
+    // Write all the data to ring, by the writer thread.
+    // @return false if no space, the log is dropped.
+    bool write(iovec* iovs, int nn_iovs);
+    // Read the logs to buf, by the reader thread, only the whole lines if buf is not large enough.
+    // @return the bytes read.
+    int read(char* buf, int size);
+    // The bytes in ring.
+    int size();
+};
+
 // Use memory/disk cache and donot flush when write log.
 // it's ok to use it without config, which will log to console, and default trace level.
 // when you want to use different level, override this classs, set the protected _level.
@@ -42,8 +71,25 @@ private:
     // Whether use utc time.
     bool utc;
     // TODO: FIXME: use macro define like SRS_MULTI_THREAD_LOG to switch enable log mutex or not.
-    // Mutex for multithread log.
+    // Mutex for multithread log, or the rings for async log.
     SrsThreadMutex* mutex_;
+private:
+    // For async log, each thread writes log to its ring, and the flusher thread writes them in batch.
+    std::atomic<bool> async_;
+    // The flusher thread to join, and whether it should quit.
+    SrsThreadEntry* flusher_;
+    std::atomic<bool> quit_;
+    // The id to identify the rings of this log in threads.
+    uint64_t id_;
+    std::vector<SrsLogRing*> rings_;
+    // Mutex for the flusher, which is the only reader of rings.
+    SrsThreadMutex* flush_mutex_;
+    // The buffer of flusher, to write logs in batch.
+    char* flush_data_;
+    // Whether reopen the log file, by the flusher thread.
+    std::atomic<bool> reopen_;
+    std::atomic<uint64_t> nn_dropped_;
+    std::atomic<uint64_t> nn_flushed_;
 public:
     SrsFileLog();
     virtual ~SrsFileLog();
@@ -52,6 +98,24 @@ public:
     virtual srs_error_t initialize();
     virtual void reopen();
     virtual void log(SrsLogLevel level, const char* tag, const SrsContextId& context_id, const char* fmt, va_list args);
+public:
+    // Start the flusher thread for async log, which should be called after daemon forked.
+    srs_error_t start_async();
+    // Write the logs in rings to console or file, return the bytes written.
+    int flush();
+    // The number of logs dropped because the ring is full, and the bytes written by flusher.
+    uint64_t dropped();
+    uint64_t flushed();
+private:
+    static srs_error_t start_flusher(void* arg);
+    srs_error_t flusher_cycle();
+    // Stop and join the flusher thread, then write the left logs.
+    void stop_async();
+    bool format_log(char* buf, SrsLogLevel level, const char* tag, const SrsContextId& context_id, const char* fmt, va_list args, int* psize);
+    void write_async(char* str_log, int size, int level);
+    void write_batch(char* data, int size);
+    // Get the ring of current thread, create it if not exists.
+    SrsLogRing* thread_ring();
 private:
     virtual void write_log(int& fd, char* str_log, int size, int level);
     virtual void open_log_file();
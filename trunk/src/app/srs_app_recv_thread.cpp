@@ -281,6 +281,8 @@ SrsPublishRecvThread::SrsPublishRecvThread(SrsRtmpServer* rtmp_sdk, SrsRequest*
     mr_sleep = _srs_config->get_mr_sleep(req->vhost);
     
     realtime = _srs_config->get_realtime_enabled(req->vhost);
+
+    latency_ = SrsStatistic::instance()->latency(req, SrsLatencyStageRtmpPublish);
     
     _srs_config->subscribe(this);
 }
@@ -370,7 +372,11 @@ srs_error_t SrsPublishRecvThread::consume(SrsCommonMessage* msg)
                 srs_update_system_time(), msg->header.timestamp, msg->size);
     
     // the rtmp connection will handle this message
+    srs_utime_t starttime = latency_ ? srs_update_system_time() : 0;
     err = _conn->handle_publish_message(_source, msg);
+    if (latency_) {
+        latency_->update(srs_update_system_time() - starttime);
+    }
     
     // must always free it,
     // the source will copy it if need to use.
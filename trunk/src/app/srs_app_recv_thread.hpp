@@ -25,6 +25,7 @@ class SrsRequest;
 class SrsLiveConsumer;
 class SrsHttpConn;
 class SrsHttpxConn;
+class SrsLatencyHistogram;
 
 // The message consumer which consume a message.
 class ISrsMessageConsumer
@@ -135,6 +136,8 @@ private:
     int64_t _nb_msgs;
     // The video frames we got.
     uint64_t video_frames;
+    // The latency to handle a message, NULL if disabled.
+    SrsLatencyHistogram* latency_;
     // For mr(merged read),
     // @see https://github.com/ossrs/srs/issues/241
     bool mr;
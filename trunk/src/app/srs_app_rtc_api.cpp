@@ -727,3 +727,64 @@ srs_error_t SrsGoApiRtcNACK::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMe
     return srs_success;
 }
 
+SrsGoApiRtcLayer::SrsGoApiRtcLayer(SrsRtcServer* server)
+{
+    server_ = server;
+}
+
+SrsGoApiRtcLayer::~SrsGoApiRtcLayer()
+{
+}
+
+srs_error_t SrsGoApiRtcLayer::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
+{
+    srs_error_t err = srs_success;
+
+    SrsJsonObject* res = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, res);
+
+    res->set("code", SrsJsonAny::integer(ERROR_SUCCESS));
+
+    if ((err = do_serve_http(w, r, res)) != srs_success) {
+        srs_warn("RTC: Layer err %s", srs_error_desc(err).c_str());
+        res->set("code", SrsJsonAny::integer(srs_error_code(err)));
+        srs_freep(err);
+    }
+
+    return srs_api_response(w, r, res->dumps());
+}
+
+srs_error_t SrsGoApiRtcLayer::do_serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, SrsJsonObject* res)
+{
+    srs_error_t err = srs_success;
+
+    string client_id = r->query_get("client");
+    string rid = r->query_get("rid");
+
+    SrsJsonObject* query = SrsJsonAny::object();
+    res->set("query", query);
+
+    query->set("client", SrsJsonAny::str(client_id.c_str()));
+    query->set("rid", SrsJsonAny::str(rid.c_str()));
+    query->set("help", SrsJsonAny::str("?client=string&rid=string|auto"));
+
+    if (rid.empty()) {
+        return srs_error_new(ERROR_RTC_INVALID_PARAMS, "invalid rid, should be the RID or auto");
+    }
+
+    SrsStatistic* stat = SrsStatistic::instance();
+    SrsStatisticClient* client = stat->find_client(client_id);
+    SrsRtcConnection* session = client ? dynamic_cast<SrsRtcConnection*>(client->conn) : NULL;
+    if (!session) {
+        return srs_error_new(ERROR_RTC_NO_SESSION, "no rtc client=%s", client_id.c_str());
+    }
+
+    if ((err = session->switch_layer(client_id, rid == "auto" ? "" : rid)) != srs_success) {
+        return srs_error_wrap(err, "switch layer client=%s, rid=%s", client_id.c_str(), rid.c_str());
+    }
+
+    srs_trace("RTC: Layer client=%s, rid=%s", client_id.c_str(), rid.c_str());
+
+    return err;
+}
+
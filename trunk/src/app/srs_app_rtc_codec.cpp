@@ -6,9 +6,14 @@
 
 #include <srs_app_rtc_codec.hpp>
 
+#include <time.h>
+#include <string.h>
+
 #include <srs_kernel_codec.hpp>
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_app_config.hpp>
+#include <srs_protocol_st.hpp>
 
 static const AVCodec* srs_find_decoder_by_id(SrsAudioCodecId id)
 {
@@ -51,7 +56,8 @@ public:
 
     static void ffmpeg_log_callback(void*, int level, const char* fmt, va_list vl) 
     {
-        static char buf[4096] = {0};
+        // Might be called by transcode worker threads, so never use static buffer.
+        char buf[4096];
         int nbytes = vsnprintf(buf, sizeof(buf), fmt, vl);
         if (nbytes > 0 && nbytes < (int)sizeof(buf)) {
             // Srs log is always start with new line, replcae '\n' to '\0', make log easy to read.
@@ -465,3 +471,187 @@ void SrsAudioTranscoder::free_swr_samples()
     }
 }
 
+
+// Get the time in microseconds of clock, which is safe for any thread.
+static srs_utime_t srs_clock_time(clockid_t clock)
+{
+    timespec ts;
+    if (clock_gettime(clock, &ts) < 0) {
+        return 0;
+    }
+    return (srs_utime_t)ts.tv_sec * SRS_UTIME_SECONDS + ts.tv_nsec / 1000;
+}
+
+SrsAudioTranscodeResult::SrsAudioTranscodeResult()
+{
+    err = srs_success;
+    dts = 0;
+    latency = 0;
+    cpu = 0;
+}
+
+SrsAudioTranscodeResult::~SrsAudioTranscodeResult()
+{
+    for (std::vector<SrsAudioFrame*>::iterator it = frames.begin(); it != frames.end(); ++it) {
+        SrsAudioFrame* p = *it;
+
+        for (int i = 0; i < p->nb_samples; i++) {
+            char* pa = p->samples[i].bytes;
+            srs_freepa(pa);
+        }
+
+        srs_freep(p);
+    }
+
+    srs_freep(err);
+}
+
+// Free the copy of frame, with its samples.
+static void srs_audio_frame_free(SrsAudioFrame* frame)
+{
+    for (int i = 0; i < frame->nb_samples; i++) {
+        char* bytes = frame->samples[i].bytes;
+        srs_freepa(bytes);
+    }
+    srs_freep(frame);
+}
+
+SrsAsyncAudioTranscoder::SrsAsyncAudioTranscoder()
+{
+    codec_ = new SrsAudioTranscoder();
+    worker_ = NULL;
+    ctx_ = new SrsThreadTaskContext();
+    lock_ = new SrsThreadMutex();
+}
+
+SrsAsyncAudioTranscoder::~SrsAsyncAudioTranscoder()
+{
+    // Drop the frames not transcoded, the worker thread never references the transcoder after canceled.
+    ctx_->cancel();
+
+    for (int i = 0; i < (int)results_.size(); i++) {
+        SrsAudioTranscodeResult* result = results_.at(i);
+        srs_freep(result);
+    }
+
+    srs_freep(codec_);
+    srs_freep(lock_);
+}
+
+srs_error_t SrsAsyncAudioTranscoder::initialize(SrsAudioCodecId from, SrsAudioCodecId to, int channels, int sample_rate, int bit_rate)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = codec_->initialize(from, to, channels, sample_rate, bit_rate)) != srs_success) {
+        return srs_error_wrap(err, "initialize");
+    }
+
+    // Bind to a worker, after the codec is initialized.
+    if (_srs_audio_transcode_pool) {
+        int nn_workers = _srs_config->get_threads_audio_workers();
+        worker_ = _srs_audio_transcode_pool->pick(nn_workers, _srs_config->get_threads_audio_queue());
+    }
+
+    return err;
+}
+
+bool SrsAsyncAudioTranscoder::async()
+{
+    return worker_ != NULL;
+}
+
+srs_error_t SrsAsyncAudioTranscoder::transcode(SrsAudioFrame* in)
+{
+    srs_error_t err = srs_success;
+
+    // Copy the frame, because the samples are freed by user.
+    SrsAudioFrame* frame = new SrsAudioFrame();
+    frame->dts = in->dts;
+    frame->cts = in->cts;
+    for (int i = 0; i < in->nb_samples; i++) {
+        SrsSample* sample = &in->samples[i];
+        if (!sample->bytes || sample->size <= 0) {
+            continue;
+        }
+
+        char* bytes = new char[sample->size];
+        memcpy(bytes, sample->bytes, sample->size);
+        frame->samples[frame->nb_samples].bytes = bytes;
+        frame->samples[frame->nb_samples].size = sample->size;
+        frame->nb_samples++;
+    }
+
+    srs_utime_t starttime = srs_clock_time(CLOCK_MONOTONIC);
+
+    // Transcode in ST thread, the result is ready now.
+    if (!worker_) {
+        on_transcode(frame, starttime);
+        return err;
+    }
+
+    worker_->push(new SrsAudioTranscodeTask(ctx_, this, frame, starttime));
+
+    return err;
+}
+
+void SrsAsyncAudioTranscoder::fetch(std::vector<SrsAudioTranscodeResult*>& results)
+{
+    SrsThreadLocker(lock_);
+
+    results.insert(results.end(), results_.begin(), results_.end());
+    results_.clear();
+}
+
+void SrsAsyncAudioTranscoder::wait()
+{
+    while (ctx_->pending() > 0) {
+        srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+    }
+}
+
+void SrsAsyncAudioTranscoder::aac_codec_header(uint8_t** data, int* len)
+{
+    // Never changed after initialized, so it's safe to read in ST thread.
+    codec_->aac_codec_header(data, len);
+}
+
+void SrsAsyncAudioTranscoder::on_transcode(SrsAudioFrame* frame, srs_utime_t starttime)
+{
+    srs_utime_t cputime = srs_clock_time(CLOCK_THREAD_CPUTIME_ID);
+
+    SrsAudioTranscodeResult* result = new SrsAudioTranscodeResult();
+    result->dts = frame->dts;
+    result->err = codec_->transcode(frame, result->frames);
+
+    result->cpu = srs_clock_time(CLOCK_THREAD_CPUTIME_ID) - cputime;
+    result->latency = srs_clock_time(CLOCK_MONOTONIC) - starttime;
+
+    srs_audio_frame_free(frame);
+
+    SrsThreadLocker(lock_);
+    results_.push_back(result);
+}
+
+SrsAudioTranscodeTask::SrsAudioTranscodeTask(SrsThreadTaskContext* ctx, SrsAsyncAudioTranscoder* transcoder, SrsAudioFrame* frame, srs_utime_t starttime) : SrsThreadTask(ctx)
+{
+    transcoder_ = transcoder;
+    frame_ = frame;
+    starttime_ = starttime;
+}
+
+SrsAudioTranscodeTask::~SrsAudioTranscodeTask()
+{
+    // The frame is not transcoded, if the task is dropped.
+    if (frame_) {
+        srs_audio_frame_free(frame_);
+    }
+}
+
+void SrsAudioTranscodeTask::execute()
+{
+    // The frame is freed by transcoder.
+    transcoder_->on_transcode(frame_, starttime_);
+    frame_ = NULL;
+}
+
+SrsThreadWorkerPool* _srs_audio_transcode_pool = NULL;
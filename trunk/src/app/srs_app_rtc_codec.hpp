@@ -12,6 +12,9 @@
 #include <srs_kernel_codec.hpp>
 
 #include <string>
+#include <vector>
+
+#include <srs_app_threads.hpp>
 
 #ifdef __cplusplus
 extern "C" {
@@ -78,5 +81,80 @@ private:
     void free_swr_samples();
 };
 
+class SrsAsyncAudioTranscoder;
+
+// The transcoded audio frames of an input frame.
+class SrsAudioTranscodeResult
+{
+public:
+    std::vector<SrsAudioFrame*> frames;
+    srs_error_t err;
+    // The dts of input frame, in ms.
+    int64_t dts;
+    // The time from input to transcoded.
+    srs_utime_t latency;
+    // The CPU time of transcoding.
+    srs_utime_t cpu;
+public:
+    SrsAudioTranscodeResult();
+    virtual ~SrsAudioTranscodeResult();
+};
+
+// The task to transcode an input frame in worker thread.
+class SrsAudioTranscodeTask : public SrsThreadTask
+{
+private:
+    SrsAsyncAudioTranscoder* transcoder_;
+    // The copy of input frame, whose samples are owned by task.
+    SrsAudioFrame* frame_;
+    // The monotonic time when input.
+    srs_utime_t starttime_;
+public:
+    SrsAudioTranscodeTask(SrsThreadTaskContext* ctx, SrsAsyncAudioTranscoder* transcoder, SrsAudioFrame* frame, srs_utime_t starttime);
+    virtual ~SrsAudioTranscodeTask();
+protected:
+    virtual void execute();
+};
+
+// The audio transcoder of a stream, which transcodes in worker thread if enabled, while
+// the results are fetched by ST thread asynchronously, in the order of input.
+// @remark When no worker, the frame is transcoded in ST thread, and the result is ready
+//       to fetch after transcode.
+class SrsAsyncAudioTranscoder
+{
+private:
+    SrsAudioTranscoder* codec_;
+    // The worker to transcode, NULL to transcode in ST thread.
+    SrsThreadWorker* worker_;
+    // The context of frames not transcoded yet, shared with the tasks.
+    SrsThreadTaskContext* ctx_;
+    // The transcoded results, produced by worker and fetched by ST thread.
+    SrsThreadMutex* lock_;
+    std::vector<SrsAudioTranscodeResult*> results_;
+public:
+    SrsAsyncAudioTranscoder();
+    virtual ~SrsAsyncAudioTranscoder();
+public:
+    // Initialize the transcoder, see SrsAudioTranscoder::initialize.
+    srs_error_t initialize(SrsAudioCodecId from, SrsAudioCodecId to, int channels, int sample_rate, int bit_rate);
+    // Whether transcode in worker thread.
+    bool async();
+    // Transcode the input audio frame, which is copied so user is able to free it.
+    srs_error_t transcode(SrsAudioFrame* in);
+    // Fetch the transcoded results, user should free them.
+    void fetch(std::vector<SrsAudioTranscodeResult*>& results);
+    // Wait for all pending frames to be transcoded, yield to other coroutines.
+    void wait();
+    // See SrsAudioTranscoder::aac_codec_header.
+    void aac_codec_header(uint8_t** data, int* len);
+public:
+    // Transcode the frame, in worker thread or ST thread.
+    void on_transcode(SrsAudioFrame* frame, srs_utime_t starttime);
+};
+
+// The workers to transcode audio for bridges out of the event loop.
+// It MUST be thread-safe, global and shared object.
+extern SrsThreadWorkerPool* _srs_audio_transcode_pool;
+
 #endif /* SRS_APP_AUDIO_RECODE_HPP */
 
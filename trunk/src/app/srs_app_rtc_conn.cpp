@@ -427,6 +427,10 @@ SrsRtcPlayStream::SrsRtcPlayStream(SrsRtcConnection* s, const SrsContextId& cid)
 
     cache_ssrc0_ = cache_ssrc1_ = cache_ssrc2_ = 0;
     cache_track0_ = cache_track1_ = cache_track2_ = NULL;
+
+    simulcast_track_ = NULL;
+    simulcast_selector_ = new SrsRtcLayerSelector();
+    simulcast_selected_at_ = 0;
 }
 
 SrsRtcPlayStream::~SrsRtcPlayStream()
@@ -441,6 +445,7 @@ SrsRtcPlayStream::~SrsRtcPlayStream()
     srs_freep(pli_worker_);
     srs_freep(trd_);
     srs_freep(req_);
+    srs_freep(simulcast_selector_);
 
     if (true) {
         std::map<uint32_t, SrsRtcAudioSendTrack*>::iterator it;
@@ -490,6 +495,10 @@ srs_error_t SrsRtcPlayStream::initialize(SrsRequest* req, std::map<uint32_t, Srs
         if (desc->type_ == "video") {
             SrsRtcVideoSendTrack* track = new SrsRtcVideoSendTrack(session_, desc);
             video_tracks_.insert(make_pair(ssrc, track));
+
+            if (!desc->rid_.empty() && !simulcast_track_) {
+                simulcast_track_ = track;
+            }
         }
     }
 
@@ -640,6 +649,9 @@ srs_error_t SrsRtcPlayStream::cycle()
     SrsErrorPithyPrint* epp = new SrsErrorPithyPrint();
     SrsAutoFree(SrsErrorPithyPrint, epp);
 
+    // The latency to send a packet, NULL if disabled.
+    SrsLatencyHistogram* latency = SrsStatistic::instance()->latency(req_, SrsLatencyStageRtcSend);
+
     while (true) {
         if ((err = trd_->pull()) != srs_success) {
             return srs_error_wrap(err, "rtc sender thread");
@@ -656,7 +668,13 @@ srs_error_t SrsRtcPlayStream::cycle()
 
         // Send-out the RTP packet and do cleanup
         // @remark Note that the pkt might be set to NULL.
-        if ((err = send_packet(pkt)) != srs_success) {
+        bool sampled = latency && latency->sample();
+        srs_utime_t sendtime = sampled ? srs_update_system_time() : 0;
+        err = send_packet(pkt);
+        if (sampled) {
+            latency->update(srs_update_system_time() - sendtime);
+        }
+        if (err != srs_success) {
             uint32_t nn = 0;
             if (epp->can_print(err, &nn)) {
                 srs_warn("play send packets=%u, nn=%u/%u, err: %s", 1, epp->nn_count, nn, srs_error_desc(err).c_str());
@@ -678,7 +696,21 @@ srs_error_t SrsRtcPlayStream::send_packet(SrsRtpPacket*& pkt)
 
     // Try to find track from cache.
     SrsRtcSendTrack* track = NULL;
-    if (cache_ssrc0_ == ssrc) {
+    if (simulcast_track_ && !pkt->is_audio() && source_->is_simulcast_layer(ssrc)) {
+        // For simulcast, only forward the selected layer by the same track.
+        update_simulcast_target();
+
+        bool switched = false;
+        if (!simulcast_selector_->accept(pkt, switched)) {
+            return err;
+        }
+
+        if (switched) {
+            simulcast_track_->on_source_switched();
+            srs_trace("RTC: Player switch to simulcast layer ssrc=%u", ssrc);
+        }
+        track = simulcast_track_;
+    } else if (cache_ssrc0_ == ssrc) {
         track = cache_track0_;
     } else if (cache_ssrc1_ == ssrc) {
         track = cache_track1_;
@@ -736,6 +768,67 @@ srs_error_t SrsRtcPlayStream::send_packet(SrsRtpPacket*& pkt)
     return err;
 }
 
+srs_error_t SrsRtcPlayStream::switch_layer(std::string rid)
+{
+    srs_error_t err = srs_success;
+
+    if (!simulcast_track_) {
+        return srs_error_new(ERROR_RTC_NO_TRACK, "no simulcast track");
+    }
+
+    if (!rid.empty()) {
+        bool found = false;
+        std::vector<SrsRtcSimulcastLayer> layers = source_->simulcast_layers();
+        for (int i = 0; i < (int)layers.size(); i++) {
+            found = found || layers.at(i).rid_ == rid;
+        }
+        if (!found) {
+            return srs_error_new(ERROR_RTC_NO_TRACK, "no simulcast layer rid=%s", rid.c_str());
+        }
+    }
+
+    // Select the target at next packet.
+    simulcast_rid_ = rid;
+    simulcast_selected_at_ = 0;
+    srs_trace("RTC: Player switch simulcast layer to rid=%s", rid.empty() ? "auto" : rid.c_str());
+
+    return err;
+}
+
+void SrsRtcPlayStream::update_simulcast_target()
+{
+    srs_utime_t now = srs_get_system_time();
+    if (simulcast_selector_->target() && now - simulcast_selected_at_ < SRS_UTIME_SECONDS) {
+        return;
+    }
+    simulcast_selected_at_ = now;
+
+    std::vector<SrsRtcSimulcastLayer> layers = source_->simulcast_layers();
+
+    uint32_t target = 0;
+    if (!simulcast_rid_.empty()) {
+        for (int i = 0; i < (int)layers.size(); i++) {
+            if (layers.at(i).rid_ == simulcast_rid_) {
+                target = layers.at(i).ssrc_;
+            }
+        }
+    } else {
+        int64_t bitrate = session_->bwe_ ? session_->bwe_->estimate() : 0;
+        target = SrsRtcLayerSelector::select(layers, bitrate);
+    }
+
+    if (!target) {
+        return;
+    }
+
+    simulcast_selector_->set_target(target);
+
+    // Request keyframe of target layer, until switched.
+    if (simulcast_selector_->switching()) {
+        pli_worker_->request_keyframe(target, cid_);
+    }
+}
+
 void SrsRtcPlayStream::set_all_tracks_status(bool status)
 {
     std::ostringstream merged_log;
@@ -890,6 +983,11 @@ srs_error_t SrsRtcPlayStream::on_rtcp_ps_feedback(SrsRtcpPsfbCommon* rtcp)
 
 uint32_t SrsRtcPlayStream::get_video_publish_ssrc(uint32_t play_ssrc)
 {
+    // For simulcast, the PLI is for the layer we are forwarding.
+    if (simulcast_track_ && simulcast_track_->has_ssrc(play_ssrc)) {
+        return simulcast_selector_->current();
+    }
+
     std::map<uint32_t, SrsRtcVideoSendTrack*>::iterator it;
     for (it = video_tracks_.begin(); it != video_tracks_.end(); ++it) {
         if (it->second->has_ssrc(play_ssrc)) {
@@ -940,6 +1038,12 @@ srs_error_t SrsRtcPublishRtcpTimer::on_timer(srs_utime_t interval)
     // For RR and RRTR.
     ++_srs_pps_rr->sugar;
 
+    // Piggyback the RR and XR by the next TWCC feedback, in the same compound packet.
+    if (p_->twcc_enabled_ && !_srs_circuit_breaker->hybrid_critical_water_level()) {
+        p_->rtcp_rr_pending_ = true;
+        return err;
+    }
+
     if ((err = p_->send_rtcp_rr()) != srs_success) {
         srs_warn("RR err %s", srs_error_desc(err).c_str());
         srs_freep(err);
@@ -950,6 +1054,11 @@ srs_error_t SrsRtcPublishRtcpTimer::on_timer(srs_utime_t interval)
         srs_freep(err);
     }
 
+    if ((err = p_->session_->flush_rtcp()) != srs_success) {
+        srs_warn("RTCP err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
     return err;
 }
 
@@ -1059,6 +1168,7 @@ SrsRtcPublishStream::SrsRtcPublishStream(SrsRtcConnection* session, const SrsCon
     req_ = NULL;
     source = NULL;
     nn_simulate_nack_drop = 0;
+    latency_ = NULL;
     nack_enabled_ = false;
     nack_no_copy_ = false;
     pt_to_drop_ = 0;
@@ -1066,10 +1176,12 @@ SrsRtcPublishStream::SrsRtcPublishStream(SrsRtcConnection* session, const SrsCon
     nn_audio_frames = 0;
     twcc_enabled_ = false;
     twcc_id_ = 0;
+    rid_id_ = 0;
     twcc_fb_count_ = 0;
     
     pli_worker_ = new SrsRtcPLIWorker(this);
     last_time_send_twcc_ = 0;
+    rtcp_rr_pending_ = false;
 
     timer_rtcp_ = new SrsRtcPublishRtcpTimer(this);
     timer_twcc_ = new SrsRtcPublishTwccTimer(this);
@@ -1124,6 +1236,7 @@ srs_error_t SrsRtcPublishStream::initialize(SrsRequest* r, SrsRtcSourceDescripti
     if ((err = stat->on_client(cid_.c_str(), req_, session_, SrsRtcConnPublish)) != srs_success) {
         return srs_error_wrap(err, "rtc: stat client");
     }
+    latency_ = stat->latency(req_, SrsLatencyStageRtcPublish);
 
     if (stream_desc->audio_track_desc_) {
         audio_tracks_.push_back(new SrsRtcAudioRecvTrack(session_, stream_desc->audio_track_desc_));
@@ -1150,6 +1263,15 @@ srs_error_t SrsRtcPublishStream::initialize(SrsRequest* r, SrsRtcSourceDescripti
         rtcp_twcc_.set_media_ssrc(media_ssrc);
     }
 
+    // For RID based simulcast, the SSRC of layer is bound by RID of packet.
+    for (int i = 0; i < (int)stream_desc->video_track_descs_.size(); ++i) {
+        SrsRtcTrackDescription* desc = stream_desc->video_track_descs_.at(i);
+        if (!desc->rid_.empty() && !desc->ssrc_) {
+            rid_id_ = srs_max(0, desc->get_rtp_extension_id(kRidExt));
+            break;
+        }
+    }
+
     nack_enabled_ = _srs_config->get_rtc_nack_enabled(req_->vhost);
     nack_no_copy_ = _srs_config->get_rtc_nack_no_copy(req_->vhost);
     pt_to_drop_ = (uint16_t)_srs_config->get_rtc_drop_for_pt(req_->vhost);
@@ -1373,7 +1495,12 @@ srs_error_t SrsRtcPublishStream::on_rtp_plaintext(char* plaintext, int nb_plaint
     SrsBuffer buf(p, nb_plaintext);
 
     // @remark Note that the pkt might be set to NULL.
+    bool sampled = latency_ && latency_->sample();
+    srs_utime_t starttime = sampled ? srs_update_system_time() : 0;
     err = do_on_rtp_plaintext(pkt, &buf);
+    if (sampled) {
+        latency_->update(srs_update_system_time() - starttime);
+    }
 
     // Free the packet.
     // @remark Note that the pkt might be set to NULL.
@@ -1382,6 +1509,34 @@ srs_error_t SrsRtcPublishStream::on_rtp_plaintext(char* plaintext, int nb_plaint
     return err;
 }
 
+bool SrsRtcPublishStream::bind_simulcast_layer(char* buf, int nb_buf, uint32_t ssrc)
+{
+    if (rid_id_ <= 0) {
+        return false;
+    }
+
+    std::string rid;
+    srs_error_t err = srs_rtp_fast_parse_rid(buf, nb_buf, rid_id_, rid);
+    if (err != srs_success || rid.empty()) {
+        srs_freep(err);
+        return false;
+    }
+
+    for (int i = 0; i < (int)video_tracks_.size(); ++i) {
+        SrsRtcVideoRecvTrack* track = video_tracks_.at(i);
+        if (track->get_rid() != rid || track->get_ssrc()) {
+            continue;
+        }
+
+        track->bind_ssrc(ssrc);
+        source->on_simulcast_bind(rid, ssrc);
+        srs_trace("RTC: Bind simulcast layer rid=%s, ssrc=%u", rid.c_str(), ssrc);
+        return true;
+    }
+
+    return false;
+}
+
 srs_error_t SrsRtcPublishStream::do_on_rtp_plaintext(SrsRtpPacket*& pkt, SrsBuffer* buf)
 {
     srs_error_t err = srs_success;
@@ -1492,11 +1647,18 @@ srs_error_t SrsRtcPublishStream::send_periodic_twcc()
     }
     last_time_send_twcc_ = srs_get_system_time();
 
-    if (!rtcp_twcc_.need_feedback()) {
-        return err;
-    }
+    // The RR and XR are sent with TWCC in a compound packet.
+    if (rtcp_rr_pending_) {
+        rtcp_rr_pending_ = false;
 
-    ++_srs_pps_srtcps->sugar;
+        if ((err = send_rtcp_rr()) != srs_success) {
+            return srs_error_wrap(err, "rr");
+        }
+
+        if ((err = send_rtcp_xr_rrtr()) != srs_success) {
+            return srs_error_wrap(err, "xr");
+        }
+    }
 
     // limit the max count=1024 to avoid dead loop.
     for (int i = 0; i < 1024 && rtcp_twcc_.need_feedback(); ++i) {
@@ -1511,11 +1673,15 @@ srs_error_t SrsRtcPublishStream::send_periodic_twcc()
             return srs_error_wrap(err, "encode, count=%u", twcc_fb_count_);
         }
 
-        if((err = session_->send_rtcp(pkt, buffer->pos())) != srs_success) {
+        if((err = session_->append_rtcp(pkt, buffer->pos())) != srs_success) {
             return srs_error_wrap(err, "send twcc, count=%u", twcc_fb_count_);
         }
     }
 
+    if ((err = session_->flush_rtcp()) != srs_success) {
+        return srs_error_wrap(err, "flush twcc");
+    }
+
     return err;
 }
 
@@ -1699,6 +1865,322 @@ void SrsRtcPublishStream::update_send_report_time(uint32_t ssrc, const SrsNtp& n
     }
 }
 
+// The number of sent packets to find by TWCC feedback, about 400ms for 10k pps. It MUST be power of
+// 2, to index the circular array by mask.
+#define SRS_RTC_BWE_HISTORY 4096
+// The start, min and max estimated bandwidth in bps.
+#define SRS_RTC_BWE_START (2 * 1000 * 1000)
+#define SRS_RTC_BWE_MIN (100 * 1000)
+#define SRS_RTC_BWE_MAX (50 * 1000 * 1000)
+// The window to follow the drift of base delay, because the clocks are not synchronized.
+#define SRS_RTC_BWE_BASE_WINDOW (10 * SRS_UTIME_SECONDS)
+// The queuing delay to detect overuse of bandwidth.
+#define SRS_RTC_BWE_OVERUSE (30 * SRS_UTIME_MILLISECONDS)
+// The min interval to decrease bandwidth, about a RTT.
+#define SRS_RTC_BWE_DECREASE_INTERVAL (200 * SRS_UTIME_MILLISECONDS)
+
+SrsRtcBandwidthEstimator::SrsRtcBandwidthEstimator()
+{
+    sent_ = new SrsRtcSentPacket[SRS_RTC_BWE_HISTORY];
+    memset(sent_, 0, sizeof(SrsRtcSentPacket) * SRS_RTC_BWE_HISTORY);
+    next_sn_ = 0;
+
+    estimate_ = SRS_RTC_BWE_START;
+    remb_ = 0;
+    has_twcc_ = false;
+    base_delay_ = INT64_MAX;
+    next_base_delay_ = INT64_MAX;
+    base_delay_at_ = 0;
+    queuing_delay_ = 0;
+    loss_ = 0;
+    acked_bitrate_ = 0;
+    last_update_ = 0;
+    last_decrease_ = 0;
+}
+
+SrsRtcBandwidthEstimator::~SrsRtcBandwidthEstimator()
+{
+    srs_freepa(sent_);
+}
+
+uint16_t SrsRtcBandwidthEstimator::generate_sn()
+{
+    return next_sn_++;
+}
+
+void SrsRtcBandwidthEstimator::on_packet_sent(uint16_t sn, int size, srs_utime_t now)
+{
+    SrsRtcSentPacket& pkt = sent_[sn & (SRS_RTC_BWE_HISTORY - 1)];
+    pkt.sn = sn;
+    pkt.size = size;
+    pkt.sent_at = now;
+}
+
+srs_error_t SrsRtcBandwidthEstimator::on_twcc(char* data, int nb_data, srs_utime_t now)
+{
+    srs_error_t err = srs_success;
+
+    status_.clear();
+    if ((err = srs_rtcp_parse_twcc(data, nb_data, status_)) != srs_success) {
+        return srs_error_wrap(err, "parse twcc");
+    }
+
+    int nn_total = 0, nn_lost = 0;
+    int64_t acked_bytes = 0, first_arrival = 0, last_arrival = 0;
+    for (int i = 0; i < (int)status_.size(); i++) {
+        SrsTwccPacketStatus& v = status_[i];
+
+        // Ignore the packet which is not sent by us, or overwritten by new packet.
+        SrsRtcSentPacket& pkt = sent_[v.sn & (SRS_RTC_BWE_HISTORY - 1)];
+        if (!pkt.sent_at || pkt.sn != v.sn) {
+            continue;
+        }
+
+        nn_total++;
+        if (!v.received) {
+            nn_lost++;
+            continue;
+        }
+
+        if (!acked_bytes || v.arrival < first_arrival) {
+            first_arrival = v.arrival;
+        }
+        if (!acked_bytes || v.arrival > last_arrival) {
+            last_arrival = v.arrival;
+        }
+        acked_bytes += pkt.size;
+
+        // The one-way delay, with an unknown offset of clocks, which is removed by base delay.
+        int64_t delay = v.arrival - pkt.sent_at;
+        base_delay_ = srs_min(base_delay_, delay);
+        next_base_delay_ = srs_min(next_base_delay_, delay);
+        queuing_delay_ = 0.9 * queuing_delay_ + 0.1 * (delay - base_delay_);
+    }
+
+    if (!nn_total) {
+        return err;
+    }
+    has_twcc_ = true;
+
+    if (now - base_delay_at_ > SRS_RTC_BWE_BASE_WINDOW) {
+        base_delay_ = next_base_delay_;
+        next_base_delay_ = INT64_MAX;
+        base_delay_at_ = now;
+    }
+
+    loss_ = (double)nn_lost / nn_total;
+    if (last_arrival - first_arrival >= 10 * SRS_UTIME_MILLISECONDS) {
+        acked_bitrate_ = acked_bytes * 8 * SRS_UTIME_SECONDS / (last_arrival - first_arrival);
+    }
+
+    update(now);
+
+    return err;
+}
+
+void SrsRtcBandwidthEstimator::on_remb(uint64_t bitrate)
+{
+    remb_ = (int64_t)bitrate;
+
+    // Use REMB as estimation if no TWCC, or as the limit.
+    if (!has_twcc_) {
+        estimate_ = srs_max(SRS_RTC_BWE_MIN, srs_min(SRS_RTC_BWE_MAX, remb_));
+    } else if (remb_ > 0) {
+        estimate_ = srs_max(SRS_RTC_BWE_MIN, srs_min(estimate_, remb_));
+    }
+}
+
+int64_t SrsRtcBandwidthEstimator::estimate()
+{
+    return estimate_;
+}
+
+double SrsRtcBandwidthEstimator::loss()
+{
+    return loss_;
+}
+
+srs_utime_t SrsRtcBandwidthEstimator::queuing_delay()
+{
+    return (srs_utime_t)queuing_delay_;
+}
+
+void SrsRtcBandwidthEstimator::update(srs_utime_t now)
+{
+    srs_utime_t elapsed = last_update_ ? srs_min(now - last_update_, SRS_UTIME_SECONDS) : 0;
+    last_update_ = now;
+
+    // The bandwidth we can trust, never more than the bitrate received by player.
+    int64_t acked = acked_bitrate_ ? srs_min(estimate_, acked_bitrate_) : estimate_;
+    bool can_decrease = now - last_decrease_ >= SRS_RTC_BWE_DECREASE_INTERVAL;
+
+    if (loss_ > 0.1) {
+        // Decrease by loss, see https://datatracker.ietf.org/doc/html/draft-ietf-rmcat-gcc-02#section-6
+        if (can_decrease) {
+            estimate_ = (int64_t)(acked * (1 - 0.5 * loss_));
+            last_decrease_ = now;
+        }
+    } else if (queuing_delay_ > SRS_RTC_BWE_OVERUSE) {
+        // Decrease by overuse of delay, see https://datatracker.ietf.org/doc/html/draft-ietf-rmcat-gcc-02#section-5.5
+        if (can_decrease) {
+            estimate_ = (int64_t)(acked * 0.85);
+            last_decrease_ = now;
+        }
+    } else if (loss_ < 0.02) {
+        // Increase 8% per second, if no loss and queuing.
+        estimate_ += srs_max(1000, (int64_t)(estimate_ * 0.08 * elapsed / SRS_UTIME_SECONDS));
+    }
+
+    estimate_ = srs_max(SRS_RTC_BWE_MIN, srs_min(SRS_RTC_BWE_MAX, estimate_));
+    if (remb_ > 0) {
+        estimate_ = srs_max(SRS_RTC_BWE_MIN, srs_min(estimate_, remb_));
+    }
+}
+
+ISrsRtcPacerHandler::ISrsRtcPacerHandler()
+{
+}
+
+ISrsRtcPacerHandler::~ISrsRtcPacerHandler()
+{
+}
+
+// The max burst of pacer, the budget is never more than the bytes of this duration.
+#define SRS_RTC_PACER_BURST (40 * SRS_UTIME_MILLISECONDS)
+
+SrsRtcPacer::SrsRtcPacer(ISrsRtcPacerHandler* h)
+{
+    handler_ = h;
+    rate_ = SRS_RTC_BWE_START;
+    max_delay_ = 200 * SRS_UTIME_MILLISECONDS;
+    budget_ = 0;
+    last_refill_ = 0;
+    delay_ = 0;
+}
+
+SrsRtcPacer::~SrsRtcPacer()
+{
+    for (std::deque<SrsRtcPacedPacket>::iterator it = queue_.begin(); it != queue_.end(); ++it) {
+        SrsRtcPacedPacket& pkt = *it;
+        srs_freepa(pkt.data);
+    }
+    queue_.clear();
+}
+
+void SrsRtcPacer::initialize(srs_utime_t max_delay)
+{
+    max_delay_ = max_delay;
+}
+
+void SrsRtcPacer::set_rate(int64_t rate)
+{
+    rate_ = rate;
+}
+
+srs_error_t SrsRtcPacer::send(char* data, int size, int twcc_sn, srs_utime_t now)
+{
+    srs_error_t err = srs_success;
+
+    refill(now);
+
+    if (queue_.empty() && budget_ > 0) {
+        budget_ -= size;
+        delay_ = 0.9 * delay_;
+        return handler_->on_pacer_send(data, size, twcc_sn);
+    }
+
+    SrsRtcPacedPacket pkt;
+    pkt.data = new char[size];
+    memcpy(pkt.data, data, size);
+    pkt.size = size;
+    pkt.twcc_sn = twcc_sn;
+    pkt.queued_at = now;
+    queue_.push_back(pkt);
+
+    return err;
+}
+
+srs_error_t SrsRtcPacer::flush(srs_utime_t now)
+{
+    srs_error_t err = srs_success;
+
+    refill(now);
+
+    while (!queue_.empty()) {
+        SrsRtcPacedPacket pkt = queue_.front();
+
+        // Never queue the packet too long, to avoid the extra latency.
+        srs_utime_t queued = now - pkt.queued_at;
+        if (budget_ <= 0 && queued < max_delay_) {
+            break;
+        }
+
+        queue_.pop_front();
+        budget_ -= pkt.size;
+        delay_ = 0.9 * delay_ + 0.1 * queued;
+
+        err = handler_->on_pacer_send(pkt.data, pkt.size, pkt.twcc_sn);
+        srs_freepa(pkt.data);
+        if (err != srs_success) {
+            return srs_error_wrap(err, "pacer send");
+        }
+    }
+
+    return err;
+}
+
+int SrsRtcPacer::size()
+{
+    return (int)queue_.size();
+}
+
+srs_utime_t SrsRtcPacer::delay()
+{
+    return (srs_utime_t)delay_;
+}
+
+void SrsRtcPacer::refill(srs_utime_t now)
+{
+    // The max budget, at least two packets for low rate.
+    double max_budget = srs_max(2 * kRtpPacketSize, (double)rate_ * SRS_RTC_PACER_BURST / SRS_UTIME_SECONDS / 8);
+
+    if (last_refill_ && now > last_refill_) {
+        budget_ += (double)rate_ * (now - last_refill_) / SRS_UTIME_SECONDS / 8;
+    } else if (!last_refill_) {
+        budget_ = max_budget;
+    }
+    last_refill_ = now;
+
+    // The budget is negative when sending overdue packets, which should not delay the next packets too much.
+    budget_ = srs_max(-max_budget, srs_min(max_budget, budget_));
+}
+
+SrsRtcConnectionPacerTimer::SrsRtcConnectionPacerTimer(SrsRtcConnection* p) : p_(p)
+{
+    _srs_hybrid->timer20ms()->subscribe(this);
+}
+
+SrsRtcConnectionPacerTimer::~SrsRtcConnectionPacerTimer()
+{
+    _srs_hybrid->timer20ms()->unsubscribe(this);
+}
+
+srs_error_t SrsRtcConnectionPacerTimer::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    if (!p_->pacer_) {
+        return err;
+    }
+
+    if ((err = p_->pacer_->flush(srs_get_system_time())) != srs_success) {
+        srs_warn("ignore pacer err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
+    return err;
+}
+
 SrsRtcConnectionNackTimer::SrsRtcConnectionNackTimer(SrsRtcConnection* p) : p_(p)
 {
     _srs_hybrid->timer20ms()->subscribe(this);
@@ -1750,6 +2232,8 @@ SrsRtcConnection::SrsRtcConnection(SrsRtcServer* s, const SrsContextId& cid)
     cache_iov_->iov_base = new char[kRtpPacketSize];
     cache_iov_->iov_len = kRtpPacketSize;
     cache_buffer_ = new SrsBuffer((char*)cache_iov_->iov_base, kRtpPacketSize);
+    rtcp_compound_ = new char[kRtcpPacketSize];
+    nn_rtcp_compound_ = 0;
 
     last_stun_time = 0;
     session_timeout = 0;
@@ -1761,6 +2245,11 @@ SrsRtcConnection::SrsRtcConnection(SrsRtcServer* s, const SrsContextId& cid)
 
     nack_enabled_ = false;
     timer_nack_ = new SrsRtcConnectionNackTimer(this);
+    timer_pacer_ = NULL;
+
+    bwe_ = NULL;
+    pacer_ = NULL;
+    pacing_factor_ = 0;
 
     _srs_rtc_manager->subscribe(this);
 }
@@ -1770,6 +2259,9 @@ SrsRtcConnection::~SrsRtcConnection()
     _srs_rtc_manager->unsubscribe(this);
 
     srs_freep(timer_nack_);
+    srs_freep(timer_pacer_);
+    srs_freep(pacer_);
+    srs_freep(bwe_);
 
     // Cleanup publishers.
     for(map<string, SrsRtcPublishStream*>::iterator it = publishers_.begin(); it != publishers_.end(); ++it) {
@@ -1796,6 +2288,7 @@ SrsRtcConnection::~SrsRtcConnection()
         srs_freep(cache_iov_);
     }
     srs_freep(cache_buffer_);
+    srs_freepa(rtcp_compound_);
 
     srs_freep(req_);
     srs_freep(pli_epp);
@@ -2110,13 +2603,65 @@ srs_error_t SrsRtcConnection::dispatch_rtcp(SrsRtcpCommon* rtcp)
 
 srs_error_t SrsRtcConnection::on_rtcp_feedback_twcc(char* data, int nb_data)
 {
-    return srs_success;
+    srs_error_t err = srs_success;
+
+    if (!bwe_) {
+        return err;
+    }
+
+    if ((err = bwe_->on_twcc(data, nb_data, srs_get_system_time())) != srs_success) {
+        return srs_error_wrap(err, "bwe twcc");
+    }
+
+    on_bwe_update();
+
+    return err;
 }
 
 srs_error_t SrsRtcConnection::on_rtcp_feedback_remb(SrsRtcpPsfbCommon *rtcp)
 {
-    //ignore REMB
-    return srs_success;
+    srs_error_t err = srs_success;
+
+    if (!bwe_) {
+        return err;
+    }
+
+    // Ignore the other application layer feedback.
+    uint64_t bitrate = 0;
+    if ((err = srs_rtcp_parse_remb(rtcp->data(), rtcp->size(), bitrate)) != srs_success) {
+        srs_freep(err);
+        return err;
+    }
+
+    bwe_->on_remb(bitrate);
+    on_bwe_update();
+
+    return err;
+}
+
+void SrsRtcConnection::on_bwe_update()
+{
+    pacer_->set_rate((int64_t)(bwe_->estimate() * pacing_factor_));
+
+    SrsStatistic* stat = SrsStatistic::instance();
+    for (map<string, SrsRtcPlayStream*>::iterator it = players_.begin(); it != players_.end(); ++it) {
+        SrsRtcPlayStream* player = it->second;
+        stat->on_rtc_bwe(player->context_id().c_str(), (int)(bwe_->estimate() / 1000), bwe_->loss(), srsu2msi(pacer_->delay()));
+    }
+}
+
+srs_error_t SrsRtcConnection::switch_layer(string cid, string rid)
+{
+    for (map<string, SrsRtcPlayStream*>::iterator it = players_.begin(); it != players_.end(); ++it) {
+        SrsRtcPlayStream* player = it->second;
+        if (cid != player->context_id().c_str()) {
+            continue;
+        }
+
+        return player->switch_layer(rid);
+    }
+
+    return srs_error_new(ERROR_RTC_NO_PLAYER, "no player cid=%s", cid.c_str());
 }
 
 srs_error_t SrsRtcConnection::on_rtp_cipher(char* data, int nb_data)
@@ -2160,6 +2705,16 @@ srs_error_t SrsRtcConnection::find_publisher(char* buf, int size, SrsRtcPublishS
 
     map<uint32_t, SrsRtcPublishStream*>::iterator it = publishers_ssrc_map_.find(ssrc);
     if(it == publishers_ssrc_map_.end()) {
+        // For RID based simulcast, the SSRC of layer is unknown until the first packet.
+        for (map<string, SrsRtcPublishStream*>::iterator it2 = publishers_.begin(); it2 != publishers_.end(); ++it2) {
+            SrsRtcPublishStream* publisher = it2->second;
+            if (publisher->bind_simulcast_layer(buf, size, ssrc)) {
+                publishers_ssrc_map_[ssrc] = publisher;
+                *ppublisher = publisher;
+                return err;
+            }
+        }
+
         return srs_error_new(ERROR_RTC_NO_PUBLISHER, "no publisher for ssrc:%u", ssrc);
     }
 
@@ -2261,6 +2816,61 @@ srs_error_t SrsRtcConnection::send_rtcp(char *data, int nb_data)
     return err;
 }
 
+srs_error_t SrsRtcConnection::append_rtcp(char* data, int nb_data)
+{
+    srs_error_t err = srs_success;
+
+    // Flush the compound packet if full, the size is limited to avoid IP fragmentation.
+    if (nn_rtcp_compound_ > 0 && nn_rtcp_compound_ + nb_data > SRS_RTCP_COMPOUND_SIZE) {
+        if ((err = flush_rtcp()) != srs_success) {
+            return srs_error_wrap(err, "flush");
+        }
+    }
+
+    // The buffer is kRtcpPacketSize, which reserves the trailer of SRTCP.
+    if (nn_rtcp_compound_ + nb_data > kMaxUDPDataSize) {
+        return srs_error_new(ERROR_RTC_RTCP, "rtcp too large, size=%d", nb_data);
+    }
+
+    memcpy(rtcp_compound_ + nn_rtcp_compound_, data, nb_data);
+    nn_rtcp_compound_ += nb_data;
+
+    return err;
+}
+
+srs_error_t SrsRtcConnection::flush_rtcp()
+{
+    srs_error_t err = srs_success;
+
+    if (!nn_rtcp_compound_) {
+        return err;
+    }
+
+    ++_srs_pps_srtcps->sugar;
+
+    int nb_buf = nn_rtcp_compound_;
+    nn_rtcp_compound_ = 0;
+
+    ISrsRtcNetwork* network = networks_->available();
+    if ((err = network->protect_rtcp(rtcp_compound_, &nb_buf)) != srs_success) {
+        return srs_error_wrap(err, "protect rtcp");
+    }
+
+    // Send by batch for UDP, to reduce the syscalls.
+    if (network == networks_->udp()) {
+        if ((err = networks_->udp()->write_batch(rtcp_compound_, nb_buf)) != srs_success) {
+            return srs_error_wrap(err, "send");
+        }
+        return err;
+    }
+
+    if ((err = network->write(rtcp_compound_, nb_buf, NULL)) != srs_success) {
+        return srs_error_wrap(err, "send");
+    }
+
+    return err;
+}
+
 void SrsRtcConnection::check_send_nacks(SrsRtpNackForReceiver* nack, uint32_t ssrc, uint32_t& sent_nacks, uint32_t& timeout_nacks)
 {
     ++_srs_pps_snack->sugar;
@@ -2289,8 +2899,6 @@ void SrsRtcConnection::check_send_nacks(SrsRtpNackForReceiver* nack, uint32_t ss
 
 srs_error_t SrsRtcConnection::send_rtcp_rr(uint32_t ssrc, SrsRtpRingBuffer* rtp_queue, const uint64_t& last_send_systime, const SrsNtp& last_send_ntp)
 {
-    ++_srs_pps_srtcps->sugar;
-
     // @see https://tools.ietf.org/html/rfc3550#section-6.4.2
     char buf[kRtpPacketSize];
     SrsBuffer stream(buf, sizeof(buf));
@@ -2324,13 +2932,11 @@ srs_error_t SrsRtcConnection::send_rtcp_rr(uint32_t ssrc, SrsRtpRingBuffer* rtp_
     srs_info("RR ssrc=%u, fraction_lost=%u, cumulative_number_of_packets_lost=%u, extended_highest_sequence=%u, interarrival_jitter=%u",
         ssrc, fraction_lost, cumulative_number_of_packets_lost, extended_highest_sequence, interarrival_jitter);
 
-    return send_rtcp(stream.data(), stream.pos());
+    return append_rtcp(stream.data(), stream.pos());
 }
 
 srs_error_t SrsRtcConnection::send_rtcp_xr_rrtr(uint32_t ssrc)
 {
-    ++_srs_pps_srtcps->sugar;
-
     /*
      @see: http://www.rfc-editor.org/rfc/rfc3611.html#section-2
 
@@ -2371,7 +2977,7 @@ srs_error_t SrsRtcConnection::send_rtcp_xr_rrtr(uint32_t ssrc)
     stream.write_4bytes(cur_ntp.ntp_second_);
     stream.write_4bytes(cur_ntp.ntp_fractions_);
 
-    return send_rtcp(stream.data(), stream.pos());
+    return append_rtcp(stream.data(), stream.pos());
 }
 
 srs_error_t SrsRtcConnection::send_rtcp_fb_pli(uint32_t ssrc, const SrsContextId& cid_of_subscriber)
@@ -2422,6 +3028,13 @@ srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
 {
     srs_error_t err = srs_success;
 
+    // Each packet sent has a new transport-wide sequence number, even for retransmission.
+    int twcc_sn = -1;
+    if (bwe_ && twcc_id_ > 0) {
+        twcc_sn = bwe_->generate_sn();
+        pkt->header.set_twcc_sequence_number(twcc_id_, (uint16_t)twcc_sn);
+    }
+
     // For this message, select the first iovec.
     iovec* iov = cache_iov_;
     iov->iov_len = kRtpPacketSize;
@@ -2451,6 +3064,14 @@ srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
         return err;
     }
 
+    // Send by pacer, which copies the packet if queued.
+    if (pacer_) {
+        if ((err = pacer_->send((char*)iov->iov_base, (int)iov->iov_len, twcc_sn, srs_get_system_time())) != srs_success) {
+            return srs_error_wrap(err, "pacer send");
+        }
+        return err;
+    }
+
     ++_srs_pps_srtps->sugar;
 
     if ((err = networks_->available()->write(iov->iov_base, iov->iov_len, NULL)) != srs_success) {
@@ -2466,6 +3087,25 @@ srs_error_t SrsRtcConnection::do_send_packet(SrsRtpPacket* pkt)
     return err;
 }
 
+srs_error_t SrsRtcConnection::on_pacer_send(char* data, int size, int twcc_sn)
+{
+    srs_error_t err = srs_success;
+
+    ++_srs_pps_srtps->sugar;
+
+    if ((err = networks_->available()->write(data, size, NULL)) != srs_success) {
+        srs_warn("RTC: Write %d bytes err %s", size, srs_error_desc(err).c_str());
+        srs_freep(err);
+        return err;
+    }
+
+    if (twcc_sn >= 0) {
+        bwe_->on_packet_sent((uint16_t)twcc_sn, size, srs_get_system_time());
+    }
+
+    return err;
+}
+
 void SrsRtcConnection::set_all_tracks_status(std::string stream_uri, bool is_publish, bool status)
 {
     // For publishers.
@@ -2585,13 +3225,16 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
         track_desc->set_direction("recvonly");
         track_desc->set_mid(remote_media_desc.mid_);
         // Whether feature enabled in remote extmap.
-        int remote_twcc_id = 0;
+        int remote_twcc_id = 0, remote_rid_id = 0, remote_mid_id = 0;
         if (true) {
             map<int, string> extmaps = remote_media_desc.get_extmaps();
             for(map<int, string>::iterator it = extmaps.begin(); it != extmaps.end(); ++it) {
                 if (it->second == kTWCCExt) {
                     remote_twcc_id = it->first;
-                    break;
+                } else if (it->second == kRidExt) {
+                    remote_rid_id = it->first;
+                } else if (it->second == kMidExt) {
+                    remote_mid_id = it->first;
                 }
             }
         }
@@ -2600,6 +3243,16 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
             track_desc->add_rtp_extension_desc(remote_twcc_id, kTWCCExt);
         }
 
+        // For RID based simulcast, the RID and MID extensions are required to identify the layers.
+        bool rid_simulcast = remote_media_desc.is_video() && remote_rid_id && remote_media_desc.rid_direction_ == "send"
+            && !remote_media_desc.rids_.empty();
+        if (rid_simulcast) {
+            track_desc->add_rtp_extension_desc(remote_rid_id, kRidExt);
+            if (remote_mid_id) {
+                track_desc->add_rtp_extension_desc(remote_mid_id, kMidExt);
+            }
+        }
+
         if (remote_media_desc.is_audio()) {
             // Update the ruc, which is about user specified configuration.
             ruc->audio_before_video_ = !nn_any_video_parsed;
@@ -2775,6 +3428,24 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
         track_desc->create_auxiliary_payload(remote_media_desc.find_media_with_encoding_name("rtx"));
         track_desc->create_auxiliary_payload(remote_media_desc.find_media_with_encoding_name("ulpfec"));
 
+        // For RID based simulcast, create a layer for each RID, and the SSRC is bound by the first packet.
+        // Note that we ignore the SSRC in SDP, because it's optional for RID.
+        if (rid_simulcast) {
+            std::string track_id = remote_media_desc.msid_tracker_;
+            if (track_id.empty()) {
+                track_id = "video-" + srs_random_str(8);
+            }
+
+            for (int j = 0; j < (int)remote_media_desc.rids_.size(); ++j) {
+                SrsRtcTrackDescription* track_desc_copy = track_desc->copy();
+                track_desc_copy->id_ = track_id;
+                track_desc_copy->msid_ = remote_media_desc.msid_;
+                track_desc_copy->rid_ = remote_media_desc.rids_.at(j);
+                stream_desc->video_track_descs_.push_back(track_desc_copy);
+            }
+            continue;
+        }
+
         std::string track_id;
         for (int j = 0; j < (int)remote_media_desc.ssrc_infos_.size(); ++j) {
             const SrsSSRCInfo& ssrc_info = remote_media_desc.ssrc_infos_.at(j);
@@ -2797,6 +3468,32 @@ srs_error_t SrsRtcConnection::negotiate_publish_capability(SrsRtcUserConfig* ruc
             track_id = ssrc_info.msid_tracker_;
         }
 
+        // For SSRC based simulcast, the first SSRC of SIM group is the track, and we create a layer
+        // for each SSRC, the layer is the index in group.
+        for (int j = 0; remote_media_desc.is_video() && j < (int)remote_media_desc.ssrc_groups_.size(); ++j) {
+            const SrsSSRCGroup& ssrc_group = remote_media_desc.ssrc_groups_.at(j);
+            if (ssrc_group.semantic_ != "SIM" || ssrc_group.ssrcs_.size() < 2) {
+                continue;
+            }
+
+            std::vector<SrsRtcTrackDescription*>& descs = stream_desc->video_track_descs_;
+            for (int k = 0; k < (int)descs.size(); ++k) {
+                SrsRtcTrackDescription* track_desc = descs.at(k);
+                if (track_desc->ssrc_ != ssrc_group.ssrcs_[0] || !track_desc->rid_.empty()) {
+                    continue;
+                }
+
+                track_desc->rid_ = "0";
+                for (int m = 1; m < (int)ssrc_group.ssrcs_.size(); ++m) {
+                    SrsRtcTrackDescription* layer = track_desc->copy();
+                    layer->ssrc_ = ssrc_group.ssrcs_[m];
+                    layer->rid_ = srs_int2str(m);
+                    descs.insert(descs.begin() + k + m, layer);
+                }
+                break;
+            }
+        }
+
         // set track fec_ssrc and rtx_ssrc
         for (int j = 0; j < (int)remote_media_desc.ssrc_groups_.size(); ++j) {
             const SrsSSRCGroup& ssrc_group = remote_media_desc.ssrc_groups_.at(j);
@@ -2909,6 +3606,11 @@ srs_error_t SrsRtcConnection::generate_publish_local_sdp_for_video(SrsSdp& local
     for (int i = 0;  i < (int)stream_desc->video_track_descs_.size(); ++i) {
         SrsRtcTrackDescription* video_track = stream_desc->video_track_descs_.at(i);
 
+        // For simulcast, all layers of track are in the same media description.
+        if (i > 0 && !video_track->rid_.empty() && video_track->id_ == stream_desc->video_track_descs_.at(i - 1)->id_) {
+            continue;
+        }
+
         local_sdp.media_descs_.push_back(SrsMediaDesc("video"));
         SrsMediaDesc& local_media_desc = local_sdp.media_descs_.back();
 
@@ -2943,6 +3645,19 @@ srs_error_t SrsRtcConnection::generate_publish_local_sdp_for_video(SrsSdp& local
             local_media_desc.payload_types_.push_back(payload->generate_media_payload_type());
         }
 
+        // For RID based simulcast, answer the RIDs to receive, whose SSRC is not bound yet.
+        for (int j = i; j < (int)stream_desc->video_track_descs_.size(); ++j) {
+            SrsRtcTrackDescription* layer = stream_desc->video_track_descs_.at(j);
+            if (layer->id_ != video_track->id_ || layer->rid_.empty() || layer->ssrc_) {
+                break;
+            }
+            local_media_desc.rids_.push_back(layer->rid_);
+        }
+        if (!local_media_desc.rids_.empty()) {
+            local_media_desc.rid_direction_ = "recv";
+            local_media_desc.simulcast_ = true;
+        }
+
         if(!unified_plan) {
             // For PlanB, only need media desc info, not ssrc info;
             break;
@@ -3044,6 +3759,11 @@ srs_error_t SrsRtcConnection::negotiate_play_capability(SrsRtcUserConfig* ruc, s
         }
 
         for (int j = 0; j < (int)track_descs.size(); ++j) {
+            // For simulcast, player only has one track for all layers, see SrsRtcPlayStream::send_packet.
+            if (j > 0 && !track_descs.at(j)->rid_.empty() && track_descs.at(j)->id_ == track_descs.at(j - 1)->id_) {
+                continue;
+            }
+
             SrsRtcTrackDescription* track = track_descs.at(j)->copy();
 
             // We should clear the extmaps of source(publisher).
@@ -3365,7 +4085,18 @@ srs_error_t SrsRtcConnection::create_player(SrsRequest* req, std::map<uint32_t,
             ++it;
         }
     }
-    srs_trace("RTC connection player gcc=%d", twcc_id);
+    // Enable the bandwidth estimation and pacer for player, by TWCC if negotiated, or REMB.
+    if (!bwe_ && _srs_config->get_rtc_bwe_enabled(req->vhost)) {
+        twcc_id_ = twcc_id;
+        pacing_factor_ = _srs_config->get_rtc_pacing_factor(req->vhost);
+
+        bwe_ = new SrsRtcBandwidthEstimator();
+        pacer_ = new SrsRtcPacer(this);
+        pacer_->initialize(_srs_config->get_rtc_pacing_max_delay(req->vhost));
+        pacer_->set_rate((int64_t)(bwe_->estimate() * pacing_factor_));
+        timer_pacer_ = new SrsRtcConnectionPacerTimer(this);
+    }
+    srs_trace("RTC connection player gcc=%d, bwe=%d", twcc_id, (bwe_ != NULL));
 
     // TODO: Start player when DTLS done. Removed it because we don't support single PC now.
     // If DTLS done, start the player. Because maybe create some players after DTLS done.
@@ -3420,6 +4151,11 @@ srs_error_t SrsRtcConnection::create_publisher(SrsRequest* req, SrsRtcSourceDesc
 
     for(int i = 0; i < (int)stream_desc->video_track_descs_.size(); ++i) {
         SrsRtcTrackDescription* track_desc = stream_desc->video_track_descs_.at(i);
+        // For RID based simulcast, the SSRC is bound when got the first packet, see find_publisher.
+        if (!track_desc->ssrc_) {
+            continue;
+        }
+
         if(publishers_ssrc_map_.end() != publishers_ssrc_map_.find(track_desc->ssrc_)) {
             return srs_error_new(ERROR_RTC_DUPLICATED_SSRC, " duplicate ssrc %d, track id: %s",
                 track_desc->ssrc_, track_desc->id_.c_str());
@@ -28,6 +28,7 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <deque>
 #include <sys/socket.h>
 
 class SrsUdpMuxSocket;
@@ -48,6 +49,7 @@ class SrsRtcVideoSendTrack;
 class SrsErrorPithyPrint;
 class SrsPithyPrint;
 class SrsStatistic;
+class SrsLatencyHistogram;
 class SrsRtcUserConfig;
 class SrsRtcSendTrack;
 class SrsRtcPublishStream;
@@ -229,6 +231,13 @@ private:
     SrsRtcSendTrack* cache_track0_;
     SrsRtcSendTrack* cache_track1_;
     SrsRtcSendTrack* cache_track2_;
+private:
+    // For simulcast, the send track for all layers, and the selector to switch layer.
+    SrsRtcVideoSendTrack* simulcast_track_;
+    SrsRtcLayerSelector* simulcast_selector_;
+    // The RID specified by API, empty to select by bandwidth estimation.
+    std::string simulcast_rid_;
+    srs_utime_t simulcast_selected_at_;
 private:
     // For merged-write messages.
     int mw_msgs;
@@ -259,6 +268,12 @@ public:
     virtual srs_error_t cycle();
 private:
     srs_error_t send_packet(SrsRtpPacket*& pkt);
+public:
+    // Switch to the simulcast layer of RID, or empty to select by bandwidth estimation.
+    srs_error_t switch_layer(std::string rid);
+private:
+    // Select the target layer about every second, request PLI when switching.
+    void update_simulcast_target();
 public:
     // Directly set the status of track, generally for init to set the default value.
     void set_all_tracks_status(bool status);
@@ -275,6 +290,9 @@ public:
     virtual srs_error_t do_request_keyframe(uint32_t ssrc, SrsContextId cid);
 };
 
+// The max size of compound RTCP packet, to avoid IP fragmentation.
+#define SRS_RTCP_COMPOUND_SIZE 1200
+
 // A fast timer for publish stream, for RTCP feedback.
 class SrsRtcPublishRtcpTimer : public ISrsFastTimer
 {
@@ -344,17 +362,23 @@ private:
     SrsRtcSource* source;
     // Simulators.
     int nn_simulate_nack_drop;
+    // The latency to handle a RTP packet, NULL if disabled.
+    SrsLatencyHistogram* latency_;
 private:
     // track vector
     std::vector<SrsRtcAudioRecvTrack*> audio_tracks_;
     std::vector<SrsRtcVideoRecvTrack*> video_tracks_;
 private:
     int twcc_id_;
+    // The RID extension id for simulcast, to bind SSRC of layer.
+    int rid_id_;
     uint8_t twcc_fb_count_;
     SrsRtcpTWCC rtcp_twcc_;
     SrsRtpExtensionTypes extension_types_;
     bool is_started;
     srs_utime_t last_time_send_twcc_;
+    // Whether the RR and XR should be sent with the next TWCC feedback.
+    bool rtcp_rr_pending_;
 public:
     SrsRtcPublishStream(SrsRtcConnection* session, const SrsContextId& cid);
     virtual ~SrsRtcPublishStream();
@@ -370,6 +394,8 @@ private:
 public:
     srs_error_t on_rtp_cipher(char* buf, int nb_buf);
     srs_error_t on_rtp_plaintext(char* buf, int nb_buf);
+    // For RID based simulcast, bind the SSRC to layer by the RID of packet, return whether bound.
+    bool bind_simulcast_layer(char* buf, int nb_buf, uint32_t ssrc);
 private:
     srs_error_t do_on_rtp_plaintext(SrsRtpPacket*& pkt, SrsBuffer* buf);
 public:
@@ -398,6 +424,129 @@ private:
     void update_send_report_time(uint32_t ssrc, const SrsNtp& ntp, uint32_t rtp_time);
 };
 
+// The sender-side bandwidth estimator for players, by the loss and queuing delay of TWCC feedback,
+// or the REMB of player if no TWCC. It's a simplified GCC, see
+// https://datatracker.ietf.org/doc/html/draft-ietf-rmcat-gcc-02
+class SrsRtcBandwidthEstimator
+{
+private:
+    // The sent packet, indexed by transport-wide sequence number.
+    struct SrsRtcSentPacket
+    {
+        uint16_t sn;
+        int size;
+        srs_utime_t sent_at;
+    };
+    // The circular array of sent packets, to find the packet of TWCC feedback in O(1).
+    SrsRtcSentPacket* sent_;
+    uint16_t next_sn_;
+private:
+    // The estimated bandwidth in bps.
+    int64_t estimate_;
+    // The bitrate of REMB from player, 0 if no REMB.
+    int64_t remb_;
+    // Whether got any TWCC feedback, the REMB is only a limit if TWCC works.
+    bool has_twcc_;
+    // The base one-way delay, which is the min delay in a window, because the clocks of sender and
+    // receiver are not synchronized. The next base delay is for the next window, to follow the drift.
+    int64_t base_delay_;
+    int64_t next_base_delay_;
+    srs_utime_t base_delay_at_;
+    // The smoothed queuing delay in us, the one-way delay over the base delay.
+    double queuing_delay_;
+    // The loss ratio of the last feedback, in [0, 1].
+    double loss_;
+    // The bitrate in bps received by player, of the last feedback.
+    int64_t acked_bitrate_;
+    srs_utime_t last_update_;
+    srs_utime_t last_decrease_;
+    // The packets status of feedback, reused to avoid allocation.
+    std::vector<SrsTwccPacketStatus> status_;
+public:
+    SrsRtcBandwidthEstimator();
+    virtual ~SrsRtcBandwidthEstimator();
+public:
+    // Allocate a transport-wide sequence number for packet to send.
+    uint16_t generate_sn();
+    // When packet with transport-wide sequence number is sent.
+    void on_packet_sent(uint16_t sn, int size, srs_utime_t now);
+    // When got TWCC feedback, the data is the RTCP packet.
+    srs_error_t on_twcc(char* data, int nb_data, srs_utime_t now);
+    // When got REMB feedback, the bitrate is in bps.
+    void on_remb(uint64_t bitrate);
+public:
+    // Get the estimated bandwidth in bps.
+    int64_t estimate();
+    double loss();
+    srs_utime_t queuing_delay();
+private:
+    void update(srs_utime_t now);
+};
+
+// The handler for pacer to send packet.
+class ISrsRtcPacerHandler
+{
+public:
+    ISrsRtcPacerHandler();
+    virtual ~ISrsRtcPacerHandler();
+public:
+    // Send the SRTP packet, the twcc_sn is -1 if no transport-wide sequence number.
+    virtual srs_error_t on_pacer_send(char* data, int size, int twcc_sn) = 0;
+};
+
+// The leaky bucket pacer, to send packets at the pacing rate rather than bursts of video frames,
+// and the packet is sent immediately if queued longer than max delay.
+class SrsRtcPacer
+{
+private:
+    struct SrsRtcPacedPacket
+    {
+        char* data;
+        int size;
+        int twcc_sn;
+        srs_utime_t queued_at;
+    };
+    std::deque<SrsRtcPacedPacket> queue_;
+    ISrsRtcPacerHandler* handler_;
+private:
+    // The pacing rate in bps.
+    int64_t rate_;
+    srs_utime_t max_delay_;
+    // The bytes allowed to send, refilled by pacing rate.
+    double budget_;
+    srs_utime_t last_refill_;
+    // The smoothed delay of packets in queue.
+    double delay_;
+public:
+    SrsRtcPacer(ISrsRtcPacerHandler* h);
+    virtual ~SrsRtcPacer();
+public:
+    void initialize(srs_utime_t max_delay);
+    void set_rate(int64_t rate);
+    // Send the packet if budget allows and no packet in queue, or copy it to queue.
+    srs_error_t send(char* data, int size, int twcc_sn, srs_utime_t now);
+    // Send the packets in queue by budget, or the packets queued longer than max delay.
+    srs_error_t flush(srs_utime_t now);
+public:
+    int size();
+    srs_utime_t delay();
+private:
+    void refill(srs_utime_t now);
+};
+
+// A fast timer for conntion, for pacer to send packets.
+class SrsRtcConnectionPacerTimer : public ISrsFastTimer
+{
+private:
+    SrsRtcConnection* p_;
+public:
+    SrsRtcConnectionPacerTimer(SrsRtcConnection* p);
+    virtual ~SrsRtcConnectionPacerTimer();
+// interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
+};
+
 // A fast timer for conntion, for NACK feedback.
 class SrsRtcConnectionNackTimer : public ISrsFastTimer
 {
@@ -415,7 +564,7 @@ private:
 //
 // For performance, we use non-public from resource,
 // see https://stackoverflow.com/questions/3747066/c-cannot-convert-from-base-a-to-derived-type-b-via-virtual-base-a
-class SrsRtcConnection : public ISrsResource, public ISrsDisposingHandler, public ISrsExpire
+class SrsRtcConnection : public ISrsResource, public ISrsDisposingHandler, public ISrsExpire, public ISrsRtcPacerHandler
 {
     friend class SrsSecurityTransport;
     friend class SrsRtcPlayStream;
@@ -423,6 +572,8 @@ class SrsRtcConnection : public ISrsResource, public ISrsDisposingHandler, publi
 private:
     friend class SrsRtcConnectionNackTimer;
     SrsRtcConnectionNackTimer* timer_nack_;
+    friend class SrsRtcConnectionPacerTimer;
+    SrsRtcConnectionPacerTimer* timer_pacer_;
 public:
     bool disposing_;
 private:
@@ -430,6 +581,9 @@ private:
 private:
     iovec* cache_iov_;
     SrsBuffer* cache_buffer_;
+    // The compound RTCP packet, to send the RR, XR and TWCC feedback of publishers in one packet.
+    char* rtcp_compound_;
+    int nn_rtcp_compound_;
 private:
     // key: stream id
     std::map<std::string, SrsRtcPlayStream*> players_;
@@ -465,6 +619,11 @@ private:
     SrsErrorPithyPrint* pli_epp;
 private:
     bool nack_enabled_;
+private:
+    // The sender-side bandwidth estimation and pacer for players, NULL if disabled.
+    SrsRtcBandwidthEstimator* bwe_;
+    SrsRtcPacer* pacer_;
+    double pacing_factor_;
 public:
     SrsRtcConnection(SrsRtcServer* s, const SrsContextId& cid);
     virtual ~SrsRtcConnection();
@@ -523,7 +682,12 @@ public:
 public:
     // send rtcp
     srs_error_t send_rtcp(char *data, int nb_data);
+    // Append the RTCP packet to the compound packet, which is sent when full or by flush_rtcp.
+    srs_error_t append_rtcp(char* data, int nb_data);
+    // Send the compound RTCP packet, by the batch of UDP.
+    srs_error_t flush_rtcp();
     void check_send_nacks(SrsRtpNackForReceiver* nack, uint32_t ssrc, uint32_t& sent_nacks, uint32_t& timeout_nacks);
+    // Append the RR and XR to the compound packet, which is sent by flush_rtcp.
     srs_error_t send_rtcp_rr(uint32_t ssrc, SrsRtpRingBuffer* rtp_queue, const uint64_t& last_send_systime, const SrsNtp& last_send_ntp);
     srs_error_t send_rtcp_xr_rrtr(uint32_t ssrc);
     srs_error_t send_rtcp_fb_pli(uint32_t ssrc, const SrsContextId& cid_of_subscriber);
@@ -532,6 +696,16 @@ public:
     void simulate_nack_drop(int nn);
     void simulate_player_drop_packet(SrsRtpHeader* h, int nn_bytes);
     srs_error_t do_send_packet(SrsRtpPacket* pkt);
+// interface ISrsRtcPacerHandler
+public:
+    virtual srs_error_t on_pacer_send(char* data, int size, int twcc_sn);
+private:
+    // Update the pacing rate and statistic of players, when bandwidth estimation changed.
+    void on_bwe_update();
+public:
+    // Switch the simulcast layer of player by context id, the rid is empty for auto.
+    srs_error_t switch_layer(std::string cid, std::string rid);
+public:
     // Directly set the status of play track, generally for init to set the default value.
     void set_all_tracks_status(std::string stream_uri, bool is_publish, bool status);
 public:
@@ -9,6 +9,7 @@
 using namespace std;
 
 #include <string.h>
+#include <algorithm>
 
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
@@ -20,6 +21,7 @@ using namespace std;
 #include <srs_app_log.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_protocol_utility.hpp>
+#include <srs_app_hybrid.hpp>
 
 #include <srtp2/srtp.h>
 #include <openssl/ssl.h>
@@ -188,6 +190,23 @@ SSL_CTX* srs_build_dtls_ctx(SrsDtlsVersion version, std::string role)
         srs_assert(SSL_CTX_set_tlsext_use_srtp(dtls_ctx, "SRTP_AES128_CM_SHA1_80") == 0);
     }
 
+    // Setup the session resumption for DTLS server, by session cache and tickets, which works because
+    // the context is shared by all connections.
+    if (role != "active") {
+        if (_srs_config->get_rtc_server_dtls_resumption()) {
+            // The session id context is required to resume session, because we request peer certificate.
+            // @see https://www.openssl.org/docs/man1.1.1/man3/SSL_CTX_set_session_id_context.html
+            static const string sid_ctx = RTMP_SIG_SRS_KEY;
+            SSL_CTX_set_session_id_context(dtls_ctx, (const unsigned char*)sid_ctx.data(), sid_ctx.size());
+            SSL_CTX_set_session_cache_mode(dtls_ctx, SSL_SESS_CACHE_SERVER);
+            SSL_CTX_sess_set_cache_size(dtls_ctx, 10240);
+            SSL_CTX_set_timeout(dtls_ctx, 300);
+        } else {
+            SSL_CTX_set_session_cache_mode(dtls_ctx, SSL_SESS_CACHE_OFF);
+            SSL_CTX_set_options(dtls_ctx, SSL_OP_NO_TICKET);
+        }
+    }
+
     return dtls_ctx;
 }
 #pragma GCC diagnostic pop
@@ -202,6 +221,11 @@ SrsDtlsCertificate::SrsDtlsCertificate()
 
 SrsDtlsCertificate::~SrsDtlsCertificate()
 {
+    for (std::map<std::string, SSL_CTX*>::iterator it = contexts_.begin(); it != contexts_.end(); ++it) {
+        SSL_CTX* ctx = it->second;
+        SSL_CTX_free(ctx);
+    }
+
     if (eckey) {
         EC_KEY_free(eckey);
     }
@@ -352,6 +376,12 @@ srs_error_t SrsDtlsCertificate::initialize()
         srs_trace("fingerprint=%s", fingerprint.c_str());
     }
 
+    // Pre-build the contexts of DTLS server, so the first connections never build it.
+    if (true) {
+        SSL_CTX* ctx = get_ctx(SrsDtlsVersionAuto, "passive");
+        SSL_CTX_free(ctx);
+    }
+
     return err;
 }
 
@@ -380,6 +410,88 @@ bool SrsDtlsCertificate::is_ecdsa()
     return ecdsa_mode;
 }
 
+SSL_CTX* SrsDtlsCertificate::get_ctx(SrsDtlsVersion version, std::string role)
+{
+    string key = srs_int2str(version) + "/" + role;
+
+    SSL_CTX* ctx = NULL;
+    std::map<std::string, SSL_CTX*>::iterator it = contexts_.find(key);
+    if (it != contexts_.end()) {
+        ctx = it->second;
+    } else {
+        ctx = contexts_[key] = srs_build_dtls_ctx(version, role);
+    }
+
+    // Increase the reference, because user frees it.
+    SSL_CTX_up_ref(ctx);
+    return ctx;
+}
+
+SrsDtlsStatistic::SrsDtlsStatistic()
+{
+    nn_handshaking_ = 0;
+    nn_handshakes_ = 0;
+    nn_resumed_ = 0;
+    nn_latencies_ = 0;
+    latencies_.resize(1024);
+}
+
+SrsDtlsStatistic::~SrsDtlsStatistic()
+{
+}
+
+void SrsDtlsStatistic::on_start()
+{
+    nn_handshaking_++;
+}
+
+void SrsDtlsStatistic::on_done(srs_utime_t latency, bool resumed)
+{
+    nn_handshaking_--;
+    nn_handshakes_++;
+    if (resumed) {
+        nn_resumed_++;
+    }
+
+    latencies_[nn_latencies_++ % latencies_.size()] = latency;
+}
+
+void SrsDtlsStatistic::on_abort()
+{
+    nn_handshaking_--;
+}
+
+int SrsDtlsStatistic::handshaking()
+{
+    return nn_handshaking_;
+}
+
+uint64_t SrsDtlsStatistic::handshakes()
+{
+    return nn_handshakes_;
+}
+
+uint64_t SrsDtlsStatistic::resumed()
+{
+    return nn_resumed_;
+}
+
+srs_utime_t SrsDtlsStatistic::percentile(double p)
+{
+    int size = (int)srs_min(nn_latencies_, (uint64_t)latencies_.size());
+    if (size == 0) {
+        return 0;
+    }
+
+    // Select the nth latency, the order of samples is not changed.
+    std::vector<srs_utime_t> samples(latencies_.begin(), latencies_.begin() + size);
+    int n = srs_max(0, srs_min(size - 1, (int)(p * size + 0.5) - 1));
+    std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+    return samples[n];
+}
+
+SrsDtlsStatistic* _srs_dtls_stat = NULL;
+
 ISrsDtlsCallback::ISrsDtlsCallback()
 {
 }
@@ -434,7 +546,7 @@ srs_error_t SrsDtlsImpl::initialize(std::string version, std::string role)
         version_ = SrsDtlsVersionAuto;
     }
 
-    dtls_ctx = srs_build_dtls_ctx(version_, role);
+    dtls_ctx = _srs_rtc_dtls_certificate->get_ctx(version_, role);
 
     if ((dtls = SSL_new(dtls_ctx)) == NULL) {
         return srs_error_new(ERROR_OpenSslCreateSSL, "SSL_new dtls");
@@ -645,6 +757,13 @@ srs_error_t SrsDtlsImpl::get_srtp_key(std::string& recv_key, std::string& send_k
 {
     srs_error_t err = srs_success;
 
+    // Already exported when handshake done.
+    if (!srtp_recv_key_.empty()) {
+        recv_key = srtp_recv_key_;
+        send_key = srtp_send_key_;
+        return err;
+    }
+
     unsigned char material[SRTP_MASTER_KEY_LEN * 2] = {0};  // client(SRTP_MASTER_KEY_KEY_LEN + SRTP_MASTER_KEY_SALT_LEN) + server
     static const string dtls_srtp_lable = "EXTRACTOR-dtls_srtp";
     if (!SSL_export_keying_material(dtls, material, sizeof(material), dtls_srtp_lable.c_str(), dtls_srtp_lable.size(), NULL, 0, 0)) {
@@ -669,6 +788,9 @@ srs_error_t SrsDtlsImpl::get_srtp_key(std::string& recv_key, std::string& send_k
         send_key = server_master_key + server_master_salt;
     }
 
+    srtp_recv_key_ = recv_key;
+    srtp_send_key_ = send_key;
+
     return err;
 }
 
@@ -681,6 +803,11 @@ void SrsDtlsImpl::callback_by_ssl(std::string type, std::string desc)
     }
 }
 
+bool SrsDtlsImpl::is_resumed()
+{
+    return SSL_session_reused(dtls) == 1;
+}
+
 SrsDtlsClientImpl::SrsDtlsClientImpl(ISrsDtlsCallback* callback) : SrsDtlsImpl(callback)
 {
     trd = NULL;
@@ -895,12 +1022,154 @@ srs_error_t SrsDtlsClientImpl::cycle()
     return err;
 }
 
+SrsDtlsDeferredCallback::SrsDtlsDeferredCallback(SrsDtlsImpl* dtls)
+{
+    dtls_ = dtls;
+    lock_ = new SrsThreadMutex();
+}
+
+SrsDtlsDeferredCallback::~SrsDtlsDeferredCallback()
+{
+    for (int i = 0; i < (int)events_.size(); i++) {
+        SrsDtlsDeferredEvent* event = events_.at(i);
+        srs_freep(event->err);
+        srs_freep(event);
+    }
+
+    srs_freep(lock_);
+}
+
+srs_error_t SrsDtlsDeferredCallback::on_dtls_handshake_done()
+{
+    srs_error_t err = srs_success;
+
+    SrsDtlsDeferredEvent* event = new SrsDtlsDeferredEvent();
+    event->type = SrsDtlsDeferredEvent::Done;
+    event->resumed = dtls_->is_resumed();
+    event->err = srs_success;
+
+    // Export the SRTP keys in the thread of handshake, so the SSL is never used by ST thread.
+    string recv_key, send_key;
+    if ((err = dtls_->get_srtp_key(recv_key, send_key)) != srs_success) {
+        event->type = SrsDtlsDeferredEvent::Error;
+        event->err = srs_error_wrap(err, "srtp key");
+    }
+
+    push(event);
+    return srs_success;
+}
+
+srs_error_t SrsDtlsDeferredCallback::on_dtls_application_data(const char* data, const int len)
+{
+    SrsDtlsDeferredEvent* event = new SrsDtlsDeferredEvent();
+    event->type = SrsDtlsDeferredEvent::Data;
+    event->data.assign(data, len);
+    event->resumed = false;
+    event->err = srs_success;
+
+    push(event);
+    return srs_success;
+}
+
+srs_error_t SrsDtlsDeferredCallback::write_dtls_data(void* data, int size)
+{
+    SrsDtlsDeferredEvent* event = new SrsDtlsDeferredEvent();
+    event->type = SrsDtlsDeferredEvent::Write;
+    event->data.assign((char*)data, size);
+    event->resumed = false;
+    event->err = srs_success;
+
+    push(event);
+    return srs_success;
+}
+
+srs_error_t SrsDtlsDeferredCallback::on_dtls_alert(std::string type, std::string desc)
+{
+    SrsDtlsDeferredEvent* event = new SrsDtlsDeferredEvent();
+    event->type = SrsDtlsDeferredEvent::Alert;
+    event->data = type;
+    event->desc = desc;
+    event->resumed = false;
+    event->err = srs_success;
+
+    push(event);
+    return srs_success;
+}
+
+void SrsDtlsDeferredCallback::on_error(srs_error_t err)
+{
+    SrsDtlsDeferredEvent* event = new SrsDtlsDeferredEvent();
+    event->type = SrsDtlsDeferredEvent::Error;
+    event->resumed = false;
+    event->err = err;
+
+    push(event);
+}
+
+void SrsDtlsDeferredCallback::fetch(std::vector<SrsDtlsDeferredEvent*>& events)
+{
+    SrsThreadLocker(lock_);
+
+    events.insert(events.end(), events_.begin(), events_.end());
+    events_.clear();
+}
+
+void SrsDtlsDeferredCallback::push(SrsDtlsDeferredEvent* event)
+{
+    SrsThreadLocker(lock_);
+    events_.push_back(event);
+}
+
+SrsDtlsTask::SrsDtlsTask(SrsThreadTaskContext* ctx, SrsDtlsServerImpl* dtls, char* data, int size) : SrsThreadTask(ctx)
+{
+    dtls_ = dtls;
+    data_ = new char[size];
+    size_ = size;
+    memcpy(data_, data, size);
+}
+
+SrsDtlsTask::~SrsDtlsTask()
+{
+    srs_freepa(data_);
+}
+
+void SrsDtlsTask::execute()
+{
+    dtls_->on_worker_dtls(data_, size_);
+}
+
+SrsThreadWorkerPool* _srs_dtls_worker_pool = NULL;
+
 SrsDtlsServerImpl::SrsDtlsServerImpl(ISrsDtlsCallback* callback) : SrsDtlsImpl(callback)
 {
+    // All callbacks of impl are deferred, then replayed to the handler of connection.
+    handler_ = callback;
+    deferred_ = new SrsDtlsDeferredCallback(this);
+    callback_ = deferred_;
+
+    worker_ = NULL;
+    timer_subscribed_ = false;
+    ctx_ = new SrsThreadTaskContext();
+    err_ = srs_success;
+    done_ = false;
+    starttime_ = 0;
 }
 
 SrsDtlsServerImpl::~SrsDtlsServerImpl()
 {
+    if (timer_subscribed_) {
+        _srs_hybrid->timer20ms()->unsubscribe(this);
+    }
+
+    // Drop the packets not handled, the worker thread never references the DTLS after canceled.
+    ctx_->cancel();
+
+    if (starttime_ && !done_) {
+        _srs_dtls_stat->on_abort();
+    }
+
+    srs_freep(err_);
+    srs_freep(deferred_);
 }
 
 srs_error_t SrsDtlsServerImpl::initialize(std::string version, std::string role)
@@ -914,6 +1183,16 @@ srs_error_t SrsDtlsServerImpl::initialize(std::string version, std::string role)
     // Dtls setup passive, as server role.
     SSL_set_accept_state(dtls);
 
+    // Bind to a worker, and replay the callbacks of worker periodically.
+    if (_srs_dtls_worker_pool) {
+        int nn_workers = _srs_config->get_threads_dtls_workers();
+        worker_ = _srs_dtls_worker_pool->pick(nn_workers, _srs_config->get_threads_dtls_queue());
+    }
+    if (worker_) {
+        _srs_hybrid->timer20ms()->subscribe(this);
+        timer_subscribed_ = true;
+    }
+
     return err;
 }
 
@@ -929,6 +1208,117 @@ bool SrsDtlsServerImpl::should_reset_timer()
     return false;
 }
 
+srs_error_t SrsDtlsServerImpl::on_dtls(char* data, int nb_data)
+{
+    srs_error_t err = srs_success;
+
+    // The handshake starts when got the first packet, generally the ClientHello.
+    if (!starttime_) {
+        starttime_ = srs_update_system_time();
+        _srs_dtls_stat->on_start();
+    }
+
+    // The error of previous packets, which is replayed by timer.
+    if (err_ != srs_success) {
+        err = err_;
+        err_ = srs_success;
+        return srs_error_wrap(err, "replay");
+    }
+
+    // Handshake in worker, until done and no pending packets, to handle the packets in order.
+    if (worker_ && (!done_ || ctx_->pending() > 0)) {
+        // Replay the callbacks of previous packets, which might fail.
+        if ((err = replay()) != srs_success) {
+            return srs_error_wrap(err, "replay");
+        }
+
+        worker_->push(new SrsDtlsTask(ctx_, this, data, nb_data));
+
+        return err;
+    }
+
+    err = SrsDtlsImpl::on_dtls(data, nb_data);
+
+    // Replay the callbacks even if failed, for example, the alert before error.
+    srs_error_t r0 = replay();
+    if (err != srs_success) {
+        srs_freep(r0);
+        return err;
+    }
+
+    return r0;
+}
+
+void SrsDtlsServerImpl::on_worker_dtls(char* data, int nb_data)
+{
+    srs_error_t err = srs_success;
+
+    if ((err = SrsDtlsImpl::on_dtls(data, nb_data)) != srs_success) {
+        deferred_->on_error(err);
+    }
+}
+
+srs_error_t SrsDtlsServerImpl::replay()
+{
+    srs_error_t err = srs_success;
+
+    std::vector<SrsDtlsDeferredEvent*> events;
+    deferred_->fetch(events);
+
+    for (int i = 0; i < (int)events.size(); i++) {
+        SrsDtlsDeferredEvent* event = events.at(i);
+
+        // Keep the first error, and free the events.
+        srs_error_t r0 = srs_success;
+        if (err != srs_success) {
+            srs_freep(event->err);
+        } else if (event->type == SrsDtlsDeferredEvent::Write) {
+            if ((r0 = handler_->write_dtls_data((void*)event->data.data(), event->data.size())) != srs_success) {
+                err = srs_error_wrap(r0, "dtls send size=%u", (int)event->data.size());
+            }
+        } else if (event->type == SrsDtlsDeferredEvent::Data) {
+            if ((r0 = handler_->on_dtls_application_data(event->data.data(), event->data.size())) != srs_success) {
+                err = srs_error_wrap(r0, "on DTLS data, size=%u", (int)event->data.size());
+            }
+        } else if (event->type == SrsDtlsDeferredEvent::Alert) {
+            if ((r0 = handler_->on_dtls_alert(event->data, event->desc)) != srs_success) {
+                srs_warn2(TAG_DTLS_ALERT, "DTLS: handler alert err %s", srs_error_desc(r0).c_str());
+                srs_freep(r0);
+            }
+        } else if (event->type == SrsDtlsDeferredEvent::Done) {
+            if (!done_) {
+                done_ = true;
+                srs_utime_t latency = srs_update_system_time() - starttime_;
+                _srs_dtls_stat->on_done(latency, event->resumed);
+                srs_trace("DTLS: Handshake done, resumed=%d, latency=%dms, worker=%d", event->resumed,
+                    srsu2msi(latency), worker_? worker_->id() : -1);
+            }
+            if ((r0 = handler_->on_dtls_handshake_done()) != srs_success) {
+                err = srs_error_wrap(r0, "dtls done");
+            }
+        } else if (event->type == SrsDtlsDeferredEvent::Error) {
+            err = event->err;
+        }
+
+        srs_freep(event);
+    }
+
+    return err;
+}
+
+srs_error_t SrsDtlsServerImpl::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    // The error is kept and returned by the next packet, like handshake in ST thread, because the error of
+    // timer is ignored.
+    if (err_ == srs_success && (err = replay()) != srs_success) {
+        err_ = err;
+    }
+
+    return srs_success;
+}
+
 srs_error_t SrsDtlsServerImpl::on_final_out_data(uint8_t* data, int size)
 {
     // No ARQ, driven by DTLS client packets.
@@ -11,13 +11,34 @@
 
 #include <string>
 #include <vector>
+#include <map>
 
 #include <openssl/ssl.h>
 #include <srtp2/srtp.h>
 
 #include <srs_app_st.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_app_hourglass.hpp>
 
 class SrsRequest;
+class SrsDtlsImpl;
+class SrsDtlsServerImpl;
+
+// @remark: play the role of DTLS_CLIENT, will send handshake
+// packet first.
+enum SrsDtlsRole {
+    SrsDtlsRoleClient,
+    SrsDtlsRoleServer
+};
+
+// @remark: DTLS_10 will all be ignored, and only DTLS1_2 will be accepted,
+// DTLS_10 Support will be completely removed in M84 or later.
+// TODO(https://bugs.webrtc.org/10261).
+enum SrsDtlsVersion {
+    SrsDtlsVersionAuto = -1,
+    SrsDtlsVersion1_0,
+    SrsDtlsVersion1_2
+};
 
 class SrsDtlsCertificate
 {
@@ -27,6 +48,9 @@ private:
     X509* dtls_cert;
     EVP_PKEY* dtls_pkey;
     EC_KEY* eckey;
+    // The DTLS contexts built from certificate, shared by all connections, so the session cache and
+    // tickets work for the clients to resume. Key is the version and role.
+    std::map<std::string, SSL_CTX*> contexts_;
 public:
     SrsDtlsCertificate();
     virtual ~SrsDtlsCertificate();
@@ -43,26 +67,45 @@ public:
     std::string get_fingerprint();
     // whether is ecdsa
     bool is_ecdsa();
+    // Get the shared DTLS context of version and role, which is built once, and user should free it
+    // by SSL_CTX_free, because we increase the reference count.
+    SSL_CTX* get_ctx(SrsDtlsVersion version, std::string role);
 };
 
 // @global config object.
 extern SrsDtlsCertificate* _srs_rtc_dtls_certificate;
 
-// @remark: play the role of DTLS_CLIENT, will send handshake
-// packet first.
-enum SrsDtlsRole {
-    SrsDtlsRoleClient,
-    SrsDtlsRoleServer
+// The statistic of DTLS handshakes, only used in ST thread.
+class SrsDtlsStatistic
+{
+private:
+    // The number of handshakes in progress, which are started but not done.
+    int nn_handshaking_;
+    uint64_t nn_handshakes_;
+    uint64_t nn_resumed_;
+    // The latency of recent handshakes, in a circular array, for percentiles.
+    std::vector<srs_utime_t> latencies_;
+    uint64_t nn_latencies_;
+public:
+    SrsDtlsStatistic();
+    virtual ~SrsDtlsStatistic();
+public:
+    // When got the first packet of handshake.
+    void on_start();
+    // When handshake done, with the latency since first packet, and whether resumed by session.
+    void on_done(srs_utime_t latency, bool resumed);
+    // When handshake is never done, for example, the connection is closed.
+    void on_abort();
+public:
+    int handshaking();
+    uint64_t handshakes();
+    uint64_t resumed();
+    // Get the percentile of latency of recent handshakes, p is in (0, 1], for example, 0.99 for p99.
+    srs_utime_t percentile(double p);
 };
 
-// @remark: DTLS_10 will all be ignored, and only DTLS1_2 will be accepted,
-// DTLS_10 Support will be completely removed in M84 or later.
-// TODO(https://bugs.webrtc.org/10261).
-enum SrsDtlsVersion {
-    SrsDtlsVersionAuto = -1,
-    SrsDtlsVersion1_0,
-    SrsDtlsVersion1_2
-};
+// It MUST be global and shared object, only used in ST thread.
+extern SrsDtlsStatistic* _srs_dtls_stat;
 
 class ISrsDtlsCallback
 {
@@ -100,6 +143,9 @@ protected:
     ISrsDtlsCallback* callback_;
     // @remark: dtls_version_ default value is SrsDtlsVersionAuto.
     SrsDtlsVersion version_;
+    // The SRTP keys exported when handshake done, so we never touch the SSL after it.
+    std::string srtp_recv_key_;
+    std::string srtp_send_key_;
 protected:
     // Whether the handshake is done, for us only.
     // @remark For us only, means peer maybe not done, we also need to handle the DTLS packet.
@@ -121,6 +167,8 @@ protected:
 public:
     srs_error_t get_srtp_key(std::string& recv_key, std::string& send_key);
     void callback_by_ssl(std::string type, std::string desc);
+    // Whether the handshake resumes a previous session, which skips the key exchange.
+    bool is_resumed();
 protected:
     virtual srs_error_t on_final_out_data(uint8_t* data, int size) = 0;
     virtual srs_error_t on_handshake_done() = 0;
@@ -158,8 +206,88 @@ public:
     virtual srs_error_t cycle();
 };
 
-class SrsDtlsServerImpl : public SrsDtlsImpl
+// The event of DTLS callback, recorded by worker thread and replayed in ST thread.
+struct SrsDtlsDeferredEvent
+{
+    enum Type {
+        Write, Data, Alert, Done, Error,
+    } type;
+    // The data to write or application data, or the alert type.
+    std::string data;
+    // The alert description.
+    std::string desc;
+    // Whether handshake done by resuming session.
+    bool resumed;
+    // The error of worker.
+    srs_error_t err;
+};
+
+// The callback of DTLS server, which records the callbacks, then the callbacks are replayed in ST thread,
+// because the handshake might be done by worker thread.
+class SrsDtlsDeferredCallback : public ISrsDtlsCallback
+{
+private:
+    SrsDtlsImpl* dtls_;
+    SrsThreadMutex* lock_;
+    std::vector<SrsDtlsDeferredEvent*> events_;
+public:
+    SrsDtlsDeferredCallback(SrsDtlsImpl* dtls);
+    virtual ~SrsDtlsDeferredCallback();
+// interface ISrsDtlsCallback
+public:
+    virtual srs_error_t on_dtls_handshake_done();
+    virtual srs_error_t on_dtls_application_data(const char* data, const int len);
+    virtual srs_error_t write_dtls_data(void* data, int size);
+    virtual srs_error_t on_dtls_alert(std::string type, std::string desc);
+public:
+    // Record the error, which is owned by callback.
+    void on_error(srs_error_t err);
+    // Fetch the recorded events, user should free them.
+    void fetch(std::vector<SrsDtlsDeferredEvent*>& events);
+private:
+    void push(SrsDtlsDeferredEvent* event);
+};
+
+// The task to handle a DTLS packet in worker thread.
+class SrsDtlsTask : public SrsThreadTask
+{
+private:
+    SrsDtlsServerImpl* dtls_;
+    // The copy of packet, owned by task.
+    char* data_;
+    int size_;
+public:
+    SrsDtlsTask(SrsThreadTaskContext* ctx, SrsDtlsServerImpl* dtls, char* data, int size);
+    virtual ~SrsDtlsTask();
+protected:
+    virtual void execute();
+};
+
+// The workers to do DTLS handshake, each connection is bound to a worker, so the packets are handled in order.
+// It MUST be thread-safe, global and shared object.
+extern SrsThreadWorkerPool* _srs_dtls_worker_pool;
+
+// The DTLS server, which handshakes in worker thread if enabled, while the callbacks are replayed in
+// ST thread, by the next packet or the 20ms timer.
+// @remark After handshake done, the packets are handled in ST thread, because it's cheap.
+class SrsDtlsServerImpl : public SrsDtlsImpl, public ISrsFastTimer
 {
+private:
+    // The callback of connection, while the callback_ of impl is the deferred callback.
+    ISrsDtlsCallback* handler_;
+    SrsDtlsDeferredCallback* deferred_;
+    // The worker to handshake, NULL to handshake in ST thread.
+    SrsThreadWorker* worker_;
+    // Whether subscribed timer to replay the callbacks of worker.
+    bool timer_subscribed_;
+    // The context of packets not handled yet, shared with the tasks.
+    SrsThreadTaskContext* ctx_;
+    // The error of replay by timer, returned by the next packet.
+    srs_error_t err_;
+    // Whether the handshake done event is replayed, in ST thread.
+    bool done_;
+    // The time when got the first packet.
+    srs_utime_t starttime_;
 public:
     SrsDtlsServerImpl(ISrsDtlsCallback* callback);
     virtual ~SrsDtlsServerImpl();
@@ -167,6 +295,16 @@ public:
     virtual srs_error_t initialize(std::string version, std::string role);
     virtual srs_error_t start_active_handshake();
     virtual bool should_reset_timer();
+    virtual srs_error_t on_dtls(char* data, int nb_data);
+public:
+    // Handle the packet, in worker thread.
+    void on_worker_dtls(char* data, int nb_data);
+private:
+    // Replay the callbacks to connection, in ST thread.
+    srs_error_t replay();
+// interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
 protected:
     virtual srs_error_t on_final_out_data(uint8_t* data, int size);
     virtual srs_error_t on_handshake_done();
@@ -7,6 +7,7 @@
 #include <srs_app_rtc_network.hpp>
 
 #include <arpa/inet.h>
+#include <errno.h>
 using namespace std;
 
 #include <srs_kernel_log.hpp>
@@ -23,6 +24,8 @@ using namespace std;
 #include <srs_kernel_buffer.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_app_utility.hpp>
+#include <srs_app_config.hpp>
+#include <srs_app_hybrid.hpp>
 
 #ifdef SRS_OSX
 // These functions are similar to the older byteorder(3) family of functions.
@@ -348,12 +351,7 @@ void SrsRtcUdpNetwork::update_sendonly_socket(SrsUdpMuxSocket* skt)
     // If no cache, build cache and setup the relations in connection.
     if (!addr_cache) {
         peer_addresses_[peer_id] = addr_cache = skt->copy_sendonly();
-        _srs_rtc_manager->add_with_id(peer_id, conn_);
-
-        uint64_t fast_id = skt->fast_id();
-        if (fast_id) {
-            _srs_rtc_manager->add_with_fast_id(fast_id, conn_);
-        }
+        _srs_rtc_manager->add_with_addr((sockaddr*)skt->peer_addr(), conn_);
     }
 
     // Update the transport.
@@ -427,6 +425,15 @@ srs_error_t SrsRtcUdpNetwork::on_binding_request(SrsStunPacket* r, string ice_pw
     return err;
 }
 
+srs_error_t SrsRtcUdpNetwork::write_batch(void* buf, size_t size)
+{
+    // Update stat when we sending data.
+    delta_->add_delta(0, size);
+
+    return _srs_rtcp_batch->sendto(sendonly_skt_->stfd(), buf, size, (sockaddr*)sendonly_skt_->peer_addr(),
+        sendonly_skt_->peer_addrlen());
+}
+
 srs_error_t SrsRtcUdpNetwork::write(void* buf, size_t size, ssize_t* nwrite)
 {
     // Update stat when we sending data.
@@ -957,3 +964,199 @@ void SrsRtcTcpConn::on_disposing(ISrsResource* c)
     return;
 }
 
+SrsUdpBatchSender* _srs_rtcp_batch = NULL;
+
+SrsUdpBatchSender::SrsUdpBatchSender()
+{
+    initialized_ = false;
+    trd_ = NULL;
+    cond_ = srs_cond_new();
+    flushing_ = false;
+    capacity_ = 0;
+    size_ = 0;
+    buffers_ = NULL;
+    iovs_ = NULL;
+    addrs_ = NULL;
+    addrlens_ = NULL;
+    fds_ = NULL;
+#if !defined(SRS_OSX) && !defined(SRS_CYGWIN64)
+    msgs_ = NULL;
+#endif
+    nn_packets_ = 0;
+    nn_syscalls_ = 0;
+}
+
+SrsUdpBatchSender::~SrsUdpBatchSender()
+{
+    srs_freep(trd_);
+    srs_cond_destroy(cond_);
+
+    srs_freepa(buffers_);
+    srs_freepa(iovs_);
+    srs_freepa(addrs_);
+    srs_freepa(addrlens_);
+    srs_freepa(fds_);
+#if !defined(SRS_OSX) && !defined(SRS_CYGWIN64)
+    srs_freepa(msgs_);
+#endif
+}
+
+void SrsUdpBatchSender::initialize(int capacity)
+{
+    if (initialized_) {
+        return;
+    }
+    initialized_ = true;
+
+    capacity_ = (capacity < 0) ? _srs_config->get_rtc_server_rtcp_batch() : capacity;
+    if (capacity_ <= 0) {
+        capacity_ = 0;
+        return;
+    }
+
+    buffers_ = new char[capacity_ * kRtcpPacketSize];
+    iovs_ = new iovec[capacity_];
+    addrs_ = new sockaddr_storage[capacity_];
+    addrlens_ = new socklen_t[capacity_];
+    fds_ = new srs_netfd_t[capacity_];
+#if !defined(SRS_OSX) && !defined(SRS_CYGWIN64)
+    msgs_ = new mmsghdr[capacity_];
+#endif
+
+    srs_trace("RTC: UDP batch sender, capacity=%d", capacity_);
+}
+
+srs_error_t SrsUdpBatchSender::sendto(srs_netfd_t fd, void* data, int size, const sockaddr* addr, socklen_t addrlen)
+{
+    srs_error_t err = srs_success;
+
+    initialize();
+
+    // Send directly if batch is disabled or busy, or the packet is too large.
+    if (!capacity_ || flushing_ || size > kRtcpPacketSize || addrlen > (socklen_t)sizeof(sockaddr_storage)) {
+        ++nn_packets_;
+        ++nn_syscalls_;
+        if (srs_sendto(fd, data, size, addr, addrlen, SRS_UTIME_NO_TIMEOUT) <= 0) {
+            return srs_error_new(ERROR_SOCKET_WRITE, "sendto");
+        }
+        return err;
+    }
+
+    // Start the coroutine to flush the batch, which is not full when producer yields.
+    if (!trd_) {
+        trd_ = new SrsSTCoroutine("rtcp-batch", this, _srs_context->get_id());
+        if ((err = trd_->start()) != srs_success) {
+            return srs_error_wrap(err, "start batch");
+        }
+    }
+
+    char* buf = buffers_ + size_ * kRtcpPacketSize;
+    memcpy(buf, data, size);
+    iovs_[size_].iov_base = buf;
+    iovs_[size_].iov_len = size;
+    memcpy(&addrs_[size_], addr, addrlen);
+    addrlens_[size_] = addrlen;
+    fds_[size_] = fd;
+
+    // Wakeup the coroutine to flush the first packet, when current coroutine yields.
+    if (++size_ == 1) {
+        srs_cond_signal(cond_);
+    }
+
+    // The packets are from other connections, so we never return the error to current one.
+    if (size_ >= capacity_) {
+        flush();
+    }
+
+    return err;
+}
+
+void SrsUdpBatchSender::flush()
+{
+    if (!size_ || flushing_) {
+        return;
+    }
+
+    // We might yield when socket is full, the packets of other coroutines are sent directly.
+    flushing_ = true;
+
+    for (int i = 0; i < size_;) {
+        // The packets of the same socket are sent by one syscall.
+        int n = 1;
+        while (i + n < size_ && fds_[i + n] == fds_[i]) {
+            n++;
+        }
+
+        int nn_sent = 0;
+#if !defined(SRS_OSX) && !defined(SRS_CYGWIN64)
+        if (n > 1) {
+            mmsghdr* msgs = msgs_ + i;
+            memset(msgs, 0, sizeof(mmsghdr) * n);
+            for (int j = 0; j < n; j++) {
+                msghdr& hdr = msgs[j].msg_hdr;
+                hdr.msg_name = &addrs_[i + j];
+                hdr.msg_namelen = addrlens_[i + j];
+                hdr.msg_iov = &iovs_[i + j];
+                hdr.msg_iovlen = 1;
+            }
+
+            ++nn_syscalls_;
+            int r0 = ::sendmmsg(srs_netfd_fileno(fds_[i]), msgs, n, MSG_DONTWAIT);
+            nn_sent = srs_max(0, r0);
+        }
+#endif
+
+        // Send the left packets one by one, which waits for the socket to be writable.
+        for (int j = nn_sent; j < n; j++) {
+            ++nn_syscalls_;
+            iovec& iov = iovs_[i + j];
+            int r0 = srs_sendto(fds_[i + j], iov.iov_base, iov.iov_len, (sockaddr*)&addrs_[i + j], addrlens_[i + j],
+                SRS_UTIME_NO_TIMEOUT);
+            if (r0 <= 0) {
+                srs_warn("RTC: batch sendto fd=%d, size=%d, errno=%d", srs_netfd_fileno(fds_[i + j]),
+                    (int)iov.iov_len, errno);
+            }
+        }
+
+        i += n;
+    }
+
+    nn_packets_ += size_;
+    size_ = 0;
+    flushing_ = false;
+}
+
+int SrsUdpBatchSender::size()
+{
+    return size_;
+}
+
+uint64_t SrsUdpBatchSender::packets()
+{
+    return nn_packets_;
+}
+
+uint64_t SrsUdpBatchSender::syscalls()
+{
+    return nn_syscalls_;
+}
+
+srs_error_t SrsUdpBatchSender::cycle()
+{
+    srs_error_t err = srs_success;
+
+    while (true) {
+        if ((err = trd_->pull()) != srs_success) {
+            return srs_error_wrap(err, "batch");
+        }
+
+        if (!size_) {
+            srs_cond_wait(cond_);
+            continue;
+        }
+
+        flush();
+    }
+
+    return err;
+}
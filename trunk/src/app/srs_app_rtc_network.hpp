@@ -11,6 +11,7 @@
 
 #include <string>
 #include <map>
+#include <sys/socket.h>
 
 #include <srs_protocol_conn.hpp>
 #include <srs_app_st.hpp>
@@ -166,6 +167,8 @@ public:
     // ICE reflexive address functions.
     std::string get_peer_ip();
     int get_peer_port();
+    // Write the packet to the batch, which is sent with other packets by one syscall.
+    srs_error_t write_batch(void* buf, size_t size);
 // Interface ISrsStreamWriter.
 public:
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
@@ -279,5 +282,58 @@ public:
     virtual void on_disposing(ISrsResource* c);
 };
 
+// The batch of UDP packets, to send the small packets of all connections by one syscall, for example,
+// the RTCP feedback of publishers. The packets are copied to the batch, which is flushed by sendmmsg
+// when full, or by a coroutine when the producer yields, that is, at the end of the current receive or
+// timer cycle, so the time-sensitive RTCP is never delayed by a timer.
+class SrsUdpBatchSender : public ISrsCoroutineHandler
+{
+private:
+    bool initialized_;
+    // The coroutine to flush the batch, started when got the first packet.
+    SrsCoroutine* trd_;
+    srs_cond_t cond_;
+    // Whether flushing, the packets are sent directly because the batch is busy.
+    bool flushing_;
+    // The max number of packets in batch, 0 to disable the batch.
+    int capacity_;
+    // The number of packets in batch.
+    int size_;
+    // The packets in batch, each slot of buffers_ is kRtcpPacketSize bytes.
+    char* buffers_;
+    iovec* iovs_;
+    sockaddr_storage* addrs_;
+    socklen_t* addrlens_;
+    srs_netfd_t* fds_;
+#if !defined(SRS_OSX) && !defined(SRS_CYGWIN64)
+    // The messages for sendmmsg.
+    mmsghdr* msgs_;
+#endif
+private:
+    uint64_t nn_packets_;
+    uint64_t nn_syscalls_;
+public:
+    SrsUdpBatchSender();
+    virtual ~SrsUdpBatchSender();
+public:
+    // Initialize the batch, the capacity is read from config if -1.
+    void initialize(int capacity = -1);
+    // Append the packet to batch, which is copied, or send it directly if the batch is disabled.
+    srs_error_t sendto(srs_netfd_t fd, void* data, int size, const sockaddr* addr, socklen_t addrlen);
+    // Send all packets in batch. The packets are from different connections, so the error is only logged.
+    void flush();
+public:
+    int size();
+    // The total number of packets and syscalls, for metrics.
+    uint64_t packets();
+    uint64_t syscalls();
+// Interface ISrsCoroutineHandler
+public:
+    virtual srs_error_t cycle();
+};
+
+// The batch to send RTCP packets.
+extern SrsUdpBatchSender* _srs_rtcp_batch;
+
 #endif
 
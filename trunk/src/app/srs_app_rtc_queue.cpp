@@ -167,6 +167,217 @@ void SrsRtpRingBuffer::clear_all_histroy()
     }
 }
 
+SrsRtpFrameBuffer::SrsRtpFrameBuffer(int capacity, srs_utime_t max_delay, int sample_rate)
+{
+    capacity_ = (uint16_t)capacity;
+    slots_ = new SrsRtpPacket*[capacity_];
+    memset(slots_, 0, sizeof(SrsRtpPacket*) * capacity_);
+
+    max_delay_ = (uint32_t)(max_delay * sample_rate / SRS_UTIME_SECONDS);
+    waiting_keyframe_ = true;
+    next_sn_ = ready_sn_ = 0;
+    ready_ts_ = 0;
+    initialized_ = false;
+    highest_sn_ = 0;
+    highest_ts_ = 0;
+    has_keyframe_ = false;
+    keyframe_sn_ = 0;
+    keyframe_ts_ = 0;
+    nn_dropped_ = 0;
+}
+
+SrsRtpFrameBuffer::~SrsRtpFrameBuffer()
+{
+    for (int i = 0; i < capacity_; ++i) {
+        SrsRtpPacket* pkt = slots_[i];
+        srs_freep(pkt);
+    }
+    srs_freepa(slots_);
+}
+
+void SrsRtpFrameBuffer::insert(SrsRtpPacket* pkt)
+{
+    uint16_t seq = pkt->header.get_sequence();
+    uint32_t ts = pkt->header.get_timestamp();
+
+    if (!initialized_ || srs_rtp_seq_distance(highest_sn_, seq) > 0) {
+        highest_sn_ = seq;
+        highest_ts_ = ts;
+        initialized_ = true;
+    }
+
+    // The packet before head frame, drop it except it's the late packet of head frame, for example,
+    // the SPS/PPS of keyframe arrives after the IDR.
+    if (!waiting_keyframe_ && srs_rtp_seq_distance(next_sn_, seq) < 0) {
+        SrsRtpPacket* head = at(next_sn_);
+        if (!head || head->header.get_timestamp() != ts || srs_rtp_seq_distance(seq, highest_sn_) >= capacity_) {
+            srs_freep(pkt);
+            nn_dropped_++;
+            return;
+        }
+
+        // Rescan the head frame from the late packet.
+        next_sn_ = ready_sn_ = seq;
+        if (has_keyframe_ && keyframe_ts_ == ts) {
+            keyframe_sn_ = seq;
+        }
+        set(seq, pkt);
+        return;
+    }
+
+    // Update the first packet of latest keyframe.
+    bool new_keyframe = false;
+    if (pkt->is_keyframe() && (!has_keyframe_ || (int32_t)(ts - keyframe_ts_) > 0)) {
+        has_keyframe_ = new_keyframe = true;
+        keyframe_sn_ = seq;
+        keyframe_ts_ = ts;
+    } else if (has_keyframe_ && keyframe_ts_ == ts && srs_rtp_seq_distance(keyframe_sn_, seq) < 0) {
+        keyframe_sn_ = seq;
+    }
+
+    // The buffer is overflow, because the lost packets are never recovered, drop to the next keyframe.
+    if (!waiting_keyframe_ && srs_rtp_seq_distance(next_sn_, seq) >= capacity_) {
+        drop_to_keyframe();
+    }
+
+    set(seq, pkt);
+
+    if (waiting_keyframe_ && new_keyframe) {
+        resync();
+    }
+}
+
+bool SrsRtpFrameBuffer::pop(std::vector<SrsRtpPacket*>& frame)
+{
+    while (!waiting_keyframe_) {
+        uint16_t start = 0, end = 0;
+        if (scan(start, end)) {
+            for (uint16_t sn = start; sn != (uint16_t)(end + 1); ++sn) {
+                frame.push_back(slots_[sn % capacity_]);
+                slots_[sn % capacity_] = NULL;
+            }
+            return true;
+        }
+
+        // Wait for the lost packets to be recovered, in the max delay.
+        if ((int32_t)(highest_ts_ - ready_ts_) <= (int32_t)max_delay_) {
+            return false;
+        }
+
+        drop_to_keyframe();
+    }
+
+    return false;
+}
+
+bool SrsRtpFrameBuffer::waiting_keyframe()
+{
+    return waiting_keyframe_;
+}
+
+uint64_t SrsRtpFrameBuffer::nn_dropped()
+{
+    return nn_dropped_;
+}
+
+SrsRtpPacket* SrsRtpFrameBuffer::at(uint16_t seq)
+{
+    SrsRtpPacket* pkt = slots_[seq % capacity_];
+    if (pkt && pkt->header.get_sequence() == seq) {
+        return pkt;
+    }
+    return NULL;
+}
+
+void SrsRtpFrameBuffer::set(uint16_t seq, SrsRtpPacket* pkt)
+{
+    SrsRtpPacket* p = slots_[seq % capacity_];
+    if (p) {
+        srs_freep(p);
+        nn_dropped_++;
+    }
+    slots_[seq % capacity_] = pkt;
+}
+
+bool SrsRtpFrameBuffer::scan(uint16_t& start, uint16_t& end)
+{
+    // All packets in [next_sn_, ready_sn_) are received, so we only check the packets from ready_sn_,
+    // and never rescan the received packets of head frame.
+    for (SrsRtpPacket* pkt = at(ready_sn_); pkt; pkt = at(ready_sn_)) {
+        // The packet of next frame, so the head frame ends by the previous packet.
+        if (ready_sn_ != next_sn_ && at(next_sn_)->header.get_timestamp() != pkt->header.get_timestamp()) {
+            start = next_sn_;
+            end = ready_sn_ - 1;
+            next_sn_ = ready_sn_;
+            return true;
+        }
+
+        ready_ts_ = pkt->header.get_timestamp();
+        ready_sn_++;
+
+        if (pkt->header.get_marker()) {
+            start = next_sn_;
+            end = ready_sn_ - 1;
+            next_sn_ = ready_sn_;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SrsRtpFrameBuffer::resync()
+{
+    // Find the first received packet of keyframe, for example, the SEI before the IDR.
+    for (int i = 0; i < capacity_; ++i) {
+        SrsRtpPacket* pkt = at(keyframe_sn_ - 1);
+        if (!pkt || pkt->header.get_timestamp() != keyframe_ts_) {
+            break;
+        }
+        keyframe_sn_--;
+    }
+
+    waiting_keyframe_ = false;
+    next_sn_ = ready_sn_ = keyframe_sn_;
+    ready_ts_ = keyframe_ts_;
+
+    // Free the packets before keyframe, which never be popped.
+    for (int i = 0; i < capacity_; ++i) {
+        SrsRtpPacket* pkt = slots_[i];
+        if (pkt && srs_rtp_seq_distance(next_sn_, pkt->header.get_sequence()) < 0) {
+            srs_freep(pkt);
+            slots_[i] = NULL;
+            nn_dropped_++;
+        }
+    }
+}
+
+void SrsRtpFrameBuffer::drop_to_keyframe()
+{
+    uint16_t lost_sn = ready_sn_;
+
+    // Only drop the tail of GOP, if the next keyframe is in buffer.
+    if (has_keyframe_ && srs_rtp_seq_distance(next_sn_, keyframe_sn_) > 0
+        && srs_rtp_seq_distance(keyframe_sn_, highest_sn_) < capacity_
+    ) {
+        resync();
+        srs_warn("RTC: Frame buffer lost seq=%u, drop to keyframe seq=%u, ts=%u, dropped=%" PRId64,
+            lost_sn, keyframe_sn_, keyframe_ts_, nn_dropped_);
+        return;
+    }
+
+    waiting_keyframe_ = true;
+    for (int i = 0; i < capacity_; ++i) {
+        SrsRtpPacket* pkt = slots_[i];
+        if (pkt) {
+            srs_freep(pkt);
+            slots_[i] = NULL;
+            nn_dropped_++;
+        }
+    }
+    srs_warn("RTC: Frame buffer lost seq=%u, wait for keyframe, dropped=%" PRId64, lost_sn, nn_dropped_);
+}
+
 SrsNackOption::SrsNackOption()
 {
     max_count = 15;
@@ -192,7 +403,8 @@ SrsNackOption::SrsNackOption()
 
 SrsRtpNackInfo::SrsRtpNackInfo()
 {
-    generate_time_ = srs_update_system_time();
+    seq_ = 0;
+    generate_time_ = 0;
     pre_req_nack_time_ = 0;
     req_nack_count_ = 0;
 }
@@ -204,12 +416,20 @@ SrsRtpNackForReceiver::SrsRtpNackForReceiver(SrsRtpRingBuffer* rtp, size_t queue
     pre_check_time_ = 0;
     rtt_ = 0;
 
+    infos_ = new SrsRtpNackInfo[SRS_RTC_NACK_WINDOW];
+    lost_ = new uint64_t[SRS_RTC_NACK_WINDOW / 64];
+    memset(lost_, 0, sizeof(uint64_t) * SRS_RTC_NACK_WINDOW / 64);
+    head_ = 0;
+    size_ = 0;
+
     srs_info("max_queue_size=%u, nack opt: max_count=%d, max_alive_time=%us, first_nack_interval=%" PRId64 ", nack_interval=%" PRId64,
         max_queue_size_, opts_.max_count, opts_.max_alive_time, opts_.first_nack_interval, opts_.nack_interval);
 }
 
 SrsRtpNackForReceiver::~SrsRtpNackForReceiver()
 {
+    srs_freepa(infos_);
+    srs_freepa(lost_);
 }
 
 void SrsRtpNackForReceiver::insert(uint16_t first, uint16_t last)
@@ -220,40 +440,69 @@ void SrsRtpNackForReceiver::insert(uint16_t first, uint16_t last)
         return;
     }
 
+    srs_utime_t now = srs_get_system_time();
     for (uint16_t s = first; s != last; ++s) {
-        queue_[s] = SrsRtpNackInfo();
+        // Drop the lost packets out of window, which is too old to recover.
+        while (size_ && srs_rtp_seq_distance(head_, s) >= SRS_RTC_NACK_WINDOW) {
+            rtp_->notify_drop_seq(head_);
+            erase(head_);
+        }
+
+        int index = s & (SRS_RTC_NACK_WINDOW - 1);
+        uint64_t mask = (uint64_t)1 << (index & 63);
+        if ((lost_[index >> 6] & mask) == 0) {
+            lost_[index >> 6] |= mask;
+            size_++;
+        }
+
+        SrsRtpNackInfo& info = infos_[index];
+        info.seq_ = s;
+        info.generate_time_ = now;
+        info.pre_req_nack_time_ = 0;
+        info.req_nack_count_ = 0;
+
+        if (size_ == 1 || srs_rtp_seq_distance(head_, s) < 0) {
+            head_ = s;
+        }
     }
 }
 
 void SrsRtpNackForReceiver::remove(uint16_t seq)
 {
-    queue_.erase(seq);
+    if (find(seq)) {
+        erase(seq);
+    }
 }
 
 SrsRtpNackInfo* SrsRtpNackForReceiver::find(uint16_t seq)
 {
-    std::map<uint16_t, SrsRtpNackInfo>::iterator iter = queue_.find(seq);
-
-    if (iter == queue_.end()) {
+    int index = seq & (SRS_RTC_NACK_WINDOW - 1);
+    if ((lost_[index >> 6] & ((uint64_t)1 << (index & 63))) == 0) {
         return NULL;
     }
 
-    return &(iter->second);
+    SrsRtpNackInfo* info = &infos_[index];
+    return info->seq_ == seq ? info : NULL;
 }
 
 void SrsRtpNackForReceiver::check_queue_size()
 {
-    if (queue_.size() >= max_queue_size_) {
+    if (size_ >= max_queue_size_) {
         rtp_->notify_nack_list_full();
-        queue_.clear();
+        clear();
     }
 }
 
+size_t SrsRtpNackForReceiver::size()
+{
+    return size_;
+}
+
 void SrsRtpNackForReceiver::get_nack_seqs(SrsRtcpNack& seqs, uint32_t& timeout_nacks)
 {
     // If circuit-breaker is enabled, disable nack.
     if (_srs_circuit_breaker->hybrid_high_water_level()) {
-        queue_.clear();
+        clear();
         ++_srs_pps_snack4->sugar;
         return;
     }
@@ -266,16 +515,29 @@ void SrsRtpNackForReceiver::get_nack_seqs(SrsRtcpNack& seqs, uint32_t& timeout_n
     }
     pre_check_time_ = now;
 
-    std::map<uint16_t, SrsRtpNackInfo>::iterator iter = queue_.begin();
-    while (iter != queue_.end()) {
-        const uint16_t& seq = iter->first;
-        SrsRtpNackInfo& nack_info = iter->second;
+    srs_utime_t nack_interval = srs_max(opts_.min_nack_interval, opts_.nack_interval / 3);
+    if(opts_.nack_interval < 50 * SRS_UTIME_MILLISECONDS){
+        nack_interval = srs_max(opts_.min_nack_interval, opts_.nack_interval);
+    }
+
+    // The chunk of PID and BLP to build.
+    bool has_chunk = false;
+    uint16_t pid = 0, blp = 0;
+
+    // Visit the lost packets in seq order, oldest to newest.
+    size_t left = size_;
+    uint16_t seq = head_;
+    while (left > 0) {
+        seq = next_lost(seq);
+        left--;
+
+        SrsRtpNackInfo& nack_info = infos_[seq & (SRS_RTC_NACK_WINDOW - 1)];
 
         int alive_time = now - nack_info.generate_time_;
         if (alive_time > opts_.max_alive_time || nack_info.req_nack_count_ > opts_.max_count) {
             ++timeout_nacks;
             rtp_->notify_drop_seq(seq);
-            queue_.erase(iter++);
+            erase(seq++);
             continue;
         }
 
@@ -284,18 +546,63 @@ void SrsRtpNackForReceiver::get_nack_seqs(SrsRtcpNack& seqs, uint32_t& timeout_n
             break;
         }
 
-        srs_utime_t nack_interval = srs_max(opts_.min_nack_interval, opts_.nack_interval / 3);
-        if(opts_.nack_interval < 50 * SRS_UTIME_MILLISECONDS){
-            nack_interval = srs_max(opts_.min_nack_interval, opts_.nack_interval);
-        }
-
         if (now - nack_info.pre_req_nack_time_ >= nack_interval ) {
             ++nack_info.req_nack_count_;
             nack_info.pre_req_nack_time_ = now;
-            seqs.add_lost_sn(seq);
+
+            // Append to current chunk, or start a new chunk.
+            uint16_t distance = seq - pid;
+            if (has_chunk && distance >= 1 && distance <= 16) {
+                blp |= 1 << (distance - 1);
+            } else {
+                if (has_chunk) {
+                    seqs.add_pid_blp(pid, blp);
+                }
+                has_chunk = true;
+                pid = seq;
+                blp = 0;
+            }
+        }
+
+        ++seq;
+    }
+
+    if (has_chunk) {
+        seqs.add_pid_blp(pid, blp);
+    }
+}
+
+void SrsRtpNackForReceiver::clear()
+{
+    memset(lost_, 0, sizeof(uint64_t) * SRS_RTC_NACK_WINDOW / 64);
+    size_ = 0;
+}
+
+void SrsRtpNackForReceiver::erase(uint16_t seq)
+{
+    int index = seq & (SRS_RTC_NACK_WINDOW - 1);
+    lost_[index >> 6] &= ~((uint64_t)1 << (index & 63));
+    size_--;
+
+    // Move head to the next lost packet.
+    if (size_ && seq == head_) {
+        head_ = next_lost(seq);
+    }
+}
+
+uint16_t SrsRtpNackForReceiver::next_lost(uint16_t seq)
+{
+    while (true) {
+        int index = seq & (SRS_RTC_NACK_WINDOW - 1);
+        uint64_t word = lost_[index >> 6] >> (index & 63);
+
+        // Skip the rest of word if no lost packet.
+        if (!word) {
+            seq += 64 - (index & 63);
+            continue;
         }
 
-        ++iter;
+        return seq + __builtin_ctzll(word);
     }
 }
 
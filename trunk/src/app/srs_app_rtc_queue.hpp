@@ -75,6 +75,71 @@ public:
     void clear_all_histroy();
 };
 
+// The max delay of frame buffer, to wait for the lost packets to be recovered by NACK.
+#define SRS_RTC_FRAME_MAX_DELAY (500 * SRS_UTIME_MILLISECONDS)
+
+// The jitter buffer to assemble the video frames from RTP packets, which stores the packets in slots
+// indexed by seq, like the ring buffer, and tracks the received packets of head frame incrementally:
+//      [seq1|seq2|seq3(marker)|seq4|seq5(lost)|seq6 ... seq10]
+//        \___(next_sn_)         \    \___(ready_sn_)
+//                                \___(frame of seq4 is not complete, wait for seq5)
+//      * seq1,seq2,seq3: The frame is complete, pop it out.
+//      * seq4: The packet of next frame, wait for the lost seq5.
+// A frame ends by the marker, or the next packet with a different timestamp. The frames are popped
+// in seq order, that is the DTS order. If the lost packets are not recovered in the max delay, we
+// drop the frames from the lost one to the next keyframe, which is the tail of GOP can't be decoded.
+class SrsRtpFrameBuffer
+{
+private:
+    // Capacity of slots.
+    uint16_t capacity_;
+    // The slots of packets, indexed by seq.
+    SrsRtpPacket** slots_;
+    // The max delay in RTP timestamp, to wait for the lost packets.
+    uint32_t max_delay_;
+    // Whether wait for a keyframe, because there is no decodable frame in buffer.
+    bool waiting_keyframe_;
+    // The first seq of the head frame, which is the next frame to pop.
+    uint16_t next_sn_;
+    // The first seq not received from the head frame, all packets in [next_sn_, ready_sn_) are received.
+    uint16_t ready_sn_;
+    // The timestamp of the last packet in [next_sn_, ready_sn_), to check the delay.
+    uint32_t ready_ts_;
+    // The highest seq and timestamp received, valid only when initialized.
+    bool initialized_;
+    uint16_t highest_sn_;
+    uint32_t highest_ts_;
+    // The first seq and timestamp of the latest keyframe.
+    bool has_keyframe_;
+    uint16_t keyframe_sn_;
+    uint32_t keyframe_ts_;
+    // The number of dropped packets.
+    uint64_t nn_dropped_;
+public:
+    SrsRtpFrameBuffer(int capacity, srs_utime_t max_delay, int sample_rate);
+    virtual ~SrsRtpFrameBuffer();
+public:
+    // Insert a packet to buffer, which is freed by buffer.
+    void insert(SrsRtpPacket* pkt);
+    // Pop the next complete frame, the packets are owned by caller.
+    // @return Whether there is a frame.
+    bool pop(std::vector<SrsRtpPacket*>& frame);
+    // Whether wait for a keyframe.
+    bool waiting_keyframe();
+    uint64_t nn_dropped();
+private:
+    // Get the packet by seq, NULL if not received.
+    SrsRtpPacket* at(uint16_t seq);
+    void set(uint16_t seq, SrsRtpPacket* pkt);
+    // Scan the packets from ready_sn_, got the seq range of frame by [start, end].
+    // @return Whether the head frame is complete.
+    bool scan(uint16_t& start, uint16_t& end);
+    // Resync the head frame to the latest keyframe, and free the packets before it.
+    void resync();
+    // Drop the frames from head frame to the next keyframe, or wait for a new keyframe.
+    void drop_to_keyframe();
+};
+
 struct SrsNackOption
 {
     int max_count;
@@ -91,6 +156,8 @@ struct SrsNackOption
 
 struct SrsRtpNackInfo
 {
+    // The seq of lost packet, to check the slot of tracker.
+    uint16_t seq_;
     // Use to control the time of first nack req and the life of seq.
     srs_utime_t generate_time_;
     // Use to control nack interval.
@@ -101,11 +168,23 @@ struct SrsRtpNackInfo
     SrsRtpNackInfo();
 };
 
+// The window of NACK tracker, must be power of 2 and larger than the capacity of ring buffer.
+#define SRS_RTC_NACK_WINDOW 2048
+
+// The NACK tracker for receiver. The lost packets are stored in a circular array indexed by seq, like
+// the ring buffer, with a bitmap of lost slots, so we find the lost packets in seq order by scanning
+// the words of bitmap, and build the compressed PID+BLP of NACK directly, no tree of map or set.
 class SrsRtpNackForReceiver
 {
 private:
-    // Nack queue, seq order, oldest to newest.
-    std::map<uint16_t, SrsRtpNackInfo, SrsSeqCompareLess> queue_;
+    // The lost packets, indexed by seq in window.
+    SrsRtpNackInfo* infos_;
+    // The bitmap of lost slots, a bit for each slot of infos_.
+    uint64_t* lost_;
+    // The oldest lost seq, valid only when there is any lost packet.
+    uint16_t head_;
+    // The number of lost packets.
+    size_t size_;
     // Max nack count.
     size_t max_queue_size_;
     SrsRtpRingBuffer* rtp_;
@@ -122,10 +201,16 @@ public:
     void remove(uint16_t seq);
     SrsRtpNackInfo* find(uint16_t seq);
     void check_queue_size();
+    size_t size();
 public:
     void get_nack_seqs(SrsRtcpNack& seqs, uint32_t& timeout_nacks);
 public:
     void update_rtt(int rtt);
+private:
+    void clear();
+    void erase(uint16_t seq);
+    // Find the next lost seq from seq, must have lost packets.
+    uint16_t next_lost(uint16_t seq);
 };
 
 #endif
@@ -308,6 +308,7 @@ SrsMediaDesc::SrsMediaDesc(const std::string& type)
     recvonly_ = false;
     sendonly_ = false;
     inactive_ = false;
+    simulcast_ = false;
 
     connection_ = "c=IN IP4 0.0.0.0";
 }
@@ -440,6 +441,18 @@ srs_error_t SrsMediaDesc::encode(std::ostringstream& os)
         }
     }
 
+    for (std::vector<std::string>::iterator iter = rids_.begin(); iter != rids_.end(); ++iter) {
+        os << "a=rid:" << *iter << " " << rid_direction_ << kCRLF;
+    }
+
+    if (simulcast_ && !rids_.empty()) {
+        os << "a=simulcast:" << rid_direction_ << " ";
+        for (int i = 0; i < (int)rids_.size(); ++i) {
+            os << (i ? ";" : "") << rids_.at(i);
+        }
+        os << kCRLF;
+    }
+
     for (std::vector<SrsSSRCInfo>::iterator iter = ssrc_infos_.begin(); iter != ssrc_infos_.end(); ++iter) {
         SrsSSRCInfo& ssrc_info = *iter;
 
@@ -510,6 +523,10 @@ srs_error_t SrsMediaDesc::parse_attribute(const std::string& content)
         return parse_attr_ssrc(value);
     } else if (attribute == "ssrc-group") {
         return parse_attr_ssrc_group(value);
+    } else if (attribute == "rid") {
+        return parse_attr_rid(value);
+    } else if (attribute == "simulcast") {
+        return parse_attr_simulcast(value);
     } else if (attribute == "rtcp-mux") {
         rtcp_mux_ = true;
     } else if (attribute == "rtcp-rsize") {
@@ -730,6 +747,65 @@ srs_error_t SrsMediaDesc::parse_attr_ssrc_group(const std::string& value)
     return err;
 }
 
+srs_error_t SrsMediaDesc::parse_attr_rid(const std::string& value)
+{
+    srs_error_t err = srs_success;
+    // @see: https://www.rfc-editor.org/rfc/rfc8851#section-10
+    // a=rid:<rid-id> <direction> [pt=<fmt-list>;<restriction>=<value>...]
+
+    std::istringstream is(value);
+
+    std::string rid, direction;
+    FETCH(is, rid);
+    FETCH(is, direction);
+
+    if (direction != "send" && direction != "recv") {
+        return srs_error_new(ERROR_RTC_SDP_DECODE, "invalid rid direction line=%s", value.c_str());
+    }
+
+    if (std::find(rids_.begin(), rids_.end(), rid) == rids_.end()) {
+        rids_.push_back(rid);
+    }
+    rid_direction_ = direction;
+
+    return err;
+}
+
+srs_error_t SrsMediaDesc::parse_attr_simulcast(const std::string& value)
+{
+    srs_error_t err = srs_success;
+    // @see: https://www.rfc-editor.org/rfc/rfc8853#section-5.1
+    // a=simulcast:<direction> <alt-rids>;<alt-rids>... where alt-rids is <rid>,<rid> and paused rid starts with ~
+
+    std::istringstream is(value);
+
+    std::string direction, streams;
+    FETCH(is, direction);
+    FETCH(is, streams);
+
+    if (direction != "send" && direction != "recv") {
+        return srs_error_new(ERROR_RTC_SDP_DECODE, "invalid simulcast direction line=%s", value.c_str());
+    }
+
+    // Use the first alternative of each stream, and fill the rids if no a=rid line.
+    std::vector<std::string> vec = split_str(streams, ";");
+    for (size_t i = 0; i < vec.size(); ++i) {
+        std::string rid = split_str(vec[i], ",").at(0);
+        if (!rid.empty() && rid.at(0) == '~') {
+            rid = rid.substr(1);
+        }
+
+        if (!rid.empty() && std::find(rids_.begin(), rids_.end(), rid) == rids_.end()) {
+            rids_.push_back(rid);
+        }
+    }
+
+    rid_direction_ = direction;
+    simulcast_ = true;
+
+    return err;
+}
+
 SrsSSRCInfo& SrsMediaDesc::fetch_or_create_ssrc_info(uint32_t ssrc)
 {
     for (size_t i = 0; i < ssrc_infos_.size(); ++i) {
@@ -16,6 +16,9 @@
 #include <vector>
 #include <map>
 const std::string kTWCCExt = "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
+// The RID and MID extensions for simulcast, see https://www.rfc-editor.org/rfc/rfc8852
+const std::string kRidExt = "urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id";
+const std::string kMidExt = "urn:ietf:params:rtp-hdrext:sdes:mid";
 
 // TDOO: FIXME: Rename it, and add utest.
 extern std::vector<std::string> split_str(const std::string& str, const std::string& delim);
@@ -151,6 +154,8 @@ private:
     srs_error_t parse_attr_ssrc(const std::string& value);
     srs_error_t parse_attr_ssrc_group(const std::string& value);
     srs_error_t parse_attr_extmap(const std::string& value);
+    srs_error_t parse_attr_rid(const std::string& value);
+    srs_error_t parse_attr_simulcast(const std::string& value);
 private:
     SrsSSRCInfo& fetch_or_create_ssrc_info(uint32_t ssrc);
 
@@ -178,6 +183,15 @@ public:
     std::vector<SrsSSRCGroup> ssrc_groups_;
     std::vector<SrsSSRCInfo>  ssrc_infos_;
     std::map<int, std::string> extmaps_;
+
+    // The RTP stream ids for simulcast, in the order of a=rid lines.
+    // @see https://www.rfc-editor.org/rfc/rfc8851
+    std::vector<std::string> rids_;
+    // The direction of rids, send for publisher offer and recv for answer.
+    std::string rid_direction_;
+    // Whether there is a=simulcast line.
+    // @see https://www.rfc-editor.org/rfc/rfc8853
+    bool simulcast_;
 };
 
 class SrsSdp
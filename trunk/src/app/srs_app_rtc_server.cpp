@@ -375,15 +375,8 @@ srs_error_t SrsRtcServer::on_udp_packet(SrsUdpMuxSocket* skt)
     bool is_rtp_or_rtcp = srs_is_rtp_or_rtcp((uint8_t*)data, size);
     bool is_rtcp = srs_is_rtcp((uint8_t*)data, size);
 
-    uint64_t fast_id = skt->fast_id();
-    // Try fast id first, if not found, search by long peer id.
-    if (fast_id) {
-        session = (SrsRtcConnection*)_srs_rtc_manager->find_by_fast_id(fast_id);
-    }
-    if (!session) {
-        string peer_id = skt->peer_id();
-        session = (SrsRtcConnection*)_srs_rtc_manager->find_by_id(peer_id);
-    }
+    // Find session by the raw peer address, for both IPv4 and IPv6.
+    session = (SrsRtcConnection*)_srs_rtc_manager->find_by_addr((sockaddr*)skt->peer_addr());
 
     if (session) {
         // When got any packet, the session is alive now.
@@ -407,13 +400,13 @@ srs_error_t SrsRtcServer::on_udp_packet(SrsUdpMuxSocket* skt)
             session->switch_to_context();
         }
 
-        srs_info("recv stun packet from %s, fast=%" PRId64 ", use-candidate=%d, ice-controlled=%d, ice-controlling=%d",
-            peer_id.c_str(), fast_id, ping.get_use_candidate(), ping.get_ice_controlled(), ping.get_ice_controlling());
+        srs_info("recv stun packet from %s, use-candidate=%d, ice-controlled=%d, ice-controlling=%d",
+            peer_id.c_str(), ping.get_use_candidate(), ping.get_ice_controlled(), ping.get_ice_controlling());
 
         // TODO: FIXME: For ICE trickle, we may get STUN packets before SDP answer, so maybe should response it.
         if (!session) {
-            return srs_error_new(ERROR_RTC_STUN, "no session, stun username=%s, peer_id=%s, fast=%" PRId64,
-                ping.get_username().c_str(), peer_id.c_str(), fast_id);
+            return srs_error_new(ERROR_RTC_STUN, "no session, stun username=%s, peer_id=%s",
+                ping.get_username().c_str(), peer_id.c_str());
         }
 
         // For each binding request, update the UDP socket.
@@ -427,7 +420,7 @@ srs_error_t SrsRtcServer::on_udp_packet(SrsUdpMuxSocket* skt)
     // For DTLS, RTCP or RTP, which does not support peer address changing.
     if (!session) {
         string peer_id = skt->peer_id();
-        return srs_error_new(ERROR_RTC_STUN, "no session, peer_id=%s, fast=%" PRId64, peer_id.c_str(), fast_id);
+        return srs_error_new(ERROR_RTC_STUN, "no session, peer_id=%s", peer_id.c_str());
     }
 
     // Note that we don't(except error) switch to the context of session, for performance issue.
@@ -480,6 +473,10 @@ srs_error_t SrsRtcServer::listen_api()
         return srs_error_wrap(err, "handle whip play");
     }
 
+    if ((err = http_api_mux->handle("/rtc/v1/layer/", new SrsGoApiRtcLayer(this))) != srs_success) {
+        return srs_error_wrap(err, "handle layer");
+    }
+
 #ifdef SRS_SIMULATOR
     if ((err = http_api_mux->handle("/rtc/v1/nack/", new SrsGoApiRtcNACK(this))) != srs_success) {
         return srs_error_wrap(err, "handle nack");
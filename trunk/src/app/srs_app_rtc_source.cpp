@@ -29,6 +29,7 @@
 #include <srs_app_log.hpp>
 #include <srs_app_threads.hpp>
 #include <srs_app_statistic.hpp>
+#include <srs_app_hybrid.hpp>
 
 #ifdef SRS_FFMPEG_FIT
 #include <srs_app_rtc_codec.hpp>
@@ -165,6 +166,7 @@ SrsRtcConsumer::SrsRtcConsumer(SrsRtcSource* s)
     mw_wait = srs_cond_new();
     mw_min_msgs = 0;
     mw_waiting = false;
+    latency_ = NULL;
 }
 
 SrsRtcConsumer::~SrsRtcConsumer()
@@ -185,12 +187,22 @@ void SrsRtcConsumer::update_source_id()
     should_update_source_id = true;
 }
 
+void SrsRtcConsumer::set_latency(SrsLatencyHistogram* v)
+{
+    latency_ = v;
+}
+
 srs_error_t SrsRtcConsumer::enqueue(SrsRtpPacket* pkt)
 {
     srs_error_t err = srs_success;
 
     queue.push_back(pkt);
 
+    // Only the sampled packets are timed, which are matched by the packet when dumped.
+    if (latency_ && latency_->sample()) {
+        times_.push_back(std::make_pair(pkt, srs_update_system_time()));
+    }
+
     if (mw_waiting) {
         if ((int)queue.size() > mw_min_msgs) {
             srs_cond_signal(mw_wait);
@@ -217,6 +229,11 @@ srs_error_t SrsRtcConsumer::dump_packet(SrsRtpPacket** ppkt)
         queue.erase(queue.begin());
     }
 
+    if (!times_.empty() && *ppkt && times_.front().first == *ppkt) {
+        latency_->update(srs_update_system_time() - times_.front().second);
+        times_.pop_front();
+    }
+
     return err;
 }
 
@@ -331,6 +348,95 @@ ISrsRtcSourceBridge::~ISrsRtcSourceBridge()
 {
 }
 
+SrsRtcSimulcastLayer::SrsRtcSimulcastLayer(std::string rid, uint32_t ssrc)
+{
+    rid_ = rid;
+    ssrc_ = ssrc;
+    kbps_ = 0;
+    bytes_ = 0;
+    starttime_ = 0;
+}
+
+SrsRtcLayerSelector::SrsRtcLayerSelector()
+{
+    current_ = target_ = 0;
+}
+
+SrsRtcLayerSelector::~SrsRtcLayerSelector()
+{
+}
+
+uint32_t SrsRtcLayerSelector::current()
+{
+    return current_;
+}
+
+uint32_t SrsRtcLayerSelector::target()
+{
+    return target_;
+}
+
+void SrsRtcLayerSelector::set_target(uint32_t ssrc)
+{
+    target_ = ssrc;
+}
+
+bool SrsRtcLayerSelector::switching()
+{
+    return target_ && target_ != current_;
+}
+
+bool SrsRtcLayerSelector::accept(SrsRtpPacket* pkt, bool& switched)
+{
+    switched = false;
+    uint32_t ssrc = pkt->header.get_ssrc();
+
+    // Switch to target layer only at the start of keyframe, for the middle of FU-A is not decodable.
+    if (ssrc == target_ && target_ != current_ && pkt->is_keyframe()) {
+        SrsRtpFUAPayload2* fua = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
+        if (!fua || fua->start) {
+            current_ = target_;
+            switched = true;
+        }
+    }
+
+    return ssrc == current_;
+}
+
+uint32_t SrsRtcLayerSelector::select(const std::vector<SrsRtcSimulcastLayer>& layers, int64_t bitrate)
+{
+    const SrsRtcSimulcastLayer* lowest = NULL;
+    const SrsRtcSimulcastLayer* highest = NULL;
+    const SrsRtcSimulcastLayer* fit = NULL;
+
+    for (int i = 0; i < (int)layers.size(); i++) {
+        const SrsRtcSimulcastLayer* layer = &layers.at(i);
+        if (!layer->ssrc_) {
+            continue;
+        }
+
+        if (!lowest || layer->kbps_ < lowest->kbps_) {
+            lowest = layer;
+        }
+        if (!highest || layer->kbps_ >= highest->kbps_) {
+            highest = layer;
+        }
+        if ((int64_t)layer->kbps_ * 1000 <= bitrate && (!fit || layer->kbps_ >= fit->kbps_)) {
+            fit = layer;
+        }
+    }
+
+    if (!highest) {
+        return 0;
+    }
+
+    if (bitrate <= 0) {
+        return highest->ssrc_;
+    }
+
+    return fit ? fit->ssrc_ : lowest->ssrc_;
+}
+
 SrsRtcSource::SrsRtcSource()
 {
     is_created_ = false;
@@ -341,8 +447,13 @@ SrsRtcSource::SrsRtcSource()
 
     req = NULL;
     bridge_ = NULL;
+    bridge_active_ = false;
 
     pli_for_rtmp_ = pli_elapsed_ = 0;
+    bridge_layer_ = new SrsRtcLayerSelector();
+
+    fanout_latency_ = NULL;
+    queue_latency_ = NULL;
 }
 
 SrsRtcSource::~SrsRtcSource()
@@ -351,6 +462,7 @@ SrsRtcSource::~SrsRtcSource()
     // for all consumers are auto free.
     consumers.clear();
 
+    srs_freep(bridge_layer_);
     srs_freep(bridge_);
     srs_freep(req);
     srs_freep(stream_desc_);
@@ -362,6 +474,9 @@ srs_error_t SrsRtcSource::initialize(SrsRequest* r)
 
     req = r->copy();
 
+    fanout_latency_ = SrsStatistic::instance()->latency(req, SrsLatencyStageRtcFanout);
+    queue_latency_ = SrsStatistic::instance()->latency(req, SrsLatencyStageRtcQueue);
+
 	// Create default relations to allow play before publishing.
 	// @see https://github.com/ossrs/srs/issues/2362
 	init_for_play_before_publishing();
@@ -475,6 +590,7 @@ srs_error_t SrsRtcSource::create_consumer(SrsRtcConsumer*& consumer)
     srs_error_t err = srs_success;
 
     consumer = new SrsRtcConsumer(this);
+    consumer->set_latency(queue_latency_);
     consumers.push_back(consumer);
 
     // TODO: FIXME: Implements edge cluster.
@@ -509,6 +625,11 @@ void SrsRtcSource::on_consumer_destroy(SrsRtcConsumer* consumer)
     }
 }
 
+bool SrsRtcSource::has_consumers()
+{
+    return !consumers.empty();
+}
+
 bool SrsRtcSource::can_publish()
 {
     // TODO: FIXME: Should check the status of bridge.
@@ -547,6 +668,7 @@ srs_error_t SrsRtcSource::on_publish()
 
         // The PLI interval for RTC2RTMP.
         pli_for_rtmp_ = _srs_config->get_rtc_pli_for_rtmp(req->vhost);
+        bridge_active_ = bridge_->active();
 
         // @see SrsRtcSource::on_timer()
         _srs_hybrid->timer100ms()->subscribe(this);
@@ -629,17 +751,60 @@ srs_error_t SrsRtcSource::on_rtp(SrsRtpPacket* pkt)
         return err;
     }
 
+    // For simulcast, update the bitrate of layers, and select the layer for bridge.
+    if (!layers_.empty() && !pkt->is_audio()) {
+        on_simulcast_packet(pkt);
+    }
+
+    bool sampled = fanout_latency_ && !consumers.empty() && fanout_latency_->sample();
+    srs_utime_t starttime = sampled ? srs_update_system_time() : 0;
     for (int i = 0; i < (int)consumers.size(); i++) {
         SrsRtcConsumer* consumer = consumers.at(i);
         if ((err = consumer->enqueue(pkt->copy())) != srs_success) {
             return srs_error_wrap(err, "consume message");
         }
     }
+    if (sampled) {
+        fanout_latency_->update(srs_update_system_time() - starttime);
+    }
 
     if (bridge_ && (err = bridge_->on_rtp(pkt)) != srs_success) {
         return srs_error_wrap(err, "bridge consume message");
     }
 
+    // Request PLI by next timer when lazy bridge is activated, see SrsRtcSource::on_timer().
+    if (bridge_ && bridge_active_ != bridge_->active()) {
+        bridge_active_ = bridge_->active();
+        if (bridge_active_) {
+            pli_elapsed_ = pli_for_rtmp_;
+        }
+    }
+
+    return err;
+}
+
+bool SrsRtcSource::can_bridge_video(uint32_t ssrc)
+{
+    if (!bridge_ || !bridge_->active()) {
+        return false;
+    }
+
+    // For simulcast, only bridge the selected layer, see on_simulcast_packet().
+    if (is_simulcast_layer(ssrc)) {
+        return ssrc == bridge_layer_->current();
+    }
+
+    return true;
+}
+
+srs_error_t SrsRtcSource::on_frame(const std::vector<SrsRtpPacket*>& frame)
+{
+    srs_error_t err = srs_success;
+
+    if (bridge_ && (err = bridge_->on_frame(frame)) != srs_success) {
+        return srs_error_wrap(err, "bridge consume frame");
+    }
+
     return err;
 }
 
@@ -655,6 +820,22 @@ void SrsRtcSource::set_stream_desc(SrsRtcSourceDescription* stream_desc)
     if (stream_desc) {
         stream_desc_ = stream_desc->copy();
     }
+
+    // Build the layers from the first simulcast video track.
+    layers_.clear();
+    for (int i = 0; stream_desc_ && i < (int)stream_desc_->video_track_descs_.size(); i++) {
+        SrsRtcTrackDescription* desc = stream_desc_->video_track_descs_.at(i);
+        if (desc->rid_.empty()) {
+            continue;
+        }
+        if (!layers_.empty() && desc->id_ != stream_desc_->video_track_descs_.at(i - 1)->id_) {
+            break;
+        }
+        layers_.push_back(SrsRtcSimulcastLayer(desc->rid_, desc->ssrc_));
+    }
+
+    srs_freep(bridge_layer_);
+    bridge_layer_ = new SrsRtcLayerSelector();
 }
 
 std::vector<SrsRtcTrackDescription*> SrsRtcSource::get_track_desc(std::string type, std::string media_name)
@@ -684,6 +865,87 @@ std::vector<SrsRtcTrackDescription*> SrsRtcSource::get_track_desc(std::string ty
     return track_descs;
 }
 
+std::vector<SrsRtcSimulcastLayer> SrsRtcSource::simulcast_layers()
+{
+    return layers_;
+}
+
+bool SrsRtcSource::is_simulcast_layer(uint32_t ssrc)
+{
+    for (int i = 0; i < (int)layers_.size(); i++) {
+        if (layers_.at(i).ssrc_ == ssrc) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SrsRtcSource::on_simulcast_bind(std::string rid, uint32_t ssrc)
+{
+    for (int i = 0; i < (int)layers_.size(); i++) {
+        SrsRtcSimulcastLayer& layer = layers_.at(i);
+        if (layer.rid_ == rid) {
+            layer.ssrc_ = ssrc;
+        }
+    }
+
+    for (int i = 0; stream_desc_ && i < (int)stream_desc_->video_track_descs_.size(); i++) {
+        SrsRtcTrackDescription* desc = stream_desc_->video_track_descs_.at(i);
+        if (desc->rid_ == rid) {
+            desc->ssrc_ = ssrc;
+        }
+    }
+}
+
+void SrsRtcSource::on_simulcast_packet(SrsRtpPacket* pkt)
+{
+    uint32_t ssrc = pkt->header.get_ssrc();
+
+    SrsRtcSimulcastLayer* layer = NULL;
+    for (int i = 0; i < (int)layers_.size(); i++) {
+        if (layers_.at(i).ssrc_ == ssrc) {
+            layer = &layers_.at(i);
+            break;
+        }
+    }
+
+    // Not a layer of simulcast, for example, the other video track.
+    if (!layer) {
+        return;
+    }
+
+    // Sample the bitrate about every second, and select the highest layer for bridge.
+    srs_utime_t now = srs_get_system_time();
+    if (!layer->starttime_) {
+        layer->starttime_ = now;
+    }
+    layer->bytes_ += pkt->nb_bytes();
+
+    srs_utime_t elapsed = now - layer->starttime_;
+    if (elapsed >= SRS_UTIME_SECONDS) {
+        layer->kbps_ = (int)(layer->bytes_ * 8 / srsu2ms(elapsed));
+        layer->bytes_ = 0;
+        layer->starttime_ = now;
+
+        uint32_t target = SrsRtcLayerSelector::select(layers_, 0);
+        if (target && target != bridge_layer_->target()) {
+            bridge_layer_->set_target(target);
+        }
+    }
+
+    // Start bridge from the first bound layer, before the bitrate is sampled.
+    if (!bridge_layer_->target()) {
+        bridge_layer_->set_target(ssrc);
+    }
+
+    // Switch at the keyframe of target layer, whose receive track restarts the jitter buffer from it.
+    bool switched = false;
+    bridge_layer_->accept(pkt, switched);
+    if (switched) {
+        srs_trace("RTC: Bridge switch to simulcast layer rid=%s, ssrc=%u, kbps=%d", layer->rid_.c_str(), ssrc, layer->kbps_);
+    }
+}
+
 srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
 {
     srs_error_t err = srs_success;
@@ -692,6 +954,11 @@ srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
         return err;
     }
 
+    // Never request PLI when bridge is suspended.
+    if (!bridge_active_) {
+        return err;
+    }
+
     // Request PLI and reset the timer.
     if (true) {
         pli_elapsed_ += interval;
@@ -701,6 +968,15 @@ srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
         pli_elapsed_ = 0;
     }
 
+    // For simulcast, only request PLI for the layer of bridge.
+    if (!layers_.empty()) {
+        uint32_t ssrc = bridge_layer_->switching() ? bridge_layer_->target() : bridge_layer_->current();
+        if (ssrc) {
+            publish_stream_->request_keyframe(ssrc);
+        }
+        return err;
+    }
+
     for (int i = 0; i < (int)stream_desc_->video_track_descs_.size(); i++) {
         SrsRtcTrackDescription* desc = stream_desc_->video_track_descs_.at(i);
         publish_stream_->request_keyframe(desc->ssrc_);
@@ -709,6 +985,67 @@ srs_error_t SrsRtcSource::on_timer(srs_utime_t interval)
     return err;
 }
 
+SrsLazyBridge::SrsLazyBridge()
+{
+    enabled_ = false;
+    grace_ = 0;
+    active_ = true;
+    idle_at_ = 0;
+}
+
+SrsLazyBridge::~SrsLazyBridge()
+{
+}
+
+void SrsLazyBridge::initialize(bool enabled, srs_utime_t grace)
+{
+    enabled_ = enabled;
+    grace_ = grace;
+
+    // Start from suspended, until there are consumers.
+    active_ = !enabled;
+    idle_at_ = 0;
+}
+
+bool SrsLazyBridge::update(bool has_consumers)
+{
+    if (!enabled_) {
+        return false;
+    }
+
+    if (has_consumers) {
+        idle_at_ = 0;
+        if (active_) {
+            return false;
+        }
+
+        active_ = true;
+        return true;
+    }
+
+    if (!active_) {
+        return false;
+    }
+
+    // Suspend after the grace period, for consumers might reconnect soon.
+    srs_utime_t now = srs_get_system_time();
+    if (!idle_at_) {
+        idle_at_ = now;
+    }
+    if (now - idle_at_ < grace_) {
+        return false;
+    }
+
+    active_ = false;
+    idle_at_ = 0;
+    return true;
+}
+
+bool SrsLazyBridge::active()
+{
+    return active_;
+}
+
 #ifdef SRS_FFMPEG_FIT
 
 SrsRtcFromRtmpBridge::SrsRtcFromRtmpBridge(SrsRtcSource* source)
@@ -716,7 +1053,10 @@ SrsRtcFromRtmpBridge::SrsRtcFromRtmpBridge(SrsRtcSource* source)
     req = NULL;
     source_ = source;
     format = new SrsRtmpFormat();
-    codec_ = new SrsAudioTranscoder();
+    codec_ = new SrsAsyncAudioTranscoder();
+    timer_subscribed_ = false;
+    lazy_ = new SrsLazyBridge();
+    wait_keyframe_ = false;
     latest_codec_ = SrsAudioCodecIdForbidden;
     rtmp_to_rtc = false;
     keep_bframe = false;
@@ -748,9 +1088,14 @@ SrsRtcFromRtmpBridge::SrsRtcFromRtmpBridge(SrsRtcSource* source)
 
 SrsRtcFromRtmpBridge::~SrsRtcFromRtmpBridge()
 {
+    if (timer_subscribed_) {
+        _srs_hybrid->timer20ms()->unsubscribe(this);
+    }
+
     srs_freep(format);
     srs_freep(codec_);
     srs_freep(meta);
+    srs_freep(lazy_);
 }
 
 srs_error_t SrsRtcFromRtmpBridge::initialize(SrsRequest* r)
@@ -771,8 +1116,13 @@ srs_error_t SrsRtcFromRtmpBridge::initialize(SrsRequest* r)
 
     keep_bframe = _srs_config->get_rtc_keep_bframe(req->vhost);
     merge_nalus = _srs_config->get_rtc_server_merge_nalus();
-    srs_trace("RTC bridge from RTMP, rtmp2rtc=%d, keep_bframe=%d, merge_nalus=%d",
-              rtmp_to_rtc, keep_bframe, merge_nalus);
+
+    bool lazy = _srs_config->get_rtc_bridge_lazy(req->vhost);
+    srs_utime_t grace = _srs_config->get_rtc_bridge_grace(req->vhost);
+    lazy_->initialize(lazy, grace);
+
+    srs_trace("RTC bridge from RTMP, rtmp2rtc=%d, keep_bframe=%d, merge_nalus=%d, lazy=%d, grace=%dms",
+              rtmp_to_rtc, keep_bframe, merge_nalus, lazy, srsu2msi(grace));
 
     return err;
 }
@@ -821,6 +1171,11 @@ srs_error_t SrsRtcFromRtmpBridge::on_audio(SrsSharedPtrMessage* msg)
         return err;
     }
 
+    // When suspended, only parse the sequence header to update the codec information.
+    if (!update_lazy() && !SrsFlvAudio::sh(msg->payload, msg->size)) {
+        return err;
+    }
+
     // TODO: FIXME: Support parsing OPUS for RTC.
     if ((err = format->on_audio(msg)) != srs_success) {
         return srs_error_wrap(err, "format consume audio");
@@ -879,6 +1234,21 @@ srs_error_t SrsRtcFromRtmpBridge::on_audio(SrsSharedPtrMessage* msg)
     return err;
 }
 
+bool SrsRtcFromRtmpBridge::update_lazy()
+{
+    if (lazy_->update(source_->has_consumers())) {
+        if (lazy_->active()) {
+            // The RTMP publisher is not able to generate keyframe, so we wait for the next one.
+            wait_keyframe_ = true;
+            srs_trace("RTMP2RTC: Bridge activated by consumers, wait for keyframe");
+        } else {
+            srs_trace("RTMP2RTC: Bridge suspended for no consumers");
+        }
+    }
+
+    return lazy_->active();
+}
+
 srs_error_t SrsRtcFromRtmpBridge::init_codec(SrsAudioCodecId codec)
 {
     srs_error_t err = srs_success;
@@ -886,9 +1256,15 @@ srs_error_t SrsRtcFromRtmpBridge::init_codec(SrsAudioCodecId codec)
     // Ignore if not changed.
     if (latest_codec_ == codec) return err;
 
+    // Consume the audio transcoded by previous codec.
+    codec_->wait();
+    if ((err = consume_audio()) != srs_success) {
+        return srs_error_wrap(err, "consume audio");
+    }
+
     // Create a new codec.
     srs_freep(codec_);
-    codec_ = new SrsAudioTranscoder();
+    codec_ = new SrsAsyncAudioTranscoder();
 
     // Initialize the codec according to the codec in stream.
     int bitrate = 48000; // The output bitrate in bps.
@@ -896,6 +1272,12 @@ srs_error_t SrsRtcFromRtmpBridge::init_codec(SrsAudioCodecId codec)
         return srs_error_wrap(err, "init codec=%d", codec);
     }
 
+    // Fetch the audio transcoded by worker periodically.
+    if (codec_->async() && !timer_subscribed_) {
+        _srs_hybrid->timer20ms()->subscribe(this);
+        timer_subscribed_ = true;
+    }
+
     // Update the latest codec in stream.
     if (latest_codec_ == SrsAudioCodecIdForbidden) {
         srs_trace("RTMP2RTC: Init audio codec to %d(%s)", codec, srs_audio_codec_id2str(codec).c_str());
@@ -912,38 +1294,79 @@ srs_error_t SrsRtcFromRtmpBridge::transcode(SrsAudioFrame* audio)
 {
     srs_error_t err = srs_success;
 
-    std::vector<SrsAudioFrame *> out_audios;
-    if ((err = codec_->transcode(audio, out_audios)) != srs_success) {
+    if ((err = codec_->transcode(audio)) != srs_success) {
         return srs_error_wrap(err, "recode error");
     }
 
-    // Save OPUS packets in shared message.
-    if (out_audios.empty()) {
-        return err;
-    }
+    return consume_audio();
+}
 
-    for (std::vector<SrsAudioFrame*>::iterator it = out_audios.begin(); it != out_audios.end(); ++it) {
-        SrsAudioFrame* out_audio = *it;
+srs_error_t SrsRtcFromRtmpBridge::consume_audio()
+{
+    srs_error_t err = srs_success;
 
-        SrsRtpPacket* pkt = new SrsRtpPacket();
-        SrsAutoFree(SrsRtpPacket, pkt);
+    std::vector<SrsAudioTranscodeResult*> results;
+    codec_->fetch(results);
 
-        if ((err = package_opus(out_audio, pkt)) != srs_success) {
-            err = srs_error_wrap(err, "package opus");
-            break;
+    int nn_frames = 0;
+    srs_utime_t latency = 0, cpu = 0;
+    for (int i = 0; i < (int)results.size(); i++) {
+        SrsAudioTranscodeResult* result = results.at(i);
+        SrsAutoFree(SrsAudioTranscodeResult, result);
+
+        nn_frames++;
+        latency += result->latency;
+        cpu += result->cpu;
+
+        if (err != srs_success) {
+            continue;
         }
 
-        if ((err = source_->on_rtp(pkt)) != srs_success) {
-            err = srs_error_wrap(err, "consume opus");
-            break;
+        if (result->err != srs_success) {
+            err = srs_error_wrap(result->err, "recode error");
+            result->err = srs_success;
+            continue;
+        }
+
+        // Save OPUS packets in shared message.
+        for (std::vector<SrsAudioFrame*>::iterator it = result->frames.begin(); it != result->frames.end(); ++it) {
+            SrsAudioFrame* out_audio = *it;
+
+            SrsRtpPacket* pkt = new SrsRtpPacket();
+            SrsAutoFree(SrsRtpPacket, pkt);
+
+            if ((err = package_opus(out_audio, pkt)) != srs_success) {
+                err = srs_error_wrap(err, "package opus");
+                break;
+            }
+
+            if ((err = source_->on_rtp(pkt)) != srs_success) {
+                err = srs_error_wrap(err, "consume opus");
+                break;
+            }
         }
     }
 
-    codec_->free_frames(out_audios);
+    if (nn_frames) {
+        SrsStatistic::instance()->on_audio_transcode(req, nn_frames, latency, cpu);
+    }
 
     return err;
 }
 
+srs_error_t SrsRtcFromRtmpBridge::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    // Only consume the audio transcoded by worker thread.
+    if ((err = consume_audio()) != srs_success) {
+        srs_warn("RTMP2RTC: ignore audio err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
+    return srs_success;
+}
+
 srs_error_t SrsRtcFromRtmpBridge::package_opus(SrsAudioFrame* audio, SrsRtpPacket* pkt)
 {
     srs_error_t err = srs_success;
@@ -975,6 +1398,19 @@ srs_error_t SrsRtcFromRtmpBridge::on_video(SrsSharedPtrMessage* msg)
 
     // cache the sequence header if h264
     bool is_sequence_header = SrsFlvVideo::sh(msg->payload, msg->size);
+
+    // When suspended, only parse the sequence header to update the SPS/PPS.
+    if (!update_lazy() && !is_sequence_header) {
+        return err;
+    }
+
+    // Drop frames until keyframe, after the bridge is activated.
+    if (wait_keyframe_ && !is_sequence_header) {
+        if (!SrsFlvVideo::keyframe(msg->payload, msg->size)) {
+            return err;
+        }
+        wait_keyframe_ = false;
+    }
     if (is_sequence_header && (err = meta->update_vsh(msg)) != srs_success) {
         return srs_error_wrap(err, "meta update video");
     }
@@ -1320,28 +1756,34 @@ srs_error_t SrsRtcFromRtmpBridge::consume_packets(vector<SrsRtpPacket*>& pkts)
 
 SrsRtmpFromRtcBridge::SrsRtmpFromRtcBridge(SrsLiveSource *src)
 {
+    req_ = NULL;
     source_ = src;
     codec_ = NULL;
+    timer_subscribed_ = false;
+    lazy_ = new SrsLazyBridge();
     is_first_audio = true;
     is_first_video = true;
     format = NULL;
-    rtp_key_frame_ts_ = -1;
-    header_sn_ = 0;
-    memset(cache_video_pkts_, 0, sizeof(cache_video_pkts_));
 }
 
 SrsRtmpFromRtcBridge::~SrsRtmpFromRtcBridge()
 {
+    if (timer_subscribed_) {
+        _srs_hybrid->timer20ms()->unsubscribe(this);
+    }
+
+    srs_freep(req_);
     srs_freep(codec_);
     srs_freep(format);
-    clear_cached_video();
+    srs_freep(lazy_);
 }
 
 srs_error_t SrsRtmpFromRtcBridge::initialize(SrsRequest* r)
 {
     srs_error_t err = srs_success;
 
-    codec_ = new SrsAudioTranscoder();
+    req_ = r->copy();
+    codec_ = new SrsAsyncAudioTranscoder();
     format = new SrsRtmpFormat();
 
     SrsAudioCodecId from = SrsAudioCodecIdOpus; // TODO: From SDP?
@@ -1353,6 +1795,12 @@ srs_error_t SrsRtmpFromRtcBridge::initialize(SrsRequest* r)
         return srs_error_wrap(err, "bridge initialize");
     }
 
+    // Fetch the audio transcoded by worker periodically.
+    if (codec_->async()) {
+        _srs_hybrid->timer20ms()->subscribe(this);
+        timer_subscribed_ = true;
+    }
+
     if ((err = format->initialize()) != srs_success) {
         return srs_error_wrap(err, "format initialize");
     }
@@ -1360,6 +1808,19 @@ srs_error_t SrsRtmpFromRtcBridge::initialize(SrsRequest* r)
     // Setup the SPS/PPS parsing strategy.
     format->try_annexb_first = _srs_config->try_annexb_first(r->vhost);
 
+    // The hub of live source, such as HLS and DVR, always consumes the stream, so never be lazy.
+    bool lazy = _srs_config->get_rtc_bridge_lazy(r->vhost);
+    if (lazy) {
+        string vhost = r->vhost;
+        lazy = !_srs_config->get_hls_enabled(vhost) && !_srs_config->get_dash_enabled(vhost)
+            && !_srs_config->get_hds_enabled(vhost) && !_srs_config->get_dvr_enabled(vhost)
+            && !_srs_config->get_forward_enabled(vhost) && !_srs_config->get_exec_enabled(vhost);
+    }
+
+    srs_utime_t grace = _srs_config->get_rtc_bridge_grace(r->vhost);
+    lazy_->initialize(lazy, grace);
+    srs_trace("RTMP bridge from RTC, lazy=%d, grace=%dms", lazy, srsu2msi(grace));
+
     return err;
 }
 
@@ -1382,6 +1843,11 @@ srs_error_t SrsRtmpFromRtcBridge::on_rtp(SrsRtpPacket *pkt)
 {
     srs_error_t err = srs_success;
 
+    // When suspended, drop all packets, the PLI is requested by RTC source when activated.
+    if (!update_lazy()) {
+        return err;
+    }
+
     if (!pkt->payload()) {
         return err;
     }
@@ -1392,10 +1858,9 @@ srs_error_t SrsRtmpFromRtcBridge::on_rtp(SrsRtpPacket *pkt)
         return err;
     }
 
+    // The video is assembled to frames by receive track, see on_frame().
     if (pkt->is_audio()) {
         err = transcode_audio(pkt);
-    } else {
-        err = packet_video(pkt);
     }
 
     return err;
@@ -1407,6 +1872,54 @@ void SrsRtmpFromRtcBridge::on_unpublish()
     source_->on_unpublish();
 }
 
+bool SrsRtmpFromRtcBridge::active()
+{
+    return lazy_->active();
+}
+
+srs_error_t SrsRtmpFromRtcBridge::on_frame(const std::vector<SrsRtpPacket*>& frame)
+{
+    srs_error_t err = srs_success;
+
+    // Have no received any sender report, can't calculate avsync_time,
+    // discard it to avoid timestamp problem in live source
+    if (frame.empty() || frame.at(0)->get_avsync_time() <= 0) {
+        return err;
+    }
+
+    for (int i = 0; i < (int)frame.size(); ++i) {
+        SrsRtpPacket* pkt = frame.at(i);
+        if (pkt->is_keyframe() && (err = packet_sequence_header(pkt)) != srs_success) {
+            return srs_error_wrap(err, "sequence header");
+        }
+    }
+
+    if ((err = packet_video_rtmp(frame)) != srs_success) {
+        return srs_error_wrap(err, "fail to pack video frame");
+    }
+
+    return err;
+}
+
+bool SrsRtmpFromRtcBridge::update_lazy()
+{
+    if (!lazy_->update(source_->has_consumers())) {
+        return lazy_->active();
+    }
+
+    // The receive track restarts the jitter buffer from the keyframe, and drops the stale frames.
+    if (lazy_->active()) {
+        // Resend the AAC sequence header, for the codec might be changed.
+        is_first_audio = true;
+        srs_trace("RTC2RTMP: Bridge activated by consumers, request keyframe");
+    } else {
+        source_->clear_gop_cache();
+        srs_trace("RTC2RTMP: Bridge suspended for no consumers");
+    }
+
+    return lazy_->active();
+}
+
 srs_error_t SrsRtmpFromRtcBridge::transcode_audio(SrsRtpPacket *pkt)
 {
     srs_error_t err = srs_success;
@@ -1428,7 +1941,6 @@ srs_error_t SrsRtmpFromRtcBridge::transcode_audio(SrsRtpPacket *pkt)
         is_first_audio = false;
     }
 
-    std::vector<SrsAudioFrame *> out_pkts;
     SrsRtpRawPayload *payload = dynamic_cast<SrsRtpRawPayload *>(pkt->payload());
 
     SrsAudioFrame frame;
@@ -1436,26 +1948,75 @@ srs_error_t SrsRtmpFromRtcBridge::transcode_audio(SrsRtpPacket *pkt)
     frame.dts = ts;
     frame.cts = 0;
 
-    err = codec_->transcode(&frame, out_pkts);
+    err = codec_->transcode(&frame);
     if (err != srs_success) {
         return err;
     }
 
-    for (std::vector<SrsAudioFrame *>::iterator it = out_pkts.begin(); it != out_pkts.end(); ++it) {
-        SrsCommonMessage out_rtmp;
-        out_rtmp.header.timestamp = (*it)->dts;
-        packet_aac(&out_rtmp, (*it)->samples[0].bytes, (*it)->samples[0].size, ts, is_first_audio);
+    return consume_audio();
+}
 
-        if ((err = source_->on_audio(&out_rtmp)) != srs_success) {
-            err = srs_error_wrap(err, "source on audio");
-            break;
+srs_error_t SrsRtmpFromRtcBridge::consume_audio()
+{
+    srs_error_t err = srs_success;
+
+    std::vector<SrsAudioTranscodeResult*> results;
+    codec_->fetch(results);
+
+    int nn_frames = 0;
+    srs_utime_t latency = 0, cpu = 0;
+    for (int i = 0; i < (int)results.size(); i++) {
+        SrsAudioTranscodeResult* result = results.at(i);
+        SrsAutoFree(SrsAudioTranscodeResult, result);
+
+        nn_frames++;
+        latency += result->latency;
+        cpu += result->cpu;
+
+        if (err != srs_success) {
+            continue;
         }
+
+        if (result->err != srs_success) {
+            err = result->err;
+            result->err = srs_success;
+            continue;
+        }
+
+        // Use the timestamp of input frame.
+        uint32_t ts = (uint32_t)result->dts;
+        for (std::vector<SrsAudioFrame *>::iterator it = result->frames.begin(); it != result->frames.end(); ++it) {
+            SrsCommonMessage out_rtmp;
+            out_rtmp.header.timestamp = (*it)->dts;
+            packet_aac(&out_rtmp, (*it)->samples[0].bytes, (*it)->samples[0].size, ts, is_first_audio);
+
+            if ((err = source_->on_audio(&out_rtmp)) != srs_success) {
+                err = srs_error_wrap(err, "source on audio");
+                break;
+            }
+        }
+    }
+
+    if (nn_frames) {
+        SrsStatistic::instance()->on_audio_transcode(req_, nn_frames, latency, cpu);
     }
-    codec_->free_frames(out_pkts);
 
     return err;
 }
 
+srs_error_t SrsRtmpFromRtcBridge::on_timer(srs_utime_t interval)
+{
+    srs_error_t err = srs_success;
+
+    // Only consume the audio transcoded by worker thread.
+    if ((err = consume_audio()) != srs_success) {
+        srs_warn("RTC2RTMP: ignore audio err %s", srs_error_desc(err).c_str());
+        srs_freep(err);
+    }
+
+    return srs_success;
+}
+
 void SrsRtmpFromRtcBridge::packet_aac(SrsCommonMessage* audio, char* data, int len, uint32_t pts, bool is_header)
 {
     int rtmp_len = len + 2;
@@ -1473,47 +2034,7 @@ void SrsRtmpFromRtcBridge::packet_aac(SrsCommonMessage* audio, char* data, int l
     audio->size = rtmp_len;
 }
 
-srs_error_t SrsRtmpFromRtcBridge::packet_video(SrsRtpPacket* src)
-{
-    srs_error_t err = srs_success;
-
-    // TODO: Only copy when need
-    SrsRtpPacket* pkt = src->copy();
-
-    if (pkt->is_keyframe()) {
-        return packet_video_key_frame(pkt);
-    }
-
-    // store in cache
-    int index = cache_index(pkt->header.get_sequence());
-    cache_video_pkts_[index].in_use = true;
-    srs_freep(cache_video_pkts_[index].pkt);
-    cache_video_pkts_[index].pkt = pkt;
-    cache_video_pkts_[index].sn = pkt->header.get_sequence();
-    cache_video_pkts_[index].ts = pkt->get_avsync_time();
-    cache_video_pkts_[index].rtp_ts = pkt->header.get_timestamp();
-
-    // check whether to recovery lost packet and can construct a video frame
-    if (lost_sn_ == pkt->header.get_sequence()) {
-        uint16_t tail_sn = 0;
-        int sn = find_next_lost_sn(lost_sn_, tail_sn);
-        if (-1 == sn ) {
-            if (check_frame_complete(header_sn_, tail_sn)) {
-                if ((err = packet_video_rtmp(header_sn_, tail_sn)) != srs_success) {
-                    err = srs_error_wrap(err, "fail to pack video frame");
-                }
-            }
-        } else if (-2 == sn) {
-            return srs_error_new(ERROR_RTC_RTP_MUXER, "video cache is overflow");
-        } else {
-            lost_sn_ = (uint16_t)sn;
-        }
-    }
-
-    return err;
-}
-
-srs_error_t SrsRtmpFromRtcBridge::packet_video_key_frame(SrsRtpPacket* pkt)
+srs_error_t SrsRtmpFromRtcBridge::packet_sequence_header(SrsRtpPacket* pkt)
 {
     srs_error_t err = srs_success;
 
@@ -1555,74 +2076,18 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video_key_frame(SrsRtpPacket* pkt)
         }
     }
 
-    if (-1 == rtp_key_frame_ts_) {
-        rtp_key_frame_ts_ = pkt->header.get_timestamp();
-        header_sn_ = pkt->header.get_sequence();
-        lost_sn_ = header_sn_ + 1;
-        // Received key frame and clean cache of old p frame pkts
-        clear_cached_video();
-        srs_trace("set ts=%u, header=%hu, lost=%hu", (uint32_t)rtp_key_frame_ts_, header_sn_, lost_sn_);
-    } else if (rtp_key_frame_ts_ != pkt->header.get_timestamp()) {
-        //new key frame, clean cache
-        int64_t old_ts = rtp_key_frame_ts_;
-        uint16_t old_header_sn = header_sn_;
-        uint16_t old_lost_sn = lost_sn_;
-        rtp_key_frame_ts_ = pkt->header.get_timestamp();
-        header_sn_ = pkt->header.get_sequence();
-        lost_sn_ = header_sn_ + 1;
-        clear_cached_video();
-        srs_warn("drop old ts=%u, header=%hu, lost=%hu, set new ts=%u, header=%hu, lost=%hu",
-            (uint32_t)old_ts, old_header_sn, old_lost_sn, (uint32_t)rtp_key_frame_ts_, header_sn_, lost_sn_);
-    }
-
-    uint16_t index = cache_index(pkt->header.get_sequence());
-    cache_video_pkts_[index].in_use = true;
-    srs_freep(cache_video_pkts_[index].pkt);
-    cache_video_pkts_[index].pkt = pkt;
-    cache_video_pkts_[index].sn = pkt->header.get_sequence();
-    cache_video_pkts_[index].ts = pkt->get_avsync_time();
-    cache_video_pkts_[index].rtp_ts = pkt->header.get_timestamp();
-
-    int32_t sn = lost_sn_;
-    uint16_t tail_sn = 0;
-    if (srs_rtp_seq_distance(header_sn_, pkt->header.get_sequence()) < 0){
-        // When receive previous pkt in the same frame, update header sn;
-        header_sn_ = pkt->header.get_sequence();
-        sn = find_next_lost_sn(header_sn_, tail_sn);
-    } else if (lost_sn_ == pkt->header.get_sequence()) {
-        sn = find_next_lost_sn(lost_sn_, tail_sn);
-    }
-
-    if (-1 == sn) {
-        if (check_frame_complete(header_sn_, tail_sn)) {
-            if ((err = packet_video_rtmp(header_sn_, tail_sn)) != srs_success) {
-                err = srs_error_wrap(err, "fail to packet key frame");
-            }
-        }
-    } else if (-2 == sn) {
-        return srs_error_new(ERROR_RTC_RTP_MUXER, "video cache is overflow");
-    } else {
-        lost_sn_ = (uint16_t)sn;
-    }
-
     return err;
 }
 
-srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const uint16_t start, const uint16_t end)
+srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const std::vector<SrsRtpPacket*>& frame)
 {
     srs_error_t err = srs_success;
 
     int nb_payload = 0;
-    int16_t cnt = srs_rtp_seq_distance(start, end) + 1;
-    srs_assert(cnt >= 1);
-
-    for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
-        uint16_t sn = start + i;
-        uint16_t index = cache_index(sn);
-        SrsRtpPacket* pkt = cache_video_pkts_[index].pkt;
-
-        // fix crash when pkt->payload() if pkt is nullptr;
-        if (!pkt) continue;
+    bool keyframe = false;
+    for (int i = 0; i < (int)frame.size(); ++i) {
+        SrsRtpPacket* pkt = frame.at(i);
+        keyframe = keyframe || pkt->is_keyframe();
 
         // calculate nalu len
         SrsRtpFUAPayload2* fua_payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
@@ -1661,14 +2126,13 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const uint16_t start, const
     nb_payload += 1 + 1 + 3;
 
     SrsCommonMessage rtmp;
-    SrsRtpPacket* pkt = cache_video_pkts_[cache_index(start)].pkt;
+    SrsRtpPacket* pkt = frame.at(0);
     rtmp.header.initialize_video(nb_payload, pkt->get_avsync_time(), 1);
     rtmp.create_payload(nb_payload);
     rtmp.size = nb_payload;
     SrsBuffer payload(rtmp.payload, rtmp.size);
-    if (pkt->is_keyframe()) {
+    if (keyframe) {
         payload.write_1bytes(0x17); // type(4 bits): key frame; code(4bits): avc
-        rtp_key_frame_ts_ = -1;
     } else {
         payload.write_1bytes(0x27); // type(4 bits): inter frame; code(4bits): avc
     }
@@ -1678,18 +2142,8 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const uint16_t start, const
     payload.write_1bytes(0x0);
 
     int nalu_len = 0;
-    for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
-        uint16_t index = cache_index((start + i));
-        SrsRtpPacket* pkt = cache_video_pkts_[index].pkt;
-
-        // fix crash when pkt->payload() if pkt is nullptr;
-        if (!pkt) continue;
-
-        cache_video_pkts_[index].in_use = false;
-        cache_video_pkts_[index].pkt = NULL;
-        cache_video_pkts_[index].ts = 0;
-        cache_video_pkts_[index].rtp_ts = 0;
-        cache_video_pkts_[index].sn = 0;
+    for (int i = 0; i < (int)frame.size(); ++i) {
+        SrsRtpPacket* pkt = frame.at(i);
 
         SrsRtpFUAPayload2* fua_payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
         if (fua_payload && fua_payload->size > 0) {
@@ -1709,7 +2163,6 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const uint16_t start, const
                     payload.skip(nalu_len);
                 }
             }
-            srs_freep(pkt);
             continue;
         }
 
@@ -1722,7 +2175,6 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const uint16_t start, const
                     payload.write_bytes(sample->bytes, sample->size);
                 }
             }
-            srs_freep(pkt);
             continue;
         }
 
@@ -1730,101 +2182,16 @@ srs_error_t SrsRtmpFromRtcBridge::packet_video_rtmp(const uint16_t start, const
         if (raw_payload && raw_payload->nn_payload > 0) {
             payload.write_4bytes(raw_payload->nn_payload);
             payload.write_bytes(raw_payload->payload, raw_payload->nn_payload);
-            srs_freep(pkt);
             continue;
         }
-
-        srs_freep(pkt);
     }
 
     if ((err = source_->on_video(&rtmp)) != srs_success) {
-        srs_warn("fail to pack video frame");
-    }
-
-    header_sn_ = end + 1;
-    uint16_t tail_sn = 0;
-    int sn = find_next_lost_sn(header_sn_, tail_sn);
-    if (-1 == sn) {
-        if (check_frame_complete(header_sn_, tail_sn)) {
-            err = packet_video_rtmp(header_sn_, tail_sn);
-        }
-    } else if (-2 == sn) {
-        return srs_error_new(ERROR_RTC_RTP_MUXER, "video cache is overflow");
-    } else {
-        lost_sn_ = sn;
+        return srs_error_wrap(err, "source on video");
     }
 
     return err;
 }
-
-int32_t SrsRtmpFromRtcBridge::find_next_lost_sn(uint16_t current_sn, uint16_t& end_sn)
-{
-    uint32_t last_rtp_ts = cache_video_pkts_[cache_index(header_sn_)].rtp_ts;
-    for (int i = 0; i < s_cache_size; ++i) {
-        uint16_t lost_sn = current_sn + i;
-        int index = cache_index(lost_sn);
-
-        if (!cache_video_pkts_[index].in_use) {
-            return lost_sn;
-        }
-        //check time first, avoid two small frame mixed case decode fail
-        if (last_rtp_ts != cache_video_pkts_[index].rtp_ts) {
-            end_sn = lost_sn - 1;
-            return -1;
-        }
-
-        if (cache_video_pkts_[index].pkt->header.get_marker()) {
-            end_sn = lost_sn;
-            return -1;
-        }
-    }
-
-    srs_error("cache overflow. the packet count of video frame is more than %u", s_cache_size);
-    return -2;
-}
-
-void SrsRtmpFromRtcBridge::clear_cached_video()
-{
-    for (size_t i = 0; i < s_cache_size; i++)
-    {
-        if (cache_video_pkts_[i].in_use) {
-            srs_freep(cache_video_pkts_[i].pkt);
-            cache_video_pkts_[i].sn = 0;
-            cache_video_pkts_[i].ts = 0;
-            cache_video_pkts_[i].rtp_ts = 0;
-            cache_video_pkts_[i].in_use = false;
-        }
-    }
-}
-
-bool SrsRtmpFromRtcBridge::check_frame_complete(const uint16_t start, const uint16_t end)
-{
-    int16_t cnt = srs_rtp_seq_distance(start, end) + 1;
-    srs_assert(cnt >= 1);
-
-    uint16_t fu_s_c = 0;
-    uint16_t fu_e_c = 0;
-    for (uint16_t i = 0; i < (uint16_t)cnt; ++i) {
-        int index = cache_index((start + i));
-        SrsRtpPacket* pkt = cache_video_pkts_[index].pkt;
-
-        // fix crash when pkt->payload() if pkt is nullptr;
-        if (!pkt) continue;
-
-        SrsRtpFUAPayload2* fua_payload = dynamic_cast<SrsRtpFUAPayload2*>(pkt->payload());
-        if (!fua_payload) continue;
-
-        if (fua_payload->start) {
-            ++fu_s_c;
-        }
-
-        if (fua_payload->end) {
-            ++fu_e_c;
-        }
-    }
-
-    return fu_s_c == fu_e_c;
-}
 #endif
 
 SrsCodecPayload::SrsCodecPayload()
@@ -2249,6 +2616,7 @@ SrsRtcTrackDescription* SrsRtcTrackDescription::copy()
     cp->direction_ = direction_;
     cp->mid_ = mid_;
     cp->msid_ = msid_;
+    cp->rid_ = rid_;
     cp->is_active_ = is_active_;
     cp->media_ = media_ ? media_->copy():NULL;
     cp->red_ = red_ ? red_->copy():NULL;
@@ -2341,6 +2709,16 @@ uint32_t SrsRtcRecvTrack::get_ssrc()
     return track_desc_->ssrc_;
 }
 
+std::string SrsRtcRecvTrack::get_rid()
+{
+    return track_desc_->rid_;
+}
+
+void SrsRtcRecvTrack::bind_ssrc(uint32_t ssrc)
+{
+    track_desc_->ssrc_ = ssrc;
+}
+
 void SrsRtcRecvTrack::update_rtt(int rtt)
 {
     nack_receiver_->update_rtt(rtt);
@@ -2534,10 +2912,12 @@ srs_error_t SrsRtcAudioRecvTrack::check_send_nacks()
 SrsRtcVideoRecvTrack::SrsRtcVideoRecvTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc)
     : SrsRtcRecvTrack(session, track_desc, false)
 {
+    frames_ = NULL;
 }
 
 SrsRtcVideoRecvTrack::~SrsRtcVideoRecvTrack()
 {
+    srs_freep(frames_);
 }
 
 void SrsRtcVideoRecvTrack::on_before_decode_payload(SrsRtpPacket* pkt, SrsBuffer* buf, ISrsRtpPayloader** ppayload, SrsRtspPacketPayloadType* ppt)
@@ -2572,6 +2952,44 @@ srs_error_t SrsRtcVideoRecvTrack::on_rtp(SrsRtcSource* source, SrsRtpPacket* pkt
         return srs_error_wrap(err, "source on rtp");
     }
 
+    if ((err = on_bridge_packet(source, pkt)) != srs_success) {
+        return srs_error_wrap(err, "bridge on rtp");
+    }
+
+    return err;
+}
+
+srs_error_t SrsRtcVideoRecvTrack::on_bridge_packet(SrsRtcSource* source, SrsRtpPacket* pkt)
+{
+    srs_error_t err = srs_success;
+
+    // Drop the stale frames when bridge is suspended or switched to another layer, so restart from the keyframe
+    // when bridged again.
+    if (!source->can_bridge_video(pkt->header.get_ssrc())) {
+        srs_freep(frames_);
+        return err;
+    }
+
+    if (!frames_) {
+        frames_ = new SrsRtpFrameBuffer(512, SRS_RTC_FRAME_MAX_DELAY, 90000);
+    }
+    frames_->insert(pkt->copy());
+
+    // Pack all complete frames in DTS order, the lost frames are dropped by jitter buffer.
+    std::vector<SrsRtpPacket*> frame;
+    while (frames_->pop(frame)) {
+        err = source->on_frame(frame);
+
+        for (int i = 0; i < (int)frame.size(); ++i) {
+            srs_freep(frame[i]);
+        }
+        frame.clear();
+
+        if (err != srs_success) {
+            return srs_error_wrap(err, "consume frame");
+        }
+    }
+
     return err;
 }
 
@@ -2613,6 +3031,11 @@ uint32_t SrsRtcTsJitter::correct(uint32_t value)
     return jitter_->correct(value);
 }
 
+void SrsRtcTsJitter::rebase(uint32_t delta)
+{
+    jitter_->rebase(delta);
+}
+
 SrsRtcSeqJitter::SrsRtcSeqJitter(uint16_t base)
 {
     jitter_ = new SrsRtcJitter<uint16_t, int16_t>(base, 128, srs_rtp_seq_distance);
@@ -2628,6 +3051,11 @@ uint16_t SrsRtcSeqJitter::correct(uint16_t value)
     return jitter_->correct(value);
 }
 
+void SrsRtcSeqJitter::rebase(uint16_t delta)
+{
+    jitter_->rebase(delta);
+}
+
 SrsRtcSendTrack::SrsRtcSendTrack(SrsRtcConnection* session, SrsRtcTrackDescription* track_desc, bool is_audio)
 {
     session_ = session;
@@ -2637,6 +3065,7 @@ SrsRtcSendTrack::SrsRtcSendTrack(SrsRtcConnection* session, SrsRtcTrackDescripti
     // Make a different start of sequence number, for debugging.
     jitter_ts_ = new SrsRtcTsJitter(track_desc_->type_ == "audio" ? 10000 : 20000);
     jitter_seq_ = new SrsRtcSeqJitter(track_desc_->type_ == "audio" ? 100 : 200);
+    last_sent_at_ = 0;
 
     if (is_audio) {
         rtp_queue_ = new SrsRtpRingBuffer(100);
@@ -2715,6 +3144,24 @@ void SrsRtcSendTrack::rebuild_packet(SrsRtpPacket* pkt)
     pkt->header.set_timestamp(jitter_ts_->correct(ts));
 
     srs_info("RTC: Correct %s seq=%u/%u, ts=%u/%u", track_desc_->type_.c_str(), seq, pkt->header.get_sequence(), ts, pkt->header.get_timestamp());
+
+    last_sent_at_ = srs_get_system_time();
+}
+
+void SrsRtcSendTrack::on_source_switched()
+{
+    // Never sent any packet, no need to rebase.
+    if (!last_sent_at_) {
+        return;
+    }
+
+    // The elapsed time in TBN of track, at least 1 to make the ts increase.
+    int sample = (track_desc_->media_ && track_desc_->media_->sample_) ? track_desc_->media_->sample_ : 90000;
+    srs_utime_t elapsed = srs_max(0, srs_get_system_time() - last_sent_at_);
+    uint32_t delta = srs_max(1, (uint32_t)(elapsed * sample / SRS_UTIME_SECONDS));
+
+    jitter_seq_->rebase(1);
+    jitter_ts_->rebase(delta);
 }
 
 srs_error_t SrsRtcSendTrack::on_nack(SrsRtpPacket** ppkt)
@@ -11,6 +11,7 @@
 
 #include <vector>
 #include <map>
+#include <deque>
 #include <inttypes.h>
 #include <vector>
 #include <string>
@@ -28,14 +29,16 @@ class SrsCommonMessage;
 class SrsMessageArray;
 class SrsRtcSource;
 class SrsRtcFromRtmpBridge;
-class SrsAudioTranscoder;
+class SrsAsyncAudioTranscoder;
 class SrsRtpPacket;
 class SrsSample;
 class SrsRtcSourceDescription;
 class SrsRtcTrackDescription;
 class SrsRtcConnection;
+class SrsLatencyHistogram;
 class SrsRtpRingBuffer;
 class SrsRtpNackForReceiver;
+class SrsRtpFrameBuffer;
 class SrsJsonObject;
 class SrsErrorPithyPrint;
 
@@ -78,6 +81,10 @@ private:
     srs_cond_t mw_wait;
     bool mw_waiting;
     int mw_min_msgs;
+    // The latency of packets in queue, NULL if disabled.
+    SrsLatencyHistogram* latency_;
+    // The enqueue time of the sampled packets in queue, only when latency is enabled.
+    std::deque<std::pair<SrsRtpPacket*, srs_utime_t> > times_;
 private:
     // The callback for stream change event.
     ISrsRtcSourceChangeCallback* handler_;
@@ -87,6 +94,8 @@ public:
 public:
     // When source id changed, notice client to print.
     virtual void update_source_id();
+    // Set the latency histogram of queue, NULL to disable it.
+    virtual void set_latency(SrsLatencyHistogram* v);
     // Put RTP packet into queue.
     // @note We do not drop packet here, but drop it in sender.
     srs_error_t enqueue(SrsRtpPacket* pkt);
@@ -153,9 +162,54 @@ public:
     virtual srs_error_t on_publish() = 0;
     virtual srs_error_t on_rtp(SrsRtpPacket *pkt) = 0;
     virtual void on_unpublish() = 0;
+    // Whether bridge is working, the lazy bridge is suspended when no consumers.
+    virtual bool active() = 0;
+    // The video frame assembled by the receive track, in DTS order.
+    virtual srs_error_t on_frame(const std::vector<SrsRtpPacket*>& frame) = 0;
 };
 
 // A Source is a stream, to publish and to play with, binding to SrsRtcPublishStream and SrsRtcPlayStream.
+// The layer of simulcast video track, identified by the RID or SSRC of publisher.
+class SrsRtcSimulcastLayer
+{
+public:
+    // The RID of layer, or the index in SSRC-SIM group.
+    std::string rid_;
+    // The SSRC of layer, 0 if RID is not bound yet.
+    uint32_t ssrc_;
+    // The bitrate of layer, sampled about every second.
+    int kbps_;
+    uint64_t bytes_;
+    srs_utime_t starttime_;
+public:
+    SrsRtcSimulcastLayer(std::string rid, uint32_t ssrc);
+};
+
+// Select a layer of simulcast to forward. We only switch layer at keyframe to make the decoder
+// happy, so the target layer is pending until its keyframe arrives.
+class SrsRtcLayerSelector
+{
+private:
+    // The SSRC of layer we are forwarding, and the layer we want to switch to.
+    uint32_t current_;
+    uint32_t target_;
+public:
+    SrsRtcLayerSelector();
+    virtual ~SrsRtcLayerSelector();
+public:
+    uint32_t current();
+    uint32_t target();
+    void set_target(uint32_t ssrc);
+    // Whether the target layer is pending for keyframe.
+    bool switching();
+    // Whether forward the packet of layer, switch to target layer at keyframe.
+    bool accept(SrsRtpPacket* pkt, bool& switched);
+public:
+    // Select the highest layer whose bitrate fits in the bandwidth in bps, or the lowest layer if none
+    // fits. Select the highest layer if no bandwidth, return 0 if no layer is bound.
+    static uint32_t select(const std::vector<SrsRtcSimulcastLayer>& layers, int64_t bitrate);
+};
+
 class SrsRtcSource : public ISrsFastTimer
 {
 private:
@@ -172,9 +226,14 @@ private:
     SrsRtcSourceDescription* stream_desc_;
     // The Source bridge, bridge stream to other source.
     ISrsRtcSourceBridge* bridge_;
+    // Whether bridge is active, to request PLI when activated.
+    bool bridge_active_;
 private:
     // To delivery stream to clients.
     std::vector<SrsRtcConsumer*> consumers;
+    // The latency of fan-out and queue of consumers, NULL if disabled.
+    SrsLatencyHistogram* fanout_latency_;
+    SrsLatencyHistogram* queue_latency_;
     // Whether stream is created, that is, SDP is done.
     bool is_created_;
     // Whether stream is delivering data, that is, DTLS is done.
@@ -185,6 +244,12 @@ private:
     // The PLI for RTC2RTMP.
     srs_utime_t pli_for_rtmp_;
     srs_utime_t pli_elapsed_;
+private:
+    // The layers of simulcast video track, empty if not simulcast.
+    // @remark We only support one simulcast video track for each stream.
+    std::vector<SrsRtcSimulcastLayer> layers_;
+    // The layer for bridge, always the highest one.
+    SrsRtcLayerSelector* bridge_layer_;
 public:
     SrsRtcSource();
     virtual ~SrsRtcSource();
@@ -214,6 +279,8 @@ public:
     // @param dg, whether dumps the gop cache.
     virtual srs_error_t consumer_dumps(SrsRtcConsumer* consumer, bool ds = true, bool dm = true, bool dg = true);
     virtual void on_consumer_destroy(SrsRtcConsumer* consumer);
+    // Whether there are consumers, for lazy bridge to start or stop.
+    virtual bool has_consumers();
     // Whether we can publish stream to the source, return false if it exists.
     // @remark Note that when SDP is done, we set the stream is not able to publish.
     virtual bool can_publish();
@@ -233,17 +300,51 @@ public:
     void set_publish_stream(ISrsRtcPublishStream* v);
     // Consume the shared RTP packet, user must free it.
     srs_error_t on_rtp(SrsRtpPacket* pkt);
+    // Whether bridge the video packets of ssrc, which are assembled to frames by receive track.
+    bool can_bridge_video(uint32_t ssrc);
+    // Consume the video frame assembled by receive track, user must free it.
+    srs_error_t on_frame(const std::vector<SrsRtpPacket*>& frame);
     // Set and get stream description for souce
     bool has_stream_desc();
     void set_stream_desc(SrsRtcSourceDescription* stream_desc);
     std::vector<SrsRtcTrackDescription*> get_track_desc(std::string type, std::string media_type);
+public:
+    // Get the layers of simulcast, empty if not simulcast.
+    std::vector<SrsRtcSimulcastLayer> simulcast_layers();
+    bool is_simulcast_layer(uint32_t ssrc);
+    // Bind the SSRC to the RID layer, when got the first packet of RID.
+    void on_simulcast_bind(std::string rid, uint32_t ssrc);
+private:
+    // Update the bitrate of layer, and switch the layer for bridge.
+    void on_simulcast_packet(SrsRtpPacket* pkt);
 // interface ISrsFastTimer
 private:
     srs_error_t on_timer(srs_utime_t interval);
 };
 
+// The lazy bridge only works when there are consumers of target source, and suspends after
+// no consumers for a grace period, so the idle bridged streams never transcode or packetize.
+class SrsLazyBridge
+{
+private:
+    // If not enabled, the bridge is always active.
+    bool enabled_;
+    srs_utime_t grace_;
+    bool active_;
+    // The time when the last consumer leaves, 0 if there are consumers.
+    srs_utime_t idle_at_;
+public:
+    SrsLazyBridge();
+    virtual ~SrsLazyBridge();
+public:
+    void initialize(bool enabled, srs_utime_t grace);
+    // Update by whether target source has consumers, return true if state changed.
+    bool update(bool has_consumers);
+    bool active();
+};
+
 #ifdef SRS_FFMPEG_FIT
-class SrsRtcFromRtmpBridge : public ISrsLiveSourceBridge
+class SrsRtcFromRtmpBridge : public ISrsLiveSourceBridge, public ISrsFastTimer
 {
 private:
     SrsRequest* req;
@@ -255,7 +356,12 @@ private:
 private:
     bool rtmp_to_rtc;
     SrsAudioCodecId latest_codec_;
-    SrsAudioTranscoder* codec_;
+    SrsAsyncAudioTranscoder* codec_;
+    // Whether subscribed timer to fetch the transcoded audio.
+    bool timer_subscribed_;
+    SrsLazyBridge* lazy_;
+    // Whether wait for keyframe, after the lazy bridge is activated.
+    bool wait_keyframe_;
     bool keep_bframe;
     bool merge_nalus;
     uint16_t audio_sequence;
@@ -273,9 +379,16 @@ public:
     virtual void on_unpublish();
     virtual srs_error_t on_audio(SrsSharedPtrMessage* msg);
 private:
+    // Update the lazy bridge by consumers of RTC source, return whether active.
+    bool update_lazy();
     srs_error_t init_codec(SrsAudioCodecId codec);
     srs_error_t transcode(SrsAudioFrame* audio);
+    // Consume the transcoded audio, which might be transcoded by worker thread.
+    srs_error_t consume_audio();
     srs_error_t package_opus(SrsAudioFrame* audio, SrsRtpPacket* pkt);
+// interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
 public:
     virtual srs_error_t on_video(SrsSharedPtrMessage* msg);
 private:
@@ -287,30 +400,19 @@ private:
     srs_error_t consume_packets(std::vector<SrsRtpPacket*>& pkts);
 };
 
-class SrsRtmpFromRtcBridge : public ISrsRtcSourceBridge
+class SrsRtmpFromRtcBridge : public ISrsRtcSourceBridge, public ISrsFastTimer
 {
 private:
+    SrsRequest* req_;
     SrsLiveSource *source_;
-    SrsAudioTranscoder *codec_;
+    SrsAsyncAudioTranscoder *codec_;
+    // Whether subscribed timer to fetch the transcoded audio.
+    bool timer_subscribed_;
+    SrsLazyBridge* lazy_;
     bool is_first_audio;
     bool is_first_video;
     // The format, codec information.
     SrsRtmpFormat* format;
-
-    //TODO:use SrsRtpRingBuffer
-    //TODO:jitter buffer class
-    struct RtcPacketCache {
-        bool in_use;
-        uint16_t sn;
-        uint32_t ts;
-        uint32_t rtp_ts;
-        SrsRtpPacket* pkt;
-    };
-    const static uint16_t s_cache_size = 512;
-    RtcPacketCache cache_video_pkts_[s_cache_size];
-    uint16_t header_sn_;
-    uint16_t lost_sn_;
-    int64_t rtp_key_frame_ts_;
 public:
     SrsRtmpFromRtcBridge(SrsLiveSource *src);
     virtual ~SrsRtmpFromRtcBridge();
@@ -320,18 +422,20 @@ public:
     virtual srs_error_t on_publish();
     virtual srs_error_t on_rtp(SrsRtpPacket *pkt);
     virtual void on_unpublish();
+    virtual bool active();
+    virtual srs_error_t on_frame(const std::vector<SrsRtpPacket*>& frame);
 private:
+    // Update the lazy bridge by consumers of live source, return whether active.
+    bool update_lazy();
     srs_error_t transcode_audio(SrsRtpPacket *pkt);
+    // Consume the transcoded audio, which might be transcoded by worker thread.
+    srs_error_t consume_audio();
     void packet_aac(SrsCommonMessage* audio, char* data, int len, uint32_t pts, bool is_header);
-    srs_error_t packet_video(SrsRtpPacket* pkt);
-    srs_error_t packet_video_key_frame(SrsRtpPacket* pkt);
-    srs_error_t packet_video_rtmp(const uint16_t start, const uint16_t end);
-    int32_t find_next_lost_sn(uint16_t current_sn, uint16_t& end_sn);
-    void clear_cached_video();
-    inline uint16_t cache_index(uint16_t current_sn) {
-        return current_sn % s_cache_size;
-    }
-    bool check_frame_complete(const uint16_t start, const uint16_t end);
+    srs_error_t packet_sequence_header(SrsRtpPacket* pkt);
+    srs_error_t packet_video_rtmp(const std::vector<SrsRtpPacket*>& frame);
+// interface ISrsFastTimer
+private:
+    srs_error_t on_timer(srs_utime_t interval);
 };
 #endif
 
@@ -458,6 +562,10 @@ public:
     std::string mid_;
     // msid_: track stream id
     std::string msid_;
+    // The RID or layer of simulcast, empty if not simulcast. Note that all layers
+    // of a simulcast track share the same id_, and the ssrc_ is 0 for RID layer
+    // until the first packet with the RID arrives.
+    std::string rid_;
 
     // meida payload, such as opus, h264.
     SrsCodecPayload* media_;
@@ -534,6 +642,9 @@ public:
     void set_nack_no_copy(bool v) { nack_no_copy_ = v; }
     bool has_ssrc(uint32_t ssrc);
     uint32_t get_ssrc();
+    // For RID based simulcast, the SSRC is bound when got the first packet of RID.
+    std::string get_rid();
+    void bind_ssrc(uint32_t ssrc);
     void update_rtt(int rtt);
     void update_send_report_time(const SrsNtp& ntp, uint32_t rtp_time);
     int64_t cal_avsync_time(uint32_t rtp_time);
@@ -567,6 +678,10 @@ public:
 
 class SrsRtcVideoRecvTrack : public SrsRtcRecvTrack, public ISrsRtspPacketDecodeHandler
 {
+private:
+    // The jitter buffer to assemble the frames for bridge, NULL when not bridged. Each track has its own buffer, so
+    // the seq and timestamp space of simulcast layers are never mixed.
+    SrsRtpFrameBuffer* frames_;
 public:
     SrsRtcVideoRecvTrack(SrsRtcConnection* session, SrsRtcTrackDescription* stream_descs);
     virtual ~SrsRtcVideoRecvTrack();
@@ -575,6 +690,9 @@ public:
 public:
     virtual srs_error_t on_rtp(SrsRtcSource* source, SrsRtpPacket* pkt);
     virtual srs_error_t check_send_nacks();
+private:
+    // Assemble the packet to frames, and consume the complete frames by bridge of source.
+    srs_error_t on_bridge_packet(SrsRtcSource* source, SrsRtpPacket* pkt);
 };
 
 // RTC jitter for TS or sequence number, only reset the base, and keep in original order.
@@ -596,6 +714,9 @@ private:
     T base_;
     // Whether initialized. Note that we should not use correct_base_(0) as init state, because it might flip back.
     bool init_;
+    // Whether rebase for next value, to continue from the last corrected value plus delta.
+    bool rebase_;
+    T delta_;
 public:
     SrsRtcJitter(T base, ST threshold, PFN distance) {
         threshold_ = threshold;
@@ -605,6 +726,8 @@ public:
         pkt_base_ = pkt_last_ = 0;
         correct_last_ = correct_base_ = 0;
         init_ = false;
+        rebase_ = false;
+        delta_ = 0;
     }
     virtual ~SrsRtcJitter() {
     }
@@ -615,7 +738,14 @@ public:
             correct_base_ = base_;
             pkt_base_ = value;
             srs_trace("RTC: Jitter init base=%u, value=%u", base_, value);
+        } else if (rebase_) {
+            // The source of packets is switched, for example, the layer of simulcast, so the value is not
+            // continuous, and we map it to the last corrected value plus delta.
+            pkt_base_ = value;
+            correct_base_ = correct_last_ + delta_;
+            pkt_last_ = value;
         }
+        rebase_ = false;
 
         if (true) {
             ST distance = distance_(value, pkt_last_);
@@ -632,6 +762,11 @@ public:
 
         return correct_last_;
     }
+    // Rebase the next value to last corrected value plus delta.
+    void rebase(T delta) {
+        rebase_ = true;
+        delta_ = delta;
+    }
 };
 
 // For RTC timestamp jitter.
@@ -644,6 +779,7 @@ public:
     virtual ~SrsRtcTsJitter();
 public:
     uint32_t correct(uint32_t value);
+    void rebase(uint32_t delta);
 };
 
 // For RTC sequence jitter.
@@ -656,6 +792,7 @@ public:
     virtual ~SrsRtcSeqJitter();
 public:
     uint16_t correct(uint16_t value);
+    void rebase(uint16_t delta);
 };
 
 class SrsRtcSendTrack
@@ -672,6 +809,8 @@ protected:
     // The jitter to correct ts and sequence number.
     SrsRtcTsJitter* jitter_ts_;
     SrsRtcSeqJitter* jitter_seq_;
+    // The time of last sent packet, to rebase ts when source switched.
+    srs_utime_t last_sent_at_;
 private:
     // By config, whether no copy.
     bool nack_no_copy_;
@@ -688,6 +827,9 @@ public:
     bool set_track_status(bool active);
     bool get_track_status();
     std::string get_track_id();
+    // When source of packets is switched, for example, the layer of simulcast, the sequence number
+    // and timestamp continue from the last packet, to make the player feel it's the same stream.
+    void on_source_switched();
 protected:
     void rebuild_packet(SrsRtpPacket* pkt);
 public:
@@ -801,6 +801,9 @@ srs_error_t SrsRtmpConn::do_playing(SrsLiveSource* source, SrsLiveConsumer* cons
     bool user_specified_duration_to_stop = (req->duration > 0);
     int64_t starttime = -1;
 
+    // The latency to send messages, NULL if disabled.
+    SrsLatencyHistogram* latency = SrsStatistic::instance()->latency(req, SrsLatencyStageRtmpSend);
+
     // setup the realtime.
     realtime = _srs_config->get_realtime_enabled(req->vhost);
     // setup the mw config.
@@ -897,9 +900,13 @@ srs_error_t SrsRtmpConn::do_playing(SrsLiveSource* source, SrsLiveConsumer* cons
         
         // sendout messages, all messages are freed by send_and_free_messages().
         // no need to assert msg, for the rtmp will assert it.
+        srs_utime_t sendtime = (count > 0 && latency) ? srs_update_system_time() : 0;
         if (count > 0 && (err = rtmp->send_and_free_messages(msgs.msgs, count, info->res->stream_id)) != srs_success) {
             return srs_error_wrap(err, "rtmp: send %d messages", count);
         }
+        if (sendtime) {
+            latency->update(srs_update_system_time() - sendtime);
+        }
         
         // if duration specified, and exceed it, stop play live.
         // @see: https://github.com/ossrs/srs/issues/45
@@ -333,8 +333,8 @@ SrsServer::SrsServer()
     rtmp_listener_ = new SrsMultipleTcpListeners(this);
     api_listener_ = new SrsTcpListener(this);
     apis_listener_ = new SrsTcpListener(this);
-    http_listener_ = new SrsTcpListener(this);
-    https_listener_ = new SrsTcpListener(this);
+    http_listener_ = new SrsMultipleTcpListeners(this);
+    https_listener_ = new SrsMultipleTcpListeners(this);
     webrtc_listener_ = new SrsTcpListener(this);
     stream_caster_flv_listener_ = new SrsHttpFlvListener();
     stream_caster_mpegts_ = new SrsUdpCasterListener();
@@ -571,7 +571,13 @@ srs_error_t SrsServer::listen()
 {
     srs_error_t err = srs_success;
 
+    // The accept options for stream listeners, to survive the reconnect storm.
+    int reuseport = _srs_config->get_accept_reuseport();
+    int accept_batch = _srs_config->get_accept_batch();
+    int accept_rate = _srs_config->get_accept_rate();
+
     // Create RTMP listeners.
+    rtmp_listener_->set_reuseport(reuseport)->set_accept(accept_batch, accept_rate);
     rtmp_listener_->add(_srs_config->get_listens())->set_label("RTMP");
     if ((err = rtmp_listener_->listen()) != srs_success) {
         return srs_error_wrap(err, "rtmp listen");
@@ -603,7 +609,8 @@ srs_error_t SrsServer::listen()
 
     // Create HTTP server listener.
     if (_srs_config->get_http_stream_enabled()) {
-        http_listener_->set_endpoint(_srs_config->get_http_stream_listen())->set_label("HTTP-Server");
+        http_listener_->set_reuseport(reuseport)->set_accept(accept_batch, accept_rate);
+        http_listener_->add(vector<string>(1, _srs_config->get_http_stream_listen()))->set_label("HTTP-Server");
         if ((err = http_listener_->listen()) != srs_success) {
             return srs_error_wrap(err, "http server listen");
         }
@@ -611,7 +618,8 @@ srs_error_t SrsServer::listen()
 
     // Create HTTPS server listener.
     if (_srs_config->get_https_stream_enabled()) {
-        https_listener_->set_endpoint(_srs_config->get_https_stream_listen())->set_label("HTTPS-Server");
+        https_listener_->set_reuseport(reuseport)->set_accept(accept_batch, accept_rate);
+        https_listener_->add(vector<string>(1, _srs_config->get_https_stream_listen()))->set_label("HTTPS-Server");
         if ((err = https_listener_->listen()) != srs_success) {
             return srs_error_wrap(err, "https server listen");
         }
@@ -773,6 +781,10 @@ srs_error_t SrsServer::http_handle()
         return srs_error_wrap(err, "handle tests errors");
     }
 #endif
+    // The built-in CPU profiler, without gperftools.
+    if ((err = http_api_mux->handle("/api/v1/profiler", new SrsGoApiProfiler())) != srs_success) {
+        return srs_error_wrap(err, "handle profiler");
+    }
     // metrics by prometheus
     if ((err = http_api_mux->handle("/metrics", new SrsGoApiMetrics())) != srs_success) {
         return srs_error_wrap(err, "handle tests errors");
@@ -816,6 +828,10 @@ srs_error_t SrsServer::start(SrsWaitGroup* wg)
         return srs_error_wrap(err, "tick");
     }
 
+    if ((err = http_heartbeat->start()) != srs_success) {
+        return srs_error_wrap(err, "heartbeat");
+    }
+
     // OK, we start SRS server.
     wg_ = wg;
     wg->add(1);
@@ -1038,12 +1054,6 @@ srs_error_t SrsServer::setup_ticks()
         }
     }
 
-    if (_srs_config->get_heartbeat_enabled()) {
-        if ((err = timer_->tick(9, _srs_config->get_heartbeat_interval())) != srs_success) {
-            return srs_error_wrap(err, "tick");
-        }
-    }
-
     if ((err = timer_->start()) != srs_success) {
         return srs_error_wrap(err, "timer");
     }
@@ -1062,7 +1072,6 @@ srs_error_t SrsServer::notify(int event, srs_utime_t interval, srs_utime_t tick)
         case 6: srs_update_platform_info(); break;
         case 7: srs_update_network_devices(); break;
         case 8: resample_kbps(); break;
-        case 9: http_heartbeat->heartbeat(); break;
         case 10: srs_update_udp_snmp_statistic(); break;
     }
 
@@ -228,6 +228,7 @@ SrsMessageQueue::SrsMessageQueue(bool ignore_shrink)
 {
     _ignore_shrink = ignore_shrink;
     max_queue_size = 0;
+    nn_dropped_ = 0;
     av_start_time = av_end_time = -1;
 }
 
@@ -246,6 +247,11 @@ srs_utime_t SrsMessageQueue::duration()
     return (av_end_time - av_start_time);
 }
 
+int64_t SrsMessageQueue::dropped()
+{
+    return nn_dropped_;
+}
+
 void SrsMessageQueue::set_queue_size(srs_utime_t queue_size)
 {
 	max_queue_size = queue_size;
@@ -373,6 +379,8 @@ void SrsMessageQueue::shrink()
         audio_sh->timestamp = srsu2ms(av_end_time);
         msgs.push_back(audio_sh);
     }
+
+    nn_dropped_ += msgs_size - (int)msgs.size();
     
     if (!_ignore_shrink) {
         srs_trace("shrinking, size=%d, removed=%d, max=%dms", (int)msgs.size(), msgs_size - (int)msgs.size(), srsu2msi(max_queue_size));
@@ -412,6 +420,9 @@ SrsLiveConsumer::SrsLiveConsumer(SrsLiveSource* s)
     jitter = new SrsRtmpJitter();
     queue = new SrsMessageQueue();
     should_update_source_id = false;
+    nn_sampled_dropped_ = 0;
+    latency_ = NULL;
+    queue_since_ = 0;
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     mw_wait = srs_cond_new();
@@ -442,6 +453,19 @@ void SrsLiveConsumer::update_source_id()
     should_update_source_id = true;
 }
 
+void SrsLiveConsumer::set_latency(SrsLatencyHistogram* v)
+{
+    latency_ = v;
+}
+
+void SrsLiveConsumer::sample_queue(int64_t& dropped, srs_utime_t& duration)
+{
+    dropped = queue->dropped() - nn_sampled_dropped_;
+    nn_sampled_dropped_ = queue->dropped();
+
+    duration = queue->duration();
+}
+
 int64_t SrsLiveConsumer::get_time()
 {
     return jitter->get_time();
@@ -462,6 +486,11 @@ srs_error_t SrsLiveConsumer::enqueue(SrsSharedPtrMessage* shared_msg, bool atc,
     if ((err = queue->enqueue(msg, NULL)) != srs_success) {
         return srs_error_wrap(err, "enqueue message");
     }
+
+    // Start to wait when the queue is not empty.
+    if (latency_ && !queue_since_) {
+        queue_since_ = srs_update_system_time();
+    }
     
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     // fire the mw when msgs is enough.
@@ -519,6 +548,14 @@ srs_error_t SrsLiveConsumer::dump_packets(SrsMessageArray* msgs, int& count)
     if ((err = queue->dump_packets(max, msgs->msgs, count)) != srs_success) {
         return srs_error_wrap(err, "dump packets");
     }
+
+    // The oldest message dumped waits since the queue is not empty, or the previous dump. The left messages
+    // start to wait from now.
+    if (latency_ && count > 0 && queue_since_) {
+        srs_utime_t now = srs_update_system_time();
+        latency_->update(now - queue_since_);
+        queue_since_ = queue->size() > 0 ? now : 0;
+    }
     
     return err;
 }
@@ -716,6 +753,11 @@ srs_utime_t SrsGopCache::start_time()
     return srs_utime_t(msg->timestamp * SRS_UTIME_MILLISECONDS);
 }
 
+int SrsGopCache::size()
+{
+    return (int)gop_cache.size();
+}
+
 bool SrsGopCache::pure_audio()
 {
     return cached_video_count == 0;
@@ -1940,6 +1982,9 @@ SrsLiveSource::SrsLiveSource()
     
     is_monotonically_increase = false;
     last_packet_time = 0;
+    nn_consumers_dropped_ = 0;
+    fanout_latency_ = NULL;
+    queue_latency_ = NULL;
     
     _srs_config->subscribe(this);
     atc = false;
@@ -1979,6 +2024,26 @@ srs_error_t SrsLiveSource::cycle()
     if (err != srs_success) {
         return srs_error_wrap(err, "hub cycle");
     }
+
+    // Sample the gop cache and queue of consumers, for the metrics of stream.
+    if (req) {
+        int64_t dropped = nn_consumers_dropped_;
+        srs_utime_t queue_duration = 0;
+        nn_consumers_dropped_ = 0;
+
+        for (int i = 0; i < (int)consumers.size(); i++) {
+            SrsLiveConsumer* consumer = consumers.at(i);
+
+            int64_t nn = 0;
+            srs_utime_t duration = 0;
+            consumer->sample_queue(nn, duration);
+
+            dropped += nn;
+            queue_duration = srs_max(queue_duration, duration);
+        }
+
+        SrsStatistic::instance()->on_stream_queue(req, gop_cache->size(), dropped, queue_duration);
+    }
     
     return srs_success;
 }
@@ -2019,6 +2084,9 @@ srs_error_t SrsLiveSource::initialize(SrsRequest* r, ISrsLiveSourceHandler* h)
     req = r->copy();
     atc = _srs_config->get_atc(req->vhost);
 
+    fanout_latency_ = SrsStatistic::instance()->latency(req, SrsLatencyStageRtmpFanout);
+    queue_latency_ = SrsStatistic::instance()->latency(req, SrsLatencyStageRtmpQueue);
+
     if ((err = format_->initialize()) != srs_success) {
         return srs_error_wrap(err, "format initialize");
     }
@@ -2324,13 +2392,17 @@ srs_error_t SrsLiveSource::on_audio_imp(SrsSharedPtrMessage* msg)
     }
 
     // copy to all consumer
-    if (!drop_for_reduce) {
+    if (!drop_for_reduce && !consumers.empty()) {
+        srs_utime_t starttime = fanout_latency_ ? srs_update_system_time() : 0;
         for (int i = 0; i < (int)consumers.size(); i++) {
             SrsLiveConsumer* consumer = consumers.at(i);
             if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
                 return srs_error_wrap(err, "consume message");
             }
         }
+        if (fanout_latency_) {
+            fanout_latency_->update(srs_update_system_time() - starttime);
+        }
     }
     
     // Refresh the sequence header in metadata.
@@ -2469,13 +2541,17 @@ srs_error_t SrsLiveSource::on_video_imp(SrsSharedPtrMessage* msg)
     }
 
     // copy to all consumer
-    if (!drop_for_reduce) {
+    if (!drop_for_reduce && !consumers.empty()) {
+        srs_utime_t starttime = fanout_latency_ ? srs_update_system_time() : 0;
         for (int i = 0; i < (int)consumers.size(); i++) {
             SrsLiveConsumer* consumer = consumers.at(i);
             if ((err = consumer->enqueue(msg, atc, jitter_algorithm)) != srs_success) {
                 return srs_error_wrap(err, "consume video");
             }
         }
+        if (fanout_latency_) {
+            fanout_latency_->update(srs_update_system_time() - starttime);
+        }
     }
     
     // when sequence header, donot push to gop cache and adjust the timestamp.
@@ -2689,6 +2765,7 @@ srs_error_t SrsLiveSource::create_consumer(SrsLiveConsumer*& consumer)
     srs_error_t err = srs_success;
     
     consumer = new SrsLiveConsumer(this);
+    consumer->set_latency(queue_latency_);
     consumers.push_back(consumer);
     
     // for edge, when play edge stream, check the state
@@ -2747,6 +2824,12 @@ srs_error_t SrsLiveSource::consumer_dumps(SrsLiveConsumer* consumer, bool ds, bo
 
 void SrsLiveSource::on_consumer_destroy(SrsLiveConsumer* consumer)
 {
+    // Keep the dropped messages of consumer, for the next sample of source.
+    int64_t dropped = 0;
+    srs_utime_t duration = 0;
+    consumer->sample_queue(dropped, duration);
+    nn_consumers_dropped_ += dropped;
+
     std::vector<SrsLiveConsumer*>::iterator it;
     it = std::find(consumers.begin(), consumers.end(), consumer);
     if (it != consumers.end()) {
@@ -2759,6 +2842,16 @@ void SrsLiveSource::on_consumer_destroy(SrsLiveConsumer* consumer)
     }
 }
 
+bool SrsLiveSource::has_consumers()
+{
+    return !consumers.empty();
+}
+
+void SrsLiveSource::clear_gop_cache()
+{
+    gop_cache->clear();
+}
+
 void SrsLiveSource::set_cache(bool enabled)
 {
     gop_cache->set(enabled);
@@ -42,6 +42,7 @@ class SrsDvr;
 class SrsDash;
 class SrsEncoder;
 class SrsBuffer;
+class SrsLatencyHistogram;
 #ifdef SRS_HDS
 class SrsHds;
 #endif
@@ -112,6 +113,8 @@ private:
     bool _ignore_shrink;
     // The max queue size, shrink if exceed it.
     srs_utime_t max_queue_size;
+    // The number of messages dropped by shrinking.
+    int64_t nn_dropped_;
 #ifdef SRS_PERF_QUEUE_FAST_VECTOR
     SrsFastVector msgs;
 #else
@@ -125,6 +128,8 @@ public:
     virtual int size();
     // Get the duration of queue.
     virtual srs_utime_t duration();
+    // Get the total number of messages dropped by shrinking.
+    virtual int64_t dropped();
     // Set the queue size
     // @param queue_size the queue size in srs_utime_t.
     virtual void set_queue_size(srs_utime_t queue_size);
@@ -174,6 +179,12 @@ private:
     bool paused;
     // when source id changed, notice all consumers
     bool should_update_source_id;
+    // The dropped messages of queue, which is already sampled.
+    int64_t nn_sampled_dropped_;
+    // The latency of messages in queue, NULL if disabled.
+    SrsLatencyHistogram* latency_;
+    // The time since the oldest message waits in queue, 0 if queue is empty.
+    srs_utime_t queue_since_;
 #ifdef SRS_PERF_QUEUE_COND_WAIT
     // The cond wait for mw.
     srs_cond_t mw_wait;
@@ -189,6 +200,12 @@ public:
     virtual void set_queue_size(srs_utime_t queue_size);
     // when source id changed, notice client to print.
     virtual void update_source_id();
+    // Set the latency histogram of queue, NULL to disable it.
+    virtual void set_latency(SrsLatencyHistogram* v);
+    // Sample the queue for metrics of stream.
+    // @param dropped The messages dropped since last sample.
+    // @param duration The duration of queue.
+    virtual void sample_queue(int64_t& dropped, srs_utime_t& duration);
 public:
     // Get current client time, the last packet time.
     virtual int64_t get_time();
@@ -272,6 +289,8 @@ public:
     // Get the start time of gop cache, in srs_utime_t.
     // @return 0 if no packets.
     virtual srs_utime_t start_time();
+    // Get the number of messages in gop cache.
+    virtual int size();
     // whether current stream is pure audio,
     // when no video in gop cache, the stream is pure audio right now.
     virtual bool pure_audio();
@@ -500,6 +519,11 @@ private:
     SrsRequest* req;
     // To delivery stream to clients.
     std::vector<SrsLiveConsumer*> consumers;
+    // The dropped messages of consumers destroyed, not sampled yet.
+    int64_t nn_consumers_dropped_;
+    // The latency of fan-out and queue of consumers, NULL if disabled.
+    SrsLatencyHistogram* fanout_latency_;
+    SrsLatencyHistogram* queue_latency_;
     // The time jitter algorithm for vhost.
     SrsRtmpJitterAlgorithm jitter_algorithm;
     // For play, whether use interlaced/mixed algorithm to correct timestamp.
@@ -593,6 +617,10 @@ public:
     // @param dg, whether dumps the gop cache.
     virtual srs_error_t consumer_dumps(SrsLiveConsumer* consumer, bool ds = true, bool dm = true, bool dg = true);
     virtual void on_consumer_destroy(SrsLiveConsumer* consumer);
+    // Whether there are consumers, for lazy bridge to start or stop.
+    virtual bool has_consumers();
+    // Drop the cached GOP, for example, it's stale when bridge is suspended.
+    virtual void clear_gop_cache();
     virtual void set_cache(bool enabled);
     virtual void set_gop_cache_max_frames(int v);
     virtual SrsRtmpJitterAlgorithm jitter();
@@ -13,6 +13,12 @@ using namespace std;
 #include <srs_kernel_log.hpp>
 #include <srs_app_utility.hpp>
 #include <srs_app_log.hpp>
+#include <srs_protocol_log.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_kernel_utility.hpp>
+
+// The key of coroutine label, which is the name of SrsFastCoroutine, for scheduler stat.
+static int _srs_coroutine_label_key = -1;
 
 ISrsCoroutineHandler::ISrsCoroutineHandler()
 {
@@ -281,6 +287,12 @@ srs_error_t SrsFastCoroutine::cycle()
         }
         _srs_context->set_id(cid_);
     }
+
+    if (_srs_coroutine_label_key < 0) {
+        int r0 = srs_key_create(&_srs_coroutine_label_key, NULL);
+        srs_assert(r0 == 0);
+    }
+    srs_thread_setspecific(_srs_coroutine_label_key, (void*)name.c_str());
     
     srs_error_t err = handler->cycle();
     if (err != srs_success) {
@@ -299,6 +311,9 @@ void* SrsFastCoroutine::pfn(void* arg)
 
     srs_error_t err = p->cycle();
 
+    // The label is freed with coroutine, which might be freed when joined.
+    srs_thread_setspecific(_srs_coroutine_label_key, NULL);
+
     // Set the err for function pull to fetch it.
     // @see https://github.com/ossrs/srs/pull/1304#issuecomment-480484151
     if (err != srs_success) {
@@ -342,3 +357,187 @@ void SrsWaitGroup::wait()
     }
 }
 
+// The edges of slice histogram, the last bucket is for the rest.
+static srs_utime_t _srs_sched_slice_edges[SRS_SCHED_SLICE_BUCKETS - 1] = {
+    100, 1 * SRS_UTIME_MILLISECONDS, 5 * SRS_UTIME_MILLISECONDS, 10 * SRS_UTIME_MILLISECONDS,
+    50 * SRS_UTIME_MILLISECONDS, 100 * SRS_UTIME_MILLISECONDS
+};
+static const char* _srs_sched_slice_names[SRS_SCHED_SLICE_BUCKETS] = {
+    "100us", "1ms", "5ms", "10ms", "50ms", "100ms", "+Inf"
+};
+
+void SrsSchedulerWindow::reset(srs_utime_t now)
+{
+    memset(this, 0, sizeof(SrsSchedulerWindow));
+    starttime = now;
+}
+
+// The scheduler stat of current thread, for the switch callbacks.
+static __thread SrsSchedulerStat* _srs_sched_stat = NULL;
+
+static void srs_sched_on_switch_in()
+{
+    _srs_sched_stat->on_switch_in(srs_utime_now(), srs_utime_last_clock());
+}
+
+static void srs_sched_on_switch_out()
+{
+    _srs_sched_stat->on_switch_out(srs_utime_now());
+}
+
+SrsSchedulerStat::SrsSchedulerStat()
+{
+    current_.reset(srs_utime_now());
+    last_.reset(0);
+    nn_rounds_ = nn_slices_ = 0;
+
+    switch_in_ = 0;
+    last_clock_ = 0;
+    depth_ = 0;
+}
+
+SrsSchedulerStat::~SrsSchedulerStat()
+{
+    uninstall();
+}
+
+void SrsSchedulerStat::install()
+{
+    _srs_sched_stat = this;
+    srs_thread_set_switch_cb(srs_sched_on_switch_in, srs_sched_on_switch_out);
+}
+
+void SrsSchedulerStat::uninstall()
+{
+    if (_srs_sched_stat != this) {
+        return;
+    }
+
+    srs_thread_set_switch_cb(NULL, NULL);
+    _srs_sched_stat = NULL;
+}
+
+void SrsSchedulerStat::on_switch_in(srs_utime_t now, srs_utime_t clock)
+{
+    // The clock is updated after epoll wait, so it's a new round of event loop.
+    if (clock != last_clock_) {
+        if (depth_ > 0) {
+            on_round(depth_);
+        }
+        depth_ = 0;
+        last_clock_ = clock;
+    }
+
+    depth_++;
+    switch_in_ = now;
+
+    // Rotate the window, only the complete window is dumped.
+    if (now - current_.starttime >= SRS_SCHED_WINDOW) {
+        current_.duration = now - current_.starttime;
+        last_ = current_;
+        current_.reset(now);
+    }
+}
+
+void SrsSchedulerStat::on_switch_out(srs_utime_t now)
+{
+    // Ignore the first slice, which is not switched in after installed.
+    if (!switch_in_ || now < switch_in_) {
+        return;
+    }
+
+    srs_utime_t duration = now - switch_in_;
+    switch_in_ = 0;
+
+    nn_slices_++;
+    current_.nn_slices++;
+    current_.run_time += duration;
+
+    int i = 0;
+    while (i < SRS_SCHED_SLICE_BUCKETS - 1 && duration >= _srs_sched_slice_edges[i]) {
+        i++;
+    }
+    current_.slices[i]++;
+
+    // Only peek the cid and label for the longest slices.
+    if (current_.nn_top < SRS_SCHED_TOP_SLICES || duration > current_.top[SRS_SCHED_TOP_SLICES - 1].duration) {
+        on_slice(now, duration);
+    }
+}
+
+void SrsSchedulerStat::dumps(SrsJsonObject* obj)
+{
+    // Never dump the current window, which is changing.
+    SrsSchedulerWindow w = last_;
+
+    obj->set("rounds", SrsJsonAny::integer(nn_rounds_));
+    obj->set("slices", SrsJsonAny::integer(nn_slices_));
+    obj->set("window_ms", SrsJsonAny::integer(srsu2ms(w.duration)));
+
+    double run_percent = w.duration ? 100.0 * w.run_time / w.duration : 0;
+    obj->set("run_percent", SrsJsonAny::number(run_percent));
+    obj->set("wait_percent", SrsJsonAny::number(w.duration ? 100 - run_percent : 0));
+    obj->set("rounds_per_second", SrsJsonAny::integer(w.duration ? w.nn_rounds * SRS_UTIME_SECONDS / w.duration : 0));
+
+    SrsJsonObject* runq = SrsJsonAny::object();
+    obj->set("runq", runq);
+    for (int i = 0; i < SRS_SCHED_RUNQ_BUCKETS; i++) {
+        runq->set(srs_int2str(1 << i), SrsJsonAny::integer(w.runq[i]));
+    }
+
+    SrsJsonObject* slices = SrsJsonAny::object();
+    obj->set("slice", slices);
+    for (int i = 0; i < SRS_SCHED_SLICE_BUCKETS; i++) {
+        slices->set(_srs_sched_slice_names[i], SrsJsonAny::integer(w.slices[i]));
+    }
+
+    SrsJsonArray* top = SrsJsonAny::array();
+    obj->set("top", top);
+    for (int i = 0; i < w.nn_top; i++) {
+        SrsCoroutineSlice& slice = w.top[i];
+
+        SrsJsonObject* p = SrsJsonAny::object();
+        top->append(p);
+
+        p->set("cid", SrsJsonAny::str(slice.cid));
+        p->set("label", SrsJsonAny::str(slice.label));
+        p->set("ms", SrsJsonAny::number(slice.duration / 1000.0));
+        p->set("at", SrsJsonAny::integer(srsu2ms(slice.at)));
+    }
+}
+
+void SrsSchedulerStat::on_round(int depth)
+{
+    nn_rounds_++;
+    current_.nn_rounds++;
+
+    int i = 0;
+    while (i < SRS_SCHED_RUNQ_BUCKETS - 1 && (depth >> (i + 1)) > 0) {
+        i++;
+    }
+    current_.runq[i]++;
+}
+
+void SrsSchedulerStat::on_slice(srs_utime_t now, srs_utime_t duration)
+{
+    // Insert to the sorted top slices, drop the shortest one if full.
+    int i = srs_min(current_.nn_top, SRS_SCHED_TOP_SLICES - 1);
+    for (; i > 0 && current_.top[i - 1].duration < duration; i--) {
+        current_.top[i] = current_.top[i - 1];
+    }
+    current_.nn_top = srs_min(current_.nn_top + 1, SRS_SCHED_TOP_SLICES);
+
+    SrsCoroutineSlice& slice = current_.top[i];
+    slice.duration = duration;
+    slice.at = now;
+
+    if (!srs_context_peek_cid(slice.cid, sizeof(slice.cid))) {
+        slice.cid[0] = 0;
+    }
+
+    const char* label = NULL;
+    if (_srs_coroutine_label_key >= 0) {
+        label = (const char*)srs_thread_getspecific(_srs_coroutine_label_key);
+    }
+    snprintf(slice.label, sizeof(slice.label), "%s", label ? label : "");
+}
@@ -17,6 +17,7 @@
 #include <srs_protocol_io.hpp>
 
 class SrsFastCoroutine;
+class SrsJsonObject;
 
 // Each ST-coroutine must implements this interface,
 // to do the cycle job and handle some events.
@@ -210,5 +211,82 @@ public:
     void wait();
 };
 
+// The buckets of run-queue depth histogram, in log2, that is 1, 2~3, 4~7, ..., 512+.
+#define SRS_SCHED_RUNQ_BUCKETS 10
+// The buckets of slice histogram, see _srs_sched_slice_edges.
+#define SRS_SCHED_SLICE_BUCKETS 7
+// The number of longest slices to keep.
+#define SRS_SCHED_TOP_SLICES 10
+// The window to rotate the stat.
+#define SRS_SCHED_WINDOW (10 * SRS_UTIME_SECONDS)
+
+// A slice is the time a coroutine runs, from switch in to switch out.
+struct SrsCoroutineSlice
+{
+    srs_utime_t duration;
+    // The time when switch out.
+    srs_utime_t at;
+    char cid[16];
+    char label[24];
+};
+
+// The stat of scheduler in a window.
+struct SrsSchedulerWindow
+{
+    srs_utime_t starttime;
+    srs_utime_t duration;
+    // The rounds of event loop, each round waits in epoll then runs the ready coroutines.
+    uint64_t nn_rounds;
+    uint64_t nn_slices;
+    // The total time of slices, the rest of window is waiting in epoll or scheduling.
+    srs_utime_t run_time;
+    // The number of rounds, by the number of coroutines run in round.
+    uint32_t runq[SRS_SCHED_RUNQ_BUCKETS];
+    // The number of slices, by the duration of slice.
+    uint32_t slices[SRS_SCHED_SLICE_BUCKETS];
+    // The longest slices, sorted in desc.
+    SrsCoroutineSlice top[SRS_SCHED_TOP_SLICES];
+    int nn_top;
+
+    void reset(srs_utime_t now);
+};
+
+// The scheduler stat of ST for a thread, driven by the context switch callbacks of ST. A round of event loop is
+// detected by the clock of ST, which is updated after each epoll wait, so the run-queue depth is the number of
+// coroutines run in the round.
+// @remark The stat is written by its thread, and read by API of other thread without lock, for diagnosis only.
+class SrsSchedulerStat
+{
+private:
+    // The current window, and the last complete window to dump.
+    SrsSchedulerWindow current_;
+    SrsSchedulerWindow last_;
+    uint64_t nn_rounds_;
+    uint64_t nn_slices_;
+private:
+    // The time when current coroutine switch in, 0 if unknown.
+    srs_utime_t switch_in_;
+    // The clock of ST, to detect the new round.
+    srs_utime_t last_clock_;
+    // The number of coroutines run in current round.
+    int depth_;
+public:
+    SrsSchedulerStat();
+    virtual ~SrsSchedulerStat();
+public:
+    // Install the stat to the switch callbacks of current thread.
+    void install();
+    void uninstall();
+public:
+    void on_switch_in(srs_utime_t now, srs_utime_t clock);
+    void on_switch_out(srs_utime_t now);
+    // Dumps the last complete window.
+    void dumps(SrsJsonObject* obj);
+private:
+    void on_round(int depth);
+    // Insert the slice to top slices, with the cid and label of current coroutine.
+    void on_slice(srs_utime_t now, srs_utime_t duration);
+};
+
 #endif
 
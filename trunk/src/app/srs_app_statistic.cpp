@@ -7,7 +7,11 @@
 #include <srs_app_statistic.hpp>
 
 #include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include <sstream>
+#include <algorithm>
 using namespace std;
 
 #include <srs_protocol_rtmp_stack.hpp>
@@ -22,11 +26,135 @@ using namespace std;
 #include <srs_kernel_kbps.hpp>
 #include <srs_app_utility.hpp>
 
+// The window of latency percentiles.
+#define SRS_LATENCY_WINDOW (60 * SRS_UTIME_SECONDS)
+
 string srs_generate_stat_vid()
 {
     return "vid-" + srs_random_str(7);
 }
 
+const char* srs_latency_stage2str(SrsLatencyStage stage)
+{
+    switch (stage) {
+        case SrsLatencyStageRtmpPublish: return "rtmp_publish";
+        case SrsLatencyStageRtmpFanout: return "rtmp_fanout";
+        case SrsLatencyStageRtmpQueue: return "rtmp_queue";
+        case SrsLatencyStageRtmpSend: return "rtmp_send";
+        case SrsLatencyStageRtcPublish: return "rtc_publish";
+        case SrsLatencyStageRtcFanout: return "rtc_fanout";
+        case SrsLatencyStageRtcQueue: return "rtc_queue";
+        case SrsLatencyStageRtcSend: return "rtc_send";
+        default: return "unknown";
+    }
+}
+
+SrsLatencyHistogram::SrsLatencyHistogram()
+{
+    memset(buckets_, 0, sizeof(buckets_));
+    memset(window_, 0, sizeof(window_));
+    memset(next_, 0, sizeof(next_));
+    count_ = 0;
+    sum_ = 0;
+    nn_sample_ = 0;
+}
+
+SrsLatencyHistogram::~SrsLatencyHistogram()
+{
+}
+
+bool SrsLatencyHistogram::sample()
+{
+    return (nn_sample_++ % SRS_LATENCY_SAMPLE_RATE) == 0;
+}
+
+void SrsLatencyHistogram::update(srs_utime_t v)
+{
+    buckets_[bucket_of(v)]++;
+    count_++;
+    sum_ += srs_max(0, v);
+}
+
+void SrsLatencyHistogram::rotate()
+{
+    memcpy(window_, next_, sizeof(window_));
+    memcpy(next_, buckets_, sizeof(next_));
+}
+
+int64_t SrsLatencyHistogram::count()
+{
+    return count_;
+}
+
+srs_utime_t SrsLatencyHistogram::sum()
+{
+    return sum_;
+}
+
+srs_utime_t SrsLatencyHistogram::percentile(double q)
+{
+    int64_t total = 0;
+    for (int i = 0; i < SRS_LATENCY_BUCKETS; i++) {
+        total += buckets_[i] - window_[i];
+    }
+    if (total <= 0) {
+        return 0;
+    }
+
+    // The rank of sample, at least the first one.
+    int64_t rank = srs_max(1, (int64_t)ceil(q * total));
+
+    int64_t nn = 0;
+    for (int i = 0; i < SRS_LATENCY_BUCKETS; i++) {
+        nn += buckets_[i] - window_[i];
+        if (nn >= rank) {
+            return highest_of(i);
+        }
+    }
+
+    return highest_of(SRS_LATENCY_BUCKETS - 1);
+}
+
+void SrsLatencyHistogram::dumps(SrsJsonWriter* w)
+{
+    w->field_integer("count", count_);
+    w->field_integer("avg_us", count_ ? sum_ / count_ : 0);
+    w->field_integer("p50_us", percentile(0.5));
+    w->field_integer("p90_us", percentile(0.9));
+    w->field_integer("p99_us", percentile(0.99));
+    w->field_integer("max_us", percentile(1.0));
+}
+
+int SrsLatencyHistogram::bucket_of(srs_utime_t v)
+{
+    // The small values are linear.
+    if (v < (1 << SRS_LATENCY_SUB_BITS)) {
+        return srs_max(0, (int)v);
+    }
+
+    // The most significant bit, and the shift to keep the sub-bucket bits.
+    int msb = 63 - __builtin_clzll((uint64_t)v);
+    if (msb >= SRS_LATENCY_MAX_BITS) {
+        return SRS_LATENCY_BUCKETS - 1;
+    }
+
+    int shift = msb - SRS_LATENCY_SUB_BITS;
+    int sub = (int)(v >> shift) & ((1 << SRS_LATENCY_SUB_BITS) - 1);
+    return ((shift + 1) << SRS_LATENCY_SUB_BITS) + sub;
+}
+
+srs_utime_t SrsLatencyHistogram::highest_of(int bucket)
+{
+    if (bucket < (1 << SRS_LATENCY_SUB_BITS)) {
+        return bucket;
+    }
+
+    int shift = (bucket >> SRS_LATENCY_SUB_BITS) - 1;
+    int sub = bucket & ((1 << SRS_LATENCY_SUB_BITS) - 1);
+    srs_utime_t lowest = (srs_utime_t)((1 << SRS_LATENCY_SUB_BITS) + sub) << shift;
+    return lowest + ((srs_utime_t)1 << shift) - 1;
+}
+
 SrsStatisticVhost::SrsStatisticVhost()
 {
     id = srs_generate_stat_vid();
@@ -35,14 +163,22 @@ SrsStatisticVhost::SrsStatisticVhost()
 
     nb_clients = 0;
     nb_streams = 0;
+
+    for (int i = 0; i < SrsLatencyStageMax; i++) {
+        latency[i] = NULL;
+    }
 }
 
 SrsStatisticVhost::~SrsStatisticVhost()
 {
     srs_freep(kbps);
+
+    for (int i = 0; i < SrsLatencyStageMax; i++) {
+        srs_freep(latency[i]);
+    }
 }
 
-srs_error_t SrsStatisticVhost::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticVhost::dumps(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
     
@@ -50,27 +186,46 @@ srs_error_t SrsStatisticVhost::dumps(SrsJsonObject* obj)
     bool hls_enabled = _srs_config->get_hls_enabled(vhost);
     bool enabled = _srs_config->get_vhost_enabled(vhost);
     
-    obj->set("id", SrsJsonAny::str(id.c_str()));
-    obj->set("name", SrsJsonAny::str(vhost.c_str()));
-    obj->set("enabled", SrsJsonAny::boolean(enabled));
-    obj->set("clients", SrsJsonAny::integer(nb_clients));
-    obj->set("streams", SrsJsonAny::integer(nb_streams));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-    
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
+    w->begin_object();
+    w->field_str("id", id);
+    w->field_str("name", vhost);
+    w->field_boolean("enabled", enabled);
+    w->field_integer("clients", nb_clients);
+    w->field_integer("streams", nb_streams);
+    w->field_integer("send_bytes", kbps->get_send_bytes());
+    w->field_integer("recv_bytes", kbps->get_recv_bytes());
     
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
-    
-    SrsJsonObject* hls = SrsJsonAny::object();
-    obj->set("hls", hls);
+    w->begin_object("kbps");
+    w->field_integer("recv_30s", kbps->get_recv_kbps_30s());
+    w->field_integer("send_30s", kbps->get_send_kbps_30s());
+    w->end_object();
+
+    bool has_latency = false;
+    for (int i = 0; i < SrsLatencyStageMax; i++) {
+        if (!latency[i]) {
+            continue;
+        }
+
+        if (!has_latency) {
+            has_latency = true;
+            w->begin_object("latency");
+        }
+
+        w->begin_object(srs_latency_stage2str((SrsLatencyStage)i));
+        latency[i]->dumps(w);
+        w->end_object();
+    }
+    if (has_latency) {
+        w->end_object();
+    }
     
-    hls->set("enabled", SrsJsonAny::boolean(hls_enabled));
+    w->begin_object("hls");
+    w->field_boolean("enabled", hls_enabled);
     if (hls_enabled) {
-        hls->set("fragment", SrsJsonAny::number(srsu2msi(_srs_config->get_hls_fragment(vhost))/1000.0));
+        w->field_number("fragment", srsu2msi(_srs_config->get_hls_fragment(vhost))/1000.0);
     }
+    w->end_object();
+    w->end_object();
     
     return err;
 }
@@ -93,6 +248,18 @@ SrsStatisticStream::SrsStatisticStream()
     aac_object = SrsAacObjectTypeReserved;
     width = 0;
     height = 0;
+
+    nn_transcode_frames = 0;
+    transcode_latency = 0;
+    transcode_cpu = 0;
+
+    nn_dropped_msgs = 0;
+    gop_cache_msgs = 0;
+    queue_duration = 0;
+
+    index_ = -1;
+    next_id_ = NULL;
+    next_url_ = NULL;
     
     kbps = new SrsKbps();
 
@@ -106,72 +273,84 @@ SrsStatisticStream::~SrsStatisticStream()
     srs_freep(frames);
 }
 
-srs_error_t SrsStatisticStream::dumps(SrsJsonObject* obj)
+void SrsStatisticStream::sample()
+{
+    kbps->sample();
+    frames->update();
+}
+
+srs_error_t SrsStatisticStream::dumps(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
+
+    w->begin_object();
+    w->field_str("id", id);
+    w->field_str("name", stream);
+    w->field_str("vhost", vhost->id);
+    w->field_str("app", app);
+    w->field_str("tcUrl", tcUrl);
+    w->field_str("url", url);
+    w->field_integer("live_ms", srsu2ms(srs_get_system_time()));
+    w->field_integer("clients", nb_clients);
+    w->field_integer("frames", frames->sugar);
+    w->field_integer("send_bytes", kbps->get_send_bytes());
+    w->field_integer("recv_bytes", kbps->get_recv_bytes());
     
-    obj->set("id", SrsJsonAny::str(id.c_str()));
-    obj->set("name", SrsJsonAny::str(stream.c_str()));
-    obj->set("vhost", SrsJsonAny::str(vhost->id.c_str()));
-    obj->set("app", SrsJsonAny::str(app.c_str()));
-    obj->set("tcUrl", SrsJsonAny::str(tcUrl.c_str()));
-    obj->set("url", SrsJsonAny::str(url.c_str()));
-    obj->set("live_ms", SrsJsonAny::integer(srsu2ms(srs_get_system_time())));
-    obj->set("clients", SrsJsonAny::integer(nb_clients));
-    obj->set("frames", SrsJsonAny::integer(frames->sugar));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-    
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
-    
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
-    
-    SrsJsonObject* publish = SrsJsonAny::object();
-    obj->set("publish", publish);
+    w->begin_object("kbps");
+    w->field_integer("recv_30s", kbps->get_recv_kbps_30s());
+    w->field_integer("send_30s", kbps->get_send_kbps_30s());
+    w->end_object();
     
-    publish->set("active", SrsJsonAny::boolean(active));
+    w->begin_object("publish");
+    w->field_boolean("active", active);
     if (!publisher_id.empty()) {
-        publish->set("cid", SrsJsonAny::str(publisher_id.c_str()));
+        w->field_str("cid", publisher_id);
     }
+    w->end_object();
     
     if (!has_video) {
-        obj->set("video", SrsJsonAny::null());
+        w->field_null("video");
     } else {
-        SrsJsonObject* video = SrsJsonAny::object();
-        obj->set("video", video);
-        
-        video->set("codec", SrsJsonAny::str(srs_video_codec_id2str(vcodec).c_str()));
+        w->begin_object("video");
+        w->field_str("codec", srs_video_codec_id2str(vcodec));
 
         if (vcodec == SrsVideoCodecIdAVC) {
-            video->set("profile", SrsJsonAny::str(srs_avc_profile2str(avc_profile).c_str()));
-            video->set("level", SrsJsonAny::str(srs_avc_level2str(avc_level).c_str()));
+            w->field_str("profile", srs_avc_profile2str(avc_profile));
+            w->field_str("level", srs_avc_level2str(avc_level));
 #ifdef SRS_H265
         } else if (vcodec == SrsVideoCodecIdHEVC) {
-            video->set("profile", SrsJsonAny::str(srs_hevc_profile2str(hevc_profile).c_str()));
-            video->set("level", SrsJsonAny::str(srs_hevc_level2str(hevc_level).c_str()));
+            w->field_str("profile", srs_hevc_profile2str(hevc_profile));
+            w->field_str("level", srs_hevc_level2str(hevc_level));
 #endif
         } else {
-            video->set("profile", SrsJsonAny::str("Other"));
-            video->set("level", SrsJsonAny::str("Other"));
+            w->field_str("profile", "Other");
+            w->field_str("level", "Other");
         }
 
-        video->set("width", SrsJsonAny::integer(width));
-        video->set("height", SrsJsonAny::integer(height));
+        w->field_integer("width", width);
+        w->field_integer("height", height);
+        w->end_object();
     }
     
     if (!has_audio) {
-        obj->set("audio", SrsJsonAny::null());
+        w->field_null("audio");
     } else {
-        SrsJsonObject* audio = SrsJsonAny::object();
-        obj->set("audio", audio);
-        
-        audio->set("codec", SrsJsonAny::str(srs_audio_codec_id2str(acodec).c_str()));
-        audio->set("sample_rate", SrsJsonAny::integer(srs_flv_srates[asample_rate]));
-        audio->set("channel", SrsJsonAny::integer(asound_type + 1));
-        audio->set("profile", SrsJsonAny::str(srs_aac_object2str(aac_object).c_str()));
+        w->begin_object("audio");
+        w->field_str("codec", srs_audio_codec_id2str(acodec));
+        w->field_integer("sample_rate", srs_flv_srates[asample_rate]);
+        w->field_integer("channel", asound_type + 1);
+        w->field_str("profile", srs_aac_object2str(aac_object));
+        w->end_object();
     }
+
+    if (nn_transcode_frames > 0) {
+        w->begin_object("transcode");
+        w->field_integer("frames", nn_transcode_frames);
+        w->field_integer("avg_latency_us", transcode_latency / nn_transcode_frames);
+        w->field_integer("cpu_ms", srsu2ms(transcode_cpu));
+        w->end_object();
+    }
+    w->end_object();
     
     return err;
 }
@@ -212,6 +391,14 @@ SrsStatisticClient::SrsStatisticClient()
     create = srs_get_system_time();
 
     kbps = new SrsKbps();
+
+    has_bwe = false;
+    bwe_kbps = 0;
+    bwe_loss = 0;
+    pacer_delay = 0;
+
+    index_ = -1;
+    next_id_ = NULL;
 }
 
 SrsStatisticClient::~SrsStatisticClient()
@@ -220,34 +407,53 @@ SrsStatisticClient::~SrsStatisticClient()
 	srs_freep(req);
 }
 
-srs_error_t SrsStatisticClient::dumps(SrsJsonObject* obj)
+srs_error_t SrsStatisticClient::dumps(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
-    
-    obj->set("id", SrsJsonAny::str(id.c_str()));
-    obj->set("vhost", SrsJsonAny::str(stream->vhost->id.c_str()));
-    obj->set("stream", SrsJsonAny::str(stream->id.c_str()));
-    obj->set("ip", SrsJsonAny::str(req->ip.c_str()));
-    obj->set("pageUrl", SrsJsonAny::str(req->pageUrl.c_str()));
-    obj->set("swfUrl", SrsJsonAny::str(req->swfUrl.c_str()));
-    obj->set("tcUrl", SrsJsonAny::str(req->tcUrl.c_str()));
-    obj->set("url", SrsJsonAny::str(req->get_stream_url().c_str()));
-    obj->set("name", SrsJsonAny::str(req->stream.c_str()));
-    obj->set("type", SrsJsonAny::str(srs_client_type_string(type).c_str()));
-    obj->set("publish", SrsJsonAny::boolean(srs_client_type_is_publish(type)));
-    obj->set("alive", SrsJsonAny::number(srsu2ms(srs_get_system_time() - create) / 1000.0));
-    obj->set("send_bytes", SrsJsonAny::integer(kbps->get_send_bytes()));
-    obj->set("recv_bytes", SrsJsonAny::integer(kbps->get_recv_bytes()));
-
-    SrsJsonObject* okbps = SrsJsonAny::object();
-    obj->set("kbps", okbps);
-
-    okbps->set("recv_30s", SrsJsonAny::integer(kbps->get_recv_kbps_30s()));
-    okbps->set("send_30s", SrsJsonAny::integer(kbps->get_send_kbps_30s()));
+
+    w->begin_object();
+    w->field_str("id", id);
+    w->field_str("vhost", stream->vhost->id);
+    w->field_str("stream", stream->id);
+    w->field_str("ip", req->ip);
+    w->field_str("pageUrl", req->pageUrl);
+    w->field_str("swfUrl", req->swfUrl);
+    w->field_str("tcUrl", req->tcUrl);
+    w->field_str("url", req->get_stream_url());
+    w->field_str("name", req->stream);
+    w->field_str("type", srs_client_type_string(type));
+    w->field_boolean("publish", srs_client_type_is_publish(type));
+    w->field_number("alive", srsu2ms(srs_get_system_time() - create) / 1000.0);
+    w->field_integer("send_bytes", kbps->get_send_bytes());
+    w->field_integer("recv_bytes", kbps->get_recv_bytes());
+
+    w->begin_object("kbps");
+    w->field_integer("recv_30s", kbps->get_recv_kbps_30s());
+    w->field_integer("send_30s", kbps->get_send_kbps_30s());
+    w->end_object();
+
+    if (has_bwe) {
+        w->begin_object("bwe");
+        w->field_integer("estimate_kbps", bwe_kbps);
+        w->field_number("loss", bwe_loss);
+        w->field_integer("pacer_delay_ms", pacer_delay);
+        w->end_object();
+    }
+    w->end_object();
     
     return err;
 }
 
+uint32_t srs_statistic_hash(const string& key)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < (int)key.length(); i++) {
+        h ^= (uint8_t)key.at(i);
+        h *= 16777619u;
+    }
+    return h;
+}
+
 SrsStatistic* SrsStatistic::_instance = NULL;
 
 SrsStatistic::SrsStatistic()
@@ -256,6 +462,7 @@ SrsStatistic::SrsStatistic()
 
     nb_clients_ = 0;
     nb_errs_ = 0;
+    latency_rotate_at_ = 0;
 }
 
 SrsStatistic::~SrsStatistic()
@@ -269,25 +476,19 @@ SrsStatistic::~SrsStatistic()
             srs_freep(vhost);
         }
     }
-    if (true) {
-        std::map<std::string, SrsStatisticStream*>::iterator it;
-        for (it = streams.begin(); it != streams.end(); it++) {
-            SrsStatisticStream* stream = it->second;
-            srs_freep(stream);
-        }
+    for (int i = 0; i < streams.slots(); i++) {
+        SrsStatisticStream* stream = streams.at(i);
+        srs_freep(stream);
     }
-    if (true) {
-        std::map<std::string, SrsStatisticClient*>::iterator it;
-        for (it = clients.begin(); it != clients.end(); it++) {
-            SrsStatisticClient* client = it->second;
-            srs_freep(client);
-        }
+    for (int i = 0; i < clients.slots(); i++) {
+        SrsStatisticClient* client = clients.at(i);
+        srs_freep(client);
     }
     
     vhosts.clear();
     rvhosts.clear();
     streams.clear();
-    rstreams.clear();
+    clients.clear();
 }
 
 SrsStatistic* SrsStatistic::instance()
@@ -322,29 +523,17 @@ SrsStatisticVhost* SrsStatistic::find_vhost_by_name(string name)
 
 SrsStatisticStream* SrsStatistic::find_stream(string sid)
 {
-    std::map<std::string, SrsStatisticStream*>::iterator it;
-    if ((it = streams.find(sid)) != streams.end()) {
-        return it->second;
-    }
-    return NULL;
+    return istreams.find(sid);
 }
 
 SrsStatisticStream* SrsStatistic::find_stream_by_url(string url)
 {
-    std::map<std::string, SrsStatisticStream*>::iterator it;
-    if ((it = rstreams.find(url)) != rstreams.end()) {
-        return it->second;
-    }
-    return NULL;
+    return rstreams.find(url);
 }
 
 SrsStatisticClient* SrsStatistic::find_client(string client_id)
 {
-    std::map<std::string, SrsStatisticClient*>::iterator it;
-    if ((it = clients.find(client_id)) != clients.end()) {
-        return it->second;
-    }
-    return NULL;
+    return iclients.find(client_id);
 }
 
 srs_error_t SrsStatistic::on_video_info(SrsRequest* req, SrsVideoCodecId vcodec, int profile, int level, int width, int height)
@@ -400,10 +589,34 @@ srs_error_t SrsStatistic::on_video_frames(SrsRequest* req, int nb_frames)
     SrsStatisticStream* stream = create_stream(vhost, req);
     
     stream->frames->sugar += nb_frames;
+    stream->frames->update();
     
     return err;
 }
 
+void SrsStatistic::on_audio_transcode(SrsRequest* req, int nb_frames, srs_utime_t latency, srs_utime_t cpu)
+{
+    SrsStatisticVhost* vhost = create_vhost(req);
+    SrsStatisticStream* stream = create_stream(vhost, req);
+
+    stream->nn_transcode_frames += nb_frames;
+    stream->transcode_latency += latency;
+    stream->transcode_cpu += cpu;
+}
+
+void SrsStatistic::on_rtc_bwe(std::string id, int kbps, double loss, int delay)
+{
+    SrsStatisticClient* client = find_client(id);
+    if (!client) {
+        return;
+    }
+
+    client->has_bwe = true;
+    client->bwe_kbps = kbps;
+    client->bwe_loss = loss;
+    client->pacer_delay = delay;
+}
+
 void SrsStatistic::on_stream_publish(SrsRequest* req, std::string publisher_id)
 {
     SrsStatisticVhost* vhost = create_vhost(req);
@@ -419,6 +632,33 @@ void SrsStatistic::on_stream_close(SrsRequest* req)
     stream->close();
 }
 
+SrsLatencyHistogram* SrsStatistic::latency(SrsRequest* req, SrsLatencyStage stage)
+{
+    if (!_srs_config->get_stats_latency()) {
+        return NULL;
+    }
+
+    SrsStatisticVhost* vhost = create_vhost(req);
+    if (!vhost->latency[stage]) {
+        vhost->latency[stage] = new SrsLatencyHistogram();
+    }
+
+    return vhost->latency[stage];
+}
+
+void SrsStatistic::on_stream_queue(SrsRequest* req, int gop_cache_msgs, int64_t dropped, srs_utime_t queue_duration)
+{
+    // Never create the stream, which maybe already cleanup.
+    SrsStatisticStream* stream = find_stream_by_url(req->get_stream_url());
+    if (!stream) {
+        return;
+    }
+
+    stream->nn_dropped_msgs += dropped;
+    stream->gop_cache_msgs = gop_cache_msgs;
+    stream->queue_duration = queue_duration;
+}
+
 srs_error_t SrsStatistic::on_client(std::string id, SrsRequest* req, ISrsExpire* conn, SrsRtmpConnType type)
 {
     srs_error_t err = srs_success;
@@ -427,14 +667,13 @@ srs_error_t SrsStatistic::on_client(std::string id, SrsRequest* req, ISrsExpire*
     SrsStatisticStream* stream = create_stream(vhost, req);
     
     // create client if not exists
-    SrsStatisticClient* client = NULL;
-    if (clients.find(id) == clients.end()) {
+    SrsStatisticClient* client = iclients.find(id);
+    if (!client) {
         client = new SrsStatisticClient();
         client->id = id;
         client->stream = stream;
-        clients[id] = client;
-    } else {
-        client = clients[id];
+        clients.push_back(client);
+        iclients.set(client);
     }
     
     // got client.
@@ -455,15 +694,14 @@ srs_error_t SrsStatistic::on_client(std::string id, SrsRequest* req, ISrsExpire*
 
 void SrsStatistic::on_disconnect(std::string id, srs_error_t err)
 {
-    std::map<std::string, SrsStatisticClient*>::iterator it = clients.find(id);
-    if (it == clients.end()) return;
+    SrsStatisticClient* client = iclients.find(id);
+    if (!client) return;
 
-    SrsStatisticClient* client = it->second;
     SrsStatisticStream* stream = client->stream;
     SrsStatisticVhost* vhost = stream->vhost;
     
+    remove_client(client);
     srs_freep(client);
-    clients.erase(it);
     
     stream->nb_clients--;
     vhost->nb_clients--;
@@ -482,39 +720,35 @@ void SrsStatistic::cleanup_stream(SrsStatisticStream* stream)
         return;
     }
 
-    // There should not be any clients referring to the stream.
-    for (std::map<std::string, SrsStatisticClient*>::iterator it = clients.begin(); it != clients.end(); ++it) {
-        SrsStatisticClient* client = it->second;
-        srs_assert(client->stream != stream);
-    }
-
-    // Do cleanup streams.
-    if (true) {
-        std::map<std::string, SrsStatisticStream *>::iterator it;
-        if ((it = streams.find(stream->id)) != streams.end()) {
-            streams.erase(it);
-        }
-    }
-
-    if (true) {
-        std::map<std::string, SrsStatisticStream *>::iterator it;
-        if ((it = rstreams.find(stream->url)) != rstreams.end()) {
-            rstreams.erase(it);
-        }
-    }
+    // Do cleanup streams. Note that there should not be any clients referring to the stream, because the
+    // nb_clients is the number of clients of stream.
+    remove_stream(stream);
 
     // It's safe to delete the stream now.
     srs_freep(stream);
 }
 
+void SrsStatistic::remove_stream(SrsStatisticStream* stream)
+{
+    istreams.erase(stream);
+    rstreams.erase(stream);
+
+    streams.erase(stream);
+}
+
+void SrsStatistic::remove_client(SrsStatisticClient* client)
+{
+    iclients.erase(client);
+
+    clients.erase(client);
+}
+
 void SrsStatistic::kbps_add_delta(std::string id, ISrsKbpsDelta* delta)
 {
     if (!delta) return;
 
-    map<string, SrsStatisticClient*>::iterator it = clients.find(id);
-    if (it == clients.end()) return;
-
-    SrsStatisticClient* client = it->second;
+    SrsStatisticClient* client = iclients.find(id);
+    if (!client) return;
     
     // resample the kbps to collect the delta.
     int64_t in, out;
@@ -526,6 +760,9 @@ void SrsStatistic::kbps_add_delta(std::string id, ISrsKbpsDelta* delta)
     client->kbps->add_delta(in, out);
     client->stream->kbps->add_delta(in, out);
     client->stream->vhost->kbps->add_delta(in, out);
+
+    // Sample the kbps of client, which only updates when the window elapsed.
+    client->kbps->sample();
 }
 
 void SrsStatistic::kbps_sample()
@@ -538,19 +775,25 @@ void SrsStatistic::kbps_sample()
             vhost->kbps->sample();
         }
     }
-    if (true) {
-        std::map<std::string, SrsStatisticStream*>::iterator it;
-        for (it = streams.begin(); it != streams.end(); it++) {
-            SrsStatisticStream* stream = it->second;
-            stream->kbps->sample();
-            stream->frames->update();
+    // Sample the kbps and fps of streams periodically, which are much fewer than clients.
+    for (int i = 0; i < streams.slots(); i++) {
+        SrsStatisticStream* stream = streams.at(i);
+        if (stream) {
+            stream->sample();
         }
     }
-    if (true) {
-        std::map<std::string, SrsStatisticClient*>::iterator it;
-        for (it = clients.begin(); it != clients.end(); it++) {
-            SrsStatisticClient* client = it->second;
-            client->kbps->sample();
+    // Rotate the window of latency, so the percentiles are of recent samples.
+    if (srs_get_system_time() - latency_rotate_at_ >= SRS_LATENCY_WINDOW) {
+        latency_rotate_at_ = srs_get_system_time();
+
+        std::map<std::string, SrsStatisticVhost*>::iterator it;
+        for (it = vhosts.begin(); it != vhosts.end(); it++) {
+            SrsStatisticVhost* vhost = it->second;
+            for (int i = 0; i < SrsLatencyStageMax; i++) {
+                if (vhost->latency[i]) {
+                    vhost->latency[i]->rotate();
+                }
+            }
         }
     }
 
@@ -566,7 +809,7 @@ std::string SrsStatistic::server_id()
     return server_id_;
 }
 
-srs_error_t SrsStatistic::dumps_vhosts(SrsJsonArray* arr)
+srs_error_t SrsStatistic::dumps_vhosts(SrsJsonWriter* w)
 {
     srs_error_t err = srs_success;
     
@@ -574,10 +817,7 @@ srs_error_t SrsStatistic::dumps_vhosts(SrsJsonArray* arr)
     for (it = vhosts.begin(); it != vhosts.end(); it++) {
         SrsStatisticVhost* vhost = it->second;
         
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = vhost->dumps(obj)) != srs_success) {
+        if ((err = vhost->dumps(w)) != srs_success) {
             return srs_error_wrap(err, "dump vhost");
         }
     }
@@ -585,22 +825,19 @@ srs_error_t SrsStatistic::dumps_vhosts(SrsJsonArray* arr)
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_streams(SrsJsonArray* arr, int start, int count)
+srs_error_t SrsStatistic::dumps_streams(SrsJsonWriter* w, int start, int count)
 {
     srs_error_t err = srs_success;
 
-    std::map<std::string, SrsStatisticStream*>::iterator it = streams.begin();
-    for (int i = 0; i < start + count && it != streams.end(); it++, i++) {
-        if (i < start) {
+    for (int i = streams.seek(start); i < streams.slots() && count > 0; i++) {
+        SrsStatisticStream* stream = streams.at(i);
+        if (!stream) {
             continue;
         }
+        count--;
 
-        SrsStatisticStream* stream = it->second;
-        
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = stream->dumps(obj)) != srs_success) {
+
+        if ((err = stream->dumps(w)) != srs_success) {
             return srs_error_wrap(err, "dump stream");
         }
     }
@@ -608,22 +845,19 @@ srs_error_t SrsStatistic::dumps_streams(SrsJsonArray* arr, int start, int count)
     return err;
 }
 
-srs_error_t SrsStatistic::dumps_clients(SrsJsonArray* arr, int start, int count)
+srs_error_t SrsStatistic::dumps_clients(SrsJsonWriter* w, int start, int count)
 {
     srs_error_t err = srs_success;
     
-    std::map<std::string, SrsStatisticClient*>::iterator it = clients.begin();
-    for (int i = 0; i < start + count && it != clients.end(); it++, i++) {
-        if (i < start) {
+    for (int i = clients.seek(start); i < clients.slots() && count > 0; i++) {
+        SrsStatisticClient* client = clients.at(i);
+        if (!client) {
             continue;
         }
-        
-        SrsStatisticClient* client = it->second;
-        
-        SrsJsonObject* obj = SrsJsonAny::object();
-        arr->append(obj);
-        
-        if ((err = client->dumps(obj)) != srs_success) {
+        count--;
+
+
+        if ((err = client->dumps(w)) != srs_success) {
             return srs_error_wrap(err, "dump client");
         }
     }
@@ -648,8 +882,11 @@ void SrsStatistic::dumps_hints_kv(std::stringstream & ss)
 
 #ifdef SRS_H265
     // For HEVC, we should check active stream which is HEVC codec.
-    for (std::map<std::string, SrsStatisticStream*>::iterator it = streams.begin(); it != streams.end(); it++) {
-        SrsStatisticStream* stream = it->second;
+    for (int i = 0; i < streams.slots(); i++) {
+        SrsStatisticStream* stream = streams.at(i);
+        if (!stream) {
+            continue;
+        }
         if (stream->vcodec == SrsVideoCodecIdHEVC) {
             ss << "&h265=1";
             break;
@@ -674,8 +911,11 @@ void SrsStatistic::dumps_cls_summaries(SrsClsSugar* sugar)
 
 void SrsStatistic::dumps_cls_streams(SrsClsSugars* sugars)
 {
-    for (std::map<std::string, SrsStatisticStream*>::iterator it = streams.begin(); it != streams.end(); ++it) {
-        SrsStatisticStream* stream = it->second;
+    for (int i = 0; i < streams.slots(); i++) {
+        SrsStatisticStream* stream = streams.at(i);
+        if (!stream) {
+            continue;
+        }
         if (!stream->active || !stream->nb_clients) {
             continue;
         }
@@ -749,20 +989,18 @@ SrsStatisticStream* SrsStatistic::create_stream(SrsStatisticVhost* vhost, SrsReq
     SrsStatisticStream* stream = NULL;
     
     // create stream if not exists.
-    if (rstreams.find(url) == rstreams.end()) {
+    if ((stream = rstreams.find(url)) == NULL) {
         stream = new SrsStatisticStream();
         stream->vhost = vhost;
         stream->stream = req->stream;
         stream->app = req->app;
         stream->url = url;
         stream->tcUrl = req->tcUrl;
-        rstreams[url] = stream;
-        streams[stream->id] = stream;
-        return stream;
+        streams.push_back(stream);
+        istreams.set(stream);
+        rstreams.set(stream);
     }
     
-    stream = rstreams[url];
-    
     return stream;
 }
 
@@ -782,3 +1020,173 @@ srs_error_t SrsStatistic::dumps_metrics(int64_t& send_bytes, int64_t& recv_bytes
     return err;
 }
 
+// Escape the label value of Prometheus, the backslash, double-quote and line feed.
+static string srs_metrics_escape(const string& v)
+{
+    if (v.find_first_of("\\\"\n") == string::npos) {
+        return v;
+    }
+
+    string r;
+    for (int i = 0; i < (int)v.length(); i++) {
+        char c = v.at(i);
+        if (c == '\\' || c == '"') {
+            r.append(1, '\\').append(1, c);
+        } else if (c == '\n') {
+            r.append("\\n");
+        } else {
+            r.append(1, c);
+        }
+    }
+    return r;
+}
+
+// Append the HELP and TYPE of metric to buf.
+static void srs_metrics_family(string& buf, const char* name, const char* type, const char* help)
+{
+    buf.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    buf.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+// Append a series of metric to buf, the labels is formated, such as vhost="xxx".
+static void srs_metrics_series(string& buf, const char* name, const string& labels, int64_t value)
+{
+    char tmp[32];
+    int nb = snprintf(tmp, sizeof(tmp), "%" PRId64, value);
+
+    buf.append(name).append("{").append(labels).append("} ").append(tmp, nb).append("\n");
+}
+
+// The stream with larger kbps is in front.
+static bool srs_metrics_stream_greater(SrsStatisticStream* a, SrsStatisticStream* b)
+{
+    return a->kbps->get_send_kbps_30s() + a->kbps->get_recv_kbps_30s() > b->kbps->get_send_kbps_30s() + b->kbps->get_recv_kbps_30s();
+}
+
+void SrsStatistic::dumps_metrics_streams(string& buf, int max_streams)
+{
+    // The vhosts are always dumped, because there are always a few vhosts.
+    if (!vhosts.empty()) {
+        metrics_labels_.clear();
+
+        std::map<std::string, SrsStatisticVhost*>::iterator it;
+        for (it = vhosts.begin(); it != vhosts.end(); it++) {
+            SrsStatisticVhost* vhost = it->second;
+            metrics_labels_.push_back("vhost=\"" + srs_metrics_escape(vhost->vhost) + "\"");
+        }
+
+        srs_metrics_family(buf, "srs_vhost_send_kbps", "gauge", "The send kbps in 30s of vhost.");
+        int i = 0;
+        for (it = vhosts.begin(); it != vhosts.end(); it++, i++) {
+            srs_metrics_series(buf, "srs_vhost_send_kbps", metrics_labels_[i], it->second->kbps->get_send_kbps_30s());
+        }
+
+        srs_metrics_family(buf, "srs_vhost_recv_kbps", "gauge", "The recv kbps in 30s of vhost.");
+        i = 0;
+        for (it = vhosts.begin(); it != vhosts.end(); it++, i++) {
+            srs_metrics_series(buf, "srs_vhost_recv_kbps", metrics_labels_[i], it->second->kbps->get_recv_kbps_30s());
+        }
+
+        srs_metrics_family(buf, "srs_vhost_streams", "gauge", "The number of streams of vhost.");
+        i = 0;
+        for (it = vhosts.begin(); it != vhosts.end(); it++, i++) {
+            srs_metrics_series(buf, "srs_vhost_streams", metrics_labels_[i], it->second->nb_streams);
+        }
+
+        srs_metrics_family(buf, "srs_vhost_clients", "gauge", "The number of clients of vhost.");
+        i = 0;
+        for (it = vhosts.begin(); it != vhosts.end(); it++, i++) {
+            srs_metrics_series(buf, "srs_vhost_clients", metrics_labels_[i], it->second->nb_clients);
+        }
+
+        // The latency of stages, the quantiles are of recent window.
+        bool latency_family = false;
+        i = 0;
+        for (it = vhosts.begin(); it != vhosts.end(); it++, i++) {
+            SrsStatisticVhost* vhost = it->second;
+            for (int j = 0; j < SrsLatencyStageMax; j++) {
+                SrsLatencyHistogram* h = vhost->latency[j];
+                if (!h) {
+                    continue;
+                }
+
+                if (!latency_family) {
+                    latency_family = true;
+                    srs_metrics_family(buf, "srs_latency_us", "summary", "The latency in us of stages in hot path.");
+                }
+
+                string labels = metrics_labels_[i] + ",stage=\"" + srs_latency_stage2str((SrsLatencyStage)j) + "\"";
+                srs_metrics_series(buf, "srs_latency_us", labels + ",quantile=\"0.5\"", h->percentile(0.5));
+                srs_metrics_series(buf, "srs_latency_us", labels + ",quantile=\"0.9\"", h->percentile(0.9));
+                srs_metrics_series(buf, "srs_latency_us", labels + ",quantile=\"0.99\"", h->percentile(0.99));
+                srs_metrics_series(buf, "srs_latency_us_sum", labels, h->sum());
+                srs_metrics_series(buf, "srs_latency_us_count", labels, h->count());
+            }
+        }
+    }
+
+    if (max_streams <= 0 || streams.empty()) {
+        return;
+    }
+
+    // Select the top streams by kbps, to limit the number of series, so the scrape is fast for lots of streams.
+    metrics_streams_.clear();
+    for (int i = 0; i < streams.slots(); i++) {
+        SrsStatisticStream* stream = streams.at(i);
+        if (stream) {
+            metrics_streams_.push_back(stream);
+        }
+    }
+
+    int nn_truncated = 0;
+    if ((int)metrics_streams_.size() > max_streams) {
+        nn_truncated = (int)metrics_streams_.size() - max_streams;
+        std::partial_sort(metrics_streams_.begin(), metrics_streams_.begin() + max_streams, metrics_streams_.end(), srs_metrics_stream_greater);
+        metrics_streams_.resize(max_streams);
+    }
+
+    metrics_labels_.clear();
+    for (int i = 0; i < (int)metrics_streams_.size(); i++) {
+        SrsStatisticStream* stream = metrics_streams_[i];
+        metrics_labels_.push_back("vhost=\"" + srs_metrics_escape(stream->vhost->vhost) + "\",app=\""
+            + srs_metrics_escape(stream->app) + "\",stream=\"" + srs_metrics_escape(stream->stream) + "\"");
+    }
+
+    srs_metrics_family(buf, "srs_stream_send_kbps", "gauge", "The send kbps in 30s of stream.");
+    for (int i = 0; i < (int)metrics_streams_.size(); i++) {
+        srs_metrics_series(buf, "srs_stream_send_kbps", metrics_labels_[i], metrics_streams_[i]->kbps->get_send_kbps_30s());
+    }
+
+    srs_metrics_family(buf, "srs_stream_recv_kbps", "gauge", "The recv kbps in 30s of stream.");
+    for (int i = 0; i < (int)metrics_streams_.size(); i++) {
+        srs_metrics_series(buf, "srs_stream_recv_kbps", metrics_labels_[i], metrics_streams_[i]->kbps->get_recv_kbps_30s());
+    }
+
+    srs_metrics_family(buf, "srs_stream_fps", "gauge", "The video frames per second in 10s of stream.");
+    for (int i = 0; i < (int)metrics_streams_.size(); i++) {
+        srs_metrics_series(buf, "srs_stream_fps", metrics_labels_[i], metrics_streams_[i]->frames->r10s());
+    }
+
+    srs_metrics_family(buf, "srs_stream_clients", "gauge", "The number of clients of stream, including the publisher.");
+    for (int i = 0; i < (int)metrics_streams_.size(); i++) {
+        srs_metrics_series(buf, "srs_stream_clients", metrics_labels_[i], metrics_streams_[i]->nb_clients);
+    }
+
+    srs_metrics_family(buf, "srs_stream_dropped_msgs_total", "counter", "The total messages dropped by the queue of consumers of stream.");
+    for (int i = 0; i < (int)metrics_streams_.size(); i++) {
+        srs_metrics_series(buf, "srs_stream_dropped_msgs_total", metrics_labels_[i], metrics_streams_[i]->nn_dropped_msgs);
+    }
+
+    srs_metrics_family(buf, "srs_stream_gop_cache_msgs", "gauge", "The number of messages in GOP cache of stream.");
+    for (int i = 0; i < (int)metrics_streams_.size(); i++) {
+        srs_metrics_series(buf, "srs_stream_gop_cache_msgs", metrics_labels_[i], metrics_streams_[i]->gop_cache_msgs);
+    }
+
+    srs_metrics_family(buf, "srs_stream_queue_ms", "gauge", "The max duration in ms of the queue of consumers of stream.");
+    for (int i = 0; i < (int)metrics_streams_.size(); i++) {
+        srs_metrics_series(buf, "srs_stream_queue_ms", metrics_labels_[i], srsu2ms(metrics_streams_[i]->queue_duration));
+    }
+
+    srs_metrics_family(buf, "srs_stream_metrics_truncated", "gauge", "The number of streams not exported, because of the limit of max_streams.");
+    buf.append("srs_stream_metrics_truncated ").append(srs_int2str(nn_truncated)).append("\n");
+}
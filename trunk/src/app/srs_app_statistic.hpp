@@ -21,13 +21,85 @@ class SrsKbps;
 class SrsWallClock;
 class SrsRequest;
 class ISrsExpire;
-class SrsJsonObject;
-class SrsJsonArray;
+class SrsJsonWriter;
 class ISrsKbpsDelta;
 class SrsClsSugar;
 class SrsClsSugars;
 class SrsPps;
 
+// The stages of latency in hot path, from publisher to players.
+enum SrsLatencyStage
+{
+    // RTMP publisher, to handle a message, from received to fan-out done, including demux and hub.
+    SrsLatencyStageRtmpPublish = 0,
+    // RTMP source, to copy a message to all consumers.
+    SrsLatencyStageRtmpFanout,
+    // RTMP consumer, the messages wait in queue before dumped by player.
+    SrsLatencyStageRtmpQueue,
+    // RTMP player, to send messages to socket.
+    SrsLatencyStageRtmpSend,
+    // RTC publisher, to handle a RTP packet, from decrypted to fan-out done, including NACK and bridge.
+    SrsLatencyStageRtcPublish,
+    // RTC source, to copy a RTP packet to all consumers.
+    SrsLatencyStageRtcFanout,
+    // RTC consumer, the packets wait in queue before dumped by player.
+    SrsLatencyStageRtcQueue,
+    // RTC player, to encrypt and send a RTP packet.
+    SrsLatencyStageRtcSend,
+    // The max stage, not a stage.
+    SrsLatencyStageMax,
+};
+extern const char* srs_latency_stage2str(SrsLatencyStage stage);
+
+// The sub-buckets of each power of 2, in bits, so the precision is 1/8.
+#define SRS_LATENCY_SUB_BITS 3
+// The max latency is 2^27us, about 134s, the larger latency is in the last bucket.
+#define SRS_LATENCY_MAX_BITS 27
+#define SRS_LATENCY_BUCKETS ((SRS_LATENCY_MAX_BITS - SRS_LATENCY_SUB_BITS + 1) << SRS_LATENCY_SUB_BITS)
+// The RTC stages sample one of every N packets, because reading the clock twice for each packet of each
+// player costs too much, see SrsLatencyHistogram::sample.
+#define SRS_LATENCY_SAMPLE_RATE 16
+
+// The histogram of latency in us, like HDR histogram, the buckets are linear in each power of 2, so the
+// update is only a few bit operations, without any allocation or comparison.
+// The count and sum are total since start, while the percentiles are of the recent window, which starts
+// at the previous rotate, so we're able to find the regression under load.
+class SrsLatencyHistogram
+{
+private:
+    // The total samples in each bucket, since start.
+    int64_t buckets_[SRS_LATENCY_BUCKETS];
+    // The buckets when the previous window starts.
+    int64_t window_[SRS_LATENCY_BUCKETS];
+    // The buckets when the current window starts.
+    int64_t next_[SRS_LATENCY_BUCKETS];
+    int64_t count_;
+    srs_utime_t sum_;
+    // The number of calls to sample.
+    uint32_t nn_sample_;
+public:
+    SrsLatencyHistogram();
+    virtual ~SrsLatencyHistogram();
+public:
+    // Whether to sample the current packet, true for one of every SRS_LATENCY_SAMPLE_RATE calls.
+    bool sample();
+    // Add a sample of latency in us.
+    void update(srs_utime_t v);
+    // Start a new window, and drop the samples of previous window.
+    void rotate();
+    // The total count and sum of samples, since start.
+    int64_t count();
+    srs_utime_t sum();
+    // Get the percentile of recent window, for example, 0.99 for P99, 1.0 for max.
+    // @return The highest value of bucket, 0 if no samples.
+    srs_utime_t percentile(double q);
+    // Dumps the fields of histogram to the current object of writer.
+    void dumps(SrsJsonWriter* w);
+public:
+    static int bucket_of(srs_utime_t v);
+    static srs_utime_t highest_of(int bucket);
+};
+
 struct SrsStatisticVhost
 {
 public:
@@ -38,11 +110,13 @@ public:
 public:
     // The vhost total kbps.
     SrsKbps* kbps;
+    // The latency of stages, NULL if not enabled.
+    SrsLatencyHistogram* latency[SrsLatencyStageMax];
 public:
     SrsStatisticVhost();
     virtual ~SrsStatisticVhost();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    virtual srs_error_t dumps(SrsJsonWriter* w);
 };
 
 struct SrsStatisticStream
@@ -89,11 +163,32 @@ public:
     // 1.5.1.1 Audio object type definition, page 23,
     //           in ISO_IEC_14496-3-AAC-2001.pdf.
     SrsAacObjectType aac_object;
+public:
+    // The number of audio frames transcoded by bridge.
+    int64_t nn_transcode_frames;
+    // The total latency and CPU time of audio transcoding.
+    srs_utime_t transcode_latency;
+    srs_utime_t transcode_cpu;
+public:
+    // The total messages dropped by the queue of consumers, because of overflow.
+    int64_t nn_dropped_msgs;
+    // The number of messages in GOP cache.
+    int gop_cache_msgs;
+    // The max duration of the queue of consumers.
+    srs_utime_t queue_duration;
+public:
+    // The position in streams of SrsStatistic.
+    int index_;
+    // The link of hash table, by id and by url.
+    SrsStatisticStream* next_id_;
+    SrsStatisticStream* next_url_;
 public:
     SrsStatisticStream();
     virtual ~SrsStatisticStream();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    // Sample the kbps and fps, periodically by the timer of statistic.
+    virtual void sample();
+    virtual srs_error_t dumps(SrsJsonWriter* w);
 public:
     // Publish the stream, id is the publisher.
     virtual void publish(std::string id);
@@ -115,11 +210,169 @@ public:
 public:
     // The stream total kbps.
     SrsKbps* kbps;
+public:
+    // The sender-side bandwidth estimation of RTC player.
+    bool has_bwe;
+    int bwe_kbps;
+    double bwe_loss;
+    // The smoothed delay in ms of packets queued by pacer.
+    int pacer_delay;
+public:
+    // The position in clients of SrsStatistic.
+    int index_;
+    // The link of hash table, by id.
+    SrsStatisticClient* next_id_;
 public:
     SrsStatisticClient();
     virtual ~SrsStatisticClient();
 public:
-    virtual srs_error_t dumps(SrsJsonObject* obj);
+    virtual srs_error_t dumps(SrsJsonWriter* w);
+};
+
+// The FNV-1a hash of string, for the key of statistic table.
+extern uint32_t srs_statistic_hash(const std::string& key);
+
+// The hash table to find the statistic object by string key, chained by the link in object, so there is
+// no allocation for each object. The buckets are doubled to keep the load factor under 1, so the lookup
+// is O(1) for lots of clients, for example, to add the delta of kbps for each connection.
+// @remark The table never owns the object, and the key of object should never change in table.
+template<typename T, std::string T::*Key, T* T::*Next>
+class SrsStatisticTable
+{
+private:
+    std::vector<T*> buckets_;
+    uint32_t size_;
+public:
+    SrsStatisticTable() {
+        buckets_.resize(64);
+        size_ = 0;
+    }
+public:
+    // Add the object, which should not be in table.
+    void set(T* v) {
+        if (size_ + 1 > buckets_.size()) {
+            rehash((uint32_t)buckets_.size() * 2);
+        }
+
+        T*& head = buckets_[srs_statistic_hash(v->*Key) & (buckets_.size() - 1)];
+        v->*Next = head;
+        head = v;
+        size_++;
+    }
+    T* find(const std::string& key) {
+        T* p = buckets_[srs_statistic_hash(key) & (buckets_.size() - 1)];
+        for (; p; p = p->*Next) {
+            if (p->*Key == key) {
+                return p;
+            }
+        }
+        return NULL;
+    }
+    void erase(T* v) {
+        T** pp = &buckets_[srs_statistic_hash(v->*Key) & (buckets_.size() - 1)];
+        for (; *pp; pp = &((*pp)->*Next)) {
+            if (*pp == v) {
+                *pp = v->*Next;
+                v->*Next = NULL;
+                size_--;
+                return;
+            }
+        }
+    }
+    uint32_t size() {
+        return size_;
+    }
+private:
+    void rehash(uint32_t nn_buckets) {
+        std::vector<T*> buckets(nn_buckets);
+        for (int i = 0; i < (int)buckets_.size(); i++) {
+            T* p = buckets_[i];
+            while (p) {
+                T* next = p->*Next;
+                T*& head = buckets[srs_statistic_hash(p->*Key) & (nn_buckets - 1)];
+                p->*Next = head;
+                head = p;
+                p = next;
+            }
+        }
+        buckets_.swap(buckets);
+    }
+};
+
+// The statistic objects in order of creation, the index_ of object is the slot, so it's O(1) to remove the
+// object by leaving a hole, and the holes are compacted when more than the objects, so the order of pages
+// is stable when objects are removed, for the API to dump the objects by page.
+// @remark The array never owns the object, and the slot might be NULL for hole.
+template<typename T>
+class SrsStatisticArray
+{
+private:
+    std::vector<T*> slots_;
+    int size_;
+public:
+    SrsStatisticArray() {
+        size_ = 0;
+    }
+public:
+    void push_back(T* v) {
+        v->index_ = (int)slots_.size();
+        slots_.push_back(v);
+        size_++;
+    }
+    void erase(T* v) {
+        slots_[v->index_] = NULL;
+        v->index_ = -1;
+        size_--;
+
+        if (size_ * 2 < (int)slots_.size()) {
+            compact();
+        }
+    }
+    void clear() {
+        slots_.clear();
+        size_ = 0;
+    }
+    // The number of objects, without holes.
+    int size() {
+        return size_;
+    }
+    bool empty() {
+        return size_ == 0;
+    }
+    // The number of slots, including holes.
+    int slots() {
+        return (int)slots_.size();
+    }
+    // Get the object at slot, NULL for hole.
+    T* at(int slot) {
+        return slots_[slot];
+    }
+    // Get the slot of the n-th object, from 0, or slots() if not exists.
+    int seek(int n) {
+        if (size_ == (int)slots_.size()) {
+            return (n < size_) ? n : size_;
+        }
+
+        int slot = 0;
+        for (; slot < (int)slots_.size(); slot++) {
+            if (slots_[slot] && n-- == 0) {
+                break;
+            }
+        }
+        return slot;
+    }
+private:
+    void compact() {
+        int size = 0;
+        for (int i = 0; i < (int)slots_.size(); i++) {
+            T* p = slots_[i];
+            if (p) {
+                p->index_ = size;
+                slots_[size++] = p;
+            }
+        }
+        slots_.resize(size);
+    }
 };
 
 class SrsStatistic
@@ -135,14 +388,17 @@ private:
     // @remark a fast index for vhosts.
     std::map<std::string, SrsStatisticVhost*> rvhosts;
 private:
-    // The key: stream id, value: stream Object.
-    std::map<std::string, SrsStatisticStream*> streams;
-    // The key: stream url, value: stream Object.
-    // @remark a fast index for streams.
-    std::map<std::string, SrsStatisticStream*> rstreams;
+    // The streams in order of creation, it's O(1) to remove stream, and the order of pages is stable.
+    SrsStatisticArray<SrsStatisticStream> streams;
+    // The index of streams by id.
+    SrsStatisticTable<SrsStatisticStream, &SrsStatisticStream::id, &SrsStatisticStream::next_id_> istreams;
+    // The index of streams by url.
+    SrsStatisticTable<SrsStatisticStream, &SrsStatisticStream::url, &SrsStatisticStream::next_url_> rstreams;
 private:
-    // The key: client id, value: stream object.
-    std::map<std::string, SrsStatisticClient*> clients;
+    // The clients in order of creation, like streams.
+    SrsStatisticArray<SrsStatisticClient> clients;
+    // The index of clients by id.
+    SrsStatisticTable<SrsStatisticClient, &SrsStatisticClient::id, &SrsStatisticClient::next_id_> iclients;
     // The server total kbps.
     SrsKbps* kbps;
 private:
@@ -150,6 +406,13 @@ private:
     int64_t nb_clients_;
     // The total of clients errors.
     int64_t nb_errs_;
+    // The time to rotate the window of latency.
+    srs_utime_t latency_rotate_at_;
+private:
+    // The streams selected to export metrics, reused for each scrape.
+    std::vector<SrsStatisticStream*> metrics_streams_;
+    // The labels of streams to export metrics, reused for each scrape.
+    std::vector<std::string> metrics_labels_;
 private:
     SrsStatistic();
     virtual ~SrsStatistic();
@@ -170,12 +433,25 @@ public:
     // When got videos, update the frames.
     // We only stat the total number of video frames.
     virtual srs_error_t on_video_frames(SrsRequest* req, int nb_frames);
+    // When audio frames transcoded by bridge, with the total latency and CPU time.
+    virtual void on_audio_transcode(SrsRequest* req, int nb_frames, srs_utime_t latency, srs_utime_t cpu);
+    // When bandwidth estimation of RTC player updated, the kbps is the estimated bandwidth, and the
+    // delay is the queue delay in ms of pacer.
+    virtual void on_rtc_bwe(std::string id, int kbps, double loss, int delay);
     // When publish stream.
     // @param req the request object of publish connection.
     // @param publisher_id The id of publish connection.
     virtual void on_stream_publish(SrsRequest* req, std::string publisher_id);
     // When close stream.
     virtual void on_stream_close(SrsRequest* req);
+    // Get the latency histogram of stage for vhost, which is never freed, so the hot path could cache it.
+    // @return NULL if latency is disabled.
+    virtual SrsLatencyHistogram* latency(SrsRequest* req, SrsLatencyStage stage);
+    // When sampled the queue of stream, ignore if stream not exists.
+    // @param gop_cache_msgs The number of messages in GOP cache.
+    // @param dropped The messages dropped by consumers since last sample.
+    // @param queue_duration The max duration of the queue of consumers.
+    virtual void on_stream_queue(SrsRequest* req, int gop_cache_msgs, int64_t dropped, srs_utime_t queue_duration);
 public:
     // When got a client to publish/play stream,
     // @param id, the client srs id.
@@ -192,25 +468,25 @@ private:
     // Cleanup the stream if stream is not active and for the last client.
     void cleanup_stream(SrsStatisticStream* stream);
 public:
-    // Sample the kbps, add delta bytes of conn.
-    // Use kbps_sample() to get all result of kbps stat.
+    // Sample the kbps, add delta bytes of conn, then sample the kbps of client and stream.
     virtual void kbps_add_delta(std::string id, ISrsKbpsDelta* delta);
-    // Calc the result for all kbps.
+    // Calc the result of kbps and fps for server, vhosts and streams. The clients are never sampled here,
+    // which are sampled when adding delta of each connection, so there is no stall for lots of clients.
     virtual void kbps_sample();
 public:
     // Get the server id, used to identify the server.
     // For example, when restart, the server id must changed.
     virtual std::string server_id();
-    // Dumps the vhosts to amf0 array.
-    virtual srs_error_t dumps_vhosts(SrsJsonArray* arr);
-    // Dumps the streams to amf0 array.
+    // Dumps the vhosts as the elements of json array, the caller should begin and end the array.
+    virtual srs_error_t dumps_vhosts(SrsJsonWriter* w);
+    // Dumps the streams as the elements of json array.
     // @param start the start index, from 0.
     // @param count the max count of streams to dump.
-    virtual srs_error_t dumps_streams(SrsJsonArray* arr, int start, int count);
-    // Dumps the clients to amf0 array
+    virtual srs_error_t dumps_streams(SrsJsonWriter* w, int start, int count);
+    // Dumps the clients as the elements of json array.
     // @param start the start index, from 0.
     // @param count the max count of clients to dump.
-    virtual srs_error_t dumps_clients(SrsJsonArray* arr, int start, int count);
+    virtual srs_error_t dumps_clients(SrsJsonWriter* w, int start, int count);
     // Dumps the hints about SRS server.
     void dumps_hints_kv(std::stringstream & ss);
 #ifdef SRS_APM
@@ -222,9 +498,15 @@ public:
 private:
     virtual SrsStatisticVhost* create_vhost(SrsRequest* req);
     virtual SrsStatisticStream* create_stream(SrsStatisticVhost* vhost, SrsRequest* req);
+    // Remove the stream or client from the array and tables.
+    void remove_stream(SrsStatisticStream* stream);
+    void remove_client(SrsStatisticClient* client);
 public:
     // Dumps exporter metrics.
     virtual srs_error_t dumps_metrics(int64_t& send_bytes, int64_t& recv_bytes, int64_t& nstreams, int64_t& nclients, int64_t& total_nclients, int64_t& nerrs);
+    // Dumps exporter metrics of vhosts and streams, in text format of Prometheus, appended to buf.
+    // @param max_streams The max number of streams to dump, the top streams by kbps, to limit the cardinality.
+    virtual void dumps_metrics_streams(std::string& buf, int max_streams);
 };
 
 // Generate a random string id, with constant prefix.
@@ -18,13 +18,20 @@
 #include <srs_app_async_call.hpp>
 #include <srs_app_tencentcloud.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_protocol_http_stack.hpp>
+#include <srs_app_http_static.hpp>
+#include <srs_app_hls.hpp>
 #ifdef SRS_RTC
 #include <srs_app_rtc_dtls.hpp>
 #include <srs_app_rtc_conn.hpp>
+#include <srs_app_rtc_network.hpp>
 #endif
 #ifdef SRS_SRT
 #include <srs_app_srt_source.hpp>
 #endif
+#ifdef SRS_FFMPEG_FIT
+#include <srs_app_rtc_codec.hpp>
+#endif
 #ifdef SRS_GB28181
 #include <srs_app_gb28181.hpp>
 #endif
@@ -317,6 +324,7 @@ srs_error_t srs_global_initialize()
     _srs_pps_cids_set = new SrsPps();
 
     // The global objects which depends on ST.
+    _srs_timer_wheel = new SrsTimerWheel("wheel", 10 * SRS_UTIME_MILLISECONDS);
     _srs_hybrid = new SrsHybridServer();
     _srs_sources = new SrsLiveSourceManager();
     _srs_stages = new SrsStageManager();
@@ -332,6 +340,11 @@ srs_error_t srs_global_initialize()
 
     _srs_rtc_manager = new SrsResourceManager("RTC", true);
     _srs_rtc_dtls_certificate = new SrsDtlsCertificate();
+    // The workers to handshake DTLS in threads, and the statistic.
+    _srs_dtls_worker_pool = new SrsThreadWorkerPool("dtls");
+    _srs_dtls_stat = new SrsDtlsStatistic();
+    // The batch to send RTCP packets of all connections.
+    _srs_rtcp_batch = new SrsUdpBatchSender();
 #endif
 #ifdef SRS_GB28181
     _srs_gb_manager = new SrsResourceManager("GB", true);
@@ -445,6 +458,20 @@ srs_error_t srs_global_initialize()
     // Create global async worker for DVR.
     _srs_dvr_async = new SrsAsyncCallWorker();
 
+    // The cache for hot small files of HTTP server.
+    _srs_http_file_cache = new SrsHttpFileCache();
+
+    // The cache for index of MP4 VOD files.
+    _srs_mp4_index_cache = new SrsMp4IndexCache();
+
+    // The workers to mux HLS streams in threads.
+    _srs_hls_mux_pool = new SrsThreadWorkerPool("hls");
+
+#ifdef SRS_FFMPEG_FIT
+    // The workers to transcode audio of RTC bridges in threads.
+    _srs_audio_transcode_pool = new SrsThreadWorkerPool("audio");
+#endif
+
 #ifdef SRS_APM
     // Initialize global TencentCloud CLS object.
     _srs_cls = new SrsClsClient();
@@ -494,6 +521,258 @@ void SrsThreadMutex::unlock()
     srs_assert(!r0);
 }
 
+SrsThreadTaskContext::SrsThreadTaskContext()
+{
+    lock_ = new SrsThreadMutex();
+    canceled_ = false;
+    refs_.store(1);
+    pending_.store(0);
+    wakeup_fd_ = -1;
+    waiting_.store(false);
+}
+
+SrsThreadTaskContext::~SrsThreadTaskContext()
+{
+    srs_freep(lock_);
+}
+
+int SrsThreadTaskContext::pending()
+{
+    return pending_.load(std::memory_order_acquire);
+}
+
+void SrsThreadTaskContext::set_wakeup(int fd)
+{
+    wakeup_fd_ = fd;
+}
+
+void SrsThreadTaskContext::set_waiting(bool v)
+{
+    waiting_.store(v, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void SrsThreadTaskContext::cancel()
+{
+    if (true) {
+        SrsThreadLocker(lock_);
+        canceled_ = true;
+    }
+
+    release();
+}
+
+void SrsThreadTaskContext::acquire()
+{
+    refs_.fetch_add(1, std::memory_order_relaxed);
+    pending_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SrsThreadTaskContext::release()
+{
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+SrsThreadTask::SrsThreadTask(SrsThreadTaskContext* ctx)
+{
+    ctx_ = ctx;
+    ctx_->acquire();
+}
+
+SrsThreadTask::~SrsThreadTask()
+{
+    ctx_->release();
+}
+
+void SrsThreadTask::run()
+{
+    SrsThreadMutex* lock = ctx_->lock_;
+    SrsThreadLocker(lock);
+
+    if (!ctx_->canceled_) {
+        execute();
+    }
+
+    // Never touch the owner after this, because it might be freed by ST thread. The wakeup fd is still open in
+    // the lock, because owner closes it after canceled.
+    if (ctx_->pending_.fetch_sub(1, std::memory_order_seq_cst) == 1 && !ctx_->canceled_ && ctx_->wakeup_fd_ >= 0
+        && ctx_->waiting_.load(std::memory_order_relaxed)
+    ) {
+        char c = 0;
+        if (::write(ctx_->wakeup_fd_, &c, 1) < 0) {
+            // Ignore, the pipe is full, so the owner is already woken up.
+        }
+    }
+}
+
+SrsThreadWorker::SrsThreadWorker(int id, int capacity)
+{
+    id_ = id;
+    queue_ = new SrsThreadSpscQueue<SrsThreadTask*>(capacity);
+    sleeping_.store(false);
+    nn_tasks_.store(0);
+    nn_full_ = 0;
+
+    int r0 = pthread_mutex_init(&lock_, NULL);
+    srs_assert(!r0);
+
+    r0 = pthread_cond_init(&cond_, NULL);
+    srs_assert(!r0);
+}
+
+SrsThreadWorker::~SrsThreadWorker()
+{
+    // Drop the tasks not executed, to release their contexts.
+    SrsThreadTask* task = NULL;
+    while (queue_->pop(task)) {
+        srs_freep(task);
+    }
+    srs_freep(queue_);
+
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&lock_);
+}
+
+int SrsThreadWorker::id()
+{
+    return id_;
+}
+
+int SrsThreadWorker::depth()
+{
+    return queue_->size();
+}
+
+uint64_t SrsThreadWorker::tasks()
+{
+    return nn_tasks_.load(std::memory_order_relaxed);
+}
+
+uint64_t SrsThreadWorker::full()
+{
+    return nn_full_;
+}
+
+void SrsThreadWorker::push(SrsThreadTask* task)
+{
+    // There is only one ST thread to produce, and the coroutines never switch inside queue push, so it's
+    // safe for all owners of the worker. When queue is full, the coroutine sleeps to wait for worker, as
+    // back-pressure to the producer, and other coroutines may push tasks before it.
+    while (!queue_->push(task)) {
+        nn_full_++;
+        wakeup();
+        srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+    }
+
+    wakeup();
+}
+
+bool SrsThreadWorker::consume()
+{
+    SrsThreadTask* task = NULL;
+    if (!queue_->pop(task)) {
+        return false;
+    }
+
+    task->run();
+    nn_tasks_.fetch_add(1, std::memory_order_relaxed);
+    srs_freep(task);
+
+    return true;
+}
+
+void SrsThreadWorker::wakeup()
+{
+    // Pair with the fence in cycle, so either the worker sees the task, or we see it's sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!sleeping_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    pthread_mutex_lock(&lock_);
+    pthread_cond_signal(&cond_);
+    pthread_mutex_unlock(&lock_);
+}
+
+srs_error_t SrsThreadWorker::start(void* arg)
+{
+    SrsThreadWorker* worker = (SrsThreadWorker*)arg;
+    return worker->cycle();
+}
+
+srs_error_t SrsThreadWorker::cycle()
+{
+    // The worker never quit, because thread pool quits when any thread is done.
+    while (true) {
+        while (consume()) {
+        }
+
+        // Mark sleeping before checking the queue again, so the producer never misses to wake us up,
+        // because it signals with the lock, which is released only when we are waiting.
+        pthread_mutex_lock(&lock_);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (queue_->size() == 0) {
+            pthread_cond_wait(&cond_, &lock_);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+        pthread_mutex_unlock(&lock_);
+    }
+
+    return srs_success;
+}
+
+SrsThreadWorkerPool::SrsThreadWorkerPool(string label)
+{
+    label_ = label;
+    started_ = false;
+    next_ = 0;
+}
+
+SrsThreadWorkerPool::~SrsThreadWorkerPool()
+{
+    // The workers are running in threads, never free them.
+}
+
+SrsThreadWorker* SrsThreadWorkerPool::pick(int nn_workers, int capacity)
+{
+    srs_error_t err = srs_success;
+
+    if (!started_) {
+        if (nn_workers <= 0) {
+            return NULL;
+        }
+
+        started_ = true;
+
+        for (int i = 0; i < nn_workers; i++) {
+            SrsThreadWorker* worker = new SrsThreadWorker(i, capacity);
+            if ((err = _srs_thread_pool->execute(label_, SrsThreadWorker::start, worker)) != srs_success) {
+                srs_warn("%s: start worker #%d failed, %s", label_.c_str(), i, srs_error_desc(err).c_str());
+                srs_freep(err);
+                srs_freep(worker);
+                break;
+            }
+            workers_.push_back(worker);
+        }
+
+        srs_trace("%s: start %d workers, queue=%d", label_.c_str(), (int)workers_.size(), capacity);
+    }
+
+    if (workers_.empty()) {
+        return NULL;
+    }
+
+    return workers_.at(next_++ % workers_.size());
+}
+
+vector<SrsThreadWorker*> SrsThreadWorkerPool::workers()
+{
+    return workers_;
+}
+
 SrsThreadEntry::SrsThreadEntry()
 {
     pool = NULL;
@@ -503,11 +782,13 @@ SrsThreadEntry::SrsThreadEntry()
     tid = 0;
 
     err = srs_success;
+    sched = NULL;
 }
 
 SrsThreadEntry::~SrsThreadEntry()
 {
     srs_freep(err);
+    srs_freep(sched);
 
     // TODO: FIXME: Should dispose trd.
 }
@@ -577,6 +858,12 @@ srs_error_t SrsThreadPool::initialize()
 
     srs_trace("Thread #%d(%s): init name=%s, interval=%dms", entry->num, entry->label.c_str(), entry->name.c_str(), srsu2msi(interval_));
 
+    // Stat the scheduler of ST, to find the coroutines which block the event loop.
+    if (_srs_config->get_threads_sched_stat()) {
+        entry->sched = new SrsSchedulerStat();
+        entry->sched->install();
+    }
+
     return err;
 }
 
@@ -753,6 +1040,12 @@ SrsThreadEntry* SrsThreadPool::self()
     return NULL;
 }
 
+vector<SrsThreadEntry*> SrsThreadPool::threads()
+{
+    SrsThreadLocker(lock_);
+    return threads_;
+}
+
 SrsThreadEntry* SrsThreadPool::hybrid()
 {
     return hybrid_;
@@ -778,6 +1071,11 @@ void* SrsThreadPool::start(void* arg)
     // Set the thread local fields.
     entry->tid = gettid();
 
+    if (_srs_config->get_threads_sched_stat()) {
+        entry->sched = new SrsSchedulerStat();
+        entry->sched->install();
+    }
+
 #ifndef SRS_OSX
     // https://man7.org/linux/man-pages/man3/pthread_setname_np.3.html
     pthread_setname_np(pthread_self(), entry->name.c_str());
@@ -13,8 +13,12 @@
 
 #include <pthread.h>
 
+#include <atomic>
+#include <vector>
+
 class SrsThreadPool;
 class SrsProcSelfStat;
+class SrsSchedulerStat;
 
 // Protect server in high load.
 class SrsCircuitBreaker : public ISrsFastTimer
@@ -87,6 +91,175 @@ public:
     }
 };
 
+// The lock-free ring queue for single producer and single consumer, for example,
+// the ST thread to produce and a worker thread to consume.
+// @remark The capacity is rounded up to power of 2.
+template<typename T>
+class SrsThreadSpscQueue
+{
+private:
+    std::vector<T> ring_;
+    uint64_t mask_;
+    // The position to pop, only updated by consumer.
+    std::atomic<uint64_t> head_;
+    // The position to push, only updated by producer.
+    std::atomic<uint64_t> tail_;
+public:
+    SrsThreadSpscQueue(int capacity) {
+        uint64_t size = 1;
+        while ((int64_t)size < capacity) {
+            size <<= 1;
+        }
+        ring_.resize(size);
+        mask_ = size - 1;
+        head_.store(0);
+        tail_.store(0);
+    }
+    virtual ~SrsThreadSpscQueue() {
+    }
+public:
+    // Push an element by producer, return false if queue is full.
+    bool push(const T& v) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return false;
+        }
+        ring_[tail & mask_] = v;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    // Pop an element by consumer, return false if queue is empty.
+    bool pop(T& v) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        v = ring_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    // The number of elements in queue, safe to call in any thread.
+    int size() {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        return (int)(tail_.load(std::memory_order_acquire) - head);
+    }
+    int capacity() {
+        return (int)ring_.size();
+    }
+};
+
+// The context of tasks of an owner, shared by the owner in ST thread and its tasks in worker thread, to
+// count the pending tasks, and to drop them when the owner is freed.
+class SrsThreadTaskContext
+{
+private:
+    // Held by worker when executing a task, and by owner when canceling.
+    SrsThreadMutex* lock_;
+    bool canceled_;
+    // The references of owner and tasks, the last one frees the context.
+    std::atomic<int> refs_;
+    // The number of tasks not executed or dropped yet.
+    std::atomic<int> pending_;
+    // The fd to wake up the owner waiting for pending tasks, owned by owner, -1 if not set.
+    int wakeup_fd_;
+    std::atomic<bool> waiting_;
+public:
+    SrsThreadTaskContext();
+private:
+    // Never free it directly, use cancel() for owner.
+    virtual ~SrsThreadTaskContext();
+public:
+    // The number of tasks not executed or dropped yet, updated by worker thread.
+    int pending();
+    // Set the fd, such as a pipe, to wake up the owner when all pending tasks are done. The worker writes a byte to
+    // it when owner is waiting, and never after canceled, so owner should close it after cancel().
+    void set_wakeup(int fd);
+    // Mark whether owner is waiting for pending tasks, by owner in ST thread, before checking the pending.
+    void set_waiting(bool v);
+    // Drop the pending tasks and release the context, by owner in ST thread, so the owner is safe to be
+    // freed. It never yields, but blocks if a task of owner is executing by worker thread.
+    // @remark Owner should never use the context after canceled.
+    void cancel();
+private:
+    friend class SrsThreadTask;
+    void acquire();
+    void release();
+};
+
+// The task to execute in worker thread, which is dropped if the context is canceled.
+class SrsThreadTask
+{
+private:
+    SrsThreadTaskContext* ctx_;
+public:
+    SrsThreadTask(SrsThreadTaskContext* ctx);
+    virtual ~SrsThreadTask();
+public:
+    // Execute the task if not canceled, in worker thread.
+    void run();
+protected:
+    // Execute the task, the owner is alive until it's done.
+    virtual void execute() = 0;
+};
+
+// The worker thread to execute tasks, which consumes the tasks in a lock-free queue produced by ST thread,
+// and sleeps on a condition when the queue is empty, until woken up by the producer.
+class SrsThreadWorker
+{
+private:
+    int id_;
+    SrsThreadSpscQueue<SrsThreadTask*>* queue_;
+    // Whether worker is sleeping on the condition, see cycle.
+    pthread_mutex_t lock_;
+    pthread_cond_t cond_;
+    std::atomic<bool> sleeping_;
+    // The number of executed tasks, updated by worker thread.
+    std::atomic<uint64_t> nn_tasks_;
+    // The number of times that queue is full, updated by ST thread.
+    uint64_t nn_full_;
+public:
+    SrsThreadWorker(int id, int capacity);
+    virtual ~SrsThreadWorker();
+public:
+    int id();
+    // The number of tasks in queue.
+    int depth();
+    uint64_t tasks();
+    uint64_t full();
+public:
+    // Push the task to worker and wake it up. If queue is full, it blocks the coroutine and sleeps 1ms each
+    // time until worker consumes a task, so the caller must be a coroutine of ST thread which is safe to yield.
+    void push(SrsThreadTask* task);
+    // Consume a task, return false if no task.
+    bool consume();
+private:
+    void wakeup();
+public:
+    static srs_error_t start(void* arg);
+private:
+    srs_error_t cycle();
+};
+
+// The pool of workers for a kind of tasks, which starts the workers when picked the first time. Each owner
+// is bound to a worker in round-robin, so its tasks are executed in order.
+class SrsThreadWorkerPool
+{
+private:
+    std::string label_;
+    bool started_;
+    int next_;
+    std::vector<SrsThreadWorker*> workers_;
+public:
+    SrsThreadWorkerPool(std::string label);
+    virtual ~SrsThreadWorkerPool();
+public:
+    // Pick a worker for owner, start workers with the queue capacity if not started, and the number of
+    // workers is not changed after started. Return NULL if workers are disabled, and the tasks should be
+    // executed in ST thread.
+    SrsThreadWorker* pick(int nn_workers, int capacity);
+    std::vector<SrsThreadWorker*> workers();
+};
+
 // The information for a thread.
 class SrsThreadEntry
 {
@@ -104,6 +277,8 @@ public:
     pthread_t trd;
     // The exit error of thread.
     srs_error_t err;
+    // The scheduler stat of ST, NULL if disabled.
+    SrsSchedulerStat* sched;
 public:
     SrsThreadEntry();
     virtual ~SrsThreadEntry();
@@ -149,6 +324,7 @@ public:
     void stop();
 public:
     SrsThreadEntry* self();
+    std::vector<SrsThreadEntry*> threads();
     SrsThreadEntry* hybrid();
     std::vector<SrsThreadEntry*> hybrids();
 private:
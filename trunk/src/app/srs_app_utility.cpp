@@ -29,6 +29,8 @@ using namespace std;
 #include <srs_kernel_error.hpp>
 #include <srs_protocol_kbps.hpp>
 #include <srs_protocol_json.hpp>
+#include <srs_protocol_log.hpp>
+#include <srs_app_threads.hpp>
 #include <srs_kernel_buffer.hpp>
 #include <srs_protocol_amf0.hpp>
 #include <srs_kernel_utility.hpp>
@@ -1377,6 +1379,26 @@ void srs_api_dump_summaries(SrsJsonObject* obj)
     sys->set("conn_sys_tw", SrsJsonAny::integer(nrs->nb_conn_sys_tw));
     sys->set("conn_sys_udp", SrsJsonAny::integer(nrs->nb_conn_sys_udp));
     sys->set("conn_srs", SrsJsonAny::integer(nrs->nb_conn_srs));
+
+    // The scheduler stat of ST for each thread, if enabled.
+    SrsJsonArray* sched = SrsJsonAny::array();
+    data->set("sched", sched);
+
+    vector<SrsThreadEntry*> threads = _srs_thread_pool->threads();
+    for (int i = 0; i < (int)threads.size(); i++) {
+        SrsThreadEntry* entry = threads.at(i);
+        if (!entry->sched) {
+            continue;
+        }
+
+        SrsJsonObject* p = SrsJsonAny::object();
+        sched->append(p);
+
+        p->set("name", SrsJsonAny::str(entry->name.c_str()));
+        p->set("label", SrsJsonAny::str(entry->label.c_str()));
+        p->set("tid", SrsJsonAny::integer(entry->tid));
+        entry->sched->dumps(p);
+    }
 }
 
 string srs_string_dumps_hex(const std::string& str)
@@ -1398,7 +1420,8 @@ string srs_string_dumps_hex(const char* str, int length, int limit, char seperat
 {
     // 1 byte trailing '\0'.
     const int LIMIT = 1024*16 + 1;
-    static char buf[LIMIT];
+    // Might be called by worker threads, for example, the DTLS workers.
+    static __thread char buf[LIMIT];
 
     int len = 0;
     for (int i = 0; i < length && i < limit && len < LIMIT; ++i) {
@@ -1466,3 +1489,330 @@ string srs_getenv(const string& key)
     return "";
 }
 
+
+#ifdef SRS_GPERF
+#include <gperftools/malloc_extension.h>
+#endif
+
+#ifndef SRS_OSX
+#include <malloc.h>
+#include <ucontext.h>
+#include <sys/uio.h>
+#endif
+
+// The profiler walks the stack by frame pointers, which are always kept because SRS is built with -O0, while
+// the glibc backtrace crashes when unwinding over the top of the stack of coroutine.
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+    #define SRS_PROFILER_SUPPORTED
+#endif
+
+// The profiler is global, because the signal handler has no argument.
+static SrsCpuProfiler* _srs_cpu_profiler = NULL;
+static bool _srs_profiler_installed = false;
+
+SrsCpuProfiler::SrsCpuProfiler()
+{
+    started_ = false;
+    sampling_ = 0;
+    frequency_ = 0;
+    starttime_ = stoptime_ = 0;
+    samples_ = NULL;
+    max_samples_ = 0;
+    nn_samples_ = nn_dropped_ = 0;
+}
+
+SrsCpuProfiler::~SrsCpuProfiler()
+{
+    stop();
+
+    if (_srs_cpu_profiler == this) {
+        _srs_cpu_profiler = NULL;
+    }
+    srs_freepa(samples_);
+}
+
+srs_error_t SrsCpuProfiler::start(int frequency, int max_samples)
+{
+    srs_error_t err = srs_success;
+
+#if defined(SRS_GPERF_CP) || defined(SRS_GPROF)
+    return srs_error_new(ERROR_PROFILER_START, "conflict with gperf cp or gprof, which use SIGPROF");
+#endif
+#ifndef SRS_PROFILER_SUPPORTED
+    return srs_error_new(ERROR_PROFILER_START, "only support linux x86_64 or aarch64");
+#endif
+
+    if (started_) {
+        return srs_error_new(ERROR_PROFILER_START, "already started");
+    }
+    if (frequency <= 0 || frequency > 1000) {
+        return srs_error_new(ERROR_PROFILER_START, "invalid frequency=%d", frequency);
+    }
+    if (max_samples <= 0) {
+        return srs_error_new(ERROR_PROFILER_START, "invalid max_samples=%d", max_samples);
+    }
+
+    // Reuse the buffer if large enough, the samples of last profile are discarded.
+    if (max_samples > max_samples_) {
+        srs_freepa(samples_);
+        samples_ = new SrsProfilerSample[max_samples];
+    }
+    max_samples_ = max_samples;
+    nn_samples_ = nn_dropped_ = 0;
+
+    _srs_cpu_profiler = this;
+
+    // Install the handler once, and keep it, see sampling_.
+    if (!_srs_profiler_installed) {
+        struct sigaction act;
+        memset(&act, 0, sizeof(act));
+        act.sa_sigaction = SrsCpuProfiler::on_signal;
+        act.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&act.sa_mask);
+        if (sigaction(SIGPROF, &act, NULL) == -1) {
+            return srs_error_new(ERROR_PROFILER_START, "sigaction");
+        }
+        _srs_profiler_installed = true;
+    }
+
+    sampling_ = 1;
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / frequency;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) == -1) {
+        sampling_ = 0;
+        return srs_error_new(ERROR_PROFILER_START, "setitimer");
+    }
+
+    started_ = true;
+    frequency_ = frequency;
+    starttime_ = srs_get_system_time();
+    stoptime_ = 0;
+
+    return err;
+}
+
+void SrsCpuProfiler::stop()
+{
+    if (!started_) {
+        return;
+    }
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    // Ignore the pending SIGPROF by the installed handler.
+    sampling_ = 0;
+
+    started_ = false;
+    stoptime_ = srs_get_system_time();
+}
+
+bool SrsCpuProfiler::started()
+{
+    return started_;
+}
+
+int SrsCpuProfiler::nn_samples()
+{
+    return srs_min(nn_samples_, max_samples_);
+}
+
+int SrsCpuProfiler::nn_dropped()
+{
+    return nn_dropped_;
+}
+
+srs_utime_t SrsCpuProfiler::duration()
+{
+    if (!starttime_) {
+        return 0;
+    }
+    return (started_ ? srs_get_system_time() : stoptime_) - starttime_;
+}
+
+#ifdef SRS_PROFILER_SUPPORTED
+// Read the frame record of [fp, fp+16), which is the caller fp and return address, by syscall which fails with
+// EFAULT rather than crash, because the fp might be garbage at the top of stack.
+static bool srs_profiler_read_frame(uintptr_t fp, uintptr_t* frame)
+{
+    struct iovec local, remote;
+    local.iov_base = frame;
+    local.iov_len = 2 * sizeof(uintptr_t);
+    remote.iov_base = (void*)fp;
+    remote.iov_len = 2 * sizeof(uintptr_t);
+    return process_vm_readv(getpid(), &local, 1, &remote, 1, 0) == (ssize_t)local.iov_len;
+}
+#endif
+
+void SrsCpuProfiler::on_signal(int /*signo*/, siginfo_t* /*info*/, void* context)
+{
+    // The signal might interrupt a syscall and the check of errno, such as the EAGAIN of ST, so we must restore the
+    // errno, which is changed by process_vm_readv when reading the top of stack.
+    int saved_errno = errno;
+    do_on_signal(context);
+    errno = saved_errno;
+}
+
+void SrsCpuProfiler::do_on_signal(void* context)
+{
+    SrsCpuProfiler* p = _srs_cpu_profiler;
+    if (!p || !p->sampling_ || !p->samples_) {
+        return;
+    }
+
+    // Never overwrite the samples, which might be dumped, and never overflow the index.
+    int index = p->max_samples_;
+    if (p->nn_samples_ < p->max_samples_) {
+        index = __sync_fetch_and_add(&p->nn_samples_, 1);
+    }
+    if (index >= p->max_samples_) {
+        __sync_fetch_and_add(&p->nn_dropped_, 1);
+        return;
+    }
+
+    SrsProfilerSample* sample = &p->samples_[index];
+    sample->depth = 0;
+
+#ifdef SRS_PROFILER_SUPPORTED
+    ucontext_t* uc = (ucontext_t*)context;
+#if defined(__x86_64__)
+    uintptr_t pc = uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t fp = uc->uc_mcontext.gregs[REG_RBP];
+#else
+    uintptr_t pc = uc->uc_mcontext.pc;
+    uintptr_t fp = uc->uc_mcontext.regs[29];
+#endif
+
+    // The pc of interrupted function, then the return address of each frame, stop when fp is not increasing, which
+    // is the top of stack.
+    sample->pcs[sample->depth++] = (void*)pc;
+    while (sample->depth < SRS_PROFILER_MAX_DEPTH && fp && (fp & (sizeof(uintptr_t) - 1)) == 0) {
+        uintptr_t frame[2];
+        if (!srs_profiler_read_frame(fp, frame) || !frame[1]) {
+            break;
+        }
+
+        sample->pcs[sample->depth++] = (void*)frame[1];
+        if (frame[0] <= fp) {
+            break;
+        }
+        fp = frame[0];
+    }
+#endif
+
+    if (!srs_context_peek_cid(sample->cid, sizeof(sample->cid))) {
+        sample->cid[0] = 0;
+    }
+}
+
+static void srs_profiler_append_word(string& buf, uintptr_t v)
+{
+    buf.append((const char*)&v, sizeof(uintptr_t));
+}
+
+void SrsCpuProfiler::dumps_pprof(string& buf)
+{
+    int nn_samples = this->nn_samples();
+    int period = frequency_ ? 1000000 / frequency_ : 0;
+
+    // The header, in slots of machine word: [0, header_words, version, period_us, padding].
+    buf.reserve(buf.length() + 64 + nn_samples * (2 + SRS_PROFILER_MAX_DEPTH) * sizeof(uintptr_t));
+    srs_profiler_append_word(buf, 0);
+    srs_profiler_append_word(buf, 3);
+    srs_profiler_append_word(buf, 0);
+    srs_profiler_append_word(buf, period);
+    srs_profiler_append_word(buf, 0);
+
+    // The records, each sample as: [count, depth, pc1, ..., pcN].
+    for (int i = 0; i < nn_samples; i++) {
+        SrsProfilerSample* sample = &samples_[i];
+        if (sample->depth <= 0) {
+            continue;
+        }
+
+        srs_profiler_append_word(buf, 1);
+        srs_profiler_append_word(buf, sample->depth);
+        for (int j = 0; j < sample->depth; j++) {
+            srs_profiler_append_word(buf, (uintptr_t)sample->pcs[j]);
+        }
+    }
+
+    // The trailer, a record with zero count: [0, 1, 0].
+    srs_profiler_append_word(buf, 0);
+    srs_profiler_append_word(buf, 1);
+    srs_profiler_append_word(buf, 0);
+
+    // The mapped objects, to symbolize the pcs.
+    FILE* f = fopen("/proc/self/maps", "r");
+    if (f) {
+        char chunk[4096];
+        size_t nn = 0;
+        while ((nn = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+            buf.append(chunk, nn);
+        }
+        fclose(f);
+    }
+}
+
+void SrsCpuProfiler::dumps_contexts(SrsJsonWriter* w, int max_contexts)
+{
+    int nn_samples = this->nn_samples();
+
+    std::map<std::string, int> contexts;
+    for (int i = 0; i < nn_samples; i++) {
+        SrsProfilerSample* sample = &samples_[i];
+        contexts[sample->cid[0] ? sample->cid : "unknown"]++;
+    }
+
+    // Sort by samples desc, by cid asc for the same samples.
+    std::multimap<int, std::string> sorted;
+    for (std::map<std::string, int>::iterator it = contexts.begin(); it != contexts.end(); ++it) {
+        sorted.insert(std::make_pair(-it->second, it->first));
+    }
+
+    w->begin_array();
+    int nn = 0;
+    for (std::multimap<int, std::string>::iterator it = sorted.begin(); it != sorted.end() && nn < max_contexts; ++it, nn++) {
+        w->begin_object();
+        w->field_str("cid", it->second);
+        w->field_integer("samples", -it->first);
+        w->field_number("percent", nn_samples ? 100.0 * -it->first / nn_samples : 0);
+        w->end_object();
+    }
+    w->end_array();
+}
+
+SrsCpuProfiler* srs_get_cpu_profiler()
+{
+    static SrsCpuProfiler* profiler = new SrsCpuProfiler();
+    return profiler;
+}
+
+string srs_get_heap_snapshot()
+{
+#ifdef SRS_GPERF
+    string sample;
+    MallocExtension::instance()->GetHeapSample(&sample);
+    return sample;
+#elif !defined(SRS_OSX)
+    char* data = NULL;
+    size_t size = 0;
+    FILE* f = open_memstream(&data, &size);
+    if (!f) {
+        return "";
+    }
+
+    malloc_info(0, f);
+    fclose(f);
+
+    string snapshot(data, size);
+    free(data);
+    return snapshot;
+#else
+    return "";
+#endif
+}
@@ -16,6 +16,7 @@
 #include <limits.h>
 #include <arpa/inet.h>
 #include <sys/resource.h>
+#include <signal.h>
 
 #include <srs_app_st.hpp>
 #include <srs_kernel_log.hpp>
@@ -24,6 +25,7 @@
 class SrsKbps;
 class SrsBuffer;
 class SrsJsonObject;
+class SrsJsonWriter;
 
 // Convert level in string to log level in int.
 // @return the log level defined in SrsLogLevel.
@@ -688,5 +690,72 @@ extern std::string srs_string_dumps_hex(const char* str, int length, int limit,
 //      srs_getenv("EIP") is srs_getenv("$EIP")
 extern std::string srs_getenv(const std::string& key);
 
+// The max depth of stack for CPU profiler.
+#define SRS_PROFILER_MAX_DEPTH 32
+// The max size of context id to attribute the sample.
+#define SRS_PROFILER_CID_SIZE 16
+
+// The sample of CPU profiler, written in signal handler.
+struct SrsProfilerSample
+{
+    int depth;
+    void* pcs[SRS_PROFILER_MAX_DEPTH];
+    // The context id of coroutine, empty if unknown.
+    char cid[SRS_PROFILER_CID_SIZE];
+};
+
+// The built-in sampling CPU profiler, driven by SIGPROF of ITIMER_PROF, which is always compiled and could
+// be started and stopped at runtime by HTTP API, without gperftools or restart. The samples are stored in a
+// preallocated buffer, so the signal handler never allocates, and attributed to the coroutine by context id.
+// The profile is encoded in the legacy CPU profile format of gperftools, which is readable by pprof:
+//      curl 'http://localhost:1985/api/v1/profiler?action=pprof&seconds=30' -o srs.prof
+//      pprof --svg ./objs/srs srs.prof > srs.svg
+class SrsCpuProfiler
+{
+private:
+    bool started_;
+    // Whether the signal handler samples. The handler is never uninstalled, because the SIGPROF might be pending
+    // after the timer is stopped, which kills the process by default action.
+    volatile sig_atomic_t sampling_;
+    // The sampling frequency in Hz.
+    int frequency_;
+    srs_utime_t starttime_;
+    srs_utime_t stoptime_;
+    // The samples buffer, never freed when stop, for download.
+    SrsProfilerSample* samples_;
+    int max_samples_;
+    // The number of samples, increased by signal handler of any thread.
+    volatile int nn_samples_;
+    // The number of samples dropped, because buffer is full or context is updating.
+    volatile int nn_dropped_;
+public:
+    SrsCpuProfiler();
+    virtual ~SrsCpuProfiler();
+public:
+    // Start to sample, the samples of last profile are discarded.
+    srs_error_t start(int frequency, int max_samples);
+    void stop();
+    bool started();
+    int nn_samples();
+    int nn_dropped();
+    // The duration of profile, to now if not stopped.
+    srs_utime_t duration();
+public:
+    // Encode the samples in legacy CPU profile format of gperftools, appended to buf.
+    // @see https://github.com/gperftools/gperftools/blob/master/docs/cpuprofile-fileformat.html
+    void dumps_pprof(std::string& buf);
+    // Dumps the top contexts by samples, to attribute the CPU to coroutines.
+    void dumps_contexts(SrsJsonWriter* w, int max_contexts);
+private:
+    static void on_signal(int signo, siginfo_t* info, void* context);
+    static void do_on_signal(void* context);
+};
+
+// Get the global CPU profiler.
+extern SrsCpuProfiler* srs_get_cpu_profiler();
+
+// Get the heap snapshot, the heap sample of tcmalloc for gperf, or the malloc_info of glibc.
+extern std::string srs_get_heap_snapshot();
+
 #endif
 
@@ -105,6 +105,10 @@
     XX(ERROR_BACKTRACE_PARSE_NOT_SUPPORT   , 1092, "BacktraceParseNotSupport", "Backtrace parse not supported") \
     XX(ERROR_BACKTRACE_PARSE_OFFSET        , 1093, "BacktraceParseOffset", "Parse backtrace offset failed") \
     XX(ERROR_BACKTRACE_ADDR2LINE           , 1094, "BacktraceAddr2Line", "Backtrace addr2line failed") \
+    XX(ERROR_PROFILER_DISABLED             , 1095, "ProfilerDisabled", "CPU profiler is disabled") \
+    XX(ERROR_PROFILER_START                , 1096, "ProfilerStart", "Start CPU profiler failed") \
+    XX(ERROR_PROFILER_ACTION               , 1097, "ProfilerAction", "Invalid action of CPU profiler") \
+    XX(ERROR_PROFILER_RUNNING              , 1098, "ProfilerRunning", "CPU profiler is running, stop it before dump") \
 
 /**************************************************/
 /* RTMP protocol error. */
@@ -322,6 +326,7 @@
     XX(ERROR_GB_SSRC_GENERATE              , 4051, "GbSsrcGenerate", "Failed to generate SSRC for GB28181") \
     XX(ERROR_GB_CONFIG                     , 4052, "GbConfig", "Invalid configuration for GB28181") \
     XX(ERROR_GB_TIMEOUT                    , 4053, "GbTimeout", "SIP or media connection timeout for GB28181") \
+    XX(ERROR_HTTP_SENDFILE                 , 4054, "HttpSendfile", "Failed to send file in zero-copy for HTTP") \
 
 /**************************************************/
 /* RTC protocol error. */
@@ -250,6 +250,11 @@ int64_t SrsFileReader::filesize()
     return size;
 }
 
+int SrsFileReader::get_fd()
+{
+    return fd;
+}
+
 srs_error_t SrsFileReader::read(void* buf, size_t count, ssize_t* pnread)
 {
     srs_error_t err = srs_success;
@@ -97,6 +97,8 @@ public:
     virtual void skip(int64_t size);
     virtual int64_t seek2(int64_t offset);
     virtual int64_t filesize();
+    // Get the underlayer fd for zero-copy such as sendfile, -1 if not opened.
+    virtual int get_fd();
 // Interface ISrsReadSeeker
 public:
     virtual srs_error_t read(void* buf, size_t count, ssize_t* pnread);
@@ -17,6 +17,7 @@
 #include <string.h>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 using namespace std;
 
 // For CentOS 6 or C++98, @see https://github.com/ossrs/srs/issues/2815
@@ -29,6 +30,9 @@ using namespace std;
 
 #define SRS_MP4_BUF_SIZE 4096
 
+// The buffer to copy the samples from fMP4 to MP4.
+#define SRS_MP4_COPY_BUF_SIZE 65536
+
 srs_error_t srs_mp4_write_box(ISrsWriter* writer, ISrsCodec* box)
 {
     srs_error_t err = srs_success;
@@ -762,6 +766,33 @@ void SrsMp4MovieFragmentBox::set_traf(SrsMp4TrackFragmentBox* v)
     boxes.push_back(v);
 }
 
+void SrsMp4MovieFragmentBox::add_traf(SrsMp4TrackFragmentBox* v)
+{
+    boxes.push_back(v);
+}
+
+int SrsMp4MovieFragmentBox::nb_trafs()
+{
+    int nb_trafs = 0;
+    for (int i = 0; i < (int)boxes.size(); i++) {
+        if (boxes.at(i)->type == SrsMp4BoxTypeTRAF) {
+            nb_trafs++;
+        }
+    }
+    return nb_trafs;
+}
+
+SrsMp4TrackFragmentBox* SrsMp4MovieFragmentBox::traf_at(int index)
+{
+    for (int i = 0; i < (int)boxes.size(); i++) {
+        SrsMp4Box* box = boxes.at(i);
+        if (box->type == SrsMp4BoxTypeTRAF && index-- == 0) {
+            return dynamic_cast<SrsMp4TrackFragmentBox*>(box);
+        }
+    }
+    return NULL;
+}
+
 SrsMp4MovieFragmentHeaderBox::SrsMp4MovieFragmentHeaderBox()
 {
     type = SrsMp4BoxTypeMFHD;
@@ -5633,6 +5664,155 @@ srs_error_t SrsMp4Decoder::do_load_next_box(SrsMp4Box** ppbox, uint32_t required
     return err;
 }
 
+// Build the tkhd and mdia of video track, the sample table only has stsd, while the samples are written
+// by SrsMp4SampleManager for MP4, or described by moof for fMP4.
+static void srs_mp4_build_video_track(SrsMp4TrackBox* trak, uint32_t track_id, uint64_t duration,
+    uint32_t width, uint32_t height, const vector<char>& avcc)
+{
+    SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
+    trak->set_tkhd(tkhd);
+
+    tkhd->track_ID = track_id;
+    tkhd->duration = duration;
+    tkhd->width = (width << 16);
+    tkhd->height = (height << 16);
+
+    SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
+    trak->set_mdia(mdia);
+
+    SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
+    mdia->set_mdhd(mdhd);
+
+    mdhd->timescale = 1000;
+    mdhd->duration = duration;
+    mdhd->set_language0('u');
+    mdhd->set_language1('n');
+    mdhd->set_language2('d');
+
+    SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
+    mdia->set_hdlr(hdlr);
+
+    hdlr->handler_type = SrsMp4HandlerTypeVIDE;
+    hdlr->name = "VideoHandler";
+
+    SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
+    mdia->set_minf(minf);
+
+    SrsMp4VideoMeidaHeaderBox* vmhd = new SrsMp4VideoMeidaHeaderBox();
+    minf->set_vmhd(vmhd);
+
+    SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
+    minf->set_dinf(dinf);
+
+    SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
+    dinf->set_dref(dref);
+
+    SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
+    dref->append(url);
+
+    SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
+    minf->set_stbl(stbl);
+
+    SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
+    stbl->set_stsd(stsd);
+
+    SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
+    stsd->append(avc1);
+
+    avc1->width = width;
+    avc1->height = height;
+    avc1->data_reference_index = 1;
+
+    SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
+    avc1->set_avcC(avcC);
+
+    avcC->avc_config = avcc;
+}
+
+// Build the tkhd and mdia of audio track, the sample table only has stsd, see srs_mp4_build_video_track.
+static void srs_mp4_build_audio_track(SrsMp4TrackBox* trak, uint32_t track_id, uint64_t duration,
+    SrsAudioSampleRate sample_rate, SrsAudioSampleBits sound_bits, SrsAudioChannels channels,
+    SrsMp4ObjectType object_type, const vector<char>& asc)
+{
+    SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
+    tkhd->volume = 0x0100;
+    trak->set_tkhd(tkhd);
+
+    tkhd->track_ID = track_id;
+    tkhd->duration = duration;
+
+    SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
+    trak->set_mdia(mdia);
+
+    SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
+    mdia->set_mdhd(mdhd);
+
+    mdhd->timescale = 1000;
+    mdhd->duration = duration;
+    mdhd->set_language0('u');
+    mdhd->set_language1('n');
+    mdhd->set_language2('d');
+
+    SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
+    mdia->set_hdlr(hdlr);
+
+    hdlr->handler_type = SrsMp4HandlerTypeSOUN;
+    hdlr->name = "SoundHandler";
+
+    SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
+    mdia->set_minf(minf);
+
+    SrsMp4SoundMeidaHeaderBox* smhd = new SrsMp4SoundMeidaHeaderBox();
+    minf->set_smhd(smhd);
+
+    SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
+    minf->set_dinf(dinf);
+
+    SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
+    dinf->set_dref(dref);
+
+    SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
+    dref->append(url);
+
+    SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
+    minf->set_stbl(stbl);
+
+    SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
+    stbl->set_stsd(stsd);
+
+    SrsMp4AudioSampleEntry* mp4a = new SrsMp4AudioSampleEntry();
+    mp4a->data_reference_index = 1;
+    mp4a->samplerate = srs_audio_sample_rate2number(sample_rate);
+    if (sound_bits == SrsAudioSampleBits16bit) {
+        mp4a->samplesize = 16;
+    } else {
+        mp4a->samplesize = 8;
+    }
+    if (channels == SrsAudioChannelsStereo) {
+        mp4a->channelcount = 2;
+    } else {
+        mp4a->channelcount = 1;
+    }
+    stsd->append(mp4a);
+
+    SrsMp4EsdsBox* esds = new SrsMp4EsdsBox();
+    mp4a->set_esds(esds);
+
+    SrsMp4ES_Descriptor* es = esds->es;
+    es->ES_ID = 0x02;
+
+    SrsMp4DecoderConfigDescriptor& desc = es->decConfigDescr;
+    desc.objectTypeIndication = object_type;
+    desc.streamType = SrsMp4StreamTypeAudioStream;
+    srs_freep(desc.decSpecificInfo);
+
+    if (SrsMp4ObjectTypeAac == desc.objectTypeIndication) {
+        SrsMp4DecoderSpecificInfo* dsi = new SrsMp4DecoderSpecificInfo();
+        desc.decSpecificInfo = dsi;
+        dsi->asc = asc;
+    }
+}
+
 SrsMp4Encoder::SrsMp4Encoder()
 {
     wsio = NULL;
@@ -5822,147 +6002,15 @@ srs_error_t SrsMp4Encoder::flush()
             entry.media_rate_integer = 1;
             elst->entries.push_back(entry);
             
-            SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
-            trak->set_tkhd(tkhd);
-            
-            tkhd->track_ID = mvhd->next_track_ID++;
-            tkhd->duration = vduration;
-            tkhd->width = (width << 16);
-            tkhd->height = (height << 16);
-            
-            SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
-            trak->set_mdia(mdia);
-            
-            SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
-            mdia->set_mdhd(mdhd);
-            
-            mdhd->timescale = 1000;
-            mdhd->duration = vduration;
-            mdhd->set_language0('u');
-            mdhd->set_language1('n');
-            mdhd->set_language2('d');
-            
-            SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
-            mdia->set_hdlr(hdlr);
-            
-            hdlr->handler_type = SrsMp4HandlerTypeVIDE;
-            hdlr->name = "VideoHandler";
-            
-            SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
-            mdia->set_minf(minf);
-            
-            SrsMp4VideoMeidaHeaderBox* vmhd = new SrsMp4VideoMeidaHeaderBox();
-            minf->set_vmhd(vmhd);
-            
-            SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
-            minf->set_dinf(dinf);
-            
-            SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
-            dinf->set_dref(dref);
-            
-            SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
-            dref->append(url);
-            
-            SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
-            minf->set_stbl(stbl);
-            
-            SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
-            stbl->set_stsd(stsd);
-            
-            SrsMp4VisualSampleEntry* avc1 = new SrsMp4VisualSampleEntry();
-            stsd->append(avc1);
-            
-            avc1->width = width;
-            avc1->height = height;
-            avc1->data_reference_index = 1;
-            
-            SrsMp4AvccBox* avcC = new SrsMp4AvccBox();
-            avc1->set_avcC(avcC);
-            
-            avcC->avc_config = pavcc;
+            srs_mp4_build_video_track(trak, mvhd->next_track_ID++, vduration, width, height, pavcc);
         }
         
         if (nb_audios || !pasc.empty()) {
             SrsMp4TrackBox* trak = new SrsMp4TrackBox();
             moov->add_trak(trak);
             
-            SrsMp4TrackHeaderBox* tkhd = new SrsMp4TrackHeaderBox();
-            tkhd->volume = 0x0100;
-            trak->set_tkhd(tkhd);
-            
-            tkhd->track_ID = mvhd->next_track_ID++;
-            tkhd->duration = aduration;
-            
-            SrsMp4MediaBox* mdia = new SrsMp4MediaBox();
-            trak->set_mdia(mdia);
-            
-            SrsMp4MediaHeaderBox* mdhd = new SrsMp4MediaHeaderBox();
-            mdia->set_mdhd(mdhd);
-            
-            mdhd->timescale = 1000;
-            mdhd->duration = aduration;
-            mdhd->set_language0('u');
-            mdhd->set_language1('n');
-            mdhd->set_language2('d');
-            
-            SrsMp4HandlerReferenceBox* hdlr = new SrsMp4HandlerReferenceBox();
-            mdia->set_hdlr(hdlr);
-            
-            hdlr->handler_type = SrsMp4HandlerTypeSOUN;
-            hdlr->name = "SoundHandler";
-            
-            SrsMp4MediaInformationBox* minf = new SrsMp4MediaInformationBox();
-            mdia->set_minf(minf);
-            
-            SrsMp4SoundMeidaHeaderBox* smhd = new SrsMp4SoundMeidaHeaderBox();
-            minf->set_smhd(smhd);
-            
-            SrsMp4DataInformationBox* dinf = new SrsMp4DataInformationBox();
-            minf->set_dinf(dinf);
-            
-            SrsMp4DataReferenceBox* dref = new SrsMp4DataReferenceBox();
-            dinf->set_dref(dref);
-            
-            SrsMp4DataEntryBox* url = new SrsMp4DataEntryUrlBox();
-            dref->append(url);
-            
-            SrsMp4SampleTableBox* stbl = new SrsMp4SampleTableBox();
-            minf->set_stbl(stbl);
-            
-            SrsMp4SampleDescriptionBox* stsd = new SrsMp4SampleDescriptionBox();
-            stbl->set_stsd(stsd);
-            
-            SrsMp4AudioSampleEntry* mp4a = new SrsMp4AudioSampleEntry();
-            mp4a->data_reference_index = 1;
-            mp4a->samplerate = srs_audio_sample_rate2number(sample_rate);
-            if (sound_bits == SrsAudioSampleBits16bit) {
-                mp4a->samplesize = 16;
-            } else {
-                mp4a->samplesize = 8;
-            }
-            if (channels == SrsAudioChannelsStereo) {
-                mp4a->channelcount = 2;
-            } else {
-                mp4a->channelcount = 1;
-            }
-            stsd->append(mp4a);
-            
-            SrsMp4EsdsBox* esds = new SrsMp4EsdsBox();
-            mp4a->set_esds(esds);
-            
-            SrsMp4ES_Descriptor* es = esds->es;
-            es->ES_ID = 0x02;
-            
-            SrsMp4DecoderConfigDescriptor& desc = es->decConfigDescr;
-            desc.objectTypeIndication = get_audio_object_type();
-            desc.streamType = SrsMp4StreamTypeAudioStream;
-            srs_freep(desc.decSpecificInfo);
-            
-            if (SrsMp4ObjectTypeAac == desc.objectTypeIndication) {
-                SrsMp4DecoderSpecificInfo* asc = new SrsMp4DecoderSpecificInfo();
-                desc.decSpecificInfo = asc;
-                asc->asc = pasc;
-            }
+            srs_mp4_build_audio_track(trak, mvhd->next_track_ID++, aduration, sample_rate, sound_bits, channels,
+                get_audio_object_type(), pasc);
         }
         
         if ((err = samples->write(moov)) != srs_success) {
@@ -6543,3 +6591,1309 @@ srs_error_t SrsMp4M2tsSegmentEncoder::flush(uint64_t& dts)
     return err;
 }
 
+
+// The sample_flags of trun, see ISO_IEC_14496-12-base-format-2012.pdf, page 63. For sync sample, the
+// sample_depends_on is 2(does not depend on others), otherwise, the sample_depends_on is 1(depends on
+// others) and sample_is_non_sync_sample is 1.
+#define SRS_MP4_SAMPLE_FLAGS_SYNC 0x02000000
+#define SRS_MP4_SAMPLE_FLAGS_NON_SYNC 0x01010000
+#define SRS_MP4_SAMPLE_FLAGS_IS_NON_SYNC 0x00010000
+
+// The sample table of fMP4 is empty, because the samples are described by moof.
+static void srs_fmp4_empty_sample_table(SrsMp4SampleTableBox* stbl)
+{
+    stbl->set_stts(new SrsMp4DecodingTime2SampleBox());
+    stbl->set_stsc(new SrsMp4Sample2ChunkBox());
+    stbl->set_stsz(new SrsMp4SampleSizeBox());
+    stbl->set_stco(new SrsMp4ChunkOffsetBox());
+}
+
+SrsFmp4Encoder::SrsFmp4Encoder()
+{
+    writer = NULL;
+    fragment = 0;
+    sequence_number = 1;
+    moov_written = false;
+    samples = new SrsMp4SampleManager();
+    vbytes = abytes = 0;
+    nb_audios = nb_videos = 0;
+    adelta = vdelta = 0;
+    atid = vtid = 0;
+    width = height = 0;
+
+    acodec = SrsAudioCodecIdForbidden;
+    sample_rate = SrsAudioSampleRateForbidden;
+    sound_bits = SrsAudioSampleBitsForbidden;
+    channels = SrsAudioChannelsForbidden;
+    vcodec = SrsVideoCodecIdForbidden;
+}
+
+SrsFmp4Encoder::~SrsFmp4Encoder()
+{
+    srs_freep(samples);
+}
+
+srs_error_t SrsFmp4Encoder::initialize(ISrsWriter* w, srs_utime_t f)
+{
+    writer = w;
+    fragment = (uint32_t)srsu2ms(f);
+    return srs_success;
+}
+
+srs_error_t SrsFmp4Encoder::write_sample(
+    SrsFormat* format, SrsMp4HandlerType ht, uint16_t ft, uint16_t ct, uint32_t dts, uint32_t pts,
+    uint8_t* sample, uint32_t nb_sample
+) {
+    srs_error_t err = srs_success;
+
+    // For SPS/PPS or ASC, copy it to moov.
+    bool vsh = (ht == SrsMp4HandlerTypeVIDE) && (ct == (uint16_t)SrsVideoAvcFrameTraitSequenceHeader);
+    bool ash = (ht == SrsMp4HandlerTypeSOUN) && (ct == (uint16_t)SrsAudioAacFrameTraitSequenceHeader);
+    if (vsh || ash) {
+        return copy_sequence_header(format, vsh, sample, nb_sample);
+    }
+
+    if (ht != SrsMp4HandlerTypeVIDE && ht != SrsMp4HandlerTypeSOUN) {
+        return err;
+    }
+
+    // Flush the fragment when its duration exceed, and start the next fragment with a video keyframe
+    // if possible, so each fragment is decodable. However, we never wait for the keyframe too long,
+    // to keep the memory bounded even for stream with very large GOP.
+    if (!samples->samples.empty()) {
+        int64_t elapsed = (int64_t)dts - (int64_t)samples->samples[0]->dts;
+        bool keyframe = ht == SrsMp4HandlerTypeVIDE && ft == SrsVideoAvcFrameTypeKeyFrame;
+        bool reached = elapsed >= (int64_t)fragment && (keyframe || pavcc.empty());
+        if (reached || elapsed >= 2 * (int64_t)fragment) {
+            if ((err = write_fragment()) != srs_success) {
+                return srs_error_wrap(err, "write fragment");
+            }
+        }
+    }
+
+    SrsMp4Sample* ps = new SrsMp4Sample();
+    if (ht == SrsMp4HandlerTypeVIDE) {
+        ps->type = SrsFrameTypeVideo;
+        ps->frame_type = (SrsVideoAvcFrameType)ft;
+        ps->index = nb_videos++;
+        vbytes += nb_sample;
+    } else {
+        ps->type = SrsFrameTypeAudio;
+        ps->index = nb_audios++;
+        abytes += nb_sample;
+    }
+    ps->tbn = 1000;
+    ps->dts = dts;
+    ps->pts = pts;
+
+    // We should copy the sample data, which is shared ptr from video/audio message.
+    // Furthermore, we do free the data when freeing the sample.
+    ps->data = new uint8_t[nb_sample];
+    memcpy(ps->data, sample, nb_sample);
+    ps->nb_data = nb_sample;
+
+    samples->append(ps);
+
+    return err;
+}
+
+srs_error_t SrsFmp4Encoder::flush()
+{
+    srs_error_t err = srs_success;
+
+    if (!nb_audios && !nb_videos) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "Missing audio and video track");
+    }
+
+    if ((err = write_fragment()) != srs_success) {
+        return srs_error_wrap(err, "write fragment");
+    }
+
+    return err;
+}
+
+srs_error_t SrsFmp4Encoder::copy_sequence_header(SrsFormat* format, bool vsh, uint8_t* sample, uint32_t nb_sample)
+{
+    srs_error_t err = srs_success;
+
+    if (vsh && !pavcc.empty()) {
+        if (nb_sample == (uint32_t)pavcc.size() && srs_bytes_equals(sample, &pavcc[0], (int)pavcc.size())) {
+            return err;
+        }
+
+        return srs_error_new(ERROR_MP4_AVCC_CHANGE, "doesn't support avcc change");
+    }
+
+    if (!vsh && !pasc.empty()) {
+        if (nb_sample == (uint32_t)pasc.size() && srs_bytes_equals(sample, &pasc[0], (int)pasc.size())) {
+            return err;
+        }
+
+        return srs_error_new(ERROR_MP4_ASC_CHANGE, "doesn't support asc change");
+    }
+
+    if (vsh) {
+        pavcc = std::vector<char>(sample, sample + nb_sample);
+        if (format && format->vcodec) {
+            width = format->vcodec->width;
+            height = format->vcodec->height;
+        }
+    }
+
+    if (!vsh) {
+        pasc = std::vector<char>(sample, sample + nb_sample);
+    }
+
+    return err;
+}
+
+srs_error_t SrsFmp4Encoder::write_moov()
+{
+    srs_error_t err = srs_success;
+
+    // Write ftyp box.
+    if (true) {
+        SrsMp4FileTypeBox* ftyp = new SrsMp4FileTypeBox();
+        SrsAutoFree(SrsMp4FileTypeBox, ftyp);
+
+        ftyp->major_brand = SrsMp4BoxBrandISO5;
+        ftyp->minor_version = 512;
+        ftyp->set_compatible_brands(SrsMp4BoxBrandISO5, SrsMp4BoxBrandISO6, SrsMp4BoxBrandAVC1, SrsMp4BoxBrandMP41);
+
+        if ((err = srs_mp4_write_box(writer, ftyp)) != srs_success) {
+            return srs_error_wrap(err, "write ftyp");
+        }
+    }
+
+    // Write moov, without any sample, which is described by moof.
+    SrsMp4MovieBox* moov = new SrsMp4MovieBox();
+    SrsAutoFree(SrsMp4MovieBox, moov);
+
+    SrsMp4MovieHeaderBox* mvhd = new SrsMp4MovieHeaderBox();
+    moov->set_mvhd(mvhd);
+
+    mvhd->timescale = 1000; // Use tbn ms.
+    mvhd->duration_in_tbn = 0;
+    mvhd->next_track_ID = 1; // Starts from 1, increase when use it.
+
+    SrsMp4MovieExtendsBox* mvex = new SrsMp4MovieExtendsBox();
+
+    if (!pavcc.empty()) {
+        SrsMp4TrackBox* trak = new SrsMp4TrackBox();
+        moov->add_trak(trak);
+
+        vtid = mvhd->next_track_ID++;
+        srs_mp4_build_video_track(trak, vtid, 0, width, height, pavcc);
+        srs_fmp4_empty_sample_table(trak->stbl());
+
+        SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
+        mvex->append(trex);
+
+        trex->track_ID = vtid;
+        trex->default_sample_description_index = 1;
+    }
+
+    if (acodec != SrsAudioCodecIdForbidden || !pasc.empty()) {
+        SrsMp4TrackBox* trak = new SrsMp4TrackBox();
+        moov->add_trak(trak);
+
+        atid = mvhd->next_track_ID++;
+        srs_mp4_build_audio_track(trak, atid, 0, sample_rate, sound_bits, channels, get_audio_object_type(), pasc);
+        srs_fmp4_empty_sample_table(trak->stbl());
+
+        SrsMp4TrackExtendsBox* trex = new SrsMp4TrackExtendsBox();
+        mvex->append(trex);
+
+        trex->track_ID = atid;
+        trex->default_sample_description_index = 1;
+    }
+
+    moov->set_mvex(mvex);
+
+    if ((err = srs_mp4_write_box(writer, moov)) != srs_success) {
+        return srs_error_wrap(err, "write moov");
+    }
+
+    return err;
+}
+
+srs_error_t SrsFmp4Encoder::write_fragment()
+{
+    srs_error_t err = srs_success;
+
+    if (samples->samples.empty()) {
+        return err;
+    }
+
+    // Write the ftyp and moov for the first fragment, when all sequence headers are parsed.
+    if (!moov_written) {
+        if ((err = write_moov()) != srs_success) {
+            return srs_error_wrap(err, "write moov");
+        }
+        moov_written = true;
+    }
+
+    // Ignore the samples of track, which is not in moov.
+    uint64_t nb_vbytes = vtid ? vbytes : 0;
+    uint64_t nb_abytes = atid ? abytes : 0;
+
+    SrsMp4MovieFragmentBox* moof = new SrsMp4MovieFragmentBox();
+    SrsAutoFree(SrsMp4MovieFragmentBox, moof);
+
+    SrsMp4MovieFragmentHeaderBox* mfhd = new SrsMp4MovieFragmentHeaderBox();
+    moof->set_mfhd(mfhd);
+
+    mfhd->sequence_number = sequence_number++;
+
+    SrsMp4TrackFragmentBox* vtraf = NULL;
+    if (nb_vbytes) {
+        vtraf = create_traf(SrsFrameTypeVideo, vtid);
+        moof->add_traf(vtraf);
+    }
+
+    SrsMp4TrackFragmentBox* atraf = NULL;
+    if (nb_abytes) {
+        atraf = create_traf(SrsFrameTypeAudio, atid);
+        moof->add_traf(atraf);
+    }
+
+    SrsMp4MediaDataBox* mdat = new SrsMp4MediaDataBox();
+    SrsAutoFree(SrsMp4MediaDataBox, mdat);
+
+    mdat->nb_data = nb_vbytes + nb_abytes;
+    mdat->update_size();
+
+    // The data_offset of trun is relative to moof, and in mdat, the video samples are followed
+    // by the audio samples.
+    int32_t data_offset = (int32_t)(moof->nb_bytes() + mdat->sz_header());
+    if (vtraf) {
+        vtraf->trun()->data_offset = data_offset;
+        data_offset += (int32_t)nb_vbytes;
+    }
+    if (atraf) {
+        atraf->trun()->data_offset = data_offset;
+    }
+
+    if ((err = srs_mp4_write_box(writer, moof)) != srs_success) {
+        return srs_error_wrap(err, "write moof");
+    }
+
+    // Write mdat.
+    if (true) {
+        int nb_data = mdat->sz_header();
+        uint8_t* data = new uint8_t[nb_data];
+        SrsAutoFreeA(uint8_t, data);
+
+        SrsBuffer* buffer = new SrsBuffer((char*)data, nb_data);
+        SrsAutoFree(SrsBuffer, buffer);
+
+        if ((err = mdat->encode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "encode mdat");
+        }
+
+        // TODO: FIXME: Ensure all bytes are writen.
+        if ((err = writer->write(data, nb_data, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write mdat");
+        }
+
+        for (int i = 0; i < 2; i++) {
+            SrsFrameType track = (i == 0) ? SrsFrameTypeVideo : SrsFrameTypeAudio;
+            if ((track == SrsFrameTypeVideo && !nb_vbytes) || (track == SrsFrameTypeAudio && !nb_abytes)) {
+                continue;
+            }
+
+            vector<SrsMp4Sample*>::iterator it;
+            for (it = samples->samples.begin(); it != samples->samples.end(); ++it) {
+                SrsMp4Sample* sample = *it;
+                if (sample->type != track) {
+                    continue;
+                }
+
+                // TODO: FIXME: Ensure all bytes are writen.
+                if ((err = writer->write(sample->data, sample->nb_data, NULL)) != srs_success) {
+                    return srs_error_wrap(err, "write sample");
+                }
+            }
+        }
+    }
+
+    // Free the samples of this fragment, to keep the memory bounded.
+    srs_freep(samples);
+    samples = new SrsMp4SampleManager();
+    vbytes = abytes = 0;
+
+    return err;
+}
+
+SrsMp4TrackFragmentBox* SrsFmp4Encoder::create_traf(SrsFrameType track, uint32_t tid)
+{
+    vector<SrsMp4Sample*> track_samples;
+    vector<SrsMp4Sample*>::iterator it;
+    for (it = samples->samples.begin(); it != samples->samples.end(); ++it) {
+        SrsMp4Sample* sample = *it;
+        if (sample->type == track) {
+            track_samples.push_back(sample);
+        }
+    }
+
+    SrsMp4TrackFragmentBox* traf = new SrsMp4TrackFragmentBox();
+
+    SrsMp4TrackFragmentHeaderBox* tfhd = new SrsMp4TrackFragmentHeaderBox();
+    traf->set_tfhd(tfhd);
+
+    tfhd->track_id = tid;
+    tfhd->flags = SrsMp4TfhdFlagsDefaultBaseIsMoof;
+
+    SrsMp4TrackFragmentDecodeTimeBox* tfdt = new SrsMp4TrackFragmentDecodeTimeBox();
+    traf->set_tfdt(tfdt);
+
+    tfdt->version = 1;
+    tfdt->base_media_decode_time = track_samples.empty() ? 0 : track_samples[0]->dts;
+
+    SrsMp4TrackFragmentRunBox* trun = new SrsMp4TrackFragmentRunBox();
+    traf->set_trun(trun);
+
+    trun->flags = SrsMp4TrunFlagsDataOffset | SrsMp4TrunFlagsSampleDuration
+        | SrsMp4TrunFlagsSampleSize | SrsMp4TrunFlagsSampleFlag | SrsMp4TrunFlagsSampleCtsOffset;
+
+    // The duration of last sample is unknown until next fragment, so we guess it by the previous one,
+    // while the tfdt of next fragment always corrects the timeline.
+    uint32_t& delta = (track == SrsFrameTypeVideo) ? vdelta : adelta;
+
+    for (int i = 0; i < (int)track_samples.size(); i++) {
+        SrsMp4Sample* sample = track_samples[i];
+        SrsMp4TrunEntry* entry = new SrsMp4TrunEntry(trun);
+
+        if (i < (int)track_samples.size() - 1) {
+            SrsMp4Sample* next = track_samples[i + 1];
+            delta = (next->dts > sample->dts) ? (uint32_t)(next->dts - sample->dts) : 0;
+        }
+        entry->sample_duration = delta;
+        entry->sample_size = sample->nb_data;
+
+        if (track == SrsFrameTypeAudio || sample->frame_type == SrsVideoAvcFrameTypeKeyFrame) {
+            entry->sample_flags = SRS_MP4_SAMPLE_FLAGS_SYNC;
+        } else {
+            entry->sample_flags = SRS_MP4_SAMPLE_FLAGS_NON_SYNC;
+        }
+
+        entry->sample_composition_time_offset = (int64_t)(sample->pts - sample->dts);
+        if (entry->sample_composition_time_offset < 0) {
+            trun->version = 1;
+        }
+
+        trun->entries.push_back(entry);
+    }
+
+    return traf;
+}
+
+SrsMp4ObjectType SrsFmp4Encoder::get_audio_object_type()
+{
+    switch (acodec) {
+    case SrsAudioCodecIdAAC:
+        return SrsMp4ObjectTypeAac;
+    case SrsAudioCodecIdMP3:
+        return (srs_audio_sample_rate2number(sample_rate) > 24000) ? SrsMp4ObjectTypeMp1a : SrsMp4ObjectTypeMp3;  // 11172 - 3
+    default:
+        return SrsMp4ObjectTypeForbidden;
+    }
+}
+
+SrsFmp4Defragmenter::SrsFmp4Defragmenter()
+{
+    rsio = NULL;
+    writer = NULL;
+    br = new SrsMp4BoxReader();
+    stream = new SrsSimpleStream();
+    moov = NULL;
+    samples = new SrsMp4SampleManager();
+    nb_videos = nb_audios = 0;
+    vstart = vend = astart = aend = 0;
+    copy_buf = NULL;
+    copy_index = 0;
+    copy_left = 0;
+}
+
+SrsFmp4Defragmenter::~SrsFmp4Defragmenter()
+{
+    srs_freep(br);
+    srs_freep(stream);
+    srs_freep(moov);
+    srs_freep(samples);
+    srs_freepa(copy_buf);
+}
+
+srs_error_t SrsFmp4Defragmenter::initialize(ISrsReadSeeker* rs, ISrsWriter* w)
+{
+    srs_error_t err = srs_success;
+
+    rsio = rs;
+    writer = w;
+
+    if ((err = br->initialize(rs)) != srs_success) {
+        return srs_error_wrap(err, "init box reader");
+    }
+
+    return err;
+}
+
+srs_error_t SrsFmp4Defragmenter::defragment()
+{
+    srs_error_t err = srs_success;
+
+    if ((err = start()) != srs_success) {
+        return srs_error_wrap(err, "start");
+    }
+
+    bool done = false;
+    while (!done) {
+        if ((err = copy(SRS_MP4_COPY_BUF_SIZE, &done)) != srs_success) {
+            return srs_error_wrap(err, "copy samples");
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsFmp4Defragmenter::start()
+{
+    srs_error_t err = srs_success;
+
+    off_t filesize = 0;
+    if ((err = rsio->lseek(0, SEEK_END, &filesize)) != srs_success) {
+        return srs_error_wrap(err, "seek to end");
+    }
+    if ((err = rsio->lseek(0, SEEK_SET, NULL)) != srs_success) {
+        return srs_error_wrap(err, "seek to start");
+    }
+
+    if ((err = parse(filesize)) != srs_success) {
+        return srs_error_wrap(err, "parse fragments");
+    }
+
+    if (!moov) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "no moov");
+    }
+    if (samples->samples.empty()) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOF, "no sample");
+    }
+
+    // Each fragment groups the samples by track, so we interleave them by timestamp, because
+    // players and our decoder read the samples of a progressive MP4 in the order of offset.
+    interleave();
+
+    SrsMp4FileTypeBox* ftyp = new SrsMp4FileTypeBox();
+    SrsAutoFree(SrsMp4FileTypeBox, ftyp);
+
+    ftyp->major_brand = SrsMp4BoxBrandISOM;
+    ftyp->minor_version = 512;
+    ftyp->set_compatible_brands(SrsMp4BoxBrandISOM, SrsMp4BoxBrandISO2, SrsMp4BoxBrandAVC1, SrsMp4BoxBrandMP41);
+
+    SrsMp4MediaDataBox* mdat = new SrsMp4MediaDataBox();
+    SrsAutoFree(SrsMp4MediaDataBox, mdat);
+
+    vector<SrsMp4Sample*>::iterator it;
+    for (it = samples->samples.begin(); it != samples->samples.end(); ++it) {
+        mdat->nb_data += (*it)->nb_data;
+    }
+    mdat->update_size();
+
+    // The chunk offsets in moov depends on the size of moov, while the size of moov depends on the
+    // chunk offsets, because stco might be changed to co64, so we update it until the size is stable.
+    uint64_t moov_bytes = 0;
+    for (int i = 0;; i++) {
+        if (i >= 4) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "unstable moov size %" PRId64, moov_bytes);
+        }
+
+        if ((err = write_moov(ftyp->nb_bytes() + moov_bytes + mdat->sz_header())) != srs_success) {
+            return srs_error_wrap(err, "write moov");
+        }
+
+        uint64_t nb_bytes = moov->nb_bytes();
+        if (nb_bytes == moov_bytes) {
+            break;
+        }
+        moov_bytes = nb_bytes;
+    }
+
+    if ((err = srs_mp4_write_box(writer, ftyp)) != srs_success) {
+        return srs_error_wrap(err, "write ftyp");
+    }
+
+    if ((err = srs_mp4_write_box(writer, moov)) != srs_success) {
+        return srs_error_wrap(err, "write moov");
+    }
+
+    // Write mdat.
+    if (true) {
+        int nb_data = mdat->sz_header();
+        uint8_t* data = new uint8_t[nb_data];
+        SrsAutoFreeA(uint8_t, data);
+
+        SrsBuffer* buffer = new SrsBuffer((char*)data, nb_data);
+        SrsAutoFree(SrsBuffer, buffer);
+
+        if ((err = mdat->encode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "encode mdat");
+        }
+
+        if ((err = writer->write(data, nb_data, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write mdat");
+        }
+    }
+
+    srs_freepa(copy_buf);
+    copy_buf = new char[SRS_MP4_COPY_BUF_SIZE];
+    copy_index = 0;
+    copy_left = 0;
+
+    return err;
+}
+
+static bool srs_fmp4_sample_dts_less(const pair<SrsMp4Sample*, off_t>& a, const pair<SrsMp4Sample*, off_t>& b)
+{
+    return a.first->dts_ms() < b.first->dts_ms();
+}
+
+void SrsFmp4Defragmenter::interleave()
+{
+    vector< pair<SrsMp4Sample*, off_t> > pairs;
+    for (int i = 0; i < (int)samples->samples.size(); i++) {
+        pairs.push_back(make_pair(samples->samples[i], offsets[i]));
+    }
+
+    // Keep the order of samples in the same track, and put video before audio at the same time.
+    std::stable_sort(pairs.begin(), pairs.end(), srs_fmp4_sample_dts_less);
+
+    for (int i = 0; i < (int)pairs.size(); i++) {
+        samples->samples[i] = pairs[i].first;
+        offsets[i] = pairs[i].second;
+    }
+}
+
+srs_error_t SrsFmp4Defragmenter::parse(off_t filesize)
+{
+    srs_error_t err = srs_success;
+
+    off_t offset = 0;
+    while (offset < filesize) {
+        SrsMp4Box* box = NULL;
+        SrsAutoFree(SrsMp4Box, box);
+
+        // Ignore the truncated box at the end of file, which is left by crash.
+        if ((err = br->read(stream, &box)) != srs_success) {
+            srs_warn("fmp4: ignore truncated box at %" PRId64 ", err %s", offset, srs_error_desc(err).c_str());
+            srs_freep(err);
+            break;
+        }
+
+        // For mdat, only decode the header.
+        SrsBuffer* buffer = new SrsBuffer(stream->bytes(), stream->length());
+        SrsAutoFree(SrsBuffer, buffer);
+
+        if ((err = box->decode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "decode box at %" PRId64, offset);
+        }
+
+        uint64_t size = box->sz();
+        bool is_mdat = box->is_mdat();
+        if (size == 0) {
+            break;
+        }
+
+        if (box->is_moov()) {
+            if (moov) {
+                return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "duplicated moov");
+            }
+            moov = dynamic_cast<SrsMp4MovieBox*>(box);
+            box = NULL;
+        } else if (box->type == SrsMp4BoxTypeMOOF) {
+            if (!moov) {
+                return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "no moov before moof");
+            }
+
+            bool truncated = false;
+            SrsMp4MovieFragmentBox* moof = dynamic_cast<SrsMp4MovieFragmentBox*>(box);
+            if ((err = parse_moof(moof, offset, filesize, &truncated)) != srs_success) {
+                return srs_error_wrap(err, "parse moof");
+            }
+
+            if (truncated) {
+                srs_warn("fmp4: ignore truncated fragment at %" PRId64, offset);
+                break;
+            }
+        }
+
+        // Skip the box. For mdat, the reader only reads its header, so we seek over its content.
+        offset += (off_t)size;
+        if (is_mdat) {
+            stream->erase(stream->length());
+            if (offset < filesize && (err = rsio->lseek(offset, SEEK_SET, NULL)) != srs_success) {
+                return srs_error_wrap(err, "seek to %" PRId64, offset);
+            }
+        } else {
+            stream->erase((int)size);
+        }
+    }
+
+    return err;
+}
+
+srs_error_t SrsFmp4Defragmenter::parse_moof(SrsMp4MovieFragmentBox* moof, off_t offset, off_t filesize, bool* truncated)
+{
+    srs_error_t err = srs_success;
+
+    SrsMp4TrackBox* vide = moov->video();
+    SrsMp4TrackBox* soun = moov->audio();
+
+    // The base data offset of traf, if not specified, is the end of data of previous traf.
+    uint64_t data_end = offset;
+
+    for (int i = 0; i < moof->nb_trafs(); i++) {
+        SrsMp4TrackFragmentBox* traf = moof->traf_at(i);
+        SrsMp4TrackFragmentHeaderBox* tfhd = traf->tfhd();
+        SrsMp4TrackFragmentRunBox* trun = traf->trun();
+        if (!tfhd || !trun) {
+            continue;
+        }
+
+        SrsMp4TrackBox* trak = NULL;
+        SrsFrameType type = SrsFrameTypeForbidden;
+        if (vide && vide->tkhd() && vide->tkhd()->track_ID == tfhd->track_id) {
+            trak = vide;
+            type = SrsFrameTypeVideo;
+        } else if (soun && soun->tkhd() && soun->tkhd()->track_ID == tfhd->track_id) {
+            trak = soun;
+            type = SrsFrameTypeAudio;
+        } else {
+            continue;
+        }
+
+        uint64_t data_offset = data_end;
+        if ((tfhd->flags & SrsMp4TfhdFlagsBaseDataOffset) == SrsMp4TfhdFlagsBaseDataOffset) {
+            data_offset = tfhd->base_data_offset;
+        } else if ((tfhd->flags & SrsMp4TfhdFlagsDefaultBaseIsMoof) == SrsMp4TfhdFlagsDefaultBaseIsMoof) {
+            data_offset = offset;
+        }
+        if ((trun->flags & SrsMp4TrunFlagsDataOffset) == SrsMp4TrunFlagsDataOffset) {
+            data_offset += trun->data_offset;
+        }
+
+        uint64_t& end = (type == SrsFrameTypeVideo) ? vend : aend;
+        uint64_t dts = traf->tfdt() ? traf->tfdt()->base_media_decode_time : end;
+        uint32_t tbn = trak->mdhd() ? trak->mdhd()->timescale : 1000;
+
+        for (int j = 0; j < (int)trun->entries.size(); j++) {
+            SrsMp4TrunEntry* entry = trun->entries.at(j);
+
+            uint32_t duration = tfhd->default_sample_duration;
+            if ((trun->flags & SrsMp4TrunFlagsSampleDuration) == SrsMp4TrunFlagsSampleDuration) {
+                duration = entry->sample_duration;
+            }
+
+            uint32_t size = tfhd->default_sample_size;
+            if ((trun->flags & SrsMp4TrunFlagsSampleSize) == SrsMp4TrunFlagsSampleSize) {
+                size = entry->sample_size;
+            }
+
+            uint32_t flags = tfhd->default_sample_flags;
+            if ((trun->flags & SrsMp4TrunFlagsSampleFlag) == SrsMp4TrunFlagsSampleFlag) {
+                flags = entry->sample_flags;
+            } else if (j == 0 && (trun->flags & SrsMp4TrunFlagsFirstSample) == SrsMp4TrunFlagsFirstSample) {
+                flags = trun->first_sample_flags;
+            }
+
+            int64_t cts = 0;
+            if ((trun->flags & SrsMp4TrunFlagsSampleCtsOffset) == SrsMp4TrunFlagsSampleCtsOffset) {
+                cts = entry->sample_composition_time_offset;
+            }
+
+            // The data of sample is not completely written, for example, server crashed.
+            if (data_offset + size > (uint64_t)filesize) {
+                *truncated = true;
+                return err;
+            }
+
+            SrsMp4Sample* ps = new SrsMp4Sample();
+            ps->type = type;
+            ps->tbn = tbn;
+            ps->dts = dts;
+            ps->pts = (uint64_t)((int64_t)dts + cts);
+            ps->nb_data = size;
+
+            if (type == SrsFrameTypeVideo) {
+                bool sync = (flags & SRS_MP4_SAMPLE_FLAGS_IS_NON_SYNC) == 0;
+                ps->frame_type = sync ? SrsVideoAvcFrameTypeKeyFrame : SrsVideoAvcFrameTypeInterFrame;
+                ps->index = nb_videos++;
+                vstart = (ps->index == 0) ? dts : vstart;
+            } else {
+                ps->index = nb_audios++;
+                astart = (ps->index == 0) ? dts : astart;
+            }
+
+            samples->append(ps);
+            offsets.push_back((off_t)data_offset);
+
+            data_offset += size;
+            dts += duration;
+        }
+
+        end = dts;
+        data_end = data_offset;
+    }
+
+    return err;
+}
+
+srs_error_t SrsFmp4Defragmenter::write_moov(uint64_t mdat_offset)
+{
+    srs_error_t err = srs_success;
+
+    uint64_t offset = mdat_offset;
+    vector<SrsMp4Sample*>::iterator it;
+    for (it = samples->samples.begin(); it != samples->samples.end(); ++it) {
+        SrsMp4Sample* sample = *it;
+        sample->offset = (off_t)offset;
+        offset += sample->nb_data;
+    }
+
+    // Remove the mvex for MP4, and the chunk offsets which might be changed from stco to co64.
+    moov->remove(SrsMp4BoxTypeMVEX);
+
+    SrsMp4MovieHeaderBox* mvhd = moov->mvhd();
+    if (!mvhd) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "no mvhd");
+    }
+    mvhd->duration_in_tbn = 0;
+
+    for (int i = 0; i < 2; i++) {
+        SrsMp4TrackBox* trak = (i == 0) ? moov->video() : moov->audio();
+        if (!trak || !trak->stbl() || !trak->mdhd() || !trak->tkhd()) {
+            continue;
+        }
+
+        trak->stbl()->remove(SrsMp4BoxTypeSTCO);
+        trak->stbl()->remove(SrsMp4BoxTypeCO64);
+
+        uint64_t duration = (i == 0) ? vend - vstart : aend - astart;
+        trak->mdhd()->duration = duration;
+
+        uint32_t tbn = trak->mdhd()->timescale ? trak->mdhd()->timescale : 1000;
+        trak->tkhd()->duration = duration * mvhd->timescale / tbn;
+        mvhd->duration_in_tbn = srs_max(mvhd->duration_in_tbn, trak->tkhd()->duration);
+    }
+
+    if ((err = samples->write(moov)) != srs_success) {
+        return srs_error_wrap(err, "write samples");
+    }
+
+    return err;
+}
+
+srs_error_t SrsFmp4Defragmenter::copy(uint64_t max, bool* done)
+{
+    srs_error_t err = srs_success;
+
+    int nb_samples = (int)samples->samples.size();
+
+    uint64_t nb_copied = 0;
+    while (nb_copied < max) {
+        // Start the next run of continuous samples, generally all samples of a traf.
+        if (!copy_left) {
+            if (copy_index >= nb_samples) {
+                break;
+            }
+
+            off_t start = offsets.at(copy_index);
+            for (; copy_index < nb_samples && offsets.at(copy_index) == (off_t)(start + copy_left); copy_index++) {
+                copy_left += samples->samples.at(copy_index)->nb_data;
+            }
+
+            if ((err = rsio->lseek(start, SEEK_SET, NULL)) != srs_success) {
+                return srs_error_wrap(err, "seek to %" PRId64, start);
+            }
+        }
+
+        uint64_t size = srs_min(copy_left, max - nb_copied);
+        ssize_t nread = 0;
+        if ((err = rsio->read(copy_buf, (size_t)srs_min(size, (uint64_t)SRS_MP4_COPY_BUF_SIZE), &nread)) != srs_success) {
+            return srs_error_wrap(err, "read sample");
+        }
+
+        if ((err = writer->write(copy_buf, nread, NULL)) != srs_success) {
+            return srs_error_wrap(err, "write sample");
+        }
+
+        copy_left -= nread;
+        nb_copied += nread;
+    }
+
+    *done = !copy_left && copy_index >= nb_samples;
+
+    return err;
+}
+
+// Write the sample table of track for the samples from the start index, the offset of sample in file is
+// shifted from begin to the mdat_offset, returns the duration in tbn of the first sample.
+static uint64_t srs_mp4_vod_write_stbl(SrsMp4SampleTableBox* stbl, vector<SrsMp4VodSample>& samples, int start,
+    uint64_t begin, uint64_t mdat_offset, bool is_video)
+{
+    int nb_samples = (int)samples.size() - start;
+
+    bool has_cts = false;
+    bool has_co64 = false;
+    for (int i = start; i < (int)samples.size(); i++) {
+        SrsMp4VodSample& v = samples.at(i);
+        has_cts = has_cts || (is_video && v.cts != 0);
+        has_co64 = has_co64 || v.offset - begin + mdat_offset >= UINT32_MAX;
+    }
+
+    SrsMp4DecodingTime2SampleBox* stts = new SrsMp4DecodingTime2SampleBox();
+    stbl->set_stts(stts);
+
+    SrsMp4SyncSampleBox* stss = NULL;
+    if (is_video) {
+        stss = new SrsMp4SyncSampleBox();
+        stbl->set_stss(stss);
+    }
+
+    SrsMp4CompositionTime2SampleBox* ctts = NULL;
+    if (has_cts) {
+        ctts = new SrsMp4CompositionTime2SampleBox();
+        stbl->set_ctts(ctts);
+    } else {
+        stbl->remove(SrsMp4BoxTypeCTTS);
+    }
+
+    SrsMp4Sample2ChunkBox* stsc = new SrsMp4Sample2ChunkBox();
+    stbl->set_stsc(stsc);
+
+    stsc->entry_count = 1;
+    stsc->entries = new SrsMp4StscEntry[1];
+    stsc->entries[0].first_chunk = stsc->entries[0].sample_description_index = stsc->entries[0].samples_per_chunk = 1;
+
+    SrsMp4SampleSizeBox* stsz = new SrsMp4SampleSizeBox();
+    stbl->set_stsz(stsz);
+
+    stsz->sample_size = 0;
+    stsz->sample_count = (uint32_t)nb_samples;
+    stsz->entry_sizes = new uint32_t[nb_samples];
+
+    // Each sample is a chunk, so the chunk offsets are the offsets of samples.
+    SrsMp4ChunkOffsetBox* stco = NULL;
+    SrsMp4ChunkLargeOffsetBox* co64 = NULL;
+    stbl->remove(SrsMp4BoxTypeSTCO);
+    stbl->remove(SrsMp4BoxTypeCO64);
+    if (!has_co64) {
+        stco = new SrsMp4ChunkOffsetBox();
+        stco->entry_count = (uint32_t)nb_samples;
+        stco->entries = new uint32_t[nb_samples];
+        stbl->set_stco(stco);
+    } else {
+        co64 = new SrsMp4ChunkLargeOffsetBox();
+        co64->entry_count = (uint32_t)nb_samples;
+        co64->entries = new uint64_t[nb_samples];
+        stbl->set_co64(co64);
+    }
+
+    SrsMp4SttsEntry stts_entry;
+    SrsMp4CttsEntry ctts_entry;
+    vector<uint32_t> stss_entries;
+
+    for (int i = start; i < (int)samples.size(); i++) {
+        SrsMp4VodSample& v = samples.at(i);
+        int index = i - start;
+
+        stsz->entry_sizes[index] = v.nb_data;
+
+        uint64_t offset = v.offset - begin + mdat_offset;
+        if (stco) {
+            stco->entries[index] = (uint32_t)offset;
+        } else {
+            co64->entries[index] = offset;
+        }
+
+        if (stss && v.keyframe) {
+            stss_entries.push_back(index + 1);
+        }
+
+        // The first sample always in the STTS table.
+        if (index > 0) {
+            uint32_t delta = (uint32_t)(v.dts - samples.at(i - 1).dts);
+            if (stts_entry.sample_delta != 0 && stts_entry.sample_delta != delta) {
+                stts->entries.push_back(stts_entry);
+                stts_entry.sample_count = 0;
+            }
+            stts_entry.sample_delta = delta;
+        }
+        stts_entry.sample_count++;
+
+        if (ctts) {
+            if (v.cts < 0) {
+                ctts->version = 0x01;
+            }
+            if (ctts_entry.sample_count != 0 && ctts_entry.sample_offset != v.cts) {
+                ctts->entries.push_back(ctts_entry);
+                ctts_entry.sample_count = 0;
+            }
+            ctts_entry.sample_offset = v.cts;
+            ctts_entry.sample_count++;
+        }
+    }
+
+    if (stts_entry.sample_count) {
+        stts->entries.push_back(stts_entry);
+    }
+    if (ctts && ctts_entry.sample_count) {
+        ctts->entries.push_back(ctts_entry);
+    }
+
+    if (stss && !stss_entries.empty()) {
+        stss->entry_count = (uint32_t)stss_entries.size();
+        stss->sample_numbers = new uint32_t[stss->entry_count];
+        for (int i = 0; i < (int)stss->entry_count; i++) {
+            stss->sample_numbers[i] = stss_entries.at(i);
+        }
+    }
+
+    return samples.at(start).dts;
+}
+
+SrsMp4VodIndex::SrsMp4VodIndex()
+{
+    ftyp_ = NULL;
+    nb_ftyp_ = 0;
+    moov_ = NULL;
+    nb_moov_ = 0;
+    vtbn_ = atbn_ = 0;
+    vduration_ = aduration_ = 0;
+    duration_ = 0;
+}
+
+SrsMp4VodIndex::~SrsMp4VodIndex()
+{
+    srs_freepa(ftyp_);
+    srs_freep(moov_);
+}
+
+srs_error_t SrsMp4VodIndex::initialize(ISrsReadSeeker* rs)
+{
+    srs_error_t err = srs_success;
+
+    off_t filesize = 0;
+    if ((err = rs->lseek(0, SEEK_END, &filesize)) != srs_success) {
+        return srs_error_wrap(err, "seek to end");
+    }
+    if ((err = rs->lseek(0, SEEK_SET, NULL)) != srs_success) {
+        return srs_error_wrap(err, "seek to start");
+    }
+
+    SrsMp4BoxReader br;
+    if ((err = br.initialize(rs)) != srs_success) {
+        return srs_error_wrap(err, "init box reader");
+    }
+
+    SrsSimpleStream stream;
+
+    // Only read the ftyp and moov, skip the content of mdat.
+    off_t offset = 0;
+    while (offset < filesize && (!ftyp_ || !moov_)) {
+        SrsMp4Box* box = NULL;
+        SrsAutoFree(SrsMp4Box, box);
+
+        if ((err = br.read(&stream, &box)) != srs_success) {
+            return srs_error_wrap(err, "read box at %" PRId64, offset);
+        }
+
+        SrsBuffer* buffer = new SrsBuffer(stream.bytes(), stream.length());
+        SrsAutoFree(SrsBuffer, buffer);
+
+        if ((err = box->decode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "decode box at %" PRId64, offset);
+        }
+
+        uint64_t size = box->sz();
+        if (size == 0) {
+            break;
+        }
+
+        if (box->type == SrsMp4BoxTypeFTYP && !ftyp_) {
+            nb_ftyp_ = (int)size;
+            ftyp_ = new char[nb_ftyp_];
+            memcpy(ftyp_, stream.bytes(), nb_ftyp_);
+        } else if (box->is_moov() && !moov_) {
+            moov_ = dynamic_cast<SrsMp4MovieBox*>(box);
+            box = NULL;
+        }
+
+        offset += (off_t)size;
+        if (box && box->is_mdat()) {
+            stream.erase(stream.length());
+            if (offset < filesize && (err = rs->lseek(offset, SEEK_SET, NULL)) != srs_success) {
+                return srs_error_wrap(err, "seek to %" PRId64, offset);
+            }
+        } else {
+            stream.erase((int)size);
+        }
+    }
+
+    if (!ftyp_) {
+        return srs_error_new(ERROR_MP4_BOX_ILLEGAL_SCHEMA, "no ftyp");
+    }
+    if (!moov_) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "no moov");
+    }
+    if (moov_->get(SrsMp4BoxTypeMVEX)) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "not support fragmented mp4");
+    }
+
+    SrsMp4MovieHeaderBox* mvhd = moov_->mvhd();
+    if (!mvhd) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "no mvhd");
+    }
+    if (mvhd->timescale) {
+        duration_ = (srs_utime_t)(mvhd->duration() * SRS_UTIME_MILLISECONDS);
+    }
+
+    SrsMp4TrackBox* vide = moov_->video();
+    if (vide && vide->mdhd()) {
+        vtbn_ = vide->mdhd()->timescale;
+        vduration_ = vide->mdhd()->duration;
+    }
+
+    SrsMp4TrackBox* soun = moov_->audio();
+    if (soun && soun->mdhd()) {
+        atbn_ = soun->mdhd()->timescale;
+        aduration_ = soun->mdhd()->duration;
+    }
+
+    // Convert the samples to compact index, then free the samples.
+    if (true) {
+        SrsMp4SampleManager sm;
+        if ((err = sm.load(moov_)) != srs_success) {
+            return srs_error_wrap(err, "load samples");
+        }
+
+        for (int i = 0; i < (int)sm.samples.size(); i++) {
+            SrsMp4Sample* sample = sm.samples.at(i);
+
+            SrsMp4VodSample v;
+            v.offset = (uint64_t)sample->offset;
+            v.dts = sample->dts;
+            v.cts = (int32_t)(sample->pts - sample->dts);
+            v.nb_data = sample->nb_data;
+            v.keyframe = sample->frame_type == SrsVideoAvcFrameTypeKeyFrame;
+
+            if (sample->type == SrsFrameTypeVideo) {
+                if (v.keyframe) {
+                    keyframes_.push_back((uint32_t)videos_.size());
+                }
+                videos_.push_back(v);
+            } else {
+                audios_.push_back(v);
+            }
+        }
+    }
+
+    if (videos_.empty() && audios_.empty()) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_SAMPLES, "no samples");
+    }
+
+    // The sample tables are kept in the flat arrays, so remove them from moov to save memory.
+    for (int i = 0; i < 2; i++) {
+        SrsMp4TrackBox* trak = (i == 0) ? vide : soun;
+        SrsMp4SampleTableBox* stbl = trak ? trak->stbl() : NULL;
+        if (!stbl) {
+            continue;
+        }
+
+        stbl->remove(SrsMp4BoxTypeSTTS);
+        stbl->remove(SrsMp4BoxTypeCTTS);
+        stbl->remove(SrsMp4BoxTypeSTSS);
+        stbl->remove(SrsMp4BoxTypeSTSC);
+        stbl->remove(SrsMp4BoxTypeSTSZ);
+        stbl->remove(SrsMp4BoxTypeSTCO);
+        stbl->remove(SrsMp4BoxTypeCO64);
+    }
+    nb_moov_ = (int)moov_->nb_bytes();
+
+    return err;
+}
+
+srs_error_t SrsMp4VodIndex::seek(srs_utime_t start, SrsSimpleStream* header, uint64_t* poffset, uint64_t* psize)
+{
+    srs_error_t err = srs_success;
+
+    uint64_t start_ms = (uint64_t)(start / SRS_UTIME_MILLISECONDS);
+
+    // Start from the video keyframe, and the audio starts from the keyframe for A/V sync. The video is
+    // dropped if no keyframe.
+    int vstart = find_keyframe(start_ms);
+    if (vstart < 0) {
+        vstart = (int)videos_.size();
+    }
+
+    uint64_t seek_ms = (vstart < (int)videos_.size()) ? videos_.at(vstart).dts * 1000 / vtbn_ : start_ms;
+    int astart = find_audio(atbn_ ? seek_ms * atbn_ / 1000 : 0);
+
+    // The range of samples to keep in file.
+    uint64_t begin = 0, end = 0;
+    bool has_samples = false;
+    for (int i = 0; i < 2; i++) {
+        vector<SrsMp4VodSample>& samples = (i == 0) ? videos_ : audios_;
+        for (int j = (i == 0) ? vstart : astart; j < (int)samples.size(); j++) {
+            SrsMp4VodSample& v = samples.at(j);
+            begin = has_samples ? srs_min(begin, v.offset) : v.offset;
+            end = srs_max(end, v.offset + v.nb_data);
+            has_samples = true;
+        }
+    }
+
+    if (!has_samples) {
+        return srs_error_new(ERROR_MP4_ILLEGAL_SAMPLES, "seek %" PRId64 "ms overflow", start_ms);
+    }
+
+    SrsMp4MediaDataBox* mdat = new SrsMp4MediaDataBox();
+    SrsAutoFree(SrsMp4MediaDataBox, mdat);
+
+    mdat->nb_data = end - begin;
+    mdat->update_size();
+
+    // The chunk offsets depends on the size of moov, which depends on the chunk offsets, because stco might
+    // be changed to co64, so we update it until the size is stable.
+    uint64_t moov_bytes = 0;
+    for (int i = 0;; i++) {
+        if (i >= 4) {
+            return srs_error_new(ERROR_MP4_ILLEGAL_MOOV, "unstable moov size %" PRId64, moov_bytes);
+        }
+
+        build_moov(vstart, astart, begin, nb_ftyp_ + moov_bytes + mdat->sz_header());
+
+        uint64_t nb_bytes = moov_->nb_bytes();
+        if (nb_bytes == moov_bytes) {
+            break;
+        }
+        moov_bytes = nb_bytes;
+    }
+
+    // Write the ftyp, moov and header of mdat.
+    int nb_header = (int)(moov_bytes + mdat->sz_header());
+    char* data = new char[nb_header];
+    SrsAutoFreeA(char, data);
+
+    if (true) {
+        SrsBuffer* buffer = new SrsBuffer(data, nb_header);
+        SrsAutoFree(SrsBuffer, buffer);
+
+        if ((err = moov_->encode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "encode moov");
+        }
+        if ((err = mdat->encode(buffer)) != srs_success) {
+            return srs_error_wrap(err, "encode mdat");
+        }
+    }
+
+    header->append(ftyp_, nb_ftyp_);
+    header->append(data, nb_header);
+
+    *poffset = begin;
+    *psize = end - begin;
+
+    return err;
+}
+
+srs_utime_t SrsMp4VodIndex::duration()
+{
+    return duration_;
+}
+
+int SrsMp4VodIndex::nb_samples()
+{
+    return (int)(videos_.size() + audios_.size());
+}
+
+int64_t SrsMp4VodIndex::nb_bytes()
+{
+    int64_t nb_samples = (int64_t)((videos_.size() + audios_.size()) * sizeof(SrsMp4VodSample));
+    return nb_ftyp_ + nb_moov_ + nb_samples + (int64_t)(keyframes_.size() * sizeof(uint32_t));
+}
+
+int SrsMp4VodIndex::find_keyframe(uint64_t start_ms)
+{
+    if (!vtbn_ || keyframes_.empty()) {
+        return -1;
+    }
+
+    // Binary search the last keyframe at or before the start time.
+    int left = 0, right = (int)keyframes_.size();
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (videos_.at(keyframes_.at(mid)).dts * 1000 / vtbn_ <= start_ms) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+
+    return keyframes_.at(left > 0 ? left - 1 : 0);
+}
+
+int SrsMp4VodIndex::find_audio(uint64_t dts)
+{
+    // Binary search the first sample at or after the dts.
+    int left = 0, right = (int)audios_.size();
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (audios_.at(mid).dts < dts) {
+            left = mid + 1;
+        } else {
+            right = mid;
+        }
+    }
+
+    return left;
+}
+
+void SrsMp4VodIndex::build_moov(int vstart, int astart, uint64_t begin, uint64_t mdat_offset)
+{
+    SrsMp4MovieHeaderBox* mvhd = moov_->mvhd();
+
+    // The duration of track is shorten by the start time, because the stts only contains the delta of dts.
+    uint64_t duration = 0;
+    for (int i = 0; i < 2; i++) {
+        SrsMp4TrackBox* trak = (i == 0) ? moov_->video() : moov_->audio();
+        if (!trak || !trak->stbl() || !trak->mdhd() || !trak->tkhd()) {
+            continue;
+        }
+
+        vector<SrsMp4VodSample>& samples = (i == 0) ? videos_ : audios_;
+        int start = (i == 0) ? vstart : astart;
+        uint64_t total = (i == 0) ? vduration_ : aduration_;
+
+        // Always rebuild the sample table, because the moov is reused by each seeking.
+        uint64_t first = 0;
+        if (start < (int)samples.size()) {
+            first = srs_mp4_vod_write_stbl(trak->stbl(), samples, start, begin, mdat_offset, i == 0);
+        } else {
+            SrsMp4SampleTableBox* stbl = trak->stbl();
+            stbl->set_stts(new SrsMp4DecodingTime2SampleBox());
+            stbl->remove(SrsMp4BoxTypeCTTS);
+            stbl->remove(SrsMp4BoxTypeSTSS);
+            stbl->set_stsc(new SrsMp4Sample2ChunkBox());
+            stbl->set_stsz(new SrsMp4SampleSizeBox());
+            stbl->remove(SrsMp4BoxTypeCO64);
+            stbl->set_stco(new SrsMp4ChunkOffsetBox());
+            first = total;
+        }
+
+        SrsMp4MediaHeaderBox* mdhd = trak->mdhd();
+        mdhd->duration = (total > first) ? total - first : 0;
+
+        uint32_t tbn = mdhd->timescale ? mdhd->timescale : 1000;
+        trak->tkhd()->duration = mdhd->duration * mvhd->timescale / tbn;
+        duration = srs_max(duration, trak->tkhd()->duration);
+    }
+    mvhd->duration_in_tbn = duration;
+}
@@ -316,6 +316,12 @@ public:
     // Get the traf.
     virtual SrsMp4TrackFragmentBox* traf();
     virtual void set_traf(SrsMp4TrackFragmentBox* v);
+    // Add a traf, for moof contains more than one track.
+    virtual void add_traf(SrsMp4TrackFragmentBox* v);
+    // Get the number of trafs.
+    virtual int nb_trafs();
+    // Get the traf at index, NULL if exceed.
+    virtual SrsMp4TrackFragmentBox* traf_at(int index);
 };
 
 // 8.8.5 Movie Fragment Header Box (mfhd)
@@ -2133,6 +2139,190 @@ public:
     virtual srs_error_t flush(uint64_t& dts);
 };
 
+// The fragmented MP4 muxer, to write a fMP4 file, for example, for DVR. It writes the ftyp and
+// moov(with mvex) once, then a moof and mdat for each fragment, so only samples of the current
+// fragment are kept in memory, and the file is always playable to the last fragment even if
+// the server crashes.
+class SrsFmp4Encoder
+{
+private:
+    ISrsWriter* writer;
+    // The duration of each fragment in ms.
+    uint32_t fragment;
+    // The sequence number of moof, starts from 1.
+    uint32_t sequence_number;
+    // Whether the ftyp and moov is written.
+    bool moov_written;
+    // The samples of current fragment, with data copied.
+    SrsMp4SampleManager* samples;
+    // The size of samples of current fragment, for video and audio.
+    uint64_t vbytes;
+    uint64_t abytes;
+public:
+    // The audio codec of first track, generally there is zero or one track.
+    // Forbidden if no audio stream.
+    SrsAudioCodecId acodec;
+    // The audio sample rate.
+    SrsAudioSampleRate sample_rate;
+    // The audio sound bits.
+    SrsAudioSampleBits sound_bits;
+    // The audio sound type.
+    SrsAudioChannels channels;
+private:
+    // For AAC, the asc in esds box.
+    std::vector<char> pasc;
+    // The number of audio samples, and the duration of last audio sample.
+    uint32_t nb_audios;
+    uint32_t adelta;
+    // The track id of audio, 0 if no audio track in moov.
+    uint32_t atid;
+public:
+    // The video codec of first track, generally there is zero or one track.
+    // Forbidden if no video stream.
+    SrsVideoCodecId vcodec;
+private:
+    // For H.264/AVC, the avcc contains the sps/pps.
+    std::vector<char> pavcc;
+    // The number of video samples, and the duration of last video sample.
+    uint32_t nb_videos;
+    uint32_t vdelta;
+    // The track id of video, 0 if no video track in moov.
+    uint32_t vtid;
+    // The size width/height of video.
+    uint32_t width;
+    uint32_t height;
+public:
+    SrsFmp4Encoder();
+    virtual ~SrsFmp4Encoder();
+public:
+    // Initialize the encoder with a writer w.
+    // @param fragment The duration of each fragment.
+    virtual srs_error_t initialize(ISrsWriter* w, srs_utime_t fragment);
+    // Write a sample to fMP4, see SrsMp4Encoder::write_sample.
+    // @remark The fragment is flushed when the duration exceed, at a video keyframe if possible.
+    virtual srs_error_t write_sample(SrsFormat* format, SrsMp4HandlerType ht, uint16_t ft, uint16_t ct,
+        uint32_t dts, uint32_t pts, uint8_t* sample, uint32_t nb_sample);
+    // Flush the encoder, to write the last fragment.
+    virtual srs_error_t flush();
+private:
+    virtual srs_error_t copy_sequence_header(SrsFormat* format, bool vsh, uint8_t* sample, uint32_t nb_sample);
+    virtual srs_error_t write_moov();
+    virtual srs_error_t write_fragment();
+    virtual SrsMp4TrackFragmentBox* create_traf(SrsFrameType track, uint32_t tid);
+    virtual SrsMp4ObjectType get_audio_object_type();
+};
+
+// Convert a fragmented MP4, for example, written by SrsFmp4Encoder, to a normal MP4 with moov
+// before mdat, which is also known as faststart. Only the sample index is kept in memory, while
+// the sample data is copied from reader to writer. A truncated fragment at the end of file, for
+// example, left by crash, is ignored.
+class SrsFmp4Defragmenter
+{
+private:
+    ISrsReadSeeker* rsio;
+    ISrsWriter* writer;
+    SrsMp4BoxReader* br;
+    SrsSimpleStream* stream;
+    // The moov of fMP4, to build the moov of MP4.
+    SrsMp4MovieBox* moov;
+    // The samples of all fragments, the offset is in the output file.
+    SrsMp4SampleManager* samples;
+    // The offset of samples in the input file.
+    std::vector<off_t> offsets;
+    // The number of samples, and the time range of samples, for video and audio track.
+    uint32_t nb_videos;
+    uint32_t nb_audios;
+    uint64_t vstart;
+    uint64_t vend;
+    uint64_t astart;
+    uint64_t aend;
+    // The buffer and the cursor to copy samples, the index of next sample and the left bytes of current run.
+    char* copy_buf;
+    int copy_index;
+    uint64_t copy_left;
+public:
+    SrsFmp4Defragmenter();
+    virtual ~SrsFmp4Defragmenter();
+public:
+    // Initialize the defragmenter with reader and writer, user must manage them.
+    virtual srs_error_t initialize(ISrsReadSeeker* rs, ISrsWriter* w);
+    // Read all fragments from reader, and write MP4 to writer.
+    virtual srs_error_t defragment();
+    // Read all fragments from reader, and write the ftyp, moov and header of mdat to writer. Then user should
+    // copy the samples by copy until done, so it's able to yield between copies for a large file.
+    virtual srs_error_t start();
+    // Copy at most max bytes of samples to writer, set done to true when all samples are copied.
+    virtual srs_error_t copy(uint64_t max, bool* done);
+private:
+    virtual srs_error_t parse(off_t filesize);
+    virtual srs_error_t parse_moof(SrsMp4MovieFragmentBox* moof, off_t offset, off_t filesize, bool* truncated);
+    virtual void interleave();
+    virtual srs_error_t write_moov(uint64_t mdat_offset);
+};
+
+// The compact index of a sample of MP4 VOD, which is much smaller than SrsMp4Sample.
+struct SrsMp4VodSample
+{
+    // The offset of sample in file.
+    uint64_t offset;
+    // The dts in tbn.
+    uint64_t dts;
+    // The pts minus dts in tbn, for video only.
+    int32_t cts;
+    // The size of sample.
+    uint32_t nb_data;
+    // Whether video keyframe.
+    bool keyframe;
+};
+
+// The index of a progressive MP4 file for VOD, which parses the moov only once, and keeps the samples in
+// flat arrays, to serve the time-based seeking by binary search and generating a trimmed moov on the fly,
+// so we never parse the file or decode the moov again for each request.
+class SrsMp4VodIndex
+{
+private:
+    // The raw ftyp box, to build the trimmed MP4 header.
+    char* ftyp_;
+    int nb_ftyp_;
+    // The decoded moov box without sample tables, which are rebuilt for each seeking.
+    SrsMp4MovieBox* moov_;
+    int nb_moov_;
+    // The samples of video and audio track, in file order which is also the decoding order.
+    std::vector<SrsMp4VodSample> videos_;
+    std::vector<SrsMp4VodSample> audios_;
+    // The index in videos_ of each video keyframe.
+    std::vector<uint32_t> keyframes_;
+    // The tbn and duration in tbn of video and audio track.
+    uint32_t vtbn_;
+    uint32_t atbn_;
+    uint64_t vduration_;
+    uint64_t aduration_;
+    // The duration of file.
+    srs_utime_t duration_;
+public:
+    SrsMp4VodIndex();
+    virtual ~SrsMp4VodIndex();
+public:
+    // Parse the ftyp and moov of MP4 file, user must manage the reader.
+    virtual srs_error_t initialize(ISrsReadSeeker* rs);
+    // Seek to the keyframe at or before the start time, and build the trimmed MP4 header to header, which
+    // consists of ftyp, moov and mdat header, while the content of mdat is the range of file in
+    // [*poffset, *poffset + *psize).
+    // @remark It's in memory and reuses the moov of index, never yield the coroutine.
+    virtual srs_error_t seek(srs_utime_t start, SrsSimpleStream* header, uint64_t* poffset, uint64_t* psize);
+public:
+    virtual srs_utime_t duration();
+    virtual int nb_samples();
+    // The bytes of index in memory.
+    virtual int64_t nb_bytes();
+private:
+    // Find the index in videos_ of keyframe at or before the start time, or the first keyframe.
+    virtual int find_keyframe(uint64_t start_ms);
+    // Find the index in audios_ of the first sample at or after the dts.
+    virtual int find_audio(uint64_t dts);
+    virtual void build_moov(int vstart, int astart, uint64_t begin, uint64_t mdat_offset);
+};
+
 // LCOV_EXCL_START
 /////////////////////////////////////////////////////////////////////////////////
 // MP4 dumps functions.
@@ -8,6 +8,7 @@
 
 #include <srs_kernel_error.hpp>
 #include <srs_kernel_log.hpp>
+#include <srs_kernel_utility.hpp>
 
 #include <arpa/inet.h>
 using namespace std;
@@ -692,6 +693,11 @@ SrsRtcpTWCC::SrsRtcpTWCCChunk::SrsRtcpTWCCChunk()
 
 SrsRtcpTWCC::SrsRtcpTWCC(uint32_t sender_ssrc) : pkt_len(0)
 {
+    recv_ts_ = NULL;
+    recv_bits_ = NULL;
+    recv_base_sn_ = recv_high_sn_ = 0;
+    nn_recv_ = 0;
+
     header_.padding = 0;
     header_.type = SrsRtcpType_rtpfb;
     header_.rc = 15;
@@ -701,20 +707,45 @@ SrsRtcpTWCC::SrsRtcpTWCC(uint32_t sender_ssrc) : pkt_len(0)
     base_sn_ = 0;
     reference_time_ = 0;
     fb_pkt_count_ = 0;
-    next_base_sn_ = 0;
 }
 
 SrsRtcpTWCC::~SrsRtcpTWCC()
 {
+    srs_freepa(recv_ts_);
+    srs_freepa(recv_bits_);
 }
 
 void SrsRtcpTWCC::clear()
 {
     encoded_chucks_.clear();
     pkt_deltas_.clear();
-    recv_packets_.clear();
-    recv_sns_.clear();
-    next_base_sn_ = 0;
+
+    if (recv_bits_) {
+        memset(recv_bits_, 0, sizeof(uint64_t) * kTwccRecvWindow / 64);
+    }
+    recv_base_sn_ = recv_high_sn_ = 0;
+    nn_recv_ = 0;
+}
+
+bool SrsRtcpTWCC::is_received(uint16_t sn)
+{
+    int index = sn & (kTwccRecvWindow - 1);
+    return (recv_bits_[index >> 6] >> (index & 63)) & 0x01;
+}
+
+void SrsRtcpTWCC::set_received(uint16_t sn, srs_utime_t ts)
+{
+    int index = sn & (kTwccRecvWindow - 1);
+    recv_bits_[index >> 6] |= (uint64_t)1 << (index & 63);
+    recv_ts_[index] = ts;
+    nn_recv_++;
+}
+
+void SrsRtcpTWCC::reset_received(uint16_t sn)
+{
+    int index = sn & (kTwccRecvWindow - 1);
+    recv_bits_[index >> 6] &= ~((uint64_t)1 << (index & 63));
+    nn_recv_--;
 }
 
 uint32_t SrsRtcpTWCC::get_media_ssrc() const
@@ -777,20 +808,54 @@ void SrsRtcpTWCC::add_recv_delta(uint16_t delta)
 
 srs_error_t SrsRtcpTWCC::recv_packet(uint16_t sn, srs_utime_t ts)
 {
-    map<uint16_t, srs_utime_t>::iterator it = recv_packets_.find(sn);
-    if(it != recv_packets_.end()) {
+    if (!recv_ts_) {
+        recv_ts_ = new srs_utime_t[kTwccRecvWindow];
+        recv_bits_ = new uint64_t[kTwccRecvWindow / 64];
+        memset(recv_bits_, 0, sizeof(uint64_t) * kTwccRecvWindow / 64);
+    }
+
+    // Start a new window, when all packets are feedback.
+    if (!nn_recv_) {
+        recv_base_sn_ = recv_high_sn_ = sn;
+        set_received(sn, ts);
+        return srs_success;
+    }
+
+    if (is_received(sn) && srs_rtp_seq_distance(recv_base_sn_, sn) >= 0 && srs_rtp_seq_distance(sn, recv_high_sn_) >= 0) {
         return srs_error_new(ERROR_RTC_RTCP, "TWCC dup seq: %d", sn);
     }
 
-    recv_packets_[sn] = ts;
-    recv_sns_.insert(sn);
+    // For the packet before window, move the base back, or drop it if window overflows.
+    if (srs_rtp_seq_distance(recv_base_sn_, sn) < 0) {
+        int window = (int)srs_rtp_seq_distance(sn, recv_base_sn_) + (int)srs_rtp_seq_distance(recv_base_sn_, recv_high_sn_);
+        if (window >= kTwccRecvWindow) {
+            return srs_error_new(ERROR_RTC_RTCP, "TWCC too old seq: %d, base=%d", sn, recv_base_sn_);
+        }
+
+        recv_base_sn_ = sn;
+        set_received(sn, ts);
+        return srs_success;
+    }
+
+    // For the packet after window, move the high, and drop the oldest packets if window overflows.
+    if (srs_rtp_seq_distance(recv_high_sn_, sn) > 0) {
+        while (srs_rtp_seq_distance(recv_base_sn_, sn) >= kTwccRecvWindow) {
+            if (is_received(recv_base_sn_)) {
+                reset_received(recv_base_sn_);
+            }
+            recv_base_sn_++;
+        }
+        recv_high_sn_ = sn;
+    }
+
+    set_received(sn, ts);
 
     return srs_success;
 }
 
 bool SrsRtcpTWCC::need_feedback()
 {
-    return recv_packets_.size() > 0;
+    return nn_recv_ > 0;
 }
 
 srs_error_t SrsRtcpTWCC::decode(SrsBuffer *buffer)
@@ -1031,7 +1096,7 @@ srs_error_t SrsRtcpTWCC::encode(SrsBuffer *buffer)
 
     err = do_encode(buffer);
 
-    if (err != srs_success || next_base_sn_ == 0) {
+    if (err != srs_success) {
         clear();
     }
 
@@ -1074,18 +1139,19 @@ srs_error_t SrsRtcpTWCC::do_encode(SrsBuffer *buffer)
         return srs_error_new(ERROR_RTC_RTCP, "requires %d bytes", nb_bytes());
     }
 
+    if (!nn_recv_) {
+        return srs_error_new(ERROR_RTC_RTCP, "no packets");
+    }
+
     pkt_len = kTwccFbPktHeaderSize;
 
-    set<uint16_t, SrsSeqCompareLess>::iterator it_sn = recv_sns_.begin();
-    if (!next_base_sn_) {
-        base_sn_ = *it_sn;
-    } else {
-        base_sn_ = next_base_sn_;
-        it_sn = recv_sns_.find(base_sn_);
+    // The base is the first received packet, in the window.
+    while (!is_received(recv_base_sn_)) {
+        recv_base_sn_++;
     }
+    base_sn_ = recv_base_sn_;
 
-    map<uint16_t, srs_utime_t>::iterator it_ts = recv_packets_.find(base_sn_);
-    srs_utime_t ts = it_ts->second;
+    srs_utime_t ts = recv_ts_[base_sn_ & (kTwccRecvWindow - 1)];
 
     reference_time_ = (ts % kTwccFbReferenceTimeDivisor) / kTwccFbTimeMultiplier;
     srs_utime_t last_ts = (srs_utime_t)(reference_time_) * kTwccFbTimeMultiplier;
@@ -1095,30 +1161,30 @@ srs_error_t SrsRtcpTWCC::do_encode(SrsBuffer *buffer)
 
     // encode chunk
     SrsRtcpTWCC::SrsRtcpTWCCChunk chunk;
-    for(; it_sn != recv_sns_.end(); ++it_sn) {
+    uint16_t current_sn = base_sn_;
+    for(; srs_rtp_seq_distance(current_sn, recv_high_sn_) >= 0; ++current_sn) {
         // check whether exceed buffer len
         // max recv_delta_size = 2
         if (pkt_len + 2 >= buffer->left()) {
             break;
         }
 
-        uint16_t current_sn = *it_sn;
-        // calculate delta
-        it_ts = recv_packets_.find(current_sn);
-        if (it_ts == recv_packets_.end()) {
+        // The lost packets are encoded with the next received packet.
+        if (!is_received(current_sn)) {
             continue;
         }
 
+        // calculate delta
         packet_count++;
-        srs_utime_t delta_us = calculate_delta_us(it_ts->second, last_ts);
+        srs_utime_t delta_us = calculate_delta_us(recv_ts_[current_sn & (kTwccRecvWindow - 1)], last_ts);
         int16_t delta = delta_us;
         if(delta != delta_us) {
             return srs_error_new(ERROR_RTC_RTCP, "twcc: delta:%" PRId64 ", exceeds the 16bits", delta_us);
         }
 
-        if(current_sn > (last_sn + 1)) {
+        if(srs_rtp_seq_distance(last_sn, current_sn) > 1) {
             // lost packet
-            for(uint16_t lost_sn = last_sn + 1; lost_sn < current_sn; ++lost_sn) {
+            for(uint16_t lost_sn = last_sn + 1; lost_sn != current_sn; ++lost_sn) {
                 process_pkt_chunk(chunk, 0);
                 packet_count++;
             }
@@ -1135,13 +1201,11 @@ srs_error_t SrsRtcpTWCC::do_encode(SrsBuffer *buffer)
         pkt_len += recv_delta_size;
         last_sn = current_sn;
 
-        recv_packets_.erase(it_ts);
+        reset_received(current_sn);
     }
 
-    next_base_sn_ = 0;
-    if (it_sn != recv_sns_.end()) {
-        next_base_sn_ = *it_sn;
-    }
+    // The left packets are feedback in next packet.
+    recv_base_sn_ = current_sn;
 
     if(0 < chunk.size) {
         if((err = encode_remaining_chunk(chunk)) != srs_success) {
@@ -1176,7 +1240,8 @@ srs_error_t SrsRtcpTWCC::do_encode(SrsBuffer *buffer)
         buffer->write_2bytes(*it);
     }
 
-    required_size = pkt_deltas_.size() * 2;
+    // The small delta is 1 byte, while large or negative delta is 2 bytes.
+    required_size = pkt_len - kTwccFbPktHeaderSize - encoded_chucks_.size() * 2;
     if(!buffer->require(required_size)) {
         return srs_error_new(ERROR_RTC_RTCP, "pkt_deltas_[%d] requires %d bytes", (int)pkt_deltas_.size(), required_size);
     }
@@ -1203,6 +1268,138 @@ srs_error_t SrsRtcpTWCC::do_encode(SrsBuffer *buffer)
     return err;
 }
 
+srs_error_t srs_rtcp_parse_twcc(char* data, int nb_data, vector<SrsTwccPacketStatus>& status)
+{
+    srs_error_t err = srs_success;
+
+    // The RTCP header, SSRC of packet sender and media source, then the base sequence number,
+    // packet status count, reference time and fb pkt count, see SrsRtcpTWCC::decode.
+    if (nb_data < kTwccFbPktHeaderSize) {
+        return srs_error_new(ERROR_RTC_RTCP, "twcc requires %d, only %d bytes", kTwccFbPktHeaderSize, nb_data);
+    }
+
+    // Never parse the next packet of compound RTCP.
+    SrsBuffer buf(data, nb_data);
+    buf.skip(2);
+    int nb_pkt = (buf.read_2bytes() + 1) * 4;
+    if (nb_pkt < kTwccFbPktHeaderSize || nb_pkt > nb_data) {
+        return srs_error_new(ERROR_RTC_RTCP, "twcc invalid size %d of %d bytes", nb_pkt, nb_data);
+    }
+    SrsBuffer buffer(data, nb_pkt);
+    buffer.skip(12);
+
+    uint16_t base_sn = buffer.read_2bytes();
+    int nn_status = (uint16_t)buffer.read_2bytes();
+    int32_t reference_time = buffer.read_3bytes();
+    buffer.skip(1);
+
+    // The symbol of each packet, by run length chunks or status vector chunks.
+    size_t start = status.size();
+    while ((int)(status.size() - start) < nn_status) {
+        if (!buffer.require(kTwccFbChunkBytes)) {
+            return srs_error_new(ERROR_RTC_RTCP, "twcc require chunk, status %d/%d", (int)(status.size() - start), nn_status);
+        }
+
+        uint16_t chunk = buffer.read_2bytes();
+        int left = nn_status - (int)(status.size() - start);
+
+        // The run length chunk, T=0, S=2bits, Run Length=13bits.
+        if ((chunk & 0x8000) == 0) {
+            uint8_t symbol = (chunk >> 13) & 0x03;
+            int run = srs_min(chunk & kTwccFbMaxRunLength, left);
+            for (int i = 0; i < run; i++) {
+                SrsTwccPacketStatus v;
+                v.sn = base_sn + (uint16_t)(status.size() - start);
+                v.received = (symbol == 1 || symbol == 2);
+                v.arrival = symbol;
+                status.push_back(v);
+            }
+            continue;
+        }
+
+        // The status vector chunk, T=1, S=0 for 14 one bit symbols, S=1 for 7 two bits symbols.
+        bool two_bits = (chunk & 0x4000);
+        int nn_symbols = srs_min(two_bits ? kTwccFbTwoBitElements : kTwccFbOneBitElements, left);
+        for (int i = 0; i < nn_symbols; i++) {
+            uint8_t symbol;
+            if (two_bits) {
+                symbol = (chunk >> (2 * (kTwccFbTwoBitElements - 1 - i))) & 0x03;
+            } else {
+                symbol = (chunk >> (kTwccFbOneBitElements - 1 - i)) & 0x01;
+            }
+
+            SrsTwccPacketStatus v;
+            v.sn = base_sn + (uint16_t)(status.size() - start);
+            v.received = (symbol == 1 || symbol == 2);
+            v.arrival = symbol;
+            status.push_back(v);
+        }
+    }
+
+    // The recv delta of each received packet, 1 byte for small delta, 2 bytes for large or negative
+    // delta, in multiple of 250us. We use the arrival as symbol before parsing the delta.
+    int64_t arrival = (int64_t)reference_time * kTwccFbTimeMultiplier;
+    for (size_t i = start; i < status.size(); i++) {
+        SrsTwccPacketStatus& v = status[i];
+        if (!v.received) {
+            continue;
+        }
+
+        int nb_delta = (v.arrival == 1) ? 1 : kTwccFbLargeRecvDeltaBytes;
+        if (!buffer.require(nb_delta)) {
+            return srs_error_new(ERROR_RTC_RTCP, "twcc require delta %d bytes, sn=%u", nb_delta, v.sn);
+        }
+
+        int64_t delta = (nb_delta == 1) ? (uint8_t)buffer.read_1bytes() : (int16_t)buffer.read_2bytes();
+        arrival += delta * kTwccFbDeltaUnit;
+        v.arrival = arrival;
+    }
+
+    return err;
+}
+
+srs_error_t srs_rtcp_parse_remb(char* data, int nb_data, uint64_t& bitrate)
+{
+    /*
+    @doc: https://datatracker.ietf.org/doc/html/draft-alvestrand-rmcat-remb-03#section-2.2
+     0                   1                   2                   3
+     0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |V=2|P| FMT=15  |   PT=206      |             length            |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |                  SSRC of packet sender                        |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |                  SSRC of media source                         |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |  Unique identifier 'R' 'E' 'M' 'B'                            |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |  Num SSRC     | BR Exp    |  BR Mantissa                      |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    |   SSRC feedback                                               |
+    +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    */
+    if (nb_data < 20) {
+        return srs_error_new(ERROR_RTC_RTCP, "remb requires 20, only %d bytes", nb_data);
+    }
+
+    if (memcmp(data + 12, "REMB", 4) != 0) {
+        return srs_error_new(ERROR_RTC_RTCP, "not remb");
+    }
+
+    SrsBuffer buffer(data + 17, 3);
+    uint32_t v = (uint32_t)buffer.read_3bytes();
+    uint8_t exp = (v >> 18) & 0x3f;
+    uint32_t mantissa = v & 0x3ffff;
+
+    // Never overflow for invalid exp.
+    if (exp > 46) {
+        return srs_error_new(ERROR_RTC_RTCP, "remb invalid exp %d", exp);
+    }
+    bitrate = (uint64_t)mantissa << exp;
+
+    return srs_success;
+}
+
 SrsRtcpNack::SrsRtcpNack(uint32_t sender_ssrc)
 {
     header_.padding = 0;
@@ -1228,12 +1425,20 @@ vector<uint16_t> SrsRtcpNack::get_lost_sns() const
     for(set<uint16_t, SrsSeqCompareLess>::iterator it = lost_sns_.begin(); it != lost_sns_.end(); ++it) {
         sn.push_back(*it);
     }
+    for(vector<SrsPidBlp>::const_iterator it = chunks_.begin(); it != chunks_.end(); ++it) {
+        sn.push_back(it->pid);
+        for(int j = 0; j < 16; j++) {
+            if(it->blp & (1 << j)) {
+                sn.push_back(it->pid + j + 1);
+            }
+        }
+    }
     return sn;
 }
 
 bool SrsRtcpNack::empty()
 {
-    return lost_sns_.empty();
+    return lost_sns_.empty() && chunks_.empty();
 }
 
 void SrsRtcpNack::set_media_ssrc(uint32_t ssrc)
@@ -1246,6 +1451,15 @@ void SrsRtcpNack::add_lost_sn(uint16_t sn)
     lost_sns_.insert(sn);
 }
 
+void SrsRtcpNack::add_pid_blp(uint16_t pid, uint16_t blp)
+{
+    SrsPidBlp chunk;
+    chunk.pid = pid;
+    chunk.blp = blp;
+    chunk.in_use = true;
+    chunks_.push_back(chunk);
+}
+
 srs_error_t SrsRtcpNack::decode(SrsBuffer *buffer)
 {
     /*
@@ -1328,7 +1542,7 @@ srs_error_t SrsRtcpNack::encode(SrsBuffer *buffer)
         return srs_error_new(ERROR_RTC_RTCP, "requires %d bytes", nb_bytes());
     }
 
-    vector<SrsPidBlp> chunks;
+    vector<SrsPidBlp> chunks = chunks_;
     do {
         SrsPidBlp chunk;
         chunk.in_use = false;
@@ -1361,6 +1575,12 @@ srs_error_t SrsRtcpNack::encode(SrsBuffer *buffer)
             chunks.push_back(chunk);
         }
 
+        // Never exceed the packet size, the left lost packets will be requested next time.
+        int max_chunks = (kRtcpPacketSize - 12) / 4;
+        if((int)chunks.size() > max_chunks) {
+            chunks.resize(max_chunks);
+        }
+
         header_.length = 2 + chunks.size();
         if(srs_success != (err = encode_header(buffer))) {
             err = srs_error_wrap(err, "encode header");
@@ -247,6 +247,10 @@ public:
 #define kTwccFbLargeRecvDeltaBytes	2
 #define kTwccFbMaxBitElements 		kTwccFbOneBitElements
 
+// The max number of packets to feedback, which is a window of transport-wide sequence number,
+// about 800ms for 10k pps. It MUST be power of 2, to index the circular array by mask.
+#define kTwccRecvWindow 8192
+
 class SrsRtcpTWCC : public SrsRtcpCommon
 {
 private:
@@ -254,11 +258,19 @@ private:
     uint16_t base_sn_;
     int32_t reference_time_;
     uint8_t fb_pkt_count_;
+    // The chunks and deltas are reused, so never allocate when feedback.
     std::vector<uint16_t> encoded_chucks_;
     std::vector<uint16_t> pkt_deltas_;
 
-    std::map<uint16_t, srs_utime_t> recv_packets_;
-    std::set<uint16_t, SrsSeqCompareLess> recv_sns_;
+    // The circular array of arrival time, indexed by transport-wide sequence number, in the
+    // window from recv_base_sn_ to recv_high_sn_. Allocated when got the first packet.
+    srs_utime_t* recv_ts_;
+    // The bitmap of received packets, in the same window.
+    uint64_t* recv_bits_;
+    uint16_t recv_base_sn_;
+    uint16_t recv_high_sn_;
+    // The number of received packets to feedback.
+    int nn_recv_;
 
     struct SrsRtcpTWCCChunk {
         uint8_t delta_sizes[kTwccFbMaxBitElements];
@@ -269,9 +281,11 @@ private:
     };
 
     int pkt_len;
-    uint16_t next_base_sn_;
 private:
     void clear();
+    bool is_received(uint16_t sn);
+    void set_received(uint16_t sn, srs_utime_t ts);
+    void reset_received(uint16_t sn);
     srs_utime_t calculate_delta_us(srs_utime_t ts, srs_utime_t last);
     srs_error_t process_pkt_chunk(SrsRtcpTWCCChunk& chunk, int delta_size);
     bool can_add_to_chunk(SrsRtcpTWCCChunk& chunk, int delta_size);
@@ -300,6 +314,8 @@ public:
     void add_packet_chuck(uint16_t chuck);
     void add_recv_delta(uint16_t delta);
 
+    // Record the arrival time of packet, in O(1) without allocation. If the window overflows,
+    // the oldest packets are dropped and never feedback.
     srs_error_t recv_packet(uint16_t sn, srs_utime_t ts);
     bool need_feedback();
 
@@ -312,6 +328,21 @@ private:
     srs_error_t do_encode(SrsBuffer *buffer);
 };
 
+// The status of packet in TWCC feedback, parsed by sender to estimate the bandwidth.
+struct SrsTwccPacketStatus
+{
+    uint16_t sn;
+    bool received;
+    // The arrival time in us, by the clock of receiver, valid only when received.
+    int64_t arrival;
+};
+
+// Parse the TWCC feedback, the data is the RTCP packet, and the status is appended to the vector.
+srs_error_t srs_rtcp_parse_twcc(char* data, int nb_data, std::vector<SrsTwccPacketStatus>& status);
+// Parse the REMB(Receiver Estimated Max Bitrate) feedback, the data is the RTCP packet.
+// @see https://datatracker.ietf.org/doc/html/draft-alvestrand-rmcat-remb-03
+srs_error_t srs_rtcp_parse_remb(char* data, int nb_data, uint64_t& bitrate);
+
 class SrsRtcpNack : public SrsRtcpCommon
 {
 private:
@@ -323,6 +354,8 @@ private:
 
     uint32_t media_ssrc_;
     std::set<uint16_t, SrsSeqCompareLess> lost_sns_;
+    // The compressed chunks built by caller, encoded directly without the set of lost_sns_.
+    std::vector<SrsPidBlp> chunks_;
 public:
     SrsRtcpNack(uint32_t sender_ssrc = 0);
     virtual ~SrsRtcpNack();
@@ -333,6 +366,9 @@ public:
 
     void set_media_ssrc(uint32_t ssrc);
     void add_lost_sn(uint16_t sn);
+    // Add a compressed chunk, the PID is the lost sn, and BLP is the bitmask of following 16 lost sns.
+    // @remark Caller should not mix it with add_lost_sn.
+    void add_pid_blp(uint16_t pid, uint16_t blp);
 // interface ISrsCodec
 public:
     virtual srs_error_t decode(SrsBuffer *buffer);
@@ -15,7 +15,7 @@
 #include <sstream>
 using namespace std;
 
-#include <openssl/aes.h>
+#include <openssl/evp.h>
 #include <cstring>
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_error.hpp>
@@ -25,7 +25,9 @@ using namespace std;
 #include <srs_kernel_buffer.hpp>
 #include <srs_core_autofree.hpp>
 
-#define HLS_AES_ENCRYPT_BLOCK_LENGTH SRS_TS_PACKET_SIZE * 4
+// The plaintext to encrypt in bulk, which is about 94KB, and the ciphertext is padding to 16 bytes.
+#define HLS_AES_ENCRYPT_BLOCK_LENGTH SRS_TS_PACKET_SIZE * 512
+#define HLS_AES_CIPHER_BLOCK_SIZE 16
 
 // the mpegts header specifed the video/audio pid.
 #define TS_PMT_NUMBER 1
@@ -459,6 +461,12 @@ srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg
     char* end = start + msg->payload->length();
     char* p = start;
     
+    // Write all packets of message at once, which is much faster than writing each packet, especially
+    // for the encrypted writer. Each packet carries at most 184 bytes payload.
+    int nb_packets = (int)((end - start) / (SRS_TS_PACKET_SIZE - 4) + 2);
+    vector<char> packets;
+    packets.reserve(nb_packets * SRS_TS_PACKET_SIZE);
+    
     while (p < end) {
         SrsTsPacket* pkt = NULL;
         if (p == start) {
@@ -495,8 +503,9 @@ srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg
         
         pkt->sync_byte = sync_byte;
         
-        char* buf = new char[SRS_TS_PACKET_SIZE];
-        SrsAutoFreeA(char, buf);
+        // Encode the packet to the tail of packets.
+        packets.resize(packets.size() + SRS_TS_PACKET_SIZE);
+        char* buf = &packets[packets.size() - SRS_TS_PACKET_SIZE];
         
         // set the left bytes with 0xFF.
         int nb_buf = pkt->size();
@@ -526,9 +535,10 @@ srs_error_t SrsTsContext::encode_pes(ISrsStreamWriter* writer, SrsTsMessage* msg
         if ((err = pkt->encode(&stream)) != srs_success) {
             return srs_error_wrap(err, "ts: encode packet");
         }
-        if ((err = writer->write(buf, SRS_TS_PACKET_SIZE, NULL)) != srs_success) {
-            return srs_error_wrap(err, "ts: write packet");
-        }
+    }
+    
+    if (!packets.empty() && (err = writer->write(&packets[0], packets.size(), NULL)) != srs_success) {
+        return srs_error_wrap(err, "ts: write packets");
     }
     
     return err;
@@ -2737,48 +2747,52 @@ void SrsTsContextWriter::set_acodec(SrsAudioCodecId v)
 
 SrsEncFileWriter::SrsEncFileWriter()
 {
-    memset(iv,0,16);
+    memset(key, 0, sizeof(key));
+    memset(iv, 0, sizeof(iv));
+    has_key = started = false;
     
     buf = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH];
-    memset(buf, 0, HLS_AES_ENCRYPT_BLOCK_LENGTH);
-    
     nb_buf = 0;
-    key = (unsigned char*)new AES_KEY();
+    cipher = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH + HLS_AES_CIPHER_BLOCK_SIZE];
+    
+    ctx = EVP_CIPHER_CTX_new();
 }
 
 SrsEncFileWriter::~SrsEncFileWriter()
 {
     srs_freepa(buf);
+    srs_freepa(cipher);
     
-    AES_KEY* k = (AES_KEY*)key;
-    srs_freep(k);
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX*)ctx);
 }
 
 srs_error_t SrsEncFileWriter::write(void* data, size_t count, ssize_t* pnwrite)
 {
     srs_error_t err = srs_success;
     
-    srs_assert(count == SRS_TS_PACKET_SIZE);
-
-    if (nb_buf < HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        memcpy(buf + nb_buf, (char*)data, SRS_TS_PACKET_SIZE);
-        nb_buf += SRS_TS_PACKET_SIZE;
+    if (!started) {
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "no cipher");
     }
     
-    if (nb_buf == HLS_AES_ENCRYPT_BLOCK_LENGTH) {
-        nb_buf = 0;
-        
-        char* cipher = new char[HLS_AES_ENCRYPT_BLOCK_LENGTH];
-        SrsAutoFreeA(char, cipher);
-        
-        AES_KEY* k = (AES_KEY*)key;
-        AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, k, iv, AES_ENCRYPT);
+    // Buffer the plaintext, and encrypt it when buffer is full.
+    char* p = (char*)data;
+    size_t left = count;
+    while (left > 0) {
+        int nn = (int)srs_min(left, (size_t)(HLS_AES_ENCRYPT_BLOCK_LENGTH - nb_buf));
+        memcpy(buf + nb_buf, p, nn);
+        nb_buf += nn;
+        p += nn;
+        left -= nn;
         
-        if ((err = SrsFileWriter::write(cipher, HLS_AES_ENCRYPT_BLOCK_LENGTH, pnwrite)) != srs_success) {
-            return srs_error_wrap(err, "write cipher");
+        if (nb_buf == HLS_AES_ENCRYPT_BLOCK_LENGTH && (err = flush_cipher()) != srs_success) {
+            return srs_error_wrap(err, "flush cipher");
         }
     }
     
+    if (pnwrite) {
+        *pnwrite = (ssize_t)count;
+    }
+    
     return err;
 }
 
@@ -2786,39 +2800,64 @@ srs_error_t SrsEncFileWriter::config_cipher(unsigned char* key, unsigned char* i
 {
     srs_error_t err = srs_success;
     
-    memcpy(this->iv, iv, 16);
-  
-    AES_KEY* k = (AES_KEY*)this->key;
-    if (AES_set_encrypt_key(key, 16 * 8, k)) {
+    EVP_CIPHER_CTX* c = (EVP_CIPHER_CTX*)ctx;
+    
+    // Reset the iv only, when key not changed, to avoid expanding the key again.
+    int r0 = 0;
+    if (has_key && memcmp(this->key, key, 16) == 0) {
+        r0 = EVP_EncryptInit_ex(c, NULL, NULL, NULL, iv);
+    } else {
+        r0 = EVP_EncryptInit_ex(c, EVP_aes_128_cbc(), NULL, key, iv);
+    }
+    if (r0 != 1) {
         return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "set aes key failed");
     }
     
+    memcpy(this->key, key, 16);
+    memcpy(this->iv, iv, 16);
+    has_key = started = true;
+    nb_buf = 0;
+    
+    return err;
+}
+
+srs_error_t SrsEncFileWriter::flush_cipher()
+{
+    srs_error_t err = srs_success;
+    
+    int nb_cipher = 0;
+    if (EVP_EncryptUpdate((EVP_CIPHER_CTX*)ctx, (unsigned char*)cipher, &nb_cipher, (unsigned char*)buf, nb_buf) != 1) {
+        return srs_error_new(ERROR_SYSTEM_FILE_WRITE, "aes encrypt %d bytes", nb_buf);
+    }
+    nb_buf = 0;
+    
+    if (nb_cipher > 0 && (err = SrsFileWriter::write(cipher, nb_cipher, NULL)) != srs_success) {
+        return srs_error_wrap(err, "write cipher");
+    }
+    
     return err;
 }
 
 void SrsEncFileWriter::close()
 {
-    if(nb_buf > 0) {
-        int nb_padding = 16 - (nb_buf % 16);
-        if (nb_padding > 0) {
-            memset(buf + nb_buf, nb_padding, nb_padding);
-        }
-        
-        char* cipher = new char[nb_buf + nb_padding];
-        SrsAutoFreeA(char, cipher);
-        
-        AES_KEY* k = (AES_KEY*)key;
-        AES_cbc_encrypt((unsigned char *)buf, (unsigned char *)cipher, nb_buf + nb_padding, k, iv, AES_ENCRYPT);
+    // Encrypt the left plaintext, and the final block with PKCS7 padding.
+    if (started) {
+        started = false;
         
         srs_error_t err = srs_success;
-        if ((err = SrsFileWriter::write(cipher, nb_buf + nb_padding, NULL)) != srs_success) {
+        int nb_cipher = 0;
+        if (nb_buf > 0 && (err = flush_cipher()) != srs_success) {
+            srs_warn("ignore err %s", srs_error_desc(err).c_str());
+            srs_error_reset(err);
+        } else if (EVP_EncryptFinal_ex((EVP_CIPHER_CTX*)ctx, (unsigned char*)cipher, &nb_cipher) != 1) {
+            srs_warn("ignore aes final failed");
+        } else if (nb_cipher > 0 && (err = SrsFileWriter::write(cipher, nb_cipher, NULL)) != srs_success) {
             srs_warn("ignore err %s", srs_error_desc(err).c_str());
             srs_error_reset(err);
         }
-
-        nb_buf = 0;
     }
     
+    nb_buf = 0;
     SrsFileWriter::close();
 }
 
@@ -1283,7 +1283,8 @@ public:
     void set_acodec(SrsAudioCodecId v);
 };
 
-// Used for HLS Encryption
+// Used for HLS Encryption, in AES-128-CBC with PKCS7 padding.
+// The plaintext is buffered and encrypted in bulk by EVP, which uses AES-NI if available.
 class SrsEncFileWriter: public SrsFileWriter
 {
 public:
@@ -1293,13 +1294,25 @@ public:
     virtual srs_error_t write(void* data, size_t count, ssize_t* pnwrite);
     virtual void close();
 public:
+    // Start to encrypt a new segment. The key is only expanded when changed, for the key is
+    // generally shared by some segments, see hls_fragments_per_key.
     srs_error_t config_cipher(unsigned char* key, unsigned char* iv);
 private:
-    unsigned char* key;
+    srs_error_t flush_cipher();
+private:
+    // The EVP_CIPHER_CTX of AES-128-CBC.
+    void* ctx;
+    unsigned char key[16];
     unsigned char iv[16];
+    // Whether key is set, and whether the segment is started to encrypt.
+    bool has_key;
+    bool started;
 private:
+    // The plaintext to encrypt in bulk.
     char* buf;
     int nb_buf;
+    // The ciphertext, with extra space for padding.
+    char* cipher;
 };
 
 // TS messages cache, to group frames to TS message,
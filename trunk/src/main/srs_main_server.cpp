@@ -513,6 +513,12 @@ srs_error_t run_in_thread_pool()
         return srs_error_wrap(err, "init thread pool");
     }
 
+    // Start the flusher thread for async log, which should be after the daemon forked.
+    SrsFileLog* log = dynamic_cast<SrsFileLog*>(_srs_log);
+    if (log && (err = log->start_async()) != srs_success) {
+        return srs_error_wrap(err, "start async log");
+    }
+
     // Start the hybrid service worker thread, for RTMP and RTC server, etc.
     if ((err = _srs_thread_pool->execute("hybrid", run_hybrid_server, (void*)NULL)) != srs_success) {
         return srs_error_wrap(err, "start hybrid server thread");
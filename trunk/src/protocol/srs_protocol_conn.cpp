@@ -11,8 +11,17 @@
 #include <algorithm>
 using namespace std;
 
+SrsResourceHook::SrsResourceHook()
+{
+    prev = next = NULL;
+    resource = NULL;
+    manager = NULL;
+    zombie = disposing = false;
+}
+
 ISrsResource::ISrsResource()
 {
+    resource_hook_.resource = this;
 }
 
 ISrsResource::~ISrsResource()
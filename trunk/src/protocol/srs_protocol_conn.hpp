@@ -12,9 +12,36 @@
 #include <string>
 #include <vector>
 
+class ISrsResource;
+class ISrsResourceManager;
+
+// The intrusive hook of resource, to link the resource in manager, so the manager adds and removes
+// the resource in O(1), without searching all resources.
+struct SrsResourceHook
+{
+    SrsResourceHook* prev;
+    SrsResourceHook* next;
+    ISrsResource* resource;
+    // The manager which the resource is added to, NULL if not added.
+    ISrsResourceManager* manager;
+    // Whether the resource is in zombies, or disposing by manager.
+    bool zombie;
+    bool disposing;
+    // The keys of resource in manager, to remove the resource by its keys.
+    std::vector<std::string> ids;
+    std::vector<std::string> names;
+    std::vector<uint64_t> fast_ids;
+
+    SrsResourceHook();
+};
+
 // The resource managed by ISrsResourceManager.
 class ISrsResource
 {
+    friend class SrsResourceManager;
+private:
+    // The hook for manager, a resource is only able to be added to one manager.
+    SrsResourceHook resource_hook_;
 public:
     ISrsResource();
     virtual ~ISrsResource();
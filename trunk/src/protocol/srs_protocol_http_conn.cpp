@@ -20,6 +20,7 @@ using namespace std;
 #include <srs_protocol_rtmp_stack.hpp>
 #include <srs_protocol_conn.hpp>
 #include <srs_protocol_http_stack.hpp>
+#include <srs_protocol_io.hpp>
 
 SrsHttpParser::SrsHttpParser()
 {
@@ -650,6 +651,7 @@ ISrsHttpFirstLineWriter::~ISrsHttpFirstLineWriter()
 SrsHttpMessageWriter::SrsHttpMessageWriter(ISrsProtocolReadWriter* io, ISrsHttpFirstLineWriter* flw)
 {
     skt = io;
+    sf_ = dynamic_cast<ISrsProtocolSendfile*>(io);
     hdr = new SrsHttpHeader();
     header_wrote_ = false;
     content_length = -1;
@@ -896,6 +898,43 @@ srs_error_t SrsHttpMessageWriter::send_header(char* data, int size)
     return skt->write((void*)buf.c_str(), buf.length(), NULL);
 }
 
+bool SrsHttpMessageWriter::sendfile_enabled()
+{
+    return sf_ && header_wrote_ && content_length != -1;
+}
+
+srs_error_t SrsHttpMessageWriter::sendfile(int fd, off_t offset, int64_t size)
+{
+    srs_error_t err = srs_success;
+
+    // The chunked encoding requires a header for each chunk, so we only send file with content length.
+    if (!sendfile_enabled()) {
+        return srs_error_new(ERROR_HTTP_SENDFILE, "sendfile disabled, sf=%d, header=%d, length=%" PRId64,
+            sf_ != NULL, header_wrote_, content_length);
+    }
+
+    // whatever header is wrote, we should try to send header.
+    if ((err = send_header(NULL, 0)) != srs_success) {
+        return srs_error_wrap(err, "send header");
+    }
+
+    // check the bytes send and content length.
+    written += size;
+    if (written > content_length) {
+        return srs_error_new(ERROR_HTTP_CONTENT_LENGTH, "overflow writen=%" PRId64 ", max=%" PRId64, written, content_length);
+    }
+
+    if (size <= 0) {
+        return err;
+    }
+
+    if ((err = sf_->sendfile(fd, offset, (size_t)size, NULL)) != srs_success) {
+        return srs_error_wrap(err, "sendfile fd=%d, offset=%" PRId64 ", size=%" PRId64, fd, (int64_t)offset, size);
+    }
+
+    return err;
+}
+
 bool SrsHttpMessageWriter::header_wrote()
 {
     return header_wrote_;
@@ -976,6 +1015,16 @@ void SrsHttpResponseWriter::write_default_header()
     write_header(SRS_CONSTS_HTTP_OK);
 }
 
+bool SrsHttpResponseWriter::sendfile_enabled()
+{
+    return writer_->sendfile_enabled();
+}
+
+srs_error_t SrsHttpResponseWriter::sendfile(int fd, off_t offset, int64_t size)
+{
+    return writer_->sendfile(fd, offset, size);
+}
+
 SrsHttpRequestWriter::SrsHttpRequestWriter(ISrsProtocolReadWriter* io)
 {
     writer_ = new SrsHttpMessageWriter(io, this);
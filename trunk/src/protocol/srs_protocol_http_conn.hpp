@@ -20,6 +20,7 @@ class SrsRequest;
 class ISrsReader;
 class SrsHttpResponseReader;
 class ISrsProtocolReadWriter;
+class ISrsProtocolSendfile;
 
 // A wrapper for http-parser,
 // provides HTTP message originted service.
@@ -215,6 +216,8 @@ class SrsHttpMessageWriter
 {
 private:
     ISrsProtocolReadWriter* skt;
+    // The zero-copy writer of skt, NULL if not supported, for example, HTTPS.
+    ISrsProtocolSendfile* sf_;
     SrsHttpHeader* hdr;
     // Before writing header, there is a chance to filter it,
     // such as remove some headers or inject new.
@@ -249,6 +252,11 @@ public:
     virtual srs_error_t writev(const iovec* iov, int iovcnt, ssize_t* pnwrite);
     virtual void write_header();
     virtual srs_error_t send_header(char* data, int size);
+public:
+    // Whether able to send file by sendfile, which requires the content-length rather than chunked.
+    virtual bool sendfile_enabled();
+    // Send size bytes of file fd from offset as body, in zero-copy.
+    virtual srs_error_t sendfile(int fd, off_t offset, int64_t size);
 public:
     bool header_wrote();
     void set_header_filter(ISrsHttpHeaderFilter* hf);
@@ -256,6 +264,7 @@ public:
 
 // Response writer use st socket
 class SrsHttpResponseWriter : public ISrsHttpResponseWriter, public ISrsHttpFirstLineWriter
+    , public ISrsHttpResponseFileWriter
 {
 protected:
     SrsHttpMessageWriter* writer_;
@@ -277,6 +286,10 @@ public:
 public:
     virtual srs_error_t build_first_line(std::stringstream& ss, char* data, int size);
     virtual void write_default_header();
+// Interface ISrsHttpResponseFileWriter
+public:
+    virtual bool sendfile_enabled();
+    virtual srs_error_t sendfile(int fd, off_t offset, int64_t size);
 };
 
 // Request writer use st socket
@@ -7,6 +7,7 @@
 #include <srs_protocol_http_stack.hpp>
 
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <sstream>
 #include <algorithm>
 using namespace std;
@@ -15,14 +16,16 @@ using namespace std;
 #include <srs_kernel_log.hpp>
 #include <srs_kernel_utility.hpp>
 #include <srs_kernel_file.hpp>
+#include <srs_kernel_flv.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_core_autofree.hpp>
 #include <srs_protocol_utility.hpp>
 
 #define SRS_HTTP_DEFAULT_PAGE "index.html"
 
-// @see ISrsHttpMessage._http_ts_send_buffer
-#define SRS_HTTP_TS_SEND_BUFFER_SIZE 4096
+// The buffer to read file and write to response, when not able to sendfile, for example, HTTPS. Note that the SSL
+// record is up to 16KB, so a larger buffer is able to reduce the number of read and SSL_write calls.
+#define SRS_HTTP_FILE_SEND_BUFFER_SIZE 65536
 
 // get the status text of code.
 string srs_generate_http_status_text(int status)
@@ -247,6 +250,14 @@ ISrsHttpResponseWriter::~ISrsHttpResponseWriter()
 {
 }
 
+ISrsHttpResponseFileWriter::ISrsHttpResponseFileWriter()
+{
+}
+
+ISrsHttpResponseFileWriter::~ISrsHttpResponseFileWriter()
+{
+}
+
 ISrsHttpResponseReader::ISrsHttpResponseReader()
 {
 }
@@ -355,11 +366,286 @@ string srs_http_fs_fullpath(string dir, string pattern, string upath)
     return fullpath;
 }
 
+SrsHttpFileCacheEntry::SrsHttpFileCacheEntry()
+{
+    mtime = 0;
+    size = 0;
+    data = NULL;
+}
+
+SrsHttpFileCacheEntry::~SrsHttpFileCacheEntry()
+{
+    srs_freep(data);
+}
+
+SrsHttpFileCache* _srs_http_file_cache = NULL;
+
+SrsHttpFileCache::SrsHttpFileCache()
+{
+    enabled_ = false;
+    max_size_ = 0;
+    max_file_size_ = 0;
+    size_ = 0;
+
+    nn_hits_ = 0;
+    nn_misses_ = 0;
+    nn_evicts_ = 0;
+}
+
+SrsHttpFileCache::~SrsHttpFileCache()
+{
+    while (!lru_.empty()) {
+        erase(lru_.begin());
+    }
+}
+
+void SrsHttpFileCache::initialize(bool enabled, int64_t max_size, int64_t max_file_size)
+{
+    while (!lru_.empty()) {
+        erase(lru_.begin());
+    }
+
+    enabled_ = enabled;
+    max_size_ = max_size;
+    max_file_size_ = srs_min(max_file_size, max_size);
+}
+
+bool SrsHttpFileCache::enabled()
+{
+    return enabled_;
+}
+
+bool SrsHttpFileCache::cacheable(int64_t size)
+{
+    return enabled_ && size > 0 && size <= max_file_size_;
+}
+
+SrsSharedPtrMessage* SrsHttpFileCache::fetch(string path, srs_utime_t mtime, int64_t size)
+{
+    std::map<std::string, std::list<SrsHttpFileCacheEntry*>::iterator>::iterator it = entries_.find(path);
+    if (it == entries_.end()) {
+        nn_misses_++;
+        return NULL;
+    }
+
+    // The file is changed, for example, the HLS m3u8 is updated, remove the stale entry.
+    std::list<SrsHttpFileCacheEntry*>::iterator pos = it->second;
+    SrsHttpFileCacheEntry* entry = *pos;
+    if (entry->mtime != mtime || entry->size != size) {
+        erase(pos);
+        nn_misses_++;
+        return NULL;
+    }
+
+    // Move to front, as the most recently used entry.
+    if (pos != lru_.begin()) {
+        lru_.splice(lru_.begin(), lru_, pos);
+    }
+
+    nn_hits_++;
+    return entry->data->copy2();
+}
+
+SrsSharedPtrMessage* SrsHttpFileCache::store(string path, srs_utime_t mtime, char* payload, int size)
+{
+    SrsHttpFileCacheEntry* entry = new SrsHttpFileCacheEntry();
+    entry->path = path;
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->data = new SrsSharedPtrMessage();
+    entry->data->wrap(payload, size);
+
+    // Always return a copy, even if not cached, the payload is freed with the copy.
+    SrsSharedPtrMessage* copy = entry->data->copy2();
+
+    if (!cacheable(size)) {
+        srs_freep(entry);
+        return copy;
+    }
+
+    // Remove the stale entry of path.
+    std::map<std::string, std::list<SrsHttpFileCacheEntry*>::iterator>::iterator it = entries_.find(path);
+    if (it != entries_.end()) {
+        erase(it->second);
+    }
+
+    // Evict the least recently used entries.
+    while (!lru_.empty() && size_ + size > max_size_) {
+        std::list<SrsHttpFileCacheEntry*>::iterator last = lru_.end();
+        erase(--last);
+        nn_evicts_++;
+    }
+
+    lru_.push_front(entry);
+    entries_[path] = lru_.begin();
+    size_ += size;
+
+    return copy;
+}
+
+void SrsHttpFileCache::erase(std::list<SrsHttpFileCacheEntry*>::iterator it)
+{
+    SrsHttpFileCacheEntry* entry = *it;
+
+    size_ -= entry->size;
+    entries_.erase(entry->path);
+    lru_.erase(it);
+
+    // Note that the payload is shared, so it's safe to free the entry even if it's being sent.
+    srs_freep(entry);
+}
+
+int64_t SrsHttpFileCache::hits()
+{
+    return nn_hits_;
+}
+
+int64_t SrsHttpFileCache::misses()
+{
+    return nn_misses_;
+}
+
+int64_t SrsHttpFileCache::evicts()
+{
+    return nn_evicts_;
+}
+
+int64_t SrsHttpFileCache::size()
+{
+    return size_;
+}
+
+int SrsHttpFileCache::count()
+{
+    return (int)lru_.size();
+}
+
+double SrsHttpFileCache::hit_ratio()
+{
+    int64_t total = nn_hits_ + nn_misses_;
+    return total ? (double)nn_hits_ / total : 0;
+}
+
+// Get the mtime and size of file, return false if failed.
+bool srs_http_fs_stat(string fullpath, srs_utime_t* pmtime, int64_t* psize)
+{
+    struct stat st;
+    if (stat(fullpath.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+
+#if defined(__linux__)
+    *pmtime = (srs_utime_t)st.st_mtim.tv_sec * SRS_UTIME_SECONDS + st.st_mtim.tv_nsec / 1000;
+#elif defined(__APPLE__)
+    *pmtime = (srs_utime_t)st.st_mtimespec.tv_sec * SRS_UTIME_SECONDS + st.st_mtimespec.tv_nsec / 1000;
+#else
+    *pmtime = (srs_utime_t)st.st_mtime * SRS_UTIME_SECONDS;
+#endif
+    *psize = (int64_t)st.st_size;
+
+    return true;
+}
+
+// Get the content type by the extension of file.
+string srs_http_fs_content_type(string fullpath)
+{
+    static std::map<std::string, std::string> _mime;
+    if (_mime.empty()) {
+        _mime[".ts"] = "video/MP2T";
+        _mime[".flv"] = "video/x-flv";
+        _mime[".m4v"] = "video/x-m4v";
+        _mime[".3gpp"] = "video/3gpp";
+        _mime[".3gp"] = "video/3gpp";
+        _mime[".mp4"] = "video/mp4";
+        _mime[".aac"] = "audio/x-aac";
+        _mime[".mp3"] = "audio/mpeg";
+        _mime[".m4a"] = "audio/x-m4a";
+        _mime[".ogg"] = "audio/ogg";
+        // @see hls-m3u8-draft-pantos-http-live-streaming-12.pdf, page 5.
+        _mime[".m3u8"] = "application/vnd.apple.mpegurl"; // application/x-mpegURL
+        _mime[".rss"] = "application/rss+xml";
+        _mime[".json"] = "application/json";
+        _mime[".swf"] = "application/x-shockwave-flash";
+        _mime[".doc"] = "application/msword";
+        _mime[".zip"] = "application/zip";
+        _mime[".rar"] = "application/x-rar-compressed";
+        _mime[".xml"] = "text/xml";
+        _mime[".html"] = "text/html";
+        _mime[".js"] = "text/javascript";
+        _mime[".css"] = "text/css";
+        _mime[".ico"] = "image/x-icon";
+        _mime[".png"] = "image/png";
+        _mime[".jpeg"] = "image/jpeg";
+        _mime[".jpg"] = "image/jpeg";
+        _mime[".gif"] = "image/gif";
+        // For MPEG-DASH.
+        _mime[".mpd"] = "application/dash+xml";
+        _mime[".m4s"] = "video/iso.segment";
+        _mime[".mp4v"] = "video/mp4";
+    }
+
+    std::string ext = srs_path_filext(fullpath);
+
+    std::map<std::string, std::string>::iterator it = _mime.find(ext);
+    if (it == _mime.end()) {
+        return "application/octet-stream";
+    }
+    return it->second;
+}
+
+bool srs_http_parse_range(ISrsHttpMessage* r, int64_t* pstart, int64_t* pend)
+{
+    // for flash to request mp4 range in query string.
+    std::string range = r->query_get("range");
+    // or, use bytes to request range.
+    if (range.empty()) {
+        range = r->query_get("bytes");
+    }
+
+    // Fetch range from header.
+    SrsHttpHeader* h = r->header();
+    if (range.empty() && h) {
+        range = h->get("Range");
+        if (range.find("bytes=") == 0) {
+            range = range.substr(6);
+        }
+    }
+    
+    // rollback to serve whole file.
+    size_t pos = string::npos;
+    if (range.empty() || (pos = range.find("-")) == string::npos) {
+        return false;
+    }
+    
+    // parse the start in query string
+    int64_t start = 0;
+    if (pos > 0) {
+        start = ::atoll(range.substr(0, pos).c_str());
+    }
+    
+    // parse end in query string.
+    int64_t end = -1;
+    if (pos < range.length() - 1) {
+        end = ::atoll(range.substr(pos + 1).c_str());
+    }
+    
+    // invalid param, serve as whole mp4 file.
+    if (start < 0 || (end != -1 && start > end)) {
+        return false;
+    }
+    
+    *pstart = start;
+    *pend = end;
+    return true;
+}
+
 SrsHttpFileServer::SrsHttpFileServer(string root_dir)
 {
     dir = root_dir;
     fs_factory = new ISrsFileReaderFactory();
     _srs_path_exists = srs_path_exists;
+    sendfile_ = true;
+    file_cache_ = NULL;
 }
 
 SrsHttpFileServer::~SrsHttpFileServer()
@@ -378,6 +664,16 @@ void SrsHttpFileServer::set_path_check(_pfn_srs_path_exists pfn)
     _srs_path_exists = pfn;
 }
 
+void SrsHttpFileServer::set_sendfile(bool v)
+{
+    sendfile_ = v;
+}
+
+void SrsHttpFileServer::set_file_cache(SrsHttpFileCache* v)
+{
+    file_cache_ = v;
+}
+
 srs_error_t SrsHttpFileServer::serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r)
 {
     srs_assert(entry);
@@ -418,6 +714,17 @@ srs_error_t SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMes
 {
     srs_error_t err = srs_success;
 
+    // Serve the hot small files from memory, for example, the HLS m3u8 and ts files.
+    if (file_cache_ && file_cache_->enabled()) {
+        bool served = false;
+        if ((err = serve_cached_file(w, r, fullpath, &served)) != srs_success) {
+            return srs_error_wrap(err, "serve cached file %s", fullpath.c_str());
+        }
+        if (served) {
+            return err;
+        }
+    }
+
     SrsFileReader* fs = fs_factory->create_file_reader();
     SrsAutoFree(SrsFileReader, fs);
 
@@ -430,51 +737,7 @@ srs_error_t SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMes
     
     // unset the content length to encode in chunked encoding.
     w->header()->set_content_length(length);
-    
-    static std::map<std::string, std::string> _mime;
-    if (_mime.empty()) {
-        _mime[".ts"] = "video/MP2T";
-        _mime[".flv"] = "video/x-flv";
-        _mime[".m4v"] = "video/x-m4v";
-        _mime[".3gpp"] = "video/3gpp";
-        _mime[".3gp"] = "video/3gpp";
-        _mime[".mp4"] = "video/mp4";
-        _mime[".aac"] = "audio/x-aac";
-        _mime[".mp3"] = "audio/mpeg";
-        _mime[".m4a"] = "audio/x-m4a";
-        _mime[".ogg"] = "audio/ogg";
-        // @see hls-m3u8-draft-pantos-http-live-streaming-12.pdf, page 5.
-        _mime[".m3u8"] = "application/vnd.apple.mpegurl"; // application/x-mpegURL
-        _mime[".rss"] = "application/rss+xml";
-        _mime[".json"] = "application/json";
-        _mime[".swf"] = "application/x-shockwave-flash";
-        _mime[".doc"] = "application/msword";
-        _mime[".zip"] = "application/zip";
-        _mime[".rar"] = "application/x-rar-compressed";
-        _mime[".xml"] = "text/xml";
-        _mime[".html"] = "text/html";
-        _mime[".js"] = "text/javascript";
-        _mime[".css"] = "text/css";
-        _mime[".ico"] = "image/x-icon";
-        _mime[".png"] = "image/png";
-        _mime[".jpeg"] = "image/jpeg";
-        _mime[".jpg"] = "image/jpeg";
-        _mime[".gif"] = "image/gif";
-        // For MPEG-DASH.
-        _mime[".mpd"] = "application/dash+xml";
-        _mime[".m4s"] = "video/iso.segment";
-        _mime[".mp4v"] = "video/mp4";
-    }
-    
-    if (true) {
-        std::string ext = srs_path_filext(fullpath);
-        
-        if (_mime.find(ext) == _mime.end()) {
-            w->header()->set_content_type("application/octet-stream");
-        } else {
-            w->header()->set_content_type(_mime[ext]);
-        }
-    }
+    w->header()->set_content_type(srs_http_fs_content_type(fullpath));
 
     // Enter chunked mode, because we didn't set the content-length.
     w->write_header(SRS_CONSTS_HTTP_OK);
@@ -492,6 +755,59 @@ srs_error_t SrsHttpFileServer::serve_file(ISrsHttpResponseWriter* w, ISrsHttpMes
     return err;
 }
 
+srs_error_t SrsHttpFileServer::serve_cached_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, bool* served)
+{
+    srs_error_t err = srs_success;
+
+    srs_utime_t mtime = 0;
+    int64_t size = 0;
+    if (!srs_http_fs_stat(fullpath, &mtime, &size) || !file_cache_->cacheable(size)) {
+        return err;
+    }
+
+    SrsSharedPtrMessage* data = file_cache_->fetch(fullpath, mtime, size);
+    SrsAutoFree(SrsSharedPtrMessage, data);
+
+    // Load the whole file to memory, when cache miss or file changed.
+    if (!data) {
+        SrsFileReader* fs = fs_factory->create_file_reader();
+        SrsAutoFree(SrsFileReader, fs);
+
+        if ((err = fs->open(fullpath)) != srs_success) {
+            return srs_error_wrap(err, "open file %s", fullpath.c_str());
+        }
+
+        char* payload = new char[size];
+        for (int64_t nn = 0; nn < size;) {
+            ssize_t nread = 0;
+            if ((err = fs->read(payload + nn, (size_t)(size - nn), &nread)) != srs_success) {
+                srs_freepa(payload);
+                return srs_error_wrap(err, "read %" PRId64 "/%" PRId64, nn, size);
+            }
+            nn += nread;
+        }
+
+        data = file_cache_->store(fullpath, mtime, payload, (int)size);
+    }
+
+    w->header()->set_content_length(data->size);
+    w->header()->set_content_type(srs_http_fs_content_type(fullpath));
+    w->write_header(SRS_CONSTS_HTTP_OK);
+
+    // Mark as served, because the response is started.
+    *served = true;
+
+    if ((err = w->write(data->payload, data->size)) != srs_success) {
+        return srs_error_wrap(err, "write size=%d", data->size);
+    }
+
+    if ((err = w->final_request()) != srs_success) {
+        return srs_error_wrap(err, "final request");
+    }
+
+    return err;
+}
+
 srs_error_t SrsHttpFileServer::serve_flv_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
 {
     std::string start = r->query_get("start");
@@ -509,42 +825,15 @@ srs_error_t SrsHttpFileServer::serve_flv_file(ISrsHttpResponseWriter* w, ISrsHtt
 
 srs_error_t SrsHttpFileServer::serve_mp4_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath)
 {
-    // for flash to request mp4 range in query string.
-    std::string range = r->query_get("range");
-    // or, use bytes to request range.
-    if (range.empty()) {
-        range = r->query_get("bytes");
+    // For player to seek mp4 by time in seconds, for example, x.mp4?start=12.5
+    std::string seek = r->query_get("start");
+    if (!seek.empty() && ::atof(seek.c_str()) > 0) {
+        return serve_mp4_seek(w, r, fullpath, (srs_utime_t)(::atof(seek.c_str()) * SRS_UTIME_SECONDS));
     }
 
-    // Fetch range from header.
-    SrsHttpHeader* h = r->header();
-    if (range.empty() && h) {
-        range = h->get("Range");
-        if (range.find("bytes=") == 0) {
-            range = range.substr(6);
-        }
-    }
-    
-    // rollback to serve whole file.
-    size_t pos = string::npos;
-    if (range.empty() || (pos = range.find("-")) == string::npos) {
-        return serve_file(w, r, fullpath);
-    }
-    
-    // parse the start in query string
     int64_t start = 0;
-    if (pos > 0) {
-        start = ::atoll(range.substr(0, pos).c_str());
-    }
-    
-    // parse end in query string.
     int64_t end = -1;
-    if (pos < range.length() - 1) {
-        end = ::atoll(range.substr(pos + 1).c_str());
-    }
-    
-    // invalid param, serve as whole mp4 file.
-    if (start < 0 || (end != -1 && start > end)) {
+    if (!srs_http_parse_range(r, &start, &end)) {
         return serve_file(w, r, fullpath);
     }
     
@@ -575,6 +864,12 @@ srs_error_t SrsHttpFileServer::serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsH
     return serve_file(w, r, fullpath);
 }
 
+srs_error_t SrsHttpFileServer::serve_mp4_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, string fullpath, srs_utime_t start)
+{
+    // @remark For common http file server, we don't support stream request, please use SrsVodStream instead.
+    return serve_file(w, r, fullpath);
+}
+
 srs_error_t SrsHttpFileServer::serve_m3u8_ctx(ISrsHttpResponseWriter * w, ISrsHttpMessage * r, std::string fullpath)
 {
     // @remark For common http file server, we don't support stream request, please use SrsVodStream instead.
@@ -590,14 +885,26 @@ srs_error_t SrsHttpFileServer::serve_ts_ctx(ISrsHttpResponseWriter * w, ISrsHttp
 srs_error_t SrsHttpFileServer::copy(ISrsHttpResponseWriter* w, SrsFileReader* fs, ISrsHttpMessage* r, int64_t size)
 {
     srs_error_t err = srs_success;
+
+    // Send file in zero-copy for plaintext connections, which avoids copying the file to user space.
+    ISrsHttpResponseFileWriter* fw = dynamic_cast<ISrsHttpResponseFileWriter*>(w);
+    if (sendfile_ && fw && fw->sendfile_enabled() && fs->get_fd() >= 0) {
+        int64_t offset = fs->tellg();
+        if ((err = fw->sendfile(fs->get_fd(), (off_t)offset, size)) != srs_success) {
+            return srs_error_wrap(err, "sendfile offset=%" PRId64 ", size=%" PRId64, offset, size);
+        }
+
+        fs->skip(size);
+        return err;
+    }
     
     int64_t left = size;
-    char* buf = new char[SRS_HTTP_TS_SEND_BUFFER_SIZE];
+    char* buf = new char[SRS_HTTP_FILE_SEND_BUFFER_SIZE];
     SrsAutoFreeA(char, buf);
     
     while (left > 0) {
         ssize_t nread = -1;
-        int max_read = srs_min(left, SRS_HTTP_TS_SEND_BUFFER_SIZE);
+        int max_read = srs_min(left, SRS_HTTP_FILE_SEND_BUFFER_SIZE);
         if ((err = fs->read(buf, max_read, &nread)) != srs_success) {
             return srs_error_wrap(err, "read limit=%d, left=%" PRId64, max_read, left);
         }
@@ -12,6 +12,7 @@
 #include <srs_kernel_io.hpp>
 
 #include <map>
+#include <list>
 #include <string>
 #include <vector>
 
@@ -27,6 +28,7 @@ class SrsHttpMuxEntry;
 class ISrsHttpResponseWriter;
 class SrsJsonObject;
 class ISrsFileReaderFactory;
+class SrsSharedPtrMessage;
 
 // From http specification
 // CR             = <US-ASCII CR, carriage return (13)>
@@ -196,6 +198,21 @@ public:
     virtual void write_header(int code) = 0;
 };
 
+// The response writer which is able to send file as body in zero-copy, for example, by sendfile(2)
+// over plaintext TCP. For HTTPS, it's not available, because the body must be encrypted in user space.
+class ISrsHttpResponseFileWriter
+{
+public:
+    ISrsHttpResponseFileWriter();
+    virtual ~ISrsHttpResponseFileWriter();
+public:
+    // Whether able to send file in zero-copy, which requires the content-length rather than chunked.
+    // @remark User must call it after write_header.
+    virtual bool sendfile_enabled() = 0;
+    // Send size bytes of file fd from offset, as the body of response.
+    virtual srs_error_t sendfile(int fd, off_t offset, int64_t size) = 0;
+};
+
 // The reader interface for http response.
 class ISrsHttpResponseReader : public ISrsReader
 {
@@ -323,6 +340,86 @@ typedef bool (*_pfn_srs_path_exists)(std::string path);
 // Build the file path from request r.
 extern std::string srs_http_fs_fullpath(std::string dir, std::string pattern, std::string upath);
 
+// Get the mtime and size of regular file, return false if failed.
+extern bool srs_http_fs_stat(std::string fullpath, srs_utime_t* pmtime, int64_t* psize);
+
+// Get the content type by the extension of file.
+extern std::string srs_http_fs_content_type(std::string fullpath);
+
+// Parse the byte range of request, from query string range or bytes, or the Range header.
+// @param pend The end offset, -1 to end of file.
+// @return false if no range or invalid range.
+extern bool srs_http_parse_range(ISrsHttpMessage* r, int64_t* pstart, int64_t* pend);
+
+// The cached content of file, which is valid only when the mtime and size of file is not changed.
+class SrsHttpFileCacheEntry
+{
+public:
+    std::string path;
+    srs_utime_t mtime;
+    int64_t size;
+    // The shared content of file, user should use copy2 to share it.
+    SrsSharedPtrMessage* data;
+public:
+    SrsHttpFileCacheEntry();
+    virtual ~SrsHttpFileCacheEntry();
+};
+
+// The LRU cache for hot small files, for example, the HLS m3u8 and the latest ts segments, which are requested
+// by lots of players at the same time, so that we serve them from memory rather than reading the file again.
+// The entry is keyed by path, and validated by the mtime and size of file.
+class SrsHttpFileCache
+{
+private:
+    bool enabled_;
+    // The max bytes of all cached files.
+    int64_t max_size_;
+    // The max bytes of a file to cache, larger file is never cached.
+    int64_t max_file_size_;
+    // The bytes of all cached files.
+    int64_t size_;
+    // The most recently used entry is at front.
+    std::list<SrsHttpFileCacheEntry*> lru_;
+    std::map<std::string, std::list<SrsHttpFileCacheEntry*>::iterator> entries_;
+private:
+    // The statistics of cache.
+    int64_t nn_hits_;
+    int64_t nn_misses_;
+    int64_t nn_evicts_;
+public:
+    SrsHttpFileCache();
+    virtual ~SrsHttpFileCache();
+public:
+    // Setup the cache, and clear all cached files.
+    // @param max_size The max bytes of all cached files.
+    // @param max_file_size The max bytes of a file to cache.
+    virtual void initialize(bool enabled, int64_t max_size, int64_t max_file_size);
+    virtual bool enabled();
+    // Whether the file in size of bytes is able to be cached.
+    virtual bool cacheable(int64_t size);
+    // Fetch the content of file, NULL if not cached or changed.
+    // @remark User must free the returned message.
+    virtual SrsSharedPtrMessage* fetch(std::string path, srs_utime_t mtime, int64_t size);
+    // Cache the content of file, and evict the least recently used files if exceed the max size.
+    // @remark The payload is managed by cache, user should never free it.
+    // @return The shared content of file, user must free it.
+    virtual SrsSharedPtrMessage* store(std::string path, srs_utime_t mtime, char* payload, int size);
+private:
+    void erase(std::list<SrsHttpFileCacheEntry*>::iterator it);
+public:
+    // The statistics of cache.
+    virtual int64_t hits();
+    virtual int64_t misses();
+    virtual int64_t evicts();
+    virtual int64_t size();
+    virtual int count();
+    // The ratio of hits in [0, 1], 0 if never requested.
+    virtual double hit_ratio();
+};
+
+// The global file cache, shared by all file servers.
+extern SrsHttpFileCache* _srs_http_file_cache;
+
 // FileServer returns a handler that serves HTTP requests
 // with the contents of the file system rooted at root.
 //
@@ -338,6 +435,10 @@ protected:
 protected:
     ISrsFileReaderFactory* fs_factory;
     _pfn_srs_path_exists _srs_path_exists;
+    // Whether send file in zero-copy, if the response writer supports it.
+    bool sendfile_;
+    // The cache for hot small files, NULL to disable it.
+    SrsHttpFileCache* file_cache_;
 public:
     SrsHttpFileServer(std::string root_dir);
     virtual ~SrsHttpFileServer();
@@ -346,11 +447,18 @@ private:
     virtual void set_fs_factory(ISrsFileReaderFactory* v);
     // For utest to mock the path check function.
     virtual void set_path_check(_pfn_srs_path_exists pfn);
+public:
+    // Whether send file by sendfile for plaintext connections.
+    virtual void set_sendfile(bool v);
+    // Set the cache for hot small files, which is not owned by server.
+    virtual void set_file_cache(SrsHttpFileCache* v);
 public:
     virtual srs_error_t serve_http(ISrsHttpResponseWriter* w, ISrsHttpMessage* r);
 private:
     // Serve the file by specified path
     virtual srs_error_t serve_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
+    // Serve the file from cache, set served to false if not able to be cached.
+    virtual srs_error_t serve_cached_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, bool* served);
     virtual srs_error_t serve_flv_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
     virtual srs_error_t serve_mp4_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
     virtual srs_error_t serve_m3u8_file(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath);
@@ -363,6 +471,9 @@ protected:
     // @param end the end offset in bytes. -1 to end of file.
     // @remark response data in [start, end].
     virtual srs_error_t serve_mp4_stream(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, int64_t start, int64_t end);
+    // When access mp4 file with x.mp4?start=12.5
+    // @param start the start time to seek to.
+    virtual srs_error_t serve_mp4_seek(ISrsHttpResponseWriter* w, ISrsHttpMessage* r, std::string fullpath, srs_utime_t start);
     // For HLS protocol.
     // When the request url, like as "http://127.0.0.1:8080/live/livestream.m3u8", 
     // returns the response like as "http://127.0.0.1:8080/live/livestream.m3u8?hls_ctx=12345678" .
@@ -38,3 +38,12 @@ ISrsProtocolReadWriter::~ISrsProtocolReadWriter()
 {
 }
 
+
+ISrsProtocolSendfile::ISrsProtocolSendfile()
+{
+}
+
+ISrsProtocolSendfile::~ISrsProtocolSendfile()
+{
+}
+
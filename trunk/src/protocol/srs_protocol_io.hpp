@@ -104,5 +104,20 @@ public:
     virtual ~ISrsProtocolReadWriter();
 };
 
+/**
+ * The writer to send file to peer in zero-copy, for example, the plaintext TCP socket
+ * by sendfile(2). It's optional, user should fallback to read and write if not supported.
+ */
+class ISrsProtocolSendfile
+{
+public:
+    ISrsProtocolSendfile();
+    virtual ~ISrsProtocolSendfile();
+public:
+    // Send size bytes of file fd from offset to peer, without copying to user space.
+    // @param nwrite, the actually sent size, NULL to ignore.
+    virtual srs_error_t sendfile(int fd, off_t offset, size_t size, ssize_t* nwrite) = 0;
+};
+
 #endif
 
@@ -2016,8 +2016,175 @@ SrsAmf0Any* SrsJsonArray::to_amf0()
     return arr;
 }
 
+SrsJsonWriter::SrsJsonWriter(string* buf)
+{
+    buf_ = buf;
+    comma_ = false;
+}
+
+SrsJsonWriter::~SrsJsonWriter()
+{
+}
+
+void SrsJsonWriter::begin_object()
+{
+    token("{", 1);
+    comma_ = false;
+}
+
+void SrsJsonWriter::begin_object(const char* k)
+{
+    key(k);
+    begin_object();
+}
+
+void SrsJsonWriter::end_object()
+{
+    buf_->append(1, '}');
+    comma_ = true;
+}
+
+void SrsJsonWriter::begin_array()
+{
+    token("[", 1);
+    comma_ = false;
+}
+
+void SrsJsonWriter::begin_array(const char* k)
+{
+    key(k);
+    begin_array();
+}
+
+void SrsJsonWriter::end_array()
+{
+    buf_->append(1, ']');
+    comma_ = true;
+}
+
+void SrsJsonWriter::key(const char* k)
+{
+    if (comma_) {
+        buf_->append(1, ',');
+    }
+
+    escape(k, (int)strlen(k));
+    buf_->append(1, ':');
+
+    // The value follows the key, without comma.
+    comma_ = false;
+}
+
+void SrsJsonWriter::str(const string& v)
+{
+    if (comma_) {
+        buf_->append(1, ',');
+    }
+
+    escape(v.data(), (int)v.length());
+    comma_ = true;
+}
+
+void SrsJsonWriter::integer(int64_t v)
+{
+    // len(max int64_t) is 20, plus one "-".
+    char tmp[21 + 1];
+    int size = snprintf(tmp, sizeof(tmp), "%" PRId64, v);
+    token(tmp, size);
+}
+
+void SrsJsonWriter::number(double v)
+{
+    // len(max int64_t) is 20, plus one "+-."
+    char tmp[21 + 1];
+    int size = snprintf(tmp, sizeof(tmp), "%.2f", v);
+    token(tmp, srs_min(size, (int)sizeof(tmp) - 1));
+}
+
+void SrsJsonWriter::boolean(bool v)
+{
+    if (v) {
+        token("true", 4);
+    } else {
+        token("false", 5);
+    }
+}
+
+void SrsJsonWriter::null()
+{
+    token("null", 4);
+}
+
+void SrsJsonWriter::field_str(const char* k, const string& v)
+{
+    key(k);
+    str(v);
+}
+
+void SrsJsonWriter::field_integer(const char* k, int64_t v)
+{
+    key(k);
+    integer(v);
+}
+
+void SrsJsonWriter::field_number(const char* k, double v)
+{
+    key(k);
+    number(v);
+}
+
+void SrsJsonWriter::field_boolean(const char* k, bool v)
+{
+    key(k);
+    boolean(v);
+}
+
+void SrsJsonWriter::field_null(const char* k)
+{
+    key(k);
+    null();
+}
+
+void SrsJsonWriter::token(const char* v, int size)
+{
+    if (comma_) {
+        buf_->append(1, ',');
+    }
+
+    buf_->append(v, size);
+    comma_ = true;
+}
+
+// Escape the string like json_serialize_string, but append the chars which need not escape by block.
+void SrsJsonWriter::escape(const char* v, int size)
+{
+    buf_->append(1, '"');
+
+    const char* start = v;
+    const char* end = v + size;
+    for (const char* p = v; p < end; ++p) {
+        char c = 0;
+        switch (*p) {
+            case '"': c = '"'; break;
+            case '\\': c = '\\'; break;
+            case '\b': c = 'b'; break;
+            case '\f': c = 'f'; break;
+            case '\n': c = 'n'; break;
+            case '\r': c = 'r'; break;
+            case '\t': c = 't'; break;
+            default: continue;
+        }
+
+        buf_->append(start, p - start);
+        buf_->append(1, '\\');
+        buf_->append(1, c);
+        start = p + 1;
+    }
+
+    buf_->append(start, end - start);
+    buf_->append(1, '"');
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////
-
-
@@ -152,4 +152,55 @@ public:
 ////////////////////////////////////////////////////////////////////////
 // JSON encode, please use JSON.dumps() to encode json object.
 
+// The streaming JSON encoder, which writes the tokens directly to the output buffer, without the tree of
+// SrsJsonAny. It's used to encode large objects, for example, the API for lots of streams and clients.
+// For example:
+//        std::string buf;
+//        SrsJsonWriter w(&buf);
+//        w.begin_object();
+//        w.field_str("name", "srs");
+//        w.begin_array("urls");
+//        w.str("rtmp://localhost/live/livestream");
+//        w.end_array();
+//        w.end_object();
+// The buf is {"name":"srs","urls":["rtmp://localhost/live/livestream"]}, the same as SrsJsonAny::dumps().
+// @remark The caller should make sure the tokens are paired, the writer never checks it.
+class SrsJsonWriter
+{
+private:
+    // The output buffer, not owned by writer.
+    std::string* buf_;
+    // Whether there is any value before, so we should write a comma before the next key or value.
+    bool comma_;
+public:
+    SrsJsonWriter(std::string* buf);
+    virtual ~SrsJsonWriter();
+public:
+    void begin_object();
+    void begin_object(const char* k);
+    void end_object();
+    void begin_array();
+    void begin_array(const char* k);
+    void end_array();
+    // Write the key of object field, the value should be written next.
+    void key(const char* k);
+public:
+    void str(const std::string& v);
+    void integer(int64_t v);
+    // The number is formatted by %.2f, the same as SrsJsonAny::dumps().
+    void number(double v);
+    void boolean(bool v);
+    void null();
+public:
+    // Write the field of object, by key and value.
+    void field_str(const char* k, const std::string& v);
+    void field_integer(const char* k, int64_t v);
+    void field_number(const char* k, double v);
+    void field_boolean(const char* k, bool v);
+    void field_null(const char* k);
+private:
+    void token(const char* v, int size);
+    void escape(const char* v, int size);
+};
+
 #endif
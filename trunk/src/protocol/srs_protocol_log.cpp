@@ -7,6 +7,7 @@
 #include <srs_protocol_log.hpp>
 
 #include <stdarg.h>
+#include <signal.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <sstream>
@@ -39,10 +40,16 @@ SrsContextId SrsThreadContext::generate_id()
 
 static SrsContextId _srs_context_default;
 static int _srs_context_key = -1;
+// Whether the context id is updating, the signal handler should not read it, which might be freed. It's thread
+// local, because the context and its coroutine is of the thread interrupted by signal.
+static __thread volatile sig_atomic_t _srs_context_updating = 0;
+// The cid of last destructor. Because the coroutine still points to the cid until the destructor returns, we free it
+// in the next destructor, so the signal handler never reads a freed cid.
+static __thread SrsContextId* _srs_context_zombie = NULL;
 void _srs_context_destructor(void* arg)
 {
-    SrsContextId* cid = (SrsContextId*)arg;
-    srs_freep(cid);
+    srs_freep(_srs_context_zombie);
+    _srs_context_zombie = (SrsContextId*)arg;
 }
 
 const SrsContextId& SrsThreadContext::get_id()
@@ -74,8 +81,11 @@ const SrsContextId& srs_context_set_cid_of(srs_thread_t trd, const SrsContextId&
 {
     ++_srs_pps_cids_set->sugar;
 
+    _srs_context_updating = 1;
+
     if (!trd) {
         _srs_context_default = v;
+        _srs_context_updating = 0;
         return v;
     }
 
@@ -90,9 +100,36 @@ const SrsContextId& srs_context_set_cid_of(srs_thread_t trd, const SrsContextId&
     int r0 = srs_thread_setspecific2(trd, _srs_context_key, cid);
     srs_assert(r0 == 0);
 
+    _srs_context_updating = 0;
+
     return v;
 }
 
+bool srs_context_peek_cid(char* buf, int size)
+{
+    if (_srs_context_updating || size <= 0) {
+        return false;
+    }
+
+    const SrsContextId* cid = &_srs_context_default;
+    if (srs_thread_self() && _srs_context_key >= 0) {
+        void* p = srs_thread_getspecific(_srs_context_key);
+        if (p) {
+            cid = (const SrsContextId*)p;
+        }
+    }
+
+    // Copy the chars without any allocation.
+    const char* v = cid->c_str();
+    int i = 0;
+    for (; i < size - 1 && v[i]; i++) {
+        buf[i] = v[i];
+    }
+    buf[i] = 0;
+
+    return true;
+}
+
 impl_SrsContextRestore::impl_SrsContextRestore(SrsContextId cid)
 {
     cid_ = cid;
@@ -170,42 +207,63 @@ bool srs_log_header(char* buffer, int size, bool utc, bool dangerous, const char
         return false;
     }
     
-    // to calendar time
-    struct tm now;
-    // Each of these functions returns NULL in case an error was detected. @see https://linux.die.net/man/3/localtime_r
-    if (utc) {
-        if (gmtime_r(&tv.tv_sec, &now) == NULL) {
-            return false;
-        }
-    } else {
-        if (localtime_r(&tv.tv_sec, &now) == NULL) {
-            return false;
+    // The formatted time is cached for each thread, because localtime_r and snprintf are slow, so we only
+    // convert the calendar time when the second changed, and format the time when the millisecond changed.
+    // Note that the clock is still read by gettimeofday for each log, which is a vDSO call without syscall.
+    // The buffer is large enough for any int fields, to avoid truncation.
+    static __thread time_t cached_sec = -1;
+    static __thread int cached_ms = -1;
+    static __thread bool cached_utc = false;
+    static __thread char cached_date[80];
+    static __thread char cached_time[96];
+    if (cached_sec != tv.tv_sec || cached_utc != utc) {
+        // to calendar time
+        struct tm now;
+        // Each of these functions returns NULL in case an error was detected. @see https://linux.die.net/man/3/localtime_r
+        if (utc) {
+            if (gmtime_r(&tv.tv_sec, &now) == NULL) {
+                return false;
+            }
+        } else {
+            if (localtime_r(&tv.tv_sec, &now) == NULL) {
+                return false;
+            }
         }
+
+        snprintf(cached_date, sizeof(cached_date), "%d-%02d-%02d %02d:%02d:%02d",
+            1900 + now.tm_year, 1 + now.tm_mon, now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec);
+        cached_sec = tv.tv_sec;
+        cached_utc = utc;
+        cached_ms = -1;
+    }
+    if (cached_ms != (int)(tv.tv_usec / 1000)) {
+        cached_ms = (int)(tv.tv_usec / 1000);
+        snprintf(cached_time, sizeof(cached_time), "%s.%03d", cached_date, cached_ms);
     }
     
     int written = -1;
     if (dangerous) {
         if (tag) {
             written = snprintf(buffer, size,
-                "[%d-%02d-%02d %02d:%02d:%02d.%03d][%s][%d][%s][%d][%s] ",
-                1900 + now.tm_year, 1 + now.tm_mon, now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec, (int)(tv.tv_usec / 1000),
+                "[%s][%s][%d][%s][%d][%s] ",
+                cached_time,
                 level, getpid(), cid.c_str(), errno, tag);
         } else {
             written = snprintf(buffer, size,
-                "[%d-%02d-%02d %02d:%02d:%02d.%03d][%s][%d][%s][%d] ",
-                1900 + now.tm_year, 1 + now.tm_mon, now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec, (int)(tv.tv_usec / 1000),
+                "[%s][%s][%d][%s][%d] ",
+                cached_time,
                 level, getpid(), cid.c_str(), errno);
         }
     } else {
         if (tag) {
             written = snprintf(buffer, size,
-                "[%d-%02d-%02d %02d:%02d:%02d.%03d][%s][%d][%s][%s] ",
-                1900 + now.tm_year, 1 + now.tm_mon, now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec, (int)(tv.tv_usec / 1000),
+                "[%s][%s][%d][%s][%s] ",
+                cached_time,
                 level, getpid(), cid.c_str(), tag);
         } else {
             written = snprintf(buffer, size,
-                "[%d-%02d-%02d %02d:%02d:%02d.%03d][%s][%d][%s] ",
-                1900 + now.tm_year, 1 + now.tm_mon, now.tm_mday, now.tm_hour, now.tm_min, now.tm_sec, (int)(tv.tv_usec / 1000),
+                "[%s][%s][%d][%s] ",
+                cached_time,
                 level, getpid(), cid.c_str());
         }
     }
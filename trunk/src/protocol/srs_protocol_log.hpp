@@ -35,6 +35,11 @@ private:
 // Set the context id of specified thread, not self.
 extern const SrsContextId& srs_context_set_cid_of(srs_thread_t trd, const SrsContextId& v);
 
+// Peek the context id of current coroutine, copy at most size-1 chars to buf, without any allocation, so
+// it's safe to call in signal handler, for example, the CPU profiler.
+// @return false if the context id is updating.
+extern bool srs_context_peek_cid(char* buf, int size);
+
 // The context restore stores the context and restore it when done.
 // Usage:
 //      SrsContextRestore(_srs_context->get_id());
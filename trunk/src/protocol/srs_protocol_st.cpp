@@ -10,6 +10,7 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <poll.h>
 using namespace std;
 
 #include <srs_core_autofree.hpp>
@@ -23,6 +24,7 @@ using namespace std;
 
 #ifdef __linux__
 #include <sys/epoll.h>
+#include <sys/sendfile.h>
 
 bool srs_st_epoll_is_supported(void)
 {
@@ -173,6 +175,22 @@ void srs_thread_yield()
     st_thread_yield();
 }
 
+void srs_thread_set_switch_cb(void (*on_in)(void), void (*on_out)(void))
+{
+    st_set_switch_in_cb(on_in);
+    st_set_switch_out_cb(on_out);
+}
+
+srs_utime_t srs_utime_last_clock()
+{
+    return (srs_utime_t)st_utime_last_clock();
+}
+
+srs_utime_t srs_utime_now()
+{
+    return (srs_utime_t)st_utime();
+}
+
 _ST_THREAD_CREATE_PFN _pfn_st_thread_create = (_ST_THREAD_CREATE_PFN)st_thread_create;
 
 srs_error_t srs_tcp_connect(string server, int port, srs_utime_t tm, srs_netfd_t* pstfd)
@@ -478,6 +496,45 @@ ssize_t srs_read(srs_netfd_t stfd, void *buf, size_t nbyte, srs_utime_t timeout)
     return st_read((st_netfd_t)stfd, buf, nbyte, (st_utime_t)timeout);
 }
 
+ssize_t srs_sendfile(srs_netfd_t stfd, int fd, off_t offset, size_t nbyte, srs_utime_t timeout)
+{
+#ifdef __linux__
+    int osfd = st_netfd_fileno((st_netfd_t)stfd);
+
+    size_t left = nbyte;
+    while (left > 0) {
+        // The socket is non-blocking for ST, so sendfile returns EAGAIN when the send buffer is full.
+        ssize_t nn = ::sendfile(osfd, fd, &offset, left);
+        if (nn < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                return -1;
+            }
+
+            // Wait for socket to be writable, and switch to other coroutines.
+            if (st_netfd_poll((st_netfd_t)stfd, POLLOUT, (st_utime_t)timeout) < 0) {
+                return -1;
+            }
+            continue;
+        }
+
+        // Reach the end of file.
+        if (nn == 0) {
+            break;
+        }
+
+        left -= nn;
+    }
+
+    return (ssize_t)(nbyte - left);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 bool srs_is_never_timeout(srs_utime_t tm)
 {
     return tm == SRS_UTIME_NO_TIMEOUT;
@@ -672,6 +729,38 @@ srs_error_t SrsStSocket::writev(const iovec *iov, int iov_size, ssize_t* nwrite)
     return err;
 }
 
+srs_error_t SrsStSocket::sendfile(int fd, off_t offset, size_t size, ssize_t* nwrite)
+{
+    srs_error_t err = srs_success;
+
+    srs_assert(stfd_);
+
+    ssize_t nb_write;
+    if (stm == SRS_UTIME_NO_TIMEOUT) {
+        nb_write = srs_sendfile(stfd_, fd, offset, size, ST_UTIME_NO_TIMEOUT);
+    } else {
+        nb_write = srs_sendfile(stfd_, fd, offset, size, stm);
+    }
+
+    if (nwrite) {
+        *nwrite = nb_write;
+    }
+
+    // On success a non-negative integer equal to nbyte is returned.
+    // Otherwise, a value of -1 is returned and errno is set to indicate the error.
+    if (nb_write != (ssize_t)size) {
+        if (nb_write < 0 && errno == ETIME) {
+            return srs_error_new(ERROR_SOCKET_TIMEOUT, "sendfile timeout %d ms", srsu2msi(stm));
+        }
+
+        return srs_error_new(ERROR_SOCKET_WRITE, "sendfile, size=%d, nn=%d", (int)size, (int)nb_write);
+    }
+
+    sbytes += nb_write;
+
+    return err;
+}
+
 SrsTcpClient::SrsTcpClient(string h, int p, srs_utime_t tm)
 {
     stfd_ = NULL;
@@ -48,6 +48,14 @@ extern int srs_thread_join(srs_thread_t thread, void **retvalp);
 extern void srs_thread_interrupt(srs_thread_t thread);
 extern void srs_thread_yield();
 
+// Set the context switch callbacks of ST for current thread, NULL to remove it. The callbacks are never called for
+// the idle thread, which waits for events by epoll.
+extern void srs_thread_set_switch_cb(void (*on_in)(void), void (*on_out)(void));
+// The last clock of ST scheduler, which changes for each round of event loop, after epoll wait.
+extern srs_utime_t srs_utime_last_clock();
+// The current clock of ST, never cached.
+extern srs_utime_t srs_utime_now();
+
 // For utest to mock the thread create.
 typedef void* (*_ST_THREAD_CREATE_PFN)(void *(*start)(void *arg), void *arg, int joinable, int stack_size);
 extern _ST_THREAD_CREATE_PFN _pfn_st_thread_create;
@@ -96,6 +104,10 @@ extern srs_netfd_t srs_accept(srs_netfd_t stfd, struct sockaddr *addr, int *addr
 
 extern ssize_t srs_read(srs_netfd_t stfd, void *buf, size_t nbyte, srs_utime_t timeout);
 
+// Send nbyte of file fd from offset to the socket stfd by sendfile(2), yield to other coroutines when socket is not
+// writable. Return the bytes sent, which is less than nbyte if file EOF, or -1 and errno is set for error.
+extern ssize_t srs_sendfile(srs_netfd_t stfd, int fd, off_t offset, size_t nbyte, srs_utime_t timeout);
+
 extern bool srs_is_never_timeout(srs_utime_t tm);
 
 // The mutex locker.
@@ -120,7 +132,7 @@ public:
 
 // the socket provides TCP socket over st,
 // that is, the sync socket mechanism.
-class SrsStSocket : public ISrsProtocolReadWriter
+class SrsStSocket : public ISrsProtocolReadWriter, public ISrsProtocolSendfile
 {
 private:
     // The recv/send timeout in srs_utime_t.
@@ -152,6 +164,9 @@ public:
     // @param nwrite, the actual write bytes, ignore if NULL.
     virtual srs_error_t write(void* buf, size_t size, ssize_t* nwrite);
     virtual srs_error_t writev(const iovec *iov, int iov_size, ssize_t* nwrite);
+// Interface ISrsProtocolSendfile
+public:
+    virtual srs_error_t sendfile(int fd, off_t offset, size_t size, ssize_t* nwrite);
 };
 
 // The client to connect to server over TCP.
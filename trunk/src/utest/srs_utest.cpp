@@ -84,6 +84,17 @@ srs_error_t prepare_main() {
 // Free global data, for address sanitizer.
 extern void srs_free_global_system_ips();
 
+// Yield after each test, to refresh the clock of ST. The clock is only updated when switching to the idle
+// coroutine, so it's stale if tests never yield, for example, the benchmarks and the tests with mock IO, and
+// the timeout of next test expires immediately, for example, TCPServerTest.PingPong.
+class MockClockRefresher : public testing::EmptyTestEventListener
+{
+public:
+    virtual void OnTestEnd(const testing::TestInfo& /*info*/) {
+        srs_usleep(0);
+    }
+};
+
 // We could do something in the main of utest.
 // Copy from gtest-1.6.0/src/gtest_main.cc
 GTEST_API_ int main(int argc, char **argv) {
@@ -100,6 +111,7 @@ GTEST_API_ int main(int argc, char **argv) {
     }
 
     testing::InitGoogleTest(&argc, argv);
+    testing::UnitTest::GetInstance()->listeners().Append(new MockClockRefresher());
     int r0 = RUN_ALL_TESTS();
 
     srs_free_global_system_ips();
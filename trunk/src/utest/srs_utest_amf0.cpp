@@ -15,6 +15,7 @@ using namespace std;
 #include <srs_core_autofree.hpp>
 #include <srs_protocol_json.hpp>
 #include <srs_kernel_buffer.hpp>
+#include <srs_kernel_utility.hpp>
 using namespace srs_internal;
 
 /**
@@ -2842,3 +2843,151 @@ VOID TEST(ProtocolJSONTest, ParseSpecial)
     }
 }
 
+
+VOID TEST(ProtocolJSONTest, Writer)
+{
+    // The writer should encode the same as the tree of json.
+    if (true) {
+        SrsJsonObject* obj = SrsJsonAny::object();
+        SrsAutoFree(SrsJsonObject, obj);
+
+        obj->set("code", SrsJsonAny::integer(-100));
+        obj->set("name", SrsJsonAny::str("he\"l\\lo\n\t视频"));
+        obj->set("alive", SrsJsonAny::number(1.5));
+        obj->set("publish", SrsJsonAny::boolean(false));
+        obj->set("video", SrsJsonAny::null());
+
+        SrsJsonArray* arr = SrsJsonAny::array();
+        obj->set("streams", arr);
+        arr->append(SrsJsonAny::object());
+        SrsJsonObject* stream = SrsJsonAny::object();
+        arr->append(stream);
+        stream->set("id", SrsJsonAny::str("vid-1"));
+        stream->set("kbps", SrsJsonAny::object()->set("recv_30s", SrsJsonAny::integer(100)));
+        arr->append(SrsJsonAny::array());
+        arr->append(SrsJsonAny::boolean(true));
+
+        string buf;
+        SrsJsonWriter w(&buf);
+        w.begin_object();
+        w.field_integer("code", -100);
+        w.field_str("name", "he\"l\\lo\n\t视频");
+        w.field_number("alive", 1.5);
+        w.field_boolean("publish", false);
+        w.field_null("video");
+        w.begin_array("streams");
+        w.begin_object();
+        w.end_object();
+        w.begin_object();
+        w.field_str("id", "vid-1");
+        w.begin_object("kbps");
+        w.field_integer("recv_30s", 100);
+        w.end_object();
+        w.end_object();
+        w.begin_array();
+        w.end_array();
+        w.boolean(true);
+        w.end_array();
+        w.end_object();
+
+        EXPECT_STREQ(obj->dumps().c_str(), buf.c_str());
+
+        SrsJsonAny* p = SrsJsonAny::loads(buf);
+        ASSERT_TRUE(p != NULL);
+        EXPECT_TRUE(p->is_object());
+        srs_freep(p);
+    }
+
+    // Append to the buffer, and write the values of array.
+    if (true) {
+        string buf = "cb(";
+        SrsJsonWriter w(&buf);
+        w.begin_array();
+        w.integer(1);
+        w.str("");
+        w.number(-0.125);
+        w.null();
+        w.end_array();
+        EXPECT_STREQ("cb([1,\"\",-0.12,null]", buf.c_str());
+    }
+}
+
+// Write the object like the client of statistic, by tree of json or by writer.
+void mock_json_client(SrsJsonObject* obj, int i)
+{
+    obj->set("id", SrsJsonAny::str("client-id-00000000"));
+    obj->set("vhost", SrsJsonAny::str("vid-00000001"));
+    obj->set("ip", SrsJsonAny::str("192.168.1.100"));
+    obj->set("url", SrsJsonAny::str("/live/livestream"));
+    obj->set("publish", SrsJsonAny::boolean(false));
+    obj->set("alive", SrsJsonAny::number(i / 1000.0));
+    obj->set("send_bytes", SrsJsonAny::integer(i * 1000));
+
+    SrsJsonObject* okbps = SrsJsonAny::object();
+    obj->set("kbps", okbps);
+    okbps->set("recv_30s", SrsJsonAny::integer(i));
+    okbps->set("send_30s", SrsJsonAny::integer(i));
+}
+
+void mock_json_client(SrsJsonWriter* w, int i)
+{
+    w->begin_object();
+    w->field_str("id", "client-id-00000000");
+    w->field_str("vhost", "vid-00000001");
+    w->field_str("ip", "192.168.1.100");
+    w->field_str("url", "/live/livestream");
+    w->field_boolean("publish", false);
+    w->field_number("alive", i / 1000.0);
+    w->field_integer("send_bytes", i * 1000);
+
+    w->begin_object("kbps");
+    w->field_integer("recv_30s", i);
+    w->field_integer("send_30s", i);
+    w->end_object();
+    w->end_object();
+}
+
+VOID TEST(ProtocolJSONTest, BenchmarkWriter)
+{
+    const int nn_clients = 20000;
+
+    // Build the tree of json, then dumps to string, as API did before.
+    srs_utime_t starttime = srs_update_system_time();
+    string tree;
+    if (true) {
+        SrsJsonObject* obj = SrsJsonAny::object();
+        SrsAutoFree(SrsJsonObject, obj);
+
+        obj->set("code", SrsJsonAny::integer(0));
+        SrsJsonArray* arr = SrsJsonAny::array();
+        obj->set("clients", arr);
+        for (int i = 0; i < nn_clients; i++) {
+            SrsJsonObject* client = SrsJsonAny::object();
+            arr->append(client);
+            mock_json_client(client, i);
+        }
+        tree = obj->dumps();
+    }
+    srs_utime_t tree_cost = srs_max(1, srs_update_system_time() - starttime);
+
+    // Write to buffer by the streaming writer.
+    starttime = srs_update_system_time();
+    string buf;
+    if (true) {
+        SrsJsonWriter w(&buf);
+        w.begin_object();
+        w.field_integer("code", 0);
+        w.begin_array("clients");
+        for (int i = 0; i < nn_clients; i++) {
+            mock_json_client(&w, i);
+        }
+        w.end_array();
+        w.end_object();
+    }
+    srs_utime_t writer_cost = srs_max(1, srs_update_system_time() - starttime);
+
+    EXPECT_TRUE(tree == buf);
+
+    printf("Dumps %d clients %d bytes, by json tree %dms, by json writer %dms\n", nn_clients, (int)buf.length(),
+        srsu2msi(tree_cost), srsu2msi(writer_cost));
+}
@@ -5,6 +5,12 @@
 //
 #include <srs_utest_app.hpp>
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
 using namespace std;
 
 #include <srs_kernel_error.hpp>
@@ -15,6 +21,27 @@ using namespace std;
 #include <srs_app_st.hpp>
 #include <srs_protocol_conn.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_kernel_utility.hpp>
+#include <srs_app_hls.hpp>
+#include <srs_app_threads.hpp>
+#include <srs_kernel_ts.hpp>
+#include <srs_utest_kernel.hpp>
+#include <srs_app_log.hpp>
+#include <srs_core_autofree.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_app_source.hpp>
+#include <srs_protocol_kbps.hpp>
+#include <srs_protocol_rtmp_stack.hpp>
+#include <srs_protocol_rtmp_msg_array.hpp>
+#include <srs_protocol_json.hpp>
+#include <srs_protocol_log.hpp>
+#include <srs_app_hourglass.hpp>
+#include <srs_app_utility.hpp>
+#include <srs_utest_protocol.hpp>
+#include <srs_utest_config.hpp>
+#ifdef SRS_FFMPEG_FIT
+#include <srs_app_rtc_codec.hpp>
+#endif
 
 class MockIDResource : public ISrsResource
 {
@@ -127,6 +154,337 @@ VOID TEST(AppResourceManagerTest, FindByFastID)
     }
 }
 
+VOID TEST(AppResourceManagerTest, FindByAddr)
+{
+    srs_error_t err = srs_success;
+
+    sockaddr_in a4;
+    memset(&a4, 0, sizeof(a4));
+    a4.sin_family = AF_INET;
+    a4.sin_port = htons(8000);
+    a4.sin_addr.s_addr = htonl(0x0a000001);
+
+    sockaddr_in6 a6;
+    memset(&a6, 0, sizeof(a6));
+    a6.sin6_family = AF_INET6;
+    a6.sin6_port = htons(8000);
+    inet_pton(AF_INET6, "2001:db8::1", &a6.sin6_addr);
+
+    if (true) {
+        SrsResourceManager m("test");
+        HELPER_EXPECT_SUCCESS(m.start());
+
+        MockIDResource* r1 = new MockIDResource(1);
+        MockIDResource* r2 = new MockIDResource(2);
+        m.add_with_addr((sockaddr*)&a4, r1);
+        m.add_with_addr((sockaddr*)&a6, r2);
+        EXPECT_EQ(2, (int)m.size());
+        EXPECT_EQ(1, ((MockIDResource*)m.find_by_addr((sockaddr*)&a4))->id);
+        EXPECT_EQ(2, ((MockIDResource*)m.find_by_addr((sockaddr*)&a6))->id);
+
+        // Different port is different address.
+        sockaddr_in b4 = a4;
+        b4.sin_port = htons(8001);
+        EXPECT_TRUE(m.find_by_addr((sockaddr*)&b4) == NULL);
+
+        // Same address of another family.
+        sockaddr_in6 b6 = a6;
+        b6.sin6_port = htons(8001);
+        EXPECT_TRUE(m.find_by_addr((sockaddr*)&b6) == NULL);
+
+        // A resource might have multiple addresses.
+        m.add_with_addr((sockaddr*)&b6, r1);
+        EXPECT_EQ(1, ((MockIDResource*)m.find_by_addr((sockaddr*)&b6))->id);
+        EXPECT_EQ(2, (int)m.size());
+
+        m.remove(r1); srs_usleep(0);
+        EXPECT_TRUE(m.find_by_addr((sockaddr*)&a4) == NULL);
+        EXPECT_TRUE(m.find_by_addr((sockaddr*)&b6) == NULL);
+        EXPECT_EQ(2, ((MockIDResource*)m.find_by_addr((sockaddr*)&a6))->id);
+
+        m.remove(r2); srs_usleep(0);
+        EXPECT_TRUE(m.find_by_addr((sockaddr*)&a6) == NULL);
+    }
+
+    // The address is reused by another resource.
+    if (true) {
+        SrsResourceAddrTable t;
+        MockIDResource r1(1), r2(2);
+
+        SrsSockaddrKey key;
+        EXPECT_TRUE(key.parse((sockaddr*)&a4));
+        t.set(key, &r1);
+        t.set(key, &r2);
+        EXPECT_EQ(1, (int)t.size());
+        EXPECT_EQ(2, ((MockIDResource*)t.find(key))->id);
+
+        t.erase(&r1);
+        EXPECT_EQ(2, ((MockIDResource*)t.find(key))->id);
+
+        t.erase(&r2);
+        EXPECT_TRUE(t.find(key) == NULL);
+        EXPECT_EQ(0, (int)t.size());
+    }
+
+    // Grow and cleanup the deleted slots.
+    if (true) {
+        SrsResourceAddrTable t;
+        vector<MockIDResource*> rs;
+        for (int i = 0; i < 1000; i++) {
+            rs.push_back(new MockIDResource(i));
+
+            sockaddr_in addr = a4;
+            addr.sin_port = htons(10000 + i);
+            SrsSockaddrKey key;
+            key.parse((sockaddr*)&addr);
+            t.set(key, rs.at(i));
+        }
+        EXPECT_EQ(1000, (int)t.size());
+        EXPECT_TRUE(t.capacity() * 3 >= t.size() * 4);
+
+        for (int i = 0; i < 1000; i += 2) {
+            t.erase(rs.at(i));
+        }
+        EXPECT_EQ(500, (int)t.size());
+
+        for (int i = 0; i < 1000; i++) {
+            sockaddr_in addr = a4;
+            addr.sin_port = htons(10000 + i);
+            SrsSockaddrKey key;
+            key.parse((sockaddr*)&addr);
+
+            MockIDResource* r = (MockIDResource*)t.find(key);
+            if (i % 2) {
+                EXPECT_TRUE(r && r->id == i);
+            } else {
+                EXPECT_TRUE(r == NULL);
+            }
+        }
+
+        for (int i = 0; i < 1000; i++) {
+            srs_freep(rs[i]);
+        }
+    }
+
+    // Unknown address family.
+    if (true) {
+        sockaddr_storage addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.ss_family = AF_UNIX;
+
+        SrsSockaddrKey key;
+        EXPECT_FALSE(key.parse((sockaddr*)&addr));
+    }
+}
+
+VOID TEST(AppResourceManagerTest, BenchmarkFindByAddr)
+{
+    // Build 50k sessions, half IPv4 and half IPv6.
+    const int nn_sessions = 50000;
+    vector<sockaddr_storage> addrs(nn_sessions);
+    vector<string> ids(nn_sessions);
+    for (int i = 0; i < nn_sessions; i++) {
+        sockaddr_storage& addr = addrs[i];
+        memset(&addr, 0, sizeof(addr));
+
+        char buf[128];
+        if (i % 2) {
+            sockaddr_in* a4 = (sockaddr_in*)&addr;
+            a4->sin_family = AF_INET;
+            a4->sin_port = htons(1024 + i % 50000);
+            a4->sin_addr.s_addr = htonl(0x0a000000 + i);
+            snprintf(buf, sizeof(buf), "%s:%d", inet_ntoa(a4->sin_addr), ntohs(a4->sin_port));
+        } else {
+            sockaddr_in6* a6 = (sockaddr_in6*)&addr;
+            a6->sin6_family = AF_INET6;
+            a6->sin6_port = htons(1024 + i % 50000);
+            inet_pton(AF_INET6, "2001:db8::", &a6->sin6_addr);
+            memcpy(&a6->sin6_addr.s6_addr[12], &i, 4);
+            char ip[64];
+            inet_ntop(AF_INET6, &a6->sin6_addr, ip, sizeof(ip));
+            snprintf(buf, sizeof(buf), "%s:%d", ip, ntohs(a6->sin6_port));
+        }
+        ids[i] = buf;
+    }
+
+    MockIDResource r(1);
+    SrsResourceAddrTable t;
+    map<string, ISrsResource*> m;
+    for (int i = 0; i < nn_sessions; i++) {
+        SrsSockaddrKey key;
+        key.parse((sockaddr*)&addrs[i]);
+        t.set(key, &r);
+        m[ids[i]] = &r;
+    }
+    EXPECT_EQ(nn_sessions, (int)t.size());
+
+    const int nn_lookups = 500000;
+    int nn_found = 0;
+
+    // Lookup by raw address, as RTC server does for each packet.
+    srs_utime_t starttime = srs_update_system_time();
+    for (int i = 0; i < nn_lookups; i++) {
+        SrsSockaddrKey key;
+        key.parse((sockaddr*)&addrs[(uint64_t)i * 7919 % nn_sessions]);
+        if (t.find(key)) nn_found++;
+    }
+    srs_utime_t table_cost = srs_max(1, srs_update_system_time() - starttime);
+    EXPECT_EQ(nn_lookups, nn_found);
+
+    // Lookup by peer id string, as RTC server did before.
+    nn_found = 0;
+    starttime = srs_update_system_time();
+    for (int i = 0; i < nn_lookups; i++) {
+        sockaddr_storage& addr = addrs[(uint64_t)i * 7919 % nn_sessions];
+        char ip[64], buf[128];
+        if (addr.ss_family == AF_INET) {
+            inet_ntop(AF_INET, &((sockaddr_in*)&addr)->sin_addr, ip, sizeof(ip));
+        } else {
+            inet_ntop(AF_INET6, &((sockaddr_in6*)&addr)->sin6_addr, ip, sizeof(ip));
+        }
+        snprintf(buf, sizeof(buf), "%s:%d", ip, ntohs(((sockaddr_in*)&addr)->sin_port));
+        if (m.find(buf) != m.end()) nn_found++;
+    }
+    srs_utime_t map_cost = srs_max(1, srs_update_system_time() - starttime);
+    EXPECT_EQ(nn_lookups, nn_found);
+
+    printf("Find %d sessions by addr table %.0f lookups/s, by peer id map %.0f lookups/s\n", nn_sessions,
+        nn_lookups * 1000000.0 / table_cost, nn_lookups * 1000000.0 / map_cost);
+}
+
+VOID TEST(AppResourceManagerTest, ResourceHook)
+{
+    srs_error_t err = srs_success;
+
+    // Iterate resources by index, and the index is changed after disposing.
+    if (true) {
+        SrsResourceManager m("test");
+        HELPER_EXPECT_SUCCESS(m.start());
+
+        MockIDResource* rs[4];
+        for (int i = 0; i < 4; i++) {
+            rs[i] = new MockIDResource(i);
+            m.add(rs[i]);
+            m.add(rs[i]); // Ignore if exists.
+        }
+        EXPECT_EQ(4, (int)m.size());
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ(i, ((MockIDResource*)m.at(i))->id);
+        }
+        EXPECT_EQ(1, ((MockIDResource*)m.at(1))->id);
+        EXPECT_TRUE(m.at(4) == NULL);
+        EXPECT_TRUE(m.at(-1) == NULL);
+
+        m.remove(rs[1]);
+        m.remove(rs[1]); // Ignore if in zombies.
+        srs_usleep(0);
+        EXPECT_EQ(3, (int)m.size());
+        EXPECT_EQ(0, ((MockIDResource*)m.at(0))->id);
+        EXPECT_EQ(2, ((MockIDResource*)m.at(1))->id);
+        EXPECT_EQ(3, ((MockIDResource*)m.at(2))->id);
+    }
+
+    // Only remove the keys of resource, ignore the key overwritten by other resource.
+    if (true) {
+        SrsResourceManager m("test");
+        HELPER_EXPECT_SUCCESS(m.start());
+
+        MockIDResource* r1 = new MockIDResource(1);
+        MockIDResource* r2 = new MockIDResource(2);
+        m.add_with_name("srs", r1);
+        m.add_with_id("100", r1);
+        m.add_with_fast_id(101, r1);
+        m.add_with_name("srs", r2);
+        m.add_with_id("200", r2);
+        EXPECT_EQ(2, (int)m.size());
+        EXPECT_EQ(2, ((MockIDResource*)m.find_by_name("srs"))->id);
+
+        m.remove(r1); srs_usleep(0);
+        EXPECT_EQ(1, (int)m.size());
+        EXPECT_EQ(2, ((MockIDResource*)m.find_by_name("srs"))->id);
+        EXPECT_TRUE(m.find_by_id("100") == NULL);
+        EXPECT_TRUE(m.find_by_fast_id(101) == NULL);
+        EXPECT_EQ(2, ((MockIDResource*)m.find_by_id("200"))->id);
+
+        m.remove(r2); srs_usleep(0);
+        EXPECT_TRUE(m.empty());
+        EXPECT_TRUE(m.find_by_name("srs") == NULL);
+        EXPECT_TRUE(m.find_by_id("200") == NULL);
+    }
+
+    // Record the keys once, although the resource is added again with the same key.
+    if (true) {
+        SrsResourceManager m("test");
+        HELPER_EXPECT_SUCCESS(m.start());
+
+        MockIDResource* r = new MockIDResource(1);
+        for (int i = 0; i < 3; i++) {
+            m.add_with_name("srs", r);
+            m.add_with_id("100", r);
+            m.add_with_fast_id(101, r);
+        }
+        EXPECT_EQ(1, (int)m.size());
+        EXPECT_EQ(1, (int)r->resource_hook_.names.size());
+        EXPECT_EQ(1, (int)r->resource_hook_.ids.size());
+        EXPECT_EQ(1, (int)r->resource_hook_.fast_ids.size());
+
+        m.remove(r); srs_usleep(0);
+        EXPECT_TRUE(m.empty());
+        EXPECT_TRUE(m.find_by_id("100") == NULL);
+        EXPECT_TRUE(m.find_by_fast_id(101) == NULL);
+    }
+}
+
+VOID TEST(AppResourceManagerTest, BenchmarkChurn)
+{
+    srs_error_t err = srs_success;
+
+    SrsResourceManager m("test");
+    HELPER_EXPECT_SUCCESS(m.start());
+
+    // Build 100k live connections.
+    const int nn_conns = 100000;
+    vector<MockIDResource*> rs;
+    for (int i = 0; i < nn_conns; i++) {
+        MockIDResource* r = new MockIDResource(i);
+        rs.push_back(r);
+        m.add_with_fast_id((uint64_t)i + 1, r);
+    }
+    EXPECT_EQ(nn_conns, (int)m.size());
+
+    // Churn 20k connections, remove the old then add the new, as 2k connects/s in 10s.
+    const int nn_churn = 20000;
+    srs_utime_t starttime = srs_update_system_time();
+    for (int i = 0; i < nn_churn; i++) {
+        int index = (int)(((uint64_t)i * 7919) % nn_conns);
+        m.remove(rs[index]);
+
+        MockIDResource* r = new MockIDResource(nn_conns + i);
+        rs[index] = r;
+        m.add_with_fast_id((uint64_t)(nn_conns + i) + 1, r);
+
+        // Dispose the zombies for each 100 connections.
+        if ((i % 100) == 99) {
+            srs_usleep(0);
+        }
+    }
+    srs_usleep(0);
+    srs_utime_t churn_cost = srs_max(1, srs_update_system_time() - starttime);
+    EXPECT_EQ(nn_conns, (int)m.size());
+
+    // Iterate all connections by index, as RTC server does.
+    int nn_found = 0;
+    starttime = srs_update_system_time();
+    for (int i = 0; i < (int)m.size(); i++) {
+        if (m.at(i)) nn_found++;
+    }
+    srs_utime_t iterate_cost = srs_max(1, srs_update_system_time() - starttime);
+    EXPECT_EQ(nn_conns, nn_found);
+
+    printf("Churn %d of %d connections %dms, iterate all %dms\n", nn_churn, nn_conns, srsu2msi(churn_cost),
+        srsu2msi(iterate_cost));
+}
+
 VOID TEST(AppCoroutineTest, Dummy)
 {
     SrsDummyCoroutine dc;
@@ -783,3 +1141,1457 @@ VOID TEST(AppSecurity, CheckSecurity)
     //       4. deny if matches deny strategy.
 }
 
+
+VOID TEST(AppThreadsTest, SpscQueue)
+{
+    if (true) {
+        SrsThreadSpscQueue<int> q(3);
+        EXPECT_EQ(4, q.capacity());
+        EXPECT_EQ(0, q.size());
+
+        for (int i = 0; i < 4; i++) {
+            EXPECT_TRUE(q.push(i));
+        }
+        EXPECT_FALSE(q.push(4));
+        EXPECT_EQ(4, q.size());
+
+        int v = -1;
+        EXPECT_TRUE(q.pop(v));
+        EXPECT_EQ(0, v);
+        EXPECT_TRUE(q.push(4));
+
+        for (int i = 1; i < 5; i++) {
+            EXPECT_TRUE(q.pop(v));
+            EXPECT_EQ(i, v);
+        }
+        EXPECT_FALSE(q.pop(v));
+        EXPECT_EQ(0, q.size());
+    }
+
+    if (true) {
+        SrsThreadSpscQueue<int> q(0);
+        EXPECT_EQ(1, q.capacity());
+        EXPECT_TRUE(q.push(1));
+        EXPECT_FALSE(q.push(2));
+    }
+}
+
+class MockThreadTask : public SrsThreadTask
+{
+public:
+    int* executed_;
+public:
+    MockThreadTask(SrsThreadTaskContext* ctx, int* executed) : SrsThreadTask(ctx) {
+        executed_ = executed;
+    }
+protected:
+    virtual void execute() {
+        (*executed_)++;
+    }
+};
+
+VOID TEST(AppThreadsTest, WorkerTaskContext)
+{
+    // The tasks are executed in order, and the pending is decreased.
+    if (true) {
+        int executed = 0;
+        SrsThreadWorker worker(0, 16);
+        SrsThreadTaskContext* ctx = new SrsThreadTaskContext();
+
+        worker.push(new MockThreadTask(ctx, &executed));
+        worker.push(new MockThreadTask(ctx, &executed));
+        EXPECT_EQ(2, worker.depth());
+        EXPECT_EQ(2, ctx->pending());
+
+        EXPECT_TRUE(worker.consume());
+        EXPECT_EQ(1, executed);
+        EXPECT_EQ(1, ctx->pending());
+
+        EXPECT_TRUE(worker.consume());
+        EXPECT_FALSE(worker.consume());
+        EXPECT_EQ(2, executed);
+        EXPECT_EQ(0, ctx->pending());
+        EXPECT_EQ(2, (int)worker.tasks());
+
+        ctx->cancel();
+    }
+
+    // The tasks are dropped after the context is canceled, and freed by worker.
+    if (true) {
+        int executed = 0;
+        SrsThreadWorker worker(0, 16);
+        SrsThreadTaskContext* ctx = new SrsThreadTaskContext();
+
+        worker.push(new MockThreadTask(ctx, &executed));
+        worker.push(new MockThreadTask(ctx, &executed));
+        worker.push(new MockThreadTask(ctx, &executed));
+        ctx->cancel();
+
+        EXPECT_TRUE(worker.consume());
+        EXPECT_EQ(0, executed);
+        EXPECT_EQ(2, worker.depth());
+    }
+}
+
+VOID TEST(AppLogTest, RingBuffer)
+{
+    char buf[64];
+
+    if (true) {
+        SrsLogRing ring(30);
+        EXPECT_EQ(0, ring.size());
+
+        char line[] = "0123456789abcde\n";
+        iovec iov = {line, 16};
+        EXPECT_TRUE(ring.write(&iov, 1));
+        EXPECT_TRUE(ring.write(&iov, 1));
+        EXPECT_FALSE(ring.write(&iov, 1));
+        EXPECT_EQ(32, ring.size());
+
+        // Only read the whole lines, if buffer is not large enough.
+        EXPECT_EQ(16, ring.read(buf, 20));
+        EXPECT_EQ(0, memcmp(buf, line, 16));
+        EXPECT_EQ(0, ring.read(buf, 10));
+
+        // Write the data which wraps around.
+        iovec iovs[2] = {{line, 10}, {line + 10, 6}};
+        EXPECT_TRUE(ring.write(iovs, 2));
+        EXPECT_EQ(32, ring.size());
+
+        EXPECT_EQ(32, ring.read(buf, sizeof(buf)));
+        EXPECT_EQ(0, memcmp(buf, line, 16));
+        EXPECT_EQ(0, memcmp(buf + 16, line, 16));
+        EXPECT_EQ(0, ring.size());
+        EXPECT_EQ(0, ring.read(buf, sizeof(buf)));
+    }
+}
+
+void mock_async_log(SrsFileLog* log, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    log->log(SrsLogLevelTrace, NULL, SrsContextId(), fmt, args);
+    va_end(args);
+}
+
+VOID TEST(AppLogTest, AsyncLog)
+{
+    string filename = "/tmp/srs-utest-async.log";
+    ::unlink(filename.c_str());
+
+    SrsFileLog log;
+    log.async_ = true;
+    log.flush_data_ = new char[64 * 1024];
+    log.log_to_file_tank = true;
+    log.fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(log.fd > 0);
+
+    // The logs are written to ring, until flush.
+    mock_async_log(&log, "Hello %s", "world");
+    mock_async_log(&log, "Hello %d", 2);
+    EXPECT_EQ(1, (int)log.rings_.size());
+    EXPECT_EQ(0, (int)log.flushed());
+
+    int nn = log.flush();
+    EXPECT_GT(nn, 0);
+    EXPECT_EQ(nn, (int)log.flushed());
+    EXPECT_EQ(0, log.flush());
+
+    if (true) {
+        char buf[1024];
+        int r0 = ::pread(log.fd, buf, sizeof(buf) - 1, 0);
+        ASSERT_EQ(nn, r0);
+        buf[r0] = 0;
+
+        string content = buf;
+        EXPECT_TRUE(content.find("Hello world\n") != string::npos);
+        EXPECT_TRUE(content.find("Hello 2\n") != string::npos);
+        EXPECT_EQ('\n', buf[r0 - 1]);
+    }
+
+    // The logs are dropped if ring is full, never block.
+    string large(4000, 'x');
+    for (int i = 0; i < 1024; i++) {
+        mock_async_log(&log, "%s", large.c_str());
+    }
+    EXPECT_GT(log.dropped(), 0);
+    EXPECT_LT(log.dropped(), 1024);
+
+    // All lines are written in batch.
+    int written = log.flush();
+    EXPECT_EQ(0, (int)(log.rings_.at(0)->size()));
+    EXPECT_GT(written, 64 * 1024);
+
+    ::unlink(filename.c_str());
+}
+
+void* mock_log_flusher(void* arg)
+{
+    srs_error_t err = SrsFileLog::start_flusher(arg);
+    srs_freep(err);
+    return NULL;
+}
+
+VOID TEST(AppLogTest, AsyncLogStopFlusher)
+{
+    string filename = "/tmp/srs-utest-async-stop.log";
+    ::unlink(filename.c_str());
+
+    SrsFileLog* log = new SrsFileLog();
+    log->async_ = true;
+    log->flush_data_ = new char[64 * 1024];
+    log->log_to_file_tank = true;
+    log->fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_TRUE(log->fd > 0);
+
+    SrsThreadEntry entry;
+    ASSERT_EQ(0, pthread_create(&entry.trd, NULL, mock_log_flusher, log));
+    log->flusher_ = &entry;
+    mock_async_log(log, "Hello %s", "flusher");
+
+    // The flusher is stopped and joined, and the left logs are written, before freeing the rings.
+    int fd = ::dup(log->fd);
+    srs_freep(log);
+
+    if (true) {
+        char buf[1024];
+        int r0 = ::pread(fd, buf, sizeof(buf) - 1, 0);
+        ASSERT_GT(r0, 0);
+        buf[r0] = 0;
+        EXPECT_TRUE(string(buf).find("Hello flusher\n") != string::npos);
+    }
+
+    ::close(fd);
+    ::unlink(filename.c_str());
+}
+
+void* mock_hls_mux_worker(void* arg)
+{
+    SrsThreadWorker* worker = (SrsThreadWorker*)arg;
+
+    // Consume later, after the channel is waiting.
+    usleep(50 * 1000);
+    while (worker->consume()) {
+    }
+
+    return NULL;
+}
+
+VOID TEST(AppHlsTest, MuxWorkerWrite)
+{
+    srs_error_t err;
+
+    if (true) {
+        SrsThreadWorker worker(0, 16);
+        SrsHlsMuxChannel channel(&worker);
+        HELPER_ASSERT_SUCCESS(channel.initialize());
+
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.ts"));
+        SrsTsContext ctx;
+        SrsTsContextWriter tscw(&fw, &ctx, SrsAudioCodecIdAAC, SrsVideoCodecIdDisabled);
+
+        for (int i = 0; i < 2; i++) {
+            SrsTsMessage* msg = new SrsTsMessage();
+            msg->sid = SrsTsPESStreamIdAudioCommon;
+            msg->dts = msg->pts = i * 90 * 20;
+            msg->payload->append("\xff\xf1\x50\x80\x01\x3f\xfc\x01", 8);
+            HELPER_ASSERT_SUCCESS(channel.write_audio(&tscw, msg));
+        }
+        EXPECT_EQ(2, worker.depth());
+        EXPECT_EQ(0, (int)fw.filesize());
+
+        // Consume in the same thread, then drain should not wait.
+        EXPECT_TRUE(worker.consume());
+        EXPECT_TRUE(worker.consume());
+        EXPECT_FALSE(worker.consume());
+        EXPECT_EQ(0, worker.depth());
+        EXPECT_EQ(2, (int)worker.tasks());
+
+        HELPER_EXPECT_SUCCESS(channel.drain());
+        EXPECT_TRUE(fw.filesize() > 0);
+        EXPECT_EQ(0, (int)(fw.filesize() % 188));
+    }
+
+    // The error of worker should be reported by drain or next write.
+    if (true) {
+        SrsThreadWorker worker(0, 16);
+        SrsHlsMuxChannel channel(&worker);
+        HELPER_ASSERT_SUCCESS(channel.initialize());
+
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.ts"));
+        fw.error_offset = 0;
+        SrsTsContext ctx;
+        SrsTsContextWriter tscw(&fw, &ctx, SrsAudioCodecIdAAC, SrsVideoCodecIdDisabled);
+
+        SrsTsMessage* msg = new SrsTsMessage();
+        msg->sid = SrsTsPESStreamIdAudioCommon;
+        msg->payload->append("\xff\xf1\x50\x80\x01\x3f\xfc\x01", 8);
+        HELPER_ASSERT_SUCCESS(channel.write_audio(&tscw, msg));
+        EXPECT_TRUE(worker.consume());
+
+        msg = new SrsTsMessage();
+        msg->sid = SrsTsPESStreamIdAudioCommon;
+        msg->payload->append("\xff\xf1\x50\x80\x01\x3f\xfc\x01", 8);
+        HELPER_EXPECT_FAILED(channel.write_audio(&tscw, msg));
+        EXPECT_EQ(0, worker.depth());
+
+        HELPER_EXPECT_SUCCESS(channel.drain());
+    }
+
+    // Free the channel without waiting, the pending messages are dropped.
+    if (true) {
+        SrsThreadWorker worker(0, 16);
+        SrsHlsMuxChannel* channel = new SrsHlsMuxChannel(&worker);
+        HELPER_ASSERT_SUCCESS(channel->initialize());
+
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.ts"));
+        SrsTsContext ctx;
+        SrsTsContextWriter tscw(&fw, &ctx, SrsAudioCodecIdAAC, SrsVideoCodecIdDisabled);
+
+        SrsTsMessage* msg = new SrsTsMessage();
+        msg->sid = SrsTsPESStreamIdAudioCommon;
+        msg->payload->append("\xff\xf1\x50\x80\x01\x3f\xfc\x01", 8);
+        HELPER_ASSERT_SUCCESS(channel->write_audio(&tscw, msg));
+        srs_freep(channel);
+
+        EXPECT_TRUE(worker.consume());
+        EXPECT_EQ(0, (int)fw.filesize());
+    }
+
+    // Wait for the worker thread, which wakes up the channel when done.
+    if (true) {
+        SrsThreadWorker worker(0, 16);
+        SrsHlsMuxChannel channel(&worker);
+        HELPER_ASSERT_SUCCESS(channel.initialize());
+
+        MockSrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open("test.ts"));
+        SrsTsContext ctx;
+        SrsTsContextWriter tscw(&fw, &ctx, SrsAudioCodecIdAAC, SrsVideoCodecIdDisabled);
+
+        for (int i = 0; i < 2; i++) {
+            SrsTsMessage* msg = new SrsTsMessage();
+            msg->sid = SrsTsPESStreamIdAudioCommon;
+            msg->dts = msg->pts = i * 90 * 20;
+            msg->payload->append("\xff\xf1\x50\x80\x01\x3f\xfc\x01", 8);
+            HELPER_ASSERT_SUCCESS(channel.write_audio(&tscw, msg));
+        }
+
+        pthread_t trd;
+        ASSERT_EQ(0, pthread_create(&trd, NULL, mock_hls_mux_worker, &worker));
+        HELPER_EXPECT_SUCCESS(channel.drain());
+        EXPECT_EQ(0, channel.ctx_->pending());
+        pthread_join(trd, NULL);
+
+        EXPECT_EQ(2, (int)worker.tasks());
+        EXPECT_TRUE(fw.filesize() > 0);
+    }
+}
+
+#ifdef SRS_FFMPEG_FIT
+VOID TEST(AppAudioTranscodeTest, AsyncTranscode)
+{
+    srs_error_t err;
+
+    // Without worker, the result is ready after transcode.
+    if (true) {
+        SrsAsyncAudioTranscoder codec;
+        HELPER_ASSERT_SUCCESS(codec.initialize(SrsAudioCodecIdOpus, SrsAudioCodecIdAAC, 2, 48000, 48000));
+        EXPECT_FALSE(codec.async());
+
+        // An Opus packet of 20ms, CELT fullband, only the TOC.
+        char opus[] = {(char)0xfc};
+        for (int i = 0; i < 3; i++) {
+            SrsAudioFrame frame;
+            frame.add_sample(opus, sizeof(opus));
+            frame.dts = i * 20;
+            HELPER_ASSERT_SUCCESS(codec.transcode(&frame));
+        }
+
+        vector<SrsAudioTranscodeResult*> results;
+        codec.fetch(results);
+        ASSERT_EQ(3, (int)results.size());
+        for (int i = 0; i < (int)results.size(); i++) {
+            SrsAudioTranscodeResult* result = results.at(i);
+            EXPECT_EQ(i * 20, result->dts);
+            EXPECT_TRUE(result->latency >= 0);
+            srs_freep(result);
+        }
+        results.clear();
+
+        // The results are fetched only once.
+        codec.fetch(results);
+        EXPECT_TRUE(results.empty());
+    }
+
+    // With worker, the result is ready after the worker consumed it.
+    if (true) {
+        SrsThreadWorker worker(0, 16);
+        SrsAsyncAudioTranscoder codec;
+        HELPER_ASSERT_SUCCESS(codec.initialize(SrsAudioCodecIdOpus, SrsAudioCodecIdAAC, 2, 48000, 48000));
+        codec.worker_ = &worker;
+        EXPECT_TRUE(codec.async());
+
+        char opus[] = {(char)0xfc};
+        for (int i = 0; i < 2; i++) {
+            SrsAudioFrame frame;
+            frame.add_sample(opus, sizeof(opus));
+            frame.dts = i * 20;
+            HELPER_ASSERT_SUCCESS(codec.transcode(&frame));
+        }
+        EXPECT_EQ(2, worker.depth());
+
+        vector<SrsAudioTranscodeResult*> results;
+        codec.fetch(results);
+        EXPECT_TRUE(results.empty());
+
+        // Consume in the same thread, then wait should not block.
+        EXPECT_TRUE(worker.consume());
+        EXPECT_TRUE(worker.consume());
+        EXPECT_FALSE(worker.consume());
+        EXPECT_EQ(2, (int)worker.tasks());
+        codec.wait();
+
+        codec.fetch(results);
+        ASSERT_EQ(2, (int)results.size());
+        EXPECT_EQ(0, results.at(0)->dts);
+        EXPECT_EQ(20, results.at(1)->dts);
+        for (int i = 0; i < (int)results.size(); i++) {
+            srs_freep(results[i]);
+        }
+    }
+}
+#endif
+
+// Create a video message of AVC inter frame, at timestamp in ms.
+SrsSharedPtrMessage* mock_video_message(uint32_t timestamp)
+{
+    SrsMessageHeader header;
+    header.initialize_video(4, timestamp, 1);
+
+    char* payload = new char[4];
+    payload[0] = 0x27; payload[1] = 0x01; payload[2] = 0x00; payload[3] = 0x00;
+
+    SrsSharedPtrMessage* msg = new SrsSharedPtrMessage();
+    srs_error_t err = msg->create(&header, payload, 4);
+    srs_freep(err);
+    return msg;
+}
+
+VOID TEST(AppSourceTest, QueueDropped)
+{
+    srs_error_t err;
+
+    // The queue shrinks when overflow, and counts the dropped messages.
+    if (true) {
+        SrsMessageQueue queue(true);
+        queue.set_queue_size(1 * SRS_UTIME_SECONDS);
+
+        for (int i = 1; i <= 3; i++) {
+            HELPER_EXPECT_SUCCESS(queue.enqueue(mock_video_message(i * 500)));
+        }
+        EXPECT_EQ(0, queue.dropped());
+        EXPECT_EQ(3, queue.size());
+
+        // Overflow, all messages are dropped.
+        HELPER_EXPECT_SUCCESS(queue.enqueue(mock_video_message(2000)));
+        EXPECT_EQ(4, queue.dropped());
+        EXPECT_EQ(0, queue.size());
+    }
+
+    // The consumer samples the delta of dropped messages.
+    if (true) {
+        SrsLiveSource source;
+        SrsLiveConsumer* consumer = new SrsLiveConsumer(&source);
+        consumer->set_queue_size(1 * SRS_UTIME_SECONDS);
+
+        for (int i = 1; i <= 4; i++) {
+            SrsSharedPtrMessage* msg = mock_video_message(i * 500);
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            HELPER_EXPECT_SUCCESS(consumer->enqueue(msg, true, SrsRtmpJitterAlgorithmOFF));
+        }
+
+        int64_t dropped = 0;
+        srs_utime_t duration = 0;
+        consumer->sample_queue(dropped, duration);
+        EXPECT_EQ(4, dropped);
+        EXPECT_EQ(0, duration);
+
+        if (true) {
+            SrsSharedPtrMessage* msg = mock_video_message(2500);
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            HELPER_EXPECT_SUCCESS(consumer->enqueue(msg, true, SrsRtmpJitterAlgorithmOFF));
+        }
+        consumer->sample_queue(dropped, duration);
+        EXPECT_EQ(0, dropped);
+        EXPECT_EQ(500 * SRS_UTIME_MILLISECONDS, duration);
+
+        // The dropped messages not sampled are kept by source.
+        if (true) {
+            SrsSharedPtrMessage* msg = mock_video_message(4000);
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            HELPER_EXPECT_SUCCESS(consumer->enqueue(msg, true, SrsRtmpJitterAlgorithmOFF));
+        }
+        srs_freep(consumer);
+        EXPECT_EQ(2, source.nn_consumers_dropped_);
+    }
+}
+
+// Publish a stream to stat, with the kbps at 800*k kbps, by the mock clock.
+SrsStatisticStream* mock_stat_stream(SrsStatistic* stat, MockWallClock* clock, string name, int k)
+{
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = name;
+    stat->on_stream_publish(&req, "pub-" + name);
+
+    SrsStatisticStream* stream = stat->find_stream_by_url(req.get_stream_url());
+    srs_freep(stream->kbps);
+    stream->kbps = new SrsKbps(clock);
+
+    clock->set_clock(0);
+    stream->kbps->sample();
+
+    clock->set_clock(30 * SRS_UTIME_SECONDS);
+    stream->kbps->add_delta(k * 30 * 100 * 1000, k * 30 * 100 * 1000);
+    stream->kbps->sample();
+
+    return stream;
+}
+
+VOID TEST(AppStatisticTest, MetricsStreams)
+{
+    MockWallClock clock;
+    SrsStatistic stat;
+    mock_stat_stream(&stat, &clock, "a", 1);
+    mock_stat_stream(&stat, &clock, "b", 3);
+    mock_stat_stream(&stat, &clock, "c", 2);
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = "b";
+    stat.on_stream_queue(&req, 10, 5, 1500 * SRS_UTIME_MILLISECONDS);
+    stat.on_stream_queue(&req, 12, 2, 800 * SRS_UTIME_MILLISECONDS);
+
+    // Ignore the stream not exists.
+    req.stream = "d";
+    stat.on_stream_queue(&req, 10, 5, 0);
+    EXPECT_TRUE(stat.find_stream_by_url(req.get_stream_url()) == NULL);
+
+    // Only the top 2 streams by kbps.
+    if (true) {
+        string buf;
+        stat.dumps_metrics_streams(buf, 2);
+
+        EXPECT_TRUE(buf.find("srs_vhost_streams{vhost=\"__defaultVhost__\"} 3\n") != string::npos);
+        EXPECT_TRUE(buf.find("srs_stream_send_kbps{vhost=\"__defaultVhost__\",app=\"live\",stream=\"b\"} 2400\n") != string::npos);
+        EXPECT_TRUE(buf.find("srs_stream_recv_kbps{vhost=\"__defaultVhost__\",app=\"live\",stream=\"c\"} 1600\n") != string::npos);
+        EXPECT_TRUE(buf.find("stream=\"a\"") == string::npos);
+        EXPECT_TRUE(buf.find("srs_stream_dropped_msgs_total{vhost=\"__defaultVhost__\",app=\"live\",stream=\"b\"} 7\n") != string::npos);
+        EXPECT_TRUE(buf.find("srs_stream_gop_cache_msgs{vhost=\"__defaultVhost__\",app=\"live\",stream=\"b\"} 12\n") != string::npos);
+        EXPECT_TRUE(buf.find("srs_stream_queue_ms{vhost=\"__defaultVhost__\",app=\"live\",stream=\"b\"} 800\n") != string::npos);
+        EXPECT_TRUE(buf.find("srs_stream_metrics_truncated 1\n") != string::npos);
+    }
+
+    // All streams, appended to buffer.
+    if (true) {
+        string buf = "srs_streams 3\n";
+        stat.dumps_metrics_streams(buf, 10);
+
+        EXPECT_EQ(0, (int)buf.find("srs_streams 3\n"));
+        EXPECT_TRUE(buf.find("srs_stream_send_kbps{vhost=\"__defaultVhost__\",app=\"live\",stream=\"a\"} 800\n") != string::npos);
+        EXPECT_TRUE(buf.find("srs_stream_metrics_truncated 0\n") != string::npos);
+    }
+
+    // Disable the metrics of streams, only vhosts.
+    if (true) {
+        string buf;
+        stat.dumps_metrics_streams(buf, 0);
+
+        EXPECT_TRUE(buf.find("srs_vhost_send_kbps") != string::npos);
+        EXPECT_TRUE(buf.find("srs_stream_") == string::npos);
+    }
+
+    // Escape the backslash, double-quote and line feed of labels.
+    if (true) {
+        SrsStatistic stat;
+        mock_stat_stream(&stat, &clock, "a\"b\\c\n", 1);
+
+        string buf;
+        stat.dumps_metrics_streams(buf, 10);
+        EXPECT_TRUE(buf.find("srs_stream_send_kbps{vhost=\"__defaultVhost__\",app=\"live\",stream=\"a\\\"b\\\\c\\n\"} 800\n") != string::npos);
+    }
+}
+
+VOID TEST(AppStatisticTest, LatencyHistogram)
+{
+    // The small values are linear, then 8 buckets for each power of 2.
+    EXPECT_EQ(0, SrsLatencyHistogram::bucket_of(-1));
+    EXPECT_EQ(7, SrsLatencyHistogram::bucket_of(7));
+    EXPECT_EQ(8, SrsLatencyHistogram::bucket_of(8));
+    EXPECT_EQ(15, SrsLatencyHistogram::bucket_of(15));
+    EXPECT_EQ(16, SrsLatencyHistogram::bucket_of(16));
+    EXPECT_EQ(16, SrsLatencyHistogram::bucket_of(17));
+    EXPECT_EQ(SRS_LATENCY_BUCKETS - 1, SrsLatencyHistogram::bucket_of(1000 * SRS_UTIME_SECONDS));
+
+    // The value is in range of its bucket, and the precision is 1/8.
+    for (srs_utime_t v = 1; v < 100 * SRS_UTIME_SECONDS; v = v * 3 / 2 + 1) {
+        int bucket = SrsLatencyHistogram::bucket_of(v);
+        srs_utime_t highest = SrsLatencyHistogram::highest_of(bucket);
+        EXPECT_LE(v, highest);
+        EXPECT_LE(highest - v, v / 8);
+        EXPECT_EQ(bucket, SrsLatencyHistogram::bucket_of(highest));
+    }
+
+    SrsLatencyHistogram h;
+    EXPECT_EQ(0, h.percentile(0.99));
+
+    for (int i = 1; i <= 100; i++) {
+        h.update(i * SRS_UTIME_MILLISECONDS);
+    }
+    EXPECT_EQ(100, h.count());
+    EXPECT_EQ(5050 * SRS_UTIME_MILLISECONDS, h.sum());
+
+    // The percentiles are the highest of bucket, in 1/8 precision.
+    srs_utime_t p50 = h.percentile(0.5), p99 = h.percentile(0.99), pmax = h.percentile(1.0);
+    EXPECT_TRUE(p50 >= 50 * SRS_UTIME_MILLISECONDS && p50 <= 57 * SRS_UTIME_MILLISECONDS);
+    EXPECT_TRUE(p99 >= 99 * SRS_UTIME_MILLISECONDS && p99 <= 112 * SRS_UTIME_MILLISECONDS);
+    EXPECT_TRUE(pmax >= 100 * SRS_UTIME_MILLISECONDS && pmax <= 113 * SRS_UTIME_MILLISECONDS);
+
+    // The percentiles are of the recent window, while the count is total.
+    h.rotate();
+    h.update(1 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(pmax, h.percentile(1.0));
+
+    h.rotate();
+    EXPECT_EQ(101, h.count());
+    EXPECT_TRUE(h.percentile(1.0) < 2 * SRS_UTIME_MILLISECONDS);
+
+    h.rotate();
+    EXPECT_EQ(0, h.percentile(1.0));
+
+    // Sample one of every N packets.
+    if (true) {
+        SrsLatencyHistogram h;
+        int nn = 0;
+        for (int i = 0; i < 3 * SRS_LATENCY_SAMPLE_RATE; i++) {
+            if (h.sample()) nn++;
+        }
+        EXPECT_EQ(3, nn);
+    }
+}
+
+VOID TEST(AppStatisticTest, LatencyMetrics)
+{
+    srs_error_t err;
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = "livestream";
+
+    // Disabled by default.
+    if (true) {
+        SrsStatistic stat;
+        EXPECT_TRUE(stat.latency(&req, SrsLatencyStageRtmpSend) == NULL);
+    }
+
+    SrsSetEnvConfig(stats_latency, "SRS_STATS_LATENCY", "on");
+
+    // The histogram is created once for each stage of vhost.
+    if (true) {
+        SrsStatistic stat;
+        SrsLatencyHistogram* h = stat.latency(&req, SrsLatencyStageRtmpSend);
+        ASSERT_TRUE(h != NULL);
+        EXPECT_EQ(h, stat.latency(&req, SrsLatencyStageRtmpSend));
+        EXPECT_NE(h, stat.latency(&req, SrsLatencyStageRtcSend));
+
+        h->update(100);
+        h->update(300);
+
+        string buf;
+        stat.dumps_metrics_streams(buf, 0);
+        EXPECT_TRUE(buf.find("# TYPE srs_latency_us summary\n") != string::npos);
+        EXPECT_TRUE(buf.find("srs_latency_us{vhost=\"__defaultVhost__\",stage=\"rtmp_send\",quantile=\"0.99\"} 319\n") != string::npos);
+        EXPECT_TRUE(buf.find("srs_latency_us_sum{vhost=\"__defaultVhost__\",stage=\"rtmp_send\"} 400\n") != string::npos);
+        EXPECT_TRUE(buf.find("srs_latency_us_count{vhost=\"__defaultVhost__\",stage=\"rtc_send\"} 0\n") != string::npos);
+    }
+
+    // The queue latency of consumer, from the queue is not empty, to the messages are dumped.
+    if (true) {
+        SrsLiveSource source;
+        SrsLiveConsumer* consumer = new SrsLiveConsumer(&source);
+        SrsAutoFree(SrsLiveConsumer, consumer);
+
+        SrsLatencyHistogram h;
+        consumer->set_latency(&h);
+
+        for (int i = 1; i <= 3; i++) {
+            SrsSharedPtrMessage* msg = mock_video_message(i * 40);
+            SrsAutoFree(SrsSharedPtrMessage, msg);
+            HELPER_EXPECT_SUCCESS(consumer->enqueue(msg, true, SrsRtmpJitterAlgorithmOFF));
+        }
+        EXPECT_TRUE(consumer->queue_since_ > 0);
+
+        SrsMessageArray msgs(2);
+        int count = 0;
+        HELPER_EXPECT_SUCCESS(consumer->dump_packets(&msgs, count));
+        EXPECT_EQ(2, count);
+        EXPECT_EQ(1, h.count());
+        EXPECT_TRUE(consumer->queue_since_ > 0);
+        for (int i = 0; i < count; i++) {
+            srs_freep(msgs.msgs[i]);
+        }
+
+        count = 0;
+        HELPER_EXPECT_SUCCESS(consumer->dump_packets(&msgs, count));
+        EXPECT_EQ(1, count);
+        EXPECT_EQ(2, h.count());
+        EXPECT_EQ(0, consumer->queue_since_);
+        srs_freep(msgs.msgs[0]);
+
+        // Nothing dumped, no sample.
+        count = 0;
+        HELPER_EXPECT_SUCCESS(consumer->dump_packets(&msgs, count));
+        EXPECT_EQ(0, count);
+        EXPECT_EQ(2, h.count());
+    }
+}
+
+VOID TEST(AppStatisticTest, DumpsWriter)
+{
+    srs_error_t err;
+
+    MockWallClock clock;
+    SrsStatistic stat;
+    mock_stat_stream(&stat, &clock, "a", 1);
+    mock_stat_stream(&stat, &clock, "b", 2);
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    req.stream = "b";
+    req.ip = "127.0.0.1";
+    req.tcUrl = "rtmp://127.0.0.1/live";
+    HELPER_EXPECT_SUCCESS(stat.on_client("c0", &req, NULL, SrsRtmpConnPlay));
+    HELPER_EXPECT_SUCCESS(stat.on_client("c1", &req, NULL, SrsRtmpConnFlashPublish));
+
+    // Dumps the streams, from the start.
+    if (true) {
+        string buf;
+        SrsJsonWriter w(&buf);
+        w.begin_array();
+        HELPER_EXPECT_SUCCESS(stat.dumps_streams(&w, 1, 10));
+        w.end_array();
+
+        SrsJsonAny* p = SrsJsonAny::loads(buf);
+        ASSERT_TRUE(p != NULL);
+        SrsAutoFree(SrsJsonAny, p);
+        ASSERT_TRUE(p->is_array());
+        EXPECT_EQ(1, p->to_array()->count());
+
+        SrsJsonObject* stream = p->to_array()->at(0)->to_object();
+        EXPECT_STREQ("b", stream->get_property("name")->to_str().c_str());
+        EXPECT_EQ(2, stream->get_property("clients")->to_integer());
+        EXPECT_TRUE(stream->get_property("video")->is_null());
+        EXPECT_EQ(1600, stream->get_property("kbps")->to_object()->get_property("send_30s")->to_integer());
+        EXPECT_STREQ("pub-b", stream->get_property("publish")->to_object()->get_property("cid")->to_str().c_str());
+    }
+
+    // Dumps the clients.
+    if (true) {
+        string buf;
+        SrsJsonWriter w(&buf);
+        w.begin_object();
+        w.begin_array("clients");
+        HELPER_EXPECT_SUCCESS(stat.dumps_clients(&w, 0, 10));
+        w.end_array();
+        w.end_object();
+
+        SrsJsonAny* p = SrsJsonAny::loads(buf);
+        ASSERT_TRUE(p != NULL);
+        SrsAutoFree(SrsJsonAny, p);
+
+        SrsJsonArray* clients = p->to_object()->get_property("clients")->to_array();
+        ASSERT_EQ(2, clients->count());
+        SrsJsonObject* client = clients->at(1)->to_object();
+        EXPECT_STREQ("c1", client->get_property("id")->to_str().c_str());
+        EXPECT_STREQ("127.0.0.1", client->get_property("ip")->to_str().c_str());
+        EXPECT_TRUE(client->get_property("publish")->to_boolean());
+        EXPECT_TRUE(client->get_property("alive")->is_number());
+    }
+
+    // Dumps the vhosts.
+    if (true) {
+        string buf;
+        SrsJsonWriter w(&buf);
+        w.begin_array();
+        HELPER_EXPECT_SUCCESS(stat.dumps_vhosts(&w));
+        w.end_array();
+
+        SrsJsonAny* p = SrsJsonAny::loads(buf);
+        ASSERT_TRUE(p != NULL);
+        SrsAutoFree(SrsJsonAny, p);
+
+        SrsJsonObject* vhost = p->to_array()->at(0)->to_object();
+        EXPECT_STREQ("__defaultVhost__", vhost->get_property("name")->to_str().c_str());
+        EXPECT_EQ(2, vhost->get_property("streams")->to_integer());
+        EXPECT_FALSE(vhost->get_property("hls")->to_object()->get_property("enabled")->to_boolean());
+    }
+}
+
+VOID TEST(AppStatisticTest, StatisticTable)
+{
+    vector<SrsStatisticClient*> objs;
+    SrsStatisticTable<SrsStatisticClient, &SrsStatisticClient::id, &SrsStatisticClient::next_id_> t;
+
+    // Grow the buckets for lots of objects.
+    for (int i = 0; i < 1000; i++) {
+        SrsStatisticClient* client = new SrsStatisticClient();
+        client->id = srs_fmt("client-%d", i);
+        t.set(client);
+        objs.push_back(client);
+    }
+    EXPECT_EQ(1000, (int)t.size());
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(objs[i], t.find(srs_fmt("client-%d", i)));
+    }
+    EXPECT_TRUE(t.find("client-1000") == NULL);
+
+    // Erase the odd objects.
+    for (int i = 1; i < 1000; i += 2) {
+        t.erase(objs[i]);
+    }
+    t.erase(objs[1]);
+    EXPECT_EQ(500, (int)t.size());
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(i % 2 ? NULL : objs[i], t.find(srs_fmt("client-%d", i)));
+    }
+
+    for (int i = 0; i < (int)objs.size(); i++) {
+        srs_freep(objs[i]);
+    }
+}
+
+VOID TEST(AppStatisticTest, IncrementalSample)
+{
+    srs_error_t err;
+
+    SrsStatistic stat;
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    for (int i = 0; i < 10; i++) {
+        req.stream = srs_fmt("s%d", i % 2);
+        HELPER_EXPECT_SUCCESS(stat.on_client(srs_fmt("c%d", i), &req, NULL, SrsRtmpConnPlay));
+    }
+    EXPECT_EQ(10, (int)stat.clients.size());
+    EXPECT_EQ(2, (int)stat.streams.size());
+
+    // Remove client by leaving a hole, and cleanup the stream without clients.
+    for (int i = 0; i < 10; i += 2) {
+        stat.on_disconnect(srs_fmt("c%d", i), srs_success);
+    }
+    EXPECT_EQ(5, (int)stat.clients.size());
+    EXPECT_EQ(10, stat.clients.slots());
+    ASSERT_EQ(1, (int)stat.streams.size());
+    SrsStatisticStream* s1 = stat.streams.at(stat.streams.seek(0));
+    ASSERT_TRUE(s1 != NULL);
+    EXPECT_STREQ("s1", s1->stream.c_str());
+    EXPECT_EQ(1, s1->index_);
+    EXPECT_TRUE(stat.find_stream_by_url("/live/s0") == NULL);
+    EXPECT_EQ(s1, stat.find_stream(s1->id));
+    for (int i = 0; i < stat.clients.slots(); i++) {
+        SrsStatisticClient* client = stat.clients.at(i);
+        if (i % 2 == 0) {
+            EXPECT_TRUE(client == NULL);
+            continue;
+        }
+        ASSERT_TRUE(client != NULL);
+        EXPECT_EQ(i, client->index_);
+        EXPECT_EQ(client, stat.find_client(client->id));
+    }
+    EXPECT_TRUE(stat.find_client("c0") == NULL);
+
+    // Dumps a page of clients, in order of creation.
+    if (true) {
+        string buf;
+        SrsJsonWriter w(&buf);
+        w.begin_array();
+        HELPER_EXPECT_SUCCESS(stat.dumps_clients(&w, 3, 10));
+        w.end_array();
+
+        SrsJsonAny* p = SrsJsonAny::loads(buf);
+        ASSERT_TRUE(p != NULL);
+        SrsAutoFree(SrsJsonAny, p);
+        ASSERT_EQ(2, p->to_array()->count());
+        EXPECT_STREQ("c7", p->to_array()->at(0)->to_object()->get_property("id")->to_str().c_str());
+        EXPECT_STREQ("c9", p->to_array()->at(1)->to_object()->get_property("id")->to_str().c_str());
+    }
+
+    // The holes are compacted when more than the clients, and the order is kept.
+    if (true) {
+        stat.on_disconnect("c1", srs_success);
+        EXPECT_EQ(4, (int)stat.clients.size());
+        ASSERT_EQ(4, stat.clients.slots());
+        EXPECT_STREQ("c3", stat.clients.at(0)->id.c_str());
+        EXPECT_EQ(0, stat.clients.at(0)->index_);
+        EXPECT_STREQ("c9", stat.clients.at(3)->id.c_str());
+        EXPECT_EQ(3, stat.clients.at(3)->index_);
+        EXPECT_EQ(4, stat.clients.seek(5));
+    }
+
+    // The kbps of client is sampled when adding delta, and stream is sampled by timer, without sampling all clients.
+    if (true) {
+        MockWallClock clock;
+        SrsStatisticClient* client = stat.find_client("c3");
+        srs_freep(client->kbps);
+        client->kbps = new SrsKbps(&clock);
+        srs_freep(client->stream->kbps);
+        client->stream->kbps = new SrsKbps(&clock);
+
+        SrsEphemeralDelta delta;
+        clock.set_clock(0);
+        stat.kbps_add_delta("c3", &delta);
+        stat.kbps_sample();
+
+        clock.set_clock(30 * SRS_UTIME_SECONDS);
+        delta.add_delta(30 * 100 * 1000, 30 * 200 * 1000);
+        stat.kbps_add_delta("c3", &delta);
+        EXPECT_EQ(800, client->kbps->get_recv_kbps_30s());
+        EXPECT_EQ(0, client->stream->kbps->get_send_kbps_30s());
+
+        stat.kbps_sample();
+        EXPECT_EQ(1600, client->stream->kbps->get_send_kbps_30s());
+
+        // Ignore the client not exists.
+        stat.kbps_add_delta("c0", &delta);
+    }
+}
+
+VOID TEST(AppStatisticTest, BenchmarkSample)
+{
+    srs_error_t err;
+
+    const int nn_clients = 50000;
+    SrsStatistic stat;
+
+    SrsRequest req;
+    req.vhost = "__defaultVhost__";
+    req.app = "live";
+    vector<string> ids(nn_clients);
+    for (int i = 0; i < nn_clients; i++) {
+        req.stream = srs_fmt("s%d", i % 100);
+        ids[i] = srs_fmt("%08x", (uint32_t)(i * 2654435761u));
+        HELPER_EXPECT_SUCCESS(stat.on_client(ids[i], &req, NULL, SrsRtmpConnPlay));
+    }
+
+    // A tick of server, add delta for each connection, then sample.
+    SrsEphemeralDelta delta;
+    srs_utime_t starttime = srs_update_system_time();
+    for (int i = 0; i < nn_clients; i++) {
+        delta.add_delta(1000, 1000);
+        stat.kbps_add_delta(ids[i], &delta);
+    }
+    stat.kbps_sample();
+    srs_utime_t tick_cost = srs_max(1, srs_update_system_time() - starttime);
+
+    // Disconnect all clients, which cleanup the streams.
+    starttime = srs_update_system_time();
+    for (int i = 0; i < nn_clients; i++) {
+        stat.on_disconnect(ids[i], srs_success);
+    }
+    srs_utime_t disconnect_cost = srs_max(1, srs_update_system_time() - starttime);
+    EXPECT_EQ(0, (int)stat.clients.size());
+    EXPECT_EQ(0, (int)stat.streams.size());
+
+    printf("Sample %d clients tick %dms, disconnect all %dms\n", nn_clients, srsu2msi(tick_cost), srsu2msi(disconnect_cost));
+}
+
+VOID TEST(AppProfilerTest, PeekContextId)
+{
+    char buf[SRS_PROFILER_CID_SIZE];
+
+    if (true) {
+        SrsContextRestore(_srs_context->get_id());
+        _srs_context->set_id(SrsContextId().set_value("abcdefgh"));
+
+        EXPECT_TRUE(srs_context_peek_cid(buf, sizeof(buf)));
+        EXPECT_STREQ("abcdefgh", buf);
+
+        // Truncated to the size of buffer.
+        EXPECT_TRUE(srs_context_peek_cid(buf, 4));
+        EXPECT_STREQ("abc", buf);
+
+        EXPECT_FALSE(srs_context_peek_cid(buf, 0));
+    }
+}
+
+VOID TEST(AppProfilerTest, SampleAndDump)
+{
+    srs_error_t err;
+
+    SrsCpuProfiler profiler;
+    EXPECT_FALSE(profiler.started());
+    HELPER_EXPECT_FAILED(profiler.start(0, 100));
+    HELPER_EXPECT_FAILED(profiler.start(100, 0));
+
+    if (true) {
+        SrsContextRestore(_srs_context->get_id());
+        _srs_context->set_id(SrsContextId().set_value("profiler"));
+
+        HELPER_ASSERT_SUCCESS(profiler.start(1000, 100));
+        EXPECT_TRUE(profiler.started());
+        HELPER_EXPECT_FAILED(profiler.start(1000, 100));
+
+        // Burn the CPU until got some samples.
+        volatile uint64_t v = 0;
+        srs_utime_t starttime = srs_get_system_time();
+        while (profiler.nn_samples() < 10 && srs_get_system_time() - starttime < 3 * SRS_UTIME_SECONDS) {
+            for (int i = 0; i < 1000000; i++) {
+                v += i * i;
+            }
+            srs_update_system_time();
+        }
+
+        // The signal handler should never change the errno of interrupted code.
+        errno = EAGAIN;
+        raise(SIGPROF);
+        EXPECT_EQ(EAGAIN, errno);
+
+        profiler.stop();
+        EXPECT_FALSE(profiler.started());
+    }
+
+    int nn_samples = profiler.nn_samples();
+    EXPECT_GE(nn_samples, 10);
+    EXPECT_GT(profiler.duration(), 0);
+
+    // Never sample after stopped, and the pending signal is ignored rather than kills the process.
+    if (true) {
+        volatile uint64_t v = 0;
+        for (int i = 0; i < 10000000; i++) {
+            v += i * i;
+        }
+        raise(SIGPROF);
+        EXPECT_EQ(nn_samples, profiler.nn_samples());
+    }
+
+    // The samples are attributed to the context.
+    if (true) {
+        string buf;
+        SrsJsonWriter w(&buf);
+        profiler.dumps_contexts(&w, 10);
+
+        SrsJsonAny* any = SrsJsonAny::loads(buf);
+        ASSERT_TRUE(any && any->is_array());
+        SrsAutoFree(SrsJsonAny, any);
+
+        SrsJsonArray* arr = any->to_array();
+        ASSERT_GE(arr->count(), 1);
+        SrsJsonObject* obj = arr->at(0)->to_object();
+        EXPECT_STREQ("profiler", obj->get_property("cid")->to_str().c_str());
+        EXPECT_EQ(nn_samples, obj->get_property("samples")->to_integer());
+    }
+
+    // The legacy CPU profile of gperftools.
+    if (true) {
+        string buf;
+        profiler.dumps_pprof(buf);
+
+        uintptr_t* p = (uintptr_t*)buf.data();
+        ASSERT_GT(buf.length(), 8 * sizeof(uintptr_t));
+        EXPECT_EQ(0, (int)p[0]);
+        EXPECT_EQ(3, (int)p[1]);
+        EXPECT_EQ(0, (int)p[2]);
+        EXPECT_EQ(1000, (int)p[3]);
+        EXPECT_EQ(0, (int)p[4]);
+
+        // Parse all records until the trailer.
+        int nn_records = 0;
+        size_t pos = 5;
+        size_t nn_words = buf.length() / sizeof(uintptr_t);
+        while (pos + 2 < nn_words && p[pos] != 0) {
+            EXPECT_EQ(1, (int)p[pos]);
+            EXPECT_GT((int)p[pos + 1], 0);
+            EXPECT_LE((int)p[pos + 1], SRS_PROFILER_MAX_DEPTH);
+            pos += 2 + p[pos + 1];
+            nn_records++;
+        }
+        EXPECT_EQ(nn_samples, nn_records);
+
+        ASSERT_LT(pos + 2, nn_words);
+        EXPECT_EQ(0, (int)p[pos]);
+        EXPECT_EQ(1, (int)p[pos + 1]);
+        EXPECT_EQ(0, (int)p[pos + 2]);
+
+        // Followed by the maps of process.
+        string maps = buf.substr((pos + 3) * sizeof(uintptr_t));
+        EXPECT_TRUE(maps.find("srs_utest") != string::npos);
+    }
+}
+
+VOID TEST(AppProfilerTest, HeapSnapshot)
+{
+    string snapshot = srs_get_heap_snapshot();
+#if !defined(SRS_GPERF) && !defined(SRS_OSX)
+    EXPECT_TRUE(snapshot.find("<malloc") != string::npos);
+#endif
+}
+
+VOID TEST(AppCoroutineTest, SchedulerStatWindow)
+{
+    SrsSchedulerStat stat;
+    srs_utime_t now = stat.current_.starttime;
+
+    // Round 1 runs 3 coroutines, round 2 runs 1 coroutine.
+    for (int i = 0; i < 3; i++) {
+        stat.on_switch_in(now, 100);
+        now += (i + 1) * SRS_UTIME_MILLISECONDS;
+        stat.on_switch_out(now);
+    }
+    stat.on_switch_in(now, 200);
+    now += 50;
+    stat.on_switch_out(now);
+
+    // Round 3 starts after window, which rotates the window.
+    now = stat.current_.starttime + SRS_SCHED_WINDOW;
+    stat.on_switch_in(now, 300);
+    stat.on_switch_out(now + 200 * SRS_UTIME_MILLISECONDS);
+
+    EXPECT_EQ(2, (int)stat.nn_rounds_);
+    EXPECT_EQ(5, (int)stat.nn_slices_);
+
+    SrsSchedulerWindow& w = stat.last_;
+    EXPECT_EQ(SRS_SCHED_WINDOW, w.duration);
+    EXPECT_EQ(2, (int)w.nn_rounds);
+    EXPECT_EQ(4, (int)w.nn_slices);
+    EXPECT_EQ(6 * SRS_UTIME_MILLISECONDS + 50, w.run_time);
+    EXPECT_EQ(1, (int)w.runq[0]); // Depth 1.
+    EXPECT_EQ(1, (int)w.runq[1]); // Depth 2~3.
+    EXPECT_EQ(1, (int)w.slices[0]); // 50us, less than 100us.
+    EXPECT_EQ(0, (int)w.slices[1]);
+    EXPECT_EQ(3, (int)w.slices[2]); // 1ms, 2ms, 3ms, less than 5ms.
+
+    // The top slices are sorted in desc.
+    ASSERT_EQ(4, w.nn_top);
+    EXPECT_EQ(3 * SRS_UTIME_MILLISECONDS, w.top[0].duration);
+    EXPECT_EQ(2 * SRS_UTIME_MILLISECONDS, w.top[1].duration);
+    EXPECT_EQ(1 * SRS_UTIME_MILLISECONDS, w.top[2].duration);
+    EXPECT_EQ(50, w.top[3].duration);
+
+    // The slice after rotated is in current window.
+    EXPECT_EQ(1, (int)stat.current_.nn_slices);
+    EXPECT_EQ(1, (int)stat.current_.slices[6]);
+
+    SrsJsonObject* obj = SrsJsonAny::object();
+    SrsAutoFree(SrsJsonObject, obj);
+    stat.dumps(obj);
+    EXPECT_EQ(2, obj->get_property("rounds")->to_integer());
+    EXPECT_EQ(10000, obj->get_property("window_ms")->to_integer());
+    EXPECT_EQ(1, obj->get_property("runq")->to_object()->get_property("2")->to_integer());
+    EXPECT_EQ(3, obj->get_property("slice")->to_object()->get_property("5ms")->to_integer());
+    EXPECT_EQ(4, obj->get_property("top")->to_array()->count());
+}
+
+VOID TEST(AppCoroutineTest, SchedulerStatTopSlices)
+{
+    SrsSchedulerStat stat;
+    srs_utime_t now = stat.current_.starttime;
+
+    // Only keep the longest slices.
+    for (int i = 0; i < SRS_SCHED_TOP_SLICES * 3; i++) {
+        stat.on_switch_in(now, 100);
+        now += ((i * 7) % (SRS_SCHED_TOP_SLICES * 3) + 1) * 100;
+        stat.on_switch_out(now);
+    }
+
+    SrsSchedulerWindow& w = stat.current_;
+    ASSERT_EQ(SRS_SCHED_TOP_SLICES, w.nn_top);
+    for (int i = 0; i < SRS_SCHED_TOP_SLICES; i++) {
+        EXPECT_EQ((SRS_SCHED_TOP_SLICES * 3 - i) * 100, w.top[i].duration);
+    }
+}
+
+class MockBusyCoroutineHandler : public ISrsCoroutineHandler
+{
+public:
+    SrsSTCoroutine* trd;
+    srs_utime_t busy;
+public:
+    MockBusyCoroutineHandler() : trd(NULL), busy(0) {
+    }
+    virtual ~MockBusyCoroutineHandler() {
+    }
+public:
+    virtual srs_error_t cycle() {
+        srs_error_t err = srs_success;
+        while ((err = trd->pull()) == srs_success) {
+            // Block the event loop for a while, then yield.
+            srs_utime_t starttime = srs_utime_now();
+            while (srs_utime_now() - starttime < busy) {
+            }
+            srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+        }
+        return err;
+    }
+};
+
+VOID TEST(AppCoroutineTest, SchedulerStatInstall)
+{
+    srs_error_t err = srs_success;
+
+    SrsSchedulerStat stat;
+    stat.install();
+
+    MockBusyCoroutineHandler ch;
+    ch.busy = 5 * SRS_UTIME_MILLISECONDS;
+    SrsSTCoroutine sc("busy", &ch, SrsContextId().set_value("busycid"));
+    ch.trd = &sc;
+    HELPER_ASSERT_SUCCESS(sc.start());
+
+    srs_usleep(50 * SRS_UTIME_MILLISECONDS);
+    sc.stop();
+    stat.uninstall();
+
+    // Never stat after uninstalled.
+    uint64_t nn_slices = stat.nn_slices_;
+    srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(nn_slices, stat.nn_slices_);
+
+    // The busy coroutine is the longest slice, with cid and label.
+    SrsSchedulerWindow& w = stat.current_;
+    EXPECT_GT(stat.nn_rounds_, 0);
+    EXPECT_GT(w.nn_slices, 0);
+    ASSERT_GT(w.nn_top, 0);
+    EXPECT_GE(w.top[0].duration, 5 * SRS_UTIME_MILLISECONDS);
+    EXPECT_STREQ("busycid", w.top[0].cid);
+    EXPECT_STREQ("busy", w.top[0].label);
+}
+
+class MockWheelTimer : public ISrsFastTimer
+{
+public:
+    int nn_ticks;
+    SrsTimerWheel* wheel;
+    // The timer to cancel in callback.
+    MockWheelTimer* victim;
+    bool cancel_self;
+public:
+    MockWheelTimer() {
+        nn_ticks = 0;
+        wheel = NULL;
+        victim = NULL;
+        cancel_self = false;
+    }
+    virtual ~MockWheelTimer() {
+    }
+public:
+    srs_error_t on_timer(srs_utime_t interval) {
+        nn_ticks++;
+        if (victim) {
+            wheel->cancel(victim);
+        }
+        if (cancel_self) {
+            wheel->cancel(this);
+        }
+        return srs_success;
+    }
+};
+
+VOID TEST(AppTimerWheelTest, PeriodicTimer)
+{
+    srs_utime_t res = 10 * SRS_UTIME_MILLISECONDS;
+    srs_utime_t base = 1000 * SRS_UTIME_SECONDS;
+    SrsTimerWheel wheel("utest", res);
+
+    MockWheelTimer t20, t100, once;
+    wheel.schedule(&t20, 20 * SRS_UTIME_MILLISECONDS);
+    wheel.schedule(&t100, 100 * SRS_UTIME_MILLISECONDS);
+    wheel.schedule(&once, 0, 50 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(3, wheel.size());
+
+    // Drive the wheel for 1s, tick by tick.
+    for (int i = 0; i <= 100; i++) {
+        wheel.advance(base + i * res);
+    }
+    EXPECT_EQ(50, t20.nn_ticks);
+    EXPECT_EQ(10, t100.nn_ticks);
+    EXPECT_EQ(1, once.nn_ticks);
+    EXPECT_FALSE(wheel.scheduled(&once));
+    EXPECT_EQ(2, wheel.size());
+
+    // Subscribe again should never reset the deadline.
+    wheel.cancel(&t20);
+    SrsFastTimer timer(&wheel, 20 * SRS_UTIME_MILLISECONDS);
+    timer.subscribe(&t20);
+    timer.subscribe(&t20);
+    EXPECT_EQ(2, wheel.size());
+
+    // Only the subscribed fast timer is able to unsubscribe it.
+    SrsFastTimer other(&wheel, 20 * SRS_UTIME_MILLISECONDS);
+    other.unsubscribe(&t20);
+    EXPECT_EQ(2, wheel.size());
+    timer.unsubscribe(&t20);
+    timer.unsubscribe(&t20);
+    EXPECT_EQ(1, wheel.size());
+
+    // If the wheel falls behind, tick once rather than a burst.
+    wheel.advance(base + 3000 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(11, t100.nn_ticks);
+    wheel.advance(base + 3100 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(12, t100.nn_ticks);
+}
+
+VOID TEST(AppTimerWheelTest, CancelInCallback)
+{
+    srs_utime_t res = 10 * SRS_UTIME_MILLISECONDS;
+    srs_utime_t base = 1000 * SRS_UTIME_SECONDS;
+    SrsTimerWheel wheel("utest", res);
+    wheel.advance(base);
+
+    // Both timers expire in the same tick, the first cancels the second.
+    MockWheelTimer a, b, c;
+    a.wheel = b.wheel = c.wheel = &wheel;
+    a.victim = &b;
+    c.cancel_self = true;
+    wheel.schedule(&a, 20 * SRS_UTIME_MILLISECONDS);
+    wheel.schedule(&b, 20 * SRS_UTIME_MILLISECONDS);
+    wheel.schedule(&c, 20 * SRS_UTIME_MILLISECONDS);
+
+    wheel.advance(base + 20 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(1, a.nn_ticks);
+    EXPECT_EQ(0, b.nn_ticks);
+    EXPECT_EQ(1, c.nn_ticks);
+    EXPECT_TRUE(wheel.scheduled(&a));
+    EXPECT_FALSE(wheel.scheduled(&b));
+    EXPECT_FALSE(wheel.scheduled(&c));
+    EXPECT_EQ(1, wheel.size());
+
+    // The timer is cancelled when freed.
+    if (true) {
+        MockWheelTimer d;
+        wheel.schedule(&d, 20 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(2, wheel.size());
+    }
+    EXPECT_EQ(1, wheel.size());
+    wheel.advance(base + 100 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(2, a.nn_ticks);
+}
+
+VOID TEST(AppTimerWheelTest, CascadeLevels)
+{
+    srs_utime_t res = 10 * SRS_UTIME_MILLISECONDS;
+    srs_utime_t base = 1000 * SRS_UTIME_SECONDS;
+    SrsTimerWheel wheel("utest", res);
+    wheel.advance(base);
+
+    // The delays in ticks, cover all levels of wheel.
+    int delays[] = {1, 255, 256, 300, 16383, 16384, 20000, 1048576, 1100000};
+    int nn_delays = (int)(sizeof(delays) / sizeof(int));
+    vector<MockWheelTimer*> timers;
+    for (int i = 0; i < nn_delays; i++) {
+        MockWheelTimer* t = new MockWheelTimer();
+        timers.push_back(t);
+        wheel.schedule(t, 0, delays[i] * res);
+    }
+
+    // Each timer should fire exactly at its deadline, never earlier.
+    for (int i = 0; i < nn_delays; i++) {
+        wheel.advance(base + (delays[i] - 1) * res);
+        EXPECT_EQ(0, timers[i]->nn_ticks) << "delay=" << delays[i];
+        wheel.advance(base + delays[i] * res);
+        EXPECT_EQ(1, timers[i]->nn_ticks) << "delay=" << delays[i];
+    }
+    EXPECT_EQ(0, wheel.size());
+
+    for (int i = 0; i < nn_delays; i++) {
+        srs_freep(timers[i]);
+    }
+}
+
+VOID TEST(AppTimerWheelTest, HourGlass)
+{
+    srs_error_t err;
+
+    class MockHourGlass : public ISrsHourGlass {
+    public:
+        map<int, int> events;
+        map<int, srs_utime_t> intervals;
+        srs_error_t notify(int event, srs_utime_t interval, srs_utime_t tick) {
+            events[event]++;
+            intervals[event] = interval;
+            return srs_success;
+        }
+    };
+
+    srs_utime_t res = 10 * SRS_UTIME_MILLISECONDS;
+    srs_utime_t base = 1000 * SRS_UTIME_SECONDS;
+    SrsTimerWheel wheel("utest", res);
+    wheel.advance(base);
+
+    MockHourGlass h;
+    SrsHourGlass hg("utest", &h, 100 * SRS_UTIME_MILLISECONDS);
+    hg.wheel_ = &wheel;
+    HELPER_EXPECT_FAILED(hg.tick(1, 150 * SRS_UTIME_MILLISECONDS));
+    HELPER_EXPECT_SUCCESS(hg.tick(1, 100 * SRS_UTIME_MILLISECONDS));
+    HELPER_EXPECT_SUCCESS(hg.tick(2, 300 * SRS_UTIME_MILLISECONDS));
+    HELPER_EXPECT_SUCCESS(hg.start());
+    EXPECT_EQ(2, wheel.size());
+
+    // Notify at the next tick when start, then every interval.
+    for (int i = 0; i <= 61; i++) {
+        wheel.advance(base + i * res);
+    }
+    EXPECT_EQ(7, h.events[1]);
+    EXPECT_EQ(3, h.events[2]);
+
+    // Tick after started is scheduled immediately.
+    HELPER_EXPECT_SUCCESS(hg.tick(3, 100 * SRS_UTIME_MILLISECONDS));
+    hg.untick(1);
+    EXPECT_EQ(2, wheel.size());
+    wheel.advance(base + 620 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(7, h.events[1]);
+    EXPECT_EQ(1, h.events[3]);
+
+    // The interval 0 is notified for each resolution, with interval 0.
+    HELPER_EXPECT_SUCCESS(hg.tick(4, 0));
+    wheel.advance(base + 630 * SRS_UTIME_MILLISECONDS);
+    wheel.advance(base + 730 * SRS_UTIME_MILLISECONDS);
+    EXPECT_EQ(2, h.events[4]);
+    EXPECT_EQ(0, h.intervals[4]);
+    EXPECT_EQ(300 * SRS_UTIME_MILLISECONDS, h.intervals[2]);
+
+    hg.stop();
+    EXPECT_EQ(0, wheel.size());
+}
+
+VOID TEST(AppTimerWheelTest, BenchmarkCancel)
+{
+    const int nn_timers = 100000;
+    srs_utime_t res = 10 * SRS_UTIME_MILLISECONDS;
+    SrsTimerWheel wheel("utest", res);
+    wheel.advance(1000 * SRS_UTIME_SECONDS);
+
+    MockWheelTimer* timers = new MockWheelTimer[nn_timers];
+    SrsAutoFreeA(MockWheelTimer, timers);
+
+    // Schedule and cancel in random order, which is O(1) for each timer.
+    srs_utime_t starttime = srs_update_system_time();
+    for (int i = 0; i < nn_timers; i++) {
+        wheel.schedule(&timers[i], (20 + i % 5000) * SRS_UTIME_MILLISECONDS);
+    }
+    for (int i = 0; i < nn_timers; i++) {
+        wheel.cancel(&timers[(int)(((uint64_t)i * 7919) % nn_timers)]);
+    }
+    srs_utime_t cost = srs_max(1, srs_update_system_time() - starttime);
+    EXPECT_EQ(0, wheel.size());
+
+    printf("Schedule and cancel %d timers %dms\n", nn_timers, srsu2msi(cost));
+}
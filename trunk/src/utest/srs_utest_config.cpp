@@ -3649,6 +3649,17 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
         EXPECT_FALSE(conf.get_raw_api_allow_update()); // Always disabled
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_api{enabled on;}"));
+        EXPECT_FALSE(conf.get_profiler_enabled());
+
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_api{enabled on;profiler {enabled on;}}"));
+        EXPECT_TRUE(conf.get_profiler_enabled());
+
+        HELPER_EXPECT_FAILED(conf.parse(_MIN_OK_CONF "http_api{enabled on;profiler {xxx on;}}"));
+    }
+
     if (true) {
         MockSrsConfig conf;
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "http_server{enabled on;listen xxx;dir xxx2;crossdomain on;}"));
@@ -3689,6 +3700,13 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
         HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "stats{network 0;disk xxx;}"));
         EXPECT_EQ(0, (int)conf.get_stats_network());
         EXPECT_TRUE(conf.get_stats_disk_device() != NULL);
+        EXPECT_FALSE(conf.get_stats_latency());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "stats{latency on;}"));
+        EXPECT_TRUE(conf.get_stats_latency());
     }
 
     if (true) {
@@ -3699,6 +3717,15 @@ VOID TEST(ConfigMainTest, CheckVhostConfig5)
         EXPECT_STREQ("cn-beijing", conf.get_exporter_label().c_str());
         EXPECT_STREQ("cn-edge", conf.get_exporter_tag().c_str());
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF));
+        EXPECT_EQ(100, conf.get_exporter_max_streams());
+
+        HELPER_ASSERT_SUCCESS(conf.parse(_MIN_OK_CONF "exporter{max_streams 0;}"));
+        EXPECT_EQ(0, conf.get_exporter_max_streams());
+    }
 }
 
 VOID TEST(ConfigMainTest, CheckIncludeConfig)
@@ -3958,6 +3985,14 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesGlobal)
         EXPECT_STREQ("xxx5", conf.get_work_dir().c_str());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_FALSE(conf.get_log_async());
+
+        SrsSetEnvConfig(log_async, "SRS_SRS_LOG_ASYNC", "on");
+        EXPECT_TRUE(conf.get_log_async());
+    }
+
     if (true) {
         MockSrsConfig conf;
 
@@ -3990,6 +4025,22 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesGlobal)
         EXPECT_TRUE(conf.get_in_docker());
     }
 
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(1, conf.get_accept_reuseport());
+        EXPECT_EQ(32, conf.get_accept_batch());
+        EXPECT_EQ(0, conf.get_accept_rate());
+
+        SrsSetEnvConfig(accept_reuseport, "SRS_ACCEPT_REUSEPORT", "4");
+        EXPECT_EQ(4, conf.get_accept_reuseport());
+
+        SrsSetEnvConfig(accept_batch, "SRS_ACCEPT_BATCH", "64");
+        EXPECT_EQ(64, conf.get_accept_batch());
+
+        SrsSetEnvConfig(accept_rate, "SRS_ACCEPT_RATE", "1000");
+        EXPECT_EQ(1000, conf.get_accept_rate());
+    }
+
     if (true) {
         MockSrsConfig conf;
 
@@ -4043,6 +4094,50 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesthreads)
         SrsSetEnvConfig(threads_interval, "SRS_THREADS_INTERVAL", "10");
         EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_threads_interval());
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(0, conf.get_threads_hls_workers());
+        EXPECT_EQ(8192, conf.get_threads_hls_queue());
+
+        SrsSetEnvConfig(threads_hls_workers, "SRS_THREADS_HLS_WORKERS", "4");
+        EXPECT_EQ(4, conf.get_threads_hls_workers());
+
+        SrsSetEnvConfig(threads_hls_queue, "SRS_THREADS_HLS_QUEUE", "1024");
+        EXPECT_EQ(1024, conf.get_threads_hls_queue());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(0, conf.get_threads_audio_workers());
+        EXPECT_EQ(1024, conf.get_threads_audio_queue());
+
+        SrsSetEnvConfig(threads_audio_workers, "SRS_THREADS_AUDIO_WORKERS", "2");
+        EXPECT_EQ(2, conf.get_threads_audio_workers());
+
+        SrsSetEnvConfig(threads_audio_queue, "SRS_THREADS_AUDIO_QUEUE", "256");
+        EXPECT_EQ(256, conf.get_threads_audio_queue());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(0, conf.get_threads_dtls_workers());
+        EXPECT_EQ(1024, conf.get_threads_dtls_queue());
+
+        SrsSetEnvConfig(threads_dtls_workers, "SRS_THREADS_DTLS_WORKERS", "2");
+        EXPECT_EQ(2, conf.get_threads_dtls_workers());
+
+        SrsSetEnvConfig(threads_dtls_queue, "SRS_THREADS_DTLS_QUEUE", "256");
+        EXPECT_EQ(256, conf.get_threads_dtls_queue());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_FALSE(conf.get_threads_sched_stat());
+
+        SrsSetEnvConfig(threads_sched_stat, "SRS_THREADS_SCHED_STAT", "on");
+        EXPECT_TRUE(conf.get_threads_sched_stat());
+    }
 }
 
 VOID TEST(ConfigEnvTest, CheckEnvValuesRtmp)
@@ -4105,6 +4200,9 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesHttpApi)
 
         SrsSetEnvConfig(raw_api_allow_reload, "SRS_HTTP_API_RAW_API_ALLOW_RELOAD", "on");
         EXPECT_TRUE(conf.get_raw_api_allow_reload());
+
+        SrsSetEnvConfig(profiler_enabled, "SRS_HTTP_API_PROFILER_ENABLED", "on");
+        EXPECT_TRUE(conf.get_profiler_enabled());
     }
 
     if (true) {
@@ -4142,6 +4240,24 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesHttpServer)
 
         SrsSetEnvConfig(http_stream_crossdomain, "SRS_HTTP_SERVER_CROSSDOMAIN", "off");
         EXPECT_FALSE(conf.get_http_stream_crossdomain());
+
+        SrsSetEnvConfig(http_stream_sendfile, "SRS_HTTP_SERVER_SENDFILE", "off");
+        EXPECT_FALSE(conf.get_http_stream_sendfile());
+
+        SrsSetEnvConfig(http_stream_file_cache_enabled, "SRS_HTTP_SERVER_FILE_CACHE_ENABLED", "on");
+        EXPECT_TRUE(conf.get_http_stream_file_cache_enabled());
+
+        SrsSetEnvConfig(http_stream_file_cache_max_size, "SRS_HTTP_SERVER_FILE_CACHE_MAX_SIZE", "1024");
+        EXPECT_EQ(1024 * 1024, conf.get_http_stream_file_cache_max_size());
+
+        SrsSetEnvConfig(http_stream_file_cache_max_file_size, "SRS_HTTP_SERVER_FILE_CACHE_MAX_FILE_SIZE", "16");
+        EXPECT_EQ(16 * 1024, conf.get_http_stream_file_cache_max_file_size());
+
+        SrsSetEnvConfig(http_stream_mp4_index_enabled, "SRS_HTTP_SERVER_MP4_INDEX_ENABLED", "off");
+        EXPECT_FALSE(conf.get_http_stream_mp4_index_enabled());
+
+        SrsSetEnvConfig(http_stream_mp4_index_max_files, "SRS_HTTP_SERVER_MP4_INDEX_MAX_FILES", "16");
+        EXPECT_EQ(16, conf.get_http_stream_mp4_index_max_files());
     }
 
     if (true) {
@@ -4299,6 +4415,22 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesRtcServer)
         SrsSetEnvConfig(rtc_server_black_hole_addr, "SRS_RTC_SERVER_BLACK_HOLE_ADDR", "xxx");
         EXPECT_STREQ("xxx", conf.get_rtc_server_black_hole_addr().c_str());
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_TRUE(conf.get_rtc_server_dtls_resumption());
+
+        SrsSetEnvConfig(rtc_server_dtls_resumption, "SRS_RTC_SERVER_DTLS_RESUMPTION", "off");
+        EXPECT_FALSE(conf.get_rtc_server_dtls_resumption());
+    }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_EQ(64, conf.get_rtc_server_rtcp_batch());
+
+        SrsSetEnvConfig(rtc_server_rtcp_batch, "SRS_RTC_SERVER_RTCP_BATCH", "0");
+        EXPECT_EQ(0, conf.get_rtc_server_rtcp_batch());
+    }
 }
 
 VOID TEST(ConfigEnvTest, CheckEnvValuesVhostRtc)
@@ -4358,6 +4490,28 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesVhostRtc)
         SrsSetEnvConfig(rtc_pli_for_rtmp, "SRS_VHOST_RTC_PLI_FOR_RTMP", "60");
         EXPECT_EQ(6 * SRS_UTIME_SECONDS, conf.get_rtc_pli_for_rtmp("__defaultVhost__"));
     }
+
+    if (true) {
+        MockSrsConfig conf;
+        EXPECT_FALSE(conf.get_rtc_bridge_lazy("__defaultVhost__"));
+        EXPECT_EQ(10 * SRS_UTIME_SECONDS, conf.get_rtc_bridge_grace("__defaultVhost__"));
+
+        SrsSetEnvConfig(rtc_bridge_lazy, "SRS_VHOST_RTC_BRIDGE_LAZY", "on");
+        EXPECT_TRUE(conf.get_rtc_bridge_lazy("__defaultVhost__"));
+
+        SrsSetEnvConfig(rtc_bridge_grace, "SRS_VHOST_RTC_BRIDGE_GRACE", "2.5");
+        EXPECT_EQ(2500 * SRS_UTIME_MILLISECONDS, conf.get_rtc_bridge_grace("__defaultVhost__"));
+
+        EXPECT_FALSE(conf.get_rtc_bwe_enabled("__defaultVhost__"));
+        SrsSetEnvConfig(rtc_bwe, "SRS_VHOST_RTC_BWE", "on");
+        EXPECT_TRUE(conf.get_rtc_bwe_enabled("__defaultVhost__"));
+
+        SrsSetEnvConfig(rtc_pacing_factor, "SRS_VHOST_RTC_PACING_FACTOR", "1.5");
+        EXPECT_EQ(1.5, conf.get_rtc_pacing_factor("__defaultVhost__"));
+
+        SrsSetEnvConfig(rtc_pacing_max_delay, "SRS_VHOST_RTC_PACING_MAX_DELAY", "300");
+        EXPECT_EQ(300 * SRS_UTIME_MILLISECONDS, conf.get_rtc_pacing_max_delay("__defaultVhost__"));
+    }
 }
 
 VOID TEST(ConfigEnvTest, CheckEnvValuesVhostPlay)
@@ -4582,6 +4736,9 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesExporter)
 
         SrsSetEnvConfig(exporter_tag, "SRS_EXPORTER_TAG", "xxx3");
         EXPECT_STREQ("xxx3", conf.get_exporter_tag().c_str());
+
+        SrsSetEnvConfig(exporter_max_streams, "SRS_EXPORTER_MAX_STREAMS", "1000");
+        EXPECT_EQ(1000, conf.get_exporter_max_streams());
     }
 }
 
@@ -4609,6 +4766,16 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesHeartbeat)
     }
 }
 
+VOID TEST(ConfigEnvTest, CheckEnvValuesStats)
+{
+    if (true) {
+        MockSrsConfig conf;
+
+        SrsSetEnvConfig(stats_latency, "SRS_STATS_LATENCY", "on");
+        EXPECT_TRUE(conf.get_stats_latency());
+    }
+}
+
 VOID TEST(ConfigEnvTest, CheckEnvValuesScope)
 {
     srs_error_t err;
@@ -4801,6 +4968,18 @@ VOID TEST(ConfigEnvTest, CheckEnvValuesDvr)
 
         SrsSetEnvConfig(dvr_time_jitter_zero, "SRS_VHOST_DVR_TIME_JITTER", "zero");
         EXPECT_EQ(0x2, conf.get_dvr_time_jitter("__defaultVhost__"));
+
+        EXPECT_FALSE(conf.get_dvr_fmp4("__defaultVhost__"));
+        SrsSetEnvConfig(dvr_fmp4, "SRS_VHOST_DVR_DVR_FMP4", "on");
+        EXPECT_TRUE(conf.get_dvr_fmp4("__defaultVhost__"));
+
+        EXPECT_EQ(2 * SRS_UTIME_SECONDS, conf.get_dvr_fmp4_fragment("__defaultVhost__"));
+        SrsSetEnvConfig(dvr_fmp4_fragment, "SRS_VHOST_DVR_DVR_FMP4_FRAGMENT", "1.5");
+        EXPECT_EQ(1500 * SRS_UTIME_MILLISECONDS, conf.get_dvr_fmp4_fragment("__defaultVhost__"));
+
+        EXPECT_FALSE(conf.get_dvr_fmp4_faststart("__defaultVhost__"));
+        SrsSetEnvConfig(dvr_fmp4_faststart, "SRS_VHOST_DVR_DVR_FMP4_FASTSTART", "on");
+        EXPECT_TRUE(conf.get_dvr_fmp4_faststart("__defaultVhost__"));
     }
 }
 
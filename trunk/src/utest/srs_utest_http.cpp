@@ -6,6 +6,8 @@
 #include <srs_utest_http.hpp>
 
 #include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
 using namespace std;
 
 #include <srs_protocol_http_stack.hpp>
@@ -18,6 +20,8 @@ using namespace std;
 #include <srs_app_http_static.hpp>
 #include <srs_protocol_utility.hpp>
 #include <srs_core_autofree.hpp>
+#include <srs_kernel_flv.hpp>
+#include <srs_protocol_st.hpp>
 
 MockMSegmentsReader::MockMSegmentsReader()
 {
@@ -1265,6 +1269,23 @@ VOID TEST(ProtocolHTTPTest, VodStreamHandlers)
         __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
     }
 
+    // Seek by time, fail for invalid mp4.
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsVodStream h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4?start=2.5", false));
+
+        HELPER_EXPECT_FAILED(h.serve_http(&w, &r));
+    }
+
     // Should return "hls_ctx"
     if (true) {
         SrsHttpMuxEntry e;
@@ -1417,6 +1438,23 @@ VOID TEST(ProtocolHTTPTest, BasicHandlers)
         __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
     }
 
+    if (true) {
+        SrsHttpMuxEntry e;
+        e.pattern = "/";
+
+        SrsHttpFileServer h("/tmp");
+        h.set_fs_factory(new MockFileReaderFactory("Hello, world!"));
+        h.set_path_check(_mock_srs_path_always_exists);
+        h.entry = &e;
+
+        MockResponseWriter w;
+        SrsHttpMessage r(NULL, NULL);
+        HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4?start=2.5", false));
+
+        HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+        __MOCK_HTTP_EXPECT_STREQ(200, "Hello, world!", w);
+    }
+
     if (true) {
         SrsHttpMuxEntry e;
         e.pattern = "/";
@@ -2153,3 +2191,209 @@ VOID TEST(ProtocolHTTPTest, PathEscape)
     }
 }
 
+
+VOID TEST(ProtocolHTTPTest, HTTPFileCache)
+{
+    // Disabled cache never caches any file.
+    if (true) {
+        SrsHttpFileCache cache;
+        EXPECT_FALSE(cache.enabled());
+        EXPECT_FALSE(cache.cacheable(10));
+
+        SrsSharedPtrMessage* msg = cache.store("/a.m3u8", 100, new char[10], 10);
+        SrsAutoFree(SrsSharedPtrMessage, msg);
+        EXPECT_EQ(10, msg->size);
+        EXPECT_EQ(0, cache.count());
+    }
+
+    // Hit if mtime and size not changed, miss if file changed.
+    if (true) {
+        SrsHttpFileCache cache;
+        cache.initialize(true, 100, 20);
+        EXPECT_TRUE(cache.cacheable(20));
+        EXPECT_FALSE(cache.cacheable(21));
+        EXPECT_FALSE(cache.cacheable(0));
+
+        EXPECT_TRUE(cache.fetch("/a.m3u8", 100, 10) == NULL);
+        SrsSharedPtrMessage* msg = cache.store("/a.m3u8", 100, new char[10], 10);
+        srs_freep(msg);
+        EXPECT_EQ(1, cache.count());
+        EXPECT_EQ(10, cache.size());
+
+        msg = cache.fetch("/a.m3u8", 100, 10);
+        EXPECT_TRUE(msg != NULL);
+        srs_freep(msg);
+
+        // The file is updated, so the entry is stale.
+        EXPECT_TRUE(cache.fetch("/a.m3u8", 200, 10) == NULL);
+        EXPECT_EQ(0, cache.count());
+        EXPECT_EQ(0, cache.size());
+
+        EXPECT_EQ(1, cache.hits());
+        EXPECT_EQ(2, cache.misses());
+        EXPECT_NEAR(1.0 / 3, cache.hit_ratio(), 0.001);
+    }
+
+    // Evict the least recently used files.
+    if (true) {
+        SrsHttpFileCache cache;
+        cache.initialize(true, 30, 20);
+
+        SrsSharedPtrMessage* msg = cache.store("/a.ts", 100, new char[10], 10);
+        srs_freep(msg);
+        msg = cache.store("/b.ts", 100, new char[10], 10);
+        srs_freep(msg);
+        msg = cache.store("/c.ts", 100, new char[10], 10);
+        srs_freep(msg);
+        EXPECT_EQ(3, cache.count());
+
+        // Use a.ts, so b.ts is the least recently used.
+        msg = cache.fetch("/a.ts", 100, 10);
+        EXPECT_TRUE(msg != NULL);
+
+        // The shared payload is still valid after evicted.
+        SrsSharedPtrMessage* msg2 = cache.store("/d.ts", 100, new char[20], 20);
+        srs_freep(msg2);
+        EXPECT_EQ(2, cache.count());
+        EXPECT_EQ(30, cache.size());
+        EXPECT_EQ(2, cache.evicts());
+        EXPECT_EQ(10, msg->size);
+        srs_freep(msg);
+
+        EXPECT_TRUE(cache.fetch("/b.ts", 100, 10) == NULL);
+        EXPECT_TRUE(cache.fetch("/c.ts", 100, 10) == NULL);
+
+        msg = cache.fetch("/d.ts", 100, 20);
+        EXPECT_TRUE(msg != NULL);
+        srs_freep(msg);
+    }
+}
+
+// The socket which counts the bytes sent by sendfile.
+class MockSendfileSocket : public SrsStSocket
+{
+public:
+    int nn_sendfile_;
+    int64_t nn_bytes_;
+public:
+    MockSendfileSocket(srs_netfd_t fd) : SrsStSocket(fd) {
+        nn_sendfile_ = 0;
+        nn_bytes_ = 0;
+    }
+    virtual ~MockSendfileSocket() {
+    }
+public:
+    virtual srs_error_t sendfile(int fd, off_t offset, size_t size, ssize_t* nwrite) {
+        nn_sendfile_++;
+        nn_bytes_ += size;
+        return SrsStSocket::sendfile(fd, offset, size, nwrite);
+    }
+};
+
+// Read all bytes of response from the peer of socket.
+string mock_read_response(int fd)
+{
+    string data;
+    char buf[1024];
+    while (true) {
+        ssize_t nn = ::read(fd, buf, sizeof(buf));
+        if (nn <= 0) {
+            break;
+        }
+        data.append(buf, nn);
+    }
+    return data;
+}
+
+VOID TEST(ProtocolHTTPTest, HTTPServeFileBySendfile)
+{
+    srs_error_t err;
+
+    string dir = _srs_tmp_file_prefix + "sendfile";
+    HELPER_ASSERT_SUCCESS(srs_create_dir_recursively(dir));
+
+    string body = "Hello, world!";
+    for (int i = 0; i < 2; i++) {
+        SrsFileWriter fw;
+        HELPER_ASSERT_SUCCESS(fw.open(dir + (i == 0 ? "/index.html" : "/index.mp4")));
+        HELPER_ASSERT_SUCCESS(fw.write((void*)body.data(), body.length(), NULL));
+    }
+
+    // Serve the whole file.
+    if (true) {
+        int fds[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+        srs_netfd_t stfd = srs_netfd_open_socket(fds[0]);
+        ASSERT_TRUE(stfd != NULL);
+
+        if (true) {
+            SrsHttpMuxEntry e;
+            e.pattern = "/";
+
+            SrsHttpFileServer h(dir);
+            h.entry = &e;
+
+            MockSendfileSocket skt(stfd);
+            SrsHttpResponseWriter w(&skt);
+            SrsHttpMessage r(NULL, NULL);
+            HELPER_ASSERT_SUCCESS(r.set_url("/index.html", false));
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            EXPECT_EQ(1, skt.nn_sendfile_);
+            EXPECT_EQ((int64_t)body.length(), skt.nn_bytes_);
+        }
+        srs_close_stfd(stfd);
+
+        string res = mock_read_response(fds[1]);
+        ::close(fds[1]);
+
+        EXPECT_EQ(0, (int)res.find("HTTP/1.1 200 OK"));
+        EXPECT_NE(string::npos, res.find("Content-Length: 13"));
+        EXPECT_TRUE(srs_string_ends_with(res, "\r\n\r\n" + body));
+    }
+
+    // Serve the range of file.
+    if (true) {
+        int fds[2];
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+        srs_netfd_t stfd = srs_netfd_open_socket(fds[0]);
+        ASSERT_TRUE(stfd != NULL);
+
+        if (true) {
+            SrsHttpMuxEntry e;
+            e.pattern = "/";
+
+            SrsVodStream h(dir);
+            h.set_sendfile(true);
+            h.entry = &e;
+
+            MockSendfileSocket skt(stfd);
+            SrsHttpResponseWriter w(&skt);
+            SrsHttpMessage r(NULL, NULL);
+
+            SrsHttpHeader hdr;
+            hdr.set("Range", "bytes=2-5");
+            r.set_header(&hdr, false);
+            HELPER_ASSERT_SUCCESS(r.set_url("/index.mp4", false));
+
+            HELPER_ASSERT_SUCCESS(h.serve_http(&w, &r));
+            EXPECT_EQ(1, skt.nn_sendfile_);
+            EXPECT_EQ(4, skt.nn_bytes_);
+        }
+        srs_close_stfd(stfd);
+
+        string res = mock_read_response(fds[1]);
+        ::close(fds[1]);
+
+        EXPECT_EQ(0, (int)res.find("HTTP/1.1 206 Partial Content"));
+        EXPECT_NE(string::npos, res.find("Content-Length: 4"));
+        EXPECT_NE(string::npos, res.find("Content-Range: bytes 2-5/13"));
+        EXPECT_TRUE(srs_string_ends_with(res, "\r\n\r\nllo,"));
+    }
+
+    ::unlink((dir + "/index.html").c_str());
+    ::unlink((dir + "/index.mp4").c_str());
+    ::rmdir(dir.c_str());
+}
@@ -22,6 +22,8 @@ using namespace std;
 #include <srs_kernel_mp4.hpp>
 #include <srs_core_autofree.hpp>
 
+#include <openssl/evp.h>
+
 #define MAX_MOCK_DATA_SIZE 1024 * 1024
 
 MockSrsFile::MockSrsFile()
@@ -4220,6 +4222,68 @@ VOID TEST(KernelFileWriterTest, WriteSpecialCase)
 	}
 }
 
+string _mock_written_data;
+
+ssize_t mock_write_to_memory(int /*fildes*/, const void* buf, size_t nbyte) {
+	_mock_written_data.append((const char*)buf, nbyte);
+	return nbyte;
+}
+
+VOID TEST(KernelFileWriterTest, WriteEncryptedHLS)
+{
+	srs_error_t err;
+
+	unsigned char key[16], iv[16];
+	for (int i = 0; i < 16; i++) {
+		key[i] = (unsigned char)i;
+		iv[i] = (unsigned char)(0xf0 + i);
+	}
+
+	// The plaintext exceed the bulk buffer, and not aligned to 16 bytes.
+	string plaintext;
+	for (int i = 0; i < 600 * SRS_TS_PACKET_SIZE + 7; i++) {
+		plaintext.append(1, (char)(i & 0xff));
+	}
+
+	// Write two segments with the same key, each should be encrypted from iv.
+	for (int k = 0; k < 2; k++) {
+		_mock_written_data.clear();
+
+		if (true) {
+			MockSystemIO _mockio(NULL, mock_write_to_memory);
+			SrsEncFileWriter f;
+			HELPER_EXPECT_FAILED(f.write((void*)plaintext.data(), 1, NULL));
+
+			HELPER_EXPECT_SUCCESS(f.config_cipher(key, iv));
+			HELPER_EXPECT_SUCCESS(f.open("/dev/null"));
+
+			// Write in packets, and a large chunk.
+			for (int i = 0; i < 100; i++) {
+				HELPER_EXPECT_SUCCESS(f.write((void*)(plaintext.data() + i * SRS_TS_PACKET_SIZE), SRS_TS_PACKET_SIZE, NULL));
+			}
+			ssize_t nn = 0;
+			HELPER_EXPECT_SUCCESS(f.write((void*)(plaintext.data() + 100 * SRS_TS_PACKET_SIZE), plaintext.length() - 100 * SRS_TS_PACKET_SIZE, &nn));
+			EXPECT_EQ((int)(plaintext.length() - 100 * SRS_TS_PACKET_SIZE), (int)nn);
+			f.close();
+		}
+
+		// Padding by PKCS7.
+		EXPECT_EQ((int)(plaintext.length() / 16 + 1) * 16, (int)_mock_written_data.length());
+
+		EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+		EXPECT_EQ(1, EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv));
+
+		vector<unsigned char> out(_mock_written_data.length() + 16);
+		int nn = 0, nn2 = 0;
+		EXPECT_EQ(1, EVP_DecryptUpdate(ctx, &out[0], &nn, (unsigned char*)_mock_written_data.data(), (int)_mock_written_data.length()));
+		EXPECT_EQ(1, EVP_DecryptFinal_ex(ctx, &out[nn], &nn2));
+		EVP_CIPHER_CTX_free(ctx);
+
+		EXPECT_EQ((int)plaintext.length(), nn + nn2);
+		EXPECT_TRUE(plaintext == string((char*)&out[0], nn + nn2));
+	}
+}
+
 VOID TEST(KernelFileReaderTest, WriteSpecialCase)
 {
 	srs_error_t err;
@@ -5881,6 +5945,406 @@ VOID TEST(KernelMP4Test, CoverMP4M2tsSegmentEncoder)
     HELPER_EXPECT_SUCCESS(enc.flush(dts));
 }
 
+VOID TEST(KernelMP4Test, CoverFMP4EncoderAndDefragmenter)
+{
+	srs_error_t err;
+
+    MockSrsFileWriter f;
+
+    // Encode 10 frames of A/V in 400ms, with keyframe every 200ms, to fMP4 of 100ms fragment.
+    if (true) {
+        SrsFmp4Encoder enc;
+        SrsFormat fmt;
+        HELPER_EXPECT_SUCCESS(enc.initialize(&f, 100 * SRS_UTIME_MILLISECONDS));
+        HELPER_EXPECT_SUCCESS(fmt.initialize());
+        enc.acodec = SrsAudioCodecIdAAC;
+
+        if (true) {
+            uint8_t raw[] = {
+                0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+            };
+            HELPER_EXPECT_SUCCESS(fmt.on_video(0, (char*)raw, sizeof(raw)));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeVIDE, fmt.video->frame_type, fmt.video->avc_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+            ));
+        }
+
+        if (true) {
+            uint8_t raw[] = {
+                0xaf, 0x00, 0x12, 0x10
+            };
+            HELPER_EXPECT_SUCCESS(fmt.on_audio(0, (char*)raw, sizeof(raw)));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeSOUN, 0x00, fmt.audio->aac_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+            ));
+        }
+
+        for (int i = 0; i < 10; i++) {
+            uint32_t dts = i * 40;
+
+            if (true) {
+                uint8_t raw[] = {
+                    0x17, 0x01, 0x00, 0x00, 0x50, 0x00, 0x00, 0x00, 0x7b, 0x41, 0x9a, 0x21, 0x6c, 0x42, 0x1f, 0x00, 0x00, 0xf1, 0x68, 0x1a, 0x35, 0x84, 0xb3, 0xee, 0xe0, 0x61, 0xba, 0x4e, 0xa8, 0x52, 0x48, 0x50, 0x59, 0x75, 0x42, 0xd9, 0x96, 0x4a, 0x51, 0x38, 0x2c, 0x63, 0x5e, 0x41, 0xc9, 0x70, 0x60, 0x9d, 0x13, 0x53, 0xc2, 0xa8, 0xf5, 0x45, 0x86, 0xc5, 0x3e, 0x28, 0x1a, 0x69, 0x5f, 0x71, 0x1e, 0x51, 0x74, 0x0e, 0x31, 0x47, 0x3c, 0xd3, 0xd2, 0x10, 0x25, 0x45, 0xc5, 0xb7, 0x31, 0xec, 0x7f, 0xd8, 0x02, 0xae, 0xa4, 0x77, 0x6d, 0xcb, 0xc6, 0x1e, 0x2f, 0xa2, 0xd1, 0x12, 0x08, 0x34, 0x52, 0xea, 0xe8, 0x0b, 0x4f, 0x81, 0x21, 0x4f, 0x71, 0x3f, 0xf2, 0xad, 0x02, 0x58, 0xdf, 0x9e, 0x31, 0x86, 0x9b, 0x1b, 0x41, 0xbf, 0x2a, 0x09, 0x00, 0x43, 0x5c, 0xa1, 0x7e, 0x76, 0x59, 0xef, 0xa6, 0xfc, 0x82, 0xb2, 0x72, 0x5a
+                };
+                raw[0] = (i % 5) ? 0x27 : 0x17;
+                HELPER_EXPECT_SUCCESS(fmt.on_video(0, (char*)raw, sizeof(raw)));
+                HELPER_EXPECT_SUCCESS(enc.write_sample(
+                    &fmt, SrsMp4HandlerTypeVIDE, fmt.video->frame_type, fmt.video->avc_packet_type, dts, dts, (uint8_t*)fmt.raw, fmt.nb_raw
+                ));
+            }
+
+            if (true) {
+                uint8_t raw[] = {
+                    0xaf, 0x01, 0x21, 0x11, 0x45, 0x00, 0x14, 0x50, 0x01, 0x46, 0xf3, 0xf1, 0x0a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5e
+                };
+                HELPER_EXPECT_SUCCESS(fmt.on_audio(0, (char*)raw, sizeof(raw)));
+                HELPER_EXPECT_SUCCESS(enc.write_sample(
+                    &fmt, SrsMp4HandlerTypeSOUN, 0x00, fmt.audio->aac_packet_type, dts, dts, (uint8_t*)fmt.raw, fmt.nb_raw
+                ));
+            }
+        }
+
+        HELPER_EXPECT_SUCCESS(enc.flush());
+    }
+
+    // The fragment is flushed at keyframe, so there are two fragments.
+    if (true) {
+        SrsMp4BoxReader br;
+        MockSrsFileReader fr((const char*)f.data(), f.filesize());
+        HELPER_EXPECT_SUCCESS(br.initialize(&fr));
+
+        SrsSimpleStream stream;
+        int nb_moovs = 0, nb_moofs = 0, nb_mdats = 0;
+
+        for (;;) {
+            SrsMp4Box* box = NULL;
+            srs_error_t err = br.read(&stream, &box);
+            if (err != srs_success) {
+                srs_freep(err);
+                break;
+            }
+
+            SrsBuffer buffer(stream.bytes(), stream.length());
+            HELPER_EXPECT_SUCCESS(box->decode(&buffer));
+
+            if (box->is_moov()) {
+                nb_moovs++;
+            }
+            if (box->is_mdat()) {
+                nb_mdats++;
+            }
+            if (box->type == SrsMp4BoxTypeMOOF) {
+                nb_moofs++;
+                SrsMp4MovieFragmentBox* moof = dynamic_cast<SrsMp4MovieFragmentBox*>(box);
+                EXPECT_EQ(2, moof->nb_trafs());
+                EXPECT_EQ(5, (int)moof->traf_at(0)->trun()->entries.size());
+                EXPECT_EQ(5, (int)moof->traf_at(1)->trun()->entries.size());
+                EXPECT_TRUE(moof->traf_at(2) == NULL);
+            }
+
+            HELPER_EXPECT_SUCCESS(br.skip(box, &stream));
+
+            srs_freep(box);
+        }
+
+        EXPECT_EQ(1, nb_moovs);
+        EXPECT_EQ(2, nb_moofs);
+        EXPECT_EQ(2, nb_mdats);
+    }
+
+    // Defragment to MP4, and decode it.
+    if (true) {
+        MockSrsFileWriter mp4;
+        if (true) {
+            MockSrsFileReader fr((const char*)f.data(), f.filesize());
+            SrsFmp4Defragmenter defrag;
+            HELPER_EXPECT_SUCCESS(defrag.initialize(&fr, &mp4));
+            HELPER_EXPECT_SUCCESS(defrag.defragment());
+        }
+
+        MockSrsFileReader fr((const char*)mp4.data(), mp4.filesize());
+        SrsMp4Decoder dec;
+        HELPER_EXPECT_SUCCESS(dec.initialize(&fr));
+
+        SrsMp4HandlerType ht;
+        uint16_t ft, ct;
+        uint32_t dts, pts, nb_sample;
+        uint8_t* sample = NULL;
+
+        // Sequence header.
+        HELPER_EXPECT_SUCCESS(dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample));
+        EXPECT_EQ(41, (int)nb_sample);
+        EXPECT_EQ(SrsMp4HandlerTypeVIDE, ht);
+        srs_freepa(sample);
+
+        HELPER_EXPECT_SUCCESS(dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample));
+        EXPECT_EQ(2, (int)nb_sample);
+        EXPECT_EQ(SrsMp4HandlerTypeSOUN, ht);
+        srs_freepa(sample);
+
+        int nb_videos = 0, nb_audios = 0, nb_keyframes = 0;
+        while (true) {
+            if ((err = dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample)) != srs_success) {
+                srs_freep(err);
+                break;
+            }
+            srs_freepa(sample);
+
+            if (ht == SrsMp4HandlerTypeVIDE) {
+                EXPECT_EQ(nb_videos * 40, (int)dts);
+                EXPECT_EQ(127, (int)nb_sample);
+                nb_keyframes += (ft == SrsVideoAvcFrameTypeKeyFrame) ? 1 : 0;
+                nb_videos++;
+            } else {
+                EXPECT_EQ(nb_audios * 40, (int)dts);
+                EXPECT_EQ(87, (int)nb_sample);
+                nb_audios++;
+            }
+        }
+        EXPECT_EQ(10, nb_videos);
+        EXPECT_EQ(10, nb_audios);
+        EXPECT_EQ(2, nb_keyframes);
+    }
+
+    // Defragment by copying samples in batches, which should be the same as defragment in one call.
+    if (true) {
+        MockSrsFileWriter mp4;
+        if (true) {
+            MockSrsFileReader fr((const char*)f.data(), f.filesize());
+            SrsFmp4Defragmenter defrag;
+            HELPER_EXPECT_SUCCESS(defrag.initialize(&fr, &mp4));
+            HELPER_EXPECT_SUCCESS(defrag.defragment());
+        }
+
+        MockSrsFileWriter batch;
+        if (true) {
+            MockSrsFileReader fr((const char*)f.data(), f.filesize());
+            SrsFmp4Defragmenter defrag;
+            HELPER_EXPECT_SUCCESS(defrag.initialize(&fr, &batch));
+            HELPER_EXPECT_SUCCESS(defrag.start());
+
+            int nb_copies = 0;
+            bool done = false;
+            while (!done) {
+                HELPER_EXPECT_SUCCESS(defrag.copy(100, &done));
+                nb_copies++;
+            }
+            EXPECT_EQ((10 * (127 + 87) + 99) / 100, nb_copies);
+        }
+
+        EXPECT_EQ(mp4.filesize(), batch.filesize());
+        EXPECT_TRUE(srs_bytes_equals(mp4.data(), batch.data(), (int)mp4.filesize()));
+    }
+
+    // Defragment the truncated fMP4, for example, server crashed, the truncated sample is ignored.
+    if (true) {
+        MockSrsFileWriter mp4;
+        if (true) {
+            MockSrsFileReader fr((const char*)f.data(), f.filesize() - 10);
+            SrsFmp4Defragmenter defrag;
+            HELPER_EXPECT_SUCCESS(defrag.initialize(&fr, &mp4));
+            HELPER_EXPECT_SUCCESS(defrag.defragment());
+        }
+
+        MockSrsFileReader fr((const char*)mp4.data(), mp4.filesize());
+        SrsMp4Decoder dec;
+        HELPER_EXPECT_SUCCESS(dec.initialize(&fr));
+
+        int nb_samples = 0;
+        while (true) {
+            SrsMp4HandlerType ht;
+            uint16_t ft, ct;
+            uint32_t dts, pts, nb_sample;
+            uint8_t* sample = NULL;
+            if ((err = dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample)) != srs_success) {
+                srs_freep(err);
+                break;
+            }
+            srs_freepa(sample);
+            nb_samples++;
+        }
+        // The sequence headers, 10 samples in the first fragment, and 9 samples in the last one.
+        EXPECT_EQ(2 + 10 + 9, nb_samples);
+    }
+}
+
+VOID TEST(KernelMP4Test, CoverMP4VodIndexSeek)
+{
+    srs_error_t err;
+
+    MockSrsFileWriter f;
+
+    // Encode 10 frames of A/V in 400ms, with keyframe every 200ms.
+    if (true) {
+        SrsMp4Encoder enc;
+        SrsFormat fmt;
+        HELPER_EXPECT_SUCCESS(enc.initialize(&f));
+        HELPER_EXPECT_SUCCESS(fmt.initialize());
+        enc.acodec = SrsAudioCodecIdAAC;
+
+        if (true) {
+            uint8_t raw[] = {
+                0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x64, 0x00, 0x20, 0xff, 0xe1, 0x00, 0x19, 0x67, 0x64, 0x00, 0x20, 0xac, 0xd9, 0x40, 0xc0, 0x29, 0xb0, 0x11, 0x00, 0x00, 0x03, 0x00, 0x01, 0x00, 0x00, 0x03, 0x00, 0x32, 0x0f, 0x18, 0x31, 0x96, 0x01, 0x00, 0x05, 0x68, 0xeb, 0xec, 0xb2, 0x2c
+            };
+            HELPER_EXPECT_SUCCESS(fmt.on_video(0, (char*)raw, sizeof(raw)));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeVIDE, fmt.video->frame_type, fmt.video->avc_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+            ));
+        }
+
+        if (true) {
+            uint8_t raw[] = {
+                0xaf, 0x00, 0x12, 0x10
+            };
+            HELPER_EXPECT_SUCCESS(fmt.on_audio(0, (char*)raw, sizeof(raw)));
+            HELPER_EXPECT_SUCCESS(enc.write_sample(
+                &fmt, SrsMp4HandlerTypeSOUN, 0x00, fmt.audio->aac_packet_type, 0, 0, (uint8_t*)fmt.raw, fmt.nb_raw
+            ));
+        }
+
+        for (int i = 0; i < 10; i++) {
+            uint32_t dts = i * 40;
+
+            if (true) {
+                uint8_t raw[] = {
+                    0x17, 0x01, 0x00, 0x00, 0x50, 0x00, 0x00, 0x00, 0x7b, 0x41, 0x9a, 0x21, 0x6c, 0x42, 0x1f, 0x00, 0x00, 0xf1, 0x68, 0x1a, 0x35, 0x84, 0xb3, 0xee, 0xe0, 0x61, 0xba, 0x4e, 0xa8, 0x52, 0x48, 0x50, 0x59, 0x75, 0x42, 0xd9, 0x96, 0x4a, 0x51, 0x38, 0x2c, 0x63, 0x5e, 0x41, 0xc9, 0x70, 0x60, 0x9d, 0x13, 0x53, 0xc2, 0xa8, 0xf5, 0x45, 0x86, 0xc5, 0x3e, 0x28, 0x1a, 0x69, 0x5f, 0x71, 0x1e, 0x51, 0x74, 0x0e, 0x31, 0x47, 0x3c, 0xd3, 0xd2, 0x10, 0x25, 0x45, 0xc5, 0xb7, 0x31, 0xec, 0x7f, 0xd8, 0x02, 0xae, 0xa4, 0x77, 0x6d, 0xcb, 0xc6, 0x1e, 0x2f, 0xa2, 0xd1, 0x12, 0x08, 0x34, 0x52, 0xea, 0xe8, 0x0b, 0x4f, 0x81, 0x21, 0x4f, 0x71, 0x3f, 0xf2, 0xad, 0x02, 0x58, 0xdf, 0x9e, 0x31, 0x86, 0x9b, 0x1b, 0x41, 0xbf, 0x2a, 0x09, 0x00, 0x43, 0x5c, 0xa1, 0x7e, 0x76, 0x59, 0xef, 0xa6, 0xfc, 0x82, 0xb2, 0x72, 0x5a
+                };
+                raw[0] = (i % 5) ? 0x27 : 0x17;
+                HELPER_EXPECT_SUCCESS(fmt.on_video(0, (char*)raw, sizeof(raw)));
+                HELPER_EXPECT_SUCCESS(enc.write_sample(
+                    &fmt, SrsMp4HandlerTypeVIDE, fmt.video->frame_type, fmt.video->avc_packet_type, dts, dts, (uint8_t*)fmt.raw, fmt.nb_raw
+                ));
+            }
+
+            if (true) {
+                uint8_t raw[] = {
+                    0xaf, 0x01, 0x21, 0x11, 0x45, 0x00, 0x14, 0x50, 0x01, 0x46, 0xf3, 0xf1, 0x0a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5a, 0x5e
+                };
+                HELPER_EXPECT_SUCCESS(fmt.on_audio(0, (char*)raw, sizeof(raw)));
+                HELPER_EXPECT_SUCCESS(enc.write_sample(
+                    &fmt, SrsMp4HandlerTypeSOUN, 0x00, fmt.audio->aac_packet_type, dts, dts, (uint8_t*)fmt.raw, fmt.nb_raw
+                ));
+            }
+        }
+
+        HELPER_EXPECT_SUCCESS(enc.flush());
+    }
+
+    SrsMp4VodIndex index;
+    if (true) {
+        MockSrsFileReader fr((const char*)f.data(), f.filesize());
+        HELPER_EXPECT_SUCCESS(index.initialize(&fr));
+        EXPECT_EQ(20, index.nb_samples());
+    }
+
+    // Seek to 250ms, which starts from the keyframe at 200ms, the index is reused for each seeking.
+    for (int k = 0; k < 2; k++) {
+        SrsSimpleStream header;
+        uint64_t offset = 0, size = 0;
+        HELPER_EXPECT_SUCCESS(index.seek(250 * SRS_UTIME_MILLISECONDS, &header, &offset, &size));
+        EXPECT_TRUE(offset > 0);
+        EXPECT_TRUE(offset + size <= (uint64_t)f.filesize());
+
+        // The trimmed MP4 is the header and the range of file.
+        MockSrsFileWriter mp4;
+        HELPER_EXPECT_SUCCESS(mp4.write(header.bytes(), header.length(), NULL));
+        HELPER_EXPECT_SUCCESS(mp4.write((char*)f.data() + offset, size, NULL));
+
+        MockSrsFileReader fr((const char*)mp4.data(), mp4.filesize());
+        SrsMp4Decoder dec;
+        HELPER_EXPECT_SUCCESS(dec.initialize(&fr));
+
+        SrsMp4HandlerType ht;
+        uint16_t ft, ct;
+        uint32_t dts, pts, nb_sample;
+        uint8_t* sample = NULL;
+
+        // Sequence header.
+        HELPER_EXPECT_SUCCESS(dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample));
+        EXPECT_EQ(41, (int)nb_sample);
+        EXPECT_EQ(SrsMp4HandlerTypeVIDE, ht);
+        srs_freepa(sample);
+
+        HELPER_EXPECT_SUCCESS(dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample));
+        EXPECT_EQ(2, (int)nb_sample);
+        EXPECT_EQ(SrsMp4HandlerTypeSOUN, ht);
+        srs_freepa(sample);
+
+        int nb_videos = 0, nb_audios = 0, nb_keyframes = 0;
+        while (true) {
+            if ((err = dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample)) != srs_success) {
+                srs_freep(err);
+                break;
+            }
+            srs_freepa(sample);
+
+            if (ht == SrsMp4HandlerTypeVIDE) {
+                EXPECT_EQ(nb_videos * 40, (int)dts);
+                EXPECT_EQ(127, (int)nb_sample);
+                if (nb_videos == 0) {
+                    EXPECT_EQ(SrsVideoAvcFrameTypeKeyFrame, ft);
+                }
+                nb_keyframes += (ft == SrsVideoAvcFrameTypeKeyFrame) ? 1 : 0;
+                nb_videos++;
+            } else {
+                EXPECT_EQ(nb_audios * 40, (int)dts);
+                EXPECT_EQ(87, (int)nb_sample);
+                nb_audios++;
+            }
+        }
+        EXPECT_EQ(5, nb_videos);
+        EXPECT_EQ(5, nb_audios);
+        EXPECT_EQ(1, nb_keyframes);
+    }
+
+    // Seek exceed the duration, starts from the last keyframe.
+    if (true) {
+        SrsSimpleStream header;
+        uint64_t offset = 0, size = 0;
+        HELPER_EXPECT_SUCCESS(index.seek(10 * SRS_UTIME_SECONDS, &header, &offset, &size));
+        EXPECT_EQ(5 * (127 + 87), (int)size);
+    }
+
+    // Seek to the start, the moov reused by index is rebuilt with all samples.
+    if (true) {
+        SrsSimpleStream header;
+        uint64_t offset = 0, size = 0;
+        HELPER_EXPECT_SUCCESS(index.seek(0, &header, &offset, &size));
+        EXPECT_EQ(10 * (127 + 87), (int)size);
+
+        MockSrsFileWriter mp4;
+        HELPER_EXPECT_SUCCESS(mp4.write(header.bytes(), header.length(), NULL));
+        HELPER_EXPECT_SUCCESS(mp4.write((char*)f.data() + offset, size, NULL));
+
+        MockSrsFileReader fr((const char*)mp4.data(), mp4.filesize());
+        SrsMp4Decoder dec;
+        HELPER_EXPECT_SUCCESS(dec.initialize(&fr));
+
+        int nb_samples = 0;
+        while (true) {
+            SrsMp4HandlerType ht;
+            uint16_t ft, ct;
+            uint32_t dts, pts, nb_sample;
+            uint8_t* sample = NULL;
+            if ((err = dec.read_sample(&ht, &ft, &ct, &dts, &pts, &sample, &nb_sample)) != srs_success) {
+                srs_freep(err);
+                break;
+            }
+            srs_freepa(sample);
+            nb_samples++;
+        }
+        // The sequence header of video and audio, and 20 samples.
+        EXPECT_EQ(22, nb_samples);
+    }
+
+    // The MP4 without moov is not supported.
+    if (true) {
+        SrsMp4VodIndex v;
+        MockSrsFileReader fr((const char*)f.data(), 32);
+        HELPER_EXPECT_FAILED(v.initialize(&fr));
+    }
+}
+
 VOID TEST(KernelUtilityTest, CoverStringAssign)
 {
     string sps = "SRS";
@@ -14,6 +14,11 @@
 #include <srs_app_rtc_conn.hpp>
 #include <srs_kernel_codec.hpp>
 #include <srs_app_conn.hpp>
+#include <srs_app_rtc_sdp.hpp>
+#include <srs_app_rtc_dtls.hpp>
+#include <srs_app_rtc_network.hpp>
+#include <srs_app_statistic.hpp>
+#include <srs_protocol_st.hpp>
 
 #include <srs_utest_service.hpp>
 
@@ -1369,3 +1374,1353 @@ VOID TEST(KernelRTCTest, JitterSequence)
     EXPECT_EQ((uint32_t)11, jitter.correct(11));
 }
 
+
+VOID TEST(AppRTCTest, LazyBridge)
+{
+    // Always active if not lazy.
+    if (true) {
+        SrsLazyBridge lazy;
+        lazy.initialize(false, 0);
+        EXPECT_TRUE(lazy.active());
+        EXPECT_FALSE(lazy.update(false));
+        EXPECT_TRUE(lazy.active());
+    }
+
+    // Activate by consumers, and suspend without grace period.
+    if (true) {
+        SrsLazyBridge lazy;
+        lazy.initialize(true, 0);
+        EXPECT_FALSE(lazy.active());
+        EXPECT_FALSE(lazy.update(false));
+
+        EXPECT_TRUE(lazy.update(true));
+        EXPECT_TRUE(lazy.active());
+        EXPECT_FALSE(lazy.update(true));
+
+        EXPECT_TRUE(lazy.update(false));
+        EXPECT_FALSE(lazy.active());
+        EXPECT_FALSE(lazy.update(false));
+    }
+
+    // Keep active in grace period, even when consumers leave.
+    if (true) {
+        SrsLazyBridge lazy;
+        lazy.initialize(true, 3600 * SRS_UTIME_SECONDS);
+        EXPECT_TRUE(lazy.update(true));
+        EXPECT_FALSE(lazy.update(false));
+        EXPECT_TRUE(lazy.active());
+        EXPECT_FALSE(lazy.update(true));
+        EXPECT_TRUE(lazy.active());
+    }
+}
+
+VOID TEST(KernelRTCTest, TwccRecvAndEncode)
+{
+    srs_error_t err;
+
+    // Encode the received packets with lost one, and parse the feedback.
+    if (true) {
+        SrsRtcpTWCC twcc(0x01);
+        twcc.set_media_ssrc(0x02);
+        EXPECT_FALSE(twcc.need_feedback());
+
+        for (uint16_t sn = 100; sn <= 110; sn++) {
+            if (sn == 105) continue;
+            HELPER_ASSERT_SUCCESS(twcc.recv_packet(sn, 1000 * SRS_UTIME_MILLISECONDS + sn * SRS_UTIME_MILLISECONDS));
+        }
+        HELPER_EXPECT_FAILED(twcc.recv_packet(108, 0));
+        EXPECT_TRUE(twcc.need_feedback());
+
+        char buf[kMaxUDPDataSize];
+        SrsBuffer b(buf, sizeof(buf));
+        HELPER_ASSERT_SUCCESS(twcc.encode(&b));
+        EXPECT_FALSE(twcc.need_feedback());
+        EXPECT_EQ(100, twcc.get_base_sn());
+
+        SrsBuffer r(buf, b.pos());
+        r.skip(4);
+        EXPECT_EQ(0x01, r.read_4bytes());
+        EXPECT_EQ(0x02, r.read_4bytes());
+        EXPECT_EQ(100, r.read_2bytes());
+        EXPECT_EQ(11, r.read_2bytes());
+        EXPECT_EQ(0, b.pos() % 4);
+
+        // The feedback is done, so it's ok to receive the same sn in new window.
+        HELPER_EXPECT_SUCCESS(twcc.recv_packet(108, 0));
+    }
+
+    // The packet before base should be feedback, and the sequence might wrap around.
+    if (true) {
+        SrsRtcpTWCC twcc;
+        HELPER_ASSERT_SUCCESS(twcc.recv_packet(65535, 1 * SRS_UTIME_SECONDS));
+        HELPER_ASSERT_SUCCESS(twcc.recv_packet(2, 1 * SRS_UTIME_SECONDS));
+        HELPER_ASSERT_SUCCESS(twcc.recv_packet(65534, 1 * SRS_UTIME_SECONDS));
+
+        char buf[kMaxUDPDataSize];
+        SrsBuffer b(buf, sizeof(buf));
+        HELPER_ASSERT_SUCCESS(twcc.encode(&b));
+        EXPECT_FALSE(twcc.need_feedback());
+
+        SrsBuffer r(buf, b.pos());
+        r.skip(12);
+        EXPECT_EQ(65534, (uint16_t)r.read_2bytes());
+        EXPECT_EQ(5, r.read_2bytes());
+    }
+
+    // The oldest packets are dropped when window overflows.
+    if (true) {
+        SrsRtcpTWCC twcc;
+        HELPER_ASSERT_SUCCESS(twcc.recv_packet(0, 1 * SRS_UTIME_SECONDS));
+        HELPER_ASSERT_SUCCESS(twcc.recv_packet(1, 1 * SRS_UTIME_SECONDS));
+        HELPER_ASSERT_SUCCESS(twcc.recv_packet(kTwccRecvWindow, 1 * SRS_UTIME_SECONDS));
+        HELPER_EXPECT_FAILED(twcc.recv_packet(0, 1 * SRS_UTIME_SECONDS));
+
+        char buf[kMaxUDPDataSize];
+        SrsBuffer b(buf, sizeof(buf));
+        HELPER_ASSERT_SUCCESS(twcc.encode(&b));
+        EXPECT_EQ(1, twcc.get_base_sn());
+        EXPECT_FALSE(twcc.need_feedback());
+    }
+
+    // Feedback in multiple packets, when there are too many packets.
+    if (true) {
+        SrsRtcpTWCC twcc;
+        for (int i = 0; i < 3000; i++) {
+            HELPER_ASSERT_SUCCESS(twcc.recv_packet(i, 1 * SRS_UTIME_SECONDS + i * 100));
+        }
+
+        int nn_packets = 0, nn_feedbacks = 0;
+        while (twcc.need_feedback() && nn_feedbacks < 100) {
+            char buf[kMaxUDPDataSize];
+            SrsBuffer b(buf, sizeof(buf));
+            HELPER_ASSERT_SUCCESS(twcc.encode(&b));
+            EXPECT_EQ(nn_packets, twcc.get_base_sn());
+
+            SrsBuffer r(buf, b.pos());
+            r.skip(14);
+            nn_packets += r.read_2bytes();
+            nn_feedbacks++;
+        }
+        EXPECT_EQ(3000, nn_packets);
+        EXPECT_GT(nn_feedbacks, 1);
+    }
+}
+
+VOID TEST(KernelRTCTest, BenchmarkTwcc)
+{
+    srs_error_t err;
+
+    // Simulate 10k pps for 10s, with a feedback every 100ms, and a lost packet every 100.
+    SrsRtcpTWCC twcc;
+    const int nn_packets = 100000;
+    int nn_feedbacks = 0;
+
+    srs_utime_t starttime = srs_update_system_time();
+    for (int i = 0; i < nn_packets; i++) {
+        if (i % 100 != 99) {
+            HELPER_ASSERT_SUCCESS(twcc.recv_packet((uint16_t)i, 1 * SRS_UTIME_SECONDS + i * 100));
+        }
+
+        if (i % 1000 == 999) {
+            while (twcc.need_feedback()) {
+                char buf[kMaxUDPDataSize];
+                SrsBuffer b(buf, sizeof(buf));
+                HELPER_ASSERT_SUCCESS(twcc.encode(&b));
+                nn_feedbacks++;
+            }
+        }
+    }
+    srs_utime_t cost = srs_max(1, srs_update_system_time() - starttime);
+
+    EXPECT_GE(nn_feedbacks, 100);
+    printf("TWCC: %d packets, %d feedbacks, cost %dms, %.2fus per packet\n",
+        nn_packets, nn_feedbacks, srsu2msi(cost), (double)cost / nn_packets);
+}
+
+VOID TEST(KernelRTCTest, TwccFeedbackAndRembParse)
+{
+    srs_error_t err;
+
+    // Parse the feedback encoded by receiver, with lost packet and large delta.
+    if (true) {
+        SrsRtcpTWCC twcc(0x01);
+        twcc.set_media_ssrc(0x02);
+        for (uint16_t sn = 100; sn <= 110; sn++) {
+            if (sn == 105) continue;
+            HELPER_ASSERT_SUCCESS(twcc.recv_packet(sn, 1000 * SRS_UTIME_MILLISECONDS + sn * SRS_UTIME_MILLISECONDS));
+        }
+        HELPER_ASSERT_SUCCESS(twcc.recv_packet(111, 1300 * SRS_UTIME_MILLISECONDS));
+
+        char buf[kMaxUDPDataSize];
+        SrsBuffer b(buf, sizeof(buf));
+        HELPER_ASSERT_SUCCESS(twcc.encode(&b));
+
+        vector<SrsTwccPacketStatus> status;
+        HELPER_ASSERT_SUCCESS(srs_rtcp_parse_twcc(buf, b.pos(), status));
+        ASSERT_EQ(12, (int)status.size());
+
+        for (int i = 0; i < (int)status.size(); i++) {
+            EXPECT_EQ(100 + i, status[i].sn);
+            EXPECT_EQ(100 + i != 105, status[i].received);
+        }
+        EXPECT_EQ(1 * SRS_UTIME_MILLISECONDS, status[1].arrival - status[0].arrival);
+        EXPECT_EQ(2 * SRS_UTIME_MILLISECONDS, status[6].arrival - status[4].arrival);
+        EXPECT_EQ(190 * SRS_UTIME_MILLISECONDS, status[11].arrival - status[10].arrival);
+
+        // Never parse the truncated packet.
+        status.clear();
+        HELPER_EXPECT_FAILED(srs_rtcp_parse_twcc(buf, b.pos() - 4, status));
+        HELPER_EXPECT_FAILED(srs_rtcp_parse_twcc(buf, 8, status));
+    }
+
+    // Parse the REMB of 1Mbps, which is 250000 * 2^2.
+    if (true) {
+        uint8_t remb[] = {
+            0x8f, 0xce, 0x00, 0x05, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+            'R', 'E', 'M', 'B', 0x01, 0x0b, 0xd0, 0x90, 0x00, 0x00, 0x00, 0x02
+        };
+
+        uint64_t bitrate = 0;
+        HELPER_ASSERT_SUCCESS(srs_rtcp_parse_remb((char*)remb, sizeof(remb), bitrate));
+        EXPECT_EQ(1000000, (int)bitrate);
+
+        remb[12] = 'X';
+        HELPER_EXPECT_FAILED(srs_rtcp_parse_remb((char*)remb, sizeof(remb), bitrate));
+        HELPER_EXPECT_FAILED(srs_rtcp_parse_remb((char*)remb, 16, bitrate));
+    }
+}
+
+class MockRtcPacerHandler : public ISrsRtcPacerHandler
+{
+public:
+    int nn_packets;
+    int nn_bytes;
+public:
+    MockRtcPacerHandler() {
+        nn_packets = nn_bytes = 0;
+    }
+    virtual ~MockRtcPacerHandler() {
+    }
+public:
+    virtual srs_error_t on_pacer_send(char* data, int size, int twcc_sn) {
+        nn_packets++;
+        nn_bytes += size;
+        return srs_success;
+    }
+};
+
+VOID TEST(AppRTCTest, RtcPacer)
+{
+    srs_error_t err;
+
+    MockRtcPacerHandler h;
+    SrsRtcPacer pacer(&h);
+    pacer.initialize(200 * SRS_UTIME_MILLISECONDS);
+    pacer.set_rate(800 * 1000);
+
+    // The budget is 40ms of rate, that is 4000 bytes, so the burst is limited.
+    char buf[1000];
+    srs_utime_t now = 1 * SRS_UTIME_SECONDS;
+    for (int i = 0; i < 10; i++) {
+        HELPER_ASSERT_SUCCESS(pacer.send(buf, sizeof(buf), i, now));
+    }
+    EXPECT_EQ(4, h.nn_packets);
+    EXPECT_EQ(6, pacer.size());
+
+    // Refill 2000 bytes in 20ms.
+    HELPER_ASSERT_SUCCESS(pacer.flush(now + 20 * SRS_UTIME_MILLISECONDS));
+    EXPECT_EQ(6, h.nn_packets);
+    EXPECT_EQ(4, pacer.size());
+
+    // The new packet should be queued, never reorder.
+    HELPER_ASSERT_SUCCESS(pacer.send(buf, sizeof(buf), 10, now + 20 * SRS_UTIME_MILLISECONDS));
+    EXPECT_EQ(6, h.nn_packets);
+    EXPECT_EQ(5, pacer.size());
+
+    // All packets are sent when queued longer than max delay, even no budget.
+    pacer.set_rate(8 * 1000);
+    HELPER_ASSERT_SUCCESS(pacer.flush(now + 220 * SRS_UTIME_MILLISECONDS));
+    EXPECT_EQ(11, h.nn_packets);
+    EXPECT_EQ(0, pacer.size());
+    EXPECT_GT(pacer.delay(), 0);
+}
+
+VOID TEST(AppRTCTest, RtcBandwidthEstimator)
+{
+    srs_error_t err;
+
+    // Send 100 packets in 100ms, and feedback by receiver with the arrival time.
+    #define MOCK_BWE_FEEDBACK(bwe, start, lost, jitter) \
+        if (true) { \
+            SrsRtcpTWCC twcc; \
+            for (int i = 0; i < 100; i++) { \
+                uint16_t sn = bwe.generate_sn(); \
+                srs_utime_t sent = start + i * SRS_UTIME_MILLISECONDS; \
+                bwe.on_packet_sent(sn, 1000, sent); \
+                if (i % 10 >= lost) HELPER_ASSERT_SUCCESS(twcc.recv_packet(sn, sent + 50 * SRS_UTIME_MILLISECONDS + i * jitter)); \
+            } \
+            char buf[kMaxUDPDataSize]; \
+            SrsBuffer b(buf, sizeof(buf)); \
+            HELPER_ASSERT_SUCCESS(twcc.encode(&b)); \
+            HELPER_ASSERT_SUCCESS(bwe.on_twcc(buf, b.pos(), start + 200 * SRS_UTIME_MILLISECONDS)); \
+        }
+
+    // Increase if no loss and queuing.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+        int64_t start = bwe.estimate();
+        MOCK_BWE_FEEDBACK(bwe, 1 * SRS_UTIME_SECONDS, 0, 0);
+        MOCK_BWE_FEEDBACK(bwe, 2 * SRS_UTIME_SECONDS, 0, 0);
+        EXPECT_GT(bwe.estimate(), start);
+        EXPECT_EQ(0, bwe.loss());
+        EXPECT_LT(bwe.queuing_delay(), 1 * SRS_UTIME_MILLISECONDS);
+    }
+
+    // Decrease if lost 20% packets.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+        int64_t start = bwe.estimate();
+        MOCK_BWE_FEEDBACK(bwe, 1 * SRS_UTIME_SECONDS, 2, 0);
+        EXPECT_LT(bwe.estimate(), start);
+        // The first two lost packets are unknown by receiver, so lost 18 of 98 packets.
+        EXPECT_NEAR(18.0 / 98, bwe.loss(), 0.001);
+    }
+
+    // Decrease if the queuing delay increases, by 1ms for each packet.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+        int64_t start = bwe.estimate();
+        MOCK_BWE_FEEDBACK(bwe, 1 * SRS_UTIME_SECONDS, 0, SRS_UTIME_MILLISECONDS);
+        EXPECT_LT(bwe.estimate(), start);
+        EXPECT_GT(bwe.queuing_delay(), 30 * SRS_UTIME_MILLISECONDS);
+    }
+
+    // Use REMB if no TWCC, or as the limit of TWCC.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+        bwe.on_remb(500 * 1000);
+        EXPECT_EQ(500 * 1000, bwe.estimate());
+        bwe.on_remb(800 * 1000);
+        EXPECT_EQ(800 * 1000, bwe.estimate());
+
+        MOCK_BWE_FEEDBACK(bwe, 1 * SRS_UTIME_SECONDS, 0, 0);
+        EXPECT_EQ(800 * 1000, bwe.estimate());
+    }
+
+    // Ignore the feedback of packets not sent.
+    if (true) {
+        SrsRtcBandwidthEstimator bwe;
+        int64_t start = bwe.estimate();
+
+        SrsRtcpTWCC twcc;
+        HELPER_ASSERT_SUCCESS(twcc.recv_packet(1000, 1 * SRS_UTIME_SECONDS));
+        char buf[kMaxUDPDataSize];
+        SrsBuffer b(buf, sizeof(buf));
+        HELPER_ASSERT_SUCCESS(twcc.encode(&b));
+        HELPER_ASSERT_SUCCESS(bwe.on_twcc(buf, b.pos(), 1 * SRS_UTIME_SECONDS));
+        EXPECT_EQ(start, bwe.estimate());
+    }
+}
+
+VOID TEST(KernelRTCTest, SimulcastSdpAndRid)
+{
+    srs_error_t err;
+
+    // Parse the RID and simulcast of publisher offer.
+    if (true) {
+        SrsMediaDesc desc("video");
+        HELPER_ASSERT_SUCCESS(desc.parse_line("a=rid:h send"));
+        HELPER_ASSERT_SUCCESS(desc.parse_line("a=rid:l send pt=96;max-width=640"));
+        HELPER_ASSERT_SUCCESS(desc.parse_line("a=simulcast:send h;~l"));
+        ASSERT_EQ(2, (int)desc.rids_.size());
+        EXPECT_STREQ("h", desc.rids_[0].c_str());
+        EXPECT_STREQ("l", desc.rids_[1].c_str());
+        EXPECT_STREQ("send", desc.rid_direction_.c_str());
+        EXPECT_TRUE(desc.simulcast_);
+
+        HELPER_EXPECT_FAILED(desc.parse_line("a=rid:m sendrecv"));
+    }
+
+    // Parse the simulcast without RID, use the first alternative.
+    if (true) {
+        SrsMediaDesc desc("video");
+        HELPER_ASSERT_SUCCESS(desc.parse_line("a=simulcast:send f,x;h"));
+        ASSERT_EQ(2, (int)desc.rids_.size());
+        EXPECT_STREQ("f", desc.rids_[0].c_str());
+        EXPECT_STREQ("h", desc.rids_[1].c_str());
+    }
+
+    // Encode the RID and simulcast of answer.
+    if (true) {
+        SrsMediaDesc desc("video");
+        desc.rids_.push_back("h"); desc.rids_.push_back("l");
+        desc.rid_direction_ = "recv"; desc.simulcast_ = true;
+
+        std::ostringstream os;
+        HELPER_ASSERT_SUCCESS(desc.encode(os));
+        EXPECT_TRUE(os.str().find("a=rid:h recv\r\na=rid:l recv\r\na=simulcast:recv h;l\r\n") != string::npos);
+    }
+
+    // Parse the RID from RTP extension.
+    if (true) {
+        uint8_t data[] = {
+            0x90, 0x60, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02,
+            0xbe, 0xde, 0x00, 0x02,
+            0x21, 0x00, 0x05, // id=2, len=2
+            0x41, 'h', 'i', // id=4, len=2, RID=hi
+            0x00, 0x00 // Padding
+        };
+
+        string rid;
+        HELPER_ASSERT_SUCCESS(srs_rtp_fast_parse_rid((char*)data, sizeof(data), 4, rid));
+        EXPECT_STREQ("hi", rid.c_str());
+
+        rid = "";
+        HELPER_ASSERT_SUCCESS(srs_rtp_fast_parse_rid((char*)data, sizeof(data), 3, rid));
+        EXPECT_TRUE(rid.empty());
+
+        // Invalid for the extension length exceed the packet.
+        HELPER_EXPECT_FAILED(srs_rtp_fast_parse_rid((char*)data, sizeof(data) - 4, 4, rid));
+    }
+}
+
+VOID TEST(KernelRTCTest, JitterRebase)
+{
+    // Continue from the last value, when source switched.
+    if (true) {
+        SrsRtcSeqJitter jitter(100);
+        EXPECT_EQ((uint16_t)100, jitter.correct(0));
+        EXPECT_EQ((uint16_t)101, jitter.correct(1));
+
+        jitter.rebase(1);
+        EXPECT_EQ((uint16_t)102, jitter.correct(50000));
+        EXPECT_EQ((uint16_t)103, jitter.correct(50001));
+        EXPECT_EQ((uint16_t)101, jitter.correct(49999));
+    }
+
+    if (true) {
+        SrsRtcTsJitter jitter(1000);
+        EXPECT_EQ((uint32_t)1000, jitter.correct(0));
+        EXPECT_EQ((uint32_t)4000, jitter.correct(3000));
+
+        jitter.rebase(3000);
+        EXPECT_EQ((uint32_t)7000, jitter.correct(123456789));
+        EXPECT_EQ((uint32_t)10000, jitter.correct(123459789));
+    }
+
+    // Rebase before init is ignored.
+    if (true) {
+        SrsRtcSeqJitter jitter(100);
+        jitter.rebase(10);
+        EXPECT_EQ((uint16_t)100, jitter.correct(0));
+        EXPECT_EQ((uint16_t)101, jitter.correct(1));
+    }
+}
+
+VOID TEST(AppRTCTest, SimulcastLayerSelector)
+{
+    // Select layer by bandwidth.
+    if (true) {
+        vector<SrsRtcSimulcastLayer> layers;
+        EXPECT_EQ((uint32_t)0, SrsRtcLayerSelector::select(layers, 0));
+
+        layers.push_back(SrsRtcSimulcastLayer("h", 300)); layers.back().kbps_ = 2500;
+        layers.push_back(SrsRtcSimulcastLayer("l", 100)); layers.back().kbps_ = 150;
+        layers.push_back(SrsRtcSimulcastLayer("m", 200)); layers.back().kbps_ = 600;
+        layers.push_back(SrsRtcSimulcastLayer("x", 0)); layers.back().kbps_ = 9000;
+
+        // Highest if no bandwidth estimation.
+        EXPECT_EQ((uint32_t)300, SrsRtcLayerSelector::select(layers, 0));
+        EXPECT_EQ((uint32_t)300, SrsRtcLayerSelector::select(layers, 3000 * 1000));
+        EXPECT_EQ((uint32_t)200, SrsRtcLayerSelector::select(layers, 2000 * 1000));
+        EXPECT_EQ((uint32_t)200, SrsRtcLayerSelector::select(layers, 600 * 1000));
+        EXPECT_EQ((uint32_t)100, SrsRtcLayerSelector::select(layers, 500 * 1000));
+        // Lowest if none fits.
+        EXPECT_EQ((uint32_t)100, SrsRtcLayerSelector::select(layers, 100 * 1000));
+    }
+
+    // Switch layer at keyframe.
+    if (true) {
+        SrsRtcLayerSelector selector;
+        bool switched = false;
+
+        SrsRtpPacket low, high, high_key;
+        low.header.set_ssrc(100); low.frame_type = SrsFrameTypeVideo; low.nalu_type = SrsAvcNaluTypeIDR;
+        high.header.set_ssrc(300); high.frame_type = SrsFrameTypeVideo; high.nalu_type = SrsAvcNaluTypeNonIDR;
+        high_key.header.set_ssrc(300); high_key.frame_type = SrsFrameTypeVideo; high_key.nalu_type = SrsAvcNaluTypeIDR;
+
+        // Drop all before the first keyframe of target.
+        selector.set_target(100);
+        EXPECT_TRUE(selector.switching());
+        EXPECT_FALSE(selector.accept(&high, switched));
+        EXPECT_TRUE(selector.accept(&low, switched));
+        EXPECT_TRUE(switched);
+        EXPECT_EQ((uint32_t)100, selector.current());
+        EXPECT_FALSE(selector.switching());
+
+        // Keep the current layer, until the keyframe of target.
+        selector.set_target(300);
+        EXPECT_TRUE(selector.switching());
+        EXPECT_FALSE(selector.accept(&high, switched));
+        EXPECT_FALSE(switched);
+        EXPECT_TRUE(selector.accept(&low, switched));
+        EXPECT_FALSE(switched);
+
+        EXPECT_TRUE(selector.accept(&high_key, switched));
+        EXPECT_TRUE(switched);
+        EXPECT_EQ((uint32_t)300, selector.current());
+        EXPECT_FALSE(selector.accept(&low, switched));
+        EXPECT_TRUE(selector.accept(&high, switched));
+        EXPECT_FALSE(switched);
+    }
+}
+
+VOID TEST(KernelRTCTest, NACKTracker)
+{
+    srs_error_t err;
+
+    // Build compressed NACK in seq order.
+    if (true) {
+        SrsRtpRingBuffer rtp(1000);
+        SrsRtpNackForReceiver nack(&rtp, 1000);
+        nack.opts_.first_nack_interval = 0;
+
+        nack.insert(120, 121);
+        nack.insert(100, 104);
+        nack.insert(116, 118);
+        EXPECT_EQ(7, (int)nack.size());
+        EXPECT_TRUE(nack.find(101) != NULL);
+        EXPECT_TRUE(nack.find(104) == NULL);
+        EXPECT_TRUE(nack.find(101 + SRS_RTC_NACK_WINDOW) == NULL);
+
+        nack.remove(102);
+        nack.remove(102);
+        EXPECT_EQ(6, (int)nack.size());
+
+        SrsRtcpNack rtcp;
+        uint32_t timeout_nacks = 0;
+        nack.get_nack_seqs(rtcp, timeout_nacks);
+        EXPECT_EQ(0, (int)timeout_nacks);
+
+        // The 100 with 101,103,116 and 117, then the 120.
+        ASSERT_EQ(2, (int)rtcp.chunks_.size());
+        EXPECT_EQ(100, rtcp.chunks_[0].pid);
+        EXPECT_EQ(0x1 | 0x4 | 0x8000, rtcp.chunks_[0].blp);
+        EXPECT_EQ(117, rtcp.chunks_[1].pid);
+        EXPECT_EQ(0x4, rtcp.chunks_[1].blp);
+
+        uint16_t expect[] = {100, 101, 103, 116, 117, 120};
+        vector<uint16_t> sns = rtcp.get_lost_sns();
+        ASSERT_EQ(6, (int)sns.size());
+        for (int i = 0; i < 6; i++) {
+            EXPECT_EQ(expect[i], sns[i]);
+        }
+
+        // Decode the encoded compressed NACK.
+        char buf[kRtcpPacketSize];
+        SrsBuffer b(buf, sizeof(buf));
+        HELPER_ASSERT_SUCCESS(rtcp.encode(&b));
+
+        SrsBuffer b2(buf, b.pos());
+        SrsRtcpNack rtcp2;
+        HELPER_ASSERT_SUCCESS(rtcp2.decode(&b2));
+        EXPECT_EQ(6, (int)rtcp2.get_lost_sns().size());
+    }
+
+    // Lost packets around the flip back of seq.
+    if (true) {
+        SrsRtpRingBuffer rtp(1000);
+        SrsRtpNackForReceiver nack(&rtp, 1000);
+        nack.opts_.first_nack_interval = 0;
+
+        nack.insert(65534, 2);
+        EXPECT_EQ(4, (int)nack.size());
+
+        SrsRtcpNack rtcp;
+        uint32_t timeout_nacks = 0;
+        nack.get_nack_seqs(rtcp, timeout_nacks);
+        ASSERT_EQ(1, (int)rtcp.chunks_.size());
+        EXPECT_EQ(65534, rtcp.chunks_[0].pid);
+        EXPECT_EQ(0x7, rtcp.chunks_[0].blp);
+    }
+
+    // Timeout by request count, and drop when out of window.
+    if (true) {
+        SrsRtpRingBuffer rtp(1000);
+        SrsRtpNackForReceiver nack(&rtp, 1000);
+        nack.opts_.first_nack_interval = 0;
+        nack.opts_.nack_check_interval = 0;
+        nack.opts_.max_count = 0;
+
+        nack.insert(10, 12);
+        uint32_t timeout_nacks = 0;
+        if (true) {
+            SrsRtcpNack rtcp;
+            nack.get_nack_seqs(rtcp, timeout_nacks);
+            EXPECT_EQ(2, (int)rtcp.get_lost_sns().size());
+            EXPECT_EQ(0, (int)timeout_nacks);
+        }
+        if (true) {
+            nack.opts_.min_nack_interval = 0;
+            SrsRtcpNack rtcp;
+            nack.get_nack_seqs(rtcp, timeout_nacks);
+            EXPECT_TRUE(rtcp.empty());
+            EXPECT_EQ(2, (int)timeout_nacks);
+            EXPECT_EQ(0, (int)nack.size());
+        }
+
+        nack.insert(10, 12);
+        nack.insert(10 + SRS_RTC_NACK_WINDOW, 11 + SRS_RTC_NACK_WINDOW);
+        EXPECT_EQ(2, (int)nack.size());
+        EXPECT_TRUE(nack.find(10) == NULL);
+        EXPECT_TRUE(nack.find(11) != NULL);
+        EXPECT_TRUE(nack.find(10 + SRS_RTC_NACK_WINDOW) != NULL);
+    }
+
+    // Clear when exceed the queue size.
+    if (true) {
+        SrsRtpRingBuffer rtp(1000);
+        SrsRtpNackForReceiver nack(&rtp, 10);
+        nack.insert(0, 9);
+        nack.check_queue_size();
+        EXPECT_EQ(9, (int)nack.size());
+
+        nack.insert(9, 10);
+        nack.check_queue_size();
+        EXPECT_EQ(0, (int)nack.size());
+        EXPECT_TRUE(nack.find(1) == NULL);
+    }
+}
+
+// The NACK list by std::map, which is the previous implementation, for benchmark.
+class MockNackMapReceiver
+{
+public:
+    std::map<uint16_t, SrsRtpNackInfo, SrsSeqCompareLess> queue_;
+public:
+    void insert(uint16_t first, uint16_t last) {
+        for (uint16_t s = first; s != last; ++s) {
+            queue_[s] = SrsRtpNackInfo();
+        }
+    }
+    void remove(uint16_t seq) {
+        queue_.erase(seq);
+    }
+    void get_nack_seqs(SrsRtcpNack& seqs) {
+        std::map<uint16_t, SrsRtpNackInfo>::iterator iter = queue_.begin();
+        while (iter != queue_.end()) {
+            if (iter->second.req_nack_count_ > 15) {
+                queue_.erase(iter++);
+                continue;
+            }
+            ++iter->second.req_nack_count_;
+            seqs.add_lost_sn(iter->first);
+            ++iter;
+        }
+    }
+};
+
+VOID TEST(KernelRTCTest, BenchmarkNACKTracker)
+{
+    srs_error_t err;
+
+    // Simulate 1000pps with 10% loss for 100s, recovered after 30 packets, check NACK every 20 packets.
+    const int nn_packets = 100000;
+    int nn_map = 0, nn_tracker = 0;
+
+    srs_utime_t map_cost = 0;
+    if (true) {
+        MockNackMapReceiver nack;
+        srs_utime_t starttime = srs_update_system_time();
+        for (int i = 0; i < nn_packets; i++) {
+            if (i % 10 == 3) nack.insert(i, i + 1);
+            if (i > 30 && (i - 30) % 10 == 3) nack.remove(i - 30);
+            if (i % 20 == 19) {
+                SrsRtcpNack rtcp;
+                nack.get_nack_seqs(rtcp);
+                nn_map += rtcp.get_lost_sns().size();
+
+                char buf[kRtcpPacketSize];
+                SrsBuffer b(buf, sizeof(buf));
+                HELPER_EXPECT_SUCCESS(rtcp.encode(&b));
+            }
+        }
+        map_cost = srs_max(1, srs_update_system_time() - starttime);
+    }
+
+    srs_utime_t tracker_cost = 0;
+    if (true) {
+        SrsRtpRingBuffer rtp(1000);
+        SrsRtpNackForReceiver nack(&rtp, 1000);
+        nack.opts_.first_nack_interval = 0;
+        nack.opts_.nack_check_interval = 0;
+        nack.opts_.min_nack_interval = 0;
+        nack.opts_.nack_interval = 0;
+        nack.opts_.max_alive_time = 3600 * SRS_UTIME_SECONDS;
+
+        srs_utime_t starttime = srs_update_system_time();
+        for (int i = 0; i < nn_packets; i++) {
+            if (i % 10 == 3) nack.insert(i, i + 1);
+            if (i > 30 && (i - 30) % 10 == 3) nack.remove(i - 30);
+            if (i % 20 == 19) {
+                SrsRtcpNack rtcp;
+                uint32_t timeout_nacks = 0;
+                nack.get_nack_seqs(rtcp, timeout_nacks);
+                nn_tracker += rtcp.get_lost_sns().size();
+
+                char buf[kRtcpPacketSize];
+                SrsBuffer b(buf, sizeof(buf));
+                HELPER_EXPECT_SUCCESS(rtcp.encode(&b));
+            }
+        }
+        tracker_cost = srs_max(1, srs_update_system_time() - starttime);
+    }
+
+    EXPECT_EQ(nn_map, nn_tracker);
+    printf("NACK: %d packets, %d nacks, map cost %dms, tracker cost %dms\n",
+        nn_packets, nn_tracker, srsu2msi(map_cost), srsu2msi(tracker_cost));
+}
+
+SrsRtpPacket* mock_frame_packet(uint16_t seq, uint32_t ts, bool marker, bool keyframe)
+{
+    SrsRtpPacket* pkt = new SrsRtpPacket();
+    pkt->header.set_sequence(seq);
+    pkt->header.set_timestamp(ts);
+    pkt->header.set_marker(marker);
+    pkt->frame_type = SrsFrameTypeVideo;
+    pkt->nalu_type = keyframe ? SrsAvcNaluTypeIDR : SrsAvcNaluTypeNonIDR;
+    return pkt;
+}
+
+void free_frame_packets(std::vector<SrsRtpPacket*>& frame)
+{
+    for (int i = 0; i < (int)frame.size(); i++) {
+        srs_freep(frame[i]);
+    }
+    frame.clear();
+}
+
+VOID TEST(KernelRTCTest, FrameBufferAssemble)
+{
+    // Drop the frames before keyframe, then pop the frames in order.
+    if (true) {
+        SrsRtpFrameBuffer buffer(512, SRS_RTC_FRAME_MAX_DELAY, 90000);
+        std::vector<SrsRtpPacket*> frame;
+
+        buffer.insert(mock_frame_packet(8, 0, true, false));
+        EXPECT_FALSE(buffer.pop(frame));
+        EXPECT_TRUE(buffer.waiting_keyframe());
+
+        buffer.insert(mock_frame_packet(10, 3000, false, true));
+        EXPECT_FALSE(buffer.waiting_keyframe());
+        EXPECT_FALSE(buffer.pop(frame));
+        buffer.insert(mock_frame_packet(11, 3000, true, true));
+        EXPECT_TRUE(buffer.pop(frame));
+        ASSERT_EQ(2, (int)frame.size());
+        EXPECT_EQ(10, frame[0]->header.get_sequence());
+        EXPECT_EQ(11, frame[1]->header.get_sequence());
+        free_frame_packets(frame);
+        EXPECT_EQ(1, (int)buffer.nn_dropped());
+
+        // The packets out of order, wait for the lost packet.
+        buffer.insert(mock_frame_packet(12, 6000, false, false));
+        buffer.insert(mock_frame_packet(14, 6000, true, false));
+        EXPECT_FALSE(buffer.pop(frame));
+        buffer.insert(mock_frame_packet(13, 6000, false, false));
+        EXPECT_TRUE(buffer.pop(frame));
+        EXPECT_EQ(3, (int)frame.size());
+        free_frame_packets(frame);
+        EXPECT_FALSE(buffer.pop(frame));
+
+        // The frame without marker, ends by the next frame.
+        buffer.insert(mock_frame_packet(15, 9000, false, false));
+        EXPECT_FALSE(buffer.pop(frame));
+        buffer.insert(mock_frame_packet(16, 12000, false, false));
+        EXPECT_TRUE(buffer.pop(frame));
+        ASSERT_EQ(1, (int)frame.size());
+        EXPECT_EQ(15, frame[0]->header.get_sequence());
+        free_frame_packets(frame);
+
+        // The retransmitted packet of popped frame is dropped.
+        buffer.insert(mock_frame_packet(13, 6000, false, false));
+        EXPECT_FALSE(buffer.pop(frame));
+        EXPECT_EQ(2, (int)buffer.nn_dropped());
+    }
+
+    // The first packet of keyframe arrives later, for example, the SPS/PPS.
+    if (true) {
+        SrsRtpFrameBuffer buffer(512, SRS_RTC_FRAME_MAX_DELAY, 90000);
+        std::vector<SrsRtpPacket*> frame;
+
+        buffer.insert(mock_frame_packet(21, 3000, false, true));
+        buffer.insert(mock_frame_packet(22, 3000, true, true));
+        buffer.insert(mock_frame_packet(20, 3000, false, false));
+        EXPECT_TRUE(buffer.pop(frame));
+        ASSERT_EQ(3, (int)frame.size());
+        EXPECT_EQ(20, frame[0]->header.get_sequence());
+        free_frame_packets(frame);
+    }
+
+    // The seq wraps around.
+    if (true) {
+        SrsRtpFrameBuffer buffer(512, SRS_RTC_FRAME_MAX_DELAY, 90000);
+        std::vector<SrsRtpPacket*> frame;
+
+        buffer.insert(mock_frame_packet(65535, 3000, false, true));
+        buffer.insert(mock_frame_packet(1, 3000, true, true));
+        buffer.insert(mock_frame_packet(0, 3000, false, true));
+        EXPECT_TRUE(buffer.pop(frame));
+        ASSERT_EQ(3, (int)frame.size());
+        EXPECT_EQ(65535, frame[0]->header.get_sequence());
+        EXPECT_EQ(1, frame[2]->header.get_sequence());
+        free_frame_packets(frame);
+    }
+}
+
+VOID TEST(KernelRTCTest, FrameBufferLoss)
+{
+    // The lost packet is not recovered, only drop the tail of GOP to next keyframe.
+    if (true) {
+        SrsRtpFrameBuffer buffer(512, 100 * SRS_UTIME_MILLISECONDS, 90000);
+        std::vector<SrsRtpPacket*> frame;
+
+        buffer.insert(mock_frame_packet(0, 0, true, true));
+        EXPECT_TRUE(buffer.pop(frame));
+        free_frame_packets(frame);
+
+        // The seq=1 of ts=3000 is lost.
+        buffer.insert(mock_frame_packet(2, 3000, true, false));
+        buffer.insert(mock_frame_packet(3, 6000, true, false));
+        buffer.insert(mock_frame_packet(4, 9000, true, true));
+        EXPECT_FALSE(buffer.pop(frame));
+
+        // Not timeout, wait for the lost packet.
+        buffer.insert(mock_frame_packet(5, 9000, true, false));
+        EXPECT_FALSE(buffer.pop(frame));
+
+        // Timeout for 100ms, which is 9000 in 90kHz, drop seq 2 and 3 of the GOP tail.
+        buffer.insert(mock_frame_packet(6, 12000, true, false));
+        EXPECT_TRUE(buffer.pop(frame));
+        ASSERT_EQ(1, (int)frame.size());
+        EXPECT_EQ(4, frame[0]->header.get_sequence());
+        free_frame_packets(frame);
+        EXPECT_EQ(2, (int)buffer.nn_dropped());
+
+        EXPECT_TRUE(buffer.pop(frame));
+        EXPECT_EQ(5, frame[0]->header.get_sequence());
+        free_frame_packets(frame);
+        EXPECT_TRUE(buffer.pop(frame));
+        EXPECT_EQ(6, frame[0]->header.get_sequence());
+        free_frame_packets(frame);
+        EXPECT_FALSE(buffer.pop(frame));
+    }
+
+    // The lost packet is not recovered and no keyframe, wait for a new keyframe.
+    if (true) {
+        SrsRtpFrameBuffer buffer(512, 100 * SRS_UTIME_MILLISECONDS, 90000);
+        std::vector<SrsRtpPacket*> frame;
+
+        buffer.insert(mock_frame_packet(0, 0, false, true));
+        buffer.insert(mock_frame_packet(2, 3000, true, false));
+        buffer.insert(mock_frame_packet(3, 20000, true, false));
+        EXPECT_FALSE(buffer.pop(frame));
+        EXPECT_TRUE(buffer.waiting_keyframe());
+        EXPECT_EQ(3, (int)buffer.nn_dropped());
+
+        // The late packet of the dropped keyframe is ignored.
+        buffer.insert(mock_frame_packet(1, 0, true, true));
+        EXPECT_FALSE(buffer.pop(frame));
+        EXPECT_TRUE(buffer.waiting_keyframe());
+
+        buffer.insert(mock_frame_packet(4, 23000, true, true));
+        EXPECT_TRUE(buffer.pop(frame));
+        EXPECT_EQ(4, frame[0]->header.get_sequence());
+        free_frame_packets(frame);
+    }
+
+    // The buffer is overflow, drop to the keyframe.
+    if (true) {
+        SrsRtpFrameBuffer buffer(16, 100 * SRS_UTIME_MILLISECONDS, 90000);
+        std::vector<SrsRtpPacket*> frame;
+
+        buffer.insert(mock_frame_packet(0, 0, true, true));
+        EXPECT_TRUE(buffer.pop(frame));
+        free_frame_packets(frame);
+
+        // The seq=1 is lost, then a large keyframe which overflows the buffer.
+        for (int i = 2; i < 6; i++) {
+            buffer.insert(mock_frame_packet(i, 3000, i == 5, false));
+        }
+        for (int i = 6; i < 22; i++) {
+            buffer.insert(mock_frame_packet(i, 6000, i == 21, true));
+        }
+        EXPECT_TRUE(buffer.pop(frame));
+        ASSERT_EQ(16, (int)frame.size());
+        EXPECT_EQ(6, frame[0]->header.get_sequence());
+        EXPECT_EQ(21, frame[15]->header.get_sequence());
+        free_frame_packets(frame);
+        EXPECT_EQ(4, (int)buffer.nn_dropped());
+    }
+}
+
+class MockRtcFrameBridge : public ISrsRtcSourceBridge
+{
+public:
+    bool active_;
+    std::vector<uint16_t> keys_;
+    int nn_frames_;
+public:
+    MockRtcFrameBridge() {
+        active_ = true;
+        nn_frames_ = 0;
+    }
+    virtual ~MockRtcFrameBridge() {
+    }
+public:
+    virtual srs_error_t on_publish() {
+        return srs_success;
+    }
+    virtual srs_error_t on_rtp(SrsRtpPacket* pkt) {
+        return srs_success;
+    }
+    virtual void on_unpublish() {
+    }
+    virtual bool active() {
+        return active_;
+    }
+    virtual srs_error_t on_frame(const std::vector<SrsRtpPacket*>& frame) {
+        if (frame[0]->is_keyframe()) {
+            keys_.push_back(frame[0]->header.get_sequence());
+        }
+        nn_frames_++;
+        return srs_success;
+    }
+};
+
+srs_error_t mock_track_packet(SrsRtcSource* source, SrsRtcVideoRecvTrack* track, uint32_t ssrc, uint16_t seq, uint32_t ts, bool keyframe)
+{
+    SrsRtpPacket* pkt = mock_frame_packet(seq, ts, true, keyframe);
+    SrsAutoFree(SrsRtpPacket, pkt);
+    pkt->header.set_ssrc(ssrc);
+    return track->on_rtp(source, pkt);
+}
+
+VOID TEST(AppRTCTest, SimulcastBridgeSwitchLayer)
+{
+    srs_error_t err;
+
+    SrsRtcConnection s(NULL, SrsContextId());
+
+    SrsRtcTrackDescription low_ds;
+    low_ds.type_ = "video";
+    low_ds.ssrc_ = 100;
+    SrsRtcVideoRecvTrack* low = new SrsRtcVideoRecvTrack(&s, &low_ds);
+    SrsAutoFree(SrsRtcVideoRecvTrack, low);
+
+    SrsRtcTrackDescription high_ds;
+    high_ds.type_ = "video";
+    high_ds.ssrc_ = 300;
+    SrsRtcVideoRecvTrack* high = new SrsRtcVideoRecvTrack(&s, &high_ds);
+    SrsAutoFree(SrsRtcVideoRecvTrack, high);
+
+    SrsRtcSource* source = new SrsRtcSource();
+    SrsAutoFree(SrsRtcSource, source);
+
+    MockRtcFrameBridge* bridge = new MockRtcFrameBridge();
+    source->set_bridge(bridge);
+
+    source->layers_.push_back(SrsRtcSimulcastLayer("l", 100));
+    source->layers_.push_back(SrsRtcSimulcastLayer("h", 300));
+
+    // Bridge the first layer, the seq from 1000 and ts from 0.
+    for (int i = 0; i < 10; i++) {
+        HELPER_EXPECT_SUCCESS(mock_track_packet(source, low, 100, 1000 + i, i * 3000, i == 0));
+    }
+    EXPECT_EQ(10, bridge->nn_frames_);
+    EXPECT_TRUE(low->frames_ != NULL);
+    EXPECT_TRUE(high->frames_ == NULL);
+
+    // Switch to the high layer, whose seq is before the head of low layer, and the ts is far away.
+    source->bridge_layer_->set_target(300);
+    for (int i = 0; i < 10; i++) {
+        HELPER_EXPECT_SUCCESS(mock_track_packet(source, high, 300, 40000 + i, 3000000000u + i * 3000, i == 0));
+        // The low layer is dropped after switched.
+        HELPER_EXPECT_SUCCESS(mock_track_packet(source, low, 100, 1010 + i, 30000 + i * 3000, false));
+    }
+    EXPECT_EQ(20, bridge->nn_frames_);
+    EXPECT_TRUE(low->frames_ == NULL);
+    ASSERT_EQ(2, (int)bridge->keys_.size());
+    EXPECT_EQ(1000, bridge->keys_[0]);
+    EXPECT_EQ(40000, bridge->keys_[1]);
+
+    // Switch back to the low layer, restart from its keyframe.
+    source->bridge_layer_->set_target(100);
+    HELPER_EXPECT_SUCCESS(mock_track_packet(source, low, 100, 1020, 60000, true));
+    HELPER_EXPECT_SUCCESS(mock_track_packet(source, low, 100, 1021, 63000, false));
+    EXPECT_EQ(22, bridge->nn_frames_);
+    ASSERT_EQ(3, (int)bridge->keys_.size());
+    EXPECT_EQ(1020, bridge->keys_[2]);
+
+    // Drop the jitter buffer when bridge is suspended.
+    bridge->active_ = false;
+    HELPER_EXPECT_SUCCESS(mock_track_packet(source, low, 100, 1022, 66000, false));
+    EXPECT_EQ(22, bridge->nn_frames_);
+    EXPECT_TRUE(low->frames_ == NULL);
+}
+
+class MockDtlsCallback : public ISrsDtlsCallback
+{
+public:
+    bool done;
+    std::vector<std::string> packets;
+public:
+    MockDtlsCallback() {
+        done = false;
+    }
+    virtual ~MockDtlsCallback() {
+    }
+public:
+    virtual srs_error_t on_dtls_handshake_done() {
+        done = true;
+        return srs_success;
+    }
+    virtual srs_error_t on_dtls_application_data(const char* data, const int len) {
+        return srs_success;
+    }
+    virtual srs_error_t write_dtls_data(void* data, int size) {
+        packets.push_back(std::string((char*)data, size));
+        return srs_success;
+    }
+    virtual srs_error_t on_dtls_alert(std::string type, std::string desc) {
+        return srs_success;
+    }
+};
+
+// Exchange the DTLS packets between client and server, until both done.
+srs_error_t mock_dtls_handshake(SrsDtls* client, MockDtlsCallback* client_cb, SrsDtls* server, MockDtlsCallback* server_cb, SrsThreadWorker* worker)
+{
+    srs_error_t err = srs_success;
+
+    for (int i = 0; i < 16 && (!client_cb->done || !server_cb->done); i++) {
+        std::vector<std::string> packets;
+        packets.swap(client_cb->packets);
+        for (int j = 0; j < (int)packets.size(); j++) {
+            std::string& p = packets.at(j);
+            if ((err = server->on_dtls((char*)p.data(), p.size())) != srs_success) {
+                return srs_error_wrap(err, "server");
+            }
+        }
+
+        // Handshake by worker, then replay in ST thread.
+        if (worker) {
+            while (worker->consume()) {
+            }
+            SrsDtlsServerImpl* impl = dynamic_cast<SrsDtlsServerImpl*>(server->impl);
+            if ((err = impl->replay()) != srs_success) {
+                return srs_error_wrap(err, "replay");
+            }
+        }
+
+        packets.clear();
+        packets.swap(server_cb->packets);
+        for (int j = 0; j < (int)packets.size(); j++) {
+            std::string& p = packets.at(j);
+            if ((err = client->on_dtls((char*)p.data(), p.size())) != srs_success) {
+                return srs_error_wrap(err, "client");
+            }
+        }
+    }
+
+    return err;
+}
+
+VOID TEST(AppRTCTest, DtlsHandshakeResumption)
+{
+    srs_error_t err;
+
+    uint64_t nn_handshakes = _srs_dtls_stat->handshakes();
+    uint64_t nn_resumed = _srs_dtls_stat->resumed();
+
+    // The full handshake, the context is shared by connections.
+    MockDtlsCallback client_cb, server_cb;
+    SrsDtls client(&client_cb), server(&server_cb);
+    HELPER_ASSERT_SUCCESS(client.initialize("active", "dtls1.2"));
+    HELPER_ASSERT_SUCCESS(server.initialize("passive", "dtls1.2"));
+    HELPER_ASSERT_SUCCESS(client.start_active_handshake());
+
+    HELPER_ASSERT_SUCCESS(mock_dtls_handshake(&client, &client_cb, &server, &server_cb, NULL));
+    EXPECT_TRUE(client_cb.done);
+    EXPECT_TRUE(server_cb.done);
+    EXPECT_FALSE(server.impl->is_resumed());
+
+    if (true) {
+        std::string client_recv, client_send, server_recv, server_send;
+        HELPER_EXPECT_SUCCESS(client.get_srtp_key(client_recv, client_send));
+        HELPER_EXPECT_SUCCESS(server.get_srtp_key(server_recv, server_send));
+        EXPECT_FALSE(client_recv.empty());
+        EXPECT_EQ(client_recv, server_send);
+        EXPECT_EQ(client_send, server_recv);
+    }
+
+    // The client resumes the previous session, which is still alive, because the session is not
+    // resumable if the connection is closed without shutdown.
+    if (true) {
+        SSL_SESSION* session = SSL_get1_session(client.impl->dtls);
+        ASSERT_TRUE(session != NULL);
+
+        MockDtlsCallback client2_cb, server2_cb;
+        SrsDtls client2(&client2_cb), server2(&server2_cb);
+        HELPER_ASSERT_SUCCESS(client2.initialize("active", "dtls1.2"));
+        HELPER_ASSERT_SUCCESS(server2.initialize("passive", "dtls1.2"));
+        SSL_set_session(client2.impl->dtls, session);
+        SSL_SESSION_free(session);
+        HELPER_ASSERT_SUCCESS(client2.start_active_handshake());
+
+        HELPER_ASSERT_SUCCESS(mock_dtls_handshake(&client2, &client2_cb, &server2, &server2_cb, NULL));
+        EXPECT_TRUE(client2_cb.done);
+        EXPECT_TRUE(server2_cb.done);
+        EXPECT_TRUE(server2.impl->is_resumed());
+
+        std::string client_recv, client_send, server_recv, server_send;
+        HELPER_EXPECT_SUCCESS(client2.get_srtp_key(client_recv, client_send));
+        HELPER_EXPECT_SUCCESS(server2.get_srtp_key(server_recv, server_send));
+        EXPECT_EQ(client_recv, server_send);
+        EXPECT_EQ(client_send, server_recv);
+    }
+
+    EXPECT_EQ(nn_handshakes + 2, _srs_dtls_stat->handshakes());
+    EXPECT_EQ(nn_resumed + 1, _srs_dtls_stat->resumed());
+}
+
+VOID TEST(AppRTCTest, DtlsHandshakeByWorker)
+{
+    srs_error_t err;
+
+    int nn_handshaking = _srs_dtls_stat->handshaking();
+
+    SrsThreadWorker worker(0, 16);
+    MockDtlsCallback client_cb, server_cb;
+    SrsDtls client(&client_cb), server(&server_cb);
+    HELPER_ASSERT_SUCCESS(client.initialize("active", "dtls1.2"));
+    HELPER_ASSERT_SUCCESS(server.initialize("passive", "dtls1.2"));
+    SrsDtlsServerImpl* impl = dynamic_cast<SrsDtlsServerImpl*>(server.impl);
+    ASSERT_TRUE(impl != NULL);
+    impl->worker_ = &worker;
+    HELPER_ASSERT_SUCCESS(client.start_active_handshake());
+
+    // The ClientHello is queued to worker, and nothing is sent before replay.
+    ASSERT_EQ(1, (int)client_cb.packets.size());
+    std::string hello = client_cb.packets.at(0);
+    client_cb.packets.clear();
+    HELPER_ASSERT_SUCCESS(server.on_dtls((char*)hello.data(), hello.size()));
+    EXPECT_EQ(1, worker.depth());
+    EXPECT_EQ(nn_handshaking + 1, _srs_dtls_stat->handshaking());
+    EXPECT_TRUE(server_cb.packets.empty());
+
+    EXPECT_TRUE(worker.consume());
+    EXPECT_FALSE(worker.consume());
+    EXPECT_EQ(0, impl->ctx_->pending());
+    EXPECT_TRUE(server_cb.packets.empty());
+    HELPER_ASSERT_SUCCESS(impl->replay());
+    EXPECT_FALSE(server_cb.packets.empty());
+
+    // Finish the handshake by worker.
+    HELPER_ASSERT_SUCCESS(mock_dtls_handshake(&client, &client_cb, &server, &server_cb, &worker));
+    EXPECT_TRUE(client_cb.done);
+    EXPECT_TRUE(server_cb.done);
+    EXPECT_TRUE(impl->done_);
+    EXPECT_EQ(nn_handshaking, _srs_dtls_stat->handshaking());
+    EXPECT_GE((int)worker.tasks(), 2);
+
+    // The SRTP keys are exported by worker.
+    EXPECT_FALSE(impl->srtp_recv_key_.empty());
+    std::string client_recv, client_send, server_recv, server_send;
+    HELPER_EXPECT_SUCCESS(client.get_srtp_key(client_recv, client_send));
+    HELPER_EXPECT_SUCCESS(server.get_srtp_key(server_recv, server_send));
+    EXPECT_EQ(client_recv, server_send);
+    EXPECT_EQ(client_send, server_recv);
+
+    // The error replayed by timer is returned by the next packet.
+    impl->deferred_->on_error(srs_error_new(ERROR_RTC_DTLS, "mock"));
+    HELPER_EXPECT_SUCCESS(impl->on_timer(20 * SRS_UTIME_MILLISECONDS));
+    HELPER_EXPECT_FAILED(server.on_dtls((char*)hello.data(), hello.size()));
+    EXPECT_TRUE(impl->err_ == srs_success);
+}
+
+VOID TEST(AppRTCTest, DtlsStatisticPercentile)
+{
+    SrsDtlsStatistic stat;
+    EXPECT_EQ(0, stat.percentile(0.99));
+
+    for (int i = 1; i <= 100; i++) {
+        stat.on_start();
+        stat.on_done(i * SRS_UTIME_MILLISECONDS, i % 10 == 0);
+    }
+    EXPECT_EQ(0, stat.handshaking());
+    EXPECT_EQ(100, (int)stat.handshakes());
+    EXPECT_EQ(10, (int)stat.resumed());
+    EXPECT_EQ(50 * SRS_UTIME_MILLISECONDS, stat.percentile(0.5));
+    EXPECT_EQ(99 * SRS_UTIME_MILLISECONDS, stat.percentile(0.99));
+    EXPECT_EQ(100 * SRS_UTIME_MILLISECONDS, stat.percentile(1));
+
+    // Only the recent handshakes are sampled.
+    for (int i = 0; i < 1024; i++) {
+        stat.on_start();
+        stat.on_done(1 * SRS_UTIME_MILLISECONDS, false);
+    }
+    EXPECT_EQ(1 * SRS_UTIME_MILLISECONDS, stat.percentile(0.99));
+
+    stat.on_start();
+    EXPECT_EQ(1, stat.handshaking());
+    stat.on_abort();
+    EXPECT_EQ(0, stat.handshaking());
+}
+
+VOID TEST(AppRTCTest, RtcpCompoundPacket)
+{
+    srs_error_t err;
+
+    SrsRtcConnection s(NULL, SrsContextId());
+    char buf[kRtcpPacketSize];
+    memset(buf, 0, sizeof(buf));
+
+    // The RR, XR and TWCC are combined in one packet.
+    HELPER_EXPECT_SUCCESS(s.append_rtcp(buf, 32));
+    HELPER_EXPECT_SUCCESS(s.append_rtcp(buf, 24));
+    HELPER_EXPECT_SUCCESS(s.append_rtcp(buf, 100));
+    EXPECT_EQ(156, s.nn_rtcp_compound_);
+
+    // Flush the compound packet if full.
+    HELPER_EXPECT_SUCCESS(s.append_rtcp(buf, SRS_RTCP_COMPOUND_SIZE - 100));
+    EXPECT_EQ(SRS_RTCP_COMPOUND_SIZE - 100, s.nn_rtcp_compound_);
+
+    HELPER_EXPECT_SUCCESS(s.flush_rtcp());
+    EXPECT_EQ(0, s.nn_rtcp_compound_);
+
+    // A large TWCC is sent alone.
+    HELPER_EXPECT_SUCCESS(s.append_rtcp(buf, 32));
+    HELPER_EXPECT_SUCCESS(s.append_rtcp(buf, kMaxUDPDataSize));
+    EXPECT_EQ(kMaxUDPDataSize, s.nn_rtcp_compound_);
+    HELPER_EXPECT_SUCCESS(s.flush_rtcp());
+
+    HELPER_EXPECT_FAILED(s.append_rtcp(buf, kMaxUDPDataSize + 1));
+}
+
+VOID TEST(AppRTCTest, RtcConsumerLatency)
+{
+    srs_error_t err;
+
+    SrsRtcSource* source = new SrsRtcSource();
+    SrsAutoFree(SrsRtcSource, source);
+
+    SrsRtcConsumer* consumer = new SrsRtcConsumer(source);
+    SrsAutoFree(SrsRtcConsumer, consumer);
+
+    SrsLatencyHistogram h;
+    consumer->set_latency(&h);
+
+    // Only the sampled packets are timed.
+    for (int i = 0; i < 2 * SRS_LATENCY_SAMPLE_RATE; i++) {
+        HELPER_EXPECT_SUCCESS(consumer->enqueue(new SrsRtpPacket()));
+    }
+    EXPECT_EQ(2, (int)consumer->times_.size());
+
+    for (int i = 0; i < 2 * SRS_LATENCY_SAMPLE_RATE; i++) {
+        SrsRtpPacket* pkt = NULL;
+        HELPER_EXPECT_SUCCESS(consumer->dump_packet(&pkt));
+        ASSERT_TRUE(pkt != NULL);
+        srs_freep(pkt);
+    }
+    EXPECT_EQ(2, h.count());
+    EXPECT_TRUE(consumer->times_.empty());
+}
+
+VOID TEST(AppRTCTest, UdpBatchSender)
+{
+    srs_error_t err;
+
+    srs_netfd_t server = NULL, client = NULL;
+    HELPER_ASSERT_SUCCESS(srs_udp_listen("127.0.0.1", 11935, &server));
+    HELPER_ASSERT_SUCCESS(srs_udp_listen("127.0.0.1", 11936, &client));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(11935);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+
+    if (true) {
+        SrsUdpBatchSender batch;
+        batch.initialize(4);
+
+        // The packets are sent in batch, by one syscall.
+        for (int i = 0; i < 3; i++) {
+            char c = 'a' + i;
+            HELPER_EXPECT_SUCCESS(batch.sendto(client, &c, 1, (sockaddr*)&addr, sizeof(addr)));
+        }
+        EXPECT_EQ(3, batch.size());
+        EXPECT_EQ(0, (int)batch.syscalls());
+
+        batch.flush();
+        EXPECT_EQ(0, batch.size());
+        EXPECT_EQ(3, (int)batch.packets());
+        EXPECT_EQ(1, (int)batch.syscalls());
+
+        for (int i = 0; i < 3; i++) {
+            char c = 0;
+            EXPECT_EQ(1, srs_recvfrom(server, &c, 1, NULL, NULL, 1 * SRS_UTIME_SECONDS));
+            EXPECT_EQ('a' + i, c);
+        }
+
+        // Flush when full.
+        for (int i = 0; i < 4; i++) {
+            char c = 'x';
+            HELPER_EXPECT_SUCCESS(batch.sendto(client, &c, 1, (sockaddr*)&addr, sizeof(addr)));
+        }
+        EXPECT_EQ(0, batch.size());
+        EXPECT_EQ(7, (int)batch.packets());
+        EXPECT_EQ(2, (int)batch.syscalls());
+
+        for (int i = 0; i < 4; i++) {
+            char c = 0;
+            EXPECT_EQ(1, srs_recvfrom(server, &c, 1, NULL, NULL, 1 * SRS_UTIME_SECONDS));
+            EXPECT_EQ('x', c);
+        }
+
+        // Flush by coroutine when current coroutine yields.
+        for (int i = 0; i < 2; i++) {
+            char c = 'z';
+            HELPER_EXPECT_SUCCESS(batch.sendto(client, &c, 1, (sockaddr*)&addr, sizeof(addr)));
+        }
+        EXPECT_EQ(2, batch.size());
+
+        srs_usleep(1 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(0, batch.size());
+        EXPECT_EQ(9, (int)batch.packets());
+        EXPECT_EQ(3, (int)batch.syscalls());
+
+        for (int i = 0; i < 2; i++) {
+            char c = 0;
+            EXPECT_EQ(1, srs_recvfrom(server, &c, 1, NULL, NULL, 1 * SRS_UTIME_SECONDS));
+            EXPECT_EQ('z', c);
+        }
+    }
+
+    // The packets are sent directly, if batch is disabled.
+    if (true) {
+        SrsUdpBatchSender batch;
+        batch.initialize(0);
+
+        char c = 'y';
+        HELPER_EXPECT_SUCCESS(batch.sendto(client, &c, 1, (sockaddr*)&addr, sizeof(addr)));
+        EXPECT_EQ(0, batch.size());
+        EXPECT_EQ(1, (int)batch.syscalls());
+
+        c = 0;
+        EXPECT_EQ(1, srs_recvfrom(server, &c, 1, NULL, NULL, 1 * SRS_UTIME_SECONDS));
+        EXPECT_EQ('y', c);
+    }
+
+    srs_close_stfd(server);
+    srs_close_stfd(client);
+}
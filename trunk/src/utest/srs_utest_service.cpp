@@ -8,6 +8,7 @@
 using namespace std;
 
 #include <srs_kernel_error.hpp>
+#include <srs_kernel_utility.hpp>
 #include <srs_app_listener.hpp>
 #include <srs_protocol_st.hpp>
 #include <srs_protocol_utility.hpp>
@@ -184,6 +185,145 @@ VOID TEST(TCPServerTest, PingPong)
 	}
 }
 
+class MockTcpCountHandler : public ISrsTcpHandler
+{
+public:
+    std::vector<srs_netfd_t> fds;
+    // The number of errors to return for clients.
+    int nn_errors;
+public:
+    MockTcpCountHandler() {
+        nn_errors = 0;
+    }
+    virtual ~MockTcpCountHandler() {
+        for (int i = 0; i < (int)fds.size(); i++) {
+            srs_close_stfd(fds[i]);
+        }
+    }
+public:
+    virtual srs_error_t on_tcp_client(ISrsListener* listener, srs_netfd_t stfd) {
+        if (nn_errors > 0) {
+            nn_errors--;
+            srs_close_stfd(stfd);
+            return srs_error_new(ERROR_EXCEED_CONNECTIONS, "mock error");
+        }
+        fds.push_back(stfd);
+        return srs_success;
+    }
+};
+
+VOID TEST(TCPServerTest, AcceptBatch)
+{
+    srs_error_t err;
+
+    // Accept all connections in backlog, and never quit for error of client.
+    if (true) {
+        MockTcpCountHandler h;
+        h.nn_errors = 2;
+        SrsTcpListener l(&h);
+        l.set_endpoint(_srs_tmp_host, _srs_tmp_port)->set_accept_batch(4);
+        HELPER_EXPECT_SUCCESS(l.listen());
+
+        vector<SrsTcpClient*> clients;
+        for (int i = 0; i < 10; i++) {
+            SrsTcpClient* c = new SrsTcpClient(_srs_tmp_host, _srs_tmp_port, _srs_tmp_timeout);
+            clients.push_back(c);
+            HELPER_EXPECT_SUCCESS(c->connect());
+        }
+
+        srs_usleep(30 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(8, (int)h.fds.size());
+
+        for (int i = 0; i < (int)clients.size(); i++) {
+            srs_freep(clients[i]);
+        }
+    }
+
+    // Multiple listeners for an endpoint by SO_REUSEPORT.
+    if (true) {
+        MockTcpCountHandler h;
+        SrsMultipleTcpListeners l(&h);
+        l.set_reuseport(2)->set_accept(4, 0)->add(vector<string>(1, _srs_tmp_host + ":" + srs_int2str(_srs_tmp_port)));
+        EXPECT_EQ(2, (int)l.listeners_.size());
+        HELPER_EXPECT_SUCCESS(l.listen());
+
+        vector<SrsTcpClient*> clients;
+        for (int i = 0; i < 10; i++) {
+            SrsTcpClient* c = new SrsTcpClient(_srs_tmp_host, _srs_tmp_port, _srs_tmp_timeout);
+            clients.push_back(c);
+            HELPER_EXPECT_SUCCESS(c->connect());
+        }
+
+        srs_usleep(30 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(10, (int)h.fds.size());
+
+        for (int i = 0; i < (int)clients.size(); i++) {
+            srs_freep(clients[i]);
+        }
+    }
+
+    // Reject the connections which exceed the rate.
+    if (true) {
+        MockTcpCountHandler h;
+        SrsMultipleTcpListeners l(&h);
+        l.set_accept(4, 3)->add(vector<string>(1, _srs_tmp_host + ":" + srs_int2str(_srs_tmp_port)));
+        HELPER_EXPECT_SUCCESS(l.listen());
+
+        vector<SrsTcpClient*> clients;
+        for (int i = 0; i < 5; i++) {
+            SrsTcpClient* c = new SrsTcpClient(_srs_tmp_host, _srs_tmp_port, _srs_tmp_timeout);
+            clients.push_back(c);
+            HELPER_EXPECT_SUCCESS(c->connect());
+        }
+
+        srs_usleep(30 * SRS_UTIME_MILLISECONDS);
+        EXPECT_EQ(3, (int)h.fds.size());
+        EXPECT_EQ(2, (int)l.limiter_->nn_rejected());
+
+        for (int i = 0; i < (int)clients.size(); i++) {
+            srs_freep(clients[i]);
+        }
+    }
+}
+
+VOID TEST(TCPServerTest, AcceptRateLimiter)
+{
+    // Disabled if rate is 0.
+    if (true) {
+        SrsAcceptRateLimiter l(0);
+        for (int i = 0; i < 1000; i++) {
+            EXPECT_TRUE(l.acquire(0));
+        }
+        EXPECT_EQ(0, (int)l.nn_rejected());
+    }
+
+    // Burst at most rate, then fill by elapsed time.
+    if (true) {
+        srs_utime_t now = 1000 * SRS_UTIME_SECONDS;
+        SrsAcceptRateLimiter l(10);
+        for (int i = 0; i < 10; i++) {
+            EXPECT_TRUE(l.acquire(now));
+        }
+        EXPECT_FALSE(l.acquire(now));
+        EXPECT_EQ(1, (int)l.nn_rejected());
+
+        // Fill a token every 100ms.
+        now += 50 * SRS_UTIME_MILLISECONDS;
+        EXPECT_FALSE(l.acquire(now));
+        now += 50 * SRS_UTIME_MILLISECONDS;
+        EXPECT_TRUE(l.acquire(now));
+        EXPECT_FALSE(l.acquire(now));
+
+        // Never exceed the rate after a long time.
+        now += 100 * SRS_UTIME_SECONDS;
+        for (int i = 0; i < 10; i++) {
+            EXPECT_TRUE(l.acquire(now));
+        }
+        EXPECT_FALSE(l.acquire(now));
+        EXPECT_EQ(4, (int)l.nn_rejected());
+    }
+}
+
 VOID TEST(TCPServerTest, PingPongWithTimeout)
 {
 	srs_error_t err;